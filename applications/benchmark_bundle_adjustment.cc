@@ -0,0 +1,171 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <theia/theia.h>
+
+#include <string>
+#include <vector>
+
+// Compares the Ceres and SCHUR bundle adjustment backends on synthetic scenes
+// of increasing size. The cameras move along a line and look sideways at a
+// wall of points, so each point is seen by a few dozen nearby cameras as in
+// real sequences. The cameras and points are perturbed and both backends
+// optimize the same perturbed scene.
+DEFINE_int32(min_num_views, 100, "Number of views of the smallest scene.");
+DEFINE_int32(num_scenes, 4, "Number of scenes. Each doubles the views.");
+DEFINE_int32(num_points_per_view, 200, "Number of points per view.");
+DEFINE_double(pixel_noise, 0.5, "Noise of the observations in pixels.");
+DEFINE_double(perturbation, 0.05, "Noise added to cameras and points.");
+DEFINE_string(linear_solver_type,
+              "SPARSE_SCHUR",
+              "Linear solver: SPARSE_SCHUR, ITERATIVE_SCHUR or DENSE_SCHUR.");
+DEFINE_int32(num_threads, 1, "Number of threads of both backends.");
+DEFINE_int32(max_num_iterations, 20, "Maximum number of iterations.");
+
+using theia::BundleAdjustmentBackend;
+using theia::BundleAdjustmentOptions;
+using theia::BundleAdjustmentSummary;
+using theia::Camera;
+using theia::Reconstruction;
+
+// Builds the scene with a fixed seed so that both backends get the same input.
+void BuildScene(const int num_views, Reconstruction* reconstruction) {
+  static const double kFocalLength = 500.0;
+  static const double kImageSize = 1000.0;
+  theia::RandomNumberGenerator rng(59);
+
+  for (int i = 0; i < num_views; i++) {
+    const theia::ViewId view_id =
+        reconstruction->AddView(std::to_string(i), 0, static_cast<double>(i));
+    theia::View* view = reconstruction->MutableView(view_id);
+    Camera* camera = view->MutableCamera();
+    camera->SetImageSize(kImageSize, kImageSize);
+    camera->SetFocalLength(kFocalLength);
+    camera->SetPrincipalPoint(kImageSize / 2.0, kImageSize / 2.0);
+    camera->SetPosition(Eigen::Vector3d(i, rng.RandGaussian(0.0, 0.1), 0.0));
+    camera->SetOrientationFromAngleAxis(0.02 * rng.RandVector3d());
+    view->SetEstimated(true);
+  }
+
+  const int num_points = num_views * FLAGS_num_points_per_view / 20;
+  for (int i = 0; i < num_points; i++) {
+    const Eigen::Vector4d point(rng.RandDouble(0.0, num_views),
+                                rng.RandDouble(-5.0, 5.0),
+                                rng.RandDouble(5.0, 15.0),
+                                1.0);
+    std::vector<std::pair<theia::ViewId, theia::Feature> > observations;
+    for (const theia::ViewId view_id : reconstruction->ViewIds()) {
+      const Camera& camera = reconstruction->View(view_id)->Camera();
+      if (std::abs(camera.GetPosition().x() - point.x()) > point.z()) {
+        continue;
+      }
+      Eigen::Vector2d pixel;
+      if (camera.ProjectPoint(point, &pixel) <= 0.0 || pixel.x() < 0.0 ||
+          pixel.y() < 0.0 || pixel.x() > kImageSize ||
+          pixel.y() > kImageSize) {
+        continue;
+      }
+      pixel += FLAGS_pixel_noise * rng.RandVector2d();
+      observations.emplace_back(view_id, theia::Feature(pixel));
+    }
+    if (observations.size() < 2) {
+      continue;
+    }
+    const theia::TrackId track_id = reconstruction->AddTrack(observations);
+    theia::Track* track = reconstruction->MutableTrack(track_id);
+    track->SetPoint(point + FLAGS_perturbation *
+                                rng.RandVector3d().homogeneous() -
+                    FLAGS_perturbation * Eigen::Vector4d::UnitW());
+    track->SetEstimated(true);
+  }
+
+  // The first view is held constant by BundleAdjustPartialViewsConstant.
+  for (const theia::ViewId view_id : reconstruction->ViewIds()) {
+    if (view_id == 0) {
+      continue;
+    }
+    Camera* camera = reconstruction->MutableView(view_id)->MutableCamera();
+    camera->SetPosition(camera->GetPosition() +
+                        FLAGS_perturbation * rng.RandVector3d());
+  }
+}
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  THEIA_GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+
+  BundleAdjustmentOptions options;
+  if (FLAGS_linear_solver_type == "SPARSE_SCHUR") {
+    options.linear_solver_type = ceres::SPARSE_SCHUR;
+  } else if (FLAGS_linear_solver_type == "ITERATIVE_SCHUR") {
+    options.linear_solver_type = ceres::ITERATIVE_SCHUR;
+  } else if (FLAGS_linear_solver_type == "DENSE_SCHUR") {
+    options.linear_solver_type = ceres::DENSE_SCHUR;
+  } else {
+    LOG(FATAL) << "Invalid linear solver type: " << FLAGS_linear_solver_type;
+  }
+  options.num_threads = FLAGS_num_threads;
+  options.max_num_iterations = FLAGS_max_num_iterations;
+  options.use_inner_iterations = false;
+
+  int num_views = FLAGS_min_num_views;
+  for (int i = 0; i < FLAGS_num_scenes; i++, num_views *= 2) {
+    for (const BundleAdjustmentBackend backend :
+         {BundleAdjustmentBackend::CERES, BundleAdjustmentBackend::SCHUR}) {
+      Reconstruction reconstruction;
+      BuildScene(num_views, &reconstruction);
+      std::vector<theia::ViewId> variable_view_ids;
+      for (const theia::ViewId view_id : reconstruction.ViewIds()) {
+        if (view_id != 0) {
+          variable_view_ids.emplace_back(view_id);
+        }
+      }
+
+      options.backend = backend;
+      const BundleAdjustmentSummary summary =
+          theia::BundleAdjustPartialViewsConstant(
+              options, variable_view_ids, {0}, &reconstruction);
+      LOG(INFO) << (backend == BundleAdjustmentBackend::CERES ? "Ceres"
+                                                               : "Schur")
+                << ": " << reconstruction.NumViews() << " views, "
+                << reconstruction.NumTracks() << " tracks, "
+                << summary.num_residuals / 2 << " observations. Setup "
+                << summary.setup_time_in_seconds << " s, solve "
+                << summary.solve_time_in_seconds << " s, cost "
+                << summary.initial_cost << " -> " << summary.final_cost;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,225 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <theia/theia.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Measures the ingest and random-read throughput of the RocksDB features and
+// matches database on a synthetic image collection.
+DEFINE_string(database_directory,
+              "",
+              "Directory of the RocksDB database. It must not exist yet and "
+              "is removed after the benchmark.");
+DEFINE_int32(num_images, 100000, "Number of synthetic images.");
+DEFINE_int32(num_features_per_image, 64, "Number of features per image.");
+DEFINE_int32(descriptor_dimension, 128, "Dimension of the descriptors.");
+DEFINE_int32(num_matches_per_image,
+             10,
+             "Number of image pairs matched with each image.");
+DEFINE_int32(num_correspondences_per_match,
+             100,
+             "Number of feature correspondences of each image pair.");
+DEFINE_int32(match_batch_size,
+             20,
+             "Number of image pair matches written with one write batch.");
+DEFINE_int32(num_random_reads, 10000, "Number of random reads of features.");
+DEFINE_int32(read_batch_size,
+             40,
+             "Number of features read with one MultiGet request.");
+DEFINE_int64(block_cache_size_mb, 512, "Size of the block cache in MB.");
+DEFINE_int32(bloom_filter_bits_per_key,
+             10,
+             "Bits per key of the bloom filters. 0 disables them.");
+DEFINE_bool(disable_write_ahead_log,
+            false,
+            "Skip the write-ahead log when writing.");
+
+using theia::ImagePairMatch;
+using theia::Keypoint;
+using theia::KeypointsAndDescriptors;
+using theia::RocksDbFeaturesAndMatchesDatabase;
+
+std::string ImageName(const int image_index) {
+  return "image_" + std::to_string(image_index) + ".jpg";
+}
+
+KeypointsAndDescriptors CreateFeatures(const int image_index,
+                                       theia::RandomNumberGenerator* rng) {
+  KeypointsAndDescriptors features;
+  features.image_name = ImageName(image_index);
+  features.keypoints.reserve(FLAGS_num_features_per_image);
+  features.descriptors.reserve(FLAGS_num_features_per_image);
+  for (int i = 0; i < FLAGS_num_features_per_image; i++) {
+    features.keypoints.emplace_back(rng->RandDouble(0.0, 1000.0),
+                                    rng->RandDouble(0.0, 1000.0),
+                                    Keypoint::SIFT);
+    Eigen::VectorXf descriptor(FLAGS_descriptor_dimension);
+    rng->SetRandom(&descriptor);
+    features.descriptors.emplace_back(descriptor);
+  }
+  return features;
+}
+
+ImagePairMatch CreateMatch(const int image_index1,
+                           const int image_index2,
+                           theia::RandomNumberGenerator* rng) {
+  ImagePairMatch match;
+  match.image1 = ImageName(image_index1);
+  match.image2 = ImageName(image_index2);
+  match.correspondences.resize(FLAGS_num_correspondences_per_match);
+  for (theia::FeatureCorrespondence& correspondence : match.correspondences) {
+    correspondence.feature1.point_ = rng->RandVector2d(0.0, 1000.0);
+    correspondence.feature2.point_ = rng->RandVector2d(0.0, 1000.0);
+  }
+  return match;
+}
+
+void LogThroughput(const std::string& operation,
+                   const int num_operations,
+                   const double elapsed_seconds) {
+  LOG(INFO) << operation << ": " << num_operations << " in " << elapsed_seconds
+            << " seconds (" << num_operations / elapsed_seconds
+            << " per second).";
+}
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  THEIA_GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK(!FLAGS_database_directory.empty())
+      << "A database directory must be given.";
+  CHECK(!theia::DirectoryExists(FLAGS_database_directory))
+      << "The database directory must not exist.";
+
+  RocksDbFeaturesAndMatchesDatabase::Options options;
+  options.block_cache_size_bytes = FLAGS_block_cache_size_mb << 20;
+  options.bloom_filter_bits_per_key = FLAGS_bloom_filter_bits_per_key;
+  options.disable_write_ahead_log = FLAGS_disable_write_ahead_log;
+
+  theia::RandomNumberGenerator rng(79);
+  theia::Timer timer;
+  {
+    RocksDbFeaturesAndMatchesDatabase database(FLAGS_database_directory,
+                                               options);
+
+    // Ingest the features one image at a time, as the feature extractor does.
+    timer.Reset();
+    for (int i = 0; i < FLAGS_num_images; i++) {
+      database.PutFeatures(ImageName(i), CreateFeatures(i, &rng));
+    }
+    LogThroughput(
+        "Feature ingest", FLAGS_num_images, timer.ElapsedTimeInSeconds());
+
+    // Ingest the matches in batches, as the feature matcher does.
+    std::vector<ImagePairMatch> matches;
+    int num_matches = 0;
+    timer.Reset();
+    for (int i = 0; i < FLAGS_num_images; i++) {
+      for (int j = 1; j <= FLAGS_num_matches_per_image; j++) {
+        matches.emplace_back(CreateMatch(i, (i + j) % FLAGS_num_images, &rng));
+        if (matches.size() == FLAGS_match_batch_size) {
+          database.PutImagePairMatches(matches);
+          num_matches += matches.size();
+          matches.clear();
+        }
+      }
+    }
+    database.PutImagePairMatches(matches);
+    num_matches += matches.size();
+    LogThroughput("Match ingest", num_matches, timer.ElapsedTimeInSeconds());
+  }
+
+  {
+    // Reopen the database so that reads are not served from the memtables.
+    RocksDbFeaturesAndMatchesDatabase database(FLAGS_database_directory,
+                                               options);
+    std::vector<std::string> image_names(FLAGS_num_random_reads);
+    for (std::string& image_name : image_names) {
+      image_name = ImageName(rng.RandInt(0, FLAGS_num_images - 1));
+    }
+
+    timer.Reset();
+    for (const std::string& image_name : image_names) {
+      const KeypointsAndDescriptors features = database.GetFeatures(image_name);
+      CHECK_EQ(features.keypoints.size(), FLAGS_num_features_per_image);
+    }
+    LogThroughput("Random feature reads with Get",
+                  FLAGS_num_random_reads,
+                  timer.ElapsedTimeInSeconds());
+
+    timer.Reset();
+    for (int i = 0; i < image_names.size(); i += FLAGS_read_batch_size) {
+      const int end =
+          std::min<int>(image_names.size(), i + FLAGS_read_batch_size);
+      const std::vector<std::string> batch(image_names.begin() + i,
+                                           image_names.begin() + end);
+      const std::vector<KeypointsAndDescriptors> features =
+          database.GetFeaturesForImages(batch);
+      CHECK_EQ(features.size(), batch.size());
+    }
+    LogThroughput("Random feature reads with MultiGet",
+                  FLAGS_num_random_reads,
+                  timer.ElapsedTimeInSeconds());
+
+    timer.Reset();
+    for (int i = 0; i < FLAGS_num_random_reads; i++) {
+      const int image_index = rng.RandInt(0, FLAGS_num_images - 1);
+      const int offset = rng.RandInt(1, FLAGS_num_matches_per_image);
+      const int other_image_index = (image_index + offset) % FLAGS_num_images;
+      database.GetImagePairMatch(ImageName(image_index),
+                                 ImageName(other_image_index));
+    }
+    LogThroughput("Random match reads",
+                  FLAGS_num_random_reads,
+                  timer.ElapsedTimeInSeconds());
+
+    // Misses are answered by the bloom filters without reading data blocks.
+    timer.Reset();
+    for (int i = 0; i < FLAGS_num_random_reads; i++) {
+      CHECK(!database.ContainsFeatures("missing_" + std::to_string(i)));
+    }
+    LogThroughput("Lookups of missing features",
+                  FLAGS_num_random_reads,
+                  timer.ElapsedTimeInSeconds());
+  }
+
+  // The database has been closed, so its files can be removed.
+  CHECK(theia::RemoveDirectory(FLAGS_database_directory))
+      << "Could not remove the database directory "
+      << FLAGS_database_directory;
+
+  return 0;
+}
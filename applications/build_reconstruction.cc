@@ -209,6 +209,50 @@ DEFINE_int32(partial_bundle_adjustment_num_views,
              20,
              "When full BA is not being run, partial BA is executed on a "
              "constant number of views specified by this parameter.");
+DEFINE_bool(use_covisibility_local_bundle_adjustment,
+            false,
+            "Select the views for partial BA by covisibility with the most "
+            "recently added views, and trigger full BA by the measured drift "
+            "instead of the growth percent.");
+DEFINE_int32(local_bundle_adjustment_num_seed_views,
+             3,
+             "With covisibility local BA, the number of most recently added "
+             "views that seed the local BA window.");
+DEFINE_int32(local_bundle_adjustment_min_num_shared_tracks,
+             15,
+             "With covisibility local BA, the minimum number of tracks a view "
+             "must share with the seed views to be added to the window.");
+DEFINE_double(full_bundle_adjustment_max_cost_ratio,
+              2.0,
+              "With covisibility local BA, full BA is triggered when the mean "
+              "squared reprojection error of a local BA problem exceeds this "
+              "multiple of the error after the last full BA.");
+DEFINE_double(full_bundle_adjustment_max_growth_percent,
+              25.0,
+              "With covisibility local BA, full BA is always triggered when "
+              "the reconstruction has grown by this percent since the last "
+              "full BA.");
+
+// Partitioned SfM options.
+DEFINE_string(partition_reconstruction_estimator,
+              "GLOBAL",
+              "Type of SfM reconstruction estimation to use for each partition "
+              "when the PARTITIONED reconstruction estimator is used.");
+DEFINE_int32(partition_max_num_views,
+             500,
+             "Maximum number of views in each partition of the view graph.");
+DEFINE_int32(partition_num_parallel_reconstructions,
+             1,
+             "Number of partitions that are estimated in parallel.");
+DEFINE_string(partition_directory,
+              "",
+              "Directory that the estimated partitions are written to until "
+              "they are merged. If empty, a temporary directory is used and "
+              "removed after merging.");
+DEFINE_bool(partition_keep_in_memory,
+            false,
+            "Keep the estimated partitions in memory until they are merged "
+            "instead of writing them to disk.");
 
 // Triangulation options.
 DEFINE_double(min_triangulation_angle_degrees,
@@ -355,6 +399,30 @@ ReconstructionBuilderOptions SetReconstructionBuilderOptions() {
       FLAGS_full_bundle_adjustment_growth_percent;
   reconstruction_estimator_options.partial_bundle_adjustment_num_views =
       FLAGS_partial_bundle_adjustment_num_views;
+  reconstruction_estimator_options.use_covisibility_local_bundle_adjustment =
+      FLAGS_use_covisibility_local_bundle_adjustment;
+  reconstruction_estimator_options.local_bundle_adjustment_num_seed_views =
+      FLAGS_local_bundle_adjustment_num_seed_views;
+  reconstruction_estimator_options
+      .local_bundle_adjustment_min_num_shared_tracks =
+      FLAGS_local_bundle_adjustment_min_num_shared_tracks;
+  reconstruction_estimator_options.full_bundle_adjustment_max_cost_ratio =
+      FLAGS_full_bundle_adjustment_max_cost_ratio;
+  reconstruction_estimator_options.full_bundle_adjustment_max_growth_percent =
+      FLAGS_full_bundle_adjustment_max_growth_percent;
+
+  // Partitioned SfM options.
+  reconstruction_estimator_options.partition_reconstruction_estimator_type =
+      StringToReconstructionEstimatorType(
+          FLAGS_partition_reconstruction_estimator);
+  reconstruction_estimator_options.partition_max_num_views =
+      FLAGS_partition_max_num_views;
+  reconstruction_estimator_options.partition_num_parallel_reconstructions =
+      FLAGS_partition_num_parallel_reconstructions;
+  reconstruction_estimator_options.partition_directory =
+      FLAGS_partition_directory;
+  reconstruction_estimator_options.partition_keep_in_memory =
+      FLAGS_partition_keep_in_memory;
 
   // Triangulation options (used by all SfM pipelines).
   reconstruction_estimator_options.min_triangulation_angle_degrees =
@@ -130,6 +130,29 @@ DEFINE_int32(partial_bundle_adjustment_num_views,
              20,
              "When full BA is not being run, partial BA is executed on a "
              "constant number of views specified by this parameter.");
+DEFINE_bool(use_covisibility_local_bundle_adjustment,
+            false,
+            "Select the views for partial BA by covisibility with the most "
+            "recently added views, and trigger full BA by the measured drift "
+            "instead of the growth percent.");
+DEFINE_int32(local_bundle_adjustment_num_seed_views,
+             3,
+             "With covisibility local BA, the number of most recently added "
+             "views that seed the local BA window.");
+DEFINE_int32(local_bundle_adjustment_min_num_shared_tracks,
+             15,
+             "With covisibility local BA, the minimum number of tracks a view "
+             "must share with the seed views to be added to the window.");
+DEFINE_double(full_bundle_adjustment_max_cost_ratio,
+              2.0,
+              "With covisibility local BA, full BA is triggered when the mean "
+              "squared reprojection error of a local BA problem exceeds this "
+              "multiple of the error after the last full BA.");
+DEFINE_double(full_bundle_adjustment_max_growth_percent,
+              25.0,
+              "With covisibility local BA, full BA is always triggered when "
+              "the reconstruction has grown by this percent since the last "
+              "full BA.");
 
 // Triangulation options.
 DEFINE_double(min_triangulation_angle_degrees,
@@ -217,6 +240,17 @@ ReconstructionBuilderOptions SetReconstructionBuilderOptions() {
       FLAGS_full_bundle_adjustment_growth_percent;
   reconstruction_estimator_options.partial_bundle_adjustment_num_views =
       FLAGS_partial_bundle_adjustment_num_views;
+  reconstruction_estimator_options.use_covisibility_local_bundle_adjustment =
+      FLAGS_use_covisibility_local_bundle_adjustment;
+  reconstruction_estimator_options.local_bundle_adjustment_num_seed_views =
+      FLAGS_local_bundle_adjustment_num_seed_views;
+  reconstruction_estimator_options
+      .local_bundle_adjustment_min_num_shared_tracks =
+      FLAGS_local_bundle_adjustment_min_num_shared_tracks;
+  reconstruction_estimator_options.full_bundle_adjustment_max_cost_ratio =
+      FLAGS_full_bundle_adjustment_max_cost_ratio;
+  reconstruction_estimator_options.full_bundle_adjustment_max_growth_percent =
+      FLAGS_full_bundle_adjustment_max_growth_percent;
 
   // Triangulation options.
   reconstruction_estimator_options.min_triangulation_angle_degrees =
@@ -99,6 +99,8 @@ inline ReconstructionEstimatorType StringToReconstructionEstimatorType(
     return ReconstructionEstimatorType::INCREMENTAL;
   } else if (reconstruction_estimator == "HYBRID") {
     return ReconstructionEstimatorType::HYBRID;
+  } else if (reconstruction_estimator == "PARTITIONED") {
+    return ReconstructionEstimatorType::PARTITIONED;
   } else {
     LOG(FATAL)
         << "Invalid reconstruction estimator type. Using GLOBAL instead.";
@@ -1,4 +1,3 @@
-
 // Author: Steffen Urban (urbste@gmail.com)
 
 #include <Eigen/Core>
@@ -7,12 +6,31 @@
 #include <theia/theia.h>
 
 #include <algorithm>
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "print_reconstruction_statistics.h"
 
 DEFINE_string(reconstruction, "", "Reconstruction file");
+DEFINE_int32(num_threads, 1, "Number of threads to use.");
+DEFINE_double(track_sample_fraction,
+              1.0,
+              "Fraction of the tracks, chosen at random, for which the "
+              "covariances are estimated.");
+DEFINE_int32(num_covariance_samples,
+             0,
+             "If positive, the inverse of the reduced camera system is "
+             "estimated from this many random samples instead of being "
+             "computed exactly. The relative error of the variances is about "
+             "sqrt(2 / num_covariance_samples).");
+DEFINE_bool(optimize_views,
+            false,
+            "If true, the views are optimized with the tracks so that the "
+            "covariances include the uncertainty of the views. The first two "
+            "views are held constant to fix the gauge. Otherwise all views "
+            "are held constant.");
 
 int main(int argc, char* argv[]) {
   google::InitGoogleLogging(argv[0]);
@@ -27,20 +45,77 @@ int main(int argc, char* argv[]) {
   std::cout << "\nNum views: " << reconstruction->NumViews()
             << "\nNum 3D points: " << reconstruction->NumTracks() << "\n";
 
+  std::vector<theia::TrackId> track_ids;
+  for (const theia::TrackId track_id : reconstruction->TrackIds()) {
+    if (reconstruction->Track(track_id)->IsEstimated()) {
+      track_ids.emplace_back(track_id);
+    }
+  }
+  const int num_sampled_tracks = std::min<int>(
+      track_ids.size(), FLAGS_track_sample_fraction * track_ids.size());
+  theia::RandomNumberGenerator rng;
+  for (int i = 0; i < num_sampled_tracks; i++) {
+    std::swap(track_ids[i], track_ids[rng.RandInt(i, track_ids.size() - 1)]);
+  }
+  const std::vector<theia::TrackId> sampled_track_ids(
+      track_ids.begin(), track_ids.begin() + num_sampled_tracks);
+
   theia::BundleAdjustmentOptions options;
-  for (int i = 0; i < reconstruction->TrackIds().size(); ++i) {
-    Eigen::Matrix3d cov;
-    double empirical_variance;
-    theia::BundleAdjustmentSummary summary =
-        theia::BundleAdjustTrack(options,
-                                 reconstruction->TrackIds()[i],
-                                 reconstruction.get(),
-                                 &cov,
-                                 &empirical_variance);
-
-    std::cout << "FInal cost: " << summary.final_cost << "\n";
-    std::cout << "standard deviations: "
-              << cov.diagonal().array().sqrt().transpose() * 1000. << " [mm]\n";
+  options.backend = theia::BundleAdjustmentBackend::SCHUR;
+  options.num_threads = FLAGS_num_threads;
+  options.num_covariance_samples = FLAGS_num_covariance_samples;
+  options.use_inner_iterations = false;
+
+  theia::BundleAdjuster bundle_adjuster(options, reconstruction.get());
+  int num_parameters = 0;
+  if (FLAGS_optimize_views) {
+    const std::vector<theia::ViewId> view_ids = reconstruction->ViewIds();
+    int num_constant_views = 0;
+    for (const theia::ViewId view_id : view_ids) {
+      if (!reconstruction->View(view_id)->IsEstimated()) {
+        continue;
+      }
+      bundle_adjuster.AddView(view_id);
+      if (num_constant_views < 2) {
+        bundle_adjuster.SetCameraExtrinsicsConstant(view_id);
+        ++num_constant_views;
+      } else {
+        num_parameters += theia::Camera::kExtrinsicsSize;
+      }
+    }
+  }
+  // Tracks are independent if the views are held constant, so only the
+  // sampled tracks need to be optimized.
+  const std::vector<theia::TrackId>& optimized_track_ids =
+      FLAGS_optimize_views ? track_ids : sampled_track_ids;
+  for (const theia::TrackId track_id : optimized_track_ids) {
+    bundle_adjuster.AddTrack(track_id, true);
+  }
+  num_parameters += 3 * optimized_track_ids.size();
+
+  const theia::BundleAdjustmentSummary summary = bundle_adjuster.Optimize();
+  std::map<theia::TrackId, Eigen::Matrix3d> covariances;
+  CHECK(summary.success) << "Bundle adjustment failed.";
+  CHECK(bundle_adjuster.GetCovarianceForTracks(sampled_track_ids,
+                                               &covariances))
+      << "Covariance estimation failed.";
+
+  // Scale the covariances by the empirical variance factor.
+  const double redundancy = summary.num_residuals - num_parameters;
+  const double empirical_variance_factor =
+      redundancy > 0.0 ? 2.0 * summary.final_cost / redundancy : 1.0;
+  std::cout << "Final cost: " << summary.final_cost
+            << "\nEmpirical variance factor: " << empirical_variance_factor
+            << "\n";
+  // The covariances are in the tangent space of the homogeneous points.
+  for (const auto& covariance : covariances) {
+    std::cout << "Track " << covariance.first << " standard deviations: "
+              << (empirical_variance_factor * covariance.second)
+                     .diagonal()
+                     .array()
+                     .sqrt()
+                     .transpose()
+              << "\n";
   }
   return 0;
 }
@@ -48,6 +48,7 @@
 //#include "theia/image/keypoint_detector/sift_parameters.h"
 #include "theia/io/bundler_file_reader.h"
 #include "theia/io/eigen_serializable.h"
+#include "theia/io/feature_file.h"
 #include "theia/io/import_nvm_file.h"
 #include "theia/io/populate_image_sizes.h"
 #include "theia/io/read_1dsfm.h"
@@ -68,6 +69,7 @@
 #include "theia/matching/brute_force_feature_matcher.h"
 #include "theia/matching/cascade_hasher.h"
 #include "theia/matching/cascade_hashing_feature_matcher.h"
+#include "theia/matching/compact_image_pair_match.h"
 #include "theia/matching/create_feature_matcher.h"
 #include "theia/matching/distance.h"
 #include "theia/matching/feature_correspondence.h"
@@ -99,6 +101,7 @@
 #include "theia/math/matrix/linear_operator.h"
 #include "theia/math/matrix/rq_decomposition.h"
 #include "theia/math/matrix/sparse_cholesky_llt.h"
+#include "theia/math/matrix/sparse_inverse.h"
 #include "theia/math/matrix/sparse_matrix.h"
 #include "theia/math/matrix/spectra_linear_operator.h"
 #include "theia/math/polynomial.h"
@@ -120,6 +123,7 @@
 #include "theia/sfm/bundle_adjustment/optimize_relative_position_with_known_rotation.h"
 #include "theia/sfm/bundle_adjustment/orthogonal_vector_error.h"
 #include "theia/sfm/bundle_adjustment/sampson_error.h"
+#include "theia/sfm/bundle_adjustment/schur_bundle_adjuster.h"
 #include "theia/sfm/bundle_adjustment/position_error.h"
 #include "theia/sfm/bundle_adjustment/gravity_error.h"
 #include "theia/sfm/bundle_adjustment/fundamental_matrix_parameterization.h"
@@ -264,10 +268,13 @@
 #include "theia/util/hash.h"
 #include "theia/util/lru_cache.h"
 #include "theia/util/map_util.h"
+#include "theia/util/mapped_file.h"
+#include "theia/util/memory_usage.h"
 #include "theia/util/mutable_priority_queue.h"
 #include "theia/util/random.h"
 #include "theia/util/string.h"
 #include "theia/util/stringprintf.h"
+#include "theia/util/text_parser.h"
 #include "theia/util/threadpool.h"
 #include "theia/util/timer.h"
 #include "theia/util/util.h"
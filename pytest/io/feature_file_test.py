@@ -0,0 +1,117 @@
+import gc
+import os
+import tempfile
+
+import numpy as np
+import pytest
+import pytheia as pt
+
+NUM_KEYPOINTS = 20
+DESCRIPTOR_DIMENSION = 8
+
+
+def make_features():
+    keypoints = []
+    descriptors = []
+    for i in range(NUM_KEYPOINTS):
+        keypoint = pt.io.Keypoint(float(i), 2.0 * i, pt.io.Keypoint.SIFT)
+        keypoint.strength = 0.5 * i
+        keypoint.scale = 1.0 + i
+        keypoint.orientation = 0.1 * i
+        keypoints.append(keypoint)
+        descriptors.append(
+            np.arange(DESCRIPTOR_DIMENSION, dtype=np.float32) + i)
+    return keypoints, descriptors
+
+
+def write_feature_file(directory, descriptor_type):
+    keypoints, descriptors = make_features()
+    filepath = os.path.join(directory, "features.bin")
+    assert pt.io.WriteFeatureFile(filepath, keypoints, descriptors,
+                                  descriptor_type)
+    return filepath, keypoints, descriptors
+
+
+def test_feature_file_views():
+    with tempfile.TemporaryDirectory() as directory:
+        filepath, keypoints, descriptors = write_feature_file(
+            directory, pt.io.FeatureFileDescriptorType.FLOAT32)
+        feature_file = pt.io.FeatureFile(filepath)
+        assert feature_file.num_keypoints == NUM_KEYPOINTS
+        assert feature_file.descriptor_dimension == DESCRIPTOR_DIMENSION
+
+        x = feature_file.x()
+        assert x.shape == (NUM_KEYPOINTS,)
+        assert not x.flags.writeable
+        assert np.array_equal(x, [k.x for k in keypoints])
+        assert np.array_equal(feature_file.y(), [k.y for k in keypoints])
+        assert np.array_equal(feature_file.strength(),
+                              [k.strength for k in keypoints])
+        assert np.array_equal(feature_file.scale(),
+                              [k.scale for k in keypoints])
+        assert np.array_equal(feature_file.orientation(),
+                              [k.orientation for k in keypoints])
+        assert (feature_file.keypoint_type() == int(pt.io.Keypoint.SIFT)).all()
+
+        float_descriptors = feature_file.float_descriptors()
+        assert float_descriptors.shape == (NUM_KEYPOINTS, DESCRIPTOR_DIMENSION)
+        assert not float_descriptors.flags.writeable
+        assert np.array_equal(float_descriptors, np.vstack(descriptors))
+        with pytest.raises(ValueError):
+            feature_file.quantized_descriptors()
+        del feature_file
+        del x
+        del float_descriptors
+        gc.collect()
+
+
+def test_feature_file_views_keep_the_file_alive():
+    with tempfile.TemporaryDirectory() as directory:
+        filepath, keypoints, descriptors = write_feature_file(
+            directory, pt.io.FeatureFileDescriptorType.FLOAT32)
+        feature_file = pt.io.FeatureFile(filepath)
+        x = feature_file.x()
+        float_descriptors = feature_file.float_descriptors()
+
+        # The arrays hold a reference to the feature file, so the mapping
+        # outlives the Python name of the file object.
+        del feature_file
+        gc.collect()
+        assert np.array_equal(x, [k.x for k in keypoints])
+        assert np.array_equal(float_descriptors, np.vstack(descriptors))
+        del x
+        del float_descriptors
+        gc.collect()
+
+
+def test_quantized_feature_file_views():
+    with tempfile.TemporaryDirectory() as directory:
+        filepath, _, descriptors = write_feature_file(
+            directory, pt.io.FeatureFileDescriptorType.UINT8)
+        feature_file = pt.io.FeatureFile(filepath)
+        quantized_descriptors = feature_file.quantized_descriptors()
+        assert quantized_descriptors.dtype == np.uint8
+        assert quantized_descriptors.shape == \
+            (NUM_KEYPOINTS, DESCRIPTOR_DIMENSION)
+        dequantized = feature_file.quantization_scale * \
+            quantized_descriptors.astype(np.float32) + \
+            feature_file.quantization_offset
+        assert np.allclose(dequantized, np.vstack(descriptors),
+                           atol=feature_file.quantization_scale)
+        with pytest.raises(ValueError):
+            feature_file.float_descriptors()
+        del feature_file
+        del quantized_descriptors
+        gc.collect()
+
+
+def test_feature_file_rejects_missing_file():
+    with pytest.raises(ValueError):
+        pt.io.FeatureFile("/nonexistent/features.bin")
+
+
+if __name__ == "__main__":
+    test_feature_file_views()
+    test_feature_file_views_keep_the_file_alive()
+    test_quantized_feature_file_views()
+    test_feature_file_rejects_missing_file()
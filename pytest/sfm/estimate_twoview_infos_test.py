@@ -0,0 +1,101 @@
+import pytheia as pt
+import numpy as np
+import pytest
+from scipy.spatial.transform import Rotation as R
+
+FOCAL_LENGTH = 800.0
+IMAGE_SIZE = (1000, 800)
+
+
+def make_prior():
+    prior = pt.sfm.CameraIntrinsicsPrior()
+    prior.focal_length.value = [FOCAL_LENGTH]
+    prior.principal_point.value = [IMAGE_SIZE[0] / 2.0, IMAGE_SIZE[1] / 2.0]
+    prior.aspect_ratio.value = [1.0]
+    prior.camera_intrinsics_model_type = "PINHOLE"
+    prior.image_width = IMAGE_SIZE[0]
+    prior.image_height = IMAGE_SIZE[1]
+    return prior
+
+
+def project(rotation, position, points):
+    points_in_camera = (rotation @ (points - position).T).T
+    principal_point = np.array(IMAGE_SIZE) / 2.0
+    return FOCAL_LENGTH * points_in_camera[:, :2] / \
+        points_in_camera[:, 2:] + principal_point
+
+
+def make_view_pair(num_correspondences):
+    rotation_2 = np.random.uniform(-0.1, 0.1, 3)
+    position_2 = np.array([1.0, 0.0, 0.0]) + \
+        np.random.uniform(-0.2, 0.2, 3)
+    position_2 /= np.linalg.norm(position_2)
+    points = np.column_stack([
+        np.random.uniform(-2.0, 2.0, num_correspondences),
+        np.random.uniform(-2.0, 2.0, num_correspondences),
+        np.random.uniform(4.0, 8.0, num_correspondences)])
+    points1 = project(np.eye(3), np.zeros(3), points)
+    points2 = project(R.from_rotvec(rotation_2).as_matrix(), position_2,
+                      points)
+    return rotation_2, position_2, points1, points2
+
+
+def test_estimate_twoview_infos():
+    np.random.seed(42)
+    num_view_pairs = 4
+    num_correspondences = [60, 80, 100, 120]
+
+    rotations, positions, points1, points2 = [], [], [], []
+    for n in num_correspondences:
+        rotation_2, position_2, pts1, pts2 = make_view_pair(n)
+        rotations.append(rotation_2)
+        positions.append(position_2)
+        points1.append(pts1)
+        points2.append(pts2)
+    offsets = np.concatenate([[0], np.cumsum(num_correspondences)]) \
+        .astype(np.int32)
+
+    options = pt.sfm.EstimateTwoViewInfoOptions()
+    options.max_sampson_error_pixels = 1.0
+    priors = [make_prior() for _ in range(num_view_pairs)]
+    successes, focal_lengths, est_rotations, est_positions, counts, \
+        inlier_mask = pt.sfm.EstimateTwoViewInfos(
+            options, priors, priors, np.vstack(points1), np.vstack(points2),
+            offsets, 4)
+
+    assert successes.shape == (num_view_pairs,)
+    assert focal_lengths.shape == (num_view_pairs, 2)
+    assert est_rotations.shape == (num_view_pairs, 3)
+    assert est_positions.shape == (num_view_pairs, 3)
+    assert counts.shape == (num_view_pairs, 3)
+    assert inlier_mask.shape == (offsets[-1],)
+
+    assert successes.all()
+    assert inlier_mask.all()
+    assert np.allclose(focal_lengths, FOCAL_LENGTH)
+    assert np.allclose(est_rotations, np.array(rotations), atol=1e-4)
+    assert np.allclose(est_positions, np.array(positions), atol=1e-4)
+    assert (counts[:, 0] == np.array(num_correspondences)).all()
+
+
+def test_estimate_twoview_infos_rejects_inconsistent_input():
+    options = pt.sfm.EstimateTwoViewInfoOptions()
+    priors = [make_prior()]
+    points = np.zeros((10, 2))
+    with pytest.raises(ValueError):
+        pt.sfm.EstimateTwoViewInfos(
+            options, priors, priors, points, points,
+            np.array([0, 5], dtype=np.int32), 1)
+    with pytest.raises(ValueError):
+        pt.sfm.EstimateTwoViewInfos(
+            options, priors, priors, points, points[:5],
+            np.array([0, 10], dtype=np.int32), 1)
+    with pytest.raises(ValueError):
+        pt.sfm.EstimateTwoViewInfos(
+            options, priors + priors, priors, points, points,
+            np.array([0, 10], dtype=np.int32), 1)
+
+
+if __name__ == "__main__":
+    test_estimate_twoview_infos()
+    test_estimate_twoview_infos_rejects_inconsistent_input()
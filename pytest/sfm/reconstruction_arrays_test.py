@@ -0,0 +1,73 @@
+import pytheia as pt
+import numpy as np
+import pytest
+
+
+def test_reconstruction_arrays_round_trip():
+    recon = pt.sfm.Reconstruction()
+
+    names = ["0", "1", "2"]
+    timestamps = np.arange(3, dtype=np.float64)
+    poses = np.random.uniform(-0.5, 0.5, (3, 6))
+    intrinsics_types = np.zeros(3, dtype=np.int32)
+    intrinsics = np.zeros((3, 10))
+    intrinsics[:, 0] = 500.0
+    intrinsics[:, 1] = 1.0
+    intrinsics[:, 2] = 320.0
+    intrinsics[:, 3] = 240.0
+    view_ids = pt.sfm.AddViewsFromArrays(
+        names, timestamps, poses, intrinsics_types, intrinsics, recon)
+    assert recon.NumViews() == 3
+
+    points = np.random.uniform(-1.0, 1.0, (4, 4))
+    colors = np.full((4, 3), 128, dtype=np.uint8)
+    view_indices = np.array([0, 1, 2, 0, 2, 1, 2, 0, 1], dtype=np.int32)
+    track_indices = np.array([0, 0, 0, 1, 1, 2, 2, 3, 3], dtype=np.int32)
+    features = np.random.uniform(0.0, 640.0, (9, 2))
+    track_ids = pt.sfm.AddTracksFromArrays(
+        view_ids, points, colors, view_indices, track_indices, features, recon)
+    assert recon.NumTracks() == 4
+
+    exported_track_ids, exported_points, exported_colors = \
+        pt.sfm.TracksToArrays(recon)
+    assert (exported_track_ids == track_ids).all()
+    assert np.allclose(exported_points, points)
+    assert (exported_colors == colors).all()
+
+    exported_view_ids, exported_poses, exported_types, exported_intrinsics = \
+        pt.sfm.ViewsToArrays(recon)
+    assert (exported_view_ids == view_ids).all()
+    assert np.allclose(exported_poses, poses)
+    assert (exported_types == intrinsics_types).all()
+    num_parameters = exported_intrinsics.shape[1]
+    assert np.allclose(exported_intrinsics, intrinsics[:, :num_parameters])
+
+    exported_view_indices, exported_track_indices, exported_features = \
+        pt.sfm.ObservationsToArrays(recon)
+    assert (exported_view_indices == view_indices).all()
+    assert (exported_track_indices == track_indices).all()
+    assert np.allclose(exported_features, features)
+
+
+def test_reconstruction_arrays_reject_inconsistent_input():
+    recon = pt.sfm.Reconstruction()
+    with pytest.raises(ValueError):
+        pt.sfm.AddViewsFromArrays(
+            ["0", "1"], np.zeros(1), np.zeros((2, 6)),
+            np.zeros(2, dtype=np.int32), np.zeros((2, 10)), recon)
+    assert recon.NumViews() == 0
+
+    view_ids = pt.sfm.AddViewsFromArrays(
+        ["0"], np.zeros(1), np.zeros((1, 6)),
+        np.zeros(1, dtype=np.int32), np.zeros((1, 10)), recon)
+    with pytest.raises(ValueError):
+        pt.sfm.AddTracksFromArrays(
+            view_ids, np.zeros((1, 4)), np.zeros((1, 3), dtype=np.uint8),
+            np.array([1], dtype=np.int32), np.array([0], dtype=np.int32),
+            np.zeros((1, 2)), recon)
+    assert recon.NumTracks() == 0
+
+
+if __name__ == "__main__":
+    test_reconstruction_arrays_round_trip()
+    test_reconstruction_arrays_reject_inconsistent_input()
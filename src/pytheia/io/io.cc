@@ -42,7 +42,9 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include "theia/image/keypoint_detector/keypoint.h"
 #include "theia/io/bundler_file_reader.h"
+#include "theia/io/feature_file.h"
 #include "theia/io/import_nvm_file.h"
 #include "theia/io/io_wrapper.h"
 #include "theia/io/populate_image_sizes.h"
@@ -98,6 +100,75 @@ void pytheia_io_classes(py::module& m) {
       .def_readwrite("second_entry", &theia::ListImgEntry::second_entry)
       .def_readwrite("focal_length", &theia::ListImgEntry::focal_length);
 
+  py::class_<theia::Keypoint> keypoint(m, "Keypoint");
+  py::enum_<theia::Keypoint::KeypointType>(keypoint, "KeypointType")
+      .value("INVALID", theia::Keypoint::INVALID)
+      .value("OTHER", theia::Keypoint::OTHER)
+      .value("SIFT", theia::Keypoint::SIFT)
+      .value("AKAZE", theia::Keypoint::AKAZE)
+      .export_values();
+  keypoint.def(py::init<>())
+      .def(py::init<double, double, theia::Keypoint::KeypointType>())
+      .def_property("x", &theia::Keypoint::x, &theia::Keypoint::set_x)
+      .def_property("y", &theia::Keypoint::y, &theia::Keypoint::set_y)
+      .def_property("keypoint_type",
+                    &theia::Keypoint::keypoint_type,
+                    &theia::Keypoint::set_keypoint_type)
+      .def_property("strength",
+                    &theia::Keypoint::strength,
+                    &theia::Keypoint::set_strength)
+      .def_property("scale",
+                    &theia::Keypoint::scale,
+                    &theia::Keypoint::set_scale)
+      .def_property("orientation",
+                    &theia::Keypoint::orientation,
+                    &theia::Keypoint::set_orientation);
+
+  py::enum_<theia::FeatureFileDescriptorType>(m, "FeatureFileDescriptorType")
+      .value("FLOAT32", theia::FeatureFileDescriptorType::FLOAT32)
+      .value("UINT8", theia::FeatureFileDescriptorType::UINT8)
+      .export_values();
+
+  // The columns and descriptors are returned as read-only numpy arrays that
+  // point into the memory-mapped file and keep the FeatureFile alive. The file
+  // is opened on construction and cannot be reopened, so the arrays stay valid.
+  py::class_<theia::FeatureFile>(m, "FeatureFile")
+      .def(py::init(&theia::OpenFeatureFileWrapper))
+      .def_property_readonly("num_keypoints",
+                             &theia::FeatureFile::num_keypoints)
+      .def_property_readonly("descriptor_dimension",
+                             &theia::FeatureFile::descriptor_dimension)
+      .def_property_readonly("descriptor_type",
+                             &theia::FeatureFile::descriptor_type)
+      .def_property_readonly("quantization_scale",
+                             &theia::FeatureFile::quantization_scale)
+      .def_property_readonly("quantization_offset",
+                             &theia::FeatureFile::quantization_offset)
+      .def("x",
+           &theia::FeatureFile::x,
+           py::return_value_policy::reference_internal)
+      .def("y",
+           &theia::FeatureFile::y,
+           py::return_value_policy::reference_internal)
+      .def("strength",
+           &theia::FeatureFile::strength,
+           py::return_value_policy::reference_internal)
+      .def("scale",
+           &theia::FeatureFile::scale,
+           py::return_value_policy::reference_internal)
+      .def("orientation",
+           &theia::FeatureFile::orientation,
+           py::return_value_policy::reference_internal)
+      .def("keypoint_type",
+           &theia::FeatureFile::keypoint_type,
+           py::return_value_policy::reference_internal)
+      .def("float_descriptors",
+           &theia::FeatureFileFloatDescriptorsWrapper,
+           py::return_value_policy::reference_internal)
+      .def("quantized_descriptors",
+           &theia::FeatureFileQuantizedDescriptorsWrapper,
+           py::return_value_policy::reference_internal);
+
   m.def("ImportNVMFile", theia::ImportNVMFileWrapper);
   m.def("PopulateImageSizesAndPrincipalPoints",
         theia::PopulateImageSizesAndPrincipalPointsWrapper);
@@ -105,6 +176,7 @@ void pytheia_io_classes(py::module& m) {
   m.def("ReadBundlerFiles", theia::ReadBundlerFilesWrapper);
   m.def("ReadKeypointsAndDescriptors",
         theia::ReadKeypointsAndDescriptorsWrapper);
+  m.def("ReadKeypoints", theia::ReadKeypointsWrapper);
 
   m.def("ReadStrechaDataset", theia::ReadStrechaDatasetWrapper);
   m.def("ReadReconstruction", theia::ReadReconstructionWrapper);
@@ -114,6 +186,12 @@ void pytheia_io_classes(py::module& m) {
   m.def("ReadSiftKeyBinaryFile", theia::ReadSiftKeyBinaryFileWrapper);
   m.def("ReadSiftKeyTextFile", theia::ReadSiftKeyTextFileWrapper);
   m.def("WriteBundlerFiles", theia::WriteBundlerFiles);
+  m.def("WriteFeatureFile",
+        theia::WriteFeatureFile,
+        py::arg("filepath"),
+        py::arg("keypoints"),
+        py::arg("descriptors"),
+        py::arg("descriptor_type") = theia::FeatureFileDescriptorType::FLOAT32);
   m.def("WriteColmapFiles", theia::WriteColmapFiles);
   m.def("WriteKeypointsAndDescriptors", theia::WriteKeypointsAndDescriptors);
   m.def("WriteNVMFile", theia::WriteNVMFile);
@@ -56,9 +56,9 @@
 #include "theia/sfm/feature.h"
 #include "theia/sfm/two_view_match_geometric_verification.h"
 //#include "theia/matching/rocksdb_features_and_matches_database.h"
-//#include "theia/matching/local_features_and_matches_database.h"
 #include "theia/matching/create_feature_matcher.h"
 #include "theia/matching/in_memory_features_and_matches_database.h"
+#include "theia/matching/local_features_and_matches_database.h"
 namespace py = pybind11;
 
 namespace pytheia {
@@ -69,6 +69,9 @@ void pytheia_matching_classes(py::module& m) {
   py::class_<theia::FeaturesAndMatchesDatabase /*, theia::PyFeaturesAndMatchesDatabase */>(m, "FeaturesAndMatchesDatabase")
       //.def(py::init<>())
       //.def("ContainsCameraIntrinsicsPrior", &theia::FeaturesAndMatchesDatabase::ContainsCameraIntrinsicsPrior)
+      .def("MemoryUsage", &theia::FeaturesAndMatchesDatabase::MemoryUsage)
+      .def("SetCacheMemoryBudget",
+           &theia::FeaturesAndMatchesDatabase::SetCacheMemoryBudget)
     ;
 
   // RocksDbFeaturesAndMatchesDatabase
@@ -143,44 +146,75 @@ void pytheia_matching_classes(py::module& m) {
                ContainsCameraIntrinsicsPrior)
 
       ;
+
+  // LocalFeaturesAndMatchesDatabase
+  py::class_<theia::LocalFeaturesAndMatchesDatabase,
+             theia::FeaturesAndMatchesDatabase>(
+      m, "LocalFeaturesAndMatchesDatabase")
+      .def(py::init<std::string, int>())
+      .def("ContainsFeatures",
+           &theia::LocalFeaturesAndMatchesDatabase::ContainsFeatures)
+      .def("GetFeatures", &theia::LocalFeaturesAndMatchesDatabase::GetFeatures)
+      .def("PutFeatures", &theia::LocalFeaturesAndMatchesDatabase::PutFeatures)
+      .def("GetFeaturesForImages",
+           &theia::LocalFeaturesAndMatchesDatabase::GetFeaturesForImages)
+      .def("ImageNamesOfFeatures",
+           &theia::LocalFeaturesAndMatchesDatabase::ImageNamesOfFeatures)
+      .def("NumImages", &theia::LocalFeaturesAndMatchesDatabase::NumImages)
+      .def("GetImagePairMatch",
+           &theia::LocalFeaturesAndMatchesDatabase::GetImagePairMatch)
+      .def("PutImagePairMatch",
+           &theia::LocalFeaturesAndMatchesDatabase::PutImagePairMatch)
+      .def("PutImagePairMatches",
+           &theia::LocalFeaturesAndMatchesDatabase::PutImagePairMatches)
+      .def("NumMatches", &theia::LocalFeaturesAndMatchesDatabase::NumMatches)
+      .def("RemoveAllMatches",
+           &theia::LocalFeaturesAndMatchesDatabase::RemoveAllMatches)
+      .def("PutCameraIntrinsicsPrior",
+           &theia::LocalFeaturesAndMatchesDatabase::PutCameraIntrinsicsPrior)
+      .def("GetCameraIntrinsicsPrior",
+           &theia::LocalFeaturesAndMatchesDatabase::GetCameraIntrinsicsPrior)
+      .def("NumCameraIntrinsicsPrior",
+           &theia::LocalFeaturesAndMatchesDatabase::NumCameraIntrinsicsPrior)
+      .def("ImageNamesOfCameraIntrinsicsPriors",
+           &theia::LocalFeaturesAndMatchesDatabase::
+               ImageNamesOfCameraIntrinsicsPriors)
+      .def("ImageNamesOfMatches",
+           &theia::LocalFeaturesAndMatchesDatabase::ImageNamesOfMatches)
+      .def("ContainsCameraIntrinsicsPrior",
+           &theia::LocalFeaturesAndMatchesDatabase::
+               ContainsCameraIntrinsicsPrior)
+      .def("ReadFromFile",
+           &theia::LocalFeaturesAndMatchesDatabase::ReadFromFile)
+      .def("WriteToFile", &theia::LocalFeaturesAndMatchesDatabase::WriteToFile)
+
+      ;
   py::class_<theia::ImagePairMatch>(m, "ImagePairMatch")
       .def(py::init<>())
       .def_readwrite("image1", &theia::ImagePairMatch::image1)
       .def_readwrite("image2", &theia::ImagePairMatch::image2)
       .def_readwrite("twoview_info", &theia::ImagePairMatch::twoview_info)
       .def_readwrite("correspondences", &theia::ImagePairMatch::correspondences)
+      .def_readwrite("feature_indices", &theia::ImagePairMatch::feature_indices)
 
       ;
 
-  /*
-      //LocalFeaturesAndMatchesDatabase
-
-      py::class_<theia::LocalFeaturesAndMatchesDatabase,
-     theia::FeaturesAndMatchesDatabase>(m, "LocalFeaturesAndMatchesDatabase")
-        .def(py::init<std::string>())
-        .def("ContainsFeatures",
-     &theia::LocalFeaturesAndMatchesDatabase::ContainsFeatures)
-        .def("GetFeatures",
-     &theia::LocalFeaturesAndMatchesDatabase::GetFeatures) .def("PutFeatures",
-     &theia::LocalFeaturesAndMatchesDatabase::PutFeatures)
-        .def("ImageNamesOfFeatures",
-     &theia::LocalFeaturesAndMatchesDatabase::ImageNamesOfFeatures)
-        .def("NumImages", &theia::LocalFeaturesAndMatchesDatabase::NumImages)
-        .def("GetImagePairMatch",
-     &theia::LocalFeaturesAndMatchesDatabase::GetImagePairMatch)
-        .def("PutImagePairMatch",
-     &theia::LocalFeaturesAndMatchesDatabase::PutImagePairMatch)
-        .def("NumMatches", &theia::LocalFeaturesAndMatchesDatabase::NumMatches)
-        .def("SaveMatchesAndGeometry",
-     &theia::LocalFeaturesAndMatchesDatabase::SaveMatchesAndGeometry)
-
-      ;
-
-  */
   // FeatureMatcherOptions
   py::class_<theia::FeatureMatcherOptions>(m, "FeatureMatcherOptions")
       .def(py::init<>())
       .def_readwrite("num_threads", &theia::FeatureMatcherOptions::num_threads)
+      .def_readwrite("num_feature_loading_threads",
+                     &theia::FeatureMatcherOptions::num_feature_loading_threads)
+      .def_readwrite("num_matching_threads",
+                     &theia::FeatureMatcherOptions::num_matching_threads)
+      .def_readwrite("num_verification_threads",
+                     &theia::FeatureMatcherOptions::num_verification_threads)
+      .def_readwrite("feature_prefetch_capacity",
+                     &theia::FeatureMatcherOptions::feature_prefetch_capacity)
+      .def_readwrite("verification_queue_capacity",
+                     &theia::FeatureMatcherOptions::verification_queue_capacity)
+      .def_readwrite("match_write_batch_size",
+                     &theia::FeatureMatcherOptions::match_write_batch_size)
       .def_readwrite("keep_only_symmetric_matches",
                      &theia::FeatureMatcherOptions::keep_only_symmetric_matches)
       .def_readwrite("use_lowes_ratio",
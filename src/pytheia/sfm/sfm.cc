@@ -35,6 +35,7 @@
 #include "pytheia/sfm/sfm.h"
 
 #include <pybind11/eigen.h>
+#include <pybind11/functional.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
@@ -692,6 +693,8 @@ void pytheia_sfm_classes(py::module& m) {
       .value("PROSAC", theia::RansacType::PROSAC)
       .value("LMED", theia::RansacType::LMED)
       .value("EXHAUSTIVE", theia::RansacType::EXHAUSTIVE)
+      .value("NAPSAC", theia::RansacType::NAPSAC)
+      .value("MAGSAC", theia::RansacType::MAGSAC)
       .export_values();
  
    py::enum_<theia::PnPType>(m, "PnPType")
@@ -713,6 +716,8 @@ void pytheia_sfm_classes(py::module& m) {
   m.def("EstimateRadialHomographyMatrix",
         theia::EstimateRadialHomographyMatrixWrapper);
   m.def("EstimateRelativePose", theia::EstimateRelativePoseWrapper);
+  m.def("EstimateRelativePoseAndHomography",
+        theia::EstimateRelativePoseAndHomographyWrapper);
   m.def("EstimateRelativePoseWithKnownOrientation",
         theia::EstimateRelativePoseWithKnownOrientationWrapper);
   m.def("EstimateRigidTransformation2D3D",
@@ -724,6 +729,8 @@ void pytheia_sfm_classes(py::module& m) {
         theia::EstimateUncalibratedAbsolutePoseWrapper);
   m.def("EstimateUncalibratedRelativePose",
         theia::EstimateUncalibratedRelativePoseWrapper);
+  m.def("EstimateUncalibratedRelativePoseAndHomography",
+        theia::EstimateUncalibratedRelativePoseAndHomographyWrapper);
 
   // triangulation
   m.def("Triangulate", theia::TriangulateWrapper);
@@ -786,10 +793,69 @@ void pytheia_sfm_classes(py::module& m) {
                      &theia::LocalizeViewToReconstructionOptions::ba_options)
       .def_readwrite(
           "min_num_inliers",
-          &theia::LocalizeViewToReconstructionOptions::min_num_inliers);
+          &theia::LocalizeViewToReconstructionOptions::min_num_inliers)
+      .def_readwrite(
+          "num_threads",
+          &theia::LocalizeViewToReconstructionOptions::num_threads);
+
+  py::class_<theia::LocalizeViewSummary>(m, "LocalizeViewSummary")
+      .def(py::init<>())
+      .def_readwrite("view_id", &theia::LocalizeViewSummary::view_id)
+      .def_readwrite("success", &theia::LocalizeViewSummary::success)
+      .def_readwrite("num_2d3d_correspondences",
+                     &theia::LocalizeViewSummary::num_2d3d_correspondences)
+      .def_readwrite("ransac_summary",
+                     &theia::LocalizeViewSummary::ransac_summary)
+      .def_readwrite("refinement_summary",
+                     &theia::LocalizeViewSummary::refinement_summary);
 
   m.def("EstimateTwoViewInfo", theia::EstimateTwoViewInfoWrapper);
-  m.def("ColorizeReconstruction", theia::ColorizeReconstruction);
+  m.def("EstimateTwoViewInfos",
+        theia::EstimateTwoViewInfosWrapper,
+        py::call_guard<py::gil_scoped_release>());
+  py::class_<theia::DecodedImage>(m, "DecodedImage")
+      .def(py::init<>())
+      .def_readwrite("width", &theia::DecodedImage::width)
+      .def_readwrite("height", &theia::DecodedImage::height)
+      .def_readwrite("channels", &theia::DecodedImage::channels)
+      // Sets the pixels from a (height, width) or (height, width, channels)
+      // uint8 array, e.g. an RGB image from imageio or OpenCV.
+      .def("SetPixels",
+           [](theia::DecodedImage& image,
+              const py::array_t<uint8_t, py::array::c_style |
+                                             py::array::forcecast>& pixels) {
+             if (pixels.ndim() != 2 && pixels.ndim() != 3) {
+               throw py::value_error("The image must have 2 or 3 dimensions");
+             }
+             image.height = pixels.shape(0);
+             image.width = pixels.shape(1);
+             image.channels = pixels.ndim() == 3 ? pixels.shape(2) : 1;
+             image.pixels.assign(pixels.data(), pixels.data() + pixels.size());
+           });
+
+  py::class_<theia::ColorizeReconstructionOptions>(
+      m, "ColorizeReconstructionOptions")
+      .def(py::init<>())
+      .def_readwrite("num_threads",
+                     &theia::ColorizeReconstructionOptions::num_threads)
+      .def_readwrite(
+          "max_num_images_in_memory",
+          &theia::ColorizeReconstructionOptions::max_num_images_in_memory)
+      .def_readwrite("track_ids",
+                     &theia::ColorizeReconstructionOptions::track_ids)
+      .def_readwrite("image_reader",
+                     &theia::ColorizeReconstructionOptions::image_reader);
+
+  m.def("ColorizeReconstruction",
+        overload_cast_<const std::string&,
+                       const theia::ColorizeReconstructionOptions&,
+                       theia::Reconstruction*>()(
+            &theia::ColorizeReconstruction),
+        py::call_guard<py::gil_scoped_release>());
+  m.def("ColorizeReconstruction",
+        overload_cast_<const std::string&, const int, theia::Reconstruction*>()(
+            &theia::ColorizeReconstruction),
+        py::call_guard<py::gil_scoped_release>());
   m.def("ExtractMaximallyParallelRigidSubgraph",
         theia::ExtractMaximallyParallelRigidSubgraph);
   m.def("FilterViewGraphCyclesByRotation",
@@ -800,6 +866,9 @@ void pytheia_sfm_classes(py::module& m) {
         theia::FilterViewPairsFromRelativeTranslation);
   m.def("LocalizeViewToReconstruction",
         theia::LocalizeViewToReconstruction);
+  m.def("LocalizeViewsToReconstruction",
+        theia::LocalizeViewsToReconstructionWrapper,
+        py::call_guard<py::gil_scoped_release>());
   m.def("SelectGoodTracksForBundleAdjustment",
         theia::SelectGoodTracksForBundleAdjustmentWrapper);
   m.def("SetOutlierTracksToUnestimated",
@@ -821,6 +890,7 @@ void pytheia_sfm_classes(py::module& m) {
       .def(py::init<std::string>())
       .def("Name", &theia::View::Name)
       .def("IsEstimated", &theia::View::IsEstimated)
+      .def("MemoryUsage", &theia::View::MemoryUsage)
       .def("SetIsEstimated", &theia::View::SetEstimated)
       .def("NumFeatures", &theia::View::NumFeatures)
       .def("AddFeature", &theia::View::AddFeature)
@@ -922,6 +992,7 @@ void pytheia_sfm_classes(py::module& m) {
       .def("SetIsEstimated", &theia::Track::SetEstimated)
       .def("IsEstimated", &theia::Track::IsEstimated)
       .def("NumViews", &theia::Track::NumViews)
+      .def("MemoryUsage", &theia::Track::MemoryUsage)
       .def("AddView", &theia::Track::AddView)
       .def("RemoveView", &theia::Track::RemoveView)
       .def("ViewIds", &theia::Track::ViewIds)
@@ -945,7 +1016,8 @@ void pytheia_sfm_classes(py::module& m) {
       .def("BuildTracks", 
            &theia::TrackBuilder::BuildTracks)
       .def("BuildTracksIncremental", 
-           &theia::TrackBuilder::BuildTracksIncremental);
+           &theia::TrackBuilder::BuildTracksIncremental)
+      .def("MemoryUsage", &theia::TrackBuilder::MemoryUsage);
 
   py::class_<theia::BundleAdjustmentOptions>(m, "BundleAdjustmentOptions")
       .def(py::init<>())
@@ -985,7 +1057,13 @@ void pytheia_sfm_classes(py::module& m) {
       .def_readwrite("orthographic_camera",
                      &theia::BundleAdjustmentOptions::orthographic_camera)
       .def_readwrite("use_homogeneous_point_parametrization",
-                     &theia::BundleAdjustmentOptions::use_homogeneous_point_parametrization);
+                     &theia::BundleAdjustmentOptions::use_homogeneous_point_parametrization)
+      .def_readwrite(
+          "max_linear_solver_iterations",
+          &theia::BundleAdjustmentOptions::max_linear_solver_iterations)
+      .def_readwrite("backend", &theia::BundleAdjustmentOptions::backend)
+      .def_readwrite("num_covariance_samples",
+                     &theia::BundleAdjustmentOptions::num_covariance_samples);
 
   // Reconstruction Options
   py::enum_<theia::TriangulationMethodType>(m, "TriangulationMethodType")
@@ -1125,7 +1203,52 @@ void pytheia_sfm_classes(py::module& m) {
                          max_num_features_for_fisher_vector_training)
       .def_readwrite("reconstruction_estimator_options",
                      &theia::ReconstructionBuilderOptions::
-                         reconstruction_estimator_options);
+                         reconstruction_estimator_options)
+      .def_readwrite("online_global_bundle_adjustment_interval",
+                     &theia::ReconstructionBuilderOptions::
+                         online_global_bundle_adjustment_interval)
+      .def_readwrite("track_builder_memory_budget_bytes",
+                     &theia::ReconstructionBuilderOptions::
+                         track_builder_memory_budget_bytes)
+      .def_readwrite("features_and_matches_cache_memory_budget_bytes",
+                     &theia::ReconstructionBuilderOptions::
+                         features_and_matches_cache_memory_budget_bytes);
+
+  py::class_<theia::ReconstructionBuilderMemoryReport>(
+      m, "ReconstructionBuilderMemoryReport")
+      .def(py::init<>())
+      .def_readwrite(
+          "reconstruction_bytes",
+          &theia::ReconstructionBuilderMemoryReport::reconstruction_bytes)
+      .def_readwrite("view_graph_bytes",
+                     &theia::ReconstructionBuilderMemoryReport::view_graph_bytes)
+      .def_readwrite(
+          "track_builder_bytes",
+          &theia::ReconstructionBuilderMemoryReport::track_builder_bytes)
+      .def_readwrite("features_and_matches_database_bytes",
+                     &theia::ReconstructionBuilderMemoryReport::
+                         features_and_matches_database_bytes)
+      .def("TotalBytes", &theia::ReconstructionBuilderMemoryReport::TotalBytes);
+
+  py::class_<theia::ReconstructionBuilderUpdateSummary>(
+      m, "ReconstructionBuilderUpdateSummary")
+      .def(py::init<>())
+      .def_readwrite("success",
+                     &theia::ReconstructionBuilderUpdateSummary::success)
+      .def_readwrite(
+          "estimated_views",
+          &theia::ReconstructionBuilderUpdateSummary::estimated_views)
+      .def_readwrite(
+          "num_triangulated_tracks",
+          &theia::ReconstructionBuilderUpdateSummary::num_triangulated_tracks)
+      .def_readwrite("num_local_bundle_adjustment_views",
+                     &theia::ReconstructionBuilderUpdateSummary::
+                         num_local_bundle_adjustment_views)
+      .def_readwrite(
+          "global_bundle_adjustment",
+          &theia::ReconstructionBuilderUpdateSummary::global_bundle_adjustment)
+      .def_readwrite("total_time",
+                     &theia::ReconstructionBuilderUpdateSummary::total_time);
 
   // Reconstruction Builder
   py::class_<theia::ReconstructionBuilder>(m, "ReconstructionBuilder")
@@ -1158,6 +1281,12 @@ void pytheia_sfm_classes(py::module& m) {
            &theia::ReconstructionBuilder::AddMaskForFeaturesExtraction)
       .def("ExtractAndMatchFeatures",
            &theia::ReconstructionBuilder::ExtractAndMatchFeatures)
+      .def("UpdateReconstruction",
+           &theia::ReconstructionBuilder::UpdateReconstruction)
+      .def("GetReconstruction",
+           &theia::ReconstructionBuilder::GetReconstruction,
+           py::return_value_policy::reference_internal)
+      .def("GetMemoryReport", &theia::ReconstructionBuilder::GetMemoryReport)
 
       ;
 
@@ -1167,6 +1296,7 @@ void pytheia_sfm_classes(py::module& m) {
       .value("GLOBAL", theia::ReconstructionEstimatorType::GLOBAL)
       .value("INCREMENTAL", theia::ReconstructionEstimatorType::INCREMENTAL)
       .value("HYBRID", theia::ReconstructionEstimatorType::HYBRID)
+      .value("PARTITIONED", theia::ReconstructionEstimatorType::PARTITIONED)
       .export_values();
 
   py::enum_<theia::GlobalPositionEstimatorType>(m,
@@ -1270,9 +1400,51 @@ void pytheia_sfm_classes(py::module& m) {
       .def_readwrite("partial_bundle_adjustment_num_views",
                      &theia::ReconstructionEstimatorOptions::
                          partial_bundle_adjustment_num_views)
+      .def_readwrite("use_covisibility_local_bundle_adjustment",
+                     &theia::ReconstructionEstimatorOptions::
+                         use_covisibility_local_bundle_adjustment)
+      .def_readwrite("local_bundle_adjustment_num_seed_views",
+                     &theia::ReconstructionEstimatorOptions::
+                         local_bundle_adjustment_num_seed_views)
+      .def_readwrite("local_bundle_adjustment_min_num_shared_tracks",
+                     &theia::ReconstructionEstimatorOptions::
+                         local_bundle_adjustment_min_num_shared_tracks)
+      .def_readwrite("full_bundle_adjustment_max_cost_ratio",
+                     &theia::ReconstructionEstimatorOptions::
+                         full_bundle_adjustment_max_cost_ratio)
+      .def_readwrite("full_bundle_adjustment_max_growth_percent",
+                     &theia::ReconstructionEstimatorOptions::
+                         full_bundle_adjustment_max_growth_percent)
       .def_readwrite("relative_position_estimation_max_sampson_error_pixels",
                      &theia::ReconstructionEstimatorOptions::
                          relative_position_estimation_max_sampson_error_pixels)
+      .def_readwrite("partition_reconstruction_estimator_type",
+                     &theia::ReconstructionEstimatorOptions::
+                         partition_reconstruction_estimator_type)
+      .def_readwrite("partition_max_num_views",
+                     &theia::ReconstructionEstimatorOptions::
+                         partition_max_num_views)
+      .def_readwrite("partition_overlap_percent",
+                     &theia::ReconstructionEstimatorOptions::
+                         partition_overlap_percent)
+      .def_readwrite("partition_min_num_overlapping_views",
+                     &theia::ReconstructionEstimatorOptions::
+                         partition_min_num_overlapping_views)
+      .def_readwrite("partition_num_parallel_reconstructions",
+                     &theia::ReconstructionEstimatorOptions::
+                         partition_num_parallel_reconstructions)
+      .def_readwrite("partition_directory",
+                     &theia::ReconstructionEstimatorOptions::
+                         partition_directory)
+      .def_readwrite("partition_keep_in_memory",
+                     &theia::ReconstructionEstimatorOptions::
+                         partition_keep_in_memory)
+      .def_readwrite("partition_min_num_common_views",
+                     &theia::ReconstructionEstimatorOptions::
+                         partition_min_num_common_views)
+      .def_readwrite("partition_alignment_max_relative_position_error",
+                     &theia::ReconstructionEstimatorOptions::
+                         partition_alignment_max_relative_position_error)
       .def_readwrite("min_triangulation_angle_degrees",
                      &theia::ReconstructionEstimatorOptions::
                          min_triangulation_angle_degrees)
@@ -1308,12 +1480,16 @@ void pytheia_sfm_classes(py::module& m) {
                          track_selection_image_grid_cell_size_pixels)
       .def_readwrite("min_num_optimized_tracks_per_view",
                      &theia::ReconstructionEstimatorOptions::
-                         min_num_optimized_tracks_per_view);
+                         min_num_optimized_tracks_per_view)
+      .def_readwrite("bundle_adjustment_memory_budget_bytes",
+                     &theia::ReconstructionEstimatorOptions::
+                         bundle_adjustment_memory_budget_bytes);
 
   // Reconstruction class
   py::class_<theia::Reconstruction>(m, "Reconstruction")
       .def(py::init<>())
       .def("NumViews", &theia::Reconstruction::NumViews)
+      .def("MemoryUsage", &theia::Reconstruction::MemoryUsage)
       .def("ViewIdFromName", &theia::Reconstruction::ViewIdFromName)
       .def("AddView",
            (theia::ViewId(theia::Reconstruction::*)(const std::string&,
@@ -1379,8 +1555,29 @@ void pytheia_sfm_classes(py::module& m) {
       //&theia::Reconstruction::GetSubReconstructionWrapper)
       ;
 
-  m.def("SetUnderconstrainedTracksToUnestimated", theia::SetUnderconstrainedTracksToUnestimated);
-  m.def("SetUnderconstrainedViewsToUnestimated", theia::SetUnderconstrainedViewsToUnestimated);
+  m.def("SetUnderconstrainedTracksToUnestimated",
+        overload_cast_<theia::Reconstruction*>()(
+            &theia::SetUnderconstrainedTracksToUnestimated));
+  m.def("SetUnderconstrainedViewsToUnestimated",
+        overload_cast_<theia::Reconstruction*>()(
+            &theia::SetUnderconstrainedViewsToUnestimated));
+
+  // Bulk conversions between a Reconstruction and numpy arrays
+  m.def("TracksToArrays",
+        theia::TracksToArraysWrapper,
+        py::call_guard<py::gil_scoped_release>());
+  m.def("ViewsToArrays",
+        theia::ViewsToArraysWrapper,
+        py::call_guard<py::gil_scoped_release>());
+  m.def("ObservationsToArrays",
+        theia::ObservationsToArraysWrapper,
+        py::call_guard<py::gil_scoped_release>());
+  m.def("AddViewsFromArrays",
+        theia::AddViewsFromArraysWrapper,
+        py::call_guard<py::gil_scoped_release>());
+  m.def("AddTracksFromArrays",
+        theia::AddTracksFromArraysWrapper,
+        py::call_guard<py::gil_scoped_release>());
 
   // Reconstruction Estimator
 
@@ -1412,6 +1609,7 @@ void pytheia_sfm_classes(py::module& m) {
       .def("RemoveEdge", &theia::ViewGraph::RemoveEdge)
       .def("NumViews", &theia::ViewGraph::NumViews)
       .def("NumEdges", &theia::ViewGraph::NumEdges)
+      .def("MemoryUsage", &theia::ViewGraph::MemoryUsage)
       .def("GetNeighborIdsForView",
            &theia::ViewGraph::GetNeighborIdsForView,
            py::return_value_policy::reference)
@@ -1449,6 +1647,11 @@ void pytheia_sfm_classes(py::module& m) {
       .value("ALL", theia::OptimizeIntrinsicsType::ALL)
       .export_values();
 
+  py::enum_<theia::BundleAdjustmentBackend>(m, "BundleAdjustmentBackend")
+      .value("CERES", theia::BundleAdjustmentBackend::CERES)
+      .value("SCHUR", theia::BundleAdjustmentBackend::SCHUR)
+      .export_values();
+
   py::enum_<theia::LossFunctionType>(m, "LossFunctionType")
       .value("TRIVIAL", theia::LossFunctionType::TRIVIAL)
       .value("HUBER", theia::LossFunctionType::HUBER)
@@ -1477,6 +1680,8 @@ void pytheia_sfm_classes(py::module& m) {
       .def_readwrite("initial_cost",
                      &theia::BundleAdjustmentSummary::initial_cost)
       .def_readwrite("final_cost", &theia::BundleAdjustmentSummary::final_cost)
+      .def_readwrite("num_residuals",
+                     &theia::BundleAdjustmentSummary::num_residuals)
       .def_readwrite("setup_time_in_seconds",
                      &theia::BundleAdjustmentSummary::setup_time_in_seconds)
       .def_readwrite("solve_time_in_seconds",
@@ -1485,6 +1690,8 @@ void pytheia_sfm_classes(py::module& m) {
   m.def("BundleAdjustPartialReconstruction", theia::BundleAdjustPartialReconstructionWrapper);
   m.def("BundleAdjustPartialViewsConstant", theia::BundleAdjustPartialViewsConstantWrapper);
   m.def("BundleAdjustReconstruction", theia::BundleAdjustReconstructionWrapper);
+  m.def("EstimateBundleAdjustmentMemoryUsage",
+        theia::EstimateBundleAdjustmentMemoryUsage);
   m.def("BundleAdjustView", theia::BundleAdjustViewWrapper);
   m.def("BundleAdjustViews", theia::BundleAdjustViewsWrapper);
   m.def("BundleAdjustViewWithCov", theia::BundleAdjustViewWithCovWrapper);
@@ -1508,6 +1715,7 @@ void pytheia_sfm_classes(py::module& m) {
       .def("AddView", &theia::BundleAdjuster::AddView)
       .def("AddTrack", &theia::BundleAdjuster::AddTrack)
       .def("Optimize", &theia::BundleAdjuster::Optimize)
+      .def("MemoryUsage", &theia::BundleAdjuster::MemoryUsage)
       //.def("SetCameraExtrinsicsParameterization",
       //&theia::BundleAdjuster::SetCameraExtrinsicsParameterization)
       //.def("SetCameraIntrinsicsParameterization",
@@ -1579,7 +1787,9 @@ void pytheia_sfm_classes(py::module& m) {
     .def_readwrite("max_num_reweighted_iterations", 
           &theia::LeastUnsquaredDeviationPositionEstimator::Options::max_num_reweighted_iterations)
     .def_readwrite("convergence_criterion", 
-          &theia::LeastUnsquaredDeviationPositionEstimator::Options::convergence_criterion);
+          &theia::LeastUnsquaredDeviationPositionEstimator::Options::convergence_criterion)
+    .def_readwrite("num_threads", 
+          &theia::LeastUnsquaredDeviationPositionEstimator::Options::num_threads);
           
   py::class_<theia::LeastUnsquaredDeviationPositionEstimator,
              theia::PositionEstimator>(
@@ -1620,7 +1830,9 @@ void pytheia_sfm_classes(py::module& m) {
       .def_readwrite("irls_step_convergence_threshold", 
           &theia::RobustRotationEstimator::Options::irls_step_convergence_threshold)
       .def_readwrite("irls_loss_parameter_sigma", 
-          &theia::RobustRotationEstimator::Options::irls_loss_parameter_sigma);
+          &theia::RobustRotationEstimator::Options::irls_loss_parameter_sigma)
+      .def_readwrite("num_threads", 
+          &theia::RobustRotationEstimator::Options::num_threads);
 
   // Global Rotation Estimators
   py::class_<theia::RobustRotationEstimator, theia::RotationEstimator>(
@@ -98,6 +98,7 @@ void pytheia_solvers_classes(py::module& m) {
       .def_readwrite("min_iterations", &theia::RansacParameters::min_iterations)
       .def_readwrite("max_iterations", &theia::RansacParameters::max_iterations)
       .def_readwrite("use_mle", &theia::RansacParameters::use_mle)
+      .def_readwrite("use_magsac", &theia::RansacParameters::use_magsac)
       .def_readwrite("use_lo", &theia::RansacParameters::use_lo)
       .def_readwrite("lo_start_iterations", &theia::RansacParameters::lo_start_iterations)
       .def_readwrite("use_Tdd_test", &theia::RansacParameters::use_Tdd_test);
@@ -44,13 +44,17 @@
 #include <vector>
 
 #include "theia/util/map_util.h"
+#include "theia/util/threadpool.h"
 
 namespace py = pybind11;
 
 namespace pytheia {
 namespace util {
 
-void pytheia_util_classes(py::module& m) {}
+void pytheia_util_classes(py::module& m) {
+  m.def("SetThreadBudget", theia::SetThreadBudget);
+  m.def("GetThreadBudget", theia::GetThreadBudget);
+}
 
 void pytheia_util(py::module& m) {
   py::module m_submodule = m.def_submodule("util");
@@ -34,33 +34,30 @@
 
 #include "theia/io/bundler_file_reader.h"
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string>
-#include <vector>
-
 #include <Eigen/Core>
 #include <glog/logging.h>
 
+#include <string>
+#include <vector>
+
 #include "theia/sfm/reconstruction.h"
+#include "theia/util/mapped_file.h"
+#include "theia/util/text_parser.h"
+#include "theia/util/threadpool.h"
 
 namespace theia {
 namespace {
-bool ReadHeader(FILE* in, int* num_cameras, int* num_points) {
+bool ReadHeader(TextParser* in, int* num_cameras, int* num_points) {
   // Read the comment.
-  char* line = nullptr;
-  size_t length = 0;
-  if ((getline(&line, &length, in) == -1) || line[0] != '#') {
-    free(line);
+  std::string line;
+  if (!in->ReadLine(&line) || line.empty() || line[0] != '#') {
     return false;
   }
   VLOG(3) << "Comment: " << line;
-  free(line);
   // Read number of points and cameras.
-  if (fscanf(
-          in, "%d %d", CHECK_NOTNULL(num_cameras), CHECK_NOTNULL(num_points)) !=
-          2 ||
-      *num_cameras < 1 || *num_points < 1) {
+  if (!in->ReadInt(CHECK_NOTNULL(num_cameras)) ||
+      !in->ReadInt(CHECK_NOTNULL(num_points)) || *num_cameras < 1 ||
+      *num_points < 1) {
     return false;
   }
   VLOG(3) << "Num cameras to read: " << *num_cameras;
@@ -68,49 +65,28 @@ bool ReadHeader(FILE* in, int* num_cameras, int* num_points) {
   return true;
 }
 
-bool ReadCamera(FILE* in, BundlerCamera* camera) {
+bool ReadCamera(TextParser* in, BundlerCamera* camera) {
   // Read focal length and radial distortion coeffs.
-  if (fscanf(in,
-             "%f %f %f",
-             &camera->focal_length,
-             &camera->radial_coeff_1,
-             &camera->radial_coeff_2) != 3) {
+  if (!in->ReadFloat(&camera->focal_length) ||
+      !in->ReadFloat(&camera->radial_coeff_1) ||
+      !in->ReadFloat(&camera->radial_coeff_2)) {
     VLOG(3) << "Unable to read focal length and radial distortion coeffs.";
     return false;
   }
   // Read rotation matrix.
   Eigen::Matrix3d& rotation = camera->rotation;
-  if (fscanf(in,
-             "%lf %lf %lf",
-             &rotation(0, 0),
-             &rotation(0, 1),
-             &rotation(0, 2)) != 3) {
-    VLOG(3) << "Unable to read first row of rotation matrix.";
-    return false;
-  }
-  if (fscanf(in,
-             "%lf %lf %lf",
-             &rotation(1, 0),
-             &rotation(1, 1),
-             &rotation(1, 2)) != 3) {
-    VLOG(3) << "Unable to read second row of rotation matrix.";
-    return false;
-  }
-  if (fscanf(in,
-             "%lf %lf %lf",
-             &rotation(2, 0),
-             &rotation(2, 1),
-             &rotation(2, 2)) != 3) {
-    VLOG(3) << "Unable to read third row of rotation matrix.";
-    return false;
+  for (int row = 0; row < 3; row++) {
+    if (!in->ReadDouble(&rotation(row, 0)) ||
+        !in->ReadDouble(&rotation(row, 1)) ||
+        !in->ReadDouble(&rotation(row, 2))) {
+      VLOG(3) << "Unable to read row " << row << " of rotation matrix.";
+      return false;
+    }
   }
   // Read position.
   Eigen::Vector3d& translation = camera->translation;
-  if (fscanf(in,
-             "%lf %lf %lf",
-             &translation(0),
-             &translation(1),
-             &translation(2)) != 3) {
+  if (!in->ReadDouble(&translation(0)) || !in->ReadDouble(&translation(1)) ||
+      !in->ReadDouble(&translation(2))) {
     VLOG(3) << "Unable to read camera translation.";
     return false;
   }
@@ -118,7 +94,7 @@ bool ReadCamera(FILE* in, BundlerCamera* camera) {
 }
 
 bool ReadCameras(const int num_cameras,
-                 FILE* in,
+                 TextParser* in,
                  std::vector<BundlerCamera>* cameras) {
   CHECK_NOTNULL(cameras)->reserve(num_cameras);
   for (int i = 0; i < num_cameras; ++i) {
@@ -142,51 +118,40 @@ bool ReadCameras(const int num_cameras,
   return true;
 }
 
-bool ReadViewList(FILE* in, std::vector<FeatureInfo>* view_list) {
+bool ReadViewList(TextParser* in, std::vector<FeatureInfo>* view_list) {
   // Read number of views.
   int num_views = 0;
-  if (fscanf(in, "%d", &num_views) != 1) {
+  if (!in->ReadInt(&num_views) || num_views < 0) {
     VLOG(3) << "Unable to read number of views for point.";
+    return false;
   }
-  VLOG(3) << "Num. views to read: " << num_views;
   view_list->resize(num_views);
-  float entry = 0;
+  double keypoint_x, keypoint_y;
   for (int i = 0; i < view_list->size(); ++i) {
-    // Camera index.
-    if (fscanf(in, "%f", &entry) != 1) {
+    FeatureInfo& feature_info = (*view_list)[i];
+    if (!in->ReadInt(&feature_info.camera_index) ||
+        !in->ReadInt(&feature_info.sift_index) ||
+        !in->ReadDouble(&keypoint_x) || !in->ReadDouble(&keypoint_y)) {
       return false;
     }
-    (*view_list)[i].camera_index = static_cast<int>(entry);
-    // Sift index.
-    if (fscanf(in, "%f", &entry) != 1) {
-      return false;
-    }
-    (*view_list)[i].sift_index = static_cast<int>(entry);
-    // Kpt x.
-    if (fscanf(in, "%f", &entry) != 1) {
-      return false;
-    }
-    (*view_list)[i].kpt_x = static_cast<int>(entry);
-    // Kpt y.
-    if (fscanf(in, "%f", &entry) != 1) {
-      return false;
-    }
-    (*view_list)[i].kpt_y = static_cast<int>(entry);
+    feature_info.kpt_x = static_cast<int>(keypoint_x);
+    feature_info.kpt_y = static_cast<int>(keypoint_y);
   }
   return true;
 }
 
-bool ReadPoint(FILE* in, BundlerPoint* point) {
+bool ReadPoint(TextParser* in, BundlerPoint* point) {
   // Read position.
   Eigen::Vector3d& position = point->position;
-  if (fscanf(in, "%lf %lf %lf", &position(0), &position(1), &position(2)) !=
-      3) {
+  if (!in->ReadDouble(&position(0)) || !in->ReadDouble(&position(1)) ||
+      !in->ReadDouble(&position(2))) {
     VLOG(3) << "Unable to read point position. ";
     return false;
   }
   // Read color.
   Eigen::Vector3d& color = point->color;
-  if (fscanf(in, "%lf %lf %lf", &color(0), &color(1), &color(2)) != 3) {
+  if (!in->ReadDouble(&color(0)) || !in->ReadDouble(&color(1)) ||
+      !in->ReadDouble(&color(2))) {
     VLOG(3) << "Unable to read point color.";
     return false;
   }
@@ -198,13 +163,39 @@ bool ReadPoint(FILE* in, BundlerPoint* point) {
   return true;
 }
 
+// Each point takes three lines in the files written by Bundler, so the lines
+// are indexed first and the points are then parsed in parallel. Files that do
+// not follow this layout are parsed sequentially.
 bool ReadPoints(const int num_points,
-                FILE* in,
+                const int num_threads,
+                TextParser* in,
                 std::vector<BundlerPoint>* points) {
-  CHECK_NOTNULL(points)->reserve(num_points);
+  CHECK_NOTNULL(points)->resize(num_points);
+
+  static const int kNumLinesPerPoint = 3;
+  std::vector<const char*> line_starts;
+  FindNonEmptyLineStarts(in->position(), in->end(), &line_starts);
+  if (line_starts.size() != kNumLinesPerPoint * num_points + 1) {
+    VLOG(3) << "The points are not written one entry per line. Parsing them "
+               "sequentially.";
+    for (int i = 0; i < num_points; ++i) {
+      if (!ReadPoint(in, &(*points)[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::vector<char> point_is_valid(num_points, false);
+  ParallelFor(num_threads, num_points, [&](const int i) {
+    TextParser point_parser(line_starts[kNumLinesPerPoint * i],
+                            line_starts[kNumLinesPerPoint * (i + 1)]);
+    point_is_valid[i] =
+        ReadPoint(&point_parser, &(*points)[i]) && point_parser.AtEnd();
+  });
   for (int i = 0; i < num_points; ++i) {
-    points->emplace_back();
-    if (!ReadPoint(in, &points->back())) {
+    if (!point_is_valid[i]) {
+      VLOG(3) << "Unable to read point " << i;
       return false;
     }
   }
@@ -251,33 +242,29 @@ bool ReadPoints(const int num_points,
 // the image, and (w/2, h/2) is the top-right corner (where w and h are the
 // width and height of the image).
 bool BundlerFileReader::ParseBundleFile() {
-  FILE* in = fopen(bundler_filepath_.c_str(), "r");
-  if (in == nullptr) {
+  MappedFile file;
+  if (!file.Open(bundler_filepath_)) {
     LOG(INFO) << "Could not open: " << bundler_filepath_;
     return false;
   }
+  TextParser in(file.begin(), file.end());
   // Read Header.
   int num_cameras;
   int num_points;
-  if (!ReadHeader(in, &num_cameras, &num_points)) {
-    fclose(in);
+  if (!ReadHeader(&in, &num_cameras, &num_points)) {
     VLOG(3) << "Unable to read header.";
     return false;
   }
   // Read Cameras.
-  if (!ReadCameras(num_cameras, in, &cameras_)) {
-    fclose(in);
+  if (!ReadCameras(num_cameras, &in, &cameras_)) {
     VLOG(3) << "Unable to read cameras.";
     return false;
   }
   // Read Points.
-  if (!ReadPoints(num_points, in, &points_)) {
-    fclose(in);
+  if (!ReadPoints(num_points, num_threads_, &in, &points_)) {
     VLOG(3) << "Unable to read points.";
     return false;
   }
-  // Close the file.
-  fclose(in);
   bundler_file_parsed_ = true;
   return true;
 }
@@ -304,29 +291,35 @@ bool BundlerFileReader::ParseBundleFile() {
 // NOTE: We set the exif focal length to zero if it is not available (since 0 is
 // never a valid focal length).
 bool BundlerFileReader::ParseListsFile() {
-  FILE* in = fopen(lists_filepath_.c_str(), "r");
-  if (in == nullptr) {
-    LOG(INFO) << "Could not open: " << bundler_filepath_;
+  MappedFile file;
+  if (!file.Open(lists_filepath_)) {
+    LOG(INFO) << "Could not open: " << lists_filepath_;
     return false;
   }
   // Read line by line
-  char* line = nullptr;
-  size_t length = 0;
   img_entries_.reserve(1024);
-  char filename[1024];
-  while (getline(&line, &length, in) != -1) {
+  const char* line_begin = file.begin();
+  while (line_begin != file.end()) {
+    const char* line_end = TextParser::FindLineEnd(line_begin, file.end());
+    TextParser line(line_begin, line_end);
+    line_begin = line_end == file.end() ? line_end : line_end + 1;
+    if (line.AtEnd()) {
+      continue;
+    }
+
     img_entries_.emplace_back();
     ListImgEntry& entry = img_entries_.back();
-    const int read_items = sscanf(
-        line, "%s %f %f", filename, &entry.second_entry, &entry.focal_length);
-    if (read_items != 1 && read_items != 3) {
-      VLOG(3) << "Invalid line: " << line;
+    entry.second_entry = 0;
+    entry.focal_length = 0;
+    // The line is not empty, so it starts with the filename.
+    line.ReadToken(&entry.filename);
+    if (!line.AtEnd() && (!line.ReadFloat(&entry.second_entry) ||
+                          !line.ReadFloat(&entry.focal_length) ||
+                          !line.AtEnd())) {
+      VLOG(3) << "Invalid line for image: " << entry.filename;
       return false;
     }
-    entry.filename = filename;
   }
-  free(line);
-  fclose(in);
   lists_file_parsed_ = true;
   return true;
 }
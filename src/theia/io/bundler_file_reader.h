@@ -98,8 +98,16 @@ class BundlerFileReader {
   //   bundler_filepath  The filepath of the bundler output file.
   BundlerFileReader(const std::string& lists_filepath,
                     const std::string& bundler_filepath)
+      : BundlerFileReader(lists_filepath, bundler_filepath, 1) {}
+
+  // Same as above, but the points of the bundler file are parsed with the given
+  // number of threads.
+  BundlerFileReader(const std::string& lists_filepath,
+                    const std::string& bundler_filepath,
+                    const int num_threads)
       : lists_filepath_(lists_filepath),
         bundler_filepath_(bundler_filepath),
+        num_threads_(num_threads),
         bundler_file_parsed_(false),
         lists_file_parsed_(false) {}
   virtual ~BundlerFileReader() {}
@@ -137,6 +145,8 @@ class BundlerFileReader {
   const std::string lists_filepath_;
   // Bundler filepath.
   const std::string bundler_filepath_;
+  // Number of threads used to parse the points.
+  const int num_threads_;
   // Bundler cameras.
   std::vector<BundlerCamera> cameras_;
   // Bundler points.
@@ -0,0 +1,365 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/io/feature_file.h"
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "theia/image/keypoint_detector/keypoint.h"
+
+namespace theia {
+
+namespace {
+
+const char kFeatureFileMagic[8] = {'T', 'H', 'E', 'I', 'A', 'F', 'T', 'R'};
+const uint32_t kFeatureFileVersion = 1;
+const uint32_t kByteOrderMark = 0x01020304;
+
+// The number of double columns that precede the keypoint type column.
+const int kNumDoubleColumns = 5;
+
+// The descriptor block is aligned so that it may be used with aligned loads.
+const uint64_t kDescriptorAlignment = 64;
+
+uint64_t DescriptorOffset(const uint64_t num_keypoints) {
+  const uint64_t columns_end = sizeof(FeatureFileHeader) +
+                               num_keypoints * (kNumDoubleColumns *
+                                                    sizeof(double) +
+                                                sizeof(int32_t));
+  return (columns_end + kDescriptorAlignment - 1) / kDescriptorAlignment *
+         kDescriptorAlignment;
+}
+
+uint64_t DescriptorEntrySize(const FeatureFileDescriptorType type) {
+  return type == FeatureFileDescriptorType::UINT8 ? sizeof(uint8_t)
+                                                  : sizeof(float);
+}
+
+template <typename T>
+void WriteColumn(const std::vector<T>& column, std::ofstream* writer) {
+  writer->write(reinterpret_cast<const char*>(column.data()),
+                column.size() * sizeof(T));
+}
+
+}  // namespace
+
+bool WriteFeatureFile(const std::string& filepath,
+                      const std::vector<Keypoint>& keypoints,
+                      const std::vector<Eigen::VectorXf>& descriptors,
+                      const FeatureFileDescriptorType descriptor_type) {
+  const int descriptor_dimension =
+      descriptors.empty() ? 0 : descriptors[0].size();
+  for (const Eigen::VectorXf& descriptor : descriptors) {
+    if (descriptor.size() != descriptor_dimension) {
+      LOG(ERROR) << "All descriptors of a feature file must have the same "
+                    "dimension.";
+      return false;
+    }
+  }
+  if (!descriptors.empty() && descriptors.size() != keypoints.size()) {
+    LOG(ERROR) << "The number of descriptors (" << descriptors.size()
+               << ") does not match the number of keypoints ("
+               << keypoints.size() << ").";
+    return false;
+  }
+
+  std::ofstream writer(filepath, std::ios::out | std::ios::binary);
+  if (!writer.is_open()) {
+    LOG(ERROR) << "Could not open the feature file: " << filepath
+               << " for writing.";
+    return false;
+  }
+
+  const uint64_t num_keypoints = keypoints.size();
+  FeatureFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kFeatureFileMagic, sizeof(header.magic));
+  header.version = kFeatureFileVersion;
+  header.byte_order_mark = kByteOrderMark;
+  header.num_keypoints = num_keypoints;
+  header.descriptor_dimension = descriptor_dimension;
+  header.descriptor_type = static_cast<uint32_t>(descriptor_type);
+  header.quantization_scale = 1.0f;
+  header.quantization_offset = 0.0f;
+  header.descriptor_offset = DescriptorOffset(num_keypoints);
+
+  // A single affine mapping over all descriptor entries.
+  if (descriptor_type == FeatureFileDescriptorType::UINT8 &&
+      !descriptors.empty() && descriptor_dimension > 0) {
+    float min_value = descriptors[0](0);
+    float max_value = descriptors[0](0);
+    for (const Eigen::VectorXf& descriptor : descriptors) {
+      min_value = std::min(min_value, descriptor.minCoeff());
+      max_value = std::max(max_value, descriptor.maxCoeff());
+    }
+    header.quantization_offset = min_value;
+    header.quantization_scale = (max_value - min_value) / 255.0f;
+  }
+  writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  // Write the keypoint attributes one column at a time.
+  std::vector<double> column(num_keypoints);
+  const auto write_double_column = [&](double (Keypoint::*accessor)() const) {
+    for (int i = 0; i < num_keypoints; i++) {
+      column[i] = (keypoints[i].*accessor)();
+    }
+    WriteColumn(column, &writer);
+  };
+  write_double_column(&Keypoint::x);
+  write_double_column(&Keypoint::y);
+  write_double_column(&Keypoint::strength);
+  write_double_column(&Keypoint::scale);
+  write_double_column(&Keypoint::orientation);
+
+  std::vector<int32_t> types(num_keypoints);
+  for (int i = 0; i < num_keypoints; i++) {
+    types[i] = static_cast<int32_t>(keypoints[i].keypoint_type());
+  }
+  WriteColumn(types, &writer);
+
+  const std::vector<char> padding(
+      header.descriptor_offset - static_cast<uint64_t>(writer.tellp()), 0);
+  WriteColumn(padding, &writer);
+
+  // Write the descriptors row by row.
+  if (descriptor_type == FeatureFileDescriptorType::UINT8) {
+    const float inverse_scale = header.quantization_scale > 0.0f
+                                    ? 1.0f / header.quantization_scale
+                                    : 0.0f;
+    std::vector<uint8_t> quantized(descriptor_dimension);
+    for (const Eigen::VectorXf& descriptor : descriptors) {
+      for (int i = 0; i < descriptor_dimension; i++) {
+        const float value = std::round(
+            (descriptor(i) - header.quantization_offset) * inverse_scale);
+        quantized[i] =
+            static_cast<uint8_t>(std::min(std::max(value, 0.0f), 255.0f));
+      }
+      WriteColumn(quantized, &writer);
+    }
+  } else {
+    for (const Eigen::VectorXf& descriptor : descriptors) {
+      writer.write(reinterpret_cast<const char*>(descriptor.data()),
+                   descriptor_dimension * sizeof(float));
+    }
+  }
+
+  if (!writer.good()) {
+    LOG(ERROR) << "Could not write the feature file: " << filepath;
+    return false;
+  }
+  return true;
+}
+
+bool IsFeatureFile(const std::string& filepath) {
+  std::ifstream reader(filepath, std::ios::in | std::ios::binary);
+  char magic[sizeof(kFeatureFileMagic)];
+  if (!reader.read(magic, sizeof(magic))) {
+    return false;
+  }
+  return std::memcmp(magic, kFeatureFileMagic, sizeof(magic)) == 0;
+}
+
+FeatureFile::FeatureFile() { std::memset(&header_, 0, sizeof(header_)); }
+
+bool FeatureFile::Open(const std::string& filepath) {
+  std::memset(&header_, 0, sizeof(header_));
+  if (!file_.Open(filepath)) {
+    LOG(ERROR) << "Could not open the feature file: " << filepath
+               << " for reading.";
+    return false;
+  }
+
+  if (file_.size() < sizeof(header_)) {
+    LOG(ERROR) << filepath << " is not a feature file.";
+    file_.Close();
+    return false;
+  }
+  FeatureFileHeader header;
+  std::memcpy(&header, file_.begin(), sizeof(header));
+  if (std::memcmp(header.magic, kFeatureFileMagic, sizeof(header.magic)) !=
+      0) {
+    LOG(ERROR) << filepath << " is not a feature file.";
+    file_.Close();
+    return false;
+  }
+  if (header.byte_order_mark != kByteOrderMark ||
+      header.version != kFeatureFileVersion) {
+    LOG(ERROR) << "The feature file " << filepath
+               << " was written with an unsupported version or byte order.";
+    file_.Close();
+    return false;
+  }
+
+  const FeatureFileDescriptorType type =
+      static_cast<FeatureFileDescriptorType>(header.descriptor_type);
+  if (type != FeatureFileDescriptorType::FLOAT32 &&
+      type != FeatureFileDescriptorType::UINT8) {
+    LOG(ERROR) << "Unknown descriptor type in feature file " << filepath;
+    file_.Close();
+    return false;
+  }
+
+  const uint64_t expected_size =
+      DescriptorOffset(header.num_keypoints) +
+      header.num_keypoints * header.descriptor_dimension *
+          DescriptorEntrySize(type);
+  if (header.descriptor_offset != DescriptorOffset(header.num_keypoints) ||
+      file_.size() < expected_size) {
+    LOG(ERROR) << "The feature file " << filepath << " is truncated.";
+    file_.Close();
+    return false;
+  }
+
+  header_ = header;
+  return true;
+}
+
+int FeatureFile::num_keypoints() const { return header_.num_keypoints; }
+
+int FeatureFile::descriptor_dimension() const {
+  return header_.descriptor_dimension;
+}
+
+FeatureFileDescriptorType FeatureFile::descriptor_type() const {
+  return static_cast<FeatureFileDescriptorType>(header_.descriptor_type);
+}
+
+float FeatureFile::quantization_scale() const {
+  return header_.quantization_scale;
+}
+
+float FeatureFile::quantization_offset() const {
+  return header_.quantization_offset;
+}
+
+const double* FeatureFile::DoubleColumn(const int column) const {
+  return reinterpret_cast<const double*>(file_.begin() + sizeof(header_)) +
+         column * header_.num_keypoints;
+}
+
+FeatureFile::Column FeatureFile::x() const {
+  return Column(DoubleColumn(0), num_keypoints());
+}
+
+FeatureFile::Column FeatureFile::y() const {
+  return Column(DoubleColumn(1), num_keypoints());
+}
+
+FeatureFile::Column FeatureFile::strength() const {
+  return Column(DoubleColumn(2), num_keypoints());
+}
+
+FeatureFile::Column FeatureFile::scale() const {
+  return Column(DoubleColumn(3), num_keypoints());
+}
+
+FeatureFile::Column FeatureFile::orientation() const {
+  return Column(DoubleColumn(4), num_keypoints());
+}
+
+FeatureFile::TypeColumn FeatureFile::keypoint_type() const {
+  return TypeColumn(
+      reinterpret_cast<const int32_t*>(DoubleColumn(kNumDoubleColumns)),
+      num_keypoints());
+}
+
+FeatureFile::FloatDescriptors FeatureFile::float_descriptors() const {
+  CHECK(descriptor_type() == FeatureFileDescriptorType::FLOAT32)
+      << "The descriptors of the feature file are quantized.";
+  return FloatDescriptors(reinterpret_cast<const float*>(
+                              file_.begin() + header_.descriptor_offset),
+                          num_keypoints(),
+                          descriptor_dimension());
+}
+
+FeatureFile::QuantizedDescriptors FeatureFile::quantized_descriptors() const {
+  CHECK(descriptor_type() == FeatureFileDescriptorType::UINT8)
+      << "The descriptors of the feature file are not quantized.";
+  return QuantizedDescriptors(reinterpret_cast<const uint8_t*>(
+                                  file_.begin() + header_.descriptor_offset),
+                              num_keypoints(),
+                              descriptor_dimension());
+}
+
+void FeatureFile::GetKeypoints(std::vector<Keypoint>* keypoints) const {
+  CHECK_NOTNULL(keypoints)->resize(num_keypoints());
+  const Column x_column = x();
+  const Column y_column = y();
+  const Column strength_column = strength();
+  const Column scale_column = scale();
+  const Column orientation_column = orientation();
+  const TypeColumn type_column = keypoint_type();
+  for (int i = 0; i < num_keypoints(); i++) {
+    Keypoint& keypoint = (*keypoints)[i];
+    keypoint.set_x(x_column(i));
+    keypoint.set_y(y_column(i));
+    keypoint.set_keypoint_type(
+        static_cast<Keypoint::KeypointType>(type_column(i)));
+    keypoint.set_strength(strength_column(i));
+    keypoint.set_scale(scale_column(i));
+    keypoint.set_orientation(orientation_column(i));
+  }
+}
+
+void FeatureFile::GetDescriptors(
+    std::vector<Eigen::VectorXf>* descriptors) const {
+  CHECK_NOTNULL(descriptors)->clear();
+  if (descriptor_dimension() == 0) {
+    return;
+  }
+
+  descriptors->resize(num_keypoints());
+  if (descriptor_type() == FeatureFileDescriptorType::UINT8) {
+    const QuantizedDescriptors quantized = quantized_descriptors();
+    for (int i = 0; i < num_keypoints(); i++) {
+      (*descriptors)[i] =
+          (quantized.row(i).transpose().cast<float>() *
+           quantization_scale())
+              .array() +
+          quantization_offset();
+    }
+  } else {
+    const FloatDescriptors block = float_descriptors();
+    for (int i = 0; i < num_keypoints(); i++) {
+      (*descriptors)[i] = block.row(i).transpose();
+    }
+  }
+}
+
+}  // namespace theia
@@ -0,0 +1,155 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_IO_FEATURE_FILE_H_
+#define THEIA_IO_FEATURE_FILE_H_
+
+#include <Eigen/Core>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "theia/util/mapped_file.h"
+#include "theia/util/util.h"
+
+namespace theia {
+class Keypoint;
+
+// Descriptors are stored either as raw floats or quantized to one byte per
+// entry with a single affine mapping for the whole file:
+//   value = quantization_offset + quantization_scale * quantized_value.
+// Quantization is lossy but makes the descriptor block four times smaller,
+// which matters when the features of large image collections are streamed
+// from disk during matching.
+enum class FeatureFileDescriptorType : uint32_t {
+  FLOAT32 = 0,
+  UINT8 = 1,
+};
+
+// The fixed size header at the start of every feature file. All values are
+// stored in the byte order of the machine that wrote the file, which is
+// recorded in the byte order mark so that readers may reject foreign files.
+struct FeatureFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order_mark;
+  uint64_t num_keypoints;
+  uint32_t descriptor_dimension;
+  uint32_t descriptor_type;
+  float quantization_scale;
+  float quantization_offset;
+  // Offset in bytes of the descriptor block from the start of the file.
+  uint64_t descriptor_offset;
+  uint64_t reserved[2];
+};
+
+// Writes the keypoints and descriptors to a columnar binary feature file. The
+// file consists of the header above followed by one contiguous column per
+// keypoint attribute (x, y, strength, scale, and orientation as doubles and the
+// keypoint type as int32) and a row-major block of all descriptors. Unlike the
+// cereal archives written by WriteKeypointsAndDescriptors, the file may be
+// memory-mapped and used without deserializing it. All descriptors must have
+// the same dimension. Returns false if the file could not be written.
+bool WriteFeatureFile(const std::string& filepath,
+                      const std::vector<Keypoint>& keypoints,
+                      const std::vector<Eigen::VectorXf>& descriptors,
+                      const FeatureFileDescriptorType descriptor_type =
+                          FeatureFileDescriptorType::FLOAT32);
+
+// Returns true if the file starts with the header of a feature file.
+bool IsFeatureFile(const std::string& filepath);
+
+// A read-only, memory-mapped view of a feature file. The columns and the
+// descriptor block are exposed as Eigen maps directly into the mapped file so
+// that no copies are made until GetKeypoints() or GetDescriptors() is called.
+// Pages of the file are only read from disk once they are accessed, so reading
+// the keypoints of a file does not load its descriptors. The maps are only
+// valid while the FeatureFile is open.
+class FeatureFile {
+ public:
+  typedef Eigen::Map<const Eigen::VectorXd> Column;
+  typedef Eigen::Map<const Eigen::Matrix<int32_t, Eigen::Dynamic, 1> >
+      TypeColumn;
+  // Each row is one descriptor.
+  typedef Eigen::Map<const Eigen::Matrix<float,
+                                         Eigen::Dynamic,
+                                         Eigen::Dynamic,
+                                         Eigen::RowMajor> >
+      FloatDescriptors;
+  typedef Eigen::Map<const Eigen::Matrix<uint8_t,
+                                         Eigen::Dynamic,
+                                         Eigen::Dynamic,
+                                         Eigen::RowMajor> >
+      QuantizedDescriptors;
+
+  FeatureFile();
+  ~FeatureFile() {}
+
+  // Maps the file and validates its header. Returns false if the file cannot
+  // be opened or is not a valid feature file.
+  bool Open(const std::string& filepath);
+
+  int num_keypoints() const;
+  int descriptor_dimension() const;
+  FeatureFileDescriptorType descriptor_type() const;
+  float quantization_scale() const;
+  float quantization_offset() const;
+
+  // The keypoint columns.
+  Column x() const;
+  Column y() const;
+  Column strength() const;
+  Column scale() const;
+  Column orientation() const;
+  TypeColumn keypoint_type() const;
+
+  // The descriptor block. Only the accessor matching descriptor_type() may be
+  // called.
+  FloatDescriptors float_descriptors() const;
+  QuantizedDescriptors quantized_descriptors() const;
+
+  // Copies the keypoints or descriptors out of the file. Quantized descriptors
+  // are converted back to floats.
+  void GetKeypoints(std::vector<Keypoint>* keypoints) const;
+  void GetDescriptors(std::vector<Eigen::VectorXf>* descriptors) const;
+
+ private:
+  const double* DoubleColumn(const int column) const;
+
+  MappedFile file_;
+  FeatureFileHeader header_;
+
+  DISALLOW_COPY_AND_ASSIGN(FeatureFile);
+};
+
+}  // namespace theia
+
+#endif  // THEIA_IO_FEATURE_FILE_H_
@@ -0,0 +1,169 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+
+#include <fstream>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "theia/image/keypoint_detector/keypoint.h"
+#include "theia/io/feature_file.h"
+#include "theia/io/read_keypoints_and_descriptors.h"
+#include "theia/io/write_keypoints_and_descriptors.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+namespace {
+
+const std::string features_file =
+    THEIA_DATA_DIR + std::string("/io/feature_file_test.features");
+
+RandomNumberGenerator rng(59);
+
+void CreateFeatures(const int num_features,
+                    std::vector<Keypoint>* keypoints,
+                    std::vector<Eigen::VectorXf>* descriptors) {
+  for (int i = 0; i < num_features; i++) {
+    Keypoint keypoint(rng.RandDouble(0, 1000.0),
+                      rng.RandDouble(0, 1000.0),
+                      Keypoint::SIFT);
+    keypoint.set_strength(rng.RandDouble(0, 1.0));
+    keypoint.set_scale(rng.RandDouble(1.0, 10.0));
+    keypoint.set_orientation(rng.RandDouble(-M_PI, M_PI));
+    keypoints->emplace_back(keypoint);
+
+    Eigen::VectorXf descriptor(128);
+    for (int j = 0; j < descriptor.size(); j++) {
+      descriptor(j) = rng.RandFloat(0.0f, 0.5f);
+    }
+    descriptors->emplace_back(descriptor);
+  }
+}
+
+void ExpectKeypointsEqual(const std::vector<Keypoint>& expected,
+                          const std::vector<Keypoint>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (int i = 0; i < expected.size(); i++) {
+    EXPECT_EQ(expected[i].x(), actual[i].x());
+    EXPECT_EQ(expected[i].y(), actual[i].y());
+    EXPECT_EQ(expected[i].keypoint_type(), actual[i].keypoint_type());
+    EXPECT_EQ(expected[i].strength(), actual[i].strength());
+    EXPECT_EQ(expected[i].scale(), actual[i].scale());
+    EXPECT_EQ(expected[i].orientation(), actual[i].orientation());
+  }
+}
+
+}  // namespace
+
+TEST(FeatureFile, FloatDescriptors) {
+  static const int kNumFeatures = 100;
+  std::vector<Keypoint> keypoints;
+  std::vector<Eigen::VectorXf> descriptors;
+  CreateFeatures(kNumFeatures, &keypoints, &descriptors);
+  EXPECT_TRUE(WriteFeatureFile(features_file, keypoints, descriptors));
+  EXPECT_TRUE(IsFeatureFile(features_file));
+
+  FeatureFile feature_file;
+  ASSERT_TRUE(feature_file.Open(features_file));
+  EXPECT_EQ(feature_file.num_keypoints(), kNumFeatures);
+  EXPECT_EQ(feature_file.descriptor_dimension(), 128);
+  for (int i = 0; i < kNumFeatures; i++) {
+    EXPECT_EQ(feature_file.x()(i), keypoints[i].x());
+    EXPECT_EQ(feature_file.orientation()(i), keypoints[i].orientation());
+    EXPECT_EQ(feature_file.float_descriptors().row(i).transpose(),
+              descriptors[i]);
+  }
+
+  std::vector<Keypoint> read_keypoints;
+  std::vector<Eigen::VectorXf> read_descriptors;
+  EXPECT_TRUE(ReadKeypointsAndDescriptors(
+      features_file, &read_keypoints, &read_descriptors));
+  ExpectKeypointsEqual(keypoints, read_keypoints);
+  ASSERT_EQ(read_descriptors.size(), descriptors.size());
+  for (int i = 0; i < descriptors.size(); i++) {
+    EXPECT_EQ(read_descriptors[i], descriptors[i]);
+  }
+
+  // Reading only the keypoints must give the same keypoints.
+  EXPECT_TRUE(ReadKeypoints(features_file, &read_keypoints));
+  ExpectKeypointsEqual(keypoints, read_keypoints);
+}
+
+TEST(FeatureFile, QuantizedDescriptors) {
+  static const int kNumFeatures = 100;
+  std::vector<Keypoint> keypoints;
+  std::vector<Eigen::VectorXf> descriptors;
+  CreateFeatures(kNumFeatures, &keypoints, &descriptors);
+  EXPECT_TRUE(WriteFeatureFile(features_file,
+                               keypoints,
+                               descriptors,
+                               FeatureFileDescriptorType::UINT8));
+
+  FeatureFile feature_file;
+  ASSERT_TRUE(feature_file.Open(features_file));
+  EXPECT_EQ(feature_file.descriptor_type(), FeatureFileDescriptorType::UINT8);
+  std::vector<Keypoint> read_keypoints;
+  std::vector<Eigen::VectorXf> read_descriptors;
+  feature_file.GetKeypoints(&read_keypoints);
+  feature_file.GetDescriptors(&read_descriptors);
+  ExpectKeypointsEqual(keypoints, read_keypoints);
+
+  // The quantization error is at most half of a quantization step.
+  const float kTolerance = 0.5f * feature_file.quantization_scale() + 1e-6f;
+  ASSERT_EQ(read_descriptors.size(), descriptors.size());
+  for (int i = 0; i < descriptors.size(); i++) {
+    EXPECT_LE((read_descriptors[i] - descriptors[i]).cwiseAbs().maxCoeff(),
+              kTolerance);
+  }
+}
+
+TEST(FeatureFile, ReadsCerealFiles) {
+  static const int kNumFeatures = 10;
+  std::vector<Keypoint> keypoints;
+  std::vector<Eigen::VectorXf> descriptors;
+  CreateFeatures(kNumFeatures, &keypoints, &descriptors);
+  EXPECT_TRUE(
+      WriteKeypointsAndDescriptors(features_file, keypoints, descriptors));
+  EXPECT_FALSE(IsFeatureFile(features_file));
+
+  FeatureFile feature_file;
+  EXPECT_FALSE(feature_file.Open(features_file));
+
+  std::vector<Keypoint> read_keypoints;
+  EXPECT_TRUE(ReadKeypoints(features_file, &read_keypoints));
+  ExpectKeypointsEqual(keypoints, read_keypoints);
+}
+
+}  // namespace theia
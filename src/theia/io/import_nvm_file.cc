@@ -32,116 +32,258 @@
 // Please contact the author of this library if you have any questions.
 // Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
 
+#include "theia/io/import_nvm_file.h"
+
 #include <Eigen/Core>
+#include <Eigen/Geometry>
 #include <glog/logging.h>
+
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
 
-#include "theia/io/import_nvm_file.h"
 #include "theia/sfm/camera/camera.h"
+#include "theia/sfm/feature.h"
 #include "theia/sfm/reconstruction.h"
 #include "theia/sfm/track.h"
 #include "theia/sfm/view.h"
 #include "theia/util/filesystem.h"
-#include "theia/util/map_util.h"
-
-#include "visual_sfm/DataInterface.h"
-#include "visual_sfm/util.h"
+#include "theia/util/mapped_file.h"
+#include "theia/util/text_parser.h"
+#include "theia/util/threadpool.h"
 
 namespace theia {
 
 namespace {
-struct VSFMReconstruction {
-  std::vector<CameraT> camera_data;
-  std::vector<Point3D> point_data;
-  std::vector<Point2D> measurements;
-  std::vector<int> point_index;
-  std::vector<int> camera_index;
-  std::vector<string> view_names;
-  std::vector<int> point_colors;
+
+// A 3D point of the NVM file with its observations. The camera indices of the
+// observations are replaced by view ids once the point has been parsed.
+struct NVMPoint {
+  Eigen::Vector3d position;
+  Eigen::Vector3i color;
+  std::vector<std::pair<ViewId, Feature>> features;
 };
+
+// Reads a camera entry of the form:
+//   <name> <focal length> <rotation> <camera center> <distortion> 0
+// where the rotation is a quaternion (w, x, y, z). In the R9T variant of the
+// format the rotation is a row-major 3x3 matrix and the camera center is
+// replaced by the translation. Returns false if the entry is malformed or the
+// view cannot be added, e.g. because its name is already in the reconstruction.
+bool ReadCamera(const bool rotation_as_matrix,
+                const double timestamp,
+                TextParser* in,
+                Reconstruction* reconstruction,
+                ViewId* view_id) {
+  std::string name;
+  double focal_length;
+  if (!in->ReadToken(&name) || !in->ReadDouble(&focal_length)) {
+    return false;
+  }
+
+  Eigen::Matrix3d rotation;
+  if (rotation_as_matrix) {
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        if (!in->ReadDouble(&rotation(i, j))) {
+          return false;
+        }
+      }
+    }
+  } else {
+    Eigen::Vector4d quaternion;
+    for (int i = 0; i < 4; i++) {
+      if (!in->ReadDouble(&quaternion[i])) {
+        return false;
+      }
+    }
+    rotation = quaternion.squaredNorm() > 0.0
+                   ? Eigen::Quaterniond(quaternion[0],
+                                        quaternion[1],
+                                        quaternion[2],
+                                        quaternion[3])
+                         .normalized()
+                         .toRotationMatrix()
+                   : Eigen::Matrix3d::Identity();
+  }
+
+  Eigen::Vector3d position;
+  double radial_distortion, zero;
+  if (!in->ReadDouble(&position[0]) || !in->ReadDouble(&position[1]) ||
+      !in->ReadDouble(&position[2]) || !in->ReadDouble(&radial_distortion) ||
+      !in->ReadDouble(&zero)) {
+    return false;
+  }
+  if (rotation_as_matrix) {
+    position = -rotation.transpose() * position;
+  }
+
+  std::string view_name;
+  GetFilenameFromFilepath(name, true, &view_name);
+  // Add the view to the reconstruction.
+  VLOG(2) << "Adding view " << view_name << " to the reconstruction.";
+  *view_id = reconstruction->AddView(view_name, timestamp);
+  if (*view_id == kInvalidViewId) {
+    return false;
+  }
+  View* view = reconstruction->MutableView(*view_id);
+  view->SetEstimated(true);
+
+  // Set the camera intrinsic and extrinsic parameters.
+  Camera* camera = view->MutableCamera();
+  camera->SetCameraIntrinsicsModelType(CameraIntrinsicsModelType::PINHOLE);
+  camera->SetFocalLength(focal_length);
+  camera->SetOrientationFromRotationMatrix(rotation);
+  camera->SetPosition(position);
+  return true;
+}
+
+// Reads a point entry of the form:
+//   <position> <color> <num observations> <observation 1> ...
+// where each observation is given as <camera index> <feature index> <x> <y>.
+bool ReadPoint(const std::vector<ViewId>& view_ids,
+               TextParser* in,
+               NVMPoint* point) {
+  int num_observations;
+  if (!in->ReadDouble(&point->position[0]) ||
+      !in->ReadDouble(&point->position[1]) ||
+      !in->ReadDouble(&point->position[2]) ||
+      !in->ReadInt(&point->color[0]) || !in->ReadInt(&point->color[1]) ||
+      !in->ReadInt(&point->color[2]) || !in->ReadInt(&num_observations) ||
+      num_observations < 0) {
+    return false;
+  }
+
+  point->features.clear();
+  point->features.reserve(num_observations);
+  int camera_index, feature_index;
+  Eigen::Vector2d pixel;
+  for (int i = 0; i < num_observations; i++) {
+    if (!in->ReadInt(&camera_index) || !in->ReadInt(&feature_index) ||
+        !in->ReadDouble(&pixel[0]) || !in->ReadDouble(&pixel[1]) ||
+        camera_index < 0 || camera_index >= view_ids.size()) {
+      return false;
+    }
+    point->features.emplace_back(view_ids[camera_index], Feature(pixel));
+  }
+  return true;
+}
+
+// Each point is written on its own line by VisualSfM, so the lines are indexed
+// first and the points are then parsed in parallel. If the points do not follow
+// this layout they are parsed sequentially instead.
+bool ReadPoints(const std::vector<ViewId>& view_ids,
+                const int num_points,
+                const int num_threads,
+                TextParser* in,
+                std::vector<NVMPoint>* points) {
+  points->resize(num_points);
+
+  std::vector<const char*> line_starts;
+  FindNonEmptyLineStarts(in->position(), in->end(), &line_starts);
+  if (line_starts.size() > num_points) {
+    std::vector<char> point_is_valid(num_points, false);
+    ParallelFor(num_threads, num_points, [&](const int i) {
+      TextParser point_parser(line_starts[i], line_starts[i + 1]);
+      point_is_valid[i] =
+          ReadPoint(view_ids, &point_parser, &(*points)[i]) &&
+          point_parser.AtEnd();
+    });
+    if (std::find(point_is_valid.begin(), point_is_valid.end(), false) ==
+        point_is_valid.end()) {
+      return true;
+    }
+  }
+
+  VLOG(2) << "The points are not written one per line. Parsing them "
+             "sequentially.";
+  for (int i = 0; i < num_points; i++) {
+    if (!ReadPoint(view_ids, in, &(*points)[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 bool ImportNVMFile(const std::string& nvm_filepath,
                    Reconstruction* reconstruction) {
+  return ImportNVMFile(nvm_filepath, 1, reconstruction);
+}
+
+bool ImportNVMFile(const std::string& nvm_filepath,
+                   const int num_threads,
+                   Reconstruction* reconstruction) {
   CHECK_GT(nvm_filepath.length(), 0);
+  CHECK_GT(num_threads, 0);
   CHECK_NOTNULL(reconstruction);
 
-  // Read VSFM file.
-  VSFMReconstruction vsfm_reconstruction;
-  CHECK(LoadModelFile(nvm_filepath.c_str(),
-                      vsfm_reconstruction.camera_data,
-                      vsfm_reconstruction.point_data,
-                      vsfm_reconstruction.measurements,
-                      vsfm_reconstruction.point_index,
-                      vsfm_reconstruction.camera_index,
-                      vsfm_reconstruction.view_names,
-                      vsfm_reconstruction.point_colors));
-
-  // Check the NVM reconstruction for sanity.
-  CHECK_EQ(vsfm_reconstruction.view_names.size(),
-           vsfm_reconstruction.camera_data.size());
-  CHECK_EQ(vsfm_reconstruction.measurements.size(),
-           vsfm_reconstruction.point_index.size());
-  CHECK_EQ(vsfm_reconstruction.point_index.size(),
-           vsfm_reconstruction.camera_index.size());
-
-  // Add all cameras to the reconstruction.
-  for (int i = 0; i < vsfm_reconstruction.camera_data.size(); i++) {
-    std::string view_name;
-    GetFilenameFromFilepath(
-        vsfm_reconstruction.view_names[i], true, &view_name);
-    // Add the view to the reconstruction.
-    LOG(INFO) << "Adding view " << view_name << " to the reconstruction.";
-    const ViewId view_id = reconstruction->AddView(view_name, i);
-    CHECK_NE(view_id, kInvalidViewId);
-    View* view = reconstruction->MutableView(view_id);
-    view->SetEstimated(true);
-
-    // Set the camera intrinsic parameters.
-    const CameraT& vsfm_camera = vsfm_reconstruction.camera_data[i];
-    Camera* camera = view->MutableCamera();
-    camera->SetCameraIntrinsicsModelType(CameraIntrinsicsModelType::PINHOLE);
-    camera->SetFocalLength(vsfm_camera.GetFocalLength());
-
-    // Set the camera extrinsic parameters. The rotation matrix is retreived
-    // from visual sfm in row-major order, hence the transpose.
-    Eigen::Matrix3f rotation;
-    vsfm_camera.GetMatrixRotation(rotation.data());
-    camera->SetOrientationFromRotationMatrix(
-        rotation.transpose().cast<double>());
-    Eigen::Vector3f position;
-    vsfm_camera.GetCameraCenter(position.data());
-    camera->SetPosition(position.cast<double>());
+  MappedFile file;
+  if (!file.Open(nvm_filepath)) {
+    LOG(ERROR) << "Could not open the NVM file: " << nvm_filepath;
+    return false;
+  }
+  TextParser in(file.begin(), file.end());
+
+  // The optional header line holds the version of the format and possibly a
+  // fixed calibration, which is ignored as each camera has its own focal
+  // length.
+  bool rotation_as_matrix = false;
+  if (file.size() > 0 && *file.begin() == 'N') {
+    std::string version;
+    in.ReadToken(&version);
+    rotation_as_matrix = version.find("R9T") != std::string::npos;
+    in.SkipLine();
+  }
+
+  // Add all cameras to the reconstruction. Only the first model of the file is
+  // read.
+  int num_cameras;
+  if (!in.ReadInt(&num_cameras) || num_cameras <= 1) {
+    LOG(ERROR) << "Could not read the cameras of " << nvm_filepath;
+    return false;
+  }
+  reconstruction->Reserve(reconstruction->NumViews() + num_cameras,
+                          reconstruction->NumTracks());
+  // The views are given consecutive timestamps after the views that are
+  // already in the reconstruction.
+  const int first_timestamp = reconstruction->NumViews();
+  std::vector<ViewId> view_ids(num_cameras);
+  for (int i = 0; i < num_cameras; i++) {
+    if (!ReadCamera(rotation_as_matrix,
+                    first_timestamp + i,
+                    &in,
+                    reconstruction,
+                    &view_ids[i])) {
+      LOG(ERROR) << "Could not read camera " << i << " of " << nvm_filepath;
+      return false;
+    }
   }
 
-  // Create the track correspondences.
-  std::unordered_map<int, std::vector<std::pair<ViewId, Feature>>> tracks;
-  for (int i = 0; i < vsfm_reconstruction.measurements.size(); i++) {
-    const Feature feature(
-        Eigen::Vector2d(vsfm_reconstruction.measurements[i].x,
-                        vsfm_reconstruction.measurements[i].y));
-    const int img_id = vsfm_reconstruction.camera_index[i];
-    tracks[vsfm_reconstruction.point_index[i]].emplace_back(img_id, feature);
+  int num_points;
+  std::vector<NVMPoint> points;
+  if (!in.ReadInt(&num_points) || num_points <= 0 ||
+      !ReadPoints(view_ids, num_points, num_threads, &in, &points)) {
+    LOG(ERROR) << "Could not read the points of " << nvm_filepath;
+    return false;
   }
 
   // Add all tracks to the reconstruction and set the 3d position.
-  for (int i = 0; i < vsfm_reconstruction.point_data.size(); i++) {
-    Eigen::Vector4f point(vsfm_reconstruction.point_data[i].xyz[0],
-                          vsfm_reconstruction.point_data[i].xyz[1],
-                          vsfm_reconstruction.point_data[i].xyz[2],
-                          1.0);
-    Eigen::Vector3i color(vsfm_reconstruction.point_colors[3 * i],
-                          vsfm_reconstruction.point_colors[3 * i + 1],
-                          vsfm_reconstruction.point_colors[3 * i + 2]);
-    const auto& features = FindOrDie(tracks, i);
-    const TrackId track_id = reconstruction->AddTrack(features);
-    CHECK_NE(track_id, kInvalidTrackId);
+  reconstruction->Reserve(reconstruction->NumViews(),
+                          reconstruction->NumTracks() + num_points);
+  for (const NVMPoint& point : points) {
+    const TrackId track_id = reconstruction->AddTrack(point.features);
+    if (track_id == kInvalidTrackId) {
+      LOG(WARNING) << "Skipping a point of " << nvm_filepath
+                   << " that is observed by fewer than two views.";
+      continue;
+    }
     Track* track = reconstruction->MutableTrack(track_id);
     track->SetEstimated(true);
-    *track->MutablePoint() = point.cast<double>();
-    *track->MutableColor() = color.cast<uint8_t>();
+    *track->MutablePoint() = point.position.homogeneous();
+    *track->MutableColor() = point.color.cast<uint8_t>();
   }
 
   return true;
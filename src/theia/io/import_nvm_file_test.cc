@@ -0,0 +1,210 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/io/import_nvm_file.h"
+
+#include <Eigen/Core>
+
+#include <fstream>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "theia/io/write_nvm_file.h"
+#include "theia/sfm/camera/camera.h"
+#include "theia/sfm/reconstruction.h"
+#include "theia/sfm/track.h"
+#include "theia/sfm/view.h"
+#include "theia/util/filesystem.h"
+#include "theia/util/map_util.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+namespace {
+
+static const int kNumViews = 4;
+static const int kNumTracks = 50;
+// NVM files are written with the default precision of the output stream.
+static const double kTolerance = 1e-4;
+
+// Creates an estimated reconstruction of pinhole cameras without a principal
+// point, as NVM files cannot store it.
+void CreateReconstruction(Reconstruction* reconstruction) {
+  RandomNumberGenerator rng(61);
+  for (int i = 0; i < kNumViews; i++) {
+    const ViewId view_id =
+        reconstruction->AddView("image" + std::to_string(i) + ".jpg", i);
+    View* view = reconstruction->MutableView(view_id);
+    view->SetEstimated(true);
+    Camera* camera = view->MutableCamera();
+    camera->SetFocalLength(rng.RandDouble(500.0, 1500.0));
+    camera->SetPrincipalPoint(0.0, 0.0);
+    camera->SetOrientationFromAngleAxis(rng.RandVector3d(-0.5, 0.5));
+    camera->SetPosition(rng.RandVector3d(-2.0, 2.0));
+  }
+
+  for (int i = 0; i < kNumTracks; i++) {
+    // Each track is seen by all views but the i-th view modulo kNumViews.
+    std::vector<std::pair<ViewId, Feature>> features;
+    for (int j = 0; j < kNumViews; j++) {
+      if (j != i % kNumViews) {
+        features.emplace_back(
+            j, Feature(rng.RandInt(-500, 500), rng.RandInt(-500, 500)));
+      }
+    }
+    const TrackId track_id = reconstruction->AddTrack(features);
+    Track* track = reconstruction->MutableTrack(track_id);
+    track->SetEstimated(true);
+    *track->MutablePoint() = rng.RandVector3d(-5.0, 5.0).homogeneous();
+    *track->MutableColor() = Eigen::Matrix<uint8_t, 3, 1>(i, 2 * i, 3 * i);
+  }
+}
+
+// Checks that every view and track of expected is in reconstruction. Views are
+// matched by name and tracks by their unique color.
+void ExpectReconstructionContains(const Reconstruction& expected,
+                                  const Reconstruction& reconstruction) {
+  std::unordered_map<ViewId, ViewId> expected_to_read_view_id;
+  for (const ViewId view_id : expected.ViewIds()) {
+    const View* expected_view = expected.View(view_id);
+    const ViewId read_view_id =
+        reconstruction.ViewIdFromName(expected_view->Name());
+    ASSERT_NE(read_view_id, kInvalidViewId);
+    expected_to_read_view_id[view_id] = read_view_id;
+    const View* view = reconstruction.View(read_view_id);
+    EXPECT_TRUE(view->IsEstimated());
+    const Camera& expected_camera = expected_view->Camera();
+    const Camera& camera = view->Camera();
+    EXPECT_NEAR(camera.FocalLength(), expected_camera.FocalLength(), 1e-2);
+    EXPECT_LT((camera.GetOrientationAsRotationMatrix() -
+               expected_camera.GetOrientationAsRotationMatrix())
+                  .norm(),
+              kTolerance);
+    EXPECT_LT((camera.GetPosition() - expected_camera.GetPosition()).norm(),
+              kTolerance);
+  }
+
+  std::unordered_map<uint8_t, TrackId> read_track_from_color;
+  for (const TrackId track_id : reconstruction.TrackIds()) {
+    read_track_from_color[reconstruction.Track(track_id)->Color()[0]] =
+        track_id;
+  }
+  for (const TrackId expected_track_id : expected.TrackIds()) {
+    const Track* expected_track = expected.Track(expected_track_id);
+    const TrackId track_id =
+        FindOrDie(read_track_from_color, expected_track->Color()[0]);
+    const Track* track = reconstruction.Track(track_id);
+    EXPECT_TRUE(track->IsEstimated());
+    EXPECT_EQ(track->Color(), expected_track->Color());
+    EXPECT_LT((track->Point().hnormalized() -
+               expected_track->Point().hnormalized())
+                  .norm(),
+              kTolerance);
+    ASSERT_EQ(track->NumViews(), expected_track->NumViews());
+    for (const ViewId view_id : expected_track->ViewIds()) {
+      const ViewId read_view_id =
+          FindOrDie(expected_to_read_view_id, view_id);
+      const Feature* feature =
+          reconstruction.View(read_view_id)->GetFeature(track_id);
+      ASSERT_NE(feature, nullptr);
+      EXPECT_EQ(feature->point_,
+                expected.View(view_id)->GetFeature(expected_track_id)->point_);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(ImportNVMFile, RoundTrip) {
+  Reconstruction expected;
+  CreateReconstruction(&expected);
+
+  std::string directory;
+  ASSERT_TRUE(CreateTemporaryDirectory("theia_nvm_", &directory));
+  const std::string nvm_file = directory + "/reconstruction.nvm";
+  ASSERT_TRUE(WriteNVMFile(nvm_file, expected));
+
+  for (const int num_threads : {1, 4}) {
+    Reconstruction reconstruction;
+    ASSERT_TRUE(ImportNVMFile(nvm_file, num_threads, &reconstruction));
+    EXPECT_EQ(reconstruction.NumViews(), kNumViews);
+    EXPECT_EQ(reconstruction.NumTracks(), kNumTracks);
+    ExpectReconstructionContains(expected, reconstruction);
+  }
+
+  EXPECT_TRUE(RemoveDirectory(directory));
+}
+
+// The camera indices of the file must be mapped to the ids of the views that
+// are added, which differ from the indices when the reconstruction is not
+// empty.
+TEST(ImportNVMFile, ImportIntoNonEmptyReconstruction) {
+  Reconstruction expected;
+  CreateReconstruction(&expected);
+
+  std::string directory;
+  ASSERT_TRUE(CreateTemporaryDirectory("theia_nvm_", &directory));
+  const std::string nvm_file = directory + "/reconstruction.nvm";
+  ASSERT_TRUE(WriteNVMFile(nvm_file, expected));
+
+  Reconstruction reconstruction;
+  const ViewId existing_view_id = reconstruction.AddView("existing.jpg", 0);
+  ASSERT_TRUE(ImportNVMFile(nvm_file, 4, &reconstruction));
+  EXPECT_EQ(reconstruction.NumViews(), kNumViews + 1);
+  EXPECT_EQ(reconstruction.NumTracks(), kNumTracks);
+  EXPECT_TRUE(reconstruction.View(existing_view_id)->TrackIds().empty());
+  ExpectReconstructionContains(expected, reconstruction);
+
+  EXPECT_TRUE(RemoveDirectory(directory));
+}
+
+TEST(ImportNVMFile, RejectsFileWithoutPoints) {
+  std::string directory;
+  ASSERT_TRUE(CreateTemporaryDirectory("theia_nvm_", &directory));
+  const std::string nvm_file = directory + "/reconstruction.nvm";
+  {
+    std::ofstream out(nvm_file);
+    out << "NVM_V3\n\n2\n"
+        << "a.jpg 500 1 0 0 0 0 0 0 0 0\n"
+        << "b.jpg 500 1 0 0 0 1 0 0 0 0\n"
+        << "0\n";
+  }
+
+  Reconstruction reconstruction;
+  EXPECT_FALSE(ImportNVMFile(nvm_file, &reconstruction));
+
+  EXPECT_TRUE(RemoveDirectory(directory));
+}
+
+}  // namespace theia
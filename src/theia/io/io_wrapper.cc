@@ -1,5 +1,7 @@
 #include "theia/io/io_wrapper.h"
 
+#include <stdexcept>
+
 #include "theia/io/import_nvm_file.h"
 #include "theia/io/populate_image_sizes.h"
 #include "theia/io/read_1dsfm.h"
@@ -51,6 +53,41 @@ ReadKeypointsAndDescriptorsWrapper(const std::string& features_file) {
   return std::make_tuple(success, keypoints, descriptors);
 }
 
+std::tuple<bool, std::vector<Keypoint>> ReadKeypointsWrapper(
+    const std::string& features_file) {
+  std::vector<Keypoint> keypoints;
+  const bool success = ReadKeypoints(features_file, &keypoints);
+  return std::make_tuple(success, keypoints);
+}
+
+std::unique_ptr<FeatureFile> OpenFeatureFileWrapper(
+    const std::string& feature_file) {
+  std::unique_ptr<FeatureFile> file(new FeatureFile());
+  if (!file->Open(feature_file)) {
+    throw std::invalid_argument("Could not open the feature file " +
+                                feature_file);
+  }
+  return file;
+}
+
+FeatureFile::FloatDescriptors FeatureFileFloatDescriptorsWrapper(
+    const FeatureFile& feature_file) {
+  if (feature_file.descriptor_type() != FeatureFileDescriptorType::FLOAT32) {
+    throw std::invalid_argument(
+        "The descriptors of the feature file are quantized.");
+  }
+  return feature_file.float_descriptors();
+}
+
+FeatureFile::QuantizedDescriptors FeatureFileQuantizedDescriptorsWrapper(
+    const FeatureFile& feature_file) {
+  if (feature_file.descriptor_type() != FeatureFileDescriptorType::UINT8) {
+    throw std::invalid_argument(
+        "The descriptors of the feature file are not quantized.");
+  }
+  return feature_file.quantized_descriptors();
+}
+
 std::tuple<bool, Reconstruction> ReadStrechaDatasetWrapper(
     const std::string& dataset_directory) {
   Reconstruction reconstr = Reconstruction();
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <Eigen/Core>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "theia/image/keypoint_detector/keypoint.h"
+#include "theia/io/feature_file.h"
 #include "theia/sfm/reconstruction.h"
 #include "theia/sfm/view_graph/view_graph.h"
 
@@ -23,6 +25,19 @@ std::tuple<bool, Reconstruction> ReadBundlerFilesWrapper(
     const std::string& lists_file, const std::string& bundle_file);
 std::tuple<bool, std::vector<Keypoint>, std::vector<Eigen::VectorXf>>
 ReadKeypointsAndDescriptorsWrapper(const std::string& features_file);
+std::tuple<bool, std::vector<Keypoint>> ReadKeypointsWrapper(
+    const std::string& features_file);
+// Opens a feature file for Python and throws std::invalid_argument if it cannot
+// be opened. Python cannot reopen the file, as that would invalidate the numpy
+// views of the previous mapping.
+std::unique_ptr<FeatureFile> OpenFeatureFileWrapper(
+    const std::string& feature_file);
+// Same as FeatureFile::float_descriptors() and quantized_descriptors(), but
+// throw std::invalid_argument instead of aborting on the wrong descriptor type.
+FeatureFile::FloatDescriptors FeatureFileFloatDescriptorsWrapper(
+    const FeatureFile& feature_file);
+FeatureFile::QuantizedDescriptors FeatureFileQuantizedDescriptorsWrapper(
+    const FeatureFile& feature_file);
 std::tuple<bool, Reconstruction> ReadStrechaDatasetWrapper(
     const std::string& dataset_directory);
 std::tuple<bool, Reconstruction> ReadReconstructionWrapper(
@@ -39,8 +39,8 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <stdio.h>
 #include <algorithm>
-#include <fstream>  // NOLINT
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -55,15 +55,24 @@
 #include "theia/sfm/view_graph/view_graph.h"
 #include "theia/util/filesystem.h"
 #include "theia/util/map_util.h"
+#include "theia/util/mapped_file.h"
+#include "theia/util/text_parser.h"
+#include "theia/util/threadpool.h"
 
 namespace theia {
 
+// All files are memory-mapped and split into lines. The records of the large
+// files (coords, tracks and EGs) are then parsed in parallel into preallocated
+// containers, and the results are added to the reconstruction and view graph in
+// file order so that the ids do not depend on the number of threads.
 class Input1DSFM {
  public:
   Input1DSFM(const std::string& dataset_directory,
+             const int num_threads,
              Reconstruction* reconstruction,
              ViewGraph* view_graph)
       : dataset_directory_(dataset_directory),
+        num_threads_(num_threads),
         reconstruction_(reconstruction),
         view_graph_(view_graph) {}
 
@@ -79,6 +88,7 @@ class Input1DSFM {
                             int* num_keys);
 
   const std::string& dataset_directory_;
+  const int num_threads_;
   Reconstruction* reconstruction_;
   ViewGraph* view_graph_;
 
@@ -93,19 +103,18 @@ class Input1DSFM {
 bool Input1DSFM::ReadCC(std::unordered_set<int>* valid_image_index) {
   const std::string cc_filename = dataset_directory_ + "/cc.txt";
 
-  std::ifstream ifs(cc_filename.c_str(), std::ios::in);
-  if (!ifs.is_open()) {
+  MappedFile file;
+  if (!file.Open(cc_filename)) {
     LOG(ERROR) << "Cannot read the cc file from " << cc_filename;
     return false;
   }
 
-  while (!ifs.eof()) {
-    int img_index;
-    ifs >> img_index;
+  TextParser in(file.begin(), file.end());
+  int img_index;
+  while (in.ReadInt(&img_index)) {
     valid_image_index->insert(img_index);
   }
-
-  return true;
+  return in.AtEnd();
 }
 
 // Reads the list file and ignores the focal length since it can be recovered
@@ -113,22 +122,24 @@ bool Input1DSFM::ReadCC(std::unordered_set<int>* valid_image_index) {
 bool Input1DSFM::ReadListsFile(
     const std::unordered_set<int>& valid_image_index) {
   const std::string list_filename = dataset_directory_ + "/list.txt";
-  std::ifstream ifs(list_filename.c_str(), std::ios::in);
-  if (!ifs.is_open()) {
+  MappedFile file;
+  if (!file.Open(list_filename)) {
     LOG(ERROR) << "Cannot read the list file from " << list_filename;
     return false;
   }
 
-  const char space = static_cast<char>(' ');
+  std::vector<const char*> line_starts;
+  FindNonEmptyLineStarts(file.begin(), file.end(), &line_starts);
+  const int num_lines = line_starts.size() - 1;
+  reconstruction_->Reserve(
+      std::min(num_lines, static_cast<int>(valid_image_index.size())), 0);
+
   int view_cnt = 0;
-  while (!ifs.eof()) {
+  for (int i = 0; i < num_lines; i++) {
+    TextParser line(line_starts[i], line_starts[i + 1]);
     // Read in the filename.
     std::string filename, truncated_filename;
-
-    ifs >> filename;
-    if (filename.length() == 0) {
-      break;
-    }
+    line.ReadToken(&filename);
     CHECK(theia::GetFilenameFromFilepath(filename, true, &truncated_filename));
     const ViewId view_id =
         reconstruction_->AddView(truncated_filename, ++view_cnt);
@@ -136,10 +147,12 @@ bool Input1DSFM::ReadListsFile(
 
     // Check to see if the exif focal length is given.
     double focal_length = 0;
-    if (ifs.peek() == space) {
-      int temp;
-      ifs >> temp;
-      ifs >> focal_length;
+    int temp;
+    if (!line.AtEnd() &&
+        (!line.ReadInt(&temp) || !line.ReadDouble(&focal_length))) {
+      LOG(ERROR) << "Invalid entry for image " << filename << " in "
+                 << list_filename;
+      return false;
     }
 
     // If the view is not in the connected component remove it. Adding it first
@@ -158,11 +171,11 @@ bool Input1DSFM::ReadListsFile(
       reconstruction_->MutableView(view_id)
           ->MutableCameraIntrinsicsPrior()
           ->focal_length.is_set = true;
-      LOG(INFO) << "Adding image " << truncated_filename
-                << " with focal length: " << focal_length;
+      VLOG(2) << "Adding image " << truncated_filename
+              << " with focal length: " << focal_length;
     } else {
-      LOG(INFO) << "Adding image " << truncated_filename
-                << " with focal length: UNKNOWN";
+      VLOG(2) << "Adding image " << truncated_filename
+              << " with focal length: UNKNOWN";
     }
   }
   return true;
@@ -174,7 +187,7 @@ bool Input1DSFM::ReadCoordsHeaderLine(const std::string& line,
   float principal_point_x, principal_point_y, focal_length;
   char name[256];
   sscanf(line.c_str(),
-         "#index = %d, name = %s keys = %d, px = %f, py = %f, focal = %f",
+         "#index = %d, name = %255s keys = %d, px = %f, py = %f, focal = %f",
          view_id,
          name,
          num_keys,
@@ -197,101 +210,181 @@ bool Input1DSFM::ReadCoordsHeaderLine(const std::string& line,
   return true;
 }
 
-// Reads the coords file. Only the coords with a valid track in the connected
-// component are kept.
+// Reads the coords file. Only the coords of images in the connected component
+// are kept. The file consists of one header line per image followed by one
+// line per keypoint, so the headers are located first and the keypoints of all
+// images are then parsed in parallel.
 bool Input1DSFM::ReadCoords() {
   const std::string coords_filename = dataset_directory_ + "/coords.txt";
-  std::ifstream ifs(coords_filename.c_str(), std::ios::in);
-  if (!ifs.is_open()) {
+  MappedFile file;
+  if (!file.Open(coords_filename)) {
     LOG(ERROR) << "Cannot read the coords file from " << coords_filename;
     return false;
   }
 
-  feature_coordinates_.reserve(reconstruction_->NumViews());
-  feature_colors_.reserve(reconstruction_->NumViews());
-  while (!ifs.eof()) {
-    std::string line;
-    std::getline(ifs, line);
-    if (ifs.eof()) {
-      break;
-    }
+  std::vector<const char*> line_starts;
+  FindNonEmptyLineStarts(file.begin(), file.end(), &line_starts);
+  const int num_lines = line_starts.size() - 1;
 
+  // The keypoints of an image are in lines [first_line, first_line + num_keys)
+  // and are written to the given containers.
+  struct KeypointBlock {
+    int first_line;
     int num_keys;
+    std::vector<Feature>* features;
+    std::vector<Eigen::Matrix<uint8_t, 3, 1> >* colors;
+  };
+  std::vector<KeypointBlock> blocks;
+  blocks.reserve(reconstruction_->NumViews());
+  feature_coordinates_.reserve(reconstruction_->NumViews());
+  feature_colors_.reserve(reconstruction_->NumViews());
+  int line_index = 0;
+  while (line_index < num_lines) {
+    const std::string line(
+        line_starts[line_index],
+        TextParser::FindLineEnd(line_starts[line_index], file.end()));
+    ++line_index;
+
+    int num_keys = 0;
     ViewId view_id;
+    const bool is_valid_view =
+        ReadCoordsHeaderLine(line, &view_id, &num_keys);
+    if (num_keys < 0 || line_index + num_keys > num_lines) {
+      LOG(ERROR) << "Invalid header in " << coords_filename << ": " << line;
+      return false;
+    }
     // If the image is not in the connected component then do not read it.
-    if (!ReadCoordsHeaderLine(line, &view_id, &num_keys)) {
-      for (int i = 0; i < num_keys; i++) {
-        std::getline(ifs, line);
-      }
-      continue;
+    if (is_valid_view) {
+      auto& features = feature_coordinates_[view_id];
+      features.resize(num_keys);
+      auto& colors = feature_colors_[view_id];
+      colors.resize(num_keys);
+      blocks.push_back({line_index, num_keys, &features, &colors});
     }
+    line_index += num_keys;
+  }
 
-    auto& features = feature_coordinates_[view_id];
-    features.reserve(num_keys);
-    auto& colors = feature_colors_[view_id];
-    colors.reserve(num_keys);
-
+  // The index of the first malformed line of each block, or -1.
+  std::vector<int> invalid_lines(blocks.size(), -1);
+  ParallelFor(num_threads_, blocks.size(), [&](const int i) {
+    const KeypointBlock& block = blocks[i];
+    int index, color[3];
+    double zero;
     Eigen::Vector2d keypoint;
-    Eigen::Vector3i color;
-    for (int i = 0; i < num_keys; i++) {
-      std::getline(ifs, line);
-      sscanf(line.c_str(),
-             "%*d %lf %lf 0 0 %d %d %d",
-             &keypoint[0],
-             &keypoint[1],
-             &color[0],
-             &color[1],
-             &color[2]);
-      features.emplace_back(keypoint);
-      colors.emplace_back(color.cast<uint8_t>());
+    for (int j = 0; j < block.num_keys; j++) {
+      TextParser in(line_starts[block.first_line + j],
+                    line_starts[block.first_line + j + 1]);
+      // Each line has the form: <index> <x> <y> 0 0 <r> <g> <b>
+      if (!in.ReadInt(&index) || !in.ReadDouble(&keypoint[0]) ||
+          !in.ReadDouble(&keypoint[1]) || !in.ReadDouble(&zero) ||
+          !in.ReadDouble(&zero) || !in.ReadInt(&color[0]) ||
+          !in.ReadInt(&color[1]) || !in.ReadInt(&color[2])) {
+        invalid_lines[i] = block.first_line + j;
+        return;
+      }
+      (*block.features)[j] = Feature(keypoint);
+      (*block.colors)[j] =
+          Eigen::Vector3i(color[0], color[1], color[2]).cast<uint8_t>();
+    }
+  });
+
+  for (int i = 0; i < blocks.size(); i++) {
+    if (invalid_lines[i] >= 0) {
+      LOG(ERROR) << "Invalid keypoint at line "
+                 << LineNumber(file.begin(), line_starts[invalid_lines[i]])
+                 << " of " << coords_filename;
+      return false;
     }
   }
-
   return true;
 }
 
 bool Input1DSFM::ReadTracks() {
   const std::string tracks_filename = dataset_directory_ + "/tracks.txt";
-  std::ifstream ifs(tracks_filename.c_str(), std::ios::in);
-  if (!ifs.is_open()) {
+  MappedFile file;
+  if (!file.Open(tracks_filename)) {
     LOG(ERROR) << "Cannot read the coords file from " << tracks_filename;
     return false;
   }
 
   // Read number of tracks.
+  TextParser in(file.begin(), file.end());
   int num_tracks;
-  ifs >> num_tracks;
+  if (!in.ReadInt(&num_tracks) || num_tracks < 0) {
+    LOG(ERROR) << "Cannot read the number of tracks from " << tracks_filename;
+    return false;
+  }
 
-  for (int i = 0; i < num_tracks; i++) {
+  // Each track is on its own line.
+  std::vector<const char*> line_starts;
+  FindNonEmptyLineStarts(in.position(), file.end(), &line_starts);
+  if (line_starts.size() < num_tracks + 1) {
+    LOG(ERROR) << "The tracks file " << tracks_filename << " is truncated.";
+    return false;
+  }
+
+  std::vector<std::vector<std::pair<ViewId, Feature> > > tracks(num_tracks);
+  std::vector<Eigen::Matrix<uint8_t, 3, 1> > track_colors(num_tracks);
+  std::vector<char> track_is_valid(num_tracks, false);
+  ParallelFor(num_threads_, num_tracks, [&](const int i) {
+    TextParser track_parser(line_starts[i], line_starts[i + 1]);
     int num_features;
-    ifs >> num_features;
+    if (!track_parser.ReadInt(&num_features) || num_features < 0) {
+      return;
+    }
 
-    std::vector<std::pair<ViewId, Feature> > track;
+    auto& track = tracks[i];
     track.reserve(num_features);
     int feature_id;
     ViewId view_id;
     Eigen::Vector3f color = Eigen::Vector3f::Zero();
     for (int j = 0; j < num_features; j++) {
-      ifs >> view_id;
-      ifs >> feature_id;
+      int view_index;
+      if (!track_parser.ReadInt(&view_index) ||
+          !track_parser.ReadInt(&feature_id)) {
+        return;
+      }
+      view_id = view_index;
 
       // Aggregate the features that form this track.
-      const auto& features = FindOrDie(feature_coordinates_, view_id);
-      const Feature& feature = features[feature_id];
-      track.emplace_back(view_id, feature);
+      const auto* features = FindOrNull(feature_coordinates_, view_id);
+      if (features == nullptr || feature_id < 0 ||
+          feature_id >= features->size()) {
+        return;
+      }
+      track.emplace_back(view_id, (*features)[feature_id]);
 
       // Add the color of the feature to form the mean color of the point.
       const auto& colors = FindOrDie(feature_colors_, view_id);
       color += colors[feature_id].cast<float>();
     }
-    // Add the track to the reconstruction.
-    const TrackId track_id = reconstruction_->AddTrack(track);
-    CHECK_NE(track_id, kInvalidTrackId);
+
+    if (!track.empty()) {
+      color /= static_cast<float>(track.size());
+    }
+    track_colors[i] = color.cast<uint8_t>();
+    track_is_valid[i] = true;
+  });
+
+  // Add the tracks to the reconstruction in the order of the file.
+  reconstruction_->Reserve(reconstruction_->NumViews(),
+                           reconstruction_->NumTracks() + num_tracks);
+  for (int i = 0; i < num_tracks; i++) {
+    if (!track_is_valid[i]) {
+      LOG(ERROR) << "Invalid track at line "
+                 << LineNumber(file.begin(), line_starts[i]) << " of "
+                 << tracks_filename;
+      return false;
+    }
+    // Tracks with fewer than two observations or with duplicate views cannot
+    // be added. AddTrack logs a warning for them.
+    const TrackId track_id = reconstruction_->AddTrack(tracks[i]);
+    if (track_id == kInvalidTrackId) {
+      continue;
+    }
 
     // Set the color of the track.
-    color /= static_cast<float>(track.size());
-    *reconstruction_->MutableTrack(track_id)->MutableColor() =
-        color.cast<uint8_t>();
+    *reconstruction_->MutableTrack(track_id)->MutableColor() = track_colors[i];
   }
 
   return true;
@@ -300,49 +393,66 @@ bool Input1DSFM::ReadTracks() {
 // Reads the epipolar geometry files.
 bool Input1DSFM::ReadEGs() {
   const std::string eg_filename = dataset_directory_ + "/EGs.txt";
-  std::ifstream ifs(eg_filename.c_str(), std::ios::in);
-  if (!ifs.is_open()) {
+  MappedFile file;
+  if (!file.Open(eg_filename)) {
     LOG(ERROR) << "Cannot read the EG file from " << eg_filename;
     return false;
   }
 
+  // Each epipolar geometry is on its own line.
+  std::vector<const char*> line_starts;
+  FindNonEmptyLineStarts(file.begin(), file.end(), &line_starts);
+  const int num_edges = line_starts.size() - 1;
+
   const Eigen::Matrix3d bundler_to_theia =
       Eigen::Vector3d(1.0, -1.0, -1.0).asDiagonal();
-  while (!ifs.eof()) {
-    TwoViewInfo info;
-    ViewId view_id1, view_id2;
-    ifs >> view_id1;
-    ifs >> view_id2;
-
+  std::vector<ViewIdPair> view_id_pairs(num_edges);
+  std::vector<TwoViewInfo> infos(num_edges);
+  // 1 if the edge is added, 0 if one of its views is not in the
+  // reconstruction and -1 if the line could not be parsed.
+  std::vector<int> edge_status(num_edges, 0);
+  ParallelFor(num_threads_, num_edges, [&](const int i) {
+    TextParser in(line_starts[i], line_starts[i + 1]);
+    TwoViewInfo& info = infos[i];
+    int view_id1, view_id2;
     // The rotation defines the camera 2 to camera 1 transformation in row-major
     // order). We want a camera 1 to camera 2 transformation so we read in the
     // transpose (i.e., column-major order).
     Eigen::Matrix3d rotation;
-    for (int i = 0; i < 3; i++) {
-      for (int j = 0; j < 3; j++) {
-        ifs >> rotation(i, j);
+    bool success = in.ReadInt(&view_id1) && in.ReadInt(&view_id2);
+    for (int j = 0; j < 3; j++) {
+      for (int k = 0; k < 3; k++) {
+        success = success && in.ReadDouble(&rotation(j, k));
       }
     }
+    // Read the position.
+    for (int j = 0; j < 3; j++) {
+      success = success && in.ReadDouble(&info.position_2[j]);
+    }
+    if (!success) {
+      edge_status[i] = -1;
+      return;
+    }
+
+    const View* view1 = reconstruction_->View(view_id1);
+    const View* view2 = reconstruction_->View(view_id2);
+    if (view1 == nullptr || view2 == nullptr) {
+      return;
+    }
+    view_id_pairs[i] = ViewIdPair(view_id1, view_id2);
 
     rotation = bundler_to_theia * rotation.transpose() * bundler_to_theia;
 
     // Convert to angle axis.
     ceres::RotationMatrixToAngleAxis(rotation.data(), info.rotation_2.data());
 
-    // Assign the position.
-    ifs >> info.position_2[0];
-    ifs >> info.position_2[1];
-    ifs >> info.position_2[2];
-
     info.position_2 = bundler_to_theia * info.position_2;
 
     // Add the focal lengths. If they are known from EXIF, add that value
     // otherwise add a focal length guess correspdonding to a median viewing
     // angle.
-    const CameraIntrinsicsPrior prior1 =
-        reconstruction_->View(view_id1)->CameraIntrinsicsPrior();
-    const CameraIntrinsicsPrior prior2 =
-        reconstruction_->View(view_id2)->CameraIntrinsicsPrior();
+    const CameraIntrinsicsPrior& prior1 = view1->CameraIntrinsicsPrior();
+    const CameraIntrinsicsPrior& prior2 = view2->CameraIntrinsicsPrior();
     if (prior1.focal_length.is_set) {
       info.focal_length_1 = prior1.focal_length.value[0];
     } else {
@@ -364,11 +474,20 @@ bool Input1DSFM::ReadEGs() {
     // not have knowledge about the image sizes and therefore cannot compute the
     // visibility score using the VisibilityPyramid.
     info.visibility_score = common_tracks.size();
-
-    // Add the match to the output.
-    if (reconstruction_->View(view_id1) != nullptr &&
-        reconstruction_->View(view_id2) != nullptr) {
-      view_graph_->AddEdge(view_id1, view_id2, info);
+    edge_status[i] = 1;
+  });
+
+  // Add the matches to the output.
+  for (int i = 0; i < num_edges; i++) {
+    if (edge_status[i] < 0) {
+      LOG(ERROR) << "Invalid epipolar geometry at line "
+                 << LineNumber(file.begin(), line_starts[i]) << " of "
+                 << eg_filename;
+      return false;
+    }
+    if (edge_status[i] > 0) {
+      view_graph_->AddEdge(
+          view_id_pairs[i].first, view_id_pairs[i].second, infos[i]);
     }
   }
   return true;
@@ -377,10 +496,19 @@ bool Input1DSFM::ReadEGs() {
 bool Read1DSFM(const std::string& dataset_directory,
                Reconstruction* reconstruction,
                ViewGraph* view_graph) {
+  return Read1DSFM(dataset_directory, 1, reconstruction, view_graph);
+}
+
+bool Read1DSFM(const std::string& dataset_directory,
+               const int num_threads,
+               Reconstruction* reconstruction,
+               ViewGraph* view_graph) {
+  CHECK_GT(num_threads, 0);
   CHECK_NOTNULL(reconstruction);
   CHECK_NOTNULL(view_graph);
 
-  Input1DSFM input_reader(dataset_directory, reconstruction, view_graph);
+  Input1DSFM input_reader(
+      dataset_directory, num_threads, reconstruction, view_graph);
 
   LOG(INFO) << "Reading connected components.";
   std::unordered_set<int> valid_images;
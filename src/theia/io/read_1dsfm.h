@@ -68,6 +68,13 @@ bool Read1DSFM(const std::string& dataset_directory,
                Reconstruction* reconstruction,
                ViewGraph* view_graph);
 
+// Same as above, but the large files are parsed with the given number of
+// threads.
+bool Read1DSFM(const std::string& dataset_directory,
+               const int num_threads,
+               Reconstruction* reconstruction,
+               ViewGraph* view_graph);
+
 }  // namespace theia
 
 #endif  // THEIA_IO_READ_1DSFM_H_
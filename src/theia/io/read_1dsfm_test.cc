@@ -0,0 +1,156 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/io/read_1dsfm.h"
+
+#include <Eigen/Core>
+
+#include <fstream>  // NOLINT
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "theia/sfm/reconstruction.h"
+#include "theia/sfm/track.h"
+#include "theia/sfm/twoview_info.h"
+#include "theia/sfm/view.h"
+#include "theia/sfm/view_graph/view_graph.h"
+#include "theia/util/filesystem.h"
+
+namespace theia {
+
+namespace {
+
+const std::string dataset_directory =
+    THEIA_DATA_DIR + std::string("/io/read_1dsfm_test");
+
+void WriteFile(const std::string& filename, const std::string& contents) {
+  std::ofstream ofs((dataset_directory + "/" + filename).c_str());
+  ofs << contents;
+}
+
+// Writes a dataset with three images where the last image is not part of the
+// connected component.
+void WriteDataset() {
+  if (!DirectoryExists(dataset_directory)) {
+    CHECK(CreateNewDirectory(dataset_directory));
+  }
+  WriteFile("cc.txt", "0\n1\n");
+  WriteFile("list.txt",
+            "images/a.jpg 0 1000.0\n"
+            "images/b.jpg\n"
+            "images/c.jpg 0 900.0\n");
+  WriteFile("coords.txt",
+            "#index = 0, name = a.jpg, keys = 2, px = 320.0, py = 240.0, "
+            "focal = 1000.0\n"
+            "0 10.5 20.5 0 0 255 0 0\n"
+            "1 30 40 0 0 0 255 0\n"
+            "#index = 1, name = b.jpg, keys = 2, px = 320.0, py = 240.0, "
+            "focal = 0.0\n"
+            "0 11 21 0 0 255 0 0\n"
+            "1 31 41 0 0 0 255 0\n"
+            "#index = 2, name = c.jpg, keys = 1, px = 320.0, py = 240.0, "
+            "focal = 900.0\n"
+            "0 1 1 0 0 0 0 255\n");
+  // The empty track cannot be added to the reconstruction and is skipped.
+  WriteFile("tracks.txt",
+            "3\n"
+            "2 0 0 1 0\n"
+            "0\n"
+            "2 0 1 1 1\n");
+  WriteFile("EGs.txt",
+            "0 1 1 0 0 0 1 0 0 0 1 1 0 0\n"
+            "0 2 1 0 0 0 1 0 0 0 1 1 0 0\n");
+}
+
+void ReadAndCheckDataset(const int num_threads) {
+  Reconstruction reconstruction;
+  ViewGraph view_graph;
+  EXPECT_TRUE(Read1DSFM(
+      dataset_directory, num_threads, &reconstruction, &view_graph));
+
+  EXPECT_EQ(reconstruction.NumViews(), 2);
+  const View* view0 = reconstruction.View(0);
+  const View* view1 = reconstruction.View(1);
+  ASSERT_NE(view0, nullptr);
+  ASSERT_NE(view1, nullptr);
+  EXPECT_EQ(view0->Name(), "a.jpg");
+  EXPECT_TRUE(view0->CameraIntrinsicsPrior().focal_length.is_set);
+  EXPECT_EQ(view0->CameraIntrinsicsPrior().focal_length.value[0], 1000.0);
+  EXPECT_FALSE(view1->CameraIntrinsicsPrior().focal_length.is_set);
+  EXPECT_EQ(view1->CameraIntrinsicsPrior().principal_point.value[0], 320.0);
+
+  ASSERT_EQ(reconstruction.NumTracks(), 2);
+  const TrackId track_id = view0->TrackIds().front();
+  const Feature* feature = view0->GetFeature(track_id);
+  const Track* track = reconstruction.Track(track_id);
+  const Eigen::Vector3i color = track->Color().cast<int>();
+  if (feature->x() == 10.5) {
+    EXPECT_EQ(feature->y(), 20.5);
+    EXPECT_EQ(color, Eigen::Vector3i(255, 0, 0));
+  } else {
+    EXPECT_EQ(feature->x(), 30.0);
+    EXPECT_EQ(color, Eigen::Vector3i(0, 255, 0));
+  }
+
+  // The second epipolar geometry refers to an image outside of the connected
+  // component.
+  EXPECT_EQ(view_graph.NumEdges(), 1);
+  const TwoViewInfo* info = view_graph.GetEdge(0, 1);
+  ASSERT_NE(info, nullptr);
+  EXPECT_EQ(info->num_verified_matches, 2);
+  EXPECT_EQ(info->focal_length_1, 1000.0);
+  EXPECT_DOUBLE_EQ(info->focal_length_2, 1.2 * 320.0);
+  EXPECT_EQ(info->position_2, Eigen::Vector3d(1.0, 0.0, 0.0));
+  EXPECT_LT(info->rotation_2.norm(), 1e-12);
+}
+
+}  // namespace
+
+TEST(Read1DSFM, ReadsSmallDataset) {
+  WriteDataset();
+  ReadAndCheckDataset(1);
+}
+
+TEST(Read1DSFM, MultithreadedReadMatchesSingleThreaded) {
+  WriteDataset();
+  ReadAndCheckDataset(4);
+}
+
+TEST(Read1DSFM, FailsOnMissingFiles) {
+  Reconstruction reconstruction;
+  ViewGraph view_graph;
+  EXPECT_FALSE(Read1DSFM(dataset_directory + "/does_not_exist",
+                         &reconstruction,
+                         &view_graph));
+}
+
+}  // namespace theia
@@ -150,7 +150,7 @@ int AddTracksToReconstruction(const BundlerFileReader& reader,
   const int num_points = reader.NumPoints();
   const std::vector<BundlerPoint>& points = reader.points();
   for (int i = 0; i < num_points; i++) {
-    const BundlerPoint point = points[i];
+    const BundlerPoint& point = points[i];
     const Eigen::Vector3d& position = point.position;
     const Eigen::Vector3d& color = point.color;
     const int num_views = point.view_list.size();
@@ -261,6 +261,8 @@ bool ReadBundlerFiles(const std::string& lists_file,
   }
 
   // Populate views in the reconstruction.
+  reconstruction->Reserve(bundler_file_reader.NumListEntries(),
+                          bundler_file_reader.NumPoints());
   CHECK(AddViewsToReconstruction(bundler_file_reader,
                                  CHECK_NOTNULL(reconstruction)));
 
@@ -0,0 +1,196 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/io/read_bundler_files.h"
+
+#include <Eigen/Core>
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "theia/io/bundler_file_reader.h"
+#include "theia/io/write_bundler_files.h"
+#include "theia/sfm/camera/camera.h"
+#include "theia/sfm/reconstruction.h"
+#include "theia/sfm/track.h"
+#include "theia/sfm/view.h"
+#include "theia/util/filesystem.h"
+#include "theia/util/map_util.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+namespace {
+
+static const int kNumViews = 4;
+static const int kNumTracks = 50;
+static const double kTolerance = 1e-6;
+
+// Creates an estimated reconstruction of pinhole cameras without a principal
+// point, as Bundler files cannot store it.
+void CreateReconstruction(Reconstruction* reconstruction) {
+  RandomNumberGenerator rng(59);
+  for (int i = 0; i < kNumViews; i++) {
+    const ViewId view_id =
+        reconstruction->AddView("image" + std::to_string(i) + ".jpg", i);
+    View* view = reconstruction->MutableView(view_id);
+    view->SetEstimated(true);
+    Camera* camera = view->MutableCamera();
+    camera->SetFocalLength(rng.RandDouble(500.0, 1500.0));
+    camera->SetPrincipalPoint(0.0, 0.0);
+    camera->SetOrientationFromAngleAxis(rng.RandVector3d(-0.5, 0.5));
+    camera->SetPosition(rng.RandVector3d(-2.0, 2.0));
+  }
+
+  for (int i = 0; i < kNumTracks; i++) {
+    // Each track is seen by all views but the i-th view modulo kNumViews.
+    std::vector<std::pair<ViewId, Feature>> features;
+    for (int j = 0; j < kNumViews; j++) {
+      if (j != i % kNumViews) {
+        // Bundler stores integer keypoint positions.
+        features.emplace_back(
+            j, Feature(rng.RandInt(-500, 500), rng.RandInt(-500, 500)));
+      }
+    }
+    const TrackId track_id = reconstruction->AddTrack(features);
+    Track* track = reconstruction->MutableTrack(track_id);
+    track->SetEstimated(true);
+    *track->MutablePoint() = rng.RandVector3d(-5.0, 5.0).homogeneous();
+    *track->MutableColor() = Eigen::Matrix<uint8_t, 3, 1>(i, 2 * i, 3 * i);
+  }
+}
+
+}  // namespace
+
+TEST(ReadBundlerFiles, RoundTrip) {
+  Reconstruction expected;
+  CreateReconstruction(&expected);
+
+  std::string directory;
+  ASSERT_TRUE(CreateTemporaryDirectory("theia_bundler_", &directory));
+  const std::string lists_file = directory + "/list.txt";
+  const std::string bundle_file = directory + "/bundle.out";
+  ASSERT_TRUE(WriteBundlerFiles(expected, lists_file, bundle_file));
+
+  Reconstruction reconstruction;
+  ASSERT_TRUE(ReadBundlerFiles(lists_file, bundle_file, &reconstruction));
+  ASSERT_EQ(reconstruction.NumViews(), kNumViews);
+  ASSERT_EQ(reconstruction.NumTracks(), kNumTracks);
+
+  std::unordered_map<ViewId, ViewId> expected_to_read_view_id;
+  for (const ViewId view_id : expected.ViewIds()) {
+    const View* expected_view = expected.View(view_id);
+    const ViewId read_view_id =
+        reconstruction.ViewIdFromName(expected_view->Name());
+    ASSERT_NE(read_view_id, kInvalidViewId);
+    expected_to_read_view_id[view_id] = read_view_id;
+    const View* view = reconstruction.View(read_view_id);
+    EXPECT_TRUE(view->IsEstimated());
+    const Camera& expected_camera = expected_view->Camera();
+    const Camera& camera = view->Camera();
+    // The focal length is written with the default precision of the stream.
+    EXPECT_NEAR(camera.FocalLength(), expected_camera.FocalLength(), 1e-2);
+    EXPECT_LT((camera.GetOrientationAsRotationMatrix() -
+               expected_camera.GetOrientationAsRotationMatrix())
+                  .norm(),
+              kTolerance);
+    EXPECT_LT((camera.GetPosition() - expected_camera.GetPosition()).norm(),
+              kTolerance);
+  }
+
+  // Tracks may be written in any order, so they are matched by their unique
+  // color.
+  std::unordered_map<uint8_t, TrackId> expected_track_from_color;
+  for (const TrackId track_id : expected.TrackIds()) {
+    expected_track_from_color[expected.Track(track_id)->Color()[0]] = track_id;
+  }
+  for (const TrackId track_id : reconstruction.TrackIds()) {
+    const Track* track = reconstruction.Track(track_id);
+    const TrackId expected_track_id =
+        FindOrDie(expected_track_from_color, track->Color()[0]);
+    const Track* expected_track = expected.Track(expected_track_id);
+    EXPECT_TRUE(track->IsEstimated());
+    EXPECT_EQ(track->Color(), expected_track->Color());
+    EXPECT_LT((track->Point().hnormalized() -
+               expected_track->Point().hnormalized())
+                  .norm(),
+              kTolerance);
+    ASSERT_EQ(track->NumViews(), expected_track->NumViews());
+    for (const ViewId view_id : expected_track->ViewIds()) {
+      const ViewId read_view_id =
+          FindOrDie(expected_to_read_view_id, view_id);
+      const Feature* feature =
+          reconstruction.View(read_view_id)->GetFeature(track_id);
+      ASSERT_NE(feature, nullptr);
+      EXPECT_EQ(feature->point_,
+                expected.View(view_id)->GetFeature(expected_track_id)->point_);
+    }
+  }
+
+  EXPECT_TRUE(RemoveDirectory(directory));
+}
+
+TEST(BundlerFileReader, MultithreadedParseMatchesSingleThreaded) {
+  Reconstruction expected;
+  CreateReconstruction(&expected);
+
+  std::string directory;
+  ASSERT_TRUE(CreateTemporaryDirectory("theia_bundler_", &directory));
+  const std::string lists_file = directory + "/list.txt";
+  const std::string bundle_file = directory + "/bundle.out";
+  ASSERT_TRUE(WriteBundlerFiles(expected, lists_file, bundle_file));
+
+  BundlerFileReader reader(lists_file, bundle_file);
+  BundlerFileReader threaded_reader(lists_file, bundle_file, 4);
+  ASSERT_TRUE(reader.ParseBundleFile());
+  ASSERT_TRUE(threaded_reader.ParseBundleFile());
+  ASSERT_EQ(threaded_reader.NumPoints(), reader.NumPoints());
+  for (int i = 0; i < reader.NumPoints(); i++) {
+    const BundlerPoint& point = reader.points()[i];
+    const BundlerPoint& threaded_point = threaded_reader.points()[i];
+    EXPECT_EQ(threaded_point.position, point.position);
+    EXPECT_EQ(threaded_point.color, point.color);
+    ASSERT_EQ(threaded_point.view_list.size(), point.view_list.size());
+    for (int j = 0; j < point.view_list.size(); j++) {
+      EXPECT_EQ(threaded_point.view_list[j].camera_index,
+                point.view_list[j].camera_index);
+      EXPECT_EQ(threaded_point.view_list[j].kpt_x, point.view_list[j].kpt_x);
+      EXPECT_EQ(threaded_point.view_list[j].kpt_y, point.view_list[j].kpt_y);
+    }
+  }
+
+  EXPECT_TRUE(RemoveDirectory(directory));
+}
+
+}  // namespace theia
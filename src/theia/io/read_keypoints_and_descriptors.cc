@@ -49,6 +49,7 @@
 #include "theia/alignment/alignment.h"
 #include "theia/image/keypoint_detector/keypoint.h"
 #include "theia/io/eigen_serializable.h"
+#include "theia/io/feature_file.h"
 
 namespace theia {
 
@@ -59,6 +60,16 @@ bool ReadKeypointsAndDescriptors(const std::string& features_file,
   CHECK_NOTNULL(keypoints)->clear();
   CHECK_NOTNULL(descriptors)->clear();
 
+  if (IsFeatureFile(features_file)) {
+    FeatureFile feature_file;
+    if (!feature_file.Open(features_file)) {
+      return false;
+    }
+    feature_file.GetKeypoints(keypoints);
+    feature_file.GetDescriptors(descriptors);
+    return true;
+  }
+
   // Return false if the file cannot be opened.
   std::ifstream features_reader(features_file, std::ios::in | std::ios::binary);
   if (!features_reader.is_open()) {
@@ -73,4 +84,20 @@ bool ReadKeypointsAndDescriptors(const std::string& features_file,
   return true;
 }
 
+bool ReadKeypoints(const std::string& features_file,
+                   std::vector<Keypoint>* keypoints) {
+  CHECK_NOTNULL(keypoints)->clear();
+  if (IsFeatureFile(features_file)) {
+    FeatureFile feature_file;
+    if (!feature_file.Open(features_file)) {
+      return false;
+    }
+    feature_file.GetKeypoints(keypoints);
+    return true;
+  }
+
+  std::vector<Eigen::VectorXf> descriptors;
+  return ReadKeypointsAndDescriptors(features_file, keypoints, &descriptors);
+}
+
 }  // namespace theia
@@ -42,11 +42,18 @@
 namespace theia {
 class Keypoint;
 
-// Reads the features from a single file.
+// Reads the features from a single file. Both the columnar feature files
+// written by WriteFeatureFile and the cereal archives written by
+// WriteKeypointsAndDescriptors are supported.
 bool ReadKeypointsAndDescriptors(const std::string& features_file,
                                  std::vector<Keypoint>* keypoints,
                                  std::vector<Eigen::VectorXf>* descriptors);
 
+// Reads only the keypoints from a single file. For columnar feature files the
+// descriptor block is never read from disk.
+bool ReadKeypoints(const std::string& features_file,
+                   std::vector<Keypoint>* keypoints);
+
 }  // namespace theia
 
 #endif  // THEIA_IO_READ_KEYPOINTS_AND_DESCRIPTORS_H_
@@ -33,6 +33,7 @@
 // Author: Chris Sweeney (cmsweeney@cs.ucsb.edu)
 
 #include <Eigen/Core>
+#include <string>
 #include <vector>
 
 #include "theia/matching/brute_force_feature_matcher.h"
@@ -41,6 +42,7 @@
 #include "theia/matching/image_pair_match.h"
 #include "theia/matching/in_memory_features_and_matches_database.h"
 #include "theia/matching/keypoints_and_descriptors.h"
+#include "theia/util/random.h"
 
 #include "gtest/gtest.h"
 
@@ -180,4 +182,85 @@ TEST(BruteForceFeatureMatcherTest, SymmetricMatches) {
   EXPECT_EQ(database.NumMatches(), 1);
 }
 
+// Matches all pairs of a set of images with random descriptors.
+void MatchRandomImages(
+    const FeatureMatcherOptions& options,
+    InMemoryFeaturesAndMatchesDatabase* database,
+    std::vector<FeatureMatchingStageStatistics>* statistics) {
+  static const int kNumImages = 12;
+  RandomNumberGenerator rng(59);
+  std::vector<std::string> image_names;
+  for (int i = 0; i < kNumImages; i++) {
+    KeypointsAndDescriptors features;
+    for (int j = 0; j < kNumDescriptors; j++) {
+      features.keypoints.emplace_back(
+          rng.RandDouble(0, 100), rng.RandDouble(0, 100), Keypoint::OTHER);
+      VectorXf descriptor(kNumDescriptorDimensions);
+      rng.SetRandom(&descriptor);
+      features.descriptors.emplace_back(descriptor.normalized());
+    }
+    image_names.emplace_back(std::to_string(i));
+    database->PutFeatures(image_names.back(), features);
+  }
+
+  BruteForceFeatureMatcher matcher(options, database);
+  matcher.AddImages(image_names);
+  matcher.MatchImages();
+  *statistics = matcher.PipelineStatistics();
+}
+
+TEST(BruteForceFeatureMatcherTest, PipelinedMatching) {
+  FeatureMatcherOptions options;
+  options.min_num_feature_matches = 0;
+  options.keep_only_symmetric_matches = false;
+  options.use_lowes_ratio = false;
+  options.perform_geometric_verification = false;
+
+  InMemoryFeaturesAndMatchesDatabase serial_database;
+  std::vector<FeatureMatchingStageStatistics> serial_statistics;
+  MatchRandomImages(options, &serial_database, &serial_statistics);
+
+  // Use several threads per stage and small queues so that the stages block
+  // on each other. The matching and verification stages split num_threads.
+  options.num_threads = 6;
+  options.num_feature_loading_threads = 2;
+  options.feature_prefetch_capacity = 1;
+  options.verification_queue_capacity = 2;
+  options.match_write_batch_size = 5;
+  InMemoryFeaturesAndMatchesDatabase database;
+  std::vector<FeatureMatchingStageStatistics> statistics;
+  MatchRandomImages(options, &database, &statistics);
+
+  // All 66 image pairs match since every feature is matched to its nearest
+  // neighbor.
+  EXPECT_EQ(serial_database.NumMatches(), 66);
+  ASSERT_EQ(database.NumMatches(), serial_database.NumMatches());
+  for (const auto& image_names : serial_database.ImageNamesOfMatches()) {
+    const ImagePairMatch serial_match = serial_database.GetImagePairMatch(
+        image_names.first, image_names.second);
+    const ImagePairMatch match =
+        database.GetImagePairMatch(image_names.first, image_names.second);
+    ASSERT_EQ(match.correspondences.size(),
+              serial_match.correspondences.size());
+    for (int i = 0; i < match.correspondences.size(); i++) {
+      EXPECT_TRUE(match.correspondences[i] == serial_match.correspondences[i]);
+    }
+  }
+
+  ASSERT_EQ(statistics.size(), 4);
+  EXPECT_EQ(statistics[0].name, "load");
+  EXPECT_EQ(statistics[0].num_threads, 2);
+  EXPECT_EQ(statistics[1].num_threads, 3);
+  EXPECT_EQ(statistics[2].num_threads, 3);
+  EXPECT_EQ(statistics[3].num_threads, 1);
+  for (int i = 1; i < statistics.size(); i++) {
+    EXPECT_EQ(statistics[i].num_items, 66);
+    EXPECT_GE(statistics[i].max_input_queue_depth, 1);
+    EXPECT_LE(statistics[i].max_input_queue_depth,
+              statistics[i].input_queue_capacity);
+  }
+  EXPECT_EQ(statistics[1].input_queue_capacity, 1);
+  EXPECT_EQ(statistics[2].input_queue_capacity, 2);
+}
+
 }  // namespace theia
@@ -0,0 +1,159 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/matching/compact_image_pair_match.h"
+
+#include <glog/logging.h>
+
+#include <Eigen/Core>
+#include <string>
+#include <vector>
+
+#include "theia/image/keypoint_detector/keypoint.h"
+#include "theia/matching/feature_correspondence.h"
+#include "theia/matching/image_pair_match.h"
+#include "theia/sfm/feature.h"
+
+namespace theia {
+namespace {
+
+// The features of the correspondences are created from the keypoints with the
+// default covariance and without depth prior.
+inline Feature FeatureFromKeypoint(const Keypoint& keypoint) {
+  return Feature(keypoint.x(), keypoint.y());
+}
+
+// Returns true if the feature is restored exactly from the keypoint.
+bool IsFeatureOfKeypoint(const std::vector<Keypoint>& keypoints,
+                         const uint32_t index,
+                         const Feature& feature) {
+  if (index >= keypoints.size()) {
+    return false;
+  }
+  const Feature keypoint_feature = FeatureFromKeypoint(keypoints[index]);
+  return feature.point_ == keypoint_feature.point_ &&
+         feature.covariance_ == keypoint_feature.covariance_ &&
+         feature.depth_prior_ == keypoint_feature.depth_prior_ &&
+         feature.depth_prior_variance_ ==
+             keypoint_feature.depth_prior_variance_;
+}
+
+}  // namespace
+
+void CompactImagePairMatch::SetInliers(const std::vector<bool>& inliers) {
+  CHECK_EQ(inliers.size(), feature_indices.size());
+  inlier_mask.assign((inliers.size() + 63) / 64, 0);
+  for (int i = 0; i < inliers.size(); i++) {
+    if (inliers[i]) {
+      inlier_mask[i / 64] |= uint64_t(1) << (i % 64);
+    }
+  }
+}
+
+int CompactImagePairMatch::NumInliers() const {
+  if (inlier_mask.empty()) {
+    return feature_indices.size();
+  }
+
+  int num_inliers = 0;
+  for (int i = 0; i < feature_indices.size(); i++) {
+    if (IsInlier(i)) {
+      ++num_inliers;
+    }
+  }
+  return num_inliers;
+}
+
+bool CompressImagePairMatch(const ImagePairMatch& match,
+                            const uint32_t image_id1,
+                            const uint32_t image_id2,
+                            const std::vector<Keypoint>& keypoints1,
+                            const std::vector<Keypoint>& keypoints2,
+                            CompactImagePairMatch* compact_match) {
+  CHECK_NOTNULL(compact_match);
+  if (match.feature_indices.size() != match.correspondences.size()) {
+    return false;
+  }
+
+  for (int i = 0; i < match.correspondences.size(); i++) {
+    const FeatureIndexPair& feature_indices = match.feature_indices[i];
+    if (!IsFeatureOfKeypoint(keypoints1,
+                             feature_indices.first,
+                             match.correspondences[i].feature1) ||
+        !IsFeatureOfKeypoint(keypoints2,
+                             feature_indices.second,
+                             match.correspondences[i].feature2)) {
+      return false;
+    }
+  }
+
+  compact_match->image_id1 = image_id1;
+  compact_match->image_id2 = image_id2;
+  compact_match->twoview_info = match.twoview_info;
+  compact_match->feature_indices = match.feature_indices;
+  compact_match->inlier_mask.clear();
+  return true;
+}
+
+void DecompressImagePairMatch(const CompactImagePairMatch& compact_match,
+                              const std::string& image1,
+                              const std::string& image2,
+                              const std::vector<Keypoint>& keypoints1,
+                              const std::vector<Keypoint>& keypoints2,
+                              ImagePairMatch* match) {
+  CHECK_NOTNULL(match);
+  match->image1 = image1;
+  match->image2 = image2;
+  match->twoview_info = compact_match.twoview_info;
+
+  const int num_inliers = compact_match.NumInliers();
+  match->correspondences.clear();
+  match->correspondences.reserve(num_inliers);
+  match->feature_indices.clear();
+  match->feature_indices.reserve(num_inliers);
+  for (int i = 0; i < compact_match.feature_indices.size(); i++) {
+    if (!compact_match.IsInlier(i)) {
+      continue;
+    }
+
+    const FeatureIndexPair& feature_indices = compact_match.feature_indices[i];
+    CHECK_LT(feature_indices.first, keypoints1.size())
+        << "The keypoints of image " << image1 << " do not match the indices.";
+    CHECK_LT(feature_indices.second, keypoints2.size())
+        << "The keypoints of image " << image2 << " do not match the indices.";
+    match->correspondences.emplace_back(
+        FeatureFromKeypoint(keypoints1[feature_indices.first]),
+        FeatureFromKeypoint(keypoints2[feature_indices.second]));
+    match->feature_indices.emplace_back(feature_indices);
+  }
+}
+
+}  // namespace theia
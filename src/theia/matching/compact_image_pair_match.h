@@ -0,0 +1,112 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_MATCHING_COMPACT_IMAGE_PAIR_MATCH_H_
+#define THEIA_MATCHING_COMPACT_IMAGE_PAIR_MATCH_H_
+
+#include <cereal/access.hpp>
+#include <cereal/cereal.hpp>
+#include <cereal/types/utility.hpp>
+#include <cereal/types/vector.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "theia/image/keypoint_detector/keypoint.h"
+#include "theia/matching/image_pair_match.h"
+#include "theia/sfm/twoview_info.h"
+
+namespace theia {
+
+// A compact representation of an ImagePairMatch that is used to store matches
+// in the features and matches databases. Each match is a pair of feature
+// indices into the keypoints of the two images and the images are referred to
+// by integer ids assigned by the database. A FeatureCorrespondence takes 128
+// bytes while a pair of indices takes 8 bytes.
+struct CompactImagePairMatch {
+ public:
+  uint32_t image_id1 = 0;
+  uint32_t image_id2 = 0;
+
+  TwoViewInfo twoview_info;
+
+  std::vector<FeatureIndexPair> feature_indices;
+
+  // Optionally, one bit per match that is set if the match is an inlier, e.g.
+  // so that putative matches may be kept along with the verified matches. If
+  // empty, all matches are inliers.
+  std::vector<uint64_t> inlier_mask;
+
+  // Returns true if the i-th match is an inlier.
+  bool IsInlier(const int i) const {
+    return inlier_mask.empty() || ((inlier_mask[i / 64] >> (i % 64)) & 1) != 0;
+  }
+
+  // Sets the inlier mask from one flag per match.
+  void SetInliers(const std::vector<bool>& inliers);
+
+  int NumInliers() const;
+
+ private:
+  // Templated method for disk I/O with cereal. This method tells cereal which
+  // data members should be used when reading/writing to/from disk.
+  friend class cereal::access;
+  template <class Archive>
+  void serialize(Archive& ar, const std::uint32_t version) {  // NOLINT
+    ar(image_id1, image_id2, twoview_info, feature_indices, inlier_mask);
+  }
+};
+
+// Compresses the match if its correspondences are exactly the features that
+// FeatureMatcher creates from the keypoints referenced by
+// match.feature_indices, so that the correspondences can be restored without
+// loss. Otherwise false is returned and the match must be stored as is.
+bool CompressImagePairMatch(const ImagePairMatch& match,
+                            const uint32_t image_id1,
+                            const uint32_t image_id2,
+                            const std::vector<Keypoint>& keypoints1,
+                            const std::vector<Keypoint>& keypoints2,
+                            CompactImagePairMatch* compact_match);
+
+// Restores the inlier correspondences (and their feature indices) of the match
+// from the keypoints of the two images.
+void DecompressImagePairMatch(const CompactImagePairMatch& compact_match,
+                              const std::string& image1,
+                              const std::string& image2,
+                              const std::vector<Keypoint>& keypoints1,
+                              const std::vector<Keypoint>& keypoints2,
+                              ImagePairMatch* match);
+
+}  // namespace theia
+
+CEREAL_CLASS_VERSION(theia::CompactImagePairMatch, 0);
+
+#endif  // THEIA_MATCHING_COMPACT_IMAGE_PAIR_MATCH_H_
@@ -0,0 +1,209 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <string>
+#include <vector>
+
+#include "theia/image/keypoint_detector/keypoint.h"
+#include "theia/matching/compact_image_pair_match.h"
+#include "theia/matching/feature_correspondence.h"
+#include "theia/matching/image_pair_match.h"
+#include "theia/matching/in_memory_features_and_matches_database.h"
+#include "theia/matching/keypoints_and_descriptors.h"
+#include "theia/sfm/feature.h"
+#include "gtest/gtest.h"
+
+namespace theia {
+
+namespace {
+
+std::vector<Keypoint> CreateKeypoints(const int num_keypoints,
+                                      const double offset) {
+  std::vector<Keypoint> keypoints;
+  for (int i = 0; i < num_keypoints; i++) {
+    keypoints.emplace_back(offset + i, 2.0 * i, Keypoint::OTHER);
+  }
+  return keypoints;
+}
+
+KeypointsAndDescriptors CreateFeatures(const std::string& image_name,
+                                       const std::vector<Keypoint>& keypoints) {
+  KeypointsAndDescriptors features;
+  features.image_name = image_name;
+  features.keypoints = keypoints;
+  features.descriptors.resize(keypoints.size(), Eigen::VectorXf::Zero(4));
+  return features;
+}
+
+// Creates a match of the keypoints the same way FeatureMatcher does.
+ImagePairMatch CreateMatch(const std::vector<Keypoint>& keypoints1,
+                           const std::vector<Keypoint>& keypoints2,
+                           const std::vector<FeatureIndexPair>& indices) {
+  ImagePairMatch match;
+  match.image1 = "1.jpg";
+  match.image2 = "2.jpg";
+  match.twoview_info.num_verified_matches = indices.size();
+  match.feature_indices = indices;
+  for (const FeatureIndexPair& index : indices) {
+    match.correspondences.emplace_back(
+        Feature(keypoints1[index.first].x(), keypoints1[index.first].y()),
+        Feature(keypoints2[index.second].x(), keypoints2[index.second].y()));
+  }
+  return match;
+}
+
+void ExpectEqualMatches(const ImagePairMatch& expected,
+                        const ImagePairMatch& actual) {
+  EXPECT_EQ(expected.image1, actual.image1);
+  EXPECT_EQ(expected.image2, actual.image2);
+  EXPECT_EQ(expected.twoview_info.num_verified_matches,
+            actual.twoview_info.num_verified_matches);
+  EXPECT_EQ(expected.feature_indices, actual.feature_indices);
+  ASSERT_EQ(expected.correspondences.size(), actual.correspondences.size());
+  for (int i = 0; i < expected.correspondences.size(); i++) {
+    EXPECT_EQ(expected.correspondences[i], actual.correspondences[i]);
+  }
+}
+
+}  // namespace
+
+TEST(CompactImagePairMatch, CompressAndDecompress) {
+  const std::vector<Keypoint> keypoints1 = CreateKeypoints(10, 0.0);
+  const std::vector<Keypoint> keypoints2 = CreateKeypoints(8, 100.0);
+  const ImagePairMatch match =
+      CreateMatch(keypoints1, keypoints2, {{0, 7}, {3, 2}, {9, 0}});
+
+  CompactImagePairMatch compact_match;
+  EXPECT_TRUE(CompressImagePairMatch(
+      match, 4, 5, keypoints1, keypoints2, &compact_match));
+  EXPECT_EQ(compact_match.image_id1, 4);
+  EXPECT_EQ(compact_match.image_id2, 5);
+  EXPECT_EQ(compact_match.NumInliers(), 3);
+
+  ImagePairMatch decompressed_match;
+  DecompressImagePairMatch(compact_match,
+                           match.image1,
+                           match.image2,
+                           keypoints1,
+                           keypoints2,
+                           &decompressed_match);
+  ExpectEqualMatches(match, decompressed_match);
+}
+
+TEST(CompactImagePairMatch, InlierMask) {
+  const std::vector<Keypoint> keypoints = CreateKeypoints(100, 0.0);
+  std::vector<FeatureIndexPair> indices;
+  std::vector<bool> inliers;
+  for (int i = 0; i < keypoints.size(); i++) {
+    indices.emplace_back(i, keypoints.size() - 1 - i);
+    inliers.emplace_back(i % 3 == 0);
+  }
+  const ImagePairMatch match = CreateMatch(keypoints, keypoints, indices);
+
+  CompactImagePairMatch compact_match;
+  ASSERT_TRUE(CompressImagePairMatch(
+      match, 0, 1, keypoints, keypoints, &compact_match));
+  compact_match.SetInliers(inliers);
+  EXPECT_EQ(compact_match.NumInliers(), 34);
+
+  ImagePairMatch decompressed_match;
+  DecompressImagePairMatch(compact_match,
+                           match.image1,
+                           match.image2,
+                           keypoints,
+                           keypoints,
+                           &decompressed_match);
+  ASSERT_EQ(decompressed_match.correspondences.size(), 34);
+  for (int i = 0; i < decompressed_match.feature_indices.size(); i++) {
+    EXPECT_EQ(decompressed_match.feature_indices[i], indices[3 * i]);
+    EXPECT_EQ(decompressed_match.correspondences[i],
+              match.correspondences[3 * i]);
+  }
+}
+
+TEST(CompactImagePairMatch, MatchesThatCannotBeCompressed) {
+  const std::vector<Keypoint> keypoints = CreateKeypoints(10, 0.0);
+  CompactImagePairMatch compact_match;
+
+  // No feature indices.
+  ImagePairMatch match = CreateMatch(keypoints, keypoints, {{1, 2}, {3, 4}});
+  match.feature_indices.clear();
+  EXPECT_FALSE(CompressImagePairMatch(
+      match, 0, 1, keypoints, keypoints, &compact_match));
+
+  // A feature with a depth prior cannot be restored from the keypoint.
+  match = CreateMatch(keypoints, keypoints, {{1, 2}, {3, 4}});
+  match.correspondences[1].feature2.depth_prior_ = 3.0;
+  EXPECT_FALSE(CompressImagePairMatch(
+      match, 0, 1, keypoints, keypoints, &compact_match));
+
+  // Indices out of range of the keypoints.
+  match = CreateMatch(keypoints, keypoints, {{1, 2}, {3, 4}});
+  EXPECT_FALSE(CompressImagePairMatch(
+      match, 0, 1, keypoints, CreateKeypoints(4, 0.0), &compact_match));
+}
+
+TEST(CompactImagePairMatch, InMemoryDatabase) {
+  const std::vector<Keypoint> keypoints1 = CreateKeypoints(10, 0.0);
+  const std::vector<Keypoint> keypoints2 = CreateKeypoints(8, 100.0);
+  const ImagePairMatch match =
+      CreateMatch(keypoints1, keypoints2, {{0, 7}, {3, 2}, {9, 0}});
+
+  InMemoryFeaturesAndMatchesDatabase database;
+  database.PutFeatures("1.jpg", CreateFeatures("1.jpg", keypoints1));
+  database.PutFeatures("2.jpg", CreateFeatures("2.jpg", keypoints2));
+  database.PutImagePairMatch("1.jpg", "2.jpg", match);
+  EXPECT_EQ(database.NumMatches(), 1);
+  ExpectEqualMatches(match, database.GetImagePairMatch("1.jpg", "2.jpg"));
+
+  // A match without feature indices is stored as is.
+  ImagePairMatch uncompressed_match = CreateMatch(keypoints1, keypoints1, {});
+  uncompressed_match.image1 = "1.jpg";
+  uncompressed_match.image2 = "3.jpg";
+  uncompressed_match.correspondences.emplace_back(Feature(0.5, 0.5),
+                                                  Feature(1.5, 1.5));
+  database.PutImagePairMatch("1.jpg", "3.jpg", uncompressed_match);
+  EXPECT_EQ(database.NumMatches(), 2);
+  ExpectEqualMatches(uncompressed_match,
+                     database.GetImagePairMatch("1.jpg", "3.jpg"));
+
+  // Replacing the features of an image keeps the correspondences that were
+  // created from the old keypoints.
+  database.PutFeatures("2.jpg",
+                       CreateFeatures("2.jpg", CreateKeypoints(8, 500.0)));
+  EXPECT_EQ(database.NumMatches(), 2);
+  ExpectEqualMatches(match, database.GetImagePairMatch("1.jpg", "2.jpg"));
+
+  database.RemoveAllMatches();
+  EXPECT_EQ(database.NumMatches(), 0);
+}
+
+}  // namespace theia
@@ -37,9 +37,13 @@
 #include <glog/logging.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <limits>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -54,8 +58,10 @@
 #include "theia/sfm/camera_intrinsics_prior.h"
 #include "theia/sfm/two_view_match_geometric_verification.h"
 
+#include "theia/util/bounded_queue.h"
 #include "theia/util/map_util.h"
-#include "theia/util/threadpool.h"
+#include "theia/util/random.h"
+#include "theia/util/stringprintf.h"
 #include "theia/util/util.h"
 
 namespace theia {
@@ -77,6 +83,57 @@ void SelectAllPairs(
 }
 }  // namespace
 
+// The features of the images of a block of consecutive image pairs.
+struct FeatureMatcher::FeatureBlock {
+  int block_index = 0;
+  int start_index = 0;
+  int end_index = 0;
+  std::unordered_map<std::string, int> feature_index;
+  std::vector<KeypointsAndDescriptors> features;
+
+  const KeypointsAndDescriptors& Features(const std::string& image_name) const {
+    return features[FindOrDie(feature_index, image_name)];
+  }
+};
+
+// The putative matches of an image pair waiting for geometric verification.
+// The pair shares the features of its block, which are released once all pairs
+// of the block have been verified.
+struct FeatureMatcher::PutativeImagePairMatch {
+  int pair_index = 0;
+  std::shared_ptr<const FeatureBlock> block;
+  std::vector<IndexedFeatureMatch> matches;
+  std::shared_ptr<RandomNumberGenerator> rng;
+};
+
+// The state shared by the stages of the matching pipeline.
+struct FeatureMatcher::Pipeline {
+  Pipeline(const int num_blocks,
+           const int interval_step,
+           const int feature_prefetch_capacity,
+           const int verification_queue_capacity,
+           const int write_queue_capacity)
+      : num_blocks(num_blocks),
+        interval_step(interval_step),
+        feature_blocks(feature_prefetch_capacity),
+        putative_matches(verification_queue_capacity),
+        verified_matches(write_queue_capacity) {}
+
+  const int num_blocks;
+  const int interval_step;
+
+  // The next block of image pairs to load.
+  std::atomic<int> next_block{0};
+
+  // The random number generator stream of each block, or null if the
+  // verification options do not provide a random number generator.
+  std::vector<std::shared_ptr<RandomNumberGenerator>> block_rngs;
+
+  BoundedQueue<std::shared_ptr<const FeatureBlock>> feature_blocks;
+  BoundedQueue<PutativeImagePairMatch> putative_matches;
+  BoundedQueue<ImagePairMatch> verified_matches;
+};
+
 FeatureMatcher::~FeatureMatcher() {}
 
 FeatureMatcher::FeatureMatcher(
@@ -108,60 +165,269 @@ void FeatureMatcher::MatchImages() {
     SelectAllPairs(image_names_, &pairs_to_match_);
   }
 
-  // Add workers for matching. It is more efficient to let each thread compute
-  // multiple matches at a time than add each matching task to the pool. This is
-  // sort of like OpenMP's dynamic schedule in that it is able to balance
-  // threads fairly efficiently.
+  pipeline_statistics_.clear();
   const int num_matches = pairs_to_match_.size();
-  const int num_threads =
-      std::min(options_.num_threads, static_cast<int>(num_matches));
-  std::unique_ptr<ThreadPool> pool(new ThreadPool(num_threads));
+  if (num_matches == 0) {
+    return;
+  }
+
+  // Image pairs are loaded and matched in blocks. Threads take the next block
+  // as soon as they finish one, which balances the load like OpenMP's dynamic
+  // schedule.
+  //
+  // Matching and verification are the compute-bound stages, so unless they are
+  // set explicitly they share num_threads between them.
+  const int num_threads = std::max(options_.num_threads, 1);
+  int requested_matching_threads = options_.num_matching_threads;
+  int requested_verification_threads = options_.num_verification_threads;
+  if (requested_matching_threads <= 0 && requested_verification_threads <= 0) {
+    requested_matching_threads = (num_threads + 1) / 2;
+    requested_verification_threads = num_threads - requested_matching_threads;
+  } else if (requested_matching_threads <= 0) {
+    requested_matching_threads = num_threads - requested_verification_threads;
+  } else if (requested_verification_threads <= 0) {
+    requested_verification_threads = num_threads - requested_matching_threads;
+  }
+  const int num_matching_threads =
+      std::max(std::min(requested_matching_threads, num_matches), 1);
   const int interval_step =
-      std::min(this->kMaxThreadingStepSize_, num_matches / num_threads);
-  for (int i = 0; i < num_matches; i += interval_step) {
-    const int end_interval = std::min(num_matches, i + interval_step);
-    pool->Add(&FeatureMatcher::MatchAndVerifyImagePairs, this, i, end_interval);
+      std::max(std::min(this->kMaxThreadingStepSize_,
+                        num_matches / num_matching_threads),
+               1);
+  const int num_blocks = (num_matches + interval_step - 1) / interval_step;
+  const int num_loading_threads = std::max(
+      std::min(options_.num_feature_loading_threads, num_blocks), 1);
+  const int num_verification_threads =
+      std::max(std::min(requested_verification_threads, num_matches), 1);
+  const int write_batch_size = std::max(options_.match_write_batch_size, 1);
+
+  Pipeline pipeline(num_blocks,
+                    interval_step,
+                    std::max(options_.feature_prefetch_capacity, 1),
+                    std::max(options_.verification_queue_capacity, 1),
+                    2 * write_batch_size);
+
+  // Random number generators are not thread-safe, so each block of image
+  // pairs gets a stream split off the supplied generator. The matching stage
+  // splits the stream of a block once per image pair in order, which makes
+  // the verification of every pair independent of the thread scheduling.
+  const std::shared_ptr<RandomNumberGenerator>& rng =
+      options_.geometric_verification_options.estimate_twoview_info_options.rng;
+  pipeline.block_rngs.resize(num_blocks);
+  if (rng.get() != nullptr) {
+    for (int i = 0; i < num_blocks; i++) {
+      pipeline.block_rngs[i] =
+          std::make_shared<RandomNumberGenerator>(rng->Split());
+    }
   }
-  // Wait for all threads to finish.
-  pool.reset(nullptr);
+
+  // The stages block on the queues between them, so each stage runs on its
+  // own threads rather than on tasks of the shared TaskScheduler where blocked
+  // stages could starve the stages they are waiting for.
+  std::vector<FeatureMatchingStageStatistics> statistics(4);
+  std::mutex statistics_mutex;
+  const auto pipeline_start = std::chrono::steady_clock::now();
+  const auto start_stage = [&](const int stage,
+                               const std::string& name,
+                               const int num_stage_threads,
+                               int (FeatureMatcher::*run)(Pipeline*)) {
+    statistics[stage].name = name;
+    statistics[stage].num_threads = num_stage_threads;
+    std::vector<std::thread> threads;
+    threads.reserve(num_stage_threads);
+    for (int i = 0; i < num_stage_threads; i++) {
+      threads.emplace_back([&, stage, run]() {
+        const auto thread_start = std::chrono::steady_clock::now();
+        const int num_items = (this->*run)(&pipeline);
+        const auto thread_end = std::chrono::steady_clock::now();
+
+        std::lock_guard<std::mutex> lock(statistics_mutex);
+        FeatureMatchingStageStatistics& stage_statistics = statistics[stage];
+        stage_statistics.num_items += num_items;
+        stage_statistics.busy_time_in_seconds +=
+            std::chrono::duration<double>(thread_end - thread_start).count();
+        stage_statistics.elapsed_time_in_seconds =
+            std::max(stage_statistics.elapsed_time_in_seconds,
+                     std::chrono::duration<double>(thread_end - pipeline_start)
+                         .count());
+      });
+    }
+    return threads;
+  };
+  const auto join = [](std::vector<std::thread>* threads) {
+    for (std::thread& thread : *threads) {
+      thread.join();
+    }
+  };
+
+  std::vector<std::thread> loaders = start_stage(
+      0, "load", num_loading_threads, &FeatureMatcher::LoadFeatures);
+  std::vector<std::thread> matchers = start_stage(
+      1, "match", num_matching_threads, &FeatureMatcher::MatchFeatures);
+  std::vector<std::thread> verifiers = start_stage(
+      2, "verify", num_verification_threads, &FeatureMatcher::VerifyMatches);
+  std::vector<std::thread> writers =
+      start_stage(3, "write", 1, &FeatureMatcher::WriteMatches);
+
+  // A queue is closed once all of its producers are done so that the
+  // consumers stop after draining it.
+  join(&loaders);
+  pipeline.feature_blocks.Close();
+  join(&matchers);
+  pipeline.putative_matches.Close();
+  join(&verifiers);
+  pipeline.verified_matches.Close();
+  join(&writers);
+
+  // Attribute the time spent waiting on each queue to the stages on either
+  // side of it.
+  const auto set_queue_statistics = [&](const auto& queue,
+                                        const int producer_stage) {
+    FeatureMatchingStageStatistics& producer = statistics[producer_stage];
+    FeatureMatchingStageStatistics& consumer = statistics[producer_stage + 1];
+    producer.output_wait_time_in_seconds = queue.PushWaitTimeInSeconds();
+    consumer.input_wait_time_in_seconds = queue.PopWaitTimeInSeconds();
+    consumer.input_queue_capacity = queue.Capacity();
+    consumer.max_input_queue_depth = queue.MaxDepth();
+    consumer.mean_input_queue_depth = queue.MeanDepth();
+  };
+  set_queue_statistics(pipeline.feature_blocks, 0);
+  set_queue_statistics(pipeline.putative_matches, 1);
+  set_queue_statistics(pipeline.verified_matches, 2);
+
+  for (FeatureMatchingStageStatistics& stage_statistics : statistics) {
+    stage_statistics.busy_time_in_seconds = std::max(
+        stage_statistics.busy_time_in_seconds -
+            stage_statistics.input_wait_time_in_seconds -
+            stage_statistics.output_wait_time_in_seconds,
+        0.0);
+    LOG(INFO) << StringPrintf(
+        "Matching stage %-6s: %2d threads, %7d items in %8.3fs "
+        "(%9.1f items/s), busy %8.3fs, waited %8.3fs for input and %8.3fs "
+        "for output, queue depth mean %5.1f max %4d of %4d.",
+        stage_statistics.name.c_str(),
+        stage_statistics.num_threads,
+        stage_statistics.num_items,
+        stage_statistics.elapsed_time_in_seconds,
+        stage_statistics.num_items /
+            std::max(stage_statistics.elapsed_time_in_seconds, 1e-9),
+        stage_statistics.busy_time_in_seconds,
+        stage_statistics.input_wait_time_in_seconds,
+        stage_statistics.output_wait_time_in_seconds,
+        stage_statistics.mean_input_queue_depth,
+        stage_statistics.max_input_queue_depth,
+        stage_statistics.input_queue_capacity);
+  }
+  pipeline_statistics_ = std::move(statistics);
 
   VLOG(1) << "Matched " << feature_and_matches_db_->NumMatches()
           << " image pairs out of " << num_matches
           << " pairs selected for matching.";
 }
 
-void FeatureMatcher::MatchAndVerifyImagePairs(const int start_index,
-                                              const int end_index) {
-  for (int i = start_index; i < end_index; i++) {
-    const std::string image1_name = pairs_to_match_[i].first;
-    const std::string image2_name = pairs_to_match_[i].second;
+int FeatureMatcher::LoadFeatures(Pipeline* pipeline) {
+  const int num_matches = pairs_to_match_.size();
+  int num_blocks_loaded = 0;
+  for (int i = pipeline->next_block++; i < pipeline->num_blocks;
+       i = pipeline->next_block++) {
+    std::shared_ptr<FeatureBlock> block = std::make_shared<FeatureBlock>();
+    block->block_index = i;
+    block->start_index = i * pipeline->interval_step;
+    block->end_index =
+        std::min(num_matches, block->start_index + pipeline->interval_step);
 
-    // Match the image pair. If the pair fails to match then continue to the
-    // next match.
-    ImagePairMatch image_pair_match;
-    image_pair_match.image1 = image1_name;
-    image_pair_match.image2 = image2_name;
+    // Fetch the features of all images in this block with a single request so
+    // that databases backed by storage may batch the lookups.
+    std::vector<std::string> image_names;
+    for (int j = block->start_index; j < block->end_index; j++) {
+      for (const std::string* image_name :
+           {&pairs_to_match_[j].first, &pairs_to_match_[j].second}) {
+        if (block->feature_index.emplace(*image_name, image_names.size())
+                .second) {
+          image_names.emplace_back(*image_name);
+        }
+      }
+    }
+    block->features =
+        feature_and_matches_db_->GetFeaturesForImages(image_names);
+
+    ++num_blocks_loaded;
+    pipeline->feature_blocks.Push(std::move(block));
+  }
+  return num_blocks_loaded;
+}
+
+int FeatureMatcher::MatchFeatures(Pipeline* pipeline) {
+  int num_pairs_matched = 0;
+  std::shared_ptr<const FeatureBlock> block;
+  while (pipeline->feature_blocks.Pop(&block)) {
+    RandomNumberGenerator* block_rng =
+        pipeline->block_rngs[block->block_index].get();
+    for (int i = block->start_index; i < block->end_index; i++) {
+      const std::string& image1_name = pairs_to_match_[i].first;
+      const std::string& image2_name = pairs_to_match_[i].second;
+      ++num_pairs_matched;
+
+      PutativeImagePairMatch putative_match;
+      putative_match.pair_index = i;
+      if (block_rng != nullptr) {
+        putative_match.rng =
+            std::make_shared<RandomNumberGenerator>(block_rng->Split());
+      }
+
+      // Compute the visual matches from feature descriptors. If the pair fails
+      // to match then continue to the next pair.
+      if (!MatchImagePair(block->Features(image1_name),
+                          block->Features(image2_name),
+                          &putative_match.matches)) {
+        VLOG(2)
+            << "Could not match a sufficient number of features between images "
+            << image1_name << " and " << image2_name;
+        continue;
+      }
+
+      putative_match.block = block;
+      pipeline->putative_matches.Push(std::move(putative_match));
+    }
+  }
+  return num_pairs_matched;
+}
+
+int FeatureMatcher::VerifyMatches(Pipeline* pipeline) {
+  // Each thread owns a copy of the options whose random number generator is
+  // replaced with the stream of the image pair being verified.
+  TwoViewMatchGeometricVerification::Options verification_options =
+      options_.geometric_verification_options;
 
-    // Get the keypoints and descriptors from the db.
+  int num_pairs_verified = 0;
+  PutativeImagePairMatch putative_match;
+  while (pipeline->putative_matches.Pop(&putative_match)) {
+    const std::string& image1_name =
+        pairs_to_match_[putative_match.pair_index].first;
+    const std::string& image2_name =
+        pairs_to_match_[putative_match.pair_index].second;
     const KeypointsAndDescriptors& features1 =
-        feature_and_matches_db_->GetFeatures(image1_name);
+        putative_match.block->Features(image1_name);
     const KeypointsAndDescriptors& features2 =
-        feature_and_matches_db_->GetFeatures(image2_name);
-
-    // Compute the visual matches from feature descriptors.
-    std::vector<IndexedFeatureMatch> putative_matches;
-    if (!MatchImagePair(features1, features2, &putative_matches)) {
-      VLOG(2)
-          << "Could not match a sufficient number of features between images "
-          << image1_name << " and " << image2_name;
-      continue;
-    }
+        putative_match.block->Features(image2_name);
+    const std::vector<IndexedFeatureMatch>& putative_matches =
+        putative_match.matches;
+    ++num_pairs_verified;
+
+    ImagePairMatch image_pair_match;
+    image_pair_match.image1 = image1_name;
+    image_pair_match.image2 = image2_name;
 
     // Perform geometric verification if applicable.
     if (options_.perform_geometric_verification) {
+      verification_options.estimate_twoview_info_options.rng =
+          std::move(putative_match.rng);
       // If geometric verification fails, do not add the match to the output.
-      if (!GeometricVerification(
-              features1, features2, putative_matches, &image_pair_match)) {
+      if (!GeometricVerification(verification_options,
+                                 features1,
+                                 features2,
+                                 putative_matches,
+                                 &image_pair_match)) {
         VLOG(2) << "Geometric verification between images " << image1_name
                 << " and " << image2_name << " failed.";
         continue;
@@ -170,6 +436,7 @@ void FeatureMatcher::MatchAndVerifyImagePairs(const int start_index,
       // If no geometric verification is performed then the putative matches are
       // output.
       image_pair_match.correspondences.reserve(putative_matches.size());
+      image_pair_match.feature_indices.reserve(putative_matches.size());
       for (int i = 0; i < putative_matches.size(); i++) {
         const Keypoint& keypoint1 =
             features1.keypoints[putative_matches[i].feature1_ind];
@@ -178,6 +445,8 @@ void FeatureMatcher::MatchAndVerifyImagePairs(const int start_index,
         image_pair_match.correspondences.emplace_back(
             Feature(keypoint1.x(), keypoint1.y()),
             Feature(keypoint2.x(), keypoint2.y()));
+        image_pair_match.feature_indices.emplace_back(
+            putative_matches[i].feature1_ind, putative_matches[i].feature2_ind);
       }
     }
 
@@ -189,13 +458,39 @@ void FeatureMatcher::MatchAndVerifyImagePairs(const int start_index,
             << " homography matches out of " << putative_matches.size()
             << " putative matches.";
 
-    // This operation is thread safe.
-    feature_and_matches_db_->PutImagePairMatch(
-        image1_name, image2_name, image_pair_match);
+    // Release the features of the block as soon as possible.
+    putative_match.block.reset();
+    pipeline->verified_matches.Push(std::move(image_pair_match));
+  }
+  return num_pairs_verified;
+}
+
+int FeatureMatcher::WriteMatches(Pipeline* pipeline) {
+  const int batch_size = std::max(options_.match_write_batch_size, 1);
+  int num_pairs_written = 0;
+  std::vector<ImagePairMatch> batch;
+  batch.reserve(batch_size);
+  const auto write_batch = [&]() {
+    feature_and_matches_db_->PutImagePairMatches(batch);
+    num_pairs_written += batch.size();
+    batch.clear();
+  };
+
+  ImagePairMatch image_pair_match;
+  while (pipeline->verified_matches.Pop(&image_pair_match)) {
+    batch.emplace_back(std::move(image_pair_match));
+    if (batch.size() >= batch_size) {
+      write_batch();
+    }
+  }
+  if (!batch.empty()) {
+    write_batch();
   }
+  return num_pairs_written;
 }
 
 bool FeatureMatcher::GeometricVerification(
+    const TwoViewMatchGeometricVerification::Options& verification_options,
     const KeypointsAndDescriptors& features1,
     const KeypointsAndDescriptors& features2,
     const std::vector<IndexedFeatureMatch>& putative_matches,
@@ -215,16 +510,29 @@ bool FeatureMatcher::GeometricVerification(
   }
 
   TwoViewMatchGeometricVerification geometric_verification(
-      options_.geometric_verification_options,
+      verification_options,
       intrinsics1,
       intrinsics2,
       features1,
       features2,
       putative_matches);
 
-  // Return whether geometric verification succeeds.
-  return geometric_verification.VerifyMatches(
-      &image_pair_match->correspondences, &image_pair_match->twoview_info);
+  if (!geometric_verification.VerifyMatches(
+          &image_pair_match->correspondences,
+          &image_pair_match->twoview_info)) {
+    return false;
+  }
+
+  // Keep the feature indices so that the databases can store the matches
+  // compactly.
+  const std::vector<IndexedFeatureMatch>& verified_matches =
+      geometric_verification.VerifiedMatchIndices();
+  image_pair_match->feature_indices.reserve(verified_matches.size());
+  for (const IndexedFeatureMatch& verified_match : verified_matches) {
+    image_pair_match->feature_indices.emplace_back(
+        verified_match.feature1_ind, verified_match.feature2_ind);
+  }
+  return true;
 }
 
 }  // namespace theia
@@ -47,12 +47,41 @@
 #include "theia/util/util.h"
 
 namespace theia {
+template <typename T>
+class BoundedQueue;
 class FeaturesAndMatchesDatabase;
 class Keypoint;
 struct ImagePairMatch;
 struct IndexedFeatureMatche;
 struct KeypointsAndDescriptors;
 
+// Throughput and queue statistics of one stage of the matching pipeline, see
+// FeatureMatcherOptions.
+struct FeatureMatchingStageStatistics {
+  std::string name;
+  int num_threads = 0;
+
+  // The number of items processed by the stage: blocks of image pairs for the
+  // feature loading stage and image pairs for all other stages.
+  int num_items = 0;
+
+  // Time from the start of the pipeline until the last thread of the stage
+  // finished, and the time the threads of the stage spent working. The time
+  // spent waiting on the queues is not part of the busy time.
+  double elapsed_time_in_seconds = 0.0;
+  double busy_time_in_seconds = 0.0;
+
+  // Total time the threads of the stage waited for input and for room in the
+  // output queue. Long output waits mean that a later stage is the bottleneck.
+  double input_wait_time_in_seconds = 0.0;
+  double output_wait_time_in_seconds = 0.0;
+
+  // Depth of the input queue of the stage, sampled whenever an item was added.
+  int input_queue_capacity = 0;
+  int max_input_queue_depth = 0;
+  double mean_input_queue_depth = 0.0;
+};
+
 // Class for matching features between images. The intended use for these
 // classes is for matching photos in image collections, so all pairwise matches
 // are computed. Matching with geometric verification is also possible. Typical
@@ -104,6 +133,13 @@ class FeatureMatcher {
   virtual void SetImagePairsToMatch(
       const std::vector<std::pair<std::string, std::string> >& pairs_to_match);
 
+  // Statistics of the stages of the matching pipeline from the last call to
+  // MatchImages, in pipeline order.
+  const std::vector<FeatureMatchingStageStatistics>& PipelineStatistics()
+      const {
+    return pipeline_statistics_;
+  }
+
  protected:
   // NOTE: This method should be overridden in the subclass implementations!
   // Returns true if the image pair is a valid match.
@@ -112,26 +148,20 @@ class FeatureMatcher {
       const KeypointsAndDescriptors& features2,
       std::vector<IndexedFeatureMatch>* matched_features) = 0;
 
-  // Performs matching and geometric verification (if desired) on the
-  // pairs_to_match_ between the specified indices. This is useful for thread
-  // pooling.
-  virtual void MatchAndVerifyImagePairs(const int start_index,
-                                        const int end_index);
-
   // Performs geometric verification. By making this a virtual method, derived
   // classes may implement custom verification methods (e.g., if rotations are
   // known then custom solvers can be used to solve for only the relative
   // translations).
   virtual bool GeometricVerification(
+      const TwoViewMatchGeometricVerification::Options& verification_options,
       const KeypointsAndDescriptors& features1,
       const KeypointsAndDescriptors& features2,
       const std::vector<IndexedFeatureMatch>& putative_matches,
       ImagePairMatch* image_pair_match);
 
-  // Each Threadpool worker will perform matching on this many image pairs.  It
-  // is more efficient to let each thread compute multiple matches at a time
-  // than add each matching task to the pool. This is sort of like OpenMP's
-  // dynamic schedule in that it is able to balance threads fairly efficiently.
+  // Features are loaded and matched in blocks of up to this many image pairs.
+  // It is more efficient to fetch the features of multiple pairs with one
+  // database request and to let each thread match multiple pairs at a time.
   const int kMaxThreadingStepSize_ = 20;
 
   FeatureMatcherOptions options_;
@@ -146,6 +176,20 @@ class FeatureMatcher {
   std::vector<std::pair<std::string, std::string> > pairs_to_match_;
 
  private:
+  struct FeatureBlock;
+  struct PutativeImagePairMatch;
+  struct Pipeline;
+
+  // The stages of the matching pipeline. Each call runs one thread of the
+  // stage until its input is exhausted and returns the number of items it
+  // processed.
+  int LoadFeatures(Pipeline* pipeline);
+  int MatchFeatures(Pipeline* pipeline);
+  int VerifyMatches(Pipeline* pipeline);
+  int WriteMatches(Pipeline* pipeline);
+
+  std::vector<FeatureMatchingStageStatistics> pipeline_statistics_;
+
   DISALLOW_COPY_AND_ASSIGN(FeatureMatcher);
 };
 
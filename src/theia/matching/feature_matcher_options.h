@@ -46,6 +46,30 @@ struct FeatureMatcherOptions {
   // Number of threads to use in parallel for matching.
   int num_threads = 1;
 
+  // Matching runs as a pipeline of stages connected by bounded queues: the
+  // features of blocks of image pairs are loaded from the database, the image
+  // pairs are matched, the putative matches are geometrically verified and the
+  // verified matches are written to the database in batches. A stage waits
+  // while the queue to the next stage is full, so only a bounded number of
+  // blocks of features is held in memory at any time. Each stage has its own
+  // threads. The matching and verification stages split num_threads between
+  // them when their thread counts are 0; if only one of them is set, the other
+  // gets the remaining threads, but always at least one. Loading and writing
+  // mostly wait on the database and use a single thread by default.
+  int num_feature_loading_threads = 1;
+  int num_matching_threads = 0;
+  int num_verification_threads = 0;
+
+  // The number of blocks of image pairs whose features are loaded ahead of the
+  // matching stage, and the number of matched image pairs that may wait for
+  // geometric verification.
+  int feature_prefetch_capacity = 4;
+  int verification_queue_capacity = 64;
+
+  // Verified image pair matches are written to the database in batches of this
+  // many image pairs.
+  int match_write_batch_size = 64;
+
   // Matching may be performed in core (i.e. all in memory) or out-of-core. For
   // the latter, features are written and read to/from disk as needed (utilizing
   // an LRU cache). The out-of-core strategy is more scalable since the memory
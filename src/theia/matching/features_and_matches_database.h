@@ -77,6 +77,19 @@ class FeaturesAndMatchesDatabase {
   virtual void PutFeatures(const std::string& image_name,
                            const KeypointsAndDescriptors& features) = 0;
 
+  // Returns the features of all images at once. Databases that can look up
+  // several keys in a single request should override this method so that a
+  // matcher may prefetch the features of all pairs it is about to match.
+  virtual std::vector<KeypointsAndDescriptors> GetFeaturesForImages(
+      const std::vector<std::string>& image_names) {
+    std::vector<KeypointsAndDescriptors> features;
+    features.reserve(image_names.size());
+    for (const std::string& image_name : image_names) {
+      features.emplace_back(GetFeatures(image_name));
+    }
+    return features;
+  }
+
   // Supply an iterator to iterate over the features.
   virtual std::vector<std::string> ImageNamesOfFeatures() = 0;
   virtual size_t NumImages() = 0;
@@ -90,6 +103,15 @@ class FeaturesAndMatchesDatabase {
                                  const std::string& image_name2,
                                  const ImagePairMatch& matches) = 0;
 
+  // Sets the image pair matches of several image pairs, keyed by the image
+  // names stored in each match. Databases backed by storage should override
+  // this method to write all matches in a single transaction.
+  virtual void PutImagePairMatches(const std::vector<ImagePairMatch>& matches) {
+    for (const ImagePairMatch& match : matches) {
+      PutImagePairMatch(match.image1, match.image2, match);
+    }
+  }
+
   // Supply an iterator to iterate over the matches.
   virtual std::vector<std::pair<std::string, std::string>>
   ImageNamesOfMatches() = 0;
@@ -97,6 +119,15 @@ class FeaturesAndMatchesDatabase {
 
   // Clear all matches from the DB.
   virtual void RemoveAllMatches() = 0;
+
+  // Returns the approximate number of bytes of memory used by the database,
+  // including its caches.
+  virtual size_t MemoryUsage() { return 0; }
+
+  // Limits the memory used by the caches of the database to budget_bytes,
+  // evicting cached entries if necessary. Databases that hold all of their data
+  // in memory have no cache and ignore the budget.
+  virtual void SetCacheMemoryBudget(const size_t budget_bytes) {}
 };
 }  // namespace theia
 #endif  // THEIA_MATCHING_FEATURES_AND_MATCHES_DATABASE_H_
@@ -36,26 +36,27 @@
 
 #include <Eigen/Core>
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <stdint.h>
-#include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
-#include "flann/flann.hpp"
-
-#include "theia/matching/distance.h"
 #include "theia/matching/indexed_feature_match.h"
 #include "theia/matching/keypoints_and_descriptors.h"
 #include "theia/sfm/camera/camera.h"
 #include "theia/sfm/pose/fundamental_matrix_util.h"
-#include "theia/util/hash.h"
-#include "theia/util/map_util.h"
 #include "theia/util/random.h"
 
 namespace theia {
 namespace {
 
+// Image grids are dense unless the bounding box of the features holds more than
+// this many cells per feature, and at least kMinNumDenseCells. Features that
+// are spread far apart (e.g. with bogus coordinates) would otherwise allocate
+// an arbitrarily large grid.
+const int64_t kMaxNumDenseCellsPerFeature = 16;
+const int64_t kMinNumDenseCells = 1 << 16;
+
 // Encodes the line endpoints into an uint64_t for fast sorting.
 uint64_t EncodeLineEndpoints(const std::vector<Eigen::Vector2d>& endpoints) {
   uint64_t encoded_endpoint = 0;
@@ -100,46 +101,52 @@ bool GuidedEpipolarMatcher::Initialize(
   }
 
   // Create a fast lookup for determining if a feature has already been matched.
-  for (const IndexedFeatureMatch match : matches) {
-    matched_features1_.insert(match.feature1_ind);
-    matched_features2_.insert(match.feature2_ind);
+  matched_features1_.assign(features1_.keypoints.size(), false);
+  matched_features2_.assign(features2_.keypoints.size(), false);
+  for (const IndexedFeatureMatch& match : matches) {
+    matched_features1_[match.feature1_ind] = true;
+    matched_features2_[match.feature2_ind] = true;
+  }
+  is_candidate_.assign(features2_.keypoints.size(), false);
+
+  // TODO(csweeney): Test if the epipolar line of feature2 features is within
+  // the image bounds of image 1. If not, we can skip the feature entirely.
+  std::vector<int> unmatched_features2;
+  unmatched_features2.reserve(features2_.keypoints.size());
+  for (int i = 0; i < features2_.keypoints.size(); i++) {
+    if (!matched_features2_[i]) {
+      unmatched_features2.emplace_back(i);
+    }
+  }
+  if (unmatched_features2.empty() ||
+      std::find(matched_features1_.begin(), matched_features1_.end(), false) ==
+          matched_features1_.end()) {
+    return false;
+  }
+
+  // Set the bounding box of the features. This will help constrain the search
+  // along epipolar lines later.
+  top_left_.setConstant(std::numeric_limits<double>::max());
+  bottom_right_.setConstant(-std::numeric_limits<double>::max());
+  for (const int i : unmatched_features2) {
+    const Eigen::Vector2d point(features2_.keypoints[i].x(),
+                                features2_.keypoints[i].y());
+    top_left_ = top_left_.cwiseMin(point);
+    bottom_right_ = bottom_right_.cwiseMax(point);
   }
 
+  // For each grid, add all unmatched features from features2.
   const double half_cell_width = options_.guided_matching_max_distance_pixels;
   const double offset = half_cell_width;
+  image_grids_.clear();
   image_grids_.emplace_back(ImageGrid(half_cell_width, 0, 0));
   image_grids_.emplace_back(ImageGrid(half_cell_width, offset, 0));
   image_grids_.emplace_back(ImageGrid(half_cell_width, 0, offset));
   image_grids_.emplace_back(ImageGrid(half_cell_width, offset, offset));
-
-  // These helper vectors will be used to find the bounding box of the
-  // features. This will help constrain the search along epipolar lines later.
-  std::vector<double> x, y;
-  x.reserve(features2_.keypoints.size());
-  y.reserve(features2_.keypoints.size());
-  // For each grid, add all features from features2.
-  for (int i = 0; i < features2_.keypoints.size(); i++) {
-    // TODO(csweeney): Test if the epipolar line of feature2 features is within
-    // the image bounds of image 1. If not, we can skip the feature entirely.
-    if (ContainsKey(matched_features2_, i)) {
-      continue;
-    }
-    for (int j = 0; j < image_grids_.size(); j++) {
-      image_grids_[j].AddFeature(
-          i, features2_.keypoints[i].x(), features2_.keypoints[i].y());
-    }
-    x.emplace_back(features2_.keypoints[i].x());
-    y.emplace_back(features2_.keypoints[i].y());
+  for (ImageGrid& image_grid : image_grids_) {
+    image_grid.AddFeatures(unmatched_features2, features2_.keypoints);
   }
 
-  // Set the bounding box of the features.
-  const auto& minmax_x = std::minmax_element(x.begin(), x.end());
-  const auto& minmax_y = std::minmax_element(y.begin(), y.end());
-  top_left_.x() = *minmax_x.first;
-  top_left_.y() = *minmax_y.first;
-  bottom_right_.x() = *minmax_x.second;
-  bottom_right_.y() = *minmax_y.second;
-
   return true;
 }
 
@@ -148,7 +155,10 @@ bool GuidedEpipolarMatcher::GetMatches(
   const int num_input_matches = matches->size();
   const double lowes_ratio_sq = options_.lowes_ratio * options_.lowes_ratio;
 
-  Initialize(*matches);
+  // Nothing is left to match if all features of either image are matched.
+  if (!Initialize(*matches)) {
+    return true;
+  }
 
   // Group all epipolar lines.
   std::vector<EpilineGroup> epiline_groups;
@@ -156,30 +166,35 @@ bool GuidedEpipolarMatcher::GetMatches(
 
   // Go through each epiline group and perform guided matching by only
   // retrieving features near the epiline once per group.
+  std::vector<int> candidate_keypoint_indices;
+  std::vector<float> nn_distances;
+  std::vector<int> nn_indices;
   for (const EpilineGroup& epiline_group : epiline_groups) {
     // Find all features close to this epiline.
-    std::vector<int> candidate_keypoint_indices;
+    candidate_keypoint_indices.clear();
     FindFeaturesNearEpipolarLines(epiline_group, &candidate_keypoint_indices);
+    // The Lowes ratio test needs at least two neighbors.
+    if (candidate_keypoint_indices.size() < 2) {
+      continue;
+    }
 
-    // Build a KD-tree for those features and query the tree to get the nearest
-    // neighbor matches for each feature in this epiline group.
-    std::vector<std::vector<float> > nn_distances;
-    std::vector<std::vector<int> > nn_indices;
-    FindKNearestNeighbors(epiline_group.features,
-                          candidate_keypoint_indices,
-                          &nn_distances,
-                          &nn_indices);
+    // Find the two nearest neighbors of each feature in this epiline group
+    // among the candidates.
+    FindTwoNearestNeighbors(epiline_group.features,
+                            candidate_keypoint_indices,
+                            &nn_distances,
+                            &nn_indices);
 
     // For each feature in the epiline group, check the Lowes ratio of the top 2
     // nearest neighbors to determine if the match is valid.
-    for (int i = 0; i < nn_distances.size(); i++) {
+    for (int i = 0; i < epiline_group.features.size(); i++) {
       // If the top 2 distance pass lowes ratio test then add the match to the
       // output.
-      if (nn_distances[i][0] < nn_distances[i][1] * lowes_ratio_sq) {
+      if (nn_distances[2 * i] < nn_distances[2 * i + 1] * lowes_ratio_sq) {
         IndexedFeatureMatch match;
         match.feature1_ind = epiline_group.features[i];
-        match.feature2_ind = nn_indices[i][0];
-        match.distance = nn_distances[i][0];
+        match.feature2_ind = nn_indices[2 * i];
+        match.distance = nn_distances[2 * i];
         matches->emplace_back(match);
       }
     }
@@ -213,7 +228,7 @@ void GuidedEpipolarMatcher::GroupEpipolarLines(
   std::vector<std::pair<uint64_t, int> > sorted_endpoints;
   sorted_endpoints.reserve(features1_.keypoints.size());
   for (int i = 0; i < features1_.keypoints.size(); i++) {
-    if (ContainsKey(matched_features1_, i)) {
+    if (matched_features1_[i]) {
       continue;
     }
 
@@ -287,7 +302,6 @@ void GuidedEpipolarMatcher::FindFeaturesNearEpipolarLines(
 
   // Sample the epipolar line equally between the points where it intersects
   // the features bounding box.
-  std::unordered_set<int> candidate_keypoints;
   const Eigen::Vector2d line_delta =
       (line_endpoints[0] - line_endpoints[1]) / static_cast<double>(num_steps);
   Eigen::Vector2d sample_point = line_endpoints[1];
@@ -297,24 +311,25 @@ void GuidedEpipolarMatcher::FindFeaturesNearEpipolarLines(
 
     // Find the cell center among all grids that is closest and add the
     // keypoints belonging to that cell.
-    std::vector<int> new_keypoints;
-    FindClosestCellAndKeypoints(sample_point, &new_keypoints);
-    candidate_keypoints.insert(new_keypoints.begin(), new_keypoints.end());
+    AddKeypointsOfClosestCell(sample_point, candidate_keypoint_indices);
   }
 
   // If we do not have enough features then the lowes ratio test is not
   // meaningful. Add some random features here so that lowes ratio is more
   // informative of whether we have a good match or not.
-  if (candidate_keypoints.size() < kMinNumMatchesFound) {
-    const int num_current_keypoints = candidate_keypoints.size();
-    for (int i = num_current_keypoints; i < kMinNumMatchesFound; i++) {
-      candidate_keypoints.insert(
-          rng_->RandInt(0, features2_.keypoints.size() - 1));
+  const int num_current_keypoints = candidate_keypoint_indices->size();
+  for (int i = num_current_keypoints; i < kMinNumMatchesFound; i++) {
+    const int feature_index = rng_->RandInt(0, features2_.keypoints.size() - 1);
+    if (!is_candidate_[feature_index]) {
+      is_candidate_[feature_index] = true;
+      candidate_keypoint_indices->emplace_back(feature_index);
     }
   }
-  candidate_keypoint_indices->insert(candidate_keypoint_indices->end(),
-                                     candidate_keypoints.begin(),
-                                     candidate_keypoints.end());
+
+  // Reset the flags for the next epiline group.
+  for (const int feature_index : *candidate_keypoint_indices) {
+    is_candidate_[feature_index] = false;
+  }
 }
 
 void GuidedEpipolarMatcher::FindEpipolarLineIntersection(
@@ -354,87 +369,95 @@ void GuidedEpipolarMatcher::FindEpipolarLineIntersection(
   }
 }
 
-void GuidedEpipolarMatcher::FindKNearestNeighbors(
+void GuidedEpipolarMatcher::FindTwoNearestNeighbors(
     const std::vector<int>& query_feature_indices,
     const std::vector<int>& candidate_feature_indices,
-    std::vector<std::vector<float> >* nn_distances,
-    std::vector<std::vector<int> >* nn_indices) {
-  static const int kNumNearestNeighbors = 2;
-  static const int kMinNumLeafsVisited = 50;
+    std::vector<float>* nn_distances,
+    std::vector<int>* nn_indices) {
+  const int num_queries = query_feature_indices.size();
+  const int num_candidates = candidate_feature_indices.size();
   const int num_descriptor_dimensions = features1_.descriptors[0].size();
 
-  // Gather the query descriptors.
-  Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
-      query_descriptors(query_feature_indices.size(),
-                        num_descriptor_dimensions);
-  for (int i = 0; i < query_feature_indices.size(); i++) {
-    const int match_index = query_feature_indices[i];
-    query_descriptors.row(i) = features1_.descriptors[match_index];
-  }
-  flann::Matrix<float> flann_query_descriptors(query_descriptors.data(),
-                                               query_descriptors.rows(),
-                                               query_descriptors.cols());
-
-  // Gather the candidate matching descriptors.
-  Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
-      candidate_descriptors(candidate_feature_indices.size(),
-                            num_descriptor_dimensions);
-  for (int i = 0; i < candidate_feature_indices.size(); i++) {
-    const int match_index = candidate_feature_indices[i];
-    candidate_descriptors.row(i) = features2_.descriptors[match_index];
-  }
-
-  // Create the searchable KD-tree with FLANN.
-  flann::Matrix<float> flann_candidate_descriptors(
-      candidate_descriptors.data(),
-      candidate_descriptors.rows(),
-      candidate_descriptors.cols());
-
-  flann::Index<flann::L2<float> > flann_kd_tree(
-      flann_candidate_descriptors, flann::KDTreeSingleIndexParams());
-  flann_kd_tree.buildIndex();
-
-  // Query the KD-tree to get the top 2 nearest neighbors.
-  const int max_leafs_to_check =
-      std::max(static_cast<int>(candidate_descriptors.rows() * 0.2),
-               kMinNumLeafsVisited);
-  flann_kd_tree.knnSearch(flann_query_descriptors,
-                          *nn_indices,
-                          *nn_distances,
-                          kNumNearestNeighbors,
-                          flann::SearchParams(max_leafs_to_check));
+  // Gather the query and candidate descriptors into contiguous buffers.
+  query_descriptors_.resize(num_queries, num_descriptor_dimensions);
+  for (int i = 0; i < num_queries; i++) {
+    query_descriptors_.row(i) =
+        features1_.descriptors[query_feature_indices[i]];
+  }
+  candidate_descriptors_.resize(num_candidates, num_descriptor_dimensions);
+  for (int i = 0; i < num_candidates; i++) {
+    candidate_descriptors_.row(i) =
+        features2_.descriptors[candidate_feature_indices[i]];
+  }
+
+  // Compute the squared distances as ||q||^2 + ||c||^2 - 2 * q^t * c so that
+  // the bulk of the work is a single matrix product which Eigen vectorizes.
+  // The ||q||^2 term does not change the order of the neighbors and is only
+  // added to the two nearest distances below.
+  candidate_sq_norms_ = candidate_descriptors_.rowwise().squaredNorm();
+  distances_.noalias() =
+      -2.0f * candidate_descriptors_ * query_descriptors_.transpose();
+  distances_.colwise() += candidate_sq_norms_;
 
   // Output the top 2 matches.
-  for (int i = 0; i < query_feature_indices.size(); i++) {
-    // Change the NN indices to be the feature index instead of the index of the
-    // FLANN matrix.
-    for (int j = 0; j < kNumNearestNeighbors; j++) {
-      const int flann_index = (*nn_indices)[i][j];
-      (*nn_indices)[i][j] = candidate_feature_indices[flann_index];
+  nn_distances->resize(2 * num_queries);
+  nn_indices->resize(2 * num_queries);
+  for (int i = 0; i < num_queries; i++) {
+    const float* distances = distances_.col(i).data();
+    int best = 0, second_best = 1;
+    if (distances[second_best] < distances[best]) {
+      std::swap(best, second_best);
     }
+    for (int j = 2; j < num_candidates; j++) {
+      if (distances[j] < distances[second_best]) {
+        if (distances[j] < distances[best]) {
+          second_best = best;
+          best = j;
+        } else {
+          second_best = j;
+        }
+      }
+    }
+
+    const float query_sq_norm = query_descriptors_.row(i).squaredNorm();
+    (*nn_distances)[2 * i] = std::max(distances[best] + query_sq_norm, 0.0f);
+    (*nn_distances)[2 * i + 1] =
+        std::max(distances[second_best] + query_sq_norm, 0.0f);
+    (*nn_indices)[2 * i] = candidate_feature_indices[best];
+    (*nn_indices)[2 * i + 1] = candidate_feature_indices[second_best];
   }
 }
 
-void GuidedEpipolarMatcher::FindClosestCellAndKeypoints(
-    const Eigen::Vector2d& point, std::vector<int>* new_keypoints) {
+void GuidedEpipolarMatcher::AddKeypointsOfClosestCell(
+    const Eigen::Vector2d& point, std::vector<int>* candidate_keypoints) {
+  int min_cell = -1;
   int min_grid = 0;
-  Eigen::Vector2i min_grid_center;
   double min_dist = std::numeric_limits<double>::max();
 
   // Find the grid cell with the closest center.
-  for (int i = 0; i < 4; i++) {
-    Eigen::Vector2i grid_center;
-    image_grids_[i].GetClosestGridCenter(point.x(), point.y(), &grid_center);
-    const double dist = (grid_center.cast<double>() - point).squaredNorm();
+  for (int i = 0; i < image_grids_.size(); i++) {
+    double dist;
+    const int cell =
+        image_grids_[i].GetClosestCell(point.x(), point.y(), &dist);
     if (dist < min_dist) {
       min_grid = i;
+      min_cell = cell;
       min_dist = dist;
-      std::swap(min_grid_center, grid_center);
     }
   }
+  if (min_cell < 0) {
+    return;
+  }
 
-  // Get the features from the closest grid cell.
-  image_grids_[min_grid].GetFeaturesFromCell(min_grid_center, new_keypoints);
+  // Add the features from the closest grid cell.
+  const int *begin, *end;
+  image_grids_[min_grid].GetFeaturesFromCell(min_cell, &begin, &end);
+  for (const int* feature = begin; feature != end; ++feature) {
+    if (!is_candidate_[*feature]) {
+      is_candidate_[*feature] = true;
+      candidate_keypoints->emplace_back(*feature);
+    }
+  }
 }
 
 GuidedEpipolarMatcher::ImageGrid::ImageGrid(const double cell_size,
@@ -442,31 +465,126 @@ GuidedEpipolarMatcher::ImageGrid::ImageGrid(const double cell_size,
                                             const double cell_offset_y)
     : cell_size_(cell_size),
       cell_offset_x_(cell_offset_x),
-      cell_offset_y_(cell_offset_y) {
-  cells_.reserve(10000);
-}
+      cell_offset_y_(cell_offset_y),
+      min_cell_x_(0),
+      min_cell_y_(0),
+      num_cells_x_(0),
+      num_cells_y_(0),
+      is_dense_(true) {}
+
+void GuidedEpipolarMatcher::ImageGrid::AddFeatures(
+    const std::vector<int>& feature_indices,
+    const std::vector<Keypoint>& keypoints) {
+  const double cell_width = 2.0 * cell_size_;
+  std::vector<Eigen::Vector2i> cells(feature_indices.size());
+  Eigen::Vector2i min_cell(std::numeric_limits<int>::max(),
+                           std::numeric_limits<int>::max());
+  Eigen::Vector2i max_cell(std::numeric_limits<int>::min(),
+                           std::numeric_limits<int>::min());
+  for (int i = 0; i < feature_indices.size(); i++) {
+    const Keypoint& keypoint = keypoints[feature_indices[i]];
+    cells[i].x() = static_cast<int>(
+        std::floor((keypoint.x() - cell_offset_x_) / cell_width));
+    cells[i].y() = static_cast<int>(
+        std::floor((keypoint.y() - cell_offset_y_) / cell_width));
+    min_cell = min_cell.cwiseMin(cells[i]);
+    max_cell = max_cell.cwiseMax(cells[i]);
+  }
+  if (feature_indices.empty()) {
+    min_cell.setZero();
+    max_cell.setConstant(-1);
+  }
+  min_cell_x_ = min_cell.x();
+  min_cell_y_ = min_cell.y();
+  num_cells_x_ = static_cast<int64_t>(max_cell.x()) - min_cell.x() + 1;
+  num_cells_y_ = static_cast<int64_t>(max_cell.y()) - min_cell.y() + 1;
+  const int64_t max_num_dense_cells =
+      std::max(kMinNumDenseCells,
+               kMaxNumDenseCellsPerFeature *
+                   static_cast<int64_t>(feature_indices.size()));
+  is_dense_ = num_cells_y_ == 0 ||
+              num_cells_x_ <= max_num_dense_cells / num_cells_y_;
+
+  std::vector<int64_t> cell_positions(cells.size());
+  for (int i = 0; i < cells.size(); i++) {
+    cell_positions[i] =
+        (static_cast<int64_t>(cells[i].y()) - min_cell_y_) * num_cells_x_ +
+        (static_cast<int64_t>(cells[i].x()) - min_cell_x_);
+  }
+
+  // The cell of each feature in the dense grid or in the list of occupied
+  // cells.
+  std::vector<int> cell_indices(cells.size());
+  if (is_dense_) {
+    occupied_cells_.clear();
+    cell_begin_.assign(num_cells_x_ * num_cells_y_ + 1, 0);
+    for (int i = 0; i < cells.size(); i++) {
+      cell_indices[i] = static_cast<int>(cell_positions[i]);
+    }
+  } else {
+    occupied_cells_ = cell_positions;
+    std::sort(occupied_cells_.begin(), occupied_cells_.end());
+    occupied_cells_.erase(
+        std::unique(occupied_cells_.begin(), occupied_cells_.end()),
+        occupied_cells_.end());
+    cell_begin_.assign(occupied_cells_.size() + 1, 0);
+    for (int i = 0; i < cells.size(); i++) {
+      cell_indices[i] = std::lower_bound(occupied_cells_.begin(),
+                                         occupied_cells_.end(),
+                                         cell_positions[i]) -
+                        occupied_cells_.begin();
+    }
+  }
 
-void GuidedEpipolarMatcher::ImageGrid::AddFeature(const int feature_index,
-                                                  const double x,
-                                                  const double y) {
-  Eigen::Vector2i grid_center;
-  GetClosestGridCenter(x, y, &grid_center);
-  cells_[grid_center].emplace_back(feature_index);
+  // Sort the features by cell with a counting sort.
+  for (int i = 0; i < cells.size(); i++) {
+    ++cell_begin_[cell_indices[i] + 1];
+  }
+  for (int i = 1; i < cell_begin_.size(); i++) {
+    cell_begin_[i] += cell_begin_[i - 1];
+  }
+  cell_features_.resize(feature_indices.size());
+  std::vector<int> cell_end(cell_begin_.begin(), cell_begin_.end() - 1);
+  for (int i = 0; i < feature_indices.size(); i++) {
+    cell_features_[cell_end[cell_indices[i]]++] = feature_indices[i];
+  }
 }
 
-void GuidedEpipolarMatcher::ImageGrid::GetClosestGridCenter(
-    const double x, const double y, Eigen::Vector2i* grid_center) {
-  grid_center->x() = static_cast<int>(
-      std::floor((x - cell_offset_x_) / (2.0 * cell_size_)) * 2.0 * cell_size_ +
-      cell_size_ + cell_offset_x_);
-  grid_center->y() = static_cast<int>(
-      std::floor((y - cell_offset_y_) / (2.0 * cell_size_)) * 2.0 * cell_size_ +
-      +cell_size_ + cell_offset_y_);
+int GuidedEpipolarMatcher::ImageGrid::GetClosestCell(
+    const double x, const double y, double* sq_distance_to_center) const {
+  const double cell_width = 2.0 * cell_size_;
+  const int cell_x =
+      static_cast<int>(std::floor((x - cell_offset_x_) / cell_width));
+  const int cell_y =
+      static_cast<int>(std::floor((y - cell_offset_y_) / cell_width));
+  const double center_x = cell_x * cell_width + cell_size_ + cell_offset_x_;
+  const double center_y = cell_y * cell_width + cell_size_ + cell_offset_y_;
+  *sq_distance_to_center = (x - center_x) * (x - center_x) +
+                           (y - center_y) * (y - center_y);
+
+  const int64_t grid_x = static_cast<int64_t>(cell_x) - min_cell_x_;
+  const int64_t grid_y = static_cast<int64_t>(cell_y) - min_cell_y_;
+  if (grid_x < 0 || grid_x >= num_cells_x_ || grid_y < 0 ||
+      grid_y >= num_cells_y_) {
+    return -1;
+  }
+  const int64_t cell_position = grid_y * num_cells_x_ + grid_x;
+  if (is_dense_) {
+    return static_cast<int>(cell_position);
+  }
+
+  const auto cell = std::lower_bound(
+      occupied_cells_.begin(), occupied_cells_.end(), cell_position);
+  if (cell == occupied_cells_.end() || *cell != cell_position) {
+    return -1;
+  }
+  return cell - occupied_cells_.begin();
 }
 
 void GuidedEpipolarMatcher::ImageGrid::GetFeaturesFromCell(
-    const Eigen::Vector2i& cell_center, std::vector<int>* feature_indices) {
-  *feature_indices = FindWithDefault(cells_, cell_center, std::vector<int>());
+    const int cell, const int** begin, const int** end) const {
+  *begin = cell_features_.data() + cell_begin_[cell];
+  *end = cell_features_.data() + cell_begin_[cell + 1];
 }
 
 }  // namespace theia
@@ -37,15 +37,13 @@
 
 #include <Eigen/Core>
 #include <memory>
-#include <unordered_map>
-#include <unordered_set>
-#include <utility>
+#include <stdint.h>
 #include <vector>
 
 #include "theia/alignment/alignment.h"
+#include "theia/image/keypoint_detector/keypoint.h"
 #include "theia/matching/keypoints_and_descriptors.h"
 #include "theia/sfm/camera/camera.h"
-#include "theia/util/hash.h"
 
 namespace theia {
 class RandomNumberGenerator;
@@ -87,30 +85,48 @@ class GuidedEpipolarMatcher {
 
  private:
   // This helper class provides quick and easy access to the image grids that
-  // are used to rapidly find features near epipolar lines.
+  // are used to rapidly find features near epipolar lines. The feature indices
+  // are sorted by cell, so the features of a cell are a contiguous range of one
+  // array. The grid is dense over the bounding box of the features, so a cell
+  // is found by index arithmetic, unless the box holds too many cells for the
+  // number of features. Then only the occupied cells are stored and a cell is
+  // found by binary search.
   class ImageGrid {
    public:
     ImageGrid(const double cell_size,
               const double cell_offset_x,
               const double cell_offset_y);
 
-    // Add a feature the the grid and assign it to a cell.
-    void AddFeature(const int feature_index, const double x, const double y);
+    // Assigns the features with the given indices to the cells of the grid.
+    void AddFeatures(const std::vector<int>& feature_indices,
+                     const std::vector<Keypoint>& keypoints);
 
-    // Retrieve the closest cell center to the point.
-    void GetClosestGridCenter(const double x,
-                              const double y,
-                              Eigen::Vector2i* grid_center);
+    // Returns the index of the cell containing the point, or -1 if the point
+    // is outside of the grid or, for sparse grids, in an empty cell. The
+    // squared distance to the center of the cell is returned in either case.
+    int GetClosestCell(const double x,
+                       const double y,
+                       double* sq_distance_to_center) const;
 
-    // Get all features that lie within the cell specified by the center.
-    void GetFeaturesFromCell(const Eigen::Vector2i& cell_center,
-                             std::vector<int>* feature_indices);
+    // Returns the features of the cell as the range [*begin, *end).
+    void GetFeaturesFromCell(const int cell,
+                             const int** begin,
+                             const int** end) const;
 
    private:
-    // A container for the grid cells. The mapping is such the the cell center
-    // contains all keypoints in the cell.
-    std::unordered_map<Eigen::Vector2i, std::vector<int>> cells_;
     double cell_size_, cell_offset_x_, cell_offset_y_;
+    int min_cell_x_, min_cell_y_;
+    int64_t num_cells_x_, num_cells_y_;
+
+    // The position of each occupied cell in the bounding box, in increasing
+    // order. Only used by sparse grids.
+    bool is_dense_;
+    std::vector<int64_t> occupied_cells_;
+
+    // The features of cell c are
+    // cell_features_[cell_begin_[c], cell_begin_[c + 1]).
+    std::vector<int> cell_begin_;
+    std::vector<int> cell_features_;
   };
 
   // Holds a group of features with similar epiplines as a single epiline.
@@ -119,7 +135,8 @@ class GuidedEpipolarMatcher {
     std::vector<int> features;
   };
 
-  // Creates the grid structure for the fast epipolar lookup.
+  // Creates the grid structure for the fast epipolar lookup. Returns false if
+  // either image has no unmatched features.
   bool Initialize(const std::vector<IndexedFeatureMatch>& matches);
 
   // Groups similar epipolar lines into groups so that the computational
@@ -139,20 +156,23 @@ class GuidedEpipolarMatcher {
   // Computes a fundamental matrix from the cameras.
   Eigen::Matrix3d ComputeFundamentalMatrix();
 
-  // Finds the closest grid cell among all image grids and returns the keypoints
-  // in that cell.
-  void FindClosestCellAndKeypoints(const Eigen::Vector2d& point,
-                                   std::vector<int>* new_keypoints);
+  // Finds the closest grid cell among all image grids and adds the keypoints
+  // in that cell that are not candidates yet.
+  void AddKeypointsOfClosestCell(const Eigen::Vector2d& point,
+                                 std::vector<int>* candidate_keypoints);
 
   // Given the set of query descriptors (in features1) and the candidate matches
   // (in features2), return the top 2 nearest neighbor distances and indices
-  // where the index is the index in features2 of the match. The format is
-  // nn_distances[query_feature_index][nn_number] where nn_number == 0 is the
-  // closest neighbor by descriptor distance.
-  void FindKNearestNeighbors(const std::vector<int>& query_feature_indices,
-                             const std::vector<int>& candidate_feature_indices,
-                             std::vector<std::vector<float>>* nn_distances,
-                             std::vector<std::vector<int>>* nn_indices);
+  // where the index is the index in features2 of the match. The neighbors of
+  // the i-th query are at nn_distances[2 * i + nn_number] where
+  // nn_number == 0 is the closest neighbor by descriptor distance. The
+  // distances are exact and computed for all candidates at once with a matrix
+  // product.
+  void FindTwoNearestNeighbors(
+      const std::vector<int>& query_feature_indices,
+      const std::vector<int>& candidate_feature_indices,
+      std::vector<float>* nn_distances,
+      std::vector<int>* nn_indices);
 
   const Options options_;
   const Camera &camera1_, camera2_;
@@ -162,7 +182,17 @@ class GuidedEpipolarMatcher {
 
   Eigen::Vector2d top_left_, bottom_right_;
   std::vector<ImageGrid> image_grids_;
-  std::unordered_set<int> matched_features1_, matched_features2_;
+  std::vector<bool> matched_features1_, matched_features2_;
+
+  // Marks the features of image 2 that are candidates of the current epiline
+  // group so that candidates are gathered without a hash set.
+  std::vector<bool> is_candidate_;
+
+  // Buffers for the descriptor distances that are reused by all epiline groups.
+  Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+      query_descriptors_, candidate_descriptors_;
+  Eigen::MatrixXf distances_;
+  Eigen::VectorXf candidate_sq_norms_;
 };
 
 }  // namespace theia
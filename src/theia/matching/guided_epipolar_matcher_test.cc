@@ -156,4 +156,144 @@ TEST(GuidedEpipolarMatcherTest, WithInputMatchesLarge) {
   TestGuidedEpipolarMatcher(2000, 500, 1000);
 }
 
+TEST(GuidedEpipolarMatcherTest, AllFeaturesMatched) {
+  Camera camera1, camera2;
+  camera2.SetPosition(Eigen::Vector3d(1.0, 0.0, 0.0));
+  KeypointsAndDescriptors features1, features2;
+  std::vector<IndexedFeatureMatch> matches;
+  for (int i = 0; i < 10; i++) {
+    features1.keypoints.emplace_back(i, i, Keypoint::OTHER);
+    features2.keypoints.emplace_back(i, i, Keypoint::OTHER);
+    features1.descriptors.emplace_back(Eigen::VectorXf::Ones(4));
+    features2.descriptors.emplace_back(Eigen::VectorXf::Ones(4));
+    matches.emplace_back(i, i, 0.0f);
+  }
+
+  // There are no unmatched features left so no matches should be added.
+  GuidedEpipolarMatcher::Options options;
+  options.rng = rng;
+  GuidedEpipolarMatcher matcher(
+      options, camera1, camera2, features1, features2);
+  EXPECT_TRUE(matcher.GetMatches(&matches));
+  EXPECT_EQ(matches.size(), 10);
+}
+
+// Sets up a single feature in image 1 whose epipolar line in image 2 is the
+// horizontal line y = kLineY, with kNumLineFeatures features on that line that
+// have random descriptors. The cameras only differ by a translation along x.
+static const double kLineY = 520.0;
+static const int kNumLineFeatures = 60;
+static const int kDescriptorDimension = 128;
+
+Eigen::VectorXf RandomDescriptor() {
+  Eigen::VectorXf descriptor(kDescriptorDimension);
+  rng->SetRandom(&descriptor);
+  return descriptor.normalized();
+}
+
+// Returns a descriptor that is close to the given one.
+Eigen::VectorXf PerturbedDescriptor(const Eigen::VectorXf& descriptor) {
+  return (descriptor + 0.1 * RandomDescriptor()).normalized();
+}
+
+void SetUpEpipolarLine(const Eigen::VectorXf& descriptor1,
+                       Camera* camera1,
+                       Camera* camera2,
+                       KeypointsAndDescriptors* features1,
+                       KeypointsAndDescriptors* features2) {
+  camera2->SetPosition(Eigen::Vector3d(1.0, 0.0, 0.0));
+  features1->keypoints.emplace_back(400.0, kLineY, Keypoint::OTHER);
+  features1->descriptors.emplace_back(descriptor1);
+  for (int i = 0; i < kNumLineFeatures; i++) {
+    features2->keypoints.emplace_back(
+        100.0 + 10.0 * i, kLineY, Keypoint::OTHER);
+    features2->descriptors.emplace_back(RandomDescriptor());
+  }
+  // Widen the bounding box of the features in image 2 around the line.
+  features2->keypoints.emplace_back(100.0, kLineY - 50.0, Keypoint::OTHER);
+  features2->descriptors.emplace_back(RandomDescriptor());
+  features2->keypoints.emplace_back(700.0, kLineY + 50.0, Keypoint::OTHER);
+  features2->descriptors.emplace_back(RandomDescriptor());
+}
+
+// Returns the index of the feature in image 2 that feature 0 of image 1 is
+// matched to, or -1 if it is not matched.
+int GuidedMatch(const Camera& camera1,
+                const Camera& camera2,
+                const KeypointsAndDescriptors& features1,
+                const KeypointsAndDescriptors& features2) {
+  GuidedEpipolarMatcher::Options options;
+  options.rng = rng;
+  GuidedEpipolarMatcher matcher(
+      options, camera1, camera2, features1, features2);
+  std::vector<IndexedFeatureMatch> matches;
+  EXPECT_TRUE(matcher.GetMatches(&matches));
+  EXPECT_LE(matches.size(), 1);
+  return matches.empty() ? -1 : matches[0].feature2_ind;
+}
+
+TEST(GuidedEpipolarMatcherTest, OnlyMatchesFeaturesNearEpipolarLine) {
+  const Eigen::VectorXf descriptor = RandomDescriptor();
+
+  // The only feature with a similar descriptor is within the distance
+  // threshold of the epipolar line.
+  {
+    Camera camera1, camera2;
+    KeypointsAndDescriptors features1, features2;
+    SetUpEpipolarLine(descriptor, &camera1, &camera2, &features1, &features2);
+    features2.keypoints.emplace_back(420.0, kLineY + 1.0, Keypoint::OTHER);
+    features2.descriptors.emplace_back(PerturbedDescriptor(descriptor));
+    EXPECT_EQ(GuidedMatch(camera1, camera2, features1, features2),
+              features2.keypoints.size() - 1);
+  }
+
+  // The only feature with a similar descriptor is far from the epipolar line.
+  {
+    Camera camera1, camera2;
+    KeypointsAndDescriptors features1, features2;
+    SetUpEpipolarLine(descriptor, &camera1, &camera2, &features1, &features2);
+    features2.keypoints.emplace_back(420.0, kLineY + 30.0, Keypoint::OTHER);
+    features2.descriptors.emplace_back(descriptor);
+    EXPECT_EQ(GuidedMatch(camera1, camera2, features1, features2), -1);
+  }
+}
+
+TEST(GuidedEpipolarMatcherTest, RejectsAmbiguousMatches) {
+  const Eigen::VectorXf descriptor = RandomDescriptor();
+
+  // Two features on the epipolar line have descriptors that are similarly
+  // close, so the Lowes ratio test fails.
+  Camera camera1, camera2;
+  KeypointsAndDescriptors features1, features2;
+  SetUpEpipolarLine(descriptor, &camera1, &camera2, &features1, &features2);
+  features2.keypoints.emplace_back(420.0, kLineY, Keypoint::OTHER);
+  features2.descriptors.emplace_back(PerturbedDescriptor(descriptor));
+  features2.keypoints.emplace_back(620.0, kLineY, Keypoint::OTHER);
+  features2.descriptors.emplace_back(PerturbedDescriptor(descriptor));
+  EXPECT_EQ(GuidedMatch(camera1, camera2, features1, features2), -1);
+
+  // Without the second feature the match is distinctive.
+  features2.keypoints.pop_back();
+  features2.descriptors.pop_back();
+  EXPECT_EQ(GuidedMatch(camera1, camera2, features1, features2),
+            features2.keypoints.size() - 1);
+}
+
+// Features that are spread over a very large area use a sparse grid instead of
+// allocating a cell for every position in their bounding box.
+TEST(GuidedEpipolarMatcherTest, MatchesWithSparseGrid) {
+  const Eigen::VectorXf descriptor = RandomDescriptor();
+  Camera camera1, camera2;
+  KeypointsAndDescriptors features1, features2;
+  SetUpEpipolarLine(descriptor, &camera1, &camera2, &features1, &features2);
+  features2.keypoints.emplace_back(0.0, 0.0, Keypoint::OTHER);
+  features2.descriptors.emplace_back(RandomDescriptor());
+  features2.keypoints.emplace_back(60000.0, 60000.0, Keypoint::OTHER);
+  features2.descriptors.emplace_back(RandomDescriptor());
+  features2.keypoints.emplace_back(420.0, kLineY + 1.0, Keypoint::OTHER);
+  features2.descriptors.emplace_back(PerturbedDescriptor(descriptor));
+  EXPECT_EQ(GuidedMatch(camera1, camera2, features1, features2),
+            features2.keypoints.size() - 1);
+}
+
 }  // namespace theia
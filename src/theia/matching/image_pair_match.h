@@ -37,9 +37,11 @@
 
 #include <cereal/access.hpp>
 #include <cereal/cereal.hpp>
+#include <cereal/types/utility.hpp>
 #include <cereal/types/vector.hpp>
 #include <stdint.h>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "theia/alignment/alignment.h"
@@ -48,6 +50,9 @@
 
 namespace theia {
 
+// The indices of two matched features in the keypoints of the two images.
+typedef std::pair<uint32_t, uint32_t> FeatureIndexPair;
+
 struct ImagePairMatch {
  public:
   std::string image1;
@@ -61,6 +66,11 @@ struct ImagePairMatch {
   // then this only contains inlier correspondences.
   std::vector<FeatureCorrespondence> correspondences;
 
+  // Optionally, the indices of the features of each correspondence in the
+  // keypoints of the images. If these are set, the databases store the match
+  // as a CompactImagePairMatch.
+  std::vector<FeatureIndexPair> feature_indices;
+
  private:
   // Templated method for disk I/O with cereal. This method tells cereal which
   // data members should be used when reading/writing to/from disk.
@@ -68,11 +78,14 @@ struct ImagePairMatch {
   template <class Archive>
   void serialize(Archive& ar, const std::uint32_t version) {  // NOLINT
     ar(image1, image2, twoview_info, correspondences);
+    if (version > 0) {
+      ar(feature_indices);
+    }
   }
 };
 
 }  // namespace theia
 
-CEREAL_CLASS_VERSION(theia::ImagePairMatch, 0);
+CEREAL_CLASS_VERSION(theia::ImagePairMatch, 1);
 
 #endif  // THEIA_MATCHING_IMAGE_PAIR_MATCH_H_
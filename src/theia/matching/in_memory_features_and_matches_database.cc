@@ -45,10 +45,14 @@
 #include <iostream>  // NOLINT
 #include <mutex>     // NOLINT
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "theia/matching/compact_image_pair_match.h"
 #include "theia/matching/image_pair_match.h"
 #include "theia/matching/keypoints_and_descriptors.h"
 #include "theia/util/map_util.h"
+#include "theia/util/memory_usage.h"
 
 namespace theia {
 
@@ -99,6 +103,20 @@ KeypointsAndDescriptors InMemoryFeaturesAndMatchesDatabase::GetFeatures(
 // Set the features for the image.
 void InMemoryFeaturesAndMatchesDatabase::PutFeatures(
     const std::string& image_name, const KeypointsAndDescriptors& features) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto image_id = image_ids_.find(image_name);
+  if (image_id != image_ids_.end() && ContainsKey(features_, image_name)) {
+    // The compact matches of the image refer to the previous keypoints.
+    for (auto it = compact_matches_.begin(); it != compact_matches_.end();) {
+      if (it->first.first != image_id->second &&
+          it->first.second != image_id->second) {
+        ++it;
+        continue;
+      }
+      matches_[it->first] = GetImagePairMatchLocked(it->first);
+      it = compact_matches_.erase(it);
+    }
+  }
   features_[image_name] = features;
 }
 
@@ -116,10 +134,69 @@ size_t InMemoryFeaturesAndMatchesDatabase::NumImages() {
   return features_.size();
 }
 
+uint32_t InMemoryFeaturesAndMatchesDatabase::FindOrAssignImageId(
+    const std::string& image_name) {
+  const auto inserted = image_ids_.emplace(image_name, image_names_.size());
+  if (inserted.second) {
+    image_names_.emplace_back(image_name);
+  }
+  return inserted.first->second;
+}
+
+ImagePairMatch InMemoryFeaturesAndMatchesDatabase::GetImagePairMatchLocked(
+    const ImageIdPair& image_ids) const {
+  const CompactImagePairMatch* compact_match =
+      FindOrNull(compact_matches_, image_ids);
+  if (compact_match == nullptr) {
+    return FindOrDieNoPrint(matches_, image_ids);
+  }
+
+  const std::string& image_name1 = image_names_[image_ids.first];
+  const std::string& image_name2 = image_names_[image_ids.second];
+  ImagePairMatch match;
+  DecompressImagePairMatch(*compact_match,
+                           image_name1,
+                           image_name2,
+                           FindOrDie(features_, image_name1).keypoints,
+                           FindOrDie(features_, image_name2).keypoints,
+                           &match);
+  return match;
+}
+
 // Get the image pair match for the images.
 ImagePairMatch InMemoryFeaturesAndMatchesDatabase::GetImagePairMatch(
     const std::string& image_name1, const std::string& image_name2) {
-  return FindOrDieNoPrint(matches_, std::make_pair(image_name1, image_name2));
+  std::lock_guard<std::mutex> lock(mutex_);
+  const ImageIdPair image_ids(FindOrDie(image_ids_, image_name1),
+                              FindOrDie(image_ids_, image_name2));
+  return GetImagePairMatchLocked(image_ids);
+}
+
+void InMemoryFeaturesAndMatchesDatabase::PutImagePairMatchLocked(
+    const std::string& image_name1,
+    const std::string& image_name2,
+    const ImagePairMatch& matches) {
+  const ImageIdPair image_ids(FindOrAssignImageId(image_name1),
+                              FindOrAssignImageId(image_name2));
+
+  // The match is stored compactly if its correspondences can be restored from
+  // the keypoints of the images.
+  const KeypointsAndDescriptors* features1 = FindOrNull(features_, image_name1);
+  const KeypointsAndDescriptors* features2 = FindOrNull(features_, image_name2);
+  CompactImagePairMatch compact_match;
+  if (features1 != nullptr && features2 != nullptr &&
+      CompressImagePairMatch(matches,
+                             image_ids.first,
+                             image_ids.second,
+                             features1->keypoints,
+                             features2->keypoints,
+                             &compact_match)) {
+    compact_matches_[image_ids] = std::move(compact_match);
+    matches_.erase(image_ids);
+  } else {
+    matches_[image_ids] = matches;
+    compact_matches_.erase(image_ids);
+  }
 }
 
 // Set the image pair match for the images.
@@ -128,21 +205,64 @@ void InMemoryFeaturesAndMatchesDatabase::PutImagePairMatch(
     const std::string& image_name2,
     const ImagePairMatch& matches) {
   std::lock_guard<std::mutex> lock(mutex_);
-  matches_[std::make_pair(image_name1, image_name2)] = matches;
+  PutImagePairMatchLocked(image_name1, image_name2, matches);
 }
 
 std::vector<std::pair<std::string, std::string>>
 InMemoryFeaturesAndMatchesDatabase::ImageNamesOfMatches() {
+  std::lock_guard<std::mutex> lock(mutex_);
   std::vector<std::pair<std::string, std::string>> match_keys;
-  match_keys.reserve(matches_.size());
+  match_keys.reserve(compact_matches_.size() + matches_.size());
+  for (const auto& match : compact_matches_) {
+    match_keys.emplace_back(image_names_[match.first.first],
+                            image_names_[match.first.second]);
+  }
   for (const auto& match : matches_) {
-    match_keys.push_back(match.first);
+    match_keys.emplace_back(image_names_[match.first.first],
+                            image_names_[match.first.second]);
   }
   return match_keys;
 }
 
 size_t InMemoryFeaturesAndMatchesDatabase::NumMatches() {
-  return matches_.size();
+  std::lock_guard<std::mutex> lock(mutex_);
+  return compact_matches_.size() + matches_.size();
+}
+
+size_t InMemoryFeaturesAndMatchesDatabase::MemoryUsage() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t memory_usage = sizeof(*this) + HeapMemoryUsage(intrinsics_priors_) +
+                        HeapMemoryUsage(features_) +
+                        HeapMemoryUsage(image_ids_) +
+                        HeapMemoryUsage(image_names_) +
+                        HeapMemoryUsage(compact_matches_) +
+                        HeapMemoryUsage(matches_);
+  for (const auto& intrinsics_prior : intrinsics_priors_) {
+    memory_usage += HeapMemoryUsage(intrinsics_prior.first);
+  }
+  for (const auto& features : features_) {
+    memory_usage += HeapMemoryUsage(features.first) +
+                    HeapMemoryUsage(features.second.image_name) +
+                    HeapMemoryUsage(features.second.keypoints) +
+                    HeapMemoryUsage(features.second.descriptors);
+    for (const Eigen::VectorXf& descriptor : features.second.descriptors) {
+      memory_usage += HeapMemoryUsage(descriptor);
+    }
+  }
+  for (const auto& image_id : image_ids_) {
+    memory_usage += 2 * HeapMemoryUsage(image_id.first);
+  }
+  for (const auto& match : compact_matches_) {
+    memory_usage += HeapMemoryUsage(match.second.feature_indices) +
+                    HeapMemoryUsage(match.second.inlier_mask);
+  }
+  for (const auto& match : matches_) {
+    memory_usage += HeapMemoryUsage(match.second.image1) +
+                    HeapMemoryUsage(match.second.image2) +
+                    HeapMemoryUsage(match.second.correspondences) +
+                    HeapMemoryUsage(match.second.feature_indices);
+  }
+  return memory_usage;
 }
 
 bool InMemoryFeaturesAndMatchesDatabase::ReadFromFile(
@@ -165,9 +285,9 @@ bool InMemoryFeaturesAndMatchesDatabase::ReadFromFile(
   }
   CHECK_EQ(view_names.size(), camera_intrinsics_prior.size());
 
-  matches_.reserve(matches.size());
+  std::lock_guard<std::mutex> lock(mutex_);
   for (const auto& match : matches) {
-    matches_[std::make_pair(match.image1, match.image2)] = match;
+    PutImagePairMatchLocked(match.image1, match.image2, match);
   }
 
   intrinsics_priors_.reserve(camera_intrinsics_prior.size());
@@ -187,9 +307,15 @@ bool InMemoryFeaturesAndMatchesDatabase::WriteToFile(
     return false;
   }
 
-  // Make sure that Cereal is able to finish executing before returning.
+  // Make sure that Cereal is able to finish executing before returning. The
+  // compact matches are written with their correspondences so that the file
+  // does not depend on the features.
+  std::lock_guard<std::mutex> lock(mutex_);
   std::vector<ImagePairMatch> matches;
-  matches.reserve(matches_.size());
+  matches.reserve(compact_matches_.size() + matches_.size());
+  for (const auto& match : compact_matches_) {
+    matches.emplace_back(GetImagePairMatchLocked(match.first));
+  }
   for (const auto& match : matches_) {
     matches.push_back(match.second);
   }
@@ -211,6 +337,8 @@ bool InMemoryFeaturesAndMatchesDatabase::WriteToFile(
 }
 
 void InMemoryFeaturesAndMatchesDatabase::RemoveAllMatches() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  compact_matches_.clear();
   matches_.clear();
 }
 
@@ -35,13 +35,16 @@
 #ifndef THEIA_MATCHING_IN_MEMORY_FEATURES_AND_MATCHES_DATABASE_H_
 #define THEIA_MATCHING_IN_MEMORY_FEATURES_AND_MATCHES_DATABASE_H_
 
+#include <stdint.h>
 #include <mutex>  // NOLINT
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "theia/io/read_keypoints_and_descriptors.h"
 #include "theia/io/write_keypoints_and_descriptors.h"
+#include "theia/matching/compact_image_pair_match.h"
 #include "theia/matching/features_and_matches_database.h"
 #include "theia/matching/image_pair_match.h"
 #include "theia/matching/keypoints_and_descriptors.h"
@@ -52,6 +55,9 @@
 namespace theia {
 
 // A simple implementation for storing features and feature matches in memory.
+// Matches that were created from the keypoints in the database (i.e. that have
+// feature indices) are stored as CompactImagePairMatch and restored from the
+// keypoints when they are retrieved.
 class InMemoryFeaturesAndMatchesDatabase : public FeaturesAndMatchesDatabase {
  public:
   InMemoryFeaturesAndMatchesDatabase() = default;
@@ -77,7 +83,9 @@ class InMemoryFeaturesAndMatchesDatabase : public FeaturesAndMatchesDatabase {
   // Get/set the features for the image.
   KeypointsAndDescriptors GetFeatures(const std::string& image_name) override;
 
-  // Set the features for the image.
+  // Set the features for the image. If the features of the image are
+  // replaced, its compact matches are restored from the previous keypoints
+  // first.
   void PutFeatures(const std::string& image_name,
                    const KeypointsAndDescriptors& features) override;
 
@@ -104,14 +112,33 @@ class InMemoryFeaturesAndMatchesDatabase : public FeaturesAndMatchesDatabase {
 
   void RemoveAllMatches() override;
 
+  // The features and matches are all held in memory.
+  size_t MemoryUsage() override;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(InMemoryFeaturesAndMatchesDatabase);
 
+  typedef std::pair<uint32_t, uint32_t> ImageIdPair;
+
+  // Returns the id of the image and assigns a new id to unknown images. The
+  // mutex must be held by the caller, as for the other helpers.
+  uint32_t FindOrAssignImageId(const std::string& image_name);
+
+  void PutImagePairMatchLocked(const std::string& image_name1,
+                               const std::string& image_name2,
+                               const ImagePairMatch& matches);
+  ImagePairMatch GetImagePairMatchLocked(const ImageIdPair& image_ids) const;
+
   std::mutex mutex_;
   std::unordered_map<std::string, CameraIntrinsicsPrior> intrinsics_priors_;
   std::unordered_map<std::string, KeypointsAndDescriptors> features_;
-  std::unordered_map<std::pair<std::string, std::string>, ImagePairMatch>
-      matches_;
+
+  // The matches are keyed by the integer ids of the images.
+  std::unordered_map<std::string, uint32_t> image_ids_;
+  std::vector<std::string> image_names_;
+  std::unordered_map<ImageIdPair, CompactImagePairMatch> compact_matches_;
+  // Matches that cannot be restored from the keypoints.
+  std::unordered_map<ImageIdPair, ImagePairMatch> matches_;
 };
 }  // namespace theia
 #endif  // THEIA_MATCHING_IN_MEMORY_FEATURES_AND_MATCHES_DATABASE_H_
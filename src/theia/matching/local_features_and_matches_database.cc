@@ -32,6 +32,7 @@
 // Please contact the author of this library if you have any questions.
 // Author: Chris Sweeney (sweeneychris@gmail.com)
 
+
 #include "theia/matching/local_features_and_matches_database.h"
 
 #include <cereal/archives/portable_binary.hpp>
@@ -41,17 +42,23 @@
 #include <cereal/types/vector.hpp>
 #include <cstdlib>
 #include <fstream>  // NOLINT
+#include <functional>
 #include <glog/logging.h>
 #include <iostream>  // NOLINT
-#include <mutex>
+#include <mutex>     // NOLINT
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "theia/io/feature_file.h"
 #include "theia/io/read_keypoints_and_descriptors.h"
-#include "theia/io/write_keypoints_and_descriptors.h"
+#include "theia/matching/compact_image_pair_match.h"
 #include "theia/matching/image_pair_match.h"
 #include "theia/matching/keypoints_and_descriptors.h"
 #include "theia/util/filesystem.h"
 #include "theia/util/map_util.h"
+#include "theia/util/memory_usage.h"
 #include "theia/util/string.h"
 
 namespace theia {
@@ -60,6 +67,17 @@ inline std::string FeatureFilenameFromImage(const std::string& output_dir,
                                             const std::string& image) {
   return output_dir + image + ".features";
 }
+
+size_t FeaturesMemoryUsage(const KeypointsAndDescriptors& features) {
+  size_t memory_usage = sizeof(features) +
+                        HeapMemoryUsage(features.image_name) +
+                        HeapMemoryUsage(features.keypoints) +
+                        HeapMemoryUsage(features.descriptors);
+  for (const Eigen::VectorXf& descriptor : features.descriptors) {
+    memory_usage += HeapMemoryUsage(descriptor);
+  }
+  return memory_usage;
+}
 }  // namespace
 
 LocalFeaturesAndMatchesDatabase::LocalFeaturesAndMatchesDatabase(
@@ -75,27 +93,71 @@ LocalFeaturesAndMatchesDatabase::LocalFeaturesAndMatchesDatabase(
            "matching: "
         << directory_;
   } else {
-    // Load existing feature files into the database.
+    // Load existing feature files into the database. The image name is the
+    // name of the feature file without the directory and the extension.
     std::vector<std::string> feature_files;
     CHECK(GetFilepathsFromWildcard(FeatureFilenameFromImage(directory_, "*"),
                                    &feature_files));
-    image_names_.insert(feature_files.begin(), feature_files.end());
+    for (const std::string& feature_file : feature_files) {
+      std::string image_name;
+      CHECK(GetFilenameFromFilepath(feature_file, false, &image_name));
+      images_with_features_.insert(image_name);
+    }
   }
 
-  // Initialize the cache.
+  // Initialize the cache. Its entries are measured in bytes so that the cache
+  // can be limited with SetCacheMemoryBudget.
   std::function<KeypointsAndDescriptors(const std::string&)> fetch_images =
       std::bind(&LocalFeaturesAndMatchesDatabase::FetchImages,
                 this,
                 std::placeholders::_1);
   features_cache_.reset(new LRUFeatureCache(fetch_images, max_cache_entries));
+  features_cache_->SetEntrySizeFunction(FeaturesMemoryUsage);
+}
+
+bool LocalFeaturesAndMatchesDatabase::ContainsCameraIntrinsicsPrior(
+    const std::string& image_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ContainsKey(intrinsics_priors_, image_name);
 }
 
-LocalFeaturesAndMatchesDatabase::~LocalFeaturesAndMatchesDatabase() {}
+// Get/set the features for the image.
+CameraIntrinsicsPrior LocalFeaturesAndMatchesDatabase::GetCameraIntrinsicsPrior(
+    const std::string& image_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return FindOrDie(intrinsics_priors_, image_name);
+}
+
+// Set the features for the image.
+void LocalFeaturesAndMatchesDatabase::PutCameraIntrinsicsPrior(
+    const std::string& image_name, const CameraIntrinsicsPrior& intrinsics) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  intrinsics_priors_[image_name] = intrinsics;
+}
+
+// Supply an iterator to iterate over the priors.
+std::vector<std::string>
+LocalFeaturesAndMatchesDatabase::ImageNamesOfCameraIntrinsicsPriors() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> image_names;
+  image_names.reserve(intrinsics_priors_.size());
+  for (const auto& intrinsics : intrinsics_priors_) {
+    image_names.push_back(intrinsics.first);
+  }
+  return image_names;
+}
+
+size_t LocalFeaturesAndMatchesDatabase::NumCameraIntrinsicsPrior() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return intrinsics_priors_.size();
+}
 
 bool LocalFeaturesAndMatchesDatabase::ContainsFeatures(
-    const std::string& image_name) const {
-  return ContainsKey(image_names_, image_name);
+    const std::string& image_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ContainsKey(images_with_features_, image_name);
 }
+
 // Get/set the features for the image.
 KeypointsAndDescriptors LocalFeaturesAndMatchesDatabase::GetFeatures(
     const std::string& image_name) {
@@ -107,33 +169,162 @@ void LocalFeaturesAndMatchesDatabase::PutFeatures(
     const std::string& image_name, const KeypointsAndDescriptors& features) {
   const std::string features_file =
       FeatureFilenameFromImage(directory_, image_name);
-  CHECK(WriteKeypointsAndDescriptors(
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto image_id = image_ids_.find(image_name);
+  if (image_id != image_ids_.end() &&
+      ContainsKey(images_with_features_, image_name)) {
+    // The compact matches of the image refer to the previous keypoints.
+    for (auto it = compact_matches_.begin(); it != compact_matches_.end();) {
+      if (it->first.first != image_id->second &&
+          it->first.second != image_id->second) {
+        ++it;
+        continue;
+      }
+      matches_[it->first] = GetImagePairMatchLocked(it->first);
+      it = compact_matches_.erase(it);
+    }
+  }
+
+  CHECK(WriteFeatureFile(
       features_file, features.keypoints, features.descriptors))
       << "Could not write features for image " << image_name << " to file "
       << features_file;
-  image_names_.insert(image_name);
-  features_cache_->Insert(image_name, features);
+  images_with_features_.insert(image_name);
+
+  // The features are read from the new file once they are requested, so that
+  // extracting the features of many images does not fill the cache.
+  features_cache_->Remove(image_name);
+}
+
+std::vector<KeypointsAndDescriptors>
+LocalFeaturesAndMatchesDatabase::GetFeaturesForImages(
+    const std::vector<std::string>& image_names) {
+  std::vector<KeypointsAndDescriptors> features(image_names.size());
+  std::unordered_map<std::string, int> first_index;
+  for (int i = 0; i < image_names.size(); i++) {
+    const auto inserted = first_index.emplace(image_names[i], i);
+    if (inserted.second) {
+      features[i] = features_cache_->Fetch(image_names[i]);
+    } else {
+      features[i] = features[inserted.first->second];
+    }
+  }
+  return features;
 }
 
 // Supply an iterator to iterate over the features.
-// Supply an iterator to iterate over the features.
-std::vector<std::string> LocalFeaturesAndMatchesDatabase::ImageNamesOfFeatures()
-    const {
-  std::vector<std::string> image_names(image_names_.begin(),
-                                       image_names_.end());
+std::vector<std::string>
+LocalFeaturesAndMatchesDatabase::ImageNamesOfFeatures() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> image_names(images_with_features_.begin(),
+                                       images_with_features_.end());
   return image_names;
 }
 
-size_t LocalFeaturesAndMatchesDatabase::NumImages() const {
-  return image_names_.size();
+size_t LocalFeaturesAndMatchesDatabase::NumImages() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return images_with_features_.size();
+}
+
+uint32_t LocalFeaturesAndMatchesDatabase::FindOrAssignImageId(
+    const std::string& image_name) {
+  const auto inserted = image_ids_.emplace(image_name, image_names_.size());
+  if (inserted.second) {
+    image_names_.emplace_back(image_name);
+  }
+  return inserted.first->second;
+}
+
+bool LocalFeaturesAndMatchesDatabase::GetKeypoints(
+    const std::string& image_name, std::vector<Keypoint>* keypoints) {
+  if (!ContainsKey(images_with_features_, image_name)) {
+    return false;
+  }
+
+  // The descriptors of the feature file are not read.
+  CHECK(ReadKeypoints(FeatureFilenameFromImage(directory_, image_name),
+                      keypoints))
+      << "Could not read the keypoints of image " << image_name;
+  return true;
+}
+
+ImagePairMatch LocalFeaturesAndMatchesDatabase::GetImagePairMatchLocked(
+    const ImageIdPair& image_ids) {
+  const CompactImagePairMatch* compact_match =
+      FindOrNull(compact_matches_, image_ids);
+  if (compact_match == nullptr) {
+    return FindOrDieNoPrint(matches_, image_ids);
+  }
+
+  const std::string& image_name1 = image_names_[image_ids.first];
+  const std::string& image_name2 = image_names_[image_ids.second];
+  std::vector<Keypoint> keypoints1, keypoints2;
+  CHECK(GetKeypoints(image_name1, &keypoints1) &&
+        GetKeypoints(image_name2, &keypoints2))
+      << "The features of the images (" << image_name1 << ", " << image_name2
+      << ") are needed to restore their matches.";
+  ImagePairMatch match;
+  DecompressImagePairMatch(*compact_match,
+                           image_name1,
+                           image_name2,
+                           keypoints1,
+                           keypoints2,
+                           &match);
+  return match;
 }
 
 // Get the image pair match for the images.
 ImagePairMatch LocalFeaturesAndMatchesDatabase::GetImagePairMatch(
     const std::string& image_name1, const std::string& image_name2) {
-  const int match_index = FindOrDieNoPrint(
-      matches_index_, std::make_pair(image_name1, image_name2));
-  return matches_[match_index];
+  std::lock_guard<std::mutex> lock(mutex_);
+  const ImageIdPair image_ids(FindOrDie(image_ids_, image_name1),
+                              FindOrDie(image_ids_, image_name2));
+  return GetImagePairMatchLocked(image_ids);
+}
+
+void LocalFeaturesAndMatchesDatabase::PutImagePairMatchLocked(
+    const std::string& image_name1,
+    const std::string& image_name2,
+    const ImagePairMatch& matches,
+    std::unordered_map<std::string, std::vector<Keypoint>>* keypoints_cache) {
+  const ImageIdPair image_ids(FindOrAssignImageId(image_name1),
+                              FindOrAssignImageId(image_name2));
+
+  // Returns the cached keypoints of the image, or nullptr if the image has no
+  // features.
+  const auto FindOrReadKeypoints =
+      [&](const std::string& image_name) -> const std::vector<Keypoint>* {
+    auto keypoints = keypoints_cache->find(image_name);
+    if (keypoints == keypoints_cache->end()) {
+      std::vector<Keypoint> image_keypoints;
+      if (!GetKeypoints(image_name, &image_keypoints)) {
+        return nullptr;
+      }
+      keypoints =
+          keypoints_cache->emplace(image_name, std::move(image_keypoints))
+              .first;
+    }
+    return &keypoints->second;
+  };
+
+  // The match is stored compactly if its correspondences can be restored from
+  // the keypoints of the images.
+  const std::vector<Keypoint>* keypoints1 = FindOrReadKeypoints(image_name1);
+  const std::vector<Keypoint>* keypoints2 = FindOrReadKeypoints(image_name2);
+  CompactImagePairMatch compact_match;
+  if (keypoints1 != nullptr && keypoints2 != nullptr &&
+      CompressImagePairMatch(matches,
+                             image_ids.first,
+                             image_ids.second,
+                             *keypoints1,
+                             *keypoints2,
+                             &compact_match)) {
+    compact_matches_[image_ids] = std::move(compact_match);
+    matches_.erase(image_ids);
+  } else {
+    matches_[image_ids] = matches;
+    compact_matches_.erase(image_ids);
+  }
 }
 
 // Set the image pair match for the images.
@@ -141,18 +332,19 @@ void LocalFeaturesAndMatchesDatabase::PutImagePairMatch(
     const std::string& image_name1,
     const std::string& image_name2,
     const ImagePairMatch& matches) {
-  const auto name_pair = std::make_pair(image_name1, image_name2);
-
-  // If the match has already been added, perform an update in place.
-  if (ContainsKey(matches_index_, name_pair)) {
-    matches_[matches_index_[name_pair]] = matches;
-    return;
-  }
+  std::unordered_map<std::string, std::vector<Keypoint>> keypoints_cache;
+  std::lock_guard<std::mutex> lock(mutex_);
+  PutImagePairMatchLocked(image_name1, image_name2, matches, &keypoints_cache);
+}
 
-  // Otherwise add the match, potentially resizing the matches container.
+void LocalFeaturesAndMatchesDatabase::PutImagePairMatches(
+    const std::vector<ImagePairMatch>& matches) {
+  std::unordered_map<std::string, std::vector<Keypoint>> keypoints_cache;
   std::lock_guard<std::mutex> lock(mutex_);
-  matches_index_[name_pair] = matches_.size();
-  matches_.push_back(matches);
+  for (const ImagePairMatch& match : matches) {
+    PutImagePairMatchLocked(
+        match.image1, match.image2, match, &keypoints_cache);
+  }
 }
 
 KeypointsAndDescriptors LocalFeaturesAndMatchesDatabase::FetchImages(
@@ -161,77 +353,144 @@ KeypointsAndDescriptors LocalFeaturesAndMatchesDatabase::FetchImages(
   CHECK(ReadKeypointsAndDescriptors(
       FeatureFilenameFromImage(directory_, image_name),
       &features.keypoints,
-      &features.descriptors));
+      &features.descriptors))
+      << "Could not read the features of image " << image_name;
   features.image_name = image_name;
   return features;
 }
 
 std::vector<std::pair<std::string, std::string>>
-LocalFeaturesAndMatchesDatabase::ImageNamesOfMatches() const {
+LocalFeaturesAndMatchesDatabase::ImageNamesOfMatches() {
+  std::lock_guard<std::mutex> lock(mutex_);
   std::vector<std::pair<std::string, std::string>> match_keys;
-  match_keys.reserve(matches_index_.size());
-  for (const auto& match : matches_index_) {
-    match_keys.push_back(match.first);
+  match_keys.reserve(compact_matches_.size() + matches_.size());
+  for (const auto& match : compact_matches_) {
+    match_keys.emplace_back(image_names_[match.first.first],
+                            image_names_[match.first.second]);
+  }
+  for (const auto& match : matches_) {
+    match_keys.emplace_back(image_names_[match.first.first],
+                            image_names_[match.first.second]);
   }
   return match_keys;
 }
 
-size_t LocalFeaturesAndMatchesDatabase::NumMatches() const {
-  return matches_.size();
+size_t LocalFeaturesAndMatchesDatabase::NumMatches() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return compact_matches_.size() + matches_.size();
 }
 
-// Populate this database from the input matches_file, and output the view
-// names and camera intrinsics.
-bool LocalFeaturesAndMatchesDatabase::ReadMatchesAndGeometry(
-    const std::string& matches_file,
-    std::vector<std::string>* view_names,
-    std::vector<CameraIntrinsicsPrior>* camera_intrinsics_prior) {
-  CHECK_NOTNULL(view_names)->clear();
-  CHECK_NOTNULL(camera_intrinsics_prior)->clear();
+size_t LocalFeaturesAndMatchesDatabase::MemoryUsage() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t memory_usage = sizeof(*this) + HeapMemoryUsage(directory_) +
+                        features_cache_->CacheSize() +
+                        HeapMemoryUsage(intrinsics_priors_) +
+                        HeapMemoryUsage(images_with_features_) +
+                        HeapMemoryUsage(image_ids_) +
+                        HeapMemoryUsage(image_names_) +
+                        HeapMemoryUsage(compact_matches_) +
+                        HeapMemoryUsage(matches_);
+  for (const auto& intrinsics_prior : intrinsics_priors_) {
+    memory_usage += HeapMemoryUsage(intrinsics_prior.first);
+  }
+  for (const std::string& image_name : images_with_features_) {
+    memory_usage += HeapMemoryUsage(image_name);
+  }
+  for (const auto& image_id : image_ids_) {
+    memory_usage += 2 * HeapMemoryUsage(image_id.first);
+  }
+  for (const auto& match : compact_matches_) {
+    memory_usage += HeapMemoryUsage(match.second.feature_indices) +
+                    HeapMemoryUsage(match.second.inlier_mask);
+  }
+  for (const auto& match : matches_) {
+    memory_usage += HeapMemoryUsage(match.second.image1) +
+                    HeapMemoryUsage(match.second.image2) +
+                    HeapMemoryUsage(match.second.correspondences) +
+                    HeapMemoryUsage(match.second.feature_indices);
+  }
+  return memory_usage;
+}
 
+void LocalFeaturesAndMatchesDatabase::SetCacheMemoryBudget(
+    const size_t budget_bytes) {
+  // The cache evicts its least recently used features to fit the budget.
+  features_cache_->SetMaxCacheSize(budget_bytes);
+}
+
+bool LocalFeaturesAndMatchesDatabase::ReadFromFile(
+    const std::string& filepath) {
   // Return false if the file cannot be opened.
-  std::ifstream matches_reader(matches_file, std::ios::in | std::ios::binary);
+  std::ifstream matches_reader(filepath, std::ios::in | std::ios::binary);
   if (!matches_reader.is_open()) {
-    LOG(ERROR) << "Could not open the matches file: " << matches_file
+    LOG(ERROR) << "Could not open the matches file: " << filepath
                << " for reading.";
     return false;
   }
 
   // Make sure that Cereal is able to finish executing before returning.
+  std::vector<ImagePairMatch> matches;
+  std::vector<std::string> view_names;
+  std::vector<CameraIntrinsicsPrior> camera_intrinsics_prior;
   {
     cereal::PortableBinaryInputArchive input_archive(matches_reader);
-    input_archive(*view_names, *camera_intrinsics_prior, matches_);
+    input_archive(view_names, camera_intrinsics_prior, matches);
   }
+  CHECK_EQ(view_names.size(), camera_intrinsics_prior.size());
+
+  PutImagePairMatches(matches);
 
-  matches_index_.reserve(matches_.size());
-  for (int i = 0; i < matches_.size(); i++) {
-    const auto name_pair =
-        std::make_pair(matches_[i].image1, matches_[i].image2);
-    matches_index_[name_pair] = i;
+  std::lock_guard<std::mutex> lock(mutex_);
+  intrinsics_priors_.reserve(camera_intrinsics_prior.size());
+  for (int i = 0; i < view_names.size(); i++) {
+    intrinsics_priors_[view_names[i]] = camera_intrinsics_prior[i];
   }
 
   return true;
 }
 
-// Save the matches and geometry to disk.
-bool LocalFeaturesAndMatchesDatabase::SaveMatchesAndGeometry(
-    const std::string& matches_file,
-    const std::vector<std::string>& view_names,
-    const std::vector<CameraIntrinsicsPrior>& camera_intrinsics_prior) {
+bool LocalFeaturesAndMatchesDatabase::WriteToFile(const std::string& filepath) {
   // Return false if the file cannot be opened for writing.
-  std::ofstream matches_writer(matches_file, std::ios::out | std::ios::binary);
+  std::ofstream matches_writer(filepath, std::ios::out | std::ios::binary);
   if (!matches_writer.is_open()) {
-    LOG(ERROR) << "Could not open the matches file: " << matches_file
+    LOG(ERROR) << "Could not open the matches file: " << filepath
                << " for writing.";
     return false;
   }
 
-  // Make sure that Cereal is able to finish executing before returning.
+  // Make sure that Cereal is able to finish executing before returning. The
+  // compact matches are written with their correspondences so that the file
+  // does not depend on the features.
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<ImagePairMatch> matches;
+  matches.reserve(compact_matches_.size() + matches_.size());
+  for (const auto& match : compact_matches_) {
+    matches.emplace_back(GetImagePairMatchLocked(match.first));
+  }
+  for (const auto& match : matches_) {
+    matches.push_back(match.second);
+  }
+
+  std::vector<std::string> view_names;
+  view_names.reserve(intrinsics_priors_.size());
+  std::vector<CameraIntrinsicsPrior> camera_intrinsics_prior;
+  camera_intrinsics_prior.reserve(intrinsics_priors_.size());
+  for (const auto& prior : intrinsics_priors_) {
+    view_names.push_back(prior.first);
+    camera_intrinsics_prior.push_back(prior.second);
+  }
   {
     cereal::PortableBinaryOutputArchive output_archive(matches_writer);
-    output_archive(view_names, camera_intrinsics_prior, matches_);
+    output_archive(view_names, camera_intrinsics_prior, matches);
   }
 
   return true;
 }
+
+void LocalFeaturesAndMatchesDatabase::RemoveAllMatches() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  compact_matches_.clear();
+  matches_.clear();
+}
+
 }  // namespace theia
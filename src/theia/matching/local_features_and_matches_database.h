@@ -32,18 +32,26 @@
 // Please contact the author of this library if you have any questions.
 // Author: Chris Sweeney (sweeneychris@gmail.com)
 
+
 #ifndef THEIA_MATCHING_LOCAL_FEATURES_AND_MATCHES_DATABASE_H_
 #define THEIA_MATCHING_LOCAL_FEATURES_AND_MATCHES_DATABASE_H_
 
+#include <stdint.h>
+#include <memory>
 #include <mutex>  // NOLINT
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "theia/image/keypoint_detector/keypoint.h"
+#include "theia/matching/compact_image_pair_match.h"
 #include "theia/matching/features_and_matches_database.h"
 #include "theia/matching/image_pair_match.h"
 #include "theia/matching/keypoints_and_descriptors.h"
+#include "theia/sfm/camera_intrinsics_prior.h"
+#include "theia/util/hash.h"
 #include "theia/util/lru_cache.h"
 #include "theia/util/util.h"
 
@@ -51,29 +59,59 @@ namespace theia {
 
 // A simple implementation for storing features and feature matches. A local
 // filesystem and cache are used to retrieve the features efficiently. The
-// matches are kept in memory. This class is guaranteed to be thread safe.
+// features of each image are written to a columnar feature file (see
+// theia/io/feature_file.h) in the directory, and feature files written by
+// earlier versions in the cereal format can still be read. The camera
+// intrinsics priors and the matches are kept in memory and may be saved with
+// WriteToFile. Matches that were created from the keypoints in the database
+// are stored as CompactImagePairMatch and restored from the keypoints of the
+// feature files when they are retrieved. This class is guaranteed to be thread
+// safe.
 class LocalFeaturesAndMatchesDatabase : public FeaturesAndMatchesDatabase {
  public:
+  // The feature files already in the directory are added to the database. At
+  // most max_cache_entries features are held in the cache.
   LocalFeaturesAndMatchesDatabase(const std::string& directory,
                                   const int max_cache_entries);
-  ~LocalFeaturesAndMatchesDatabase();
+  ~LocalFeaturesAndMatchesDatabase() = default;
 
-  bool ContainsFeatures(const std::string& image_name) const override;
+  bool ContainsCameraIntrinsicsPrior(const std::string& image_name) override;
 
-  // Get/set the features for the image. Returns true if the features exist in
-  // the database and false otherwise.
-  KeypointsAndDescriptors GetFeatures(const std::string& image_name) override;
+  // Get/set the features for the image.
+  CameraIntrinsicsPrior GetCameraIntrinsicsPrior(
+      const std::string& image_name) override;
 
   // Set the features for the image.
+  void PutCameraIntrinsicsPrior(
+      const std::string& image_name,
+      const CameraIntrinsicsPrior& intrinsics) override;
+
+  // Supply an iterator to iterate over the priors.
+  std::vector<std::string> ImageNamesOfCameraIntrinsicsPriors() override;
+  size_t NumCameraIntrinsicsPrior() override;
+
+  bool ContainsFeatures(const std::string& image_name) override;
+
+  // Get/set the features for the image.
+  KeypointsAndDescriptors GetFeatures(const std::string& image_name) override;
+
+  // Set the features for the image. The features are written to the feature
+  // file of the image, replacing any previous features in the cache. If the
+  // features of the image are replaced, its compact matches are restored from
+  // the previous keypoints first.
   void PutFeatures(const std::string& image_name,
                    const KeypointsAndDescriptors& features) override;
 
+  // Each feature file is read at most once, even if an image is listed several
+  // times or the batch is larger than the cache.
+  std::vector<KeypointsAndDescriptors> GetFeaturesForImages(
+      const std::vector<std::string>& image_names) override;
+
   // Supply an iterator to iterate over the features.
-  std::vector<std::string> ImageNamesOfFeatures() const override;
-  size_t NumImages() const override;
+  std::vector<std::string> ImageNamesOfFeatures() override;
+  size_t NumImages() override;
 
-  // Get the image pair match for the images.Returns true if the features exist
-  // in the database and false otherwise.
+  // Get the image pair match for the images.
   ImagePairMatch GetImagePairMatch(const std::string& image_name1,
                                    const std::string& image_name2) override;
 
@@ -82,35 +120,69 @@ class LocalFeaturesAndMatchesDatabase : public FeaturesAndMatchesDatabase {
                          const std::string& image_name2,
                          const ImagePairMatch& matches) override;
 
+  // Sets all matches while holding the lock once. The keypoints of each image
+  // are read once per batch.
+  void PutImagePairMatches(const std::vector<ImagePairMatch>& matches) override;
+
   std::vector<std::pair<std::string, std::string>> ImageNamesOfMatches()
-      const override;
-  size_t NumMatches() const override;
-
-  // Populate this database from the input matches_file, and output the view
-  // names and camera intrinsics.
-  bool ReadMatchesAndGeometry(
-      const std::string& matches_file,
-      std::vector<std::string>* view_names,
-      std::vector<CameraIntrinsicsPrior>* camera_intrinsics_prior) override;
-
-  // Save the matches and geometry to disk.
-  bool SaveMatchesAndGeometry(const std::string& matches_file,
-                              const std::vector<std::string>& view_names,
-                              const std::vector<CameraIntrinsicsPrior>&
-                                  camera_intrinsics_prior) override;
+      override;
+  size_t NumMatches() override;
+
+  // Reads and writes the camera intrinsics priors and the matches in the same
+  // format as InMemoryFeaturesAndMatchesDatabase.
+  bool ReadFromFile(const std::string& filepath);
+  bool WriteToFile(const std::string& filepath);
+
+  void RemoveAllMatches() override;
+
+  // The memory used by the cached features, the priors and the matches.
+  size_t MemoryUsage() override;
+
+  // Limits the memory used by the cached features. The feature files are not
+  // affected.
+  void SetCacheMemoryBudget(const size_t budget_bytes) override;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(LocalFeaturesAndMatchesDatabase);
   using LRUFeatureCache = LRUCache<std::string, KeypointsAndDescriptors>;
 
+  typedef std::pair<uint32_t, uint32_t> ImageIdPair;
+
+  // Reads the features of the image from its feature file on a cache miss.
   KeypointsAndDescriptors FetchImages(const std::string& image_name);
 
+  // Returns the id of the image and assigns a new id to unknown images. The
+  // mutex must be held by the caller, as for the other helpers.
+  uint32_t FindOrAssignImageId(const std::string& image_name);
+
+  // Reads the keypoints of the image without its descriptors. Returns false if
+  // the database does not contain features for the image.
+  bool GetKeypoints(const std::string& image_name,
+                    std::vector<Keypoint>* keypoints);
+
+  // Stores the match as a compact match if it can be restored from the
+  // keypoints of the images. The keypoints that are read are kept in
+  // keypoints_cache.
+  void PutImagePairMatchLocked(
+      const std::string& image_name1,
+      const std::string& image_name2,
+      const ImagePairMatch& matches,
+      std::unordered_map<std::string, std::vector<Keypoint>>* keypoints_cache);
+  ImagePairMatch GetImagePairMatchLocked(const ImageIdPair& image_ids);
+
   std::string directory_;
   std::unique_ptr<LRUFeatureCache> features_cache_;
-  std::unordered_set<std::string> image_names_;
-  std::unordered_map<std::pair<std::string, std::string>, int> matches_index_;
-  std::vector<ImagePairMatch> matches_;
+
   std::mutex mutex_;
+  std::unordered_map<std::string, CameraIntrinsicsPrior> intrinsics_priors_;
+  std::unordered_set<std::string> images_with_features_;
+
+  // The matches are keyed by the integer ids of the images.
+  std::unordered_map<std::string, uint32_t> image_ids_;
+  std::vector<std::string> image_names_;
+  std::unordered_map<ImageIdPair, CompactImagePairMatch> compact_matches_;
+  // Matches that cannot be restored from the keypoints.
+  std::unordered_map<ImageIdPair, ImagePairMatch> matches_;
 };
 }  // namespace theia
 #endif  // THEIA_MATCHING_LOCAL_FEATURES_AND_MATCHES_DATABASE_H_
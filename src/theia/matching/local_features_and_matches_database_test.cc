@@ -0,0 +1,327 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <algorithm>
+
+#include <algorithm>
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "theia/image/keypoint_detector/keypoint.h"
+#include "theia/matching/image_pair_match.h"
+#include "theia/matching/keypoints_and_descriptors.h"
+#include "theia/matching/local_features_and_matches_database.h"
+#include "theia/sfm/camera_intrinsics_prior.h"
+#include "theia/util/filesystem.h"
+
+namespace theia {
+namespace {
+static const std::string db_directory =
+    THEIA_DATA_DIR + std::string("/local_features_database");
+static const int kMaxCacheEntries = 10;
+
+KeypointsAndDescriptors CreateFeatures(const std::string& image_name,
+                                       const int num_features,
+                                       const double offset = 0.0) {
+  static const int kDescriptorDimension = 8;
+  KeypointsAndDescriptors features;
+  features.image_name = image_name;
+  features.keypoints.resize(num_features);
+  features.descriptors.resize(num_features);
+  for (int i = 0; i < num_features; i++) {
+    features.keypoints[i] = Keypoint(offset + i, i + 1, Keypoint::OTHER);
+    features.keypoints[i].set_scale(0.5 * i);
+    features.keypoints[i].set_orientation(0.1 * i);
+    features.descriptors[i] = Eigen::VectorXf::Random(kDescriptorDimension);
+  }
+  return features;
+}
+
+void ExpectEqualFeatures(const KeypointsAndDescriptors& expected,
+                         const KeypointsAndDescriptors& actual) {
+  EXPECT_EQ(expected.image_name, actual.image_name);
+  ASSERT_EQ(expected.keypoints.size(), actual.keypoints.size());
+  ASSERT_EQ(expected.descriptors.size(), actual.descriptors.size());
+  for (int i = 0; i < expected.keypoints.size(); i++) {
+    EXPECT_EQ(expected.keypoints[i].x(), actual.keypoints[i].x());
+    EXPECT_EQ(expected.keypoints[i].y(), actual.keypoints[i].y());
+    EXPECT_EQ(expected.keypoints[i].scale(), actual.keypoints[i].scale());
+    EXPECT_EQ(expected.keypoints[i].orientation(),
+              actual.keypoints[i].orientation());
+    EXPECT_EQ(expected.descriptors[i], actual.descriptors[i]);
+  }
+}
+
+ImagePairMatch CreateMatch(const std::string& image1,
+                           const std::string& image2) {
+  ImagePairMatch match;
+  match.image1 = image1;
+  match.image2 = image2;
+  match.twoview_info.num_verified_matches = 2;
+  match.correspondences.emplace_back(Feature(1.0, 2.0), Feature(3.0, 4.0));
+  match.correspondences.emplace_back(Feature(5.0, 6.0), Feature(7.0, 8.0));
+  return match;
+}
+
+// Creates a match of the keypoints the same way FeatureMatcher does.
+ImagePairMatch CreateMatchOfFeatures(
+    const KeypointsAndDescriptors& features1,
+    const KeypointsAndDescriptors& features2,
+    const std::vector<FeatureIndexPair>& indices) {
+  ImagePairMatch match;
+  match.image1 = features1.image_name;
+  match.image2 = features2.image_name;
+  match.twoview_info.num_verified_matches = indices.size();
+  match.twoview_info.focal_length_1 = 1000.0;
+  match.feature_indices = indices;
+  for (const FeatureIndexPair& index : indices) {
+    const Keypoint& keypoint1 = features1.keypoints[index.first];
+    const Keypoint& keypoint2 = features2.keypoints[index.second];
+    match.correspondences.emplace_back(Feature(keypoint1.x(), keypoint1.y()),
+                                       Feature(keypoint2.x(), keypoint2.y()));
+  }
+  return match;
+}
+
+void ExpectEqualMatches(const ImagePairMatch& expected,
+                        const ImagePairMatch& actual) {
+  EXPECT_EQ(expected.image1, actual.image1);
+  EXPECT_EQ(expected.image2, actual.image2);
+  EXPECT_EQ(expected.twoview_info.num_verified_matches,
+            actual.twoview_info.num_verified_matches);
+  EXPECT_EQ(expected.twoview_info.focal_length_1,
+            actual.twoview_info.focal_length_1);
+  EXPECT_EQ(expected.feature_indices, actual.feature_indices);
+  ASSERT_EQ(expected.correspondences.size(), actual.correspondences.size());
+  for (int i = 0; i < expected.correspondences.size(); i++) {
+    EXPECT_EQ(expected.correspondences[i], actual.correspondences[i]);
+  }
+}
+
+}  // namespace
+
+TEST(LocalFeaturesAndMatchesDatabase, PutFeatures) {
+  const KeypointsAndDescriptors features = CreateFeatures("image.jpg", 100);
+  {
+    LocalFeaturesAndMatchesDatabase db(db_directory, kMaxCacheEntries);
+    EXPECT_FALSE(db.ContainsFeatures("image.jpg"));
+    db.PutFeatures("image.jpg", features);
+    EXPECT_TRUE(db.ContainsFeatures("image.jpg"));
+    EXPECT_EQ(db.NumImages(), 1);
+    ExpectEqualFeatures(features, db.GetFeatures("image.jpg"));
+
+    // Replacing the features of an image replaces the cached features.
+    const KeypointsAndDescriptors new_features =
+        CreateFeatures("image.jpg", 50);
+    db.PutFeatures("image.jpg", new_features);
+    EXPECT_EQ(db.NumImages(), 1);
+    ExpectEqualFeatures(new_features, db.GetFeatures("image.jpg"));
+  }
+  EXPECT_TRUE(RemoveDirectory(db_directory));
+}
+
+TEST(LocalFeaturesAndMatchesDatabase, GetFeaturesFromExistingDirectory) {
+  const KeypointsAndDescriptors features1 = CreateFeatures("1.jpg", 100);
+  const KeypointsAndDescriptors features2 = CreateFeatures("2.jpg", 20);
+  {
+    LocalFeaturesAndMatchesDatabase db(db_directory, kMaxCacheEntries);
+    db.PutFeatures("1.jpg", features1);
+    db.PutFeatures("2.jpg", features2);
+  }
+
+  // The features are read from the feature files written above.
+  {
+    LocalFeaturesAndMatchesDatabase db(db_directory, kMaxCacheEntries);
+    EXPECT_EQ(db.NumImages(), 2);
+    EXPECT_TRUE(db.ContainsFeatures("1.jpg"));
+    EXPECT_TRUE(db.ContainsFeatures("2.jpg"));
+    std::vector<std::string> image_names = db.ImageNamesOfFeatures();
+    std::sort(image_names.begin(), image_names.end());
+    EXPECT_EQ(image_names, std::vector<std::string>({"1.jpg", "2.jpg"}));
+    ExpectEqualFeatures(features1, db.GetFeatures("1.jpg"));
+    ExpectEqualFeatures(features2, db.GetFeatures("2.jpg"));
+  }
+  EXPECT_TRUE(RemoveDirectory(db_directory));
+}
+
+TEST(LocalFeaturesAndMatchesDatabase, GetFeaturesForImages) {
+  // A cache that is smaller than the batch.
+  LocalFeaturesAndMatchesDatabase db(db_directory, 1);
+  std::vector<KeypointsAndDescriptors> features;
+  for (int i = 0; i < 3; i++) {
+    features.emplace_back(CreateFeatures(std::to_string(i) + ".jpg", 10 + i));
+    db.PutFeatures(features.back().image_name, features.back());
+  }
+
+  const std::vector<std::string> image_names = {
+      "2.jpg", "0.jpg", "2.jpg", "1.jpg"};
+  const std::vector<KeypointsAndDescriptors> db_features =
+      db.GetFeaturesForImages(image_names);
+  ASSERT_EQ(db_features.size(), image_names.size());
+  ExpectEqualFeatures(features[2], db_features[0]);
+  ExpectEqualFeatures(features[0], db_features[1]);
+  ExpectEqualFeatures(features[2], db_features[2]);
+  ExpectEqualFeatures(features[1], db_features[3]);
+  EXPECT_TRUE(RemoveDirectory(db_directory));
+}
+
+TEST(LocalFeaturesAndMatchesDatabase, CacheMemoryBudget) {
+  LocalFeaturesAndMatchesDatabase db(db_directory, kMaxCacheEntries);
+  const KeypointsAndDescriptors features = CreateFeatures("image.jpg", 1000);
+  db.PutFeatures("image.jpg", features);
+  const size_t uncached_memory_usage = db.MemoryUsage();
+
+  // Reading the features caches them.
+  db.GetFeatures("image.jpg");
+  EXPECT_GT(db.MemoryUsage(), uncached_memory_usage + 1000 * sizeof(Keypoint));
+
+  // A budget smaller than the features evicts them, but they can still be read
+  // from their feature file.
+  db.SetCacheMemoryBudget(1000);
+  EXPECT_EQ(db.MemoryUsage(), uncached_memory_usage);
+  ExpectEqualFeatures(features, db.GetFeatures("image.jpg"));
+  EXPECT_EQ(db.MemoryUsage(), uncached_memory_usage);
+  EXPECT_TRUE(RemoveDirectory(db_directory));
+}
+
+TEST(LocalFeaturesAndMatchesDatabase, PutImagePairMatches) {
+  const std::string matches_file = db_directory + "/matches.bin";
+  const std::vector<ImagePairMatch> matches = {CreateMatch("1.jpg", "2.jpg"),
+                                               CreateMatch("1.jpg", "3.jpg"),
+                                               CreateMatch("2.jpg", "3.jpg")};
+  CameraIntrinsicsPrior prior;
+  prior.focal_length.is_set = true;
+  prior.focal_length.value[0] = 1200.0;
+  {
+    LocalFeaturesAndMatchesDatabase db(db_directory, kMaxCacheEntries);
+    db.PutImagePairMatches(matches);
+    db.PutCameraIntrinsicsPrior("1.jpg", prior);
+    EXPECT_EQ(db.NumMatches(), 3);
+    EXPECT_EQ(db.ImageNamesOfMatches().size(), 3);
+    for (const ImagePairMatch& match : matches) {
+      ExpectEqualMatches(match, db.GetImagePairMatch(match.image1,
+                                                     match.image2));
+    }
+    EXPECT_TRUE(db.WriteToFile(matches_file));
+
+    db.RemoveAllMatches();
+    EXPECT_EQ(db.NumMatches(), 0);
+  }
+
+  {
+    LocalFeaturesAndMatchesDatabase db(db_directory, kMaxCacheEntries);
+    EXPECT_TRUE(db.ReadFromFile(matches_file));
+    EXPECT_EQ(db.NumMatches(), 3);
+    for (const ImagePairMatch& match : matches) {
+      ExpectEqualMatches(match, db.GetImagePairMatch(match.image1,
+                                                     match.image2));
+    }
+    EXPECT_EQ(db.NumCameraIntrinsicsPrior(), 1);
+    ASSERT_TRUE(db.ContainsCameraIntrinsicsPrior("1.jpg"));
+    EXPECT_EQ(db.GetCameraIntrinsicsPrior("1.jpg").focal_length.value[0],
+              1200.0);
+  }
+  EXPECT_TRUE(RemoveDirectory(db_directory));
+}
+
+TEST(LocalFeaturesAndMatchesDatabase, CompactMatchesRoundTrip) {
+  static const int kNumFeatures = 1000;
+  const std::string matches_file = db_directory + "/matches.bin";
+  const KeypointsAndDescriptors features1 =
+      CreateFeatures("1.jpg", kNumFeatures, 0.0);
+  const KeypointsAndDescriptors features2 =
+      CreateFeatures("2.jpg", kNumFeatures, 5000.0);
+  std::vector<FeatureIndexPair> indices;
+  for (int i = 0; i < kNumFeatures; i++) {
+    indices.emplace_back(i, kNumFeatures - 1 - i);
+  }
+  const ImagePairMatch match =
+      CreateMatchOfFeatures(features1, features2, indices);
+
+  // A match with an image without features is stored as is.
+  ImagePairMatch uncompressed_match = match;
+  uncompressed_match.image2 = "3.jpg";
+
+  {
+    LocalFeaturesAndMatchesDatabase db(db_directory, kMaxCacheEntries);
+    db.PutFeatures("1.jpg", features1);
+    db.PutFeatures("2.jpg", features2);
+    const size_t memory_usage_without_matches = db.MemoryUsage();
+
+    // The match refers to the keypoints instead of holding its
+    // correspondences.
+    db.PutImagePairMatches({match, uncompressed_match});
+    EXPECT_EQ(db.NumMatches(), 2);
+    EXPECT_LT(db.MemoryUsage(),
+              memory_usage_without_matches +
+                  2 * kNumFeatures * sizeof(FeatureCorrespondence));
+    ExpectEqualMatches(match, db.GetImagePairMatch("1.jpg", "2.jpg"));
+    ExpectEqualMatches(uncompressed_match,
+                       db.GetImagePairMatch("1.jpg", "3.jpg"));
+
+    // Replacing the features of an image keeps the correspondences that were
+    // created from the old keypoints.
+    db.PutFeatures("2.jpg", CreateFeatures("2.jpg", kNumFeatures, 9000.0));
+    EXPECT_EQ(db.NumMatches(), 2);
+    ExpectEqualMatches(match, db.GetImagePairMatch("1.jpg", "2.jpg"));
+
+    // The matches are written with their correspondences.
+    EXPECT_TRUE(db.WriteToFile(matches_file));
+  }
+
+  {
+    LocalFeaturesAndMatchesDatabase db(db_directory, kMaxCacheEntries);
+    EXPECT_TRUE(db.ReadFromFile(matches_file));
+    EXPECT_EQ(db.NumMatches(), 2);
+    ExpectEqualMatches(match, db.GetImagePairMatch("1.jpg", "2.jpg"));
+    ExpectEqualMatches(uncompressed_match,
+                       db.GetImagePairMatch("1.jpg", "3.jpg"));
+
+    std::vector<std::pair<std::string, std::string>> image_names =
+        db.ImageNamesOfMatches();
+    std::sort(image_names.begin(), image_names.end());
+    ASSERT_EQ(image_names.size(), 2);
+    EXPECT_EQ(image_names[0], std::make_pair(std::string("1.jpg"),
+                                             std::string("2.jpg")));
+    EXPECT_EQ(image_names[1], std::make_pair(std::string("1.jpg"),
+                                             std::string("3.jpg")));
+  }
+  EXPECT_TRUE(RemoveDirectory(db_directory));
+}
+
+}  // namespace theia
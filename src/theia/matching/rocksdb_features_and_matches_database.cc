@@ -40,18 +40,26 @@
 #include <glog/logging.h>
 #include <istream>
 #include <mutex>
+#include <ostream>
 #include <streambuf>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <cereal/archives/portable_binary.hpp>
 #include <cereal/types/string.hpp>
 #include <cereal/types/unordered_map.hpp>
 #include <cereal/types/utility.hpp>
 #include <cereal/types/vector.hpp>
+#include <rocksdb/cache.h>
 #include <rocksdb/db.h>
 #include <rocksdb/filter_policy.h>
 #include <rocksdb/table.h>
+#include <rocksdb/write_batch.h>
 
+#include "theia/image/keypoint_detector/keypoint.h"
+#include "theia/matching/compact_image_pair_match.h"
 #include "theia/matching/image_pair_match.h"
 #include "theia/matching/keypoints_and_descriptors.h"
 #include "theia/util/filesystem.h"
@@ -61,12 +69,16 @@
 namespace theia {
 namespace {
 using StringPair = std::pair<std::string, std::string>;
+using ImageIdPair = std::pair<uint32_t, uint32_t>;
 
 static const std::string kFeaturesColumnFamilyName =
     "keypoints_and_descriptors";
 static const std::string kMatchesColumnFamilyName = "image_pair_matches";
+static const std::string kCompactMatchesColumnFamilyName =
+    "compact_image_pair_matches";
 static const std::string kIntrinsicsColumnFamilyName =
     "camera_intrinsics_prior";
+static const std::string kImageIdsColumnFamilyName = "image_ids";
 static const std::string kNamePairSeparator = "/";
 
 // For serialization using the Cereal library we must provide a stream for the
@@ -79,6 +91,57 @@ struct ZeroCopyBuffer : std::streambuf {
   }
 };
 
+// The output counterpart of ZeroCopyBuffer. Cereal writes directly into the
+// string that is handed to RocksDB instead of going through the buffers of a
+// std::stringstream, which would be copied once more by str().
+struct StringOutputBuffer : std::streambuf {
+  explicit StringOutputBuffer(std::string* output) : output(output) {}
+
+  std::streamsize xsputn(const char* data, std::streamsize size) override {
+    output->append(data, size);
+    return size;
+  }
+
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      output->push_back(traits_type::to_char_type(c));
+    }
+    return c;
+  }
+
+  std::string* output;
+};
+
+// Serializes the values into the string with cereal.
+template <typename... Types>
+void Serialize(std::string* output, const Types&... values) {
+  StringOutputBuffer buffer(output);
+  std::ostream outs(&buffer);
+  cereal::PortableBinaryOutputArchive output_archive(outs);
+  output_archive(values...);
+}
+
+// Deserializes the values from the memory owned by RocksDB with cereal.
+template <typename... Types>
+void Deserialize(const rocksdb::Slice& input, Types&... values) {
+  ZeroCopyBuffer buffer(input.data(), input.size());
+  std::istream ins(&buffer);
+  cereal::PortableBinaryInputArchive input_archive(ins);
+  input_archive(values...);
+}
+
+// An upper bound of the serialized size of the features, used to allocate the
+// output buffer once.
+size_t SerializedSizeOfFeatures(const KeypointsAndDescriptors& features) {
+  size_t size = features.image_name.size() + 3 * sizeof(uint64_t);
+  size += features.keypoints.size() *
+          (5 * sizeof(double) + sizeof(int32_t) + sizeof(uint32_t));
+  for (const Eigen::VectorXf& descriptor : features.descriptors) {
+    size += sizeof(uint64_t) + descriptor.size() * sizeof(float);
+  }
+  return size;
+}
+
 // Creates a column family with the specified name and returns the handle.s
 rocksdb::ColumnFamilyHandle* CreateColumnFamily(const rocksdb::Options& options,
                                                 const std::string& column_name,
@@ -98,11 +161,40 @@ StringPair DecomposeImageNamePair(const std::string& image_pair) {
   return std::make_pair(image_pair.substr(0, delimiter_index),
                         image_pair.substr(delimiter_index + 1));
 }
+
+// The keys of the compact matches are the two image ids in big endian order,
+// so that the matches of an image are next to each other.
+std::string ComposeImageIdPair(const uint32_t image_id1,
+                               const uint32_t image_id2) {
+  std::string key(2 * sizeof(uint32_t), '\0');
+  for (int i = 0; i < sizeof(uint32_t); i++) {
+    const int shift = 8 * (sizeof(uint32_t) - 1 - i);
+    key[i] = static_cast<char>((image_id1 >> shift) & 0xFF);
+    key[sizeof(uint32_t) + i] = static_cast<char>((image_id2 >> shift) & 0xFF);
+  }
+  return key;
+}
+
+ImageIdPair DecomposeImageIdPair(const rocksdb::Slice& key) {
+  CHECK_EQ(key.size(), 2 * sizeof(uint32_t));
+  ImageIdPair image_ids(0, 0);
+  for (int i = 0; i < sizeof(uint32_t); i++) {
+    image_ids.first =
+        (image_ids.first << 8) | static_cast<unsigned char>(key[i]);
+    image_ids.second = (image_ids.second << 8) |
+                       static_cast<unsigned char>(key[sizeof(uint32_t) + i]);
+  }
+  return image_ids;
+}
 }  // namespace
 
 RocksDbFeaturesAndMatchesDatabase::RocksDbFeaturesAndMatchesDatabase(
     const std::string& directory)
-    : directory_(directory) {
+    : RocksDbFeaturesAndMatchesDatabase(directory, Options()) {}
+
+RocksDbFeaturesAndMatchesDatabase::RocksDbFeaturesAndMatchesDatabase(
+    const std::string& directory, const Options& options)
+    : database_options_(options), directory_(directory) {
   AppendTrailingSlashIfNeeded(&directory_);
   InitializeRocksDB();
 }
@@ -110,24 +202,39 @@ RocksDbFeaturesAndMatchesDatabase::RocksDbFeaturesAndMatchesDatabase(
 void RocksDbFeaturesAndMatchesDatabase::InitializeRocksDB() {
   options_.reset(new rocksdb::Options);
   // Number of threads for writing to disk.
-  options_->max_background_jobs = 4;
-  options_->db_write_buffer_size = 1 << 30;
+  options_->max_background_jobs = database_options_.max_background_jobs;
+  options_->db_write_buffer_size = database_options_.write_buffer_size_bytes;
   // 1 MB.
   options_->bytes_per_sync = 1 << 20;
   options_->compaction_pri = rocksdb::kMinOverlappingRatio;
   options_->create_if_missing = true;
   options_->level_compaction_dynamic_level_bytes = true;
-  options_->statistics = rocksdb::CreateDBStatistics();
+  if (database_options_.collect_statistics) {
+    options_->statistics = rocksdb::CreateDBStatistics();
+  }
 
+  // The table options are part of the column family options and so they apply
+  // to all column families created with options_.
   rocksdb::BlockBasedTableOptions table_options;
-  // 512 MB.
-  //  table_options.block_cache = rocksdb::NewLRUCache(512 << 20);
-  //  table_options.block_size = 16 * 1024;
-  //  table_options.cache_index_and_filter_blocks = true;
-  //  table_options.pin_l0_filter_and_index_blocks_in_cache = true;
-  //  table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10,
-  //  false)); options_->table_factory.reset(
-  //      rocksdb::NewBlockBasedTableFactory(table_options));
+  if (database_options_.block_cache_size_bytes > 0) {
+    block_cache_ =
+        rocksdb::NewLRUCache(database_options_.block_cache_size_bytes);
+    table_options.block_cache = block_cache_;
+  } else {
+    table_options.no_block_cache = true;
+  }
+  table_options.block_size = database_options_.block_size_bytes;
+  table_options.cache_index_and_filter_blocks = true;
+  table_options.pin_l0_filter_and_index_blocks_in_cache = true;
+  if (database_options_.bloom_filter_bits_per_key > 0) {
+    table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(
+        database_options_.bloom_filter_bits_per_key, false));
+  }
+  options_->table_factory.reset(
+      rocksdb::NewBlockBasedTableFactory(table_options));
+
+  write_options_.reset(new rocksdb::WriteOptions);
+  write_options_->disableWAL = database_options_.disable_write_ahead_log;
 
   // Get column family descriptors to open the database.
   std::vector<rocksdb::ColumnFamilyDescriptor> column_descriptors;
@@ -165,28 +272,102 @@ void RocksDbFeaturesAndMatchesDatabase::InitializeRocksDB() {
   // Take ownership of the database object.
   database_.reset(temp_db);
 
-  // If the DB is new (i.e. no existing column families are present), then we
-  // need to create the column families.
-  if (existing_column_families.empty()) {
-    features_handle_.reset(CreateColumnFamily(
-        *options_, kFeaturesColumnFamilyName, database_.get()));
-    matches_handle_.reset(CreateColumnFamily(
-        *options_, kMatchesColumnFamilyName, database_.get()));
-    intrinsics_prior_handle_.reset(CreateColumnFamily(
-        *options_, kIntrinsicsColumnFamilyName, database_.get()));
-  } else {
-    // Otherwise, set up the mapping for the existing column families in the
-    // database.
-    for (int i = 0; i < temp_col_family_handles.size(); i++) {
-      if (existing_column_families[i] == kFeaturesColumnFamilyName) {
-        features_handle_.reset(temp_col_family_handles[i]);
-      } else if (existing_column_families[i] == kMatchesColumnFamilyName) {
-        matches_handle_.reset(temp_col_family_handles[i]);
-      } else if (existing_column_families[i] == kIntrinsicsColumnFamilyName) {
-        intrinsics_prior_handle_.reset(temp_col_family_handles[i]);
-      }
+  // Set up the mapping for the existing column families in the database.
+  for (int i = 0; i < existing_column_families.size(); i++) {
+    if (existing_column_families[i] == kFeaturesColumnFamilyName) {
+      features_handle_.reset(temp_col_family_handles[i]);
+    } else if (existing_column_families[i] == kMatchesColumnFamilyName) {
+      matches_handle_.reset(temp_col_family_handles[i]);
+    } else if (existing_column_families[i] ==
+               kCompactMatchesColumnFamilyName) {
+      compact_matches_handle_.reset(temp_col_family_handles[i]);
+    } else if (existing_column_families[i] == kIntrinsicsColumnFamilyName) {
+      intrinsics_prior_handle_.reset(temp_col_family_handles[i]);
+    } else if (existing_column_families[i] == kImageIdsColumnFamilyName) {
+      image_ids_handle_.reset(temp_col_family_handles[i]);
+    }
+  }
+
+  // Create the column families that are missing, either because the DB is new
+  // or because it was created by an earlier version without compact matches.
+  const std::pair<std::unique_ptr<rocksdb::ColumnFamilyHandle>*,
+                  const std::string*>
+      column_families[] = {
+          {&features_handle_, &kFeaturesColumnFamilyName},
+          {&matches_handle_, &kMatchesColumnFamilyName},
+          {&compact_matches_handle_, &kCompactMatchesColumnFamilyName},
+          {&intrinsics_prior_handle_, &kIntrinsicsColumnFamilyName},
+          {&image_ids_handle_, &kImageIdsColumnFamilyName}};
+  for (const auto& column_family : column_families) {
+    if (*column_family.first == nullptr) {
+      column_family.first->reset(CreateColumnFamily(
+          *options_, *column_family.second, database_.get()));
+    }
+  }
+
+  // Load the image ids.
+  std::unique_ptr<rocksdb::Iterator> it(
+      database_->NewIterator(rocksdb::ReadOptions(), image_ids_handle_.get()));
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    uint32_t image_id;
+    Deserialize(it->value(), image_id);
+    image_ids_.emplace(it->key().ToString(), image_id);
+    if (image_id >= image_names_.size()) {
+      image_names_.resize(image_id + 1);
     }
+    image_names_[image_id] = it->key().ToString();
+  }
+}
+
+uint32_t RocksDbFeaturesAndMatchesDatabase::FindOrAssignImageId(
+    const std::string& image_name) {
+  std::lock_guard<std::mutex> lock(image_ids_mutex_);
+  const auto inserted = image_ids_.emplace(image_name, image_names_.size());
+  if (!inserted.second) {
+    return inserted.first->second;
+  }
+
+  const uint32_t image_id = inserted.first->second;
+  image_names_.emplace_back(image_name);
+  std::string value;
+  Serialize(&value, image_id);
+  const rocksdb::Status status = database_->Put(
+      *write_options_, image_ids_handle_.get(), image_name, value);
+  CHECK(status.ok()) << "Could not store the id of image " << image_name;
+  return image_id;
+}
+
+bool RocksDbFeaturesAndMatchesDatabase::FindImageId(
+    const std::string& image_name, uint32_t* image_id) {
+  std::lock_guard<std::mutex> lock(image_ids_mutex_);
+  const uint32_t* existing_image_id = FindOrNull(image_ids_, image_name);
+  if (existing_image_id == nullptr) {
+    return false;
+  }
+  *image_id = *existing_image_id;
+  return true;
+}
+
+std::string RocksDbFeaturesAndMatchesDatabase::ImageName(
+    const uint32_t image_id) {
+  std::lock_guard<std::mutex> lock(image_ids_mutex_);
+  CHECK_LT(image_id, image_names_.size());
+  return image_names_[image_id];
+}
+
+bool RocksDbFeaturesAndMatchesDatabase::GetKeypoints(
+    const std::string& image_name, std::vector<Keypoint>* keypoints) {
+  rocksdb::PinnableSlice value;
+  const rocksdb::Status status = database_->Get(
+      rocksdb::ReadOptions(), features_handle_.get(), image_name, &value);
+  if (status.IsNotFound()) {
+    return false;
   }
+
+  // The descriptors follow the keypoints and are not deserialized.
+  std::string stored_image_name;
+  Deserialize(value, stored_image_name, *keypoints);
+  return true;
 }
 
 RocksDbFeaturesAndMatchesDatabase::~RocksDbFeaturesAndMatchesDatabase() {}
@@ -213,34 +394,19 @@ RocksDbFeaturesAndMatchesDatabase::GetCameraIntrinsicsPrior(
   CHECK(!status.IsNotFound())
       << "Could not find intrinsics for " << image_name << " in the database.";
 
-  // Create a stream wrapped around the rocksdb value.
-  ZeroCopyBuffer buffer(value.data(), value.size());
-  std::istream ins(&buffer);
-
-  // Load the keypoints and descriptors.
   CameraIntrinsicsPrior intrinsics_prior;
-  {
-    cereal::PortableBinaryInputArchive input_archive(ins);
-    input_archive(intrinsics_prior);
-  }
-
-  std::string out;
-  database_->GetProperty("rocksdb.estimate-table-readers-mem", &out);
+  Deserialize(value, intrinsics_prior);
   return intrinsics_prior;
 }
 
 // Set the features for the image.
 void RocksDbFeaturesAndMatchesDatabase::PutCameraIntrinsicsPrior(
     const std::string& image_name, const CameraIntrinsicsPrior& intrinsics) {
-  std::stringstream ss;
-  {
-    cereal::PortableBinaryOutputArchive output_archive(ss);
-    output_archive(intrinsics);
-  }
-  rocksdb::WriteOptions options;
+  std::string value;
+  Serialize(&value, intrinsics);
   const rocksdb::Slice key(image_name);
-  const rocksdb::Status status =
-      database_->Put(options, intrinsics_prior_handle_.get(), key, ss.str());
+  const rocksdb::Status status = database_->Put(
+      *write_options_, intrinsics_prior_handle_.get(), key, value);
   CHECK(status.ok()) << "Could not insert intrinsics for " << image_name
                      << " into the database.";
 }
@@ -287,16 +453,36 @@ KeypointsAndDescriptors RocksDbFeaturesAndMatchesDatabase::GetFeatures(
   CHECK(!status.IsNotFound())
       << "Could not find features for " << image_name << " in the database.";
 
-  // Create a stream wrapped around the rocksdb value.
-  ZeroCopyBuffer buffer(value.data(), value.size());
-  std::istream ins(&buffer);
-
   // Load the keypoints and descriptors.
   KeypointsAndDescriptors features;
-  {
-    cereal::PortableBinaryInputArchive input_archive(ins);
-    input_archive(
-        features.image_name, features.keypoints, features.descriptors);
+  Deserialize(
+      value, features.image_name, features.keypoints, features.descriptors);
+  return features;
+}
+
+std::vector<KeypointsAndDescriptors>
+RocksDbFeaturesAndMatchesDatabase::GetFeaturesForImages(
+    const std::vector<std::string>& image_names) {
+  std::vector<rocksdb::Slice> keys;
+  keys.reserve(image_names.size());
+  for (const std::string& image_name : image_names) {
+    keys.emplace_back(image_name);
+  }
+  const std::vector<rocksdb::ColumnFamilyHandle*> column_families(
+      keys.size(), features_handle_.get());
+
+  std::vector<std::string> values;
+  const std::vector<rocksdb::Status> statuses = database_->MultiGet(
+      rocksdb::ReadOptions(), column_families, keys, &values);
+
+  std::vector<KeypointsAndDescriptors> features(image_names.size());
+  for (int i = 0; i < image_names.size(); i++) {
+    CHECK(statuses[i].ok()) << "Could not find features for " << image_names[i]
+                            << " in the database.";
+    Deserialize(values[i],
+                features[i].image_name,
+                features[i].keypoints,
+                features[i].descriptors);
   }
   return features;
 }
@@ -304,17 +490,18 @@ KeypointsAndDescriptors RocksDbFeaturesAndMatchesDatabase::GetFeatures(
 // Set the features for the image.
 void RocksDbFeaturesAndMatchesDatabase::PutFeatures(
     const std::string& image_name, const KeypointsAndDescriptors& features) {
-  std::stringstream ss;
-  {
-    cereal::PortableBinaryOutputArchive output_archive(ss);
-    output_archive(
-        features.image_name, features.keypoints, features.descriptors);
+  if (ContainsFeatures(image_name)) {
+    RestoreCompactMatchesOfImage(image_name);
   }
 
-  rocksdb::WriteOptions options;
+  std::string value;
+  value.reserve(SerializedSizeOfFeatures(features));
+  Serialize(
+      &value, features.image_name, features.keypoints, features.descriptors);
+
   const rocksdb::Slice key(image_name);
   const rocksdb::Status status =
-      database_->Put(options, features_handle_.get(), key, ss.str());
+      database_->Put(*write_options_, features_handle_.get(), key, value);
   CHECK(status.ok()) << "Could not insert features for " << image_name
                      << " into the database.";
 }
@@ -342,28 +529,94 @@ size_t RocksDbFeaturesAndMatchesDatabase::NumImages() {
 // Get the image pair match for the images.
 ImagePairMatch RocksDbFeaturesAndMatchesDatabase::GetImagePairMatch(
     const std::string& image_name1, const std::string& image_name2) {
+  rocksdb::ReadOptions options;
+  rocksdb::PinnableSlice value;
+  ImagePairMatch matches;
+
+  uint32_t image_id1, image_id2;
+  if (FindImageId(image_name1, &image_id1) &&
+      FindImageId(image_name2, &image_id2)) {
+    const std::string image_id_pair = ComposeImageIdPair(image_id1, image_id2);
+    const rocksdb::Status status = database_->Get(
+        options, compact_matches_handle_.get(), image_id_pair, &value);
+    if (status.ok()) {
+      CompactImagePairMatch compact_matches;
+      Deserialize(value, compact_matches);
+      std::vector<Keypoint> keypoints1, keypoints2;
+      CHECK(GetKeypoints(image_name1, &keypoints1) &&
+            GetKeypoints(image_name2, &keypoints2))
+          << "The features of the images (" << image_name1 << ", "
+          << image_name2 << ") are needed to restore their matches.";
+      DecompressImagePairMatch(compact_matches,
+                               image_name1,
+                               image_name2,
+                               keypoints1,
+                               keypoints2,
+                               &matches);
+      return matches;
+    }
+  }
+
   const std::string image_name_pair =
       ComposeImageNamePair(image_name1, image_name2);
-
-  rocksdb::ReadOptions options;
   const rocksdb::Slice key(image_name_pair);
-  rocksdb::PinnableSlice value;
   const rocksdb::Status status =
       database_->Get(options, matches_handle_.get(), key, &value);
   CHECK(!status.IsNotFound()) << "Could not find the image pair match for ("
                               << image_name1 << ", " << image_name2 << ")";
 
-  // Create a stream wrapped around the rocksdb value.
-  ZeroCopyBuffer buffer(value.data(), value.size());
-  std::istream ins(&buffer);
+  Deserialize(value, matches);
+  return matches;
+}
 
-  // Load the keypoints and descriptors.
-  ImagePairMatch matches;
-  {
-    cereal::PortableBinaryInputArchive input_archive(ins);
-    input_archive(matches);
+void RocksDbFeaturesAndMatchesDatabase::AddImagePairMatchToBatch(
+    const std::string& image_name1,
+    const std::string& image_name2,
+    const ImagePairMatch& matches,
+    std::unordered_map<std::string, std::vector<Keypoint>>* keypoints_cache,
+    rocksdb::WriteBatch* batch) {
+  const uint32_t image_id1 = FindOrAssignImageId(image_name1);
+  const uint32_t image_id2 = FindOrAssignImageId(image_name2);
+  const std::string image_id_pair = ComposeImageIdPair(image_id1, image_id2);
+  const std::string image_name_pair =
+      ComposeImageNamePair(image_name1, image_name2);
+
+  // Returns the cached keypoints of the image, or nullptr if the image has no
+  // features.
+  const auto FindOrReadKeypoints =
+      [&](const std::string& image_name) -> const std::vector<Keypoint>* {
+    auto keypoints = keypoints_cache->find(image_name);
+    if (keypoints == keypoints_cache->end()) {
+      std::vector<Keypoint> image_keypoints;
+      if (!GetKeypoints(image_name, &image_keypoints)) {
+        return nullptr;
+      }
+      keypoints =
+          keypoints_cache->emplace(image_name, std::move(image_keypoints))
+              .first;
+    }
+    return &keypoints->second;
+  };
+
+  std::string value;
+  CompactImagePairMatch compact_matches;
+  const std::vector<Keypoint>* keypoints1 = FindOrReadKeypoints(image_name1);
+  const std::vector<Keypoint>* keypoints2 = FindOrReadKeypoints(image_name2);
+  if (keypoints1 != nullptr && keypoints2 != nullptr &&
+      CompressImagePairMatch(matches,
+                             image_id1,
+                             image_id2,
+                             *keypoints1,
+                             *keypoints2,
+                             &compact_matches)) {
+    Serialize(&value, compact_matches);
+    batch->Put(compact_matches_handle_.get(), image_id_pair, value);
+    batch->Delete(matches_handle_.get(), image_name_pair);
+  } else {
+    Serialize(&value, matches);
+    batch->Put(matches_handle_.get(), image_name_pair, value);
+    batch->Delete(compact_matches_handle_.get(), image_id_pair);
   }
-  return matches;
 }
 
 // Set the image pair match for the images.
@@ -371,28 +624,96 @@ void RocksDbFeaturesAndMatchesDatabase::PutImagePairMatch(
     const std::string& image_name1,
     const std::string& image_name2,
     const ImagePairMatch& matches) {
-  const std::string image_name_pair =
-      ComposeImageNamePair(image_name1, image_name2);
+  std::unordered_map<std::string, std::vector<Keypoint>> keypoints_cache;
+  rocksdb::WriteBatch batch;
+  AddImagePairMatchToBatch(
+      image_name1, image_name2, matches, &keypoints_cache, &batch);
+  const rocksdb::Status status = database_->Write(*write_options_, &batch);
+  CHECK(status.ok());
+}
 
-  std::stringstream ss;
-  {
-    cereal::PortableBinaryOutputArchive output_archive(ss);
-    output_archive(matches);
+void RocksDbFeaturesAndMatchesDatabase::PutImagePairMatches(
+    const std::vector<ImagePairMatch>& matches) {
+  if (matches.empty()) {
+    return;
   }
 
-  rocksdb::WriteOptions options;
-  const rocksdb::Slice key(image_name_pair);
-  const rocksdb::Status status =
-      database_->Put(options, matches_handle_.get(), key, ss.str());
+  // All matches are committed together, so writers from different matching
+  // threads are grouped into few writes of the write-ahead log. The keypoints
+  // of each image are read once per batch.
+  std::unordered_map<std::string, std::vector<Keypoint>> keypoints_cache;
+  rocksdb::WriteBatch batch;
+  for (const ImagePairMatch& match : matches) {
+    AddImagePairMatchToBatch(
+        match.image1, match.image2, match, &keypoints_cache, &batch);
+  }
+  const rocksdb::Status status = database_->Write(*write_options_, &batch);
+  CHECK(status.ok()) << "Could not insert " << matches.size()
+                     << " image pair matches into the database.";
+}
+
+void RocksDbFeaturesAndMatchesDatabase::RestoreCompactMatchesOfImage(
+    const std::string& image_name) {
+  uint32_t image_id;
+  if (!FindImageId(image_name, &image_id)) {
+    return;
+  }
+
+  std::vector<Keypoint> keypoints;
+  CHECK(GetKeypoints(image_name, &keypoints));
+  rocksdb::WriteBatch batch;
+  std::string value;
+  std::unique_ptr<rocksdb::Iterator> it(database_->NewIterator(
+      rocksdb::ReadOptions(), compact_matches_handle_.get()));
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    const ImageIdPair image_ids = DecomposeImageIdPair(it->key());
+    if (image_ids.first != image_id && image_ids.second != image_id) {
+      continue;
+    }
+
+    const std::string image_name1 = ImageName(image_ids.first);
+    const std::string image_name2 = ImageName(image_ids.second);
+    std::vector<Keypoint> other_keypoints;
+    const std::string& other_image_name =
+        image_ids.first == image_id ? image_name2 : image_name1;
+    CHECK(GetKeypoints(other_image_name, &other_keypoints));
+
+    CompactImagePairMatch compact_matches;
+    Deserialize(it->value(), compact_matches);
+    ImagePairMatch matches;
+    DecompressImagePairMatch(
+        compact_matches,
+        image_name1,
+        image_name2,
+        image_ids.first == image_id ? keypoints : other_keypoints,
+        image_ids.second == image_id ? keypoints : other_keypoints,
+        &matches);
+
+    value.clear();
+    Serialize(&value, matches);
+    batch.Put(matches_handle_.get(),
+              ComposeImageNamePair(image_name1, image_name2),
+              value);
+    batch.Delete(compact_matches_handle_.get(), it->key());
+  }
+  const rocksdb::Status status = database_->Write(*write_options_, &batch);
   CHECK(status.ok());
 }
 
 std::vector<StringPair>
 RocksDbFeaturesAndMatchesDatabase::ImageNamesOfMatches() {
-  // Iterate over the features column family and grab the keys.
+  // Iterate over the match column families and grab the keys.
   std::vector<StringPair> image_match_names;
-  auto it =
-      database_->NewIterator(rocksdb::ReadOptions(), matches_handle_.get());
+  std::unique_ptr<rocksdb::Iterator> compact_it(database_->NewIterator(
+      rocksdb::ReadOptions(), compact_matches_handle_.get()));
+  for (compact_it->SeekToFirst(); compact_it->Valid(); compact_it->Next()) {
+    const ImageIdPair image_ids = DecomposeImageIdPair(compact_it->key());
+    image_match_names.emplace_back(ImageName(image_ids.first),
+                                   ImageName(image_ids.second));
+  }
+
+  std::unique_ptr<rocksdb::Iterator> it(
+      database_->NewIterator(rocksdb::ReadOptions(), matches_handle_.get()));
   for (it->SeekToFirst(); it->Valid(); it->Next()) {
     image_match_names.push_back(DecomposeImageNamePair(it->key().ToString()));
   }
@@ -401,20 +722,65 @@ RocksDbFeaturesAndMatchesDatabase::ImageNamesOfMatches() {
 }
 
 size_t RocksDbFeaturesAndMatchesDatabase::NumMatches() {
-  std::uint64_t num_matches;
+  std::uint64_t num_compact_matches = 0;
+  database_->GetIntProperty(compact_matches_handle_.get(),
+                            "rocksdb.estimate-num-keys",
+                            &num_compact_matches);
+  std::uint64_t num_matches = 0;
   database_->GetIntProperty(
       matches_handle_.get(), "rocksdb.estimate-num-keys", &num_matches);
-  return static_cast<size_t>(num_matches);
+  return static_cast<size_t>(num_compact_matches + num_matches);
 }
 
 void RocksDbFeaturesAndMatchesDatabase::RemoveAllMatches() {
-  // Drop the column family handle -- this deletes all key/values in the column
-  // family.
+  // Drop the column family handles -- this deletes all key/values in the
+  // column families.
   database_->DropColumnFamily(matches_handle_.get());
+  database_->DropColumnFamily(compact_matches_handle_.get());
 
-  // Add the column family back again.
+  // Add the column families back again.
   matches_handle_.reset(
       CreateColumnFamily(*options_, kMatchesColumnFamilyName, database_.get()));
+  compact_matches_handle_.reset(CreateColumnFamily(
+      *options_, kCompactMatchesColumnFamilyName, database_.get()));
+}
+
+size_t RocksDbFeaturesAndMatchesDatabase::MemoryUsage() {
+  size_t memory_usage = sizeof(*this);
+  if (block_cache_ != nullptr) {
+    memory_usage += block_cache_->GetUsage();
+  }
+
+  rocksdb::ColumnFamilyHandle* handles[] = {intrinsics_prior_handle_.get(),
+                                            features_handle_.get(),
+                                            matches_handle_.get(),
+                                            compact_matches_handle_.get(),
+                                            image_ids_handle_.get()};
+  for (rocksdb::ColumnFamilyHandle* handle : handles) {
+    std::uint64_t memtables_bytes = 0;
+    if (database_->GetIntProperty(handle,
+                                  rocksdb::DB::Properties::kCurSizeAllMemTables,
+                                  &memtables_bytes)) {
+      memory_usage += memtables_bytes;
+    }
+    std::uint64_t table_readers_bytes = 0;
+    if (database_->GetIntProperty(
+            handle,
+            rocksdb::DB::Properties::kEstimateTableReadersMem,
+            &table_readers_bytes)) {
+      memory_usage += table_readers_bytes;
+    }
+  }
+  return memory_usage;
+}
+
+void RocksDbFeaturesAndMatchesDatabase::SetCacheMemoryBudget(
+    const size_t budget_bytes) {
+  if (block_cache_ == nullptr) {
+    return;
+  }
+  // The LRU cache evicts its oldest entries once the capacity is lowered.
+  block_cache_->SetCapacity(budget_bytes);
 }
 
 }  // namespace theia
@@ -34,12 +34,15 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <memory>
 #include <mutex>  // NOLINT
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "theia/image/keypoint_detector/keypoint.h"
 #include "theia/matching/features_and_matches_database.h"
 #include "theia/matching/image_pair_match.h"
 #include "theia/matching/keypoints_and_descriptors.h"
@@ -48,21 +51,62 @@
 #include "theia/util/util.h"
 
 namespace rocksdb {
+class Cache;
 class ColumnFamilyHandle;
 class DB;
 struct Options;
+class WriteBatch;
+struct WriteOptions;
 }  // namespace rocksdb
 
 namespace theia {
 
 #ifdef WITH_ROCKSDB
 
-// A simple implementation for storing features and feature matches. A local
-// filesystem and cache are used to retrieve the features efficiently. The
-// matches are kept in memory. This class is guaranteed to be thread safe.
+// An implementation for storing features and feature matches in a RocksDB
+// database on the local filesystem. Reads go through a shared block cache and
+// bloom filters so that lookups of missing keys rarely touch the disk. Batches
+// of matches are written with a single group commit and batches of features
+// are read with a single MultiGet request. Matches that were created from the
+// keypoints in the database are stored as CompactImagePairMatch and keyed by
+// the integer ids of the images, which are kept in a separate column family.
+// Other matches are stored as is and keyed by the image names. This class is
+// guaranteed to be thread safe, but the features of an image should not be
+// replaced while matches of the image are written.
 class RocksDbFeaturesAndMatchesDatabase : public FeaturesAndMatchesDatabase {
  public:
+  struct Options {
+    // Size of the LRU cache of uncompressed data blocks shared by all column
+    // families. Set to 0 to disable the block cache.
+    size_t block_cache_size_bytes = 512 << 20;
+
+    // Size of the data blocks of the table files. Values of features are
+    // large, so larger blocks reduce the index size without hurting reads.
+    size_t block_size_bytes = 16 << 10;
+
+    // Number of bits per key used for the bloom filters of the table files. A
+    // value of 0 disables bloom filters.
+    int bloom_filter_bits_per_key = 10;
+
+    // Number of background threads used for flushes and compactions.
+    int max_background_jobs = 4;
+
+    // Total size of the memtables of all column families before they are
+    // flushed to disk.
+    size_t write_buffer_size_bytes = 1 << 30;
+
+    // If true, writes skip the write-ahead log. This speeds up ingestion
+    // considerably but writes that have not been flushed are lost if the
+    // process crashes.
+    bool disable_write_ahead_log = false;
+
+    // If true, RocksDB collects statistics about the database operations.
+    bool collect_statistics = false;
+  };
+
   explicit RocksDbFeaturesAndMatchesDatabase(const std::string& directory);
+  RocksDbFeaturesAndMatchesDatabase(const std::string& directory,
+                                    const Options& options);
   ~RocksDbFeaturesAndMatchesDatabase();
 
   bool ContainsCameraIntrinsicsPrior(const std::string& image_name) override;
@@ -86,10 +130,16 @@ class RocksDbFeaturesAndMatchesDatabase : public FeaturesAndMatchesDatabase {
   // the database and false otherwise.
   KeypointsAndDescriptors GetFeatures(const std::string& image_name) override;
 
-  // Set the features for the image.
+  // Set the features for the image. If the features of the image are
+  // replaced, its compact matches are restored from the previous keypoints
+  // first.
   void PutFeatures(const std::string& image_name,
                    const KeypointsAndDescriptors& features) override;
 
+  // Reads the features of all images with a single MultiGet request.
+  std::vector<KeypointsAndDescriptors> GetFeaturesForImages(
+      const std::vector<std::string>& image_names) override;
+
   // Supply an iterator to iterate over the features.
   std::vector<std::string> ImageNamesOfFeatures() override;
   size_t NumImages() override;
@@ -104,23 +154,68 @@ class RocksDbFeaturesAndMatchesDatabase : public FeaturesAndMatchesDatabase {
                          const std::string& image_name2,
                          const ImagePairMatch& matches) override;
 
+  // Writes all matches with a single write batch.
+  void PutImagePairMatches(const std::vector<ImagePairMatch>& matches) override;
+
   std::vector<std::pair<std::string, std::string>> ImageNamesOfMatches()
       override;
   size_t NumMatches() override;
 
   void RemoveAllMatches() override;
 
+  // The memory used by the block cache, the memtables and the readers of the
+  // table files.
+  size_t MemoryUsage() override;
+
+  // Shrinks (or grows) the block cache to the budget. The memtables are bounded
+  // by write_buffer_size_bytes instead.
+  void SetCacheMemoryBudget(const size_t budget_bytes) override;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(RocksDbFeaturesAndMatchesDatabase);
 
   void InitializeRocksDB();
 
+  // Returns the id of the image and assigns (and stores) a new id for unknown
+  // images.
+  uint32_t FindOrAssignImageId(const std::string& image_name);
+  bool FindImageId(const std::string& image_name, uint32_t* image_id);
+  std::string ImageName(const uint32_t image_id);
+
+  // Reads the keypoints of the image without its descriptors. Returns false if
+  // the database does not contain features for the image.
+  bool GetKeypoints(const std::string& image_name,
+                    std::vector<Keypoint>* keypoints);
+
+  // Adds the match to the batch, as a compact match if it can be restored from
+  // the keypoints of the images. The keypoints that are read are kept in
+  // keypoints_cache.
+  void AddImagePairMatchToBatch(
+      const std::string& image_name1,
+      const std::string& image_name2,
+      const ImagePairMatch& matches,
+      std::unordered_map<std::string, std::vector<Keypoint>>* keypoints_cache,
+      rocksdb::WriteBatch* batch);
+
+  // Stores the compact matches of the image as regular matches.
+  void RestoreCompactMatchesOfImage(const std::string& image_name);
+
+  const Options database_options_;
   std::unique_ptr<rocksdb::Options> options_;
+  std::unique_ptr<rocksdb::WriteOptions> write_options_;
+  std::shared_ptr<rocksdb::Cache> block_cache_;
   std::string directory_;
   std::unique_ptr<rocksdb::DB> database_;
   std::unique_ptr<rocksdb::ColumnFamilyHandle> intrinsics_prior_handle_;
   std::unique_ptr<rocksdb::ColumnFamilyHandle> features_handle_;
   std::unique_ptr<rocksdb::ColumnFamilyHandle> matches_handle_;
+  std::unique_ptr<rocksdb::ColumnFamilyHandle> compact_matches_handle_;
+  std::unique_ptr<rocksdb::ColumnFamilyHandle> image_ids_handle_;
+
+  // The ids of the images, which are also stored in the database.
+  std::mutex image_ids_mutex_;
+  std::unordered_map<std::string, uint32_t> image_ids_;
+  std::vector<std::string> image_names_;
 };
 
 #endif  // PYTHON_BUILD
@@ -150,8 +150,66 @@ TEST(RocksDbFeaturesAndMatchesDatabase, ImageNames) {
   rocksdb::DestroyDB(db_directory, rocksdb::Options());
 }
 
+TEST(RocksDbFeaturesAndMatchesDatabase, GetFeaturesForImages) {
+  static const int kNumImages = 10;
+  static const int kNumFeatures = 100;
+
+  RocksDbFeaturesAndMatchesDatabase db(db_directory);
+  std::vector<std::string> image_names;
+  for (int i = 0; i < kNumImages; i++) {
+    KeypointsAndDescriptors features;
+    features.image_name = "image_" + std::to_string(i);
+    for (int j = 0; j < kNumFeatures; j++) {
+      features.keypoints.emplace_back(i, j, Keypoint::OTHER);
+      features.descriptors.emplace_back(Eigen::VectorXf::Random(128));
+    }
+    db.PutFeatures(features.image_name, features);
+    image_names.emplace_back(features.image_name);
+  }
+
+  // The batched read must return the features in the order of the names.
+  std::reverse(image_names.begin(), image_names.end());
+  const std::vector<KeypointsAndDescriptors> db_features =
+      db.GetFeaturesForImages(image_names);
+  ASSERT_EQ(db_features.size(), image_names.size());
+  for (int i = 0; i < image_names.size(); i++) {
+    const KeypointsAndDescriptors features = db.GetFeatures(image_names[i]);
+    EXPECT_EQ(db_features[i].image_name, image_names[i]);
+    ASSERT_EQ(db_features[i].keypoints.size(), kNumFeatures);
+    for (int j = 0; j < kNumFeatures; j++) {
+      EXPECT_EQ(db_features[i].keypoints[j].x(), features.keypoints[j].x());
+      EXPECT_EQ(db_features[i].descriptors[j], features.descriptors[j]);
+    }
+  }
+
+  rocksdb::DestroyDB(db_directory, rocksdb::Options());
+}
+
 TEST(RocksDbFeaturesAndMatchesDatabase, PutMatch) {}
 
+TEST(RocksDbFeaturesAndMatchesDatabase, PutImagePairMatches) {
+  static const int kNumMatches = 100;
+
+  RocksDbFeaturesAndMatchesDatabase db(db_directory);
+  std::vector<ImagePairMatch> matches(kNumMatches);
+  for (int i = 0; i < kNumMatches; i++) {
+    matches[i].image1 = "image_" + std::to_string(i);
+    matches[i].image2 = "image_" + std::to_string(i + 1);
+    matches[i].correspondences.emplace_back(Feature(i, i), Feature(i, i + 1));
+  }
+  db.PutImagePairMatches(matches);
+
+  EXPECT_EQ(db.ImageNamesOfMatches().size(), kNumMatches);
+  for (int i = 0; i < kNumMatches; i++) {
+    const ImagePairMatch match =
+        db.GetImagePairMatch(matches[i].image1, matches[i].image2);
+    ASSERT_EQ(match.correspondences.size(), 1);
+    EXPECT_EQ(match.correspondences[0], matches[i].correspondences[0]);
+  }
+
+  rocksdb::DestroyDB(db_directory, rocksdb::Options());
+}
+
 TEST(RocksDbFeaturesAndMatchesDatabase, GetMatchFromInputDB) {}
 
 TEST(RocksDbFeaturesAndMatchesDatabase, ContainsMatch) {}
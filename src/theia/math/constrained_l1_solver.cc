@@ -41,6 +41,7 @@
 #include <algorithm>
 #include <string>
 
+#include "theia/math/matrix/parallel_sparse_matrix.h"
 #include "theia/math/matrix/sparse_cholesky_llt.h"
 #include "theia/util/stringprintf.h"
 
@@ -78,6 +79,7 @@ ConstrainedL1Solver::ConstrainedL1Solver(
     }
   }
   A_.setFromTriplets(triplets.begin(), triplets.end());
+  products_.reset(new ParallelSparseMatrix(A_, options_.num_threads));
 
   Eigen::SparseMatrix<double> spd_mat(A.cols(), A.cols());
   spd_mat.selfadjointView<Eigen::Upper>().rankUpdate(A_.transpose());
@@ -112,11 +114,16 @@ ConstrainedL1Solver::ConstrainedL1Solver(
 void ConstrainedL1Solver::Solve(Eigen::VectorXd* solution) {
   CHECK_NOTNULL(solution)->resize(A_.cols());
   Eigen::VectorXd& x = *solution;
-  Eigen::VectorXd z(A_.rows()), u(A_.rows());
-  z.setZero();
-  u.setZero();
+  if (!options_.warm_start || z_.size() != A_.rows()) {
+    z_.setZero(A_.rows());
+    u_.setZero(A_.rows());
+  }
+  z_old_.resize(A_.rows());
+  a_times_x_.resize(A_.rows());
+  ax_hat_.resize(A_.rows());
+  residual_.resize(A_.rows());
+  num_iterations_ = 0;
 
-  Eigen::VectorXd a_times_x(A_.rows()), z_old(z.size()), ax_hat(A_.rows());
   // Precompute some convergence terms.
   const double rhs_norm = b_.norm();
   const double primal_abs_tolerance_eps =
@@ -128,9 +135,11 @@ void ConstrainedL1Solver::Solve(Eigen::VectorXd* solution) {
   const std::string row_format =
       "  % 4d     % 4.4e     % 4.4e     % 4.4e     % 4.4e";
 
-  // qp_options.max_num_iterations = 100;
   for (int i = 0; i < options_.max_num_iterations; i++) {
-    x.noalias() = linear_solver_.Solve(A_.transpose() * (b_ + z - u));
+    ++num_iterations_;
+    residual_ = b_ + z_ - u_;
+    products_->TransposeMultiply(residual_, &at_residual_);
+    linear_solver_.Solve(at_residual_, &x);
 
     if (linear_solver_.Info() != Eigen::Success) {
       LOG(ERROR) << "L1 Minimization failed. Could not solve the sparse "
@@ -138,26 +147,30 @@ void ConstrainedL1Solver::Solve(Eigen::VectorXd* solution) {
       return;
     }
 
-    a_times_x.noalias() = A_ * x;
-    ax_hat.noalias() = options_.alpha * a_times_x;
-    ax_hat.noalias() += (1.0 - options_.alpha) * (z + b_);
+    products_->Multiply(x, &a_times_x_);
+    ax_hat_ = options_.alpha * a_times_x_ + (1.0 - options_.alpha) * (z_ + b_);
 
     // Update z and set z_old.
-    std::swap(z, z_old);
-    z.noalias() = ModifiedShrinkage(ax_hat - b_ + u, 1.0 / options_.rho);
+    std::swap(z_, z_old_);
+    residual_ = ax_hat_ - b_ + u_;
+    ModifiedShrinkage(residual_, 1.0 / options_.rho, &z_);
 
     // Update u.
-    u.noalias() += ax_hat - z - b_;
+    u_ += ax_hat_ - z_ - b_;
 
     // Compute the convergence terms.
-    const double r_norm = (a_times_x - z - b_).norm();
-    const double s_norm = (-options_.rho * A_.transpose() * (z - z_old)).norm();
-    const double max_norm = std::max({a_times_x.norm(), z.norm(), rhs_norm});
+    residual_ = a_times_x_ - z_ - b_;
+    const double r_norm = residual_.norm();
+    residual_ = z_ - z_old_;
+    products_->TransposeMultiply(residual_, &at_residual_);
+    const double s_norm = options_.rho * at_residual_.norm();
+    const double max_norm = std::max({a_times_x_.norm(), z_.norm(), rhs_norm});
     const double primal_eps =
         primal_abs_tolerance_eps + options_.relative_tolerance * max_norm;
+    products_->TransposeMultiply(u_, &at_residual_);
     const double dual_eps =
-        dual_abs_tolerance_eps + options_.relative_tolerance *
-                                     (options_.rho * A_.transpose() * u).norm();
+        dual_abs_tolerance_eps +
+        options_.relative_tolerance * options_.rho * at_residual_.norm();
 
     // Log the result to the screen.
     VLOG(2) << theia::StringPrintf(
@@ -169,21 +182,20 @@ void ConstrainedL1Solver::Solve(Eigen::VectorXd* solution) {
   }
 }
 
-Eigen::VectorXd ConstrainedL1Solver::ModifiedShrinkage(
-    const Eigen::VectorXd& vec, const double kappa) {
-  Eigen::VectorXd output(num_l1_residuals_ + num_inequality_constraints_);
-
+void ConstrainedL1Solver::ModifiedShrinkage(const Eigen::VectorXd& vec,
+                                            const double kappa,
+                                            Eigen::VectorXd* shrunk_vec) const {
   // Get an array for the subset of l1 terms in the input vec.
   Eigen::Map<const Eigen::ArrayXd> l1_array(vec.data(), num_l1_residuals_);
   Eigen::Map<const Eigen::ArrayXd> inequality_array(
       vec.data() + num_l1_residuals_, num_inequality_constraints_);
 
   // Compute the L1 proximal operator on the L1 terms.
-  output.head(num_l1_residuals_).array() =
+  shrunk_vec->head(num_l1_residuals_).array() =
       (l1_array - kappa).max(0.0) - (-l1_array - kappa).max(0.0);
   // Project the inequality constraints such that geq_mat * x - geq_vec > 0
-  output.tail(num_inequality_constraints_).array() = inequality_array.max(0.0);
-  return output;
+  shrunk_vec->tail(num_inequality_constraints_).array() =
+      inequality_array.max(0.0);
 }
 
 }  // namespace theia
@@ -39,7 +39,11 @@
 #include <Eigen/SparseCore>
 #include <glog/logging.h>
 
+#include <memory>
+
+#include "theia/math/matrix/parallel_sparse_matrix.h"
 #include "theia/math/matrix/sparse_cholesky_llt.h"
+#include "theia/util/util.h"
 
 namespace theia {
 
@@ -71,6 +75,16 @@ class ConstrainedL1Solver {
     // Stopping criteria.
     double absolute_tolerance = 1e-4;
     double relative_tolerance = 1e-2;
+
+    // Number of threads used for the sparse matrix-vector products of each
+    // iteration.
+    int num_threads = 1;
+
+    // If true, the auxiliary and dual variables of the previous call to Solve()
+    // initialize the next call instead of zero, so that a solve that stopped at
+    // the maximum number of iterations can be continued by calling Solve()
+    // again.
+    bool warm_start = false;
   };
 
   // The linear system along with the equality and inequality constraints.
@@ -83,14 +97,19 @@ class ConstrainedL1Solver {
   // Solve the constrained L1 minimization above.
   void Solve(Eigen::VectorXd* solution);
 
+  // The number of ADMM iterations performed by the last call to Solve(). This
+  // is less than the maximum number of iterations if the solver converged.
+  int NumIterations() const { return num_iterations_; }
+
  private:
   // This method is used for the z-update, which is conveniently an element-wise
   // update. For the terms in vec corresponding to the L1 minimization, we
   // update the values with the L1 proximal mapping (Shrinkage) operator. The
   // terms corresponding to the inequality constraints are constrained to be
-  // greater than zero as vec = max(vec, 0).
-  Eigen::VectorXd ModifiedShrinkage(const Eigen::VectorXd& vec,
-                                    const double kappa);
+  // greater than zero as vec = max(vec, 0). The output is written in place.
+  void ModifiedShrinkage(const Eigen::VectorXd& vec,
+                         const double kappa,
+                         Eigen::VectorXd* shrunk_vec) const;
 
   const Options options_;
   const int num_l1_residuals_;
@@ -99,10 +118,18 @@ class ConstrainedL1Solver {
   // Matrix A where || Ax - b ||_1 is the problem we are solving.
   Eigen::SparseMatrix<double> A_;
   Eigen::VectorXd b_;
+  std::unique_ptr<ParallelSparseMatrix> products_;
 
   // Cholesky linear solver. Since our linear system will be a SPD matrix we can
   // utilize the Cholesky factorization.
   SparseCholeskyLLt linear_solver_;
+
+  // The ADMM variables and temporaries, allocated once so that the iterations
+  // do not allocate memory.
+  Eigen::VectorXd z_, u_, z_old_, a_times_x_, ax_hat_, residual_, at_residual_;
+  int num_iterations_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(ConstrainedL1Solver);
 };
 
 }  // namespace theia
@@ -43,6 +43,7 @@
 #include <unordered_set>
 
 #include "theia/util/map_util.h"
+#include "theia/util/memory_usage.h"
 
 namespace theia {
 
@@ -131,6 +132,12 @@ class ConnectedComponents {
     return root1->id == root2->id;
   }
 
+  // Returns the approximate number of bytes of memory used by the disjoint
+  // sets.
+  size_t MemoryUsage() const {
+    return sizeof(*this) + HeapMemoryUsage(disjoint_set_);
+  }
+
  private:
   // Attempts to find the root of the tree, or otherwise inserts the node.
   Root* FindOrInsert(const T& node) {
@@ -40,10 +40,13 @@
 #include <glog/logging.h>
 
 #include <algorithm>
+#include <cmath>
 #include <string>
 
+#include "theia/math/matrix/parallel_sparse_matrix.h"
 #include "theia/math/matrix/sparse_cholesky_llt.h"
 #include "theia/util/stringprintf.h"
+#include "theia/util/util.h"
 
 namespace theia {
 
@@ -62,6 +65,46 @@ inline void Compute(const Eigen::MatrixXd& spd_mat,
   linear_solver->Compute(spd_mat.sparseView());
 }
 
+// Products with A and A^T. Sparse matrices are multiplied with multiple
+// threads while dense matrices use the Eigen products.
+template <class MatrixType>
+class MatrixVectorProducts;
+
+template <>
+class MatrixVectorProducts<Eigen::SparseMatrix<double> > {
+ public:
+  MatrixVectorProducts(const Eigen::SparseMatrix<double>& mat,
+                       const int num_threads)
+      : mat_(mat, num_threads) {}
+
+  void Multiply(const Eigen::VectorXd& x, Eigen::VectorXd* y) const {
+    mat_.Multiply(x, y);
+  }
+  void TransposeMultiply(const Eigen::VectorXd& x, Eigen::VectorXd* y) const {
+    mat_.TransposeMultiply(x, y);
+  }
+
+ private:
+  ParallelSparseMatrix mat_;
+};
+
+template <>
+class MatrixVectorProducts<Eigen::MatrixXd> {
+ public:
+  MatrixVectorProducts(const Eigen::MatrixXd& mat, const int num_threads)
+      : mat_(mat) {}
+
+  void Multiply(const Eigen::VectorXd& x, Eigen::VectorXd* y) const {
+    y->noalias() = mat_ * x;
+  }
+  void TransposeMultiply(const Eigen::VectorXd& x, Eigen::VectorXd* y) const {
+    y->noalias() = mat_.transpose() * x;
+  }
+
+ private:
+  const Eigen::MatrixXd& mat_;
+};
+
 }  // namespace l1_solver_internal
 
 // An L1 norm approximation solver. This class will attempt to solve the
@@ -95,21 +138,48 @@ class L1Solver {
 
     double absolute_tolerance = 1e-4;
     double relative_tolerance = 1e-2;
+
+    // Number of threads used for the sparse matrix-vector products of each
+    // iteration.
+    int num_threads = 1;
+
+    // If true, the auxiliary and dual variables of the previous call to Solve()
+    // initialize the next call instead of zero. This speeds up convergence when
+    // Solve() is called repeatedly with slowly changing right hand sides, e.g.
+    // in the outer iterations of a robust rotation estimator.
+    bool warm_start = false;
   };
 
   L1Solver(const Options& options, const MatrixType& mat)
-      : options_(options), a_(mat) {
+      : L1Solver(options, mat, nullptr) {}
+
+  // Same as above, but A^T * A is factorized with the given linear solver
+  // instead of one owned by the L1 solver. If the linear solver has already
+  // analyzed a matrix with the same sparsity pattern, the symbolic analysis is
+  // reused. The linear solver must outlive the L1 solver.
+  L1Solver(const Options& options,
+           const MatrixType& mat,
+           SparseCholeskyLLt* linear_solver)
+      : options_(options),
+        a_(mat),
+        products_(a_, options.num_threads),
+        linear_solver_(linear_solver != nullptr ? linear_solver
+                                                : &owned_linear_solver_) {
     // Analyze the sparsity pattern once. Only the values of the entries will be
     // changed with each iteration.
     const MatrixType spd_mat = a_.transpose() * a_;
-    l1_solver_internal::Compute(spd_mat, &linear_solver_);
-    CHECK_EQ(linear_solver_.Info(), Eigen::Success);
+    l1_solver_internal::Compute(spd_mat, linear_solver_);
+    CHECK_EQ(linear_solver_->Info(), Eigen::Success);
   }
 
   void SetMaxIterations(const int max_iterations) {
     options_.max_num_iterations = max_iterations;
   }
 
+  // The number of ADMM iterations performed by the last call to Solve(). This
+  // is less than the maximum number of iterations if the solver converged.
+  int NumIterations() const { return num_iterations_; }
+
   // Solves ||Ax - b||_1 for the optimial L1 solution given an initial guess for
   // x. To solve this we introduce an auxillary variable y such that the
   // solution to:
@@ -117,14 +187,23 @@ class L1Solver {
   //   s.t. [  A   -I ] [ x ] < [  b ]
   //        [ -A   -I ] [ y ]   [ -b ]
   // which is an equivalent linear program.
+  //
+  // All temporaries are members of the solver so that the iterations do not
+  // allocate memory.
   void Solve(const Eigen::VectorXd& rhs, Eigen::VectorXd* solution) {
     CHECK_NOTNULL(solution);
     Eigen::VectorXd& x = *solution;
-    Eigen::VectorXd z(a_.rows()), u(a_.rows());
-    z.setZero();
-    u.setZero();
+    const int num_rows = a_.rows();
+    if (!options_.warm_start || z_.size() != num_rows) {
+      z_.setZero(num_rows);
+      u_.setZero(num_rows);
+    }
+    z_old_.resize(num_rows);
+    a_times_x_.resize(num_rows);
+    ax_hat_.resize(num_rows);
+    residual_.resize(num_rows);
+    num_iterations_ = 0;
 
-    Eigen::VectorXd a_times_x(a_.rows()), z_old(z.size()), ax_hat(a_.rows());
     // Precompute some convergence terms.
     const double rhs_norm = rhs.norm();
     const double primal_abs_tolerance_eps =
@@ -136,35 +215,43 @@ class L1Solver {
     const std::string row_format =
         "  % 4d     % 4.4e     % 4.4e     % 4.4e     % 4.4e";
     for (int i = 0; i < options_.max_num_iterations; i++) {
+      ++num_iterations_;
       // Update x.
-      x.noalias() = linear_solver_.Solve(a_.transpose() * (rhs + z - u));
-      if (linear_solver_.Info() != Eigen::Success) {
+      residual_ = rhs + z_ - u_;
+      products_.TransposeMultiply(residual_, &at_residual_);
+      linear_solver_->Solve(at_residual_, &x);
+      if (linear_solver_->Info() != Eigen::Success) {
         LOG(ERROR) << "L1 Minimization failed. Could not solve the sparse "
                       "linear system with Cholesky Decomposition";
         return;
       }
 
-      a_times_x.noalias() = a_ * x;
-      ax_hat.noalias() = options_.alpha * a_times_x;
-      ax_hat.noalias() += (1.0 - options_.alpha) * (z + rhs);
+      products_.Multiply(x, &a_times_x_);
+      ax_hat_ =
+          options_.alpha * a_times_x_ + (1.0 - options_.alpha) * (z_ + rhs);
 
       // Update z and set z_old.
-      std::swap(z, z_old);
-      z.noalias() = Shrinkage(ax_hat - rhs + u, 1.0 / options_.rho);
+      std::swap(z_, z_old_);
+      residual_ = ax_hat_ - rhs + u_;
+      Shrinkage(residual_, 1.0 / options_.rho, &z_);
 
       // Update u.
-      u.noalias() += ax_hat - z - rhs;
+      u_ += ax_hat_ - z_ - rhs;
 
       // Compute the convergence terms.
-      const double r_norm = (a_times_x - z - rhs).norm();
-      const double s_norm =
-          (-options_.rho * a_.transpose() * (z - z_old)).norm();
-      const double max_norm = std::max({a_times_x.norm(), z.norm(), rhs_norm});
+      residual_ = a_times_x_ - z_ - rhs;
+      const double r_norm = residual_.norm();
+      residual_ = z_ - z_old_;
+      products_.TransposeMultiply(residual_, &at_residual_);
+      const double s_norm = options_.rho * at_residual_.norm();
+      const double max_norm =
+          std::max({a_times_x_.norm(), z_.norm(), rhs_norm});
       const double primal_eps =
           primal_abs_tolerance_eps + options_.relative_tolerance * max_norm;
-      const double dual_eps = dual_abs_tolerance_eps +
-                              options_.relative_tolerance *
-                                  (options_.rho * a_.transpose() * u).norm();
+      products_.TransposeMultiply(u_, &at_residual_);
+      const double dual_eps =
+          dual_abs_tolerance_eps +
+          options_.relative_tolerance * options_.rho * at_residual_.norm();
 
       // Log the result to the screen.
       VLOG(2) << StringPrintf(
@@ -181,17 +268,26 @@ class L1Solver {
 
   // Matrix A where || Ax - b ||_1 is the problem we are solving.
   MatrixType a_;
+  l1_solver_internal::MatrixVectorProducts<MatrixType> products_;
 
   // Cholesky linear solver. Since our linear system will be a SPD matrix we can
   // utilize the Cholesky factorization.
-  SparseCholeskyLLt linear_solver_;
+  SparseCholeskyLLt owned_linear_solver_;
+  SparseCholeskyLLt* linear_solver_;
+
+  // The ADMM variables and temporaries.
+  Eigen::VectorXd z_, u_, z_old_, a_times_x_, ax_hat_, residual_, at_residual_;
+  int num_iterations_ = 0;
 
-  Eigen::VectorXd Shrinkage(const Eigen::VectorXd& vec, const double kappa) {
-    Eigen::ArrayXd zero_vec(vec.size());
-    zero_vec.setZero();
-    return zero_vec.max(vec.array() - kappa) -
-           zero_vec.max(-vec.array() - kappa);
+  // The proximal operator of the L1 norm, computed in place.
+  void Shrinkage(const Eigen::VectorXd& vec,
+                 const double kappa,
+                 Eigen::VectorXd* shrunk_vec) {
+    shrunk_vec->array() =
+        (vec.array() - kappa).max(0.0) - (-vec.array() - kappa).max(0.0);
   }
+
+  DISALLOW_COPY_AND_ASSIGN(L1Solver);
 };
 
 }  // namespace theia
@@ -35,6 +35,9 @@
 #include "gtest/gtest.h"
 #include <Eigen/Core>
 #include <Eigen/LU>
+#include <Eigen/SparseCore>
+
+#include <vector>
 
 #include "theia/math/l1_solver.h"
 #include "theia/util/random.h"
@@ -131,4 +134,104 @@ TEST(L1Solver, Decoding) {
   }
 }
 
+// The same decoding problem solved as a sparse problem with multiple threads.
+// The symbolic analysis is shared through an external linear solver and the
+// solver is warm started from the previous solve.
+TEST(L1Solver, SparseDecodingWithThreadsAndWarmStart) {
+  RandomNumberGenerator rng(94);
+  static const double kTolerance = 1e-8;
+
+  static const int source_length = 256;
+  static const int codeword_length = 4 * source_length;
+  static const int num_pertubations = 0.2 * codeword_length;
+
+  Eigen::MatrixXd mat(codeword_length, source_length);
+  rng.SetRandom(&mat);
+  Eigen::VectorXd source_word(source_length);
+  rng.SetRandom(&source_word);
+  const Eigen::VectorXd code_word = mat * source_word;
+
+  Eigen::VectorXd observation = code_word;
+  for (int i = 0; i < num_pertubations; i++) {
+    const int rand_entry = rng.RandInt(0, observation.size() - 1);
+    observation(rand_entry) = rng.RandDouble(-0.5, 0.5);
+  }
+
+  const Eigen::SparseMatrix<double> sparse_mat = mat.sparseView();
+  SparseCholeskyLLt linear_solver;
+  L1Solver<Eigen::SparseMatrix<double> >::Options options;
+  options.absolute_tolerance = 1e-8;
+  options.relative_tolerance = 1e-8;
+  options.num_threads = 4;
+  options.warm_start = true;
+  options.max_num_iterations = 100;
+  L1Solver<Eigen::SparseMatrix<double> > l1_solver(
+      options, sparse_mat, &linear_solver);
+  EXPECT_TRUE(linear_solver.HasAnalyzedPattern(
+      Eigen::SparseMatrix<double>(sparse_mat.transpose() * sparse_mat)));
+
+  // Solve in several short calls that continue from the previous state.
+  Eigen::VectorXd solution(source_length);
+  for (int i = 0; i < 10; i++) {
+    l1_solver.Solve(observation, &solution);
+  }
+
+  const Eigen::VectorXd residual = mat * solution - code_word;
+  for (int i = 0; i < residual.size(); i++) {
+    EXPECT_NEAR(residual(i), 0.0, kTolerance);
+  }
+}
+
+// After the outliers of the decoding problem change slightly, a solver that is
+// warm started from the previous solution converges in fewer iterations than a
+// solver that starts from zero.
+TEST(L1Solver, WarmStartConvergesInFewerIterations) {
+  RandomNumberGenerator rng(94);
+  static const double kTolerance = 1e-6;
+
+  static const int source_length = 128;
+  static const int codeword_length = 4 * source_length;
+  static const int num_pertubations = 0.2 * codeword_length;
+
+  Eigen::MatrixXd mat(codeword_length, source_length);
+  rng.SetRandom(&mat);
+  Eigen::VectorXd source_word(source_length);
+  rng.SetRandom(&source_word);
+  const Eigen::VectorXd code_word = mat * source_word;
+
+  Eigen::VectorXd observation = code_word;
+  std::vector<int> perturbed_entries(num_pertubations);
+  for (int i = 0; i < num_pertubations; i++) {
+    perturbed_entries[i] = rng.RandInt(0, observation.size() - 1);
+    observation(perturbed_entries[i]) = rng.RandDouble(-0.5, 0.5);
+  }
+
+  const Eigen::SparseMatrix<double> sparse_mat = mat.sparseView();
+  L1Solver<Eigen::SparseMatrix<double> >::Options options;
+  options.absolute_tolerance = 1e-8;
+  options.relative_tolerance = 1e-8;
+  options.warm_start = true;
+  L1Solver<Eigen::SparseMatrix<double> > warm_solver(options, sparse_mat);
+  Eigen::VectorXd warm_solution(source_length);
+  warm_solver.Solve(observation, &warm_solution);
+
+  for (const int entry : perturbed_entries) {
+    observation(entry) += rng.RandDouble(-0.01, 0.01);
+  }
+  warm_solver.Solve(observation, &warm_solution);
+
+  options.warm_start = false;
+  L1Solver<Eigen::SparseMatrix<double> > cold_solver(options, sparse_mat);
+  Eigen::VectorXd cold_solution(source_length);
+  cold_solver.Solve(observation, &cold_solution);
+
+  EXPECT_LT(warm_solver.NumIterations(), cold_solver.NumIterations());
+  const Eigen::VectorXd warm_residual = mat * warm_solution - code_word;
+  const Eigen::VectorXd cold_residual = mat * cold_solution - code_word;
+  for (int i = 0; i < codeword_length; i++) {
+    EXPECT_NEAR(warm_residual(i), 0.0, kTolerance);
+    EXPECT_NEAR(cold_residual(i), 0.0, kTolerance);
+  }
+}
+
 }  // namespace theia
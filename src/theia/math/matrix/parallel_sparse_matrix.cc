@@ -0,0 +1,139 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/math/matrix/parallel_sparse_matrix.h"
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "theia/util/threadpool.h"
+
+namespace theia {
+
+namespace {
+
+// Matrices with fewer non-zero entries than this are multiplied on the calling
+// thread.
+const int kMinNumNonZerosForParallelProduct = 20000;
+
+// Computes y(i) = A.row(i) * x for rows in [begin_row, end_row).
+void MultiplyRows(const Eigen::SparseMatrix<double, Eigen::RowMajor>& matrix,
+                  const Eigen::VectorXd& x,
+                  const int begin_row,
+                  const int end_row,
+                  Eigen::VectorXd* y) {
+  for (int row = begin_row; row < end_row; row++) {
+    double sum = 0.0;
+    for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(matrix,
+                                                                        row);
+         it;
+         ++it) {
+      sum += it.value() * x[it.index()];
+    }
+    (*y)[row] = sum;
+  }
+}
+
+}  // namespace
+
+ParallelSparseMatrix::ParallelSparseMatrix(
+    const Eigen::SparseMatrix<double>& matrix, const int num_threads)
+    : matrix_(matrix),
+      transpose_(matrix.transpose()),
+      num_threads_(std::max(1, num_threads)) {
+  matrix_.makeCompressed();
+  transpose_.makeCompressed();
+  if (matrix_.nonZeros() < kMinNumNonZerosForParallelProduct) {
+    num_threads_ = 1;
+  }
+  matrix_block_begin_rows_ = PartitionRows(matrix_);
+  transpose_block_begin_rows_ = PartitionRows(transpose_);
+}
+
+ParallelSparseMatrix::~ParallelSparseMatrix() {}
+
+void ParallelSparseMatrix::Multiply(const Eigen::VectorXd& x,
+                                    Eigen::VectorXd* y) const {
+  CHECK_EQ(x.size(), matrix_.cols());
+  MultiplyRowMajor(matrix_, matrix_block_begin_rows_, x, y);
+}
+
+void ParallelSparseMatrix::TransposeMultiply(const Eigen::VectorXd& x,
+                                             Eigen::VectorXd* y) const {
+  CHECK_EQ(x.size(), transpose_.cols());
+  MultiplyRowMajor(transpose_, transpose_block_begin_rows_, x, y);
+}
+
+std::vector<int> ParallelSparseMatrix::PartitionRows(
+    const RowMajorSparseMatrix& matrix) const {
+  std::vector<int> block_begin_rows = {0};
+  if (num_threads_ == 1) {
+    block_begin_rows.emplace_back(matrix.rows());
+    return block_begin_rows;
+  }
+
+  // Each thread processes a contiguous block of rows with roughly the same
+  // number of non-zero entries.
+  const int* outer_index = matrix.outerIndexPtr();
+  const int num_non_zeros_per_block =
+      (matrix.nonZeros() + num_threads_ - 1) / num_threads_;
+  while (block_begin_rows.back() < matrix.rows()) {
+    const int begin_row = block_begin_rows.back();
+    const int* end_row_ptr =
+        std::lower_bound(outer_index + begin_row + 1,
+                         outer_index + matrix.rows(),
+                         outer_index[begin_row] + num_non_zeros_per_block);
+    block_begin_rows.emplace_back(end_row_ptr - outer_index);
+  }
+  return block_begin_rows;
+}
+
+void ParallelSparseMatrix::MultiplyRowMajor(
+    const RowMajorSparseMatrix& matrix,
+    const std::vector<int>& block_begin_rows,
+    const Eigen::VectorXd& x,
+    Eigen::VectorXd* y) const {
+  CHECK_NOTNULL(y)->resize(matrix.rows());
+  if (num_threads_ == 1) {
+    MultiplyRows(matrix, x, 0, matrix.rows(), y);
+    return;
+  }
+
+  ParallelFor(num_threads_, block_begin_rows.size() - 1, [&](const int i) {
+    MultiplyRows(matrix, x, block_begin_rows[i], block_begin_rows[i + 1], y);
+  });
+}
+
+}  // namespace theia
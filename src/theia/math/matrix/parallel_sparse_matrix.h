@@ -0,0 +1,94 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_MATH_MATRIX_PARALLEL_SPARSE_MATRIX_H_
+#define THEIA_MATH_MATRIX_PARALLEL_SPARSE_MATRIX_H_
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <vector>
+
+#include "theia/util/util.h"
+
+namespace theia {
+
+// A sparse matrix that computes the products A * x and A^T * x with multiple
+// threads. Row-major copies of A and A^T are stored so that both products are
+// computed row by row. The rows are split into contiguous blocks that are
+// processed in parallel, so each thread writes to a disjoint part of the output
+// and no reduction is needed. The blocks are computed once at construction, so
+// the products do not allocate memory. This is useful for iterative solvers
+// (e.g. ADMM) that multiply by the same matrix many times.
+class ParallelSparseMatrix {
+ public:
+  ParallelSparseMatrix(const Eigen::SparseMatrix<double>& matrix,
+                       const int num_threads);
+  ~ParallelSparseMatrix();
+
+  // y = A * x. The output is resized if necessary.
+  void Multiply(const Eigen::VectorXd& x, Eigen::VectorXd* y) const;
+
+  // y = A^T * x. The output is resized if necessary.
+  void TransposeMultiply(const Eigen::VectorXd& x, Eigen::VectorXd* y) const;
+
+  int num_rows() const { return matrix_.rows(); }
+  int num_cols() const { return matrix_.cols(); }
+
+ private:
+  typedef Eigen::SparseMatrix<double, Eigen::RowMajor> RowMajorSparseMatrix;
+
+  // Splits the rows of the matrix into num_threads_ contiguous blocks with
+  // roughly the same number of non-zero entries. The first row of each block
+  // is returned, followed by the number of rows.
+  std::vector<int> PartitionRows(const RowMajorSparseMatrix& matrix) const;
+
+  void MultiplyRowMajor(const RowMajorSparseMatrix& matrix,
+                        const std::vector<int>& block_begin_rows,
+                        const Eigen::VectorXd& x,
+                        Eigen::VectorXd* y) const;
+
+  RowMajorSparseMatrix matrix_;
+  RowMajorSparseMatrix transpose_;
+
+  // The row blocks of matrix_ and transpose_ that are processed in parallel.
+  std::vector<int> matrix_block_begin_rows_;
+  std::vector<int> transpose_block_begin_rows_;
+
+  // Small products are computed on the calling thread since the cost of
+  // scheduling outweighs the gain, in which case this is 1.
+  int num_threads_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelSparseMatrix);
+};
+
+}  // namespace theia
+
+#endif  // THEIA_MATH_MATRIX_PARALLEL_SPARSE_MATRIX_H_
@@ -0,0 +1,102 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+#include <vector>
+
+#include "theia/math/matrix/parallel_sparse_matrix.h"
+#include "theia/util/random.h"
+#include "gtest/gtest.h"
+
+namespace theia {
+
+namespace {
+
+const double kTolerance = 1e-12;
+
+Eigen::SparseMatrix<double> RandomSparseMatrix(const int rows,
+                                               const int cols,
+                                               const int num_entries_per_row,
+                                               RandomNumberGenerator* rng) {
+  std::vector<Eigen::Triplet<double> > triplets;
+  triplets.reserve(rows * num_entries_per_row);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < num_entries_per_row; j++) {
+      triplets.emplace_back(
+          i, rng->RandInt(0, cols - 1), rng->RandDouble(-1.0, 1.0));
+    }
+  }
+  Eigen::SparseMatrix<double> matrix(rows, cols);
+  matrix.setFromTriplets(triplets.begin(), triplets.end());
+  return matrix;
+}
+
+void TestProducts(const int rows,
+                  const int cols,
+                  const int num_entries_per_row,
+                  const int num_threads) {
+  RandomNumberGenerator rng(51);
+  const Eigen::SparseMatrix<double> matrix =
+      RandomSparseMatrix(rows, cols, num_entries_per_row, &rng);
+  const Eigen::VectorXd x = Eigen::VectorXd::Random(cols);
+  const Eigen::VectorXd y = Eigen::VectorXd::Random(rows);
+
+  ParallelSparseMatrix parallel_matrix(matrix, num_threads);
+  EXPECT_EQ(parallel_matrix.num_rows(), rows);
+  EXPECT_EQ(parallel_matrix.num_cols(), cols);
+
+  Eigen::VectorXd ax, aty;
+  parallel_matrix.Multiply(x, &ax);
+  parallel_matrix.TransposeMultiply(y, &aty);
+
+  const Eigen::VectorXd expected_ax = matrix * x;
+  const Eigen::VectorXd expected_aty = matrix.transpose() * y;
+  ASSERT_EQ(ax.size(), rows);
+  ASSERT_EQ(aty.size(), cols);
+  EXPECT_LT((ax - expected_ax).lpNorm<Eigen::Infinity>(), kTolerance);
+  EXPECT_LT((aty - expected_aty).lpNorm<Eigen::Infinity>(), kTolerance);
+}
+
+}  // namespace
+
+TEST(ParallelSparseMatrix, SingleThreaded) { TestProducts(100, 50, 5, 1); }
+
+TEST(ParallelSparseMatrix, SmallMatrixWithMultipleThreads) {
+  TestProducts(100, 50, 5, 4);
+}
+
+TEST(ParallelSparseMatrix, LargeMatrixWithMultipleThreads) {
+  TestProducts(30000, 10000, 6, 4);
+}
+
+}  // namespace theia
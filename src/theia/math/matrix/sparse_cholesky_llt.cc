@@ -76,6 +76,8 @@
 #include <Eigen/SparseCore>
 #include <glog/logging.h>
 
+#include <algorithm>
+
 // UF_long is deprecated but SuiteSparse_long is only available in
 // newer versions of SuiteSparse. So for older versions of
 // SuiteSparse, we define SuiteSparse_long to be the same as UF_long,
@@ -94,18 +96,43 @@ namespace theia {
 SparseCholeskyLLt::SparseCholeskyLLt(const Eigen::SparseMatrix<double>& mat)
     : is_factorization_ok_(false),
       is_analysis_ok_(false),
-      info_(Eigen::Success) {
+      info_(Eigen::Success),
+      analyzed_rows_(0) {
   Compute(mat);
 }
 
 SparseCholeskyLLt::SparseCholeskyLLt()
     : is_factorization_ok_(false),
       is_analysis_ok_(false),
-      info_(Eigen::Success) {}
+      info_(Eigen::Success),
+      analyzed_rows_(0) {}
 
 SparseCholeskyLLt::~SparseCholeskyLLt() {}
 
+bool SparseCholeskyLLt::HasAnalyzedPattern(
+    const Eigen::SparseMatrix<double>& mat) const {
+  if (!is_analysis_ok_ || !mat.isCompressed() || mat.rows() != analyzed_rows_ ||
+      mat.cols() != analyzed_rows_ ||
+      mat.nonZeros() != static_cast<int>(analyzed_inner_index_.size())) {
+    return false;
+  }
+  return std::equal(analyzed_outer_index_.begin(),
+                    analyzed_outer_index_.end(),
+                    mat.outerIndexPtr()) &&
+         std::equal(analyzed_inner_index_.begin(),
+                    analyzed_inner_index_.end(),
+                    mat.innerIndexPtr());
+}
+
 void SparseCholeskyLLt::AnalyzePattern(const Eigen::SparseMatrix<double>& mat) {
+  // Comparing the patterns is linear in the number of non-zeros, which is much
+  // cheaper than computing a fill-reducing ordering.
+  if (HasAnalyzedPattern(mat)) {
+    is_factorization_ok_ = false;
+    info_ = Eigen::Success;
+    return;
+  }
+
   solver_.analyzePattern(mat);
   info_ = solver_.info();
   if (info_ == Eigen::Success)
@@ -114,6 +141,19 @@ void SparseCholeskyLLt::AnalyzePattern(const Eigen::SparseMatrix<double>& mat) {
     is_analysis_ok_ = false;
   is_factorization_ok_ = false;
   info_ = Eigen::Success;
+
+  // Only compressed matrices can be compared cheaply, so the pattern of
+  // uncompressed matrices is not cached.
+  analyzed_outer_index_.clear();
+  analyzed_inner_index_.clear();
+  analyzed_rows_ = 0;
+  if (is_analysis_ok_ && mat.isCompressed()) {
+    analyzed_rows_ = mat.rows();
+    analyzed_outer_index_.assign(mat.outerIndexPtr(),
+                                 mat.outerIndexPtr() + mat.outerSize() + 1);
+    analyzed_inner_index_.assign(mat.innerIndexPtr(),
+                                 mat.innerIndexPtr() + mat.nonZeros());
+  }
 }
 
 void SparseCholeskyLLt::Factorize(const Eigen::SparseMatrix<double>& mat) {
@@ -127,12 +167,12 @@ void SparseCholeskyLLt::Factorize(const Eigen::SparseMatrix<double>& mat) {
 }
 
 void SparseCholeskyLLt::Compute(const Eigen::SparseMatrix<double>& mat) {
-  solver_.compute(mat);
-  info_ = solver_.info();
-  if (info_ == Eigen::Success) {
-    is_factorization_ok_ = true;
-    is_analysis_ok_ = true;
+  AnalyzePattern(mat);
+  if (!is_analysis_ok_) {
+    info_ = Eigen::NumericalIssue;
+    return;
   }
+  Factorize(mat);
 }
 
 Eigen::ComputationInfo SparseCholeskyLLt::Info() { return info_; }
@@ -152,4 +192,15 @@ Eigen::VectorXd SparseCholeskyLLt::Solve(const Eigen::VectorXd& rhs) {
   return solution;
 }
 
+void SparseCholeskyLLt::Solve(const Eigen::VectorXd& rhs,
+                              Eigen::VectorXd* solution) {
+  CHECK(is_analysis_ok_) << "Cannot call Solve() because symbolic analysis "
+                            "of the matrix (i.e. AnalyzePattern()) failed!";
+  CHECK(is_factorization_ok_)
+      << "Cannot call Solve() because numeric factorization "
+         "of the matrix (i.e. Factorize()) failed!";
+
+  *solution = solver_.solve(rhs);
+}
+
 }  // namespace theia
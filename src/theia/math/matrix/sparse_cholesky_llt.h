@@ -44,6 +44,8 @@
 #include <Eigen/SparseCholesky>
 #include <Eigen/SparseCore>
 
+#include <vector>
+
 namespace theia {
 
 // A class for performing the choleksy decomposition of a sparse matrix using
@@ -62,7 +64,12 @@ class SparseCholeskyLLt {
 
   // Perform symbolic analysis of the matrix. This is useful for analyzing
   // matrices with the same sparsity pattern when used in conjunction with
-  // Factorize().
+  // Factorize(). The sparsity pattern of the last successful analysis is kept
+  // and the analysis is skipped if mat has the same sparsity pattern, so
+  // solvers that repeatedly set up systems with the same structure (e.g. L1
+  // followed by IRLS) only pay for the analysis once. Only one sparsity pattern
+  // is kept per instance: analyzing a matrix with a different pattern replaces
+  // it, so alternating between two patterns analyzes every time.
   void AnalyzePattern(const Eigen::SparseMatrix<double>& mat);
 
   // Perform numerical decomposition of the current matrix. If the matrix has
@@ -75,6 +82,10 @@ class SparseCholeskyLLt {
   // AnalyzePattern() followed by Factorize().
   void Compute(const Eigen::SparseMatrix<double>& mat);
 
+  // Returns true if mat has the same sparsity pattern as the matrix of the
+  // last successful symbolic analysis.
+  bool HasAnalyzedPattern(const Eigen::SparseMatrix<double>& mat) const;
+
   // Returns the current state of the decomposition. After each step users
   // should ensure that Info() returns Eigen::Success.
   Eigen::ComputationInfo Info();
@@ -84,9 +95,17 @@ class SparseCholeskyLLt {
   // where lhs is the factorized matrix.
   Eigen::VectorXd Solve(const Eigen::VectorXd& rhs);
 
+  // Same as above, but the solution is written to a preallocated vector.
+  void Solve(const Eigen::VectorXd& rhs, Eigen::VectorXd* solution);
+
  private:
   Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Upper> solver_;
 
+  // The sparsity pattern of the last successful symbolic analysis.
+  int analyzed_rows_;
+  std::vector<int> analyzed_outer_index_;
+  std::vector<int> analyzed_inner_index_;
+
   bool is_factorization_ok_, is_analysis_ok_;
   Eigen::ComputationInfo info_;
 };
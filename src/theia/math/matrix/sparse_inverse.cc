@@ -0,0 +1,148 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/math/matrix/sparse_inverse.h"
+
+#include <Eigen/Core>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseCore>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace theia {
+
+SparseInverse::SparseInverse() {}
+
+SparseInverse::~SparseInverse() {}
+
+bool SparseInverse::Factorize(const Eigen::SparseMatrix<double>& mat) {
+  CHECK_EQ(mat.rows(), mat.cols());
+  permutation_.clear();
+  inverse_diagonal_.resize(0);
+  inverse_values_.clear();
+
+  // Pivots at the level of the rounding errors of the largest pivot mean that
+  // the matrix is singular.
+  ldlt_.compute(mat);
+  if (ldlt_.info() != Eigen::Success) {
+    return false;
+  }
+  const Eigen::VectorXd& diagonal = ldlt_.vectorD();
+  if (diagonal.size() > 0 &&
+      !(diagonal.array() >
+        std::numeric_limits<double>::epsilon() * diagonal.maxCoeff())
+           .all()) {
+    return false;
+  }
+  const auto& permutation_indices = ldlt_.permutationP().indices();
+  permutation_.assign(permutation_indices.data(),
+                      permutation_indices.data() + permutation_indices.size());
+  return true;
+}
+
+void SparseInverse::ComputeInverse() {
+  CHECK_EQ(permutation_.size(), ldlt_.rows())
+      << "The matrix must be factorized before computing its inverse.";
+  const Eigen::SparseMatrix<double>& lower = ldlt_.matrixL().nestedExpression();
+  const Eigen::VectorXd& diagonal = ldlt_.vectorD();
+  const int* outer_index = lower.outerIndexPtr();
+  const int* inner_index = lower.innerIndexPtr();
+  const double* values = lower.valuePtr();
+
+  // The columns are processed from the last to the first. The entries of
+  // column j of the inverse only depend on the entries of the inverse with
+  // rows and columns in the pattern of column j of L, which are in later
+  // columns.
+  inverse_diagonal_.resize(lower.cols());
+  inverse_values_.assign(lower.nonZeros(), 0.0);
+  for (int col = lower.cols() - 1; col >= 0; col--) {
+    const int begin = outer_index[col];
+    const int end = outer_index[col + 1];
+    for (int i = begin; i < end; i++) {
+      const int row = inner_index[i];
+      if (row == col) {
+        continue;
+      }
+      double sum = 0.0;
+      for (int k = begin; k < end; k++) {
+        if (inner_index[k] != col) {
+          sum += values[k] * PermutedCoeff(row, inner_index[k]);
+        }
+      }
+      inverse_values_[i] = -sum;
+    }
+
+    double sum = 0.0;
+    for (int k = begin; k < end; k++) {
+      if (inner_index[k] != col) {
+        sum += values[k] * inverse_values_[k];
+      }
+    }
+    inverse_diagonal_[col] = 1.0 / diagonal[col] - sum;
+  }
+}
+
+double SparseInverse::PermutedCoeff(const int row, const int col) const {
+  if (row == col) {
+    return inverse_diagonal_[row];
+  }
+  const int lower_row = std::max(row, col);
+  const int lower_col = std::min(row, col);
+  const Eigen::SparseMatrix<double>& lower = ldlt_.matrixL().nestedExpression();
+  const int* begin = lower.innerIndexPtr() + lower.outerIndexPtr()[lower_col];
+  const int* end = lower.innerIndexPtr() + lower.outerIndexPtr()[lower_col + 1];
+  const int* entry = std::lower_bound(begin, end, lower_row);
+  DCHECK(entry != end && *entry == lower_row)
+      << "Entry (" << row << ", " << col
+      << ") is not in the sparsity pattern of the factorization.";
+  return inverse_values_[entry - lower.innerIndexPtr()];
+}
+
+double SparseInverse::Coeff(const int row, const int col) const {
+  DCHECK_EQ(inverse_diagonal_.size(), permutation_.size())
+      << "The inverse must be computed before accessing its entries.";
+  return PermutedCoeff(permutation_[row], permutation_[col]);
+}
+
+void SparseInverse::Sample(const Eigen::VectorXd& standard_normal,
+                           Eigen::VectorXd* sample) const {
+  CHECK_EQ(standard_normal.size(), permutation_.size());
+  Eigen::VectorXd permuted_sample =
+      standard_normal.cwiseQuotient(ldlt_.vectorD().cwiseSqrt());
+  ldlt_.matrixU().solveInPlace(permuted_sample);
+  *sample = ldlt_.permutationPinv() * permuted_sample;
+}
+
+}  // namespace theia
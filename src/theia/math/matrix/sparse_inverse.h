@@ -0,0 +1,105 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_MATH_MATRIX_SPARSE_INVERSE_H_
+#define THEIA_MATH_MATRIX_SPARSE_INVERSE_H_
+
+#include <Eigen/Core>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseCore>
+
+#include <vector>
+
+#include "theia/util/util.h"
+
+namespace theia {
+
+// Selected entries of the inverse of a sparse symmetric positive definite
+// matrix A, e.g. for covariance estimation. The matrix is factorized once as
+// P * A * P^T = L * D * L^T. The entries of the inverse on the sparsity
+// pattern of L, which contains the pattern of A, are then computed with the
+// recursion of Takahashi et al.:
+//
+//   Z = D^-1 * L^-1 + (I - L^T) * Z,
+//
+// which only needs entries of Z that are on the same pattern, so the dense
+// inverse is never formed. See "Formation of a sparse bus impedance matrix
+// and its application to short circuit study" by Takahashi et al. (1973).
+//
+// For matrices where even the pattern of L is too large, Sample() draws
+// random vectors whose covariance is A^-1, from which any entry of the inverse
+// can be estimated.
+class SparseInverse {
+ public:
+  SparseInverse();
+  ~SparseInverse();
+
+  // Factorizes the matrix, of which only the upper triangle is used. Returns
+  // false if the matrix is not positive definite.
+  bool Factorize(const Eigen::SparseMatrix<double>& mat);
+
+  // Computes the entries of the inverse on the sparsity pattern of the
+  // factorization. Must be called after a successful Factorize().
+  void ComputeInverse();
+
+  // Returns the entry (row, col) of the inverse, which must be in the
+  // sparsity pattern of the factorized matrix. Must be called after
+  // ComputeInverse().
+  double Coeff(const int row, const int col) const;
+
+  // Transforms a vector of independent standard normal samples into a sample
+  // of the normal distribution with covariance A^-1, i.e. sample = P^T *
+  // L^-T * D^-1/2 * standard_normal. Must be called after a successful
+  // Factorize().
+  void Sample(const Eigen::VectorXd& standard_normal,
+              Eigen::VectorXd* sample) const;
+
+  int rows() const { return permutation_.size(); }
+
+ private:
+  // Returns the entry of the inverse of the permuted matrix.
+  double PermutedCoeff(const int row, const int col) const;
+
+  Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Upper> ldlt_;
+  // Row i of A is row permutation_[i] of the permuted matrix.
+  std::vector<int> permutation_;
+
+  // The inverse of the permuted matrix: its diagonal and the entries below
+  // the diagonal, which are stored in the order of the entries of L.
+  Eigen::VectorXd inverse_diagonal_;
+  std::vector<double> inverse_values_;
+
+  DISALLOW_COPY_AND_ASSIGN(SparseInverse);
+};
+
+}  // namespace theia
+
+#endif  // THEIA_MATH_MATRIX_SPARSE_INVERSE_H_
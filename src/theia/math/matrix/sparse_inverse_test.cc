@@ -0,0 +1,119 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <Eigen/LU>
+#include <Eigen/SparseCore>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "theia/math/matrix/sparse_inverse.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+namespace {
+
+// Returns a random sparse symmetric positive definite matrix A^T * A + I.
+Eigen::SparseMatrix<double> RandomSymmetricPositiveDefiniteMatrix(
+    const int size, const int num_entries_per_row, RandomNumberGenerator* rng) {
+  std::vector<Eigen::Triplet<double> > triplets;
+  for (int i = 0; i < size; i++) {
+    for (int j = 0; j < num_entries_per_row; j++) {
+      triplets.emplace_back(
+          i, rng->RandInt(0, size - 1), rng->RandDouble(-1.0, 1.0));
+    }
+  }
+  Eigen::SparseMatrix<double> matrix(size, size);
+  matrix.setFromTriplets(triplets.begin(), triplets.end());
+  Eigen::SparseMatrix<double> identity(size, size);
+  identity.setIdentity();
+  return Eigen::SparseMatrix<double>(matrix.transpose() * matrix) + identity;
+}
+
+TEST(SparseInverse, EntriesOnSparsityPattern) {
+  RandomNumberGenerator rng(47);
+  const Eigen::SparseMatrix<double> matrix =
+      RandomSymmetricPositiveDefiniteMatrix(200, 3, &rng);
+  const Eigen::MatrixXd inverse = Eigen::MatrixXd(matrix).inverse();
+
+  SparseInverse sparse_inverse;
+  ASSERT_TRUE(sparse_inverse.Factorize(matrix.triangularView<Eigen::Upper>()));
+  sparse_inverse.ComputeInverse();
+  EXPECT_EQ(sparse_inverse.rows(), matrix.rows());
+  for (int col = 0; col < matrix.outerSize(); col++) {
+    for (Eigen::SparseMatrix<double>::InnerIterator it(matrix, col); it;
+         ++it) {
+      EXPECT_NEAR(sparse_inverse.Coeff(it.row(), it.col()),
+                  inverse(it.row(), it.col()),
+                  1e-10);
+    }
+  }
+}
+
+TEST(SparseInverse, SamplesHaveInverseCovariance) {
+  static const int kNumSamples = 20000;
+  RandomNumberGenerator rng(53);
+  const Eigen::SparseMatrix<double> matrix =
+      RandomSymmetricPositiveDefiniteMatrix(10, 2, &rng);
+  const Eigen::MatrixXd inverse = Eigen::MatrixXd(matrix).inverse();
+
+  SparseInverse sparse_inverse;
+  ASSERT_TRUE(sparse_inverse.Factorize(matrix.triangularView<Eigen::Upper>()));
+  Eigen::MatrixXd covariance = Eigen::MatrixXd::Zero(10, 10);
+  Eigen::VectorXd standard_normal(10), sample;
+  for (int i = 0; i < kNumSamples; i++) {
+    for (int j = 0; j < standard_normal.size(); j++) {
+      standard_normal[j] = rng.RandGaussian(0.0, 1.0);
+    }
+    sparse_inverse.Sample(standard_normal, &sample);
+    covariance += sample * sample.transpose() / kNumSamples;
+  }
+  // The standard deviation of the estimated variances is sqrt(2 / N) times
+  // the variance.
+  for (int i = 0; i < covariance.rows(); i++) {
+    EXPECT_NEAR(covariance(i, i), inverse(i, i), 0.05 * inverse(i, i));
+  }
+}
+
+TEST(SparseInverse, IndefiniteMatrix) {
+  Eigen::SparseMatrix<double> matrix(2, 2);
+  matrix.insert(0, 0) = 1.0;
+  matrix.insert(0, 1) = 2.0;
+  matrix.insert(1, 1) = 1.0;
+  SparseInverse sparse_inverse;
+  EXPECT_FALSE(sparse_inverse.Factorize(matrix));
+}
+
+}  // namespace
+
+}  // namespace theia
@@ -40,6 +40,8 @@
 #include <Eigen/Eigenvalues>
 #include <Eigen/QR>
 
+#include "theia/util/threadpool.h"
+
 namespace theia {
 namespace math {
 
@@ -58,16 +60,15 @@ RankRestrictedSDPSolver::RankRestrictedSDPSolver(
 void RankRestrictedSDPSolver::Solve(math::Summary& summary) {
   Eigen::MatrixXd G = Eigen::MatrixXd::Zero(rank_, dim_ * n_);
 
-#pragma omp parallel for num_threads(sdp_solver_options_.num_threads)
   // Compute inital G according to Equ.(3)
-  for (size_t i = 0; i < n_; i++) {
+  ParallelFor(sdp_solver_options_.num_threads, n_, [&](const int i) {
     const std::vector<size_t>& adjs = adj_edges_[i];
     for (auto j : adjs) {
       G.block(0, i * dim_, rank_, dim_) +=
           Y_.block(0, j * dim_, rank_, dim_) *
           Q_.block(j * dim_, i * dim_, dim_, dim_);
     }
-  }
+  });
 
   double prev_func_val = std::numeric_limits<double>::max();
   double cur_func_val = this->EvaluateFuncVal();
@@ -100,8 +101,9 @@ void RankRestrictedSDPSolver::Solve(math::Summary& summary) {
       Y_.block(0, i * dim_, rank_, dim_) =
           jacobi_svd.matrixU() * jacobi_svd.matrixV().transpose();
 
+      // Only the few neighbors of block i are updated, which is too little
+      // work to split between threads.
       const std::vector<size_t>& adjs = adj_edges_[i];
-#pragma omp parallel for num_threads(sdp_solver_options_.num_threads)
       for (size_t idx = 0; idx < adjs.size(); ++idx) {
         const size_t j = adjs[idx];
         G.block(0, j * dim_, rank_, dim_) +=
@@ -152,12 +154,11 @@ Eigen::MatrixXd RankRestrictedSDPSolver::ComputeLambdaMatrix() const {
   // \Lambda = \SymblockDiag(Q * Y^T * Y).
   Eigen::MatrixXd Lambda = Eigen::MatrixXd::Zero(dim_, n_ * dim_);
 
-#pragma omp parallel for num_threads(sdp_solver_options_.num_threads)
-  for (size_t i = 0; i < n_; ++i) {
+  ParallelFor(sdp_solver_options_.num_threads, n_, [&](const int i) {
     Eigen::MatrixXd P =
         QYt.block(i * dim_, 0, dim_, rank) * Y_.block(0, i * dim_, rank, dim_);
     Lambda.block(0, i * dim_, dim_, dim_) = 0.5 * (P + P.transpose());
-  }
+  });
 
   return Lambda;
 }
@@ -196,8 +197,7 @@ Eigen::MatrixXd RankRestrictedSDPSolver::Project(
 
   Eigen::MatrixXd P(rank_, dim_ * n_);
 
-#pragma omp parallel for num_threads(sdp_solver_options_.num_threads)
-  for (size_t i = 0; i < n_; ++i) {
+  ParallelFor(sdp_solver_options_.num_threads, n_, [&](const int i) {
     // Compute the (thin) SVD of the ith block of A
     Eigen::JacobiSVD<Eigen::MatrixXd> SVD(
         A.block(0, i * dim_, rank_, dim_),
@@ -206,7 +206,7 @@ Eigen::MatrixXd RankRestrictedSDPSolver::Project(
     // Set the ith block of P to the SVD-based projection of the ith block of A
     P.block(0, i * dim_, rank_, dim_) =
         SVD.matrixU() * SVD.matrixV().transpose();
-  }
+  });
   return P;
 }
 
@@ -244,8 +244,7 @@ Eigen::MatrixXd RankRestrictedSDPSolver::SymBlockDiagProduct(
   // Preallocate result matrix
   Eigen::MatrixXd R(rank_, dim_ * n_);
 
-#pragma omp parallel for num_threads(sdp_solver_options_.num_threads)
-  for (size_t i = 0; i < n_; ++i) {
+  ParallelFor(sdp_solver_options_.num_threads, n_, [&](const int i) {
     // Compute block product Bi' * Ci.
     Eigen::MatrixXd P = B.block(0, i * dim_, rank_, dim_).transpose() *
                         C.block(0, i * dim_, rank_, dim_);
@@ -253,7 +252,7 @@ Eigen::MatrixXd RankRestrictedSDPSolver::SymBlockDiagProduct(
     Eigen::MatrixXd S = 0.5 * (P + P.transpose());
     // Compute Ai * S and set corresponding block of R.
     R.block(0, i * dim_, rank_, dim_) = A.block(0, i * dim_, rank_, dim_) * S;
-  }
+  });
   return R;
 }
 
@@ -41,16 +41,28 @@
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <Eigen/Eigenvalues>
 #include <Eigen/QR>
 
 #include "theia/math/bcm_sdp_solver.h"
 #include "theia/math/matrix/matrix_square_root.h"
+#include "theia/util/threadpool.h"
 
 namespace theia {
 namespace math {
 
+namespace {
+
+// Each row update only multiplies a few small blocks per block row, so
+// dispatching the loops to the thread pool only pays off for large problems.
+const int kMinNumBlockProductsForParallelUpdate = 4096;
+
+}  // namespace
+
 RBRSDPSolver::RBRSDPSolver(const size_t n, const size_t block_dim)
     : RBRSDPSolver(n, block_dim, SDPSolverOptions()) {}
 
@@ -67,6 +79,9 @@ void RBRSDPSolver::Solve(math::Summary& summary) {
   double duration = 0.0;
   double error = 0.0;
 
+  this->ExtractNeighborBlocks();
+  B_multi_W_.resize(dim_ * n_, dim_);
+
   summary.begin_time = std::chrono::high_resolution_clock::now();
   while (summary.total_iterations_num < sdp_solver_options_.max_iterations) {
     if (sdp_solver_options_.verbose) {
@@ -86,34 +101,7 @@ void RBRSDPSolver::Solve(math::Summary& summary) {
 
     // convergence rate? Take it for consideration.
     for (size_t k = 0; k < n_; k++) {
-      // Eliminating the k-th row and column from Y to form Bk
-      Eigen::MatrixXd B = Eigen::MatrixXd::Zero(3 * (n_ - 1), 3 * (n_ - 1));
-      this->ReformingB(k, B);
-
-      // Eliminating the k-th column and all but the k-th row from R to form Wk
-      Eigen::MatrixXd W = Eigen::MatrixXd::Zero(3 * (n_ - 1), 3);
-      this->ReformingW(k, W);
-
-      Eigen::MatrixXd B_multi_W = B * W;
-      Eigen::MatrixXd WtBW = W.transpose() * B_multi_W;
-
-      // FIXME: (chenyu) Solving matrix square root with
-      // SVD and LDL^T would generate different result
-      Eigen::MatrixXd WtBW_sqrt = math::MatrixSquareRoot(WtBW);
-      // Eigen::MatrixXd WtBW_sqrt =
-      // MatrixSquareRootForSemidefinitePositiveMat(WtBW);
-
-      // FIXME: (chenyu) Eigen 3.3.0 is required for the use of
-      // CompleteOrthogonalDecomposition<>
-      // Eigen::CompleteOrthogonalDecomposition<Eigen::MatrixXd> cqr(WtBW_sqrt);
-      // Eigen::Matrix3d moore_penrose_pseinv = cqr.pseudoInverse();
-      Eigen::Matrix3d moore_penrose_pseinv = WtBW_sqrt.inverse();
-
-      // compute S by fixing the error of Equ.(47) in Erikson's paper
-      Eigen::MatrixXd S = -B_multi_W * moore_penrose_pseinv;
-
-      // reordering X
-      this->ReorderingUnknown(k, B, S);
+      this->UpdateRow(k);
     }
 
     summary.total_iterations_num++;
@@ -137,62 +125,103 @@ void RBRSDPSolver::Solve(math::Summary& summary) {
 double RBRSDPSolver::EvaluateFuncVal() const { return EvaluateFuncVal(X_); }
 
 double RBRSDPSolver::EvaluateFuncVal(const Eigen::MatrixXd& Y) const {
-  return (Q_ * Y).trace();
-}
-
-void RBRSDPSolver::ReformingB(const size_t k, Eigen::MatrixXd& B) {
-  size_t r = 0, c = 0;  // the row and column index of matrix B
-
-  for (size_t i = 0; i < n_; i++) {
-    if (i == k) continue;
-    c = 0;
-    for (size_t j = 0; j < n_; j++) {
-      if (j == k) continue;
-
-      B.block(3 * r, 3 * c, 3, 3) = X_.block(3 * i, 3 * j, 3, 3);
-      c++;
+  // tr(QY) = sum_{r, c} Q(r, c) * Y(c, r) only needs the non-zeros of Q.
+  double func_val = 0.0;
+  for (int outer = 0; outer < Q_.outerSize(); outer++) {
+    for (Eigen::SparseMatrix<double>::InnerIterator it(Q_, outer); it; ++it) {
+      func_val += it.value() * Y(it.col(), it.row());
     }
-    r++;
   }
+  return func_val;
 }
 
-void RBRSDPSolver::ReformingW(const size_t k, Eigen::MatrixXd& W) {
-  size_t r = 0;  // row index of matrix W
-
-  for (size_t i = 0; i < n_; i++) {
-    if (i == k) continue;
+void RBRSDPSolver::ExtractNeighborBlocks() {
+  std::vector<std::unordered_map<size_t, Eigen::MatrixXd>> blocks(n_);
+  for (int outer = 0; outer < Q_.outerSize(); outer++) {
+    for (Eigen::SparseMatrix<double>::InnerIterator it(Q_, outer); it; ++it) {
+      const size_t j = it.row() / dim_;
+      const size_t k = it.col() / dim_;
+      if (j == k) {
+        continue;
+      }
+      auto inserted =
+          blocks[k].emplace(j, Eigen::MatrixXd::Zero(dim_, dim_));
+      inserted.first->second(it.row() % dim_, it.col() % dim_) = it.value();
+    }
+  }
 
-    W.block(3 * r, 0, 3, 3) = Q_.block(3 * i, 3 * k, 3, 3);
-    r++;
+  neighbor_blocks_.clear();
+  neighbor_blocks_.resize(n_);
+  for (size_t k = 0; k < n_; k++) {
+    neighbor_blocks_[k].assign(blocks[k].begin(), blocks[k].end());
+    std::sort(neighbor_blocks_[k].begin(),
+              neighbor_blocks_[k].end(),
+              [](const std::pair<size_t, Eigen::MatrixXd>& lhs,
+                 const std::pair<size_t, Eigen::MatrixXd>& rhs) {
+                return lhs.first < rhs.first;
+              });
   }
 }
 
-void RBRSDPSolver::ReorderingUnknown(const size_t k,
-                                     const Eigen::MatrixXd& B,
-                                     const Eigen::MatrixXd& S) {
-  // Reordering X according to [Algorithm 1] in paper:
+void RBRSDPSolver::UpdateRow(const size_t k) {
+  // Updating X according to [Algorithm 1] in paper:
   // - Z. Wen, D. Goldfarb, S. Ma, and K. Scheinberg.
   //   Row by row methods for semidefinite programming.
   //   Technical report, Columbia University, 2009. 7
+  //
+  // B_k is X without its k-th block row and column and W_k is the k-th block
+  // column of Q without its k-th block. Only the blocks j of W_k with
+  // Q(j, k) != 0 contribute to B_k * W_k.
+  const std::vector<std::pair<size_t, Eigen::MatrixXd>>& neighbors =
+      neighbor_blocks_[k];
+  const int num_blocks = static_cast<int>(n_);
+  const int num_block_products =
+      num_blocks * std::max<int>(1, static_cast<int>(neighbors.size()));
+  const int num_threads =
+      num_block_products < kMinNumBlockProductsForParallelUpdate
+          ? 1
+          : sdp_solver_options_.num_threads;
+
+  ParallelFor(num_threads, num_blocks, [&](const int i) {
+    auto B_multi_W_i = B_multi_W_.middleRows(dim_ * i, dim_);
+    B_multi_W_i.setZero();
+    if (i == static_cast<int>(k)) {
+      return;
+    }
+    for (const auto& neighbor : neighbors) {
+      B_multi_W_i.noalias() +=
+          X_.block(dim_ * i, dim_ * neighbor.first, dim_, dim_) *
+          neighbor.second;
+    }
+  });
 
-  // Update X(k, k)
-  X_.block(3 * k, 3 * k, 3, 3) = Eigen::Matrix3d::Identity();
-
-  // Update the k-th column of Y, except Y(k, k)
-  size_t j = 0;  // the j-th block of S
-  for (size_t i = 0; i < n_; i++) {
-    if (i == k) continue;
-    X_.block(3 * i, 3 * k, 3, 3) = S.block(3 * j, 0, 3, 3);
-    j++;
+  Eigen::MatrixXd WtBW = Eigen::MatrixXd::Zero(dim_, dim_);
+  for (const auto& neighbor : neighbors) {
+    WtBW.noalias() += neighbor.second.transpose() *
+                      B_multi_W_.middleRows(dim_ * neighbor.first, dim_);
   }
 
-  // Update the k-th row of Y, except Y(k, k)
-  size_t i = 0;  // the i-th block of S
-  for (size_t j = 0; j < n_; j++) {
-    if (j == k) continue;
-    X_.block(3 * k, 3 * j, 3, 3) = S.block(3 * i, 0, 3, 3).transpose();
-    i++;
-  }
+  // FIXME: (chenyu) Solving matrix square root with
+  // SVD and LDL^T would generate different result
+  const Eigen::MatrixXd WtBW_sqrt = math::MatrixSquareRoot(WtBW);
+
+  // FIXME: (chenyu) Eigen 3.3.0 is required for the use of
+  // CompleteOrthogonalDecomposition<>
+  const Eigen::MatrixXd moore_penrose_pseinv = WtBW_sqrt.inverse();
+
+  // Compute S by fixing the error of Equ.(47) in Erikson's paper and write it
+  // to the k-th block column and row of X.
+  ParallelFor(num_threads, num_blocks, [&](const int i) {
+    if (i == static_cast<int>(k)) {
+      return;
+    }
+    auto S_i = X_.block(dim_ * i, dim_ * k, dim_, dim_);
+    S_i.noalias() =
+        -B_multi_W_.middleRows(dim_ * i, dim_) * moore_penrose_pseinv;
+    X_.block(dim_ * k, dim_ * i, dim_, dim_) = S_i.transpose();
+  });
+
+  X_.block(dim_ * k, dim_ * k, dim_, dim_).setIdentity();
 }
 
 }  // namespace math
@@ -37,6 +37,8 @@
 
 #include <chrono>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 #include <Eigen/Core>
 
@@ -63,6 +65,11 @@ namespace math {
 // and the optimal solution could be retrieved by reading the first three rows
 // of Y^*
 //
+// Each row update only touches the blocks of Y that are coupled to the k-th
+// row through a non-zero block of R, so one sweep costs O(n * nnz(R)) instead of
+// the O(n^3) of forming B_k and W_k explicitly. The block rows of a single
+// update are computed with multiple threads.
+//
 class RBRSDPSolver : public BCMSDPSolver {
  public:
   RBRSDPSolver(const size_t n, const size_t block_dim);
@@ -79,13 +86,21 @@ class RBRSDPSolver : public BCMSDPSolver {
   double EvaluateFuncVal(const Eigen::MatrixXd& Y) const override;
 
  private:
-  void ReformingB(const size_t k, Eigen::MatrixXd& Bk);
-  void ReformingW(const size_t k, Eigen::MatrixXd& Wk);
-  void ReorderingUnknown(const size_t k,
-                         const Eigen::MatrixXd& B,
-                         const Eigen::MatrixXd& W);
+  // Collects the non-zero blocks Q(j, k), j != k, of each block column k.
+  void ExtractNeighborBlocks();
+
+  // Minimizes the objective over the k-th block row and column of X.
+  void UpdateRow(const size_t k);
 
   Eigen::MatrixXd X_;
+
+  // The non-zero off-diagonal blocks of Q, indexed by block column. This is
+  // W_k of the paper without the zero rows.
+  std::vector<std::vector<std::pair<size_t, Eigen::MatrixXd>>>
+      neighbor_blocks_;
+
+  // B_k * W_k with the k-th block row left at zero.
+  Eigen::MatrixXd B_multi_W_;
 };
 
 }  // namespace math
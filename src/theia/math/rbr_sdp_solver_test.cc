@@ -0,0 +1,137 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/SparseCore>
+
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "theia/math/rbr_sdp_solver.h"
+#include "theia/math/solver_options.h"
+#include "theia/math/solver_summary.h"
+#include "theia/util/random.h"
+
+namespace theia {
+namespace math {
+
+namespace {
+
+RandomNumberGenerator rng(52);
+
+// Builds Q = -R for noise-free relative rotations R_ij = R_j * R_i^T on a
+// cycle with a few chords, the same way as the Lagrange dual rotation
+// estimator does.
+Eigen::SparseMatrix<double> BuildCovariance(
+    const int num_views, std::vector<std::pair<int, int>>* edges) {
+  std::vector<Eigen::Matrix3d> rotations(num_views);
+  for (int i = 0; i < num_views; i++) {
+    const Eigen::Vector3d angle_axis = rng.RandVector3d();
+    rotations[i] =
+        Eigen::AngleAxisd(angle_axis.norm(), angle_axis.normalized())
+            .toRotationMatrix();
+  }
+
+  for (int i = 0; i < num_views; i++) {
+    edges->emplace_back(i, (i + 1) % num_views);
+  }
+  for (int i = 0; i + 3 < num_views; i += 2) {
+    edges->emplace_back(i, i + 3);
+  }
+
+  std::vector<Eigen::Triplet<double>> triplets;
+  for (const auto& edge : *edges) {
+    const int i = edge.first, j = edge.second;
+    const Eigen::Matrix3d R_ij = rotations[j] * rotations[i].transpose();
+    for (int l = 0; l < 3; l++) {
+      for (int r = 0; r < 3; r++) {
+        triplets.emplace_back(3 * i + l, 3 * j + r, -R_ij(r, l));
+        triplets.emplace_back(3 * j + l, 3 * i + r, -R_ij(l, r));
+      }
+    }
+  }
+  Eigen::SparseMatrix<double> Q(3 * num_views, 3 * num_views);
+  Q.setFromTriplets(triplets.begin(), triplets.end());
+  return Q;
+}
+
+}  // namespace
+
+TEST(RBRSDPSolver, EvaluateFuncValMatchesDenseTrace) {
+  static const int kNumViews = 8;
+  std::vector<std::pair<int, int>> edges;
+  const Eigen::SparseMatrix<double> Q = BuildCovariance(kNumViews, &edges);
+
+  RBRSDPSolver solver(kNumViews, 3);
+  solver.SetCovariance(Q);
+
+  const Eigen::MatrixXd Y = Eigen::MatrixXd::Random(3 * kNumViews,
+                                                    3 * kNumViews);
+  EXPECT_NEAR(solver.EvaluateFuncVal(Y), (Q * Y).trace(), 1e-10);
+}
+
+TEST(RBRSDPSolver, NoiseFreeProblem) {
+  static const int kNumViews = 10;
+  static const double kTolerance = 1e-6;
+  std::vector<std::pair<int, int>> edges;
+  const Eigen::SparseMatrix<double> Q = BuildCovariance(kNumViews, &edges);
+
+  SDPSolverOptions options(500, 1e-14, false);
+  options.solver_type = RBR_BCM;
+  options.num_threads = 2;
+  RBRSDPSolver solver(kNumViews, 3, options);
+  solver.SetCovariance(Q);
+
+  Summary summary;
+  solver.Solve(summary);
+
+  // Without noise every edge is satisfied exactly at the optimum, and each
+  // edge contributes -3 to both of its blocks of tr(QX).
+  const double expected_func_val = -6.0 * edges.size();
+  EXPECT_NEAR(solver.EvaluateFuncVal(), expected_func_val, kTolerance);
+
+  const Eigen::MatrixXd X = solver.GetSolution();
+  for (int i = 0; i < kNumViews; i++) {
+    for (int j = 0; j < kNumViews; j++) {
+      const Eigen::Matrix3d X_ij = X.block<3, 3>(3 * i, 3 * j);
+      EXPECT_TRUE(X_ij.isApprox(X.block<3, 3>(3 * j, 3 * i).transpose()));
+      EXPECT_LT((X_ij * X_ij.transpose() - Eigen::Matrix3d::Identity())
+                    .norm(),
+                kTolerance);
+    }
+  }
+}
+
+}  // namespace math
+}  // namespace theia
@@ -38,6 +38,7 @@
 
 #include "spectra/include/SymEigsSolver.h"
 #include "theia/math/rotation.h"
+#include "theia/util/threadpool.h"
 
 namespace theia {
 namespace math {
@@ -58,7 +59,8 @@ void SMinusLambdaProdFunctor::perform_op(double* x, double* y) const {
 
   Y = sdp_solver_->ComputeQYt(X.transpose());
 
-#pragma omp parallel for
+  // The blocks are too small to split between threads. This operator is
+  // applied many times by the eigen solver.
   for (size_t i = 0; i < sdp_solver_->NumUnknowns(); ++i) {
     Y.segment(i * dim_, dim_) -=
         Lambda_.block(0, i * dim_, dim_, dim_) * X.segment(i * dim_, dim_);
@@ -339,11 +341,10 @@ bool RiemannianStaircase::EscapeSaddle(const double lambda_min,
 
 void RiemannianStaircase::RoundSolution() {
   // Finally, project each dxd rotation block to SO(d).
-#pragma omp parallel for num_threads(sdp_options_.num_threads)
-  for (size_t i = 0; i < n_; ++i) {
+  ParallelFor(sdp_options_.num_threads, n_, [&](const int i) {
     R_.block(0, i * dim_, dim_, dim_) =
         ProjectToSOd(R_.block(0, i * dim_, dim_, dim_));
-  }
+  });
 }
 
 Eigen::MatrixXd RiemannianStaircase::GetSolution() const { return R_; }
@@ -36,6 +36,7 @@
 
 #include <Eigen/Core>
 #include <ceres/ceres.h>
+#include <algorithm>
 #include <vector>
 
 #include "theia/matching/feature_correspondence.h"
@@ -50,6 +51,7 @@
 #include "theia/sfm/triangulation/triangulation.h"
 #include "theia/sfm/twoview_info.h"
 #include "theia/sfm/types.h"
+#include "theia/util/threadpool.h"
 #include "theia/util/timer.h"
 
 namespace theia {
@@ -62,7 +64,8 @@ void SetSolverOptions(const BundleAdjustmentOptions& options,
   solver_options->linear_solver_type = ceres::DENSE_SCHUR;
   solver_options->visibility_clustering_type = ceres::CANONICAL_VIEWS;
   solver_options->logging_type = ceres::SILENT;
-  solver_options->num_threads = options.num_threads;
+  solver_options->num_threads =
+      GetNumThreadsForExternalSolver(options.num_threads);
   solver_options->max_num_iterations = options.max_num_iterations;
   // Solver options takes ownership of the ordering so that we can order the BA
   // problem by points and cameras.
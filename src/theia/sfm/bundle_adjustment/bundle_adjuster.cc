@@ -54,6 +54,8 @@
 #include "theia/sfm/reconstruction_estimator_utils.h"
 #include "theia/sfm/types.h"
 #include "theia/util/map_util.h"
+#include "theia/util/memory_usage.h"
+#include "theia/util/threadpool.h"
 #include "theia/util/timer.h"
 
 namespace theia {
@@ -63,11 +65,16 @@ void SetSolverOptions(const BundleAdjustmentOptions& options,
                       ceres::Solver::Options* solver_options) {
   solver_options->linear_solver_type = options.linear_solver_type;
   solver_options->preconditioner_type = options.preconditioner_type;
+  solver_options->max_linear_solver_iterations =
+      options.max_linear_solver_iterations;
   solver_options->visibility_clustering_type =
       options.visibility_clustering_type;
   solver_options->logging_type =
       options.verbose ? ceres::PER_MINIMIZER_ITERATION : ceres::SILENT;
-  solver_options->num_threads = options.num_threads;
+  // Ceres uses its own threads, so only one is used when bundle adjustment is
+  // run from within a parallel task.
+  solver_options->num_threads =
+      GetNumThreadsForExternalSolver(options.num_threads);
   solver_options->max_num_iterations = options.max_num_iterations;
   solver_options->max_solver_time_in_seconds =
       options.max_solver_time_in_seconds;
@@ -106,9 +113,24 @@ BundleAdjuster::BundleAdjuster(const BundleAdjustmentOptions& options,
   // Set solver options.
   SetSolverOptions(options, &solver_options_);
   parameter_ordering_ = solver_options_.linear_solver_ordering.get();
+
+  if (options.backend == BundleAdjustmentBackend::SCHUR) {
+    if (SchurBundleAdjuster::SupportsOptions(options)) {
+      schur_bundle_adjuster_.reset(
+          new SchurBundleAdjuster(options, reconstruction));
+    } else {
+      LOG(WARNING) << "The SCHUR bundle adjustment backend does not support "
+                      "priors or orthographic cameras. Using Ceres instead.";
+    }
+  }
 }
 
 void BundleAdjuster::AddView(const ViewId view_id) {
+  if (schur_bundle_adjuster_ != nullptr) {
+    schur_bundle_adjuster_->AddView(view_id);
+    return;
+  }
+
   View* view = CHECK_NOTNULL(reconstruction_->MutableView(view_id));
 
   // Only optimize estimated views.
@@ -164,6 +186,11 @@ void BundleAdjuster::AddView(const ViewId view_id) {
 
 void BundleAdjuster::AddTrack(const TrackId track_id,
                               const bool use_homogeneous) {
+  if (schur_bundle_adjuster_ != nullptr) {
+    schur_bundle_adjuster_->AddTrack(track_id, use_homogeneous);
+    return;
+  }
+
   Track* track = CHECK_NOTNULL(reconstruction_->MutableTrack(track_id));
   // Only optimize estimated tracks.
   if (!track->IsEstimated() || ContainsKey(optimized_tracks_, track_id)) {
@@ -209,6 +236,27 @@ void BundleAdjuster::AddTrack(const TrackId track_id,
 }
 
 BundleAdjustmentSummary BundleAdjuster::Optimize() {
+  if (schur_bundle_adjuster_ != nullptr) {
+    if (schur_bundle_adjuster_->IsSupported()) {
+      return schur_bundle_adjuster_->Optimize();
+    }
+
+    // Set up the same problem with Ceres.
+    LOG(WARNING) << "The SCHUR bundle adjustment backend only supports "
+                    "pinhole cameras. Using Ceres instead.";
+    const std::unique_ptr<SchurBundleAdjuster> schur_bundle_adjuster =
+        std::move(schur_bundle_adjuster_);
+    for (const ViewId view_id : schur_bundle_adjuster->AddedViews()) {
+      AddView(view_id);
+    }
+    for (const auto& track : schur_bundle_adjuster->AddedTracks()) {
+      AddTrack(track.first, track.second);
+    }
+    for (const ViewId view_id : schur_bundle_adjuster->ConstantViews()) {
+      SetCameraExtrinsicsConstant(view_id);
+    }
+  }
+
   // Set extrinsics parameterization of the camera poses. This will set
   // orientation and/or positions as constant if desired.
   SetCameraExtrinsicsParameterization();
@@ -241,6 +289,7 @@ BundleAdjustmentSummary BundleAdjuster::Optimize() {
   summary.solve_time_in_seconds = solver_summary.total_time_in_seconds;
   summary.initial_cost = solver_summary.initial_cost;
   summary.final_cost = solver_summary.final_cost;
+  summary.num_residuals = solver_summary.num_residuals;
 
   // This only indicates whether the optimization was successfully run and makes
   // no guarantees on the quality or convergence.
@@ -370,11 +419,37 @@ BundleAdjuster::GetIntrinsicsForCameraIntrinsicsGroup(
 }
 
 void BundleAdjuster::SetCameraExtrinsicsConstant(const ViewId view_id) {
+  if (schur_bundle_adjuster_ != nullptr) {
+    schur_bundle_adjuster_->SetCameraExtrinsicsConstant(view_id);
+    return;
+  }
+
   View* view = reconstruction_->MutableView(view_id);
   Camera* camera = view->MutableCamera();
   problem_->SetParameterBlockConstant(camera->mutable_extrinsics());
 }
 
+size_t BundleAdjuster::MemoryUsage() const {
+  size_t memory_usage =
+      sizeof(*this) + HeapMemoryUsage(optimized_views_) +
+      HeapMemoryUsage(optimized_tracks_) +
+      HeapMemoryUsage(optimized_camera_intrinsics_groups_) +
+      HeapMemoryUsage(potentially_constant_camera_intrinsics_groups_);
+  if (schur_bundle_adjuster_ != nullptr) {
+    memory_usage += schur_bundle_adjuster_->MemoryUsage();
+  }
+  // Constant views do not add blocks to the reduced camera system, so only the
+  // optimized views are counted.
+  if (problem_->NumResidualBlocks() > 0) {
+    memory_usage +=
+        EstimateBundleAdjustmentMemoryUsage(options_,
+                                            optimized_views_.size(),
+                                            optimized_tracks_.size(),
+                                            problem_->NumResidualBlocks());
+  }
+  return memory_usage;
+}
+
 void BundleAdjuster::SetCameraPositionConstant(const ViewId view_id) {
   static const std::vector<int> position_parameters = {
       Camera::POSITION + 0, Camera::POSITION + 1, Camera::POSITION + 2};
@@ -506,6 +581,15 @@ bool BundleAdjuster::GetCovarianceForTrack(const TrackId track_id,
                                            Matrix3d* covariance_matrix) {
   const Track* track = reconstruction_->Track(track_id);
   *covariance_matrix = Matrix3d::Identity();
+  if (schur_bundle_adjuster_ != nullptr) {
+    std::map<TrackId, Matrix3d> covariance_matrices;
+    if (!schur_bundle_adjuster_->GetCovarianceForTracks({track_id},
+                                                        &covariance_matrices)) {
+      return false;
+    }
+    *covariance_matrix = covariance_matrices[track_id];
+    return true;
+  }
   ceres::Covariance covariance_estimator(covariance_options_);
 
   std::vector<std::pair<const double*, const double*>> covariance_blocks = {
@@ -528,6 +612,10 @@ bool BundleAdjuster::GetCovarianceForTrack(const TrackId track_id,
 bool BundleAdjuster::GetCovarianceForTracks(
     const std::vector<TrackId>& track_ids,
     std::map<TrackId, Eigen::Matrix3d>* covariance_matrices) {
+  if (schur_bundle_adjuster_ != nullptr) {
+    return schur_bundle_adjuster_->GetCovarianceForTracks(track_ids,
+                                                          covariance_matrices);
+  }
   ceres::Covariance covariance_estimator(covariance_options_);
   std::vector<std::pair<const double*, const double*>> covariance_blocks;
   std::vector<TrackId> est_track_ids;
@@ -564,6 +652,15 @@ bool BundleAdjuster::GetCovarianceForView(const ViewId view_id,
                                           Matrix6d* covariance_matrix) {
   const auto camera = reconstruction_->View(view_id)->Camera();
   *covariance_matrix = Matrix6d::Identity();
+  if (schur_bundle_adjuster_ != nullptr) {
+    std::map<ViewId, Matrix6d> covariance_matrices;
+    if (!schur_bundle_adjuster_->GetCovarianceForViews({view_id},
+                                                       &covariance_matrices)) {
+      return false;
+    }
+    *covariance_matrix = covariance_matrices[view_id];
+    return true;
+  }
 
   ceres::Covariance covariance_estimator(covariance_options_);
 
@@ -586,6 +683,10 @@ bool BundleAdjuster::GetCovarianceForView(const ViewId view_id,
 bool BundleAdjuster::GetCovarianceForViews(
     const std::vector<ViewId>& view_ids,
     std::map<ViewId, Matrix6d>* covariance_matrices) {
+  if (schur_bundle_adjuster_ != nullptr) {
+    return schur_bundle_adjuster_->GetCovarianceForViews(view_ids,
+                                                         covariance_matrices);
+  }
   ceres::Covariance covariance_estimator(covariance_options_);
   std::vector<std::pair<const double*, const double*>> covariance_blocks;
   std::vector<ViewId> est_view_ids;
@@ -40,6 +40,7 @@
 #include <unordered_set>
 
 #include "theia/sfm/bundle_adjustment/bundle_adjustment.h"
+#include "theia/sfm/bundle_adjustment/schur_bundle_adjuster.h"
 #include "theia/sfm/feature.h"
 #include "theia/sfm/types.h"
 #include "theia/sfm/view.h"
@@ -57,6 +58,9 @@ class View;
 // optimized. Only the views and tracks supplied with AddView and AddTrack will
 // be optimized. All other parameters are held constant.
 //
+// If options.backend is SCHUR the problem is solved with SchurBundleAdjuster
+// instead of Ceres when the options and cameras allow it.
+//
 // NOTE: It is required that AddViews is called before AddTracks if any views
 // are being optimized.
 class BundleAdjuster {
@@ -78,6 +82,11 @@ class BundleAdjuster {
   // and tracks with bundle adjustment.
   BundleAdjustmentSummary Optimize();
 
+  // The covariance methods below are computed with ceres::Covariance or, if
+  // the SCHUR backend optimized the problem, from the sparse inverse of its
+  // reduced camera system. Either way the covariances are in the tangent
+  // spaces of the parameters.
+
   // Get covariance for a single track
   bool GetCovarianceForTrack(const TrackId track_id,
                              Eigen::Matrix3d* covariance_matrix);
@@ -96,6 +105,10 @@ class BundleAdjuster {
     
   void SetCameraExtrinsicsConstant(const ViewId view_id);
 
+  // Returns the approximate number of bytes of memory used by the problem.
+  // Ceres does not report its memory usage, so the peak memory of optimizing
+  // the Ceres problem is estimated with EstimateBundleAdjustmentMemoryUsage.
+  size_t MemoryUsage() const;
 
  protected:
   // Add all camera extrinsics and intrinsics to the optimization problem.
@@ -169,6 +182,10 @@ class BundleAdjuster {
 
   // Covariance estimator
   ceres::Covariance::Options covariance_options_;
+
+  // The native solver if the SCHUR backend is used. Views and tracks are only
+  // added to the Ceres problem if it cannot solve the problem.
+  std::unique_ptr<SchurBundleAdjuster> schur_bundle_adjuster_;
 };
 
 }  // namespace theia
@@ -35,14 +35,81 @@
 #include "theia/sfm/bundle_adjustment/bundle_adjustment.h"
 
 #include <glog/logging.h>
+#include <algorithm>
 #include <unordered_set>
 
 #include "theia/sfm/bundle_adjustment/bundle_adjuster.h"
+#include "theia/sfm/camera/camera.h"
 #include "theia/sfm/reconstruction.h"
 #include "theia/sfm/types.h"
 
 namespace theia {
 
+size_t EstimateBundleAdjustmentMemoryUsage(
+    const BundleAdjustmentOptions& options,
+    const int num_views,
+    const int num_tracks,
+    const int num_observations) {
+  // Approximate bookkeeping overhead of a residual block (with its cost
+  // function) and of a parameter block.
+  static const double kResidualBlockBytes = 256.0;
+  static const double kParameterBlockBytes = 128.0;
+  // The size of a camera block with a typical number of intrinsics, and of a
+  // homogeneous point.
+  static const int kCameraBlockSize = Camera::kExtrinsicsSize + 5;
+  static const int kPointBlockSize = 4;
+  static const int kResidualSize = 2;
+
+  const double num_views_d = num_views;
+  const double num_observations_d = num_observations;
+  double memory_usage = num_observations_d * kResidualBlockBytes +
+                        (num_views_d + num_tracks) * kParameterBlockBytes;
+
+  // The residuals and the Jacobian of each observation.
+  memory_usage += num_observations_d * kResidualSize *
+                  (1 + kCameraBlockSize + kPointBlockSize) * sizeof(double);
+
+  // The point blocks of the Schur complement and their inverses.
+  memory_usage += 2.0 * num_tracks * kPointBlockSize * kPointBlockSize *
+                  sizeof(double);
+
+  // The reduced camera system.
+  const double camera_block_bytes =
+      kCameraBlockSize * kCameraBlockSize * sizeof(double);
+  switch (options.linear_solver_type) {
+    case ceres::DENSE_QR:
+    case ceres::DENSE_NORMAL_CHOLESKY: {
+      // The points are not eliminated, so the dense system contains all
+      // parameters.
+      const double num_parameters =
+          num_views_d * kCameraBlockSize + num_tracks * kPointBlockSize;
+      memory_usage += num_parameters * num_parameters * sizeof(double);
+      break;
+    }
+    case ceres::DENSE_SCHUR:
+      memory_usage += num_views_d * num_views_d * camera_block_bytes;
+      break;
+    case ceres::ITERATIVE_SCHUR:
+    case ceres::CGNR:
+      // Only the block diagonal preconditioner is stored.
+      memory_usage += num_views_d * camera_block_bytes;
+      break;
+    default: {
+      // Each observation couples its view with the other views of the track,
+      // and the fill-in of the factorization about doubles the storage.
+      const double mean_track_length =
+          num_tracks > 0 ? num_observations_d / num_tracks : 0.0;
+      const double num_view_pairs =
+          std::min(num_views_d * (num_views_d - 1.0) / 2.0,
+                   num_observations_d * std::max(mean_track_length - 1.0, 0.0) /
+                       2.0);
+      memory_usage += 2.0 * (num_views_d + num_view_pairs) * camera_block_bytes;
+      break;
+    }
+  }
+  return static_cast<size_t>(memory_usage);
+}
+
 // Bundle adjust the specified views and tracks.
 BundleAdjustmentSummary BundleAdjustPartialReconstruction(
     const BundleAdjustmentOptions& options,
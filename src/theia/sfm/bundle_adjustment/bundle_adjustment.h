@@ -83,6 +83,17 @@ enum class OptimizeIntrinsicsType {
 };
 ENABLE_ENUM_BITMASK_OPERATORS(OptimizeIntrinsicsType)
 
+// The optimizer that solves the bundle adjustment problem. CERES builds a
+// generic ceres::Problem with one residual block per observation and supports
+// all camera models and priors. SCHUR is a native Levenberg-Marquardt solver
+// (see schur_bundle_adjuster.h) with fixed-size camera and point blocks that is
+// much faster for large problems with pinhole cameras. Problems that SCHUR
+// does not support are solved with Ceres.
+enum class BundleAdjustmentBackend {
+  CERES = 0,
+  SCHUR = 1,
+};
+
 struct BundleAdjustmentOptions {
   // The type of loss function used for BA. By default, we use a standard L2
   // loss function, but robust cost functions could be used.
@@ -97,6 +108,23 @@ struct BundleAdjustmentOptions {
   ceres::PreconditionerType preconditioner_type = ceres::SCHUR_JACOBI;
   ceres::VisibilityClusteringType visibility_clustering_type =
       ceres::CANONICAL_VIEWS;
+  // The maximum number of conjugate gradient iterations of iterative linear
+  // solvers.
+  int max_linear_solver_iterations = 500;
+
+  // The SCHUR backend solves the reduced camera system with sparse Cholesky
+  // for SPARSE_SCHUR, with preconditioned conjugate gradients for
+  // ITERATIVE_SCHUR and CGNR and with a dense factorization for the dense
+  // linear solver types.
+  BundleAdjustmentBackend backend = BundleAdjustmentBackend::CERES;
+
+  // The SCHUR backend estimates covariances from the inverse of the reduced
+  // camera system. If this is 0, the inverse is computed exactly on the
+  // sparsity pattern of the reduced camera system. Otherwise it is estimated
+  // from this many random samples, which needs less time and memory for very
+  // large problems. The relative error of the estimated variances is then
+  // about sqrt(2 / num_covariance_samples).
+  int num_covariance_samples = 0;
 
   // If true, ceres will log verbosely.
   bool verbose = false;
@@ -115,6 +143,9 @@ struct BundleAdjustmentOptions {
   // adjustment. Default to NONE!
   OptimizeIntrinsicsType intrinsics_to_optimize = OptimizeIntrinsicsType::NONE;
 
+  // The number of threads is limited to the thread budget, and a single thread
+  // is used when called from within a parallel task (see
+  // GetNumThreadsForExternalSolver in util/threadpool.h).
   int num_threads = std::thread::hardware_concurrency();
   int max_num_iterations = 100;
 
@@ -151,10 +182,25 @@ struct BundleAdjustmentSummary {
   bool success = false;
   double initial_cost = 0.0;
   double final_cost = 0.0;
+  // The number of residuals in the problem. The cost divided by the number of
+  // residuals is comparable between problems of different sizes.
+  int num_residuals = 0;
   double setup_time_in_seconds = 0.0;
   double solve_time_in_seconds = 0.0;
 };
 
+// Returns a rough estimate of the peak number of bytes of memory used to bundle
+// adjust num_views views and num_tracks tracks with num_observations
+// reprojection errors. The estimate includes the residual blocks, the Jacobian,
+// the point blocks of the Schur complement and the reduced camera system for
+// the linear solver type of the options. This may be used to decide whether a
+// problem fits into a memory budget before it is set up.
+size_t EstimateBundleAdjustmentMemoryUsage(
+    const BundleAdjustmentOptions& options,
+    const int num_views,
+    const int num_tracks,
+    const int num_observations);
+
 // Bundle adjust all views and tracks in the reconstruction.
 BundleAdjustmentSummary BundleAdjustReconstruction(
     const BundleAdjustmentOptions& options, Reconstruction* reconstruction);
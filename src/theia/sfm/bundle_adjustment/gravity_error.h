@@ -40,6 +40,8 @@
 
 #include <Eigen/Core>
 
+#include "theia/sfm/camera/camera.h"
+
 namespace theia {
 
 struct GravityError {
@@ -39,6 +39,8 @@
 
 #include <Eigen/Core>
 
+#include "theia/sfm/camera/camera.h"
+
 namespace theia {
 
 struct PositionError {
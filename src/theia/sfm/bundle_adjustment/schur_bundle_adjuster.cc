@@ -0,0 +1,1612 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/sfm/bundle_adjustment/schur_bundle_adjuster.h"
+
+#include <Eigen/Cholesky>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/LU>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "theia/sfm/bundle_adjustment/create_loss_function.h"
+#include "theia/sfm/camera/camera.h"
+#include "theia/sfm/camera/camera_intrinsics_model.h"
+#include "theia/sfm/camera/pinhole_camera_model.h"
+#include "theia/sfm/feature.h"
+#include "theia/sfm/reconstruction.h"
+#include "theia/sfm/track.h"
+#include "theia/sfm/view.h"
+#include "theia/util/map_util.h"
+#include "theia/util/memory_usage.h"
+#include "theia/util/random.h"
+#include "theia/util/threadpool.h"
+
+namespace theia {
+
+namespace {
+
+static const int kExtrinsicsSize = Camera::kExtrinsicsSize;
+static const int kIntrinsicsSize = PinholeCameraModel::kIntrinsicsSize;
+
+// As in ReprojectionError, points this close to the camera center cannot be
+// projected.
+static const double kMinSquaredDistanceToCamera = 1e-8;
+
+// The damping and trust region parameters are the defaults of the Ceres
+// Levenberg-Marquardt minimizer.
+static const double kMinDiagonal = 1e-6;
+static const double kMaxDiagonal = 1e32;
+static const double kInitialTrustRegionRadius = 1e4;
+static const double kMinTrustRegionRadius = 1e-32;
+static const double kMinRelativeDecrease = 1e-3;
+
+// Conjugate gradients stop once the residual of the reduced camera system is
+// reduced by this factor.
+static const double kConjugateGradientsTolerance = 0.1;
+
+// The seed of the random samples of S^-1 for covariance estimation.
+static const unsigned kCovarianceSamplesSeed = 59;
+
+enum class ReducedCameraSystemSolver {
+  SPARSE_CHOLESKY,
+  CONJUGATE_GRADIENTS,
+  DENSE_CHOLESKY,
+};
+
+ReducedCameraSystemSolver GetReducedCameraSystemSolver(
+    const ceres::LinearSolverType linear_solver_type) {
+  switch (linear_solver_type) {
+    case ceres::ITERATIVE_SCHUR:
+    case ceres::CGNR:
+      return ReducedCameraSystemSolver::CONJUGATE_GRADIENTS;
+    case ceres::DENSE_SCHUR:
+    case ceres::DENSE_QR:
+    case ceres::DENSE_NORMAL_CHOLESKY:
+      return ReducedCameraSystemSolver::DENSE_CHOLESKY;
+    default:
+      return ReducedCameraSystemSolver::SPARSE_CHOLESKY;
+  }
+}
+
+Eigen::Matrix3d CrossProductMatrix(const Eigen::Vector3d& vector) {
+  Eigen::Matrix3d cross_product_matrix;
+  cross_product_matrix << 0.0, -vector.z(), vector.y(), vector.z(), 0.0,
+      -vector.x(), -vector.y(), vector.x(), 0.0;
+  return cross_product_matrix;
+}
+
+Eigen::Matrix3d AngleAxisToRotationMatrix(const Eigen::Vector3d& angle_axis) {
+  const double angle = angle_axis.norm();
+  if (angle < std::numeric_limits<double>::epsilon()) {
+    return Eigen::Matrix3d::Identity() + CrossProductMatrix(angle_axis);
+  }
+  return Eigen::AngleAxisd(angle, angle_axis / angle).toRotationMatrix();
+}
+
+Eigen::Vector3d RotationMatrixToAngleAxis(const Eigen::Matrix3d& rotation) {
+  const Eigen::AngleAxisd angle_axis(rotation);
+  return angle_axis.angle() * angle_axis.axis();
+}
+
+// Returns an orthonormal basis of the vectors orthogonal to the unit vector x,
+// i.e. the tangent space of the sphere at x, from the Householder reflection
+// that maps x to the positive last coordinate axis. This is the basis of
+// ceres::SphereManifold, so covariances of both backends are comparable.
+Eigen::Matrix<double, 4, 3> SphereTangentBasis(const Eigen::Vector4d& x) {
+  Eigen::Matrix4d householder = Eigen::Matrix4d::Identity();
+  const double sigma = x.head<3>().squaredNorm();
+  if (sigma <= std::numeric_limits<double>::epsilon()) {
+    return householder.leftCols<3>();
+  }
+  Eigen::Vector4d v = x;
+  v[3] = x[3] <= 0.0 ? x[3] - 1.0 : -sigma / (x[3] + 1.0);
+  householder -= 2.0 * v * v.transpose() / v.squaredNorm();
+  return householder.leftCols<3>();
+}
+
+// Returns the derivative of the angle-axis vector of exp(delta) * R with
+// respect to delta at zero, i.e. the inverse of the left Jacobian of SO(3) at
+// the angle-axis vector of R.
+Eigen::Matrix3d InverseLeftJacobian(const Eigen::Vector3d& angle_axis) {
+  const double angle = angle_axis.norm();
+  const Eigen::Matrix3d cross_product_matrix = CrossProductMatrix(angle_axis);
+  const double second_order_coefficient =
+      angle < 1e-4 ? 1.0 / 12.0
+                   : 1.0 / (angle * angle) -
+                         (1.0 + std::cos(angle)) /
+                             (2.0 * angle * std::sin(angle));
+  return Eigen::Matrix3d::Identity() - 0.5 * cross_product_matrix +
+         second_order_coefficient * cross_product_matrix *
+             cross_product_matrix;
+}
+
+// Applies a robust loss with derivatives rho to a residual r and returns the
+// matrix that its Jacobians are multiplied with. This is the second order
+// correction of Triggs et al. ("Bundle Adjustment - A Modern Synthesis",
+// Section 4.3), which gives the corrected problem the gradient rho' * J^T * r
+// and the Gauss-Newton Hessian J^T * (rho' + 2 * rho'' * r * r^T) * J. Like
+// ceres::Corrector, the correction is only applied where rho'' > 0, since the
+// Hessian may be indefinite otherwise, e.g. for the outliers of the Huber and
+// Cauchy losses. There both are scaled by sqrt(rho').
+Eigen::Matrix2d ApplyRobustLoss(const double rho[3],
+                                Eigen::Vector2d* residual) {
+  const double sq_norm = residual->squaredNorm();
+  const double sqrt_rho1 = std::sqrt(std::max(rho[1], 0.0));
+  if (sq_norm == 0.0 || rho[1] <= 0.0 || rho[2] <= 0.0) {
+    *residual *= sqrt_rho1;
+    return sqrt_rho1 * Eigen::Matrix2d::Identity();
+  }
+
+  // The smaller root of 0.5 * alpha^2 - alpha - rho'' / rho' * |r|^2 = 0.
+  const double alpha = 1.0 - std::sqrt(1.0 + 2.0 * sq_norm * rho[2] / rho[1]);
+  const Eigen::Matrix2d jacobian_scaling =
+      sqrt_rho1 * (Eigen::Matrix2d::Identity() -
+                   (alpha / sq_norm) * *residual * residual->transpose());
+  *residual *= sqrt_rho1 / (1.0 - alpha);
+  return jacobian_scaling;
+}
+
+// Adds the product to the row-major block of S.
+template <int kRows, int kCols, class Derived>
+void AddToBlock(const Eigen::MatrixBase<Derived>& product, double* block) {
+  Eigen::Map<Eigen::Matrix<double, kRows, kCols, Eigen::RowMajor> >(block) +=
+      product;
+}
+
+}  // namespace
+
+SchurBundleAdjuster::SchurBundleAdjuster(
+    const BundleAdjustmentOptions& options, Reconstruction* reconstruction)
+    : options_(options),
+      num_threads_(std::max(std::min(options.num_threads, GetThreadBudget()),
+                            1)),
+      reconstruction_(CHECK_NOTNULL(reconstruction)),
+      is_supported_(true),
+      num_extrinsics_blocks_(0),
+      gradient_max_norm_(0.0),
+      is_covariance_computed_(false),
+      is_covariance_valid_(false) {
+  timer_.Reset();
+  loss_function_ =
+      CreateLossFunction(options.loss_function_type, options.robust_loss_width);
+}
+
+SchurBundleAdjuster::~SchurBundleAdjuster() {}
+
+bool SchurBundleAdjuster::SupportsOptions(
+    const BundleAdjustmentOptions& options) {
+  return !options.use_position_priors && !options.use_gravity_priors &&
+         !options.use_depth_priors && !options.orthographic_camera;
+}
+
+void SchurBundleAdjuster::AddView(const ViewId view_id) {
+  const View* view = CHECK_NOTNULL(reconstruction_->View(view_id));
+  if (!view->IsEstimated() || ContainsKey(optimized_views_, view_id)) {
+    return;
+  }
+  optimized_views_.emplace(view_id);
+  added_views_.emplace_back(view_id);
+  if (view->Camera().GetCameraIntrinsicsModelType() !=
+      CameraIntrinsicsModelType::PINHOLE) {
+    is_supported_ = false;
+  }
+}
+
+void SchurBundleAdjuster::AddTrack(const TrackId track_id,
+                                   const bool use_homogeneous) {
+  const Track* track = CHECK_NOTNULL(reconstruction_->Track(track_id));
+  if (!track->IsEstimated() || ContainsKey(optimized_tracks_, track_id)) {
+    return;
+  }
+  optimized_tracks_.emplace(track_id);
+  added_tracks_.emplace_back(track_id, use_homogeneous);
+  for (const ViewId view_id : track->ViewIds()) {
+    const View* view = CHECK_NOTNULL(reconstruction_->View(view_id));
+    if (view->IsEstimated() && view->Camera().GetCameraIntrinsicsModelType() !=
+                                   CameraIntrinsicsModelType::PINHOLE) {
+      is_supported_ = false;
+    }
+  }
+}
+
+void SchurBundleAdjuster::SetCameraExtrinsicsConstant(const ViewId view_id) {
+  constant_views_.emplace_back(view_id);
+}
+
+size_t SchurBundleAdjuster::MemoryUsage() const {
+  size_t memory_usage =
+      sizeof(*this) + HeapMemoryUsage(added_views_) +
+      HeapMemoryUsage(added_tracks_) + HeapMemoryUsage(constant_views_) +
+      HeapMemoryUsage(optimized_views_) + HeapMemoryUsage(optimized_tracks_);
+
+  // The problem and the linearization.
+  memory_usage += HeapMemoryUsage(cameras_) + HeapMemoryUsage(intrinsics_) +
+                  HeapMemoryUsage(points_) + HeapMemoryUsage(observations_) +
+                  HeapMemoryUsage(camera_indices_) +
+                  HeapMemoryUsage(point_indices_) +
+                  HeapMemoryUsage(rotations_) +
+                  HeapMemoryUsage(point_tangent_bases_) +
+                  HeapMemoryUsage(residuals_) +
+                  HeapMemoryUsage(extrinsics_jacobians_) +
+                  HeapMemoryUsage(intrinsics_jacobians_) +
+                  HeapMemoryUsage(point_jacobians_) +
+                  HeapMemoryUsage(point_hessians_) +
+                  HeapMemoryUsage(point_gradients_) +
+                  HeapMemoryUsage(inverse_point_hessians_) +
+                  HeapMemoryUsage(point_steps_) +
+                  HeapMemoryUsage(saved_parameters_);
+
+  // The reduced camera system.
+  memory_usage += HeapMemoryUsage(block_offsets_) +
+                  HeapMemoryUsage(block_observation_offsets_) +
+                  HeapMemoryUsage(block_observations_) +
+                  HeapMemoryUsage(row_offsets_) + HeapMemoryUsage(col_blocks_) +
+                  HeapMemoryUsage(value_offsets_) + HeapMemoryUsage(values_) +
+                  HeapMemoryUsage(transpose_offsets_) +
+                  HeapMemoryUsage(transpose_blocks_) +
+                  HeapMemoryUsage(transpose_rows_) +
+                  HeapMemoryUsage(sparse_value_indices_) +
+                  sparse_matrix_.nonZeros() * (sizeof(double) + sizeof(int)) +
+                  (sparse_matrix_.outerSize() + 1) * sizeof(int);
+  memory_usage += HeapMemoryUsage(reduced_rhs_) +
+                  HeapMemoryUsage(camera_gradient_) +
+                  HeapMemoryUsage(camera_diagonal_) +
+                  HeapMemoryUsage(covariance_samples_);
+  return memory_usage;
+}
+
+int SchurBundleAdjuster::ExtrinsicsBlock(const Observation& observation) const {
+  return cameras_[observation.camera].extrinsics_block;
+}
+
+int SchurBundleAdjuster::IntrinsicsBlock(const Observation& observation) const {
+  return intrinsics_[cameras_[observation.camera].intrinsics].block;
+}
+
+void SchurBundleAdjuster::SetUpProblem() {
+  const std::unordered_set<ViewId> constant_views(constant_views_.begin(),
+                                                  constant_views_.end());
+  const bool constant_extrinsics = options_.constant_camera_orientation &&
+                                   options_.constant_camera_position;
+
+  // Add the cameras and their intrinsics groups. The intrinsics of a group are
+  // optimized if any view of the group is optimized.
+  std::unordered_map<CameraIntrinsicsGroupId, int> intrinsics_indices;
+  std::vector<bool> is_intrinsics_optimized;
+  const auto add_camera = [&](const ViewId view_id, const bool is_optimized) {
+    const auto it = camera_indices_.find(view_id);
+    if (it != camera_indices_.end()) {
+      return it->second;
+    }
+    const CameraIntrinsicsGroupId group_id =
+        reconstruction_->CameraIntrinsicsGroupIdFromViewId(view_id);
+    auto intrinsics_it = intrinsics_indices.find(group_id);
+    if (intrinsics_it == intrinsics_indices.end()) {
+      intrinsics_it =
+          intrinsics_indices.emplace(group_id, intrinsics_.size()).first;
+      intrinsics_.emplace_back();
+      intrinsics_.back().parameters = reconstruction_->MutableView(view_id)
+                                          ->MutableCamera()
+                                          ->mutable_intrinsics();
+      is_intrinsics_optimized.emplace_back(false);
+    }
+    if (is_optimized) {
+      is_intrinsics_optimized[intrinsics_it->second] = true;
+    }
+
+    CameraBlock camera;
+    camera.camera = reconstruction_->MutableView(view_id)->MutableCamera();
+    camera.intrinsics = intrinsics_it->second;
+    camera.extrinsics_block =
+        is_optimized && !constant_extrinsics &&
+                !ContainsKey(constant_views, view_id)
+            ? 0
+            : -1;
+    camera_indices_.emplace(view_id, cameras_.size());
+    cameras_.emplace_back(camera);
+    return static_cast<int>(cameras_.size()) - 1;
+  };
+
+  std::unordered_map<TrackId, bool> use_homogeneous;
+  for (const auto& track : added_tracks_) {
+    use_homogeneous.emplace(track.first, track.second);
+  }
+  const auto add_point = [&](const TrackId track_id) {
+    const auto it = point_indices_.find(track_id);
+    if (it != point_indices_.end()) {
+      return it->second;
+    }
+    PointBlock point;
+    point.point = reconstruction_->MutableTrack(track_id)->MutablePoint();
+    point.is_variable = ContainsKey(optimized_tracks_, track_id);
+    point.use_homogeneous = FindWithDefault(use_homogeneous, track_id, false);
+    point.first_observation = 0;
+    point.num_observations = 0;
+    point_indices_.emplace(track_id, points_.size());
+    points_.emplace_back(point);
+    return static_cast<int>(points_.size()) - 1;
+  };
+
+  const auto add_observation = [&](const int camera_index,
+                                   const int point_index,
+                                   const Feature& feature) {
+    Observation observation;
+    observation.camera = camera_index;
+    observation.point = point_index;
+    observation.feature = feature.point_;
+    observation.sqrt_information =
+        feature.covariance_.diagonal().cwiseSqrt().cwiseInverse();
+    observations_.emplace_back(observation);
+  };
+
+  // Residuals of the optimized views, as in BundleAdjuster::AddView.
+  for (const ViewId view_id : added_views_) {
+    const int camera_index = add_camera(view_id, true);
+    const View* view = reconstruction_->View(view_id);
+    for (const TrackId track_id : view->TrackIds()) {
+      if (!reconstruction_->Track(track_id)->IsEstimated()) {
+        continue;
+      }
+      add_observation(
+          camera_index, add_point(track_id), *view->GetFeature(track_id));
+    }
+  }
+
+  // Residuals of the views that only observe optimized tracks, as in
+  // BundleAdjuster::AddTrack.
+  for (const auto& added_track : added_tracks_) {
+    const int point_index = add_point(added_track.first);
+    const Track* track = reconstruction_->Track(added_track.first);
+    for (const ViewId view_id : track->ViewIds()) {
+      const View* view = reconstruction_->View(view_id);
+      if (ContainsKey(optimized_views_, view_id) || !view->IsEstimated()) {
+        continue;
+      }
+      add_observation(add_camera(view_id, false),
+                      point_index,
+                      *view->GetFeature(added_track.first));
+    }
+  }
+
+  // Number the blocks of S: the variable extrinsics first, then the variable
+  // intrinsics.
+  block_offsets_.assign(1, 0);
+  for (CameraBlock& camera : cameras_) {
+    if (camera.extrinsics_block == -1) {
+      continue;
+    }
+    camera.extrinsics_block = block_offsets_.size() - 1;
+    block_offsets_.emplace_back(block_offsets_.back() + kExtrinsicsSize);
+  }
+  num_extrinsics_blocks_ = block_offsets_.size() - 1;
+
+  const std::vector<int> constant_intrinsics =
+      PinholeCameraModel().GetSubsetFromOptimizeIntrinsicsType(
+          options_.intrinsics_to_optimize);
+  for (int i = 0; i < intrinsics_.size(); i++) {
+    IntrinsicsGroup& intrinsics = intrinsics_[i];
+    intrinsics.block = -1;
+    std::fill(intrinsics.is_constant, intrinsics.is_constant + kIntrinsicsSize,
+              true);
+    if (!is_intrinsics_optimized[i] ||
+        constant_intrinsics.size() == kIntrinsicsSize) {
+      continue;
+    }
+    std::fill(intrinsics.is_constant, intrinsics.is_constant + kIntrinsicsSize,
+              false);
+    for (const int constant_intrinsic : constant_intrinsics) {
+      intrinsics.is_constant[constant_intrinsic] = true;
+    }
+    intrinsics.block = block_offsets_.size() - 1;
+    block_offsets_.emplace_back(block_offsets_.back() + kIntrinsicsSize);
+  }
+
+  // Group the observations by point so that each point is eliminated from a
+  // contiguous range.
+  std::sort(observations_.begin(),
+            observations_.end(),
+            [](const Observation& lhs, const Observation& rhs) {
+              return lhs.point < rhs.point ||
+                     (lhs.point == rhs.point && lhs.camera < rhs.camera);
+            });
+  for (int i = 0; i < observations_.size(); i++) {
+    PointBlock& point = points_[observations_[i].point];
+    if (point.num_observations == 0) {
+      point.first_observation = i;
+    }
+    ++point.num_observations;
+  }
+
+  // The observations that contribute to each block row of S.
+  const int num_blocks = block_offsets_.size() - 1;
+  block_observation_offsets_.assign(num_blocks + 1, 0);
+  for (const Observation& observation : observations_) {
+    for (const int block :
+         {ExtrinsicsBlock(observation), IntrinsicsBlock(observation)}) {
+      if (block != -1) {
+        ++block_observation_offsets_[block + 1];
+      }
+    }
+  }
+  for (int i = 0; i < num_blocks; i++) {
+    block_observation_offsets_[i + 1] += block_observation_offsets_[i];
+  }
+  block_observations_.resize(block_observation_offsets_.back());
+  std::vector<int> num_block_observations(num_blocks, 0);
+  for (int i = 0; i < observations_.size(); i++) {
+    for (const int block : {ExtrinsicsBlock(observations_[i]),
+                            IntrinsicsBlock(observations_[i])}) {
+      if (block != -1) {
+        block_observations_[block_observation_offsets_[block] +
+                            num_block_observations[block]++] = i;
+      }
+    }
+  }
+
+  BuildReducedCameraSystemStructure();
+  if (GetReducedCameraSystemSolver(options_.linear_solver_type) ==
+      ReducedCameraSystemSolver::SPARSE_CHOLESKY) {
+    BuildSparseMatrixStructure();
+  }
+
+  rotations_.resize(cameras_.size());
+  point_tangent_bases_.resize(points_.size());
+  residuals_.resize(observations_.size());
+  extrinsics_jacobians_.resize(observations_.size());
+  intrinsics_jacobians_.resize(observations_.size());
+  point_jacobians_.resize(observations_.size());
+  point_hessians_.resize(points_.size());
+  point_gradients_.resize(points_.size());
+  inverse_point_hessians_.resize(points_.size());
+  point_steps_.resize(points_.size());
+}
+
+void SchurBundleAdjuster::BuildReducedCameraSystemStructure() {
+  // Block (i, j) of S is nonzero if an observation contributes to blocks i and
+  // j or if two observations of the same variable point do.
+  const int num_blocks = block_offsets_.size() - 1;
+  std::vector<std::vector<int> > row_col_blocks(num_blocks);
+  ParallelFor(num_threads_, num_blocks, [&](const int row) {
+    std::vector<int>& col_blocks = row_col_blocks[row];
+    const auto add_blocks = [&](const Observation& observation) {
+      for (const int block :
+           {ExtrinsicsBlock(observation), IntrinsicsBlock(observation)}) {
+        if (block >= row) {
+          col_blocks.emplace_back(block);
+        }
+      }
+    };
+
+    for (int i = block_observation_offsets_[row];
+         i < block_observation_offsets_[row + 1];
+         i++) {
+      const Observation& observation = observations_[block_observations_[i]];
+      const PointBlock& point = points_[observation.point];
+      if (!point.is_variable) {
+        add_blocks(observation);
+        continue;
+      }
+      for (int j = 0; j < point.num_observations; j++) {
+        add_blocks(observations_[point.first_observation + j]);
+      }
+    }
+    std::sort(col_blocks.begin(), col_blocks.end());
+    col_blocks.erase(std::unique(col_blocks.begin(), col_blocks.end()),
+                     col_blocks.end());
+  });
+
+  row_offsets_.assign(1, 0);
+  col_blocks_.clear();
+  value_offsets_.clear();
+  int num_values = 0;
+  for (int row = 0; row < num_blocks; row++) {
+    const int row_size = block_offsets_[row + 1] - block_offsets_[row];
+    for (const int col : row_col_blocks[row]) {
+      col_blocks_.emplace_back(col);
+      value_offsets_.emplace_back(num_values);
+      num_values += row_size * (block_offsets_[col + 1] - block_offsets_[col]);
+    }
+    row_offsets_.emplace_back(col_blocks_.size());
+    std::vector<int>().swap(row_col_blocks[row]);
+  }
+  values_.resize(num_values);
+  reduced_rhs_.resize(block_offsets_.back());
+
+  if (GetReducedCameraSystemSolver(options_.linear_solver_type) !=
+      ReducedCameraSystemSolver::CONJUGATE_GRADIENTS) {
+    return;
+  }
+
+  // Index the blocks above the diagonal by column for products with the lower
+  // triangle.
+  transpose_offsets_.assign(num_blocks + 1, 0);
+  for (int row = 0; row < num_blocks; row++) {
+    for (int i = row_offsets_[row]; i < row_offsets_[row + 1]; i++) {
+      if (col_blocks_[i] != row) {
+        ++transpose_offsets_[col_blocks_[i] + 1];
+      }
+    }
+  }
+  for (int i = 0; i < num_blocks; i++) {
+    transpose_offsets_[i + 1] += transpose_offsets_[i];
+  }
+  transpose_blocks_.resize(transpose_offsets_.back());
+  transpose_rows_.resize(transpose_offsets_.back());
+  std::vector<int> num_transpose_blocks(num_blocks, 0);
+  for (int row = 0; row < num_blocks; row++) {
+    for (int i = row_offsets_[row]; i < row_offsets_[row + 1]; i++) {
+      const int col = col_blocks_[i];
+      if (col != row) {
+        const int index =
+            transpose_offsets_[col] + num_transpose_blocks[col]++;
+        transpose_blocks_[index] = i;
+        transpose_rows_[index] = row;
+      }
+    }
+  }
+}
+
+void SchurBundleAdjuster::BuildSparseMatrixStructure() {
+  // The upper triangle of S with scalar entries.
+  const int num_blocks = block_offsets_.size() - 1;
+  std::vector<Eigen::Triplet<double> > triplets;
+  for (int row = 0; row < num_blocks; row++) {
+    for (int i = row_offsets_[row]; i < row_offsets_[row + 1]; i++) {
+      const int col = col_blocks_[i];
+      for (int r = block_offsets_[row]; r < block_offsets_[row + 1]; r++) {
+        for (int c = std::max(r, block_offsets_[col]);
+             c < block_offsets_[col + 1];
+             c++) {
+          triplets.emplace_back(r, c, 0.0);
+        }
+      }
+    }
+  }
+  sparse_matrix_.resize(block_offsets_.back(), block_offsets_.back());
+  sparse_matrix_.setFromTriplets(triplets.begin(), triplets.end());
+  sparse_matrix_.makeCompressed();
+
+  // Find the scalar entry of each block value.
+  sparse_value_indices_.assign(values_.size(), -1);
+  const int* outer_index = sparse_matrix_.outerIndexPtr();
+  const int* inner_index = sparse_matrix_.innerIndexPtr();
+  ParallelFor(num_threads_, num_blocks, [&](const int row) {
+    for (int i = row_offsets_[row]; i < row_offsets_[row + 1]; i++) {
+      const int col = col_blocks_[i];
+      const int col_size = block_offsets_[col + 1] - block_offsets_[col];
+      for (int r = block_offsets_[row]; r < block_offsets_[row + 1]; r++) {
+        for (int c = std::max(r, block_offsets_[col]);
+             c < block_offsets_[col + 1];
+             c++) {
+          const int* entry = std::lower_bound(inner_index + outer_index[c],
+                                              inner_index + outer_index[c + 1],
+                                              r);
+          sparse_value_indices_[value_offsets_[i] +
+                                (r - block_offsets_[row]) * col_size +
+                                (c - block_offsets_[col])] =
+              entry - inner_index;
+        }
+      }
+    }
+  });
+}
+
+void SchurBundleAdjuster::CopyToSparseMatrix() {
+  double* sparse_values = sparse_matrix_.valuePtr();
+  ParallelForRange(num_threads_,
+                   values_.size(),
+                   [&](const int begin, const int end) {
+                     for (int i = begin; i < end; i++) {
+                       if (sparse_value_indices_[i] != -1) {
+                         sparse_values[sparse_value_indices_[i]] = values_[i];
+                       }
+                     }
+                   });
+}
+
+double* SchurBundleAdjuster::MutableBlock(const int row, const int col) {
+  const auto it = std::lower_bound(col_blocks_.begin() + row_offsets_[row],
+                                   col_blocks_.begin() + row_offsets_[row + 1],
+                                   col);
+  DCHECK(it != col_blocks_.begin() + row_offsets_[row + 1] && *it == col);
+  return values_.data() + value_offsets_[it - col_blocks_.begin()];
+}
+
+void SchurBundleAdjuster::PrepareEvaluation() {
+  ParallelFor(num_threads_, cameras_.size(), [&](const int i) {
+    rotations_[i] = AngleAxisToRotationMatrix(Eigen::Map<const Eigen::Vector3d>(
+        cameras_[i].camera->extrinsics() + Camera::ORIENTATION));
+  });
+
+  // Steps of homogeneous points are taken in the tangent space of the sphere
+  // through the point, scaled by the norm of the point. Steps of Euclidean
+  // points change the first three coordinates.
+  ParallelFor(num_threads_, points_.size(), [&](const int i) {
+    const PointBlock& point = points_[i];
+    if (!point.is_variable) {
+      return;
+    }
+    if (!point.use_homogeneous) {
+      point_tangent_bases_[i].setIdentity();
+      return;
+    }
+    const double norm = point.point->norm();
+    point_tangent_bases_[i] = norm * SphereTangentBasis(*point.point / norm);
+  });
+}
+
+bool SchurBundleAdjuster::EvaluateObservation(
+    const int observation_index,
+    Eigen::Vector2d* residual,
+    ExtrinsicsJacobian* extrinsics_jacobian,
+    IntrinsicsJacobian* intrinsics_jacobian,
+    PointJacobian* point_jacobian) const {
+  const Observation& observation = observations_[observation_index];
+  const Camera& camera = *cameras_[observation.camera].camera;
+  const IntrinsicsGroup& intrinsics =
+      intrinsics_[cameras_[observation.camera].intrinsics];
+  const Eigen::Vector4d& point = *points_[observation.point].point;
+  const Eigen::Matrix3d& rotation = rotations_[observation.camera];
+  const Eigen::Map<const Eigen::Vector3d> position(camera.extrinsics() +
+                                                   Camera::POSITION);
+
+  const Eigen::Vector3d adjusted_point =
+      point.head<3>() - point[3] * position;
+  if (adjusted_point.squaredNorm() < kMinSquaredDistanceToCamera) {
+    return false;
+  }
+  const Eigen::Vector3d rotated_point = rotation * adjusted_point;
+
+  // Project the point with the pinhole camera model.
+  const double* parameters = intrinsics.parameters;
+  const double focal_length = parameters[PinholeCameraModel::FOCAL_LENGTH];
+  const double aspect_ratio = parameters[PinholeCameraModel::ASPECT_RATIO];
+  const double skew = parameters[PinholeCameraModel::SKEW];
+  const double radial_distortion1 =
+      parameters[PinholeCameraModel::RADIAL_DISTORTION_1];
+  const double radial_distortion2 =
+      parameters[PinholeCameraModel::RADIAL_DISTORTION_2];
+
+  const double inverse_depth = 1.0 / rotated_point.z();
+  const double x = rotated_point.x() * inverse_depth;
+  const double y = rotated_point.y() * inverse_depth;
+  const double r_sq = x * x + y * y;
+  const double distortion =
+      1.0 + r_sq * (radial_distortion1 + radial_distortion2 * r_sq);
+  const double distorted_x = x * distortion;
+  const double distorted_y = y * distortion;
+  const Eigen::Vector2d pixel(
+      focal_length * distorted_x + skew * distorted_y +
+          parameters[PinholeCameraModel::PRINCIPAL_POINT_X],
+      focal_length * aspect_ratio * distorted_y +
+          parameters[PinholeCameraModel::PRINCIPAL_POINT_Y]);
+  *residual = observation.sqrt_information.cwiseProduct(
+      pixel - observation.feature);
+  if (extrinsics_jacobian == nullptr) {
+    return true;
+  }
+
+  // Chain rule from the rotated point to the weighted residual.
+  Eigen::Matrix2d pixel_jacobian;
+  pixel_jacobian << focal_length, skew, 0.0, focal_length * aspect_ratio;
+  const double distortion_derivative =
+      2.0 * (radial_distortion1 + 2.0 * radial_distortion2 * r_sq);
+  Eigen::Matrix2d distortion_jacobian;
+  distortion_jacobian << distortion + x * x * distortion_derivative,
+      x * y * distortion_derivative, x * y * distortion_derivative,
+      distortion + y * y * distortion_derivative;
+  Eigen::Matrix<double, 2, 3> projection_jacobian;
+  projection_jacobian << inverse_depth, 0.0, -x * inverse_depth, 0.0,
+      inverse_depth, -y * inverse_depth;
+  const Eigen::Matrix<double, 2, 3> rotated_point_jacobian =
+      observation.sqrt_information.asDiagonal() * pixel_jacobian *
+      distortion_jacobian * projection_jacobian;
+
+  // The orientation is perturbed by a rotation from the left.
+  extrinsics_jacobian->leftCols<3>() =
+      -rotated_point_jacobian * CrossProductMatrix(rotated_point);
+  extrinsics_jacobian->rightCols<3>() =
+      -point[3] * rotated_point_jacobian * rotation;
+  if (options_.constant_camera_orientation) {
+    extrinsics_jacobian->leftCols<3>().setZero();
+  }
+  if (options_.constant_camera_position) {
+    extrinsics_jacobian->rightCols<3>().setZero();
+  }
+
+  const PointTangentBasis& tangent_basis =
+      point_tangent_bases_[observation.point];
+  *point_jacobian =
+      rotated_point_jacobian * rotation *
+      (tangent_basis.topRows<3>() - position * tangent_basis.row(3));
+
+  const double radial_distortion_x =
+      (focal_length * x + skew * y) * r_sq;
+  const double radial_distortion_y = focal_length * aspect_ratio * y * r_sq;
+  intrinsics_jacobian->setZero();
+  intrinsics_jacobian->col(PinholeCameraModel::FOCAL_LENGTH)
+      << distorted_x, aspect_ratio * distorted_y;
+  intrinsics_jacobian->col(PinholeCameraModel::ASPECT_RATIO)
+      << 0.0, focal_length * distorted_y;
+  intrinsics_jacobian->col(PinholeCameraModel::SKEW) << distorted_y, 0.0;
+  intrinsics_jacobian->col(PinholeCameraModel::PRINCIPAL_POINT_X) << 1.0, 0.0;
+  intrinsics_jacobian->col(PinholeCameraModel::PRINCIPAL_POINT_Y) << 0.0, 1.0;
+  intrinsics_jacobian->col(PinholeCameraModel::RADIAL_DISTORTION_1)
+      << radial_distortion_x, radial_distortion_y;
+  intrinsics_jacobian->col(PinholeCameraModel::RADIAL_DISTORTION_2)
+      << radial_distortion_x * r_sq, radial_distortion_y * r_sq;
+  for (int i = 0; i < kIntrinsicsSize; i++) {
+    if (intrinsics.is_constant[i]) {
+      intrinsics_jacobian->col(i).setZero();
+    }
+  }
+  *intrinsics_jacobian =
+      observation.sqrt_information.asDiagonal() * *intrinsics_jacobian;
+  return true;
+}
+
+double SchurBundleAdjuster::EvaluateCost() {
+  PrepareEvaluation();
+  std::mutex mutex;
+  double cost = 0.0;
+  std::atomic<bool> success(true);
+  ParallelForRange(
+      num_threads_, observations_.size(), [&](const int begin,
+                                              const int end) {
+        double partial_cost = 0.0;
+        Eigen::Vector2d residual;
+        for (int i = begin; i < end; i++) {
+          if (!EvaluateObservation(i, &residual, nullptr, nullptr, nullptr)) {
+            success = false;
+            return;
+          }
+          double rho[3] = {residual.squaredNorm(), 1.0, 0.0};
+          loss_function_->Evaluate(rho[0], rho);
+          partial_cost += rho[0];
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        cost += partial_cost;
+      });
+  return success ? 0.5 * cost : -1.0;
+}
+
+void SchurBundleAdjuster::Linearize() {
+  // Residuals and Jacobians of the observations with robust losses applied
+  // (see ApplyRobustLoss).
+  ParallelFor(num_threads_, observations_.size(), [&](const int i) {
+    if (!EvaluateObservation(i,
+                             &residuals_[i],
+                             &extrinsics_jacobians_[i],
+                             &intrinsics_jacobians_[i],
+                             &point_jacobians_[i])) {
+      residuals_[i].setZero();
+      extrinsics_jacobians_[i].setZero();
+      intrinsics_jacobians_[i].setZero();
+      point_jacobians_[i].setZero();
+      return;
+    }
+    double rho[3] = {residuals_[i].squaredNorm(), 1.0, 0.0};
+    loss_function_->Evaluate(rho[0], rho);
+    const Eigen::Matrix2d jacobian_scaling =
+        ApplyRobustLoss(rho, &residuals_[i]);
+    extrinsics_jacobians_[i] = jacobian_scaling * extrinsics_jacobians_[i];
+    intrinsics_jacobians_[i] = jacobian_scaling * intrinsics_jacobians_[i];
+    point_jacobians_[i] = jacobian_scaling * point_jacobians_[i];
+  });
+
+  // The point blocks V and the point gradients.
+  ParallelFor(num_threads_, points_.size(), [&](const int i) {
+    const PointBlock& point = points_[i];
+    point_hessians_[i].setZero();
+    point_gradients_[i].setZero();
+    if (!point.is_variable) {
+      return;
+    }
+    for (int j = point.first_observation;
+         j < point.first_observation + point.num_observations;
+         j++) {
+      point_hessians_[i].noalias() +=
+          point_jacobians_[j].transpose() * point_jacobians_[j];
+      point_gradients_[i].noalias() +=
+          point_jacobians_[j].transpose() * residuals_[j];
+    }
+  });
+
+  // The camera gradient and the diagonal of U.
+  const int num_blocks = block_offsets_.size() - 1;
+  camera_gradient_.setZero(block_offsets_.back());
+  camera_diagonal_.setZero(block_offsets_.back());
+  ParallelFor(num_threads_, num_blocks, [&](const int row) {
+    const int offset = block_offsets_[row];
+    for (int i = block_observation_offsets_[row];
+         i < block_observation_offsets_[row + 1];
+         i++) {
+      const int j = block_observations_[i];
+      if (row < num_extrinsics_blocks_) {
+        camera_gradient_.segment<kExtrinsicsSize>(offset).noalias() +=
+            extrinsics_jacobians_[j].transpose() * residuals_[j];
+        camera_diagonal_.segment<kExtrinsicsSize>(offset) +=
+            extrinsics_jacobians_[j].colwise().squaredNorm().transpose();
+      } else {
+        camera_gradient_.segment<kIntrinsicsSize>(offset).noalias() +=
+            intrinsics_jacobians_[j].transpose() * residuals_[j];
+        camera_diagonal_.segment<kIntrinsicsSize>(offset) +=
+            intrinsics_jacobians_[j].colwise().squaredNorm().transpose();
+      }
+    }
+  });
+
+  gradient_max_norm_ = camera_gradient_.size() > 0
+                           ? camera_gradient_.lpNorm<Eigen::Infinity>()
+                           : 0.0;
+  for (const Eigen::Vector3d& point_gradient : point_gradients_) {
+    gradient_max_norm_ = std::max(gradient_max_norm_,
+                                  point_gradient.lpNorm<Eigen::Infinity>());
+  }
+}
+
+void SchurBundleAdjuster::BuildReducedCameraSystem(const double mu) {
+  // Invert the damped point blocks.
+  ParallelFor(num_threads_, points_.size(), [&](const int i) {
+    if (!points_[i].is_variable) {
+      return;
+    }
+    Eigen::Matrix3d damped_point_hessian = point_hessians_[i];
+    damped_point_hessian.diagonal() +=
+        mu * point_hessians_[i].diagonal().cwiseMax(kMinDiagonal).cwiseMin(
+                 kMaxDiagonal);
+    inverse_point_hessians_[i] = damped_point_hessian.inverse();
+  });
+
+  // Each block row of S is assembled by one task, so no two tasks write to
+  // the same block.
+  const int num_blocks = block_offsets_.size() - 1;
+  ParallelFor(num_threads_, num_blocks, [&](const int row) {
+    if (row < num_extrinsics_blocks_) {
+      BuildReducedCameraSystemRow(row, mu, extrinsics_jacobians_);
+    } else {
+      BuildReducedCameraSystemRow(row, mu, intrinsics_jacobians_);
+    }
+  });
+}
+
+template <class RowJacobian>
+void SchurBundleAdjuster::BuildReducedCameraSystemRow(
+    const int row,
+    const double mu,
+    const AlignedVector<RowJacobian>& row_jacobians) {
+  static const int kRowSize = RowJacobian::ColsAtCompileTime;
+  typedef Eigen::Matrix<double, kRowSize, 1> RowVector;
+  typedef Eigen::Matrix<double, kRowSize, 3> RowPointMatrix;
+  typedef Eigen::Matrix<double, kRowSize, 2> RowResidualMatrix;
+
+  const int offset = block_offsets_[row];
+  for (int i = row_offsets_[row]; i < row_offsets_[row + 1]; i++) {
+    const int col = col_blocks_[i];
+    std::fill_n(values_.data() + value_offsets_[i],
+                kRowSize * (block_offsets_[col + 1] - block_offsets_[col]),
+                0.0);
+  }
+
+  // Adds left * J to the blocks of the observation in this row of S.
+  const auto add_to_blocks = [&](const int observation_index,
+                                 const RowResidualMatrix& left) {
+    const Observation& observation = observations_[observation_index];
+    const int extrinsics_block = ExtrinsicsBlock(observation);
+    if (extrinsics_block >= row) {
+      AddToBlock<kRowSize, kExtrinsicsSize>(
+          left * extrinsics_jacobians_[observation_index],
+          MutableBlock(row, extrinsics_block));
+    }
+    const int intrinsics_block = IntrinsicsBlock(observation);
+    if (intrinsics_block >= row) {
+      AddToBlock<kRowSize, kIntrinsicsSize>(
+          left * intrinsics_jacobians_[observation_index],
+          MutableBlock(row, intrinsics_block));
+    }
+  };
+
+  RowVector rhs = -camera_gradient_.segment<kRowSize>(offset);
+  for (int i = block_observation_offsets_[row];
+       i < block_observation_offsets_[row + 1];
+       i++) {
+    const int observation_index = block_observations_[i];
+    const RowResidualMatrix row_jacobian_transpose =
+        row_jacobians[observation_index].transpose();
+
+    // U = J_c^T * J_c.
+    add_to_blocks(observation_index, row_jacobian_transpose);
+
+    // -W * V^-1 * W^T and W * V^-1 * g_p for the point of the observation.
+    const int point_index = observations_[observation_index].point;
+    const PointBlock& point = points_[point_index];
+    if (!point.is_variable) {
+      continue;
+    }
+    const RowPointMatrix w_inverse_v = row_jacobian_transpose *
+                                       point_jacobians_[observation_index] *
+                                       inverse_point_hessians_[point_index];
+    rhs.noalias() += w_inverse_v * point_gradients_[point_index];
+    for (int j = point.first_observation;
+         j < point.first_observation + point.num_observations;
+         j++) {
+      add_to_blocks(j, -w_inverse_v * point_jacobians_[j].transpose());
+    }
+  }
+  reduced_rhs_.segment<kRowSize>(offset) = rhs;
+
+  // Levenberg-Marquardt damping of the diagonal. Parameters that are held
+  // constant have no Jacobian and get a unit diagonal so that their step is
+  // zero.
+  double* diagonal_block = MutableBlock(row, row);
+  for (int i = 0; i < kRowSize; i++) {
+    const double diagonal = camera_diagonal_[offset + i];
+    diagonal_block[i * kRowSize + i] +=
+        diagonal == 0.0
+            ? 1.0
+            : mu * std::min(std::max(diagonal, kMinDiagonal), kMaxDiagonal);
+  }
+}
+
+bool SchurBundleAdjuster::SolveReducedCameraSystem(
+    Eigen::VectorXd* camera_step) {
+  const int num_parameters = block_offsets_.back();
+  if (num_parameters == 0) {
+    camera_step->resize(0);
+    return true;
+  }
+
+  switch (GetReducedCameraSystemSolver(options_.linear_solver_type)) {
+    case ReducedCameraSystemSolver::CONJUGATE_GRADIENTS:
+      return SolveWithConjugateGradients(camera_step);
+    case ReducedCameraSystemSolver::DENSE_CHOLESKY: {
+      const int num_blocks = block_offsets_.size() - 1;
+      Eigen::MatrixXd reduced_camera_system =
+          Eigen::MatrixXd::Zero(num_parameters, num_parameters);
+      for (int row = 0; row < num_blocks; row++) {
+        const int row_size = block_offsets_[row + 1] - block_offsets_[row];
+        for (int i = row_offsets_[row]; i < row_offsets_[row + 1]; i++) {
+          const int col = col_blocks_[i];
+          const int col_size = block_offsets_[col + 1] - block_offsets_[col];
+          reduced_camera_system.block(
+              block_offsets_[row], block_offsets_[col], row_size, col_size) =
+              Eigen::Map<const Eigen::Matrix<double,
+                                             Eigen::Dynamic,
+                                             Eigen::Dynamic,
+                                             Eigen::RowMajor> >(
+                  values_.data() + value_offsets_[i], row_size, col_size);
+        }
+      }
+      const Eigen::LDLT<Eigen::MatrixXd, Eigen::Upper> ldlt(
+          reduced_camera_system);
+      if (ldlt.info() != Eigen::Success) {
+        return false;
+      }
+      *camera_step = ldlt.solve(reduced_rhs_);
+      return true;
+    }
+    default: {
+      CopyToSparseMatrix();
+      // The sparsity pattern does not change so the symbolic analysis is only
+      // done in the first iteration.
+      sparse_cholesky_.Compute(sparse_matrix_);
+      if (sparse_cholesky_.Info() != Eigen::Success) {
+        return false;
+      }
+      sparse_cholesky_.Solve(reduced_rhs_, camera_step);
+      return sparse_cholesky_.Info() == Eigen::Success;
+    }
+  }
+}
+
+bool SchurBundleAdjuster::SolveWithConjugateGradients(
+    Eigen::VectorXd* camera_step) {
+  // Block Jacobi preconditioner.
+  const int num_blocks = block_offsets_.size() - 1;
+  std::vector<Eigen::MatrixXd> preconditioner(num_blocks);
+  ParallelFor(num_threads_, num_blocks, [&](const int row) {
+    const int row_size = block_offsets_[row + 1] - block_offsets_[row];
+    const Eigen::Map<const Eigen::MatrixXd> diagonal_block(
+        MutableBlock(row, row), row_size, row_size);
+    preconditioner[row] = diagonal_block.ldlt().solve(
+        Eigen::MatrixXd::Identity(row_size, row_size));
+  });
+  const auto precondition = [&](const Eigen::VectorXd& x, Eigen::VectorXd* y) {
+    y->resize(x.size());
+    ParallelFor(num_threads_, num_blocks, [&](const int row) {
+      const int offset = block_offsets_[row];
+      const int row_size = block_offsets_[row + 1] - offset;
+      y->segment(offset, row_size).noalias() =
+          preconditioner[row] * x.segment(offset, row_size);
+    });
+  };
+
+  Eigen::VectorXd& x = *camera_step;
+  x.setZero(reduced_rhs_.size());
+  Eigen::VectorXd residual = reduced_rhs_;
+  Eigen::VectorXd preconditioned_residual, direction, product;
+  precondition(residual, &preconditioned_residual);
+  direction = preconditioned_residual;
+  double residual_dot = residual.dot(preconditioned_residual);
+  const double tolerance = kConjugateGradientsTolerance * reduced_rhs_.norm();
+  for (int i = 0; i < options_.max_linear_solver_iterations; i++) {
+    if (residual.norm() <= tolerance) {
+      break;
+    }
+    MultiplyReducedCameraSystem(direction, &product);
+    const double curvature = direction.dot(product);
+    if (!(curvature > 0.0)) {
+      break;
+    }
+    const double alpha = residual_dot / curvature;
+    x += alpha * direction;
+    residual -= alpha * product;
+
+    precondition(residual, &preconditioned_residual);
+    const double previous_residual_dot = residual_dot;
+    residual_dot = residual.dot(preconditioned_residual);
+    direction = preconditioned_residual +
+                (residual_dot / previous_residual_dot) * direction;
+  }
+  return x.allFinite();
+}
+
+void SchurBundleAdjuster::MultiplyReducedCameraSystem(
+    const Eigen::VectorXd& x, Eigen::VectorXd* y) const {
+  typedef Eigen::Map<const Eigen::Matrix<double,
+                                         Eigen::Dynamic,
+                                         Eigen::Dynamic,
+                                         Eigen::RowMajor> >
+      ConstBlock;
+  y->resize(x.size());
+  const int num_blocks = block_offsets_.size() - 1;
+  ParallelFor(num_threads_, num_blocks, [&](const int row) {
+    const int offset = block_offsets_[row];
+    const int row_size = block_offsets_[row + 1] - offset;
+    auto y_row = y->segment(offset, row_size);
+    y_row.setZero();
+    // The upper triangle of the row.
+    for (int i = row_offsets_[row]; i < row_offsets_[row + 1]; i++) {
+      const int col = col_blocks_[i];
+      const int col_size = block_offsets_[col + 1] - block_offsets_[col];
+      y_row.noalias() +=
+          ConstBlock(values_.data() + value_offsets_[i], row_size, col_size) *
+          x.segment(block_offsets_[col], col_size);
+    }
+    // The lower triangle of the row is the transpose of the upper triangle of
+    // the column.
+    for (int i = transpose_offsets_[row]; i < transpose_offsets_[row + 1];
+         i++) {
+      const int upper_row = transpose_rows_[i];
+      const int upper_row_size =
+          block_offsets_[upper_row + 1] - block_offsets_[upper_row];
+      y_row.noalias() +=
+          ConstBlock(values_.data() + value_offsets_[transpose_blocks_[i]],
+                     upper_row_size,
+                     row_size)
+              .transpose() *
+          x.segment(block_offsets_[upper_row], upper_row_size);
+    }
+  });
+}
+
+void SchurBundleAdjuster::BackSubstitute(const Eigen::VectorXd& camera_step) {
+  // delta_p = V^-1 * (-g_p - W^T * delta_c).
+  ParallelFor(num_threads_, points_.size(), [&](const int i) {
+    const PointBlock& point = points_[i];
+    if (!point.is_variable) {
+      point_steps_[i].setZero();
+      return;
+    }
+    Eigen::Vector3d rhs = -point_gradients_[i];
+    for (int j = point.first_observation;
+         j < point.first_observation + point.num_observations;
+         j++) {
+      Eigen::Vector2d camera_change = Eigen::Vector2d::Zero();
+      const int extrinsics_block = ExtrinsicsBlock(observations_[j]);
+      if (extrinsics_block != -1) {
+        camera_change.noalias() +=
+            extrinsics_jacobians_[j] *
+            camera_step.segment<kExtrinsicsSize>(
+                block_offsets_[extrinsics_block]);
+      }
+      const int intrinsics_block = IntrinsicsBlock(observations_[j]);
+      if (intrinsics_block != -1) {
+        camera_change.noalias() +=
+            intrinsics_jacobians_[j] *
+            camera_step.segment<kIntrinsicsSize>(
+                block_offsets_[intrinsics_block]);
+      }
+      rhs.noalias() -= point_jacobians_[j].transpose() * camera_change;
+    }
+    point_steps_[i] = inverse_point_hessians_[i] * rhs;
+  });
+}
+
+double SchurBundleAdjuster::ModelCostChange(
+    const Eigen::VectorXd& camera_step) const {
+  // The decrease of the linearized cost 1/2 |r + J * delta|^2.
+  std::mutex mutex;
+  double model_cost_change = 0.0;
+  ParallelForRange(
+      num_threads_, observations_.size(), [&](const int begin,
+                                              const int end) {
+        double partial_change = 0.0;
+        for (int i = begin; i < end; i++) {
+          const Observation& observation = observations_[i];
+          Eigen::Vector2d change =
+              point_jacobians_[i] * point_steps_[observation.point];
+          const int extrinsics_block = ExtrinsicsBlock(observation);
+          if (extrinsics_block != -1) {
+            change.noalias() += extrinsics_jacobians_[i] *
+                                camera_step.segment<kExtrinsicsSize>(
+                                    block_offsets_[extrinsics_block]);
+          }
+          const int intrinsics_block = IntrinsicsBlock(observation);
+          if (intrinsics_block != -1) {
+            change.noalias() += intrinsics_jacobians_[i] *
+                                camera_step.segment<kIntrinsicsSize>(
+                                    block_offsets_[intrinsics_block]);
+          }
+          partial_change -=
+              residuals_[i].dot(change) + 0.5 * change.squaredNorm();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        model_cost_change += partial_change;
+      });
+  return model_cost_change;
+}
+
+void SchurBundleAdjuster::ApplyStep(const Eigen::VectorXd& camera_step) {
+  saved_parameters_.clear();
+  for (int i = 0; i < cameras_.size(); i++) {
+    const CameraBlock& camera = cameras_[i];
+    if (camera.extrinsics_block == -1) {
+      continue;
+    }
+    double* extrinsics = camera.camera->mutable_extrinsics();
+    saved_parameters_.insert(
+        saved_parameters_.end(), extrinsics, extrinsics + kExtrinsicsSize);
+    const int offset = block_offsets_[camera.extrinsics_block];
+    Eigen::Map<Eigen::Vector3d>(extrinsics + Camera::ORIENTATION) =
+        RotationMatrixToAngleAxis(
+            AngleAxisToRotationMatrix(camera_step.segment<3>(offset)) *
+            rotations_[i]);
+    Eigen::Map<Eigen::Vector3d>(extrinsics + Camera::POSITION) +=
+        camera_step.segment<3>(offset + 3);
+  }
+
+  for (const IntrinsicsGroup& intrinsics : intrinsics_) {
+    if (intrinsics.block == -1) {
+      continue;
+    }
+    double* parameters = intrinsics.parameters;
+    saved_parameters_.insert(
+        saved_parameters_.end(), parameters, parameters + kIntrinsicsSize);
+    const int offset = block_offsets_[intrinsics.block];
+    for (int i = 0; i < kIntrinsicsSize; i++) {
+      if (!intrinsics.is_constant[i]) {
+        parameters[i] += camera_step[offset + i];
+      }
+    }
+    // The focal length is bounded from below as in the Ceres backend.
+    parameters[PinholeCameraModel::FOCAL_LENGTH] =
+        std::max(parameters[PinholeCameraModel::FOCAL_LENGTH], 1.0);
+  }
+
+  for (int i = 0; i < points_.size(); i++) {
+    const PointBlock& point = points_[i];
+    if (!point.is_variable) {
+      continue;
+    }
+    Eigen::Vector4d& point_coordinates = *point.point;
+    saved_parameters_.insert(saved_parameters_.end(),
+                             point_coordinates.data(),
+                             point_coordinates.data() + 4);
+    const Eigen::Vector4d updated_point =
+        point_coordinates + point_tangent_bases_[i] * point_steps_[i];
+    // Homogeneous points stay on the sphere of their norm.
+    point_coordinates =
+        point.use_homogeneous
+            ? (point_coordinates.norm() * updated_point.normalized()).eval()
+            : updated_point;
+  }
+}
+
+void SchurBundleAdjuster::UndoStep() {
+  const double* saved_parameters = saved_parameters_.data();
+  for (const CameraBlock& camera : cameras_) {
+    if (camera.extrinsics_block != -1) {
+      std::copy_n(saved_parameters,
+                  kExtrinsicsSize,
+                  camera.camera->mutable_extrinsics());
+      saved_parameters += kExtrinsicsSize;
+    }
+  }
+  for (const IntrinsicsGroup& intrinsics : intrinsics_) {
+    if (intrinsics.block != -1) {
+      std::copy_n(saved_parameters, kIntrinsicsSize, intrinsics.parameters);
+      saved_parameters += kIntrinsicsSize;
+    }
+  }
+  for (const PointBlock& point : points_) {
+    if (point.is_variable) {
+      std::copy_n(saved_parameters, 4, point.point->data());
+      saved_parameters += 4;
+    }
+  }
+  PrepareEvaluation();
+}
+
+double SchurBundleAdjuster::StepNorm(const Eigen::VectorXd& camera_step) const {
+  double squared_norm = camera_step.squaredNorm();
+  for (int i = 0; i < points_.size(); i++) {
+    if (points_[i].is_variable) {
+      squared_norm += (point_tangent_bases_[i] * point_steps_[i]).squaredNorm();
+    }
+  }
+  return std::sqrt(squared_norm);
+}
+
+double SchurBundleAdjuster::ParameterNorm() const {
+  double squared_norm = 0.0;
+  for (const CameraBlock& camera : cameras_) {
+    if (camera.extrinsics_block != -1) {
+      squared_norm += Eigen::Map<const Eigen::Matrix<double, 6, 1> >(
+                          camera.camera->extrinsics())
+                          .squaredNorm();
+    }
+  }
+  for (const IntrinsicsGroup& intrinsics : intrinsics_) {
+    if (intrinsics.block != -1) {
+      squared_norm += Eigen::Map<const Eigen::Matrix<double, 7, 1> >(
+                          intrinsics.parameters)
+                          .squaredNorm();
+    }
+  }
+  for (const PointBlock& point : points_) {
+    if (point.is_variable) {
+      squared_norm += point.point->squaredNorm();
+    }
+  }
+  return std::sqrt(squared_norm);
+}
+
+BundleAdjustmentSummary SchurBundleAdjuster::Optimize() {
+  CHECK(is_supported_) << "The problem has cameras that are not supported.";
+  BundleAdjustmentSummary summary;
+  SetUpProblem();
+  summary.num_residuals = 2 * observations_.size();
+  summary.setup_time_in_seconds = timer_.ElapsedTimeInSeconds();
+  timer_.Reset();
+
+  double cost = EvaluateCost();
+  if (cost < 0.0) {
+    LOG(ERROR) << "Bundle adjustment failed: a point lies on a camera center.";
+    return summary;
+  }
+  summary.initial_cost = cost;
+  Linearize();
+
+  // Levenberg-Marquardt with the trust region update of Ceres.
+  double radius = kInitialTrustRegionRadius;
+  double radius_decrease_factor = 2.0;
+  Eigen::VectorXd camera_step;
+  for (int iteration = 0; iteration < options_.max_num_iterations;
+       iteration++) {
+    if (gradient_max_norm_ <= options_.gradient_tolerance ||
+        timer_.ElapsedTimeInSeconds() > options_.max_solver_time_in_seconds) {
+      break;
+    }
+
+    BuildReducedCameraSystem(1.0 / radius);
+    double new_cost = -1.0;
+    double model_cost_change = 0.0;
+    bool is_step_applied = false;
+    if (SolveReducedCameraSystem(&camera_step)) {
+      BackSubstitute(camera_step);
+      if (StepNorm(camera_step) <=
+          options_.parameter_tolerance *
+              (ParameterNorm() + options_.parameter_tolerance)) {
+        break;
+      }
+      model_cost_change = ModelCostChange(camera_step);
+      ApplyStep(camera_step);
+      is_step_applied = true;
+      new_cost = EvaluateCost();
+    }
+
+    const double relative_decrease =
+        model_cost_change > 0.0 ? (cost - new_cost) / model_cost_change : 0.0;
+    LOG_IF(INFO, options_.verbose)
+        << "Iteration " << iteration << ": cost = " << cost
+        << ", new cost = " << new_cost << ", trust region radius = " << radius;
+    if (new_cost >= 0.0 && relative_decrease > kMinRelativeDecrease) {
+      const double cost_change = cost - new_cost;
+      cost = new_cost;
+      radius = std::min(
+          options_.max_trust_region_radius,
+          radius / std::max(1.0 / 3.0,
+                            1.0 - std::pow(2.0 * relative_decrease - 1.0, 3)));
+      radius_decrease_factor = 2.0;
+      if (cost_change <= options_.function_tolerance * (cost + cost_change)) {
+        break;
+      }
+      Linearize();
+    } else {
+      if (is_step_applied) {
+        UndoStep();
+      }
+      radius /= radius_decrease_factor;
+      radius_decrease_factor *= 2.0;
+      if (radius < kMinTrustRegionRadius) {
+        break;
+      }
+    }
+  }
+
+  summary.final_cost = cost;
+  summary.solve_time_in_seconds = timer_.ElapsedTimeInSeconds();
+  summary.success = true;
+  return summary;
+}
+
+bool SchurBundleAdjuster::ComputeCovariance() {
+  if (is_covariance_computed_) {
+    return is_covariance_valid_;
+  }
+  is_covariance_computed_ = true;
+  if (block_offsets_.empty()) {
+    SetUpProblem();
+  }
+
+  // The covariance is the inverse of the undamped Gauss-Newton Hessian at the
+  // current parameters.
+  if (EvaluateCost() < 0.0) {
+    LOG(ERROR) << "Covariance estimation failed: a point lies on a camera "
+                  "center.";
+    return false;
+  }
+  Linearize();
+  BuildReducedCameraSystem(0.0);
+  for (int i = 0; i < points_.size(); i++) {
+    if (points_[i].is_variable && !inverse_point_hessians_[i].allFinite()) {
+      LOG(ERROR) << "Covariance estimation failed: a track is not constrained "
+                    "by its observations.";
+      return false;
+    }
+  }
+
+  const int num_parameters = block_offsets_.back();
+  if (num_parameters == 0) {
+    is_covariance_valid_ = true;
+    return true;
+  }
+  if (sparse_value_indices_.size() != values_.size()) {
+    BuildSparseMatrixStructure();
+  }
+  CopyToSparseMatrix();
+  if (!inverse_reduced_camera_system_.Factorize(sparse_matrix_)) {
+    LOG(ERROR) << "Covariance estimation failed: the reduced camera system is "
+                  "rank deficient. Hold views constant to fix the gauge.";
+    return false;
+  }
+
+  if (options_.num_covariance_samples <= 0) {
+    inverse_reduced_camera_system_.ComputeInverse();
+  } else {
+    // Each sample has its own random number generator so that the samples do
+    // not depend on the number of threads.
+    covariance_samples_.resize(num_parameters,
+                               options_.num_covariance_samples);
+    ParallelFor(num_threads_,
+                options_.num_covariance_samples,
+                [&](const int i) {
+                  RandomNumberGenerator rng(kCovarianceSamplesSeed + i);
+                  Eigen::VectorXd standard_normal(num_parameters), sample;
+                  rng.RandGaussians(
+                      0.0, 1.0, num_parameters, standard_normal.data());
+                  inverse_reduced_camera_system_.Sample(standard_normal,
+                                                        &sample);
+                  covariance_samples_.col(i) = sample;
+                });
+  }
+  is_covariance_valid_ = true;
+  return true;
+}
+
+Eigen::MatrixXd SchurBundleAdjuster::InverseReducedCameraSystemBlock(
+    const int row, const int col) const {
+  const int row_offset = block_offsets_[row];
+  const int row_size = block_offsets_[row + 1] - row_offset;
+  const int col_offset = block_offsets_[col];
+  const int col_size = block_offsets_[col + 1] - col_offset;
+  if (covariance_samples_.size() > 0) {
+    return covariance_samples_.middleRows(row_offset, row_size) *
+           covariance_samples_.middleRows(col_offset, col_size).transpose() /
+           covariance_samples_.cols();
+  }
+
+  Eigen::MatrixXd block(row_size, col_size);
+  for (int r = 0; r < row_size; r++) {
+    for (int c = 0; c < col_size; c++) {
+      block(r, c) = inverse_reduced_camera_system_.Coeff(row_offset + r,
+                                                         col_offset + c);
+    }
+  }
+  return block;
+}
+
+Eigen::Matrix3d SchurBundleAdjuster::PointCovariance(
+    const int point_index) const {
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 3, 0, kIntrinsicsSize, 3>
+      BlockPointMatrix;
+  const PointBlock& point = points_[point_index];
+  const Eigen::Matrix3d& inverse_point_hessian =
+      inverse_point_hessians_[point_index];
+
+  // W_p^T for the blocks of S that the observations of the point contribute
+  // to. A block may be shared by several observations, e.g. the intrinsics.
+  std::vector<std::pair<int, BlockPointMatrix> > block_point_matrices;
+  const auto add_to_block = [&](const int block,
+                                const BlockPointMatrix& product) {
+    if (block == -1) {
+      return;
+    }
+    for (auto& block_point_matrix : block_point_matrices) {
+      if (block_point_matrix.first == block) {
+        block_point_matrix.second += product;
+        return;
+      }
+    }
+    block_point_matrices.emplace_back(block, product);
+  };
+  for (int i = point.first_observation;
+       i < point.first_observation + point.num_observations;
+       i++) {
+    add_to_block(ExtrinsicsBlock(observations_[i]),
+                 extrinsics_jacobians_[i].transpose() * point_jacobians_[i]);
+    add_to_block(IntrinsicsBlock(observations_[i]),
+                 intrinsics_jacobians_[i].transpose() * point_jacobians_[i]);
+  }
+  for (auto& block_point_matrix : block_point_matrices) {
+    block_point_matrix.second =
+        (block_point_matrix.second * inverse_point_hessian).eval();
+  }
+
+  // C_p = V_p^-1 + V_p^-1 * W_p^T * S^-1 * W_p * V_p^-1.
+  Eigen::Matrix3d covariance = inverse_point_hessian;
+  if (covariance_samples_.size() > 0) {
+    Eigen::Matrix<double, 3, Eigen::Dynamic> samples =
+        Eigen::Matrix<double, 3, Eigen::Dynamic>::Zero(
+            3, covariance_samples_.cols());
+    for (const auto& block_point_matrix : block_point_matrices) {
+      const int block = block_point_matrix.first;
+      samples.noalias() +=
+          block_point_matrix.second.transpose() *
+          covariance_samples_.middleRows(
+              block_offsets_[block],
+              block_offsets_[block + 1] - block_offsets_[block]);
+    }
+    covariance.noalias() +=
+        samples * samples.transpose() / covariance_samples_.cols();
+    return covariance;
+  }
+
+  for (const auto& row_block : block_point_matrices) {
+    for (const auto& col_block : block_point_matrices) {
+      covariance.noalias() +=
+          row_block.second.transpose() *
+          InverseReducedCameraSystemBlock(row_block.first, col_block.first) *
+          col_block.second;
+    }
+  }
+  return covariance;
+}
+
+bool SchurBundleAdjuster::GetCovarianceForTracks(
+    const std::vector<TrackId>& track_ids,
+    std::map<TrackId, Eigen::Matrix3d>* covariance_matrices) {
+  CHECK_NOTNULL(covariance_matrices);
+  if (!ComputeCovariance()) {
+    return false;
+  }
+  std::vector<int> point_indices(track_ids.size());
+  for (int i = 0; i < track_ids.size(); i++) {
+    const int* point_index = FindOrNull(point_indices_, track_ids[i]);
+    if (point_index == nullptr || !points_[*point_index].is_variable) {
+      LOG(ERROR) << "Track " << track_ids[i]
+                 << " is not optimized. No covariance estimation possible.";
+      return false;
+    }
+    point_indices[i] = *point_index;
+  }
+
+  std::vector<Eigen::Matrix3d> covariances(track_ids.size());
+  ParallelFor(num_threads_, track_ids.size(), [&](const int i) {
+    covariances[i] = PointCovariance(point_indices[i]);
+  });
+  for (int i = 0; i < track_ids.size(); i++) {
+    (*covariance_matrices)[track_ids[i]] = covariances[i];
+  }
+  return true;
+}
+
+bool SchurBundleAdjuster::GetCovarianceForViews(
+    const std::vector<ViewId>& view_ids,
+    std::map<ViewId, Matrix6d>* covariance_matrices) {
+  CHECK_NOTNULL(covariance_matrices);
+  if (!ComputeCovariance()) {
+    return false;
+  }
+  for (const ViewId view_id : view_ids) {
+    const int* camera_index = FindOrNull(camera_indices_, view_id);
+    if (camera_index == nullptr ||
+        cameras_[*camera_index].extrinsics_block == -1) {
+      LOG(ERROR) << "View " << view_id
+                 << " is not optimized. No covariance estimation possible.";
+      return false;
+    }
+  }
+
+  for (const ViewId view_id : view_ids) {
+    const CameraBlock& camera = cameras_[FindOrDie(camera_indices_, view_id)];
+    const Matrix6d covariance = InverseReducedCameraSystemBlock(
+        camera.extrinsics_block, camera.extrinsics_block);
+
+    // The step of the orientation is a rotation from the left. The covariance
+    // of the Ceres backend is that of the position and the angle-axis vector.
+    Matrix6d jacobian = Matrix6d::Zero();
+    if (!options_.constant_camera_position) {
+      jacobian.block<3, 3>(Camera::POSITION, 3).setIdentity();
+    }
+    if (!options_.constant_camera_orientation) {
+      jacobian.block<3, 3>(Camera::ORIENTATION, 0) = InverseLeftJacobian(
+          Eigen::Map<const Eigen::Vector3d>(camera.camera->extrinsics() +
+                                            Camera::ORIENTATION));
+    }
+    (*covariance_matrices)[view_id] =
+        jacobian * covariance * jacobian.transpose();
+  }
+  return true;
+}
+
+}  // namespace theia
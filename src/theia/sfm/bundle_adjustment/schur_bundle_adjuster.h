@@ -0,0 +1,356 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_SFM_BUNDLE_ADJUSTMENT_SCHUR_BUNDLE_ADJUSTER_H_
+#define THEIA_SFM_BUNDLE_ADJUSTMENT_SCHUR_BUNDLE_ADJUSTER_H_
+
+#include <ceres/ceres.h>
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "theia/math/matrix/sparse_cholesky_llt.h"
+#include "theia/math/matrix/sparse_inverse.h"
+#include "theia/sfm/bundle_adjustment/bundle_adjustment.h"
+#include "theia/sfm/types.h"
+#include "theia/util/timer.h"
+#include "theia/util/util.h"
+
+namespace theia {
+class Camera;
+class Reconstruction;
+
+// A native Levenberg-Marquardt bundle adjuster for reprojection error of
+// pinhole cameras (with radial distortion). It is the SCHUR backend of
+// BundleAdjuster and follows the same conventions: only the views and tracks
+// added with AddView and AddTrack are optimized, views that only observe
+// optimized tracks are held constant and intrinsics are shared by all views of
+// a camera intrinsics group.
+//
+// Unlike the Ceres backend, the problem is laid out in fixed-size blocks: 6
+// extrinsics parameters per view, 7 intrinsics parameters per intrinsics group
+// and 3 parameters per point. Each iteration evaluates the analytic Jacobians
+// of all observations in parallel, eliminates the points and assembles the
+// reduced camera system
+//
+//   S = U - W * V^-1 * W^T
+//
+// in parallel, one block row per thread-owned task, so no locking is needed.
+// S is solved with sparse Cholesky, preconditioned conjugate gradients or a
+// dense factorization depending on options.linear_solver_type, and the points
+// are recovered by back-substitution.
+//
+// Orientations are updated with a rotation that is applied from the left and
+// homogeneous points are updated on the sphere. Robust losses are applied with
+// the second order correction of Triggs et al. where the loss is convex, as
+// ceres::Corrector does. Both backends minimize the same cost, although the
+// iterates may differ.
+//
+// The adjuster also estimates the covariances of the optimized tracks and
+// views without forming the inverse of the full Hessian. S is inverted once on
+// its own sparsity pattern (see SparseInverse) and the 3x3 covariance of each
+// point is then recovered in parallel from the blocks of the cameras that
+// observe it:
+//
+//   C_p = V_p^-1 + V_p^-1 * W_p^T * S^-1 * W_p * V_p^-1.
+//
+// If options.num_covariance_samples is positive, S^-1 is instead estimated
+// from that many random samples, which avoids the fill-in of the sparse
+// inverse for very large problems.
+//
+// NOTE: AddView must be called before AddTrack if any views are optimized.
+class SchurBundleAdjuster {
+ public:
+  SchurBundleAdjuster(const BundleAdjustmentOptions& options,
+                      Reconstruction* reconstruction);
+  ~SchurBundleAdjuster();
+
+  // Returns true if the options only use features that this adjuster
+  // supports, i.e. no priors and no orthographic cameras.
+  static bool SupportsOptions(const BundleAdjustmentOptions& options);
+
+  // Add a view or track to be optimized. See BundleAdjuster.
+  void AddView(const ViewId view_id);
+  void AddTrack(const TrackId track_id, const bool use_homogeneous = true);
+
+  // Holds the extrinsics of an added view constant.
+  void SetCameraExtrinsicsConstant(const ViewId view_id);
+
+  // Returns false if a view of the problem has a camera model other than
+  // PINHOLE. The problem must then be solved with Ceres.
+  bool IsSupported() const { return is_supported_; }
+
+  // The views, tracks and constant views in the order they were added. These
+  // are used to set up the same problem with Ceres if it is not supported.
+  const std::vector<ViewId>& AddedViews() const { return added_views_; }
+  const std::vector<std::pair<TrackId, bool> >& AddedTracks() const {
+    return added_tracks_;
+  }
+  const std::vector<ViewId>& ConstantViews() const { return constant_views_; }
+
+  // Returns the approximate number of bytes of memory used by the problem. The
+  // problem is set up in Optimize, so this is small before. The storage of the
+  // sparse Cholesky factorization is not included.
+  size_t MemoryUsage() const;
+
+  // Optimizes the added views and tracks and writes them to the
+  // reconstruction.
+  BundleAdjustmentSummary Optimize();
+
+  // Returns the covariances of optimized tracks and views at the current
+  // parameters, e.g. after Optimize(). The covariances are expressed in the
+  // same tangent spaces as those of the Ceres backend, i.e. of the sphere for
+  // homogeneous points and of the position and angle-axis orientation for
+  // views. S is inverted on the first call and reused by later calls. Returns
+  // false if a track or view is not optimized or if the problem is rank
+  // deficient, e.g. because the gauge freedom is not fixed by constant views.
+  bool GetCovarianceForTracks(
+      const std::vector<TrackId>& track_ids,
+      std::map<TrackId, Eigen::Matrix3d>* covariance_matrices);
+  bool GetCovarianceForViews(const std::vector<ViewId>& view_ids,
+                             std::map<ViewId, Matrix6d>* covariance_matrices);
+
+ private:
+  typedef Eigen::Matrix<double, 2, 6> ExtrinsicsJacobian;
+  typedef Eigen::Matrix<double, 2, 7> IntrinsicsJacobian;
+  typedef Eigen::Matrix<double, 2, 3> PointJacobian;
+  typedef Eigen::Matrix<double, 4, 3> PointTangentBasis;
+  template <class T>
+  using AlignedVector = std::vector<T, Eigen::aligned_allocator<T> >;
+
+  // A view of the problem. The blocks are -1 if the parameters are constant.
+  struct CameraBlock {
+    Camera* camera;
+    int intrinsics;
+    int extrinsics_block;
+  };
+
+  // A camera intrinsics group of the problem.
+  struct IntrinsicsGroup {
+    double* parameters;
+    int block;
+    // Parameters that are held constant.
+    bool is_constant[7];
+  };
+
+  // A track of the problem. The observations of the point are
+  // observations_[first_observation, first_observation + num_observations).
+  struct PointBlock {
+    Eigen::Vector4d* point;
+    bool is_variable;
+    bool use_homogeneous;
+    int first_observation;
+    int num_observations;
+  };
+
+  struct Observation {
+    int camera;
+    int point;
+    Eigen::Vector2d feature;
+    Eigen::Vector2d sqrt_information;
+  };
+
+  // Builds the blocks, the observations and the sparsity structure of S.
+  void SetUpProblem();
+  void BuildReducedCameraSystemStructure();
+  void BuildSparseMatrixStructure();
+
+  // Returns the blocks of S that the observation's Jacobians contribute to,
+  // which are -1 for constant parameters.
+  int ExtrinsicsBlock(const Observation& observation) const;
+  int IntrinsicsBlock(const Observation& observation) const;
+
+  // Computes the per camera and per point quantities that the residuals and
+  // Jacobians need for the current parameters.
+  void PrepareEvaluation();
+
+  // Returns the cost of the current parameters or a negative number if an
+  // observation cannot be evaluated.
+  double EvaluateCost();
+
+  // Computes the weighted residual of an observation and, if the Jacobians
+  // are not null, its Jacobians. Returns false if the point is too close to
+  // the camera center.
+  bool EvaluateObservation(const int observation_index,
+                           Eigen::Vector2d* residual,
+                           ExtrinsicsJacobian* extrinsics_jacobian,
+                           IntrinsicsJacobian* intrinsics_jacobian,
+                           PointJacobian* point_jacobian) const;
+
+  // Computes the (robustified) residuals and Jacobians of all observations,
+  // the point blocks V and the gradient.
+  void Linearize();
+
+  // Assembles S and the reduced right hand side for the damping mu.
+  void BuildReducedCameraSystem(const double mu);
+  template <class RowJacobian>
+  void BuildReducedCameraSystemRow(
+      const int row,
+      const double mu,
+      const AlignedVector<RowJacobian>& row_jacobians);
+
+  // Solves the reduced camera system. Returns false if the solver failed.
+  bool SolveReducedCameraSystem(Eigen::VectorXd* camera_step);
+  bool SolveWithConjugateGradients(Eigen::VectorXd* camera_step);
+
+  // y = S * x with the symmetric S stored as its upper triangle.
+  void MultiplyReducedCameraSystem(const Eigen::VectorXd& x,
+                                   Eigen::VectorXd* y) const;
+
+  // Computes the point steps from the camera step.
+  void BackSubstitute(const Eigen::VectorXd& camera_step);
+
+  // Returns the decrease of the linearized cost for the step.
+  double ModelCostChange(const Eigen::VectorXd& camera_step) const;
+
+  // Applies the step to the parameters, after saving them so that the step
+  // can be undone.
+  void ApplyStep(const Eigen::VectorXd& camera_step);
+  void UndoStep();
+  double StepNorm(const Eigen::VectorXd& camera_step) const;
+  double ParameterNorm() const;
+
+  // Returns the block of S at (row, col) with row <= col.
+  double* MutableBlock(const int row, const int col);
+
+  // Copies the upper triangle of S into sparse_matrix_.
+  void CopyToSparseMatrix();
+
+  // Linearizes the problem without damping and inverts S. Returns false if
+  // the problem is rank deficient.
+  bool ComputeCovariance();
+
+  // Returns the entries of S^-1 for the parameter ranges of two blocks.
+  Eigen::MatrixXd InverseReducedCameraSystemBlock(const int row,
+                                                  const int col) const;
+
+  // Returns the covariance of a variable point in the tangent space of
+  // point_tangent_bases_.
+  Eigen::Matrix3d PointCovariance(const int point_index) const;
+
+  const BundleAdjustmentOptions options_;
+  // options_.num_threads capped by the thread budget.
+  const int num_threads_;
+  Reconstruction* reconstruction_;
+  Timer timer_;
+  std::unique_ptr<ceres::LossFunction> loss_function_;
+  bool is_supported_;
+
+  // The inputs of the problem.
+  std::vector<ViewId> added_views_;
+  std::vector<std::pair<TrackId, bool> > added_tracks_;
+  std::vector<ViewId> constant_views_;
+  std::unordered_set<ViewId> optimized_views_;
+  std::unordered_set<TrackId> optimized_tracks_;
+
+  // The problem.
+  std::vector<CameraBlock> cameras_;
+  std::vector<IntrinsicsGroup> intrinsics_;
+  std::vector<PointBlock> points_;
+  // Sorted by point.
+  std::vector<Observation> observations_;
+  std::unordered_map<ViewId, int> camera_indices_;
+  std::unordered_map<TrackId, int> point_indices_;
+
+  // The blocks of S are the variable extrinsics followed by the variable
+  // intrinsics. The size of block i is block_offsets_[i + 1] -
+  // block_offsets_[i].
+  int num_extrinsics_blocks_;
+  std::vector<int> block_offsets_;
+  // The observations that contribute to block row i of S are
+  // block_observations_[block_observation_offsets_[i]...].
+  std::vector<int> block_observation_offsets_;
+  std::vector<int> block_observations_;
+
+  // The upper triangle of S in block compressed row format. The row-major
+  // values of block (i, col_blocks_[j]) for row_offsets_[i] <= j <
+  // row_offsets_[i + 1] start at values_[value_offsets_[j]].
+  std::vector<int> row_offsets_;
+  std::vector<int> col_blocks_;
+  std::vector<int> value_offsets_;
+  std::vector<double> values_;
+  // The blocks (j, i) with j < i of column i as indices into col_blocks_, for
+  // products with the lower triangle.
+  std::vector<int> transpose_offsets_;
+  std::vector<int> transpose_blocks_;
+  std::vector<int> transpose_rows_;
+  Eigen::VectorXd reduced_rhs_;
+
+  // Scalar entries of S for sparse Cholesky: the entry of values_[i] is
+  // sparse_matrix_.valuePtr()[sparse_value_indices_[i]] or -1 if it is in the
+  // lower triangle of a diagonal block.
+  Eigen::SparseMatrix<double> sparse_matrix_;
+  std::vector<int> sparse_value_indices_;
+  SparseCholeskyLLt sparse_cholesky_;
+
+  // Evaluation state of the current parameters.
+  AlignedVector<Eigen::Matrix3d> rotations_;
+  AlignedVector<PointTangentBasis> point_tangent_bases_;
+
+  // Linearization of the current parameters.
+  AlignedVector<Eigen::Vector2d> residuals_;
+  AlignedVector<ExtrinsicsJacobian> extrinsics_jacobians_;
+  AlignedVector<IntrinsicsJacobian> intrinsics_jacobians_;
+  AlignedVector<PointJacobian> point_jacobians_;
+  AlignedVector<Eigen::Matrix3d> point_hessians_;
+  AlignedVector<Eigen::Vector3d> point_gradients_;
+  Eigen::VectorXd camera_gradient_;
+  // The diagonal of U, which scales the damping of the cameras.
+  Eigen::VectorXd camera_diagonal_;
+  double gradient_max_norm_;
+
+  // Damped inverse point blocks and the point step.
+  AlignedVector<Eigen::Matrix3d> inverse_point_hessians_;
+  AlignedVector<Eigen::Vector3d> point_steps_;
+
+  // The parameters before the last step.
+  std::vector<double> saved_parameters_;
+
+  // S^-1 for covariance estimation: either its entries on the pattern of S or
+  // random samples of the normal distribution with covariance S^-1, one per
+  // column of covariance_samples_.
+  bool is_covariance_computed_;
+  bool is_covariance_valid_;
+  SparseInverse inverse_reduced_camera_system_;
+  Eigen::MatrixXd covariance_samples_;
+
+  DISALLOW_COPY_AND_ASSIGN(SchurBundleAdjuster);
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SFM_BUNDLE_ADJUSTMENT_SCHUR_BUNDLE_ADJUSTER_H_
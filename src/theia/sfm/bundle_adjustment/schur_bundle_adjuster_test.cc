@@ -0,0 +1,439 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/LU>
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "theia/sfm/bundle_adjustment/bundle_adjuster.h"
+#include "theia/sfm/bundle_adjustment/bundle_adjustment.h"
+#include "theia/sfm/bundle_adjustment/schur_bundle_adjuster.h"
+#include "theia/sfm/camera/camera.h"
+#include "theia/sfm/camera/pinhole_camera_model.h"
+#include "theia/sfm/reconstruction.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+namespace {
+
+static const double kFocalLength = 500.0;
+static const double kRadialDistortion = -0.05;
+
+void SetRadialDistortion(const double radial_distortion, Camera* camera) {
+  camera->MutableCameraIntrinsics()
+      ->mutable_parameters()[PinholeCameraModel::RADIAL_DISTORTION_1] =
+      radial_distortion;
+}
+
+// Cameras on a circle around the points, all looking at the origin and
+// sharing one intrinsics group. Each point is observed by every camera that
+// sees it.
+void BuildReconstruction(const int num_views,
+                         const int num_points,
+                         RandomNumberGenerator* rng,
+                         Reconstruction* reconstruction) {
+  for (int i = 0; i < num_views; i++) {
+    const ViewId view_id =
+        reconstruction->AddView(std::to_string(i), 0, static_cast<double>(i));
+    View* view = reconstruction->MutableView(view_id);
+    Camera* camera = view->MutableCamera();
+    camera->SetImageSize(1000, 1000);
+    camera->SetFocalLength(kFocalLength);
+    camera->SetPrincipalPoint(500.0, 500.0);
+    SetRadialDistortion(kRadialDistortion, camera);
+
+    const double angle = M_PI * i / num_views;
+    const Eigen::Vector3d position(
+        10.0 * std::sin(angle), rng->RandDouble(-1.0, 1.0),
+        -10.0 * std::cos(angle));
+    const Eigen::Vector3d z_axis = -position.normalized();
+    const Eigen::Vector3d x_axis =
+        Eigen::Vector3d::UnitY().cross(z_axis).normalized();
+    Eigen::Matrix3d rotation;
+    rotation.row(0) = x_axis.transpose();
+    rotation.row(1) = z_axis.cross(x_axis).transpose();
+    rotation.row(2) = z_axis.transpose();
+    camera->SetPosition(position);
+    camera->SetOrientationFromRotationMatrix(rotation);
+    view->SetEstimated(true);
+  }
+
+  for (int i = 0; i < num_points; i++) {
+    const TrackId track_id = reconstruction->AddTrack();
+    Track* track = reconstruction->MutableTrack(track_id);
+    track->SetPoint(rng->RandVector3d(-2.0, 2.0).homogeneous());
+    track->SetEstimated(true);
+    for (const ViewId view_id : reconstruction->ViewIds()) {
+      Eigen::Vector2d pixel;
+      if (reconstruction->View(view_id)->Camera().ProjectPoint(
+              track->Point(), &pixel) > 0.0) {
+        reconstruction->AddObservation(view_id, track_id, Feature(pixel));
+      }
+    }
+  }
+}
+
+void PerturbReconstruction(const std::vector<ViewId>& view_ids,
+                           const double noise,
+                           RandomNumberGenerator* rng,
+                           Reconstruction* reconstruction) {
+  for (const ViewId view_id : view_ids) {
+    Camera* camera = reconstruction->MutableView(view_id)->MutableCamera();
+    camera->SetPosition(camera->GetPosition() + noise * rng->RandVector3d());
+    camera->SetOrientationFromAngleAxis(camera->GetOrientationAsAngleAxis() +
+                                        0.1 * noise * rng->RandVector3d());
+  }
+  for (const TrackId track_id : reconstruction->TrackIds()) {
+    Track* track = reconstruction->MutableTrack(track_id);
+    track->SetPoint(track->Point() +
+                    noise * rng->RandVector3d().homogeneous() -
+                    Eigen::Vector4d::UnitW() * noise);
+  }
+}
+
+// Optimizes a perturbed reconstruction with the first two cameras held
+// constant, which fixes the gauge, and checks that the true cameras and
+// points are recovered.
+void TestRecoverReconstruction(const BundleAdjustmentOptions& options,
+                               const double initial_focal_length) {
+  static const int kNumViews = 8;
+  static const int kNumPoints = 200;
+  static const double kNoise = 0.05;
+  static const double kTolerance = 1e-6;
+
+  RandomNumberGenerator rng(61);
+  Reconstruction reconstruction;
+  BuildReconstruction(kNumViews, kNumPoints, &rng, &reconstruction);
+  std::vector<Eigen::Vector3d> expected_positions, expected_points;
+  std::vector<Eigen::Matrix3d> expected_rotations;
+  for (const ViewId view_id : reconstruction.ViewIds()) {
+    const Camera& camera = reconstruction.View(view_id)->Camera();
+    expected_positions.emplace_back(camera.GetPosition());
+    expected_rotations.emplace_back(camera.GetOrientationAsRotationMatrix());
+  }
+  for (const TrackId track_id : reconstruction.TrackIds()) {
+    expected_points.emplace_back(
+        reconstruction.Track(track_id)->Point().hnormalized());
+  }
+
+  std::vector<ViewId> variable_view_ids, constant_view_ids;
+  for (const ViewId view_id : reconstruction.ViewIds()) {
+    if (view_id < 2) {
+      constant_view_ids.emplace_back(view_id);
+    } else {
+      variable_view_ids.emplace_back(view_id);
+    }
+  }
+  PerturbReconstruction(variable_view_ids, kNoise, &rng, &reconstruction);
+  Camera* camera = reconstruction.MutableView(0)->MutableCamera();
+  camera->SetFocalLength(initial_focal_length);
+  if (initial_focal_length != kFocalLength) {
+    SetRadialDistortion(0.0, camera);
+  }
+
+  const BundleAdjustmentSummary summary = BundleAdjustPartialViewsConstant(
+      options, variable_view_ids, constant_view_ids, &reconstruction);
+  EXPECT_TRUE(summary.success);
+  EXPECT_GT(summary.initial_cost, summary.final_cost);
+  EXPECT_LT(summary.final_cost, 1e-12 * summary.num_residuals);
+
+  const std::vector<ViewId> view_ids = reconstruction.ViewIds();
+  for (int i = 0; i < view_ids.size(); i++) {
+    const Camera& camera = reconstruction.View(view_ids[i])->Camera();
+    EXPECT_LT((camera.GetPosition() - expected_positions[i]).norm(),
+              kTolerance);
+    EXPECT_LT(
+        (camera.GetOrientationAsRotationMatrix() - expected_rotations[i])
+            .norm(),
+        kTolerance);
+    EXPECT_NEAR(camera.FocalLength(), kFocalLength, kTolerance);
+  }
+  const std::vector<TrackId> track_ids = reconstruction.TrackIds();
+  for (int i = 0; i < track_ids.size(); i++) {
+    EXPECT_LT((reconstruction.Track(track_ids[i])->Point().hnormalized() -
+               expected_points[i])
+                  .norm(),
+              kTolerance);
+  }
+}
+
+BundleAdjustmentOptions SchurOptions(
+    const ceres::LinearSolverType linear_solver_type) {
+  BundleAdjustmentOptions options;
+  options.backend = BundleAdjustmentBackend::SCHUR;
+  options.linear_solver_type = linear_solver_type;
+  options.function_tolerance = 1e-16;
+  options.parameter_tolerance = 1e-14;
+  options.num_threads = 4;
+  return options;
+}
+
+// Returns the covariance of the optimized parameters from the numeric
+// Jacobian of all reprojection errors. The parameters are the positions and
+// angle-axis orientations of the variable views, the shared focal length and
+// the Euclidean coordinates of the points, in this order.
+Eigen::MatrixXd NumericCovariance(const std::vector<ViewId>& variable_view_ids,
+                                  Reconstruction* reconstruction) {
+  static const double kStep = 1e-6;
+  std::vector<double*> parameters;
+  for (const ViewId view_id : variable_view_ids) {
+    double* extrinsics =
+        reconstruction->MutableView(view_id)->MutableCamera()
+            ->mutable_extrinsics();
+    for (int i = 0; i < Camera::kExtrinsicsSize; i++) {
+      parameters.emplace_back(extrinsics + i);
+    }
+  }
+  parameters.emplace_back(
+      reconstruction->MutableView(0)->MutableCamera()->mutable_intrinsics() +
+      PinholeCameraModel::FOCAL_LENGTH);
+  for (const TrackId track_id : reconstruction->TrackIds()) {
+    double* point = reconstruction->MutableTrack(track_id)->MutablePoint()
+                        ->data();
+    for (int i = 0; i < 3; i++) {
+      parameters.emplace_back(point + i);
+    }
+  }
+
+  const auto residuals = [&]() {
+    std::vector<double> residuals;
+    for (const TrackId track_id : reconstruction->TrackIds()) {
+      const Track* track = reconstruction->Track(track_id);
+      for (const ViewId view_id : track->ViewIds()) {
+        const View* view = reconstruction->View(view_id);
+        Eigen::Vector2d pixel;
+        view->Camera().ProjectPoint(track->Point(), &pixel);
+        pixel -= view->GetFeature(track_id)->point_;
+        residuals.emplace_back(pixel.x());
+        residuals.emplace_back(pixel.y());
+      }
+    }
+    return Eigen::Map<const Eigen::VectorXd>(residuals.data(),
+                                             residuals.size())
+        .eval();
+  };
+
+  Eigen::MatrixXd jacobian(residuals().size(), parameters.size());
+  for (int i = 0; i < parameters.size(); i++) {
+    const double value = *parameters[i];
+    *parameters[i] = value + kStep;
+    const Eigen::VectorXd forward_residuals = residuals();
+    *parameters[i] = value - kStep;
+    jacobian.col(i) = (forward_residuals - residuals()) / (2.0 * kStep);
+    *parameters[i] = value;
+  }
+  return (jacobian.transpose() * jacobian).inverse();
+}
+
+// Sets up the problem with all views and tracks of the reconstruction, of
+// which the first two views are held constant.
+void AddReconstruction(const bool use_homogeneous,
+                       const Reconstruction& reconstruction,
+                       SchurBundleAdjuster* bundle_adjuster) {
+  for (const ViewId view_id : reconstruction.ViewIds()) {
+    bundle_adjuster->AddView(view_id);
+  }
+  bundle_adjuster->SetCameraExtrinsicsConstant(0);
+  bundle_adjuster->SetCameraExtrinsicsConstant(1);
+  for (const TrackId track_id : reconstruction.TrackIds()) {
+    bundle_adjuster->AddTrack(track_id, use_homogeneous);
+  }
+}
+
+}  // namespace
+
+TEST(SchurBundleAdjuster, SparseCholesky) {
+  TestRecoverReconstruction(SchurOptions(ceres::SPARSE_SCHUR), kFocalLength);
+}
+
+TEST(SchurBundleAdjuster, ConjugateGradients) {
+  BundleAdjustmentOptions options = SchurOptions(ceres::ITERATIVE_SCHUR);
+  TestRecoverReconstruction(options, kFocalLength);
+}
+
+TEST(SchurBundleAdjuster, DenseCholesky) {
+  TestRecoverReconstruction(SchurOptions(ceres::DENSE_SCHUR), kFocalLength);
+}
+
+TEST(SchurBundleAdjuster, EuclideanPoints) {
+  BundleAdjustmentOptions options = SchurOptions(ceres::SPARSE_SCHUR);
+  options.use_homogeneous_point_parametrization = false;
+  TestRecoverReconstruction(options, kFocalLength);
+}
+
+TEST(SchurBundleAdjuster, SharedIntrinsics) {
+  BundleAdjustmentOptions options = SchurOptions(ceres::SPARSE_SCHUR);
+  options.intrinsics_to_optimize = OptimizeIntrinsicsType::FOCAL_LENGTH |
+                                   OptimizeIntrinsicsType::RADIAL_DISTORTION;
+  TestRecoverReconstruction(options, 1.05 * kFocalLength);
+}
+
+TEST(SchurBundleAdjuster, ConstantPoints) {
+  // Only the views are optimized and the points are held constant.
+  RandomNumberGenerator rng(62);
+  Reconstruction reconstruction;
+  BuildReconstruction(4, 100, &rng, &reconstruction);
+  Camera* camera = reconstruction.MutableView(2)->MutableCamera();
+  const Eigen::Vector3d expected_position = camera->GetPosition();
+  const Eigen::Matrix3d expected_rotation =
+      camera->GetOrientationAsRotationMatrix();
+  camera->SetPosition(camera->GetPosition() + 0.05 * rng.RandVector3d());
+  camera->SetOrientationFromAngleAxis(camera->GetOrientationAsAngleAxis() +
+                                      0.005 * rng.RandVector3d());
+
+  const BundleAdjustmentSummary summary =
+      BundleAdjustView(SchurOptions(ceres::SPARSE_SCHUR), 2, &reconstruction);
+  EXPECT_TRUE(summary.success);
+  EXPECT_LT((camera->GetPosition() - expected_position).norm(), 1e-6);
+  EXPECT_LT(
+      (camera->GetOrientationAsRotationMatrix() - expected_rotation).norm(),
+      1e-6);
+}
+
+TEST(SchurBundleAdjuster, Covariance) {
+  static const double kTolerance = 1e-4;
+  RandomNumberGenerator rng(64);
+  Reconstruction reconstruction;
+  BuildReconstruction(6, 50, &rng, &reconstruction);
+  const std::vector<ViewId> variable_view_ids = {2, 3, 4, 5};
+  const Eigen::MatrixXd expected_covariance =
+      NumericCovariance(variable_view_ids, &reconstruction);
+
+  BundleAdjustmentOptions options = SchurOptions(ceres::SPARSE_SCHUR);
+  options.intrinsics_to_optimize = OptimizeIntrinsicsType::FOCAL_LENGTH;
+  SchurBundleAdjuster bundle_adjuster(options, &reconstruction);
+  AddReconstruction(false, reconstruction, &bundle_adjuster);
+
+  std::map<ViewId, Matrix6d> view_covariances;
+  ASSERT_TRUE(bundle_adjuster.GetCovarianceForViews(variable_view_ids,
+                                                    &view_covariances));
+  for (int i = 0; i < variable_view_ids.size(); i++) {
+    const Matrix6d expected_view_covariance =
+        expected_covariance.block<6, 6>(6 * i, 6 * i);
+    EXPECT_LT((view_covariances[variable_view_ids[i]] -
+               expected_view_covariance)
+                  .norm(),
+              kTolerance * expected_view_covariance.norm());
+  }
+
+  const std::vector<TrackId> track_ids = reconstruction.TrackIds();
+  std::map<TrackId, Eigen::Matrix3d> track_covariances;
+  ASSERT_TRUE(
+      bundle_adjuster.GetCovarianceForTracks(track_ids, &track_covariances));
+  ASSERT_EQ(track_covariances.size(), track_ids.size());
+  const int first_point_parameter = 6 * variable_view_ids.size() + 1;
+  for (int i = 0; i < track_ids.size(); i++) {
+    const Eigen::Matrix3d expected_track_covariance =
+        expected_covariance.block<3, 3>(first_point_parameter + 3 * i,
+                                        first_point_parameter + 3 * i);
+    EXPECT_LT((track_covariances[track_ids[i]] - expected_track_covariance)
+                  .norm(),
+              kTolerance * expected_track_covariance.norm());
+  }
+
+  // Views that are held constant have no covariance.
+  EXPECT_FALSE(bundle_adjuster.GetCovarianceForViews({0}, &view_covariances));
+}
+
+TEST(SchurBundleAdjuster, SampledCovariance) {
+  RandomNumberGenerator rng(65);
+  Reconstruction reconstruction;
+  BuildReconstruction(6, 50, &rng, &reconstruction);
+  const std::vector<TrackId> track_ids = reconstruction.TrackIds();
+
+  BundleAdjustmentOptions options = SchurOptions(ceres::SPARSE_SCHUR);
+  SchurBundleAdjuster exact_bundle_adjuster(options, &reconstruction);
+  AddReconstruction(true, reconstruction, &exact_bundle_adjuster);
+  std::map<TrackId, Eigen::Matrix3d> expected_covariances;
+  ASSERT_TRUE(exact_bundle_adjuster.GetCovarianceForTracks(
+      track_ids, &expected_covariances));
+
+  // The relative error of the sampled variances is about sqrt(2 / 5000).
+  options.num_covariance_samples = 5000;
+  SchurBundleAdjuster sampled_bundle_adjuster(options, &reconstruction);
+  AddReconstruction(true, reconstruction, &sampled_bundle_adjuster);
+  std::map<TrackId, Eigen::Matrix3d> covariances;
+  ASSERT_TRUE(
+      sampled_bundle_adjuster.GetCovarianceForTracks(track_ids, &covariances));
+  for (const TrackId track_id : track_ids) {
+    const Eigen::Matrix3d& expected_covariance =
+        expected_covariances[track_id];
+    for (int i = 0; i < 3; i++) {
+      EXPECT_NEAR(covariances[track_id](i, i),
+                  expected_covariance(i, i),
+                  0.1 * expected_covariance(i, i));
+    }
+  }
+}
+
+TEST(SchurBundleAdjuster, CovarianceWithoutFixedGauge) {
+  RandomNumberGenerator rng(66);
+  Reconstruction reconstruction;
+  BuildReconstruction(4, 50, &rng, &reconstruction);
+  SchurBundleAdjuster bundle_adjuster(SchurOptions(ceres::SPARSE_SCHUR),
+                                      &reconstruction);
+  for (const ViewId view_id : reconstruction.ViewIds()) {
+    bundle_adjuster.AddView(view_id);
+  }
+  for (const TrackId track_id : reconstruction.TrackIds()) {
+    bundle_adjuster.AddTrack(track_id);
+  }
+  std::map<ViewId, Matrix6d> covariances;
+  EXPECT_FALSE(bundle_adjuster.GetCovarianceForViews({0}, &covariances));
+}
+
+TEST(SchurBundleAdjuster, UnsupportedCameraModel) {
+  RandomNumberGenerator rng(63);
+  Reconstruction reconstruction;
+  BuildReconstruction(2, 10, &rng, &reconstruction);
+  SchurBundleAdjuster bundle_adjuster(SchurOptions(ceres::SPARSE_SCHUR),
+                                      &reconstruction);
+  bundle_adjuster.AddView(0);
+  EXPECT_TRUE(bundle_adjuster.IsSupported());
+
+  reconstruction.MutableView(1)->MutableCamera()->SetCameraIntrinsicsModelType(
+      CameraIntrinsicsModelType::FISHEYE);
+  bundle_adjuster.AddView(1);
+  EXPECT_FALSE(bundle_adjuster.IsSupported());
+
+  BundleAdjustmentOptions options = SchurOptions(ceres::SPARSE_SCHUR);
+  options.use_position_priors = true;
+  EXPECT_FALSE(SchurBundleAdjuster::SupportsOptions(options));
+}
+
+}  // namespace theia
@@ -35,12 +35,16 @@
 #include "theia/sfm/colorize_reconstruction.h"
 
 #include <Eigen/Core>
+#include <glog/logging.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
-#include <mutex>  // NOLINT
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
-//#include "theia/image/image.h"
 #include "theia/sfm/reconstruction.h"
 #include "theia/sfm/track.h"
 #include "theia/sfm/types.h"
@@ -52,81 +56,209 @@
 namespace theia {
 namespace {
 
+// The sum of the colors of the observations of each track that a worker thread
+// has seen, indexed by the dense track index. Each worker owns one so that no
+// locking is needed while the images are processed.
+struct ColorAccumulator {
+  std::vector<Eigen::Vector3f> color_sums;
+  std::vector<int> num_observations;
+};
+
+// A pixel to sample for the track with the given dense index.
+struct PixelSample {
+  int track_index;
+  int x;
+  int y;
+};
+
 void ExtractColorsFromImage(
     const std::string& image_file,
     const View& view,
-    std::unordered_map<TrackId, Eigen::Vector3f>* colors,
-    std::mutex* mutex_lock) {
-  // LOG(INFO) << "Extracting color for features in image: " << image_file;
-  // const FloatImage image(image_file);
-
-  // const auto& track_ids = view.TrackIds();
-  // if (image.Channels() == 3) {
-  //   for (const TrackId track_id : track_ids) {
-  //     const Feature feature = *view.GetFeature(track_id);
-  //     const int x = static_cast<int>(feature.x());
-  //     const int y = static_cast<int>(feature.y());
-  //     std::lock_guard<std::mutex> lock(*mutex_lock);
-  //     (*colors)[track_id] += 255.0 * image.GetXY(x, y);
-  //   }
-  // } else if (image.Channels() == 1) {
-  //   for (const TrackId track_id : track_ids) {
-  //     const Feature feature = *view.GetFeature(track_id);
-  //     const int x = static_cast<int>(feature.x());
-  //     const int y = static_cast<int>(feature.y());
-  //     std::lock_guard<std::mutex> lock(*mutex_lock);
-  //     (*colors)[track_id] += 255.0 * image.GetXY(x, y);
-  //   }
-  // } else {
-  //   LOG(FATAL) << "The image file at: " << image_file
-  //              << " is not an RGB or a grayscale image so the color cannot be
-  //              "
-  //                 "extracted.";
-  // }
+    const std::unordered_map<TrackId, int>& track_indices,
+    const ColorizeReconstructionOptions& options,
+    DecodedImage* image,
+    ColorAccumulator* accumulator) {
+  // Gather the pixels to sample before the image is decoded.
+  std::vector<PixelSample> samples;
+  samples.reserve(view.NumFeatures());
+  for (const TrackId track_id : view.TrackIds()) {
+    const int* track_index = FindOrNull(track_indices, track_id);
+    if (track_index == nullptr) {
+      continue;
+    }
+    const Feature& feature = *view.GetFeature(track_id);
+    samples.push_back({*track_index,
+                       static_cast<int>(feature.x()),
+                       static_cast<int>(feature.y())});
+  }
+  if (samples.empty()) {
+    return;
+  }
+
+  VLOG(2) << "Extracting color for features in image: " << image_file;
+  if (!options.image_reader(image_file, image)) {
+    LOG(WARNING) << "Could not decode the image file at: " << image_file;
+    return;
+  }
+  if (image->channels != 3 && image->channels != 1) {
+    LOG(FATAL) << "The image file at: " << image_file
+               << " is not an RGB or a grayscale image so the color cannot "
+                  "be extracted.";
+  }
+  CHECK_EQ(image->pixels.size(),
+           static_cast<size_t>(image->width) * image->height * image->channels)
+      << "The decoded image " << image_file << " has the wrong size.";
+
+  for (const PixelSample& sample : samples) {
+    if (sample.x < 0 || sample.x >= image->width || sample.y < 0 ||
+        sample.y >= image->height) {
+      continue;
+    }
+    const uint8_t* pixel =
+        image->pixels.data() +
+        (static_cast<size_t>(sample.y) * image->width + sample.x) *
+            image->channels;
+    Eigen::Vector3f& color_sum = accumulator->color_sums[sample.track_index];
+    if (image->channels == 3) {
+      color_sum += Eigen::Vector3f(pixel[0], pixel[1], pixel[2]);
+    } else {
+      color_sum += Eigen::Vector3f::Constant(pixel[0]);
+    }
+    ++accumulator->num_observations[sample.track_index];
+  }
+}
+
+// Processes images until none are left. Images are handed out one at a time so
+// that each worker holds at most one decoded image and the load is balanced
+// across images of different sizes. The worker reuses one image buffer.
+void ExtractColorsFromImages(
+    const std::vector<std::string>* image_files,
+    const std::vector<const View*>* views,
+    const std::unordered_map<TrackId, int>* track_indices,
+    const ColorizeReconstructionOptions* options,
+    std::atomic<int>* next_image,
+    ColorAccumulator* accumulator) {
+  accumulator->color_sums.resize(track_indices->size(),
+                                 Eigen::Vector3f::Zero());
+  accumulator->num_observations.resize(track_indices->size(), 0);
+
+  DecodedImage image;
+  const int num_images = views->size();
+  for (int i = (*next_image)++; i < num_images; i = (*next_image)++) {
+    ExtractColorsFromImage((*image_files)[i],
+                           *(*views)[i],
+                           *track_indices,
+                           *options,
+                           &image,
+                           accumulator);
+  }
 }
 
 }  // namespace
 
 void ColorizeReconstruction(const std::string& image_directory,
-                            const int num_threads,
+                            const ColorizeReconstructionOptions& options,
                             Reconstruction* reconstruction) {
   CHECK(DirectoryExists(image_directory))
       << "The image directory " << image_directory << " does not exist.";
-  CHECK_GT(num_threads, 0);
+  CHECK_GT(options.num_threads, 0);
+  CHECK_GT(options.max_num_images_in_memory, 0);
   CHECK_NOTNULL(reconstruction);
+  if (!options.image_reader) {
+    LOG(WARNING) << "No image reader is set, so the reconstruction cannot be "
+                    "colorized.";
+    return;
+  }
 
-  // Initialize the colors to be (0, 0, 0).
-  const auto& track_ids = reconstruction->TrackIds();
-  std::unordered_map<TrackId, Eigen::Vector3f> colors;
+  // Assign a dense index to each track that will be colorized.
+  const std::vector<TrackId> track_ids = options.track_ids.empty()
+                                             ? reconstruction->TrackIds()
+                                             : options.track_ids;
+  std::unordered_map<TrackId, int> track_indices;
+  track_indices.reserve(track_ids.size());
   for (const TrackId track_id : track_ids) {
-    colors[track_id].setZero();
+    CHECK(reconstruction->Track(track_id) != nullptr)
+        << "Track " << track_id << " does not exist.";
+    track_indices.emplace(track_id, track_indices.size());
   }
 
-  // For each image, find the color of each feature and add the value to the
-  // colors map.
-  std::unique_ptr<ThreadPool> pool(new ThreadPool(num_threads));
-  std::mutex mutex_lock;
-  const auto& view_ids = reconstruction->ViewIds();
+  // Only the images that observe one of the tracks need to be decoded.
+  std::vector<ViewId> view_ids;
+  if (options.track_ids.empty()) {
+    view_ids = reconstruction->ViewIds();
+  } else {
+    std::unordered_set<ViewId> observing_view_ids;
+    for (const auto& track_index : track_indices) {
+      const Track* track = reconstruction->Track(track_index.first);
+      observing_view_ids.insert(track->ViewIds().begin(),
+                                track->ViewIds().end());
+    }
+    view_ids.assign(observing_view_ids.begin(), observing_view_ids.end());
+    std::sort(view_ids.begin(), view_ids.end());
+  }
+
+  std::vector<const View*> views;
+  std::vector<std::string> image_files;
+  views.reserve(view_ids.size());
+  image_files.reserve(view_ids.size());
   for (const ViewId view_id : view_ids) {
     const View* view = reconstruction->View(view_id);
     const std::string image_filepath = image_directory + view->Name();
     CHECK(FileExists(image_filepath))
         << "The image file: " << image_filepath << " does not exist!";
-    pool->Add(
-        ExtractColorsFromImage, image_filepath, *view, &colors, &mutex_lock);
+    views.emplace_back(view);
+    image_files.emplace_back(image_filepath);
   }
-  // Wait for all threads to finish before proceeding.
-  pool.reset(nullptr);
 
-  // The colors map now contains a sum of all colors, so to get the mean we must
-  // divide by the number of observations in each track.
-  for (const TrackId track_id : track_ids) {
-    Eigen::Vector3f color = FindOrDie(colors, track_id);
+  // For each image, find the color of each feature and add the value to the
+  // accumulator of the worker that processed the image.
+  const int num_workers = std::max(
+      1,
+      std::min({options.num_threads,
+                options.max_num_images_in_memory,
+                static_cast<int>(views.size())}));
+  std::vector<ColorAccumulator> accumulators(num_workers);
+  std::atomic<int> next_image(0);
+  ParallelFor(num_workers, num_workers, [&](const int i) {
+    ExtractColorsFromImages(&image_files,
+                            &views,
+                            &track_indices,
+                            &options,
+                            &next_image,
+                            &accumulators[i]);
+  });
 
-    Track* track = reconstruction->MutableTrack(track_id);
-    color /= static_cast<float>(track->NumViews());
+  // Reduce the accumulators and set the color of each track to the mean color
+  // of its sampled observations. Tracks without any sampled observations keep
+  // their color.
+  for (const auto& track_index : track_indices) {
+    Eigen::Vector3f color_sum = Eigen::Vector3f::Zero();
+    int num_observations = 0;
+    for (const ColorAccumulator& accumulator : accumulators) {
+      if (accumulator.num_observations.empty()) {
+        continue;
+      }
+      color_sum += accumulator.color_sums[track_index.second];
+      num_observations += accumulator.num_observations[track_index.second];
+    }
+    if (num_observations == 0) {
+      continue;
+    }
+
+    Track* track = reconstruction->MutableTrack(track_index.first);
+    const Eigen::Vector3f color =
+        color_sum / static_cast<float>(num_observations);
     *track->MutableColor() = color.cast<uint8_t>();
   }
 }
 
+void ColorizeReconstruction(const std::string& image_directory,
+                            const int num_threads,
+                            Reconstruction* reconstruction) {
+  ColorizeReconstructionOptions options;
+  options.num_threads = num_threads;
+  options.max_num_images_in_memory = num_threads;
+  ColorizeReconstruction(image_directory, options, reconstruction);
+}
+
 }  // namespace theia
@@ -35,18 +35,60 @@
 #ifndef THEIA_SFM_COLORIZE_RECONSTRUCTION_H_
 #define THEIA_SFM_COLORIZE_RECONSTRUCTION_H_
 
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
+
+#include "theia/sfm/types.h"
 
 namespace theia {
 
 class Reconstruction;
 
+// An 8-bit image with 1 (grayscale) or 3 (RGB) channels. The pixels are stored
+// row by row with interleaved channels.
+struct DecodedImage {
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  std::vector<uint8_t> pixels;
+};
+
+struct ColorizeReconstructionOptions {
+  // Number of threads used to extract the colors. Each thread accumulates the
+  // colors of its images into its own buffer.
+  int num_threads = 1;
+
+  // The maximum number of images that are decoded at the same time. Each
+  // decoded image is held by one worker thread, so this limits the number of
+  // workers when it is smaller than num_threads.
+  int max_num_images_in_memory = 8;
+
+  // If not empty, only these tracks are colorized and only the images that
+  // observe them are decoded. The colors of all other tracks are unchanged.
+  std::vector<TrackId> track_ids;
+
+  // Decodes the image file into the given image and returns true on success.
+  // Theia is built without an image library, so the decoder must be provided
+  // by the caller, e.g. a wrapper around OpenImageIO or OpenCV. It is called
+  // from several threads at once. If it is not set, no colors are changed.
+  std::function<bool(const std::string& image_file, DecodedImage* image)>
+      image_reader;
+};
+
 // Points of a reconstruction are colored according to their image pixels. Each
 // 3D point's color is determined by the mean of the colors of the pixel
 // observations that see the point. All images must be contained in the image
 // directory. This task is easily parallelizable and multithreading may be used.
 //
 // NOTE: Currently, we simply take the nearest pixel value.
+void ColorizeReconstruction(const std::string& image_directory,
+                            const ColorizeReconstructionOptions& options,
+                            Reconstruction* reconstruction);
+
+// Same as above, colorizing all tracks with the given number of threads. No
+// image reader is set, so the colors are left unchanged.
 void ColorizeReconstruction(const std::string& image_directory,
                             const int num_threads,
                             Reconstruction* reconstruction);
@@ -0,0 +1,148 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "theia/sfm/colorize_reconstruction.h"
+#include "theia/sfm/feature.h"
+#include "theia/sfm/reconstruction.h"
+#include "theia/sfm/track.h"
+#include "theia/util/filesystem.h"
+
+namespace theia {
+
+namespace {
+
+static const int kImageWidth = 20;
+static const int kImageHeight = 10;
+
+// The color of pixel (x, y) in image i is (10 * x, 10 * y, 50 * i). The image
+// index is the digit before the extension of the file name.
+bool ReadSyntheticImage(const std::string& image_file, DecodedImage* image) {
+  const int image_index = image_file[image_file.size() - 5] - '0';
+  image->width = kImageWidth;
+  image->height = kImageHeight;
+  image->channels = 3;
+  image->pixels.resize(kImageWidth * kImageHeight * 3);
+  for (int y = 0; y < kImageHeight; y++) {
+    for (int x = 0; x < kImageWidth; x++) {
+      uint8_t* pixel = &image->pixels[(y * kImageWidth + x) * 3];
+      pixel[0] = 10 * x;
+      pixel[1] = 10 * y;
+      pixel[2] = 50 * image_index;
+    }
+  }
+  return true;
+}
+
+class ColorizeReconstructionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(CreateTemporaryDirectory("theia_colorize_", &directory_));
+    directory_ += "/";
+    for (int i = 0; i < 3; i++) {
+      const std::string name = "image" + std::to_string(i) + ".png";
+      // The images are only decoded by the reader above, but must exist.
+      std::ofstream(directory_ + name) << "";
+      view_ids_.emplace_back(reconstruction_.AddView(name, i));
+    }
+
+    // Track 0 is seen at (1, 2) in images 0 and 1, track 1 at (4, 6) in images
+    // 1 and 2 and track 2 at (3, 3) in image 0 and outside of image 2.
+    AddTrack(0, Feature(1.0, 2.0), 1, Feature(1.0, 2.0));
+    AddTrack(1, Feature(4.0, 6.0), 2, Feature(4.0, 6.0));
+    AddTrack(0, Feature(3.0, 3.0), 2, Feature(50.0, 3.0));
+    for (const TrackId track_id : track_ids_) {
+      *reconstruction_.MutableTrack(track_id)->MutableColor() =
+          Eigen::Matrix<uint8_t, 3, 1>(1, 2, 3);
+    }
+  }
+
+  void TearDown() override { RemoveDirectory(directory_); }
+
+  void AddTrack(const int image1,
+                const Feature& feature1,
+                const int image2,
+                const Feature& feature2) {
+    track_ids_.emplace_back(
+        reconstruction_.AddTrack({{view_ids_[image1], feature1},
+                                  {view_ids_[image2], feature2}}));
+  }
+
+  Eigen::Vector3i Color(const int i) const {
+    return reconstruction_.Track(track_ids_[i])->Color().cast<int>();
+  }
+
+  std::string directory_;
+  Reconstruction reconstruction_;
+  std::vector<ViewId> view_ids_;
+  std::vector<TrackId> track_ids_;
+};
+
+}  // namespace
+
+TEST_F(ColorizeReconstructionTest, MeanOfObservedPixels) {
+  ColorizeReconstructionOptions options;
+  options.num_threads = 2;
+  options.image_reader = ReadSyntheticImage;
+  ColorizeReconstruction(directory_, options, &reconstruction_);
+
+  EXPECT_EQ(Color(0), Eigen::Vector3i(10, 20, 25));
+  EXPECT_EQ(Color(1), Eigen::Vector3i(40, 60, 75));
+  // The observation outside of image 2 is not sampled.
+  EXPECT_EQ(Color(2), Eigen::Vector3i(30, 30, 0));
+}
+
+TEST_F(ColorizeReconstructionTest, OnlySelectedTracks) {
+  ColorizeReconstructionOptions options;
+  options.track_ids = {track_ids_[1]};
+  options.image_reader = ReadSyntheticImage;
+  ColorizeReconstruction(directory_, options, &reconstruction_);
+
+  EXPECT_EQ(Color(0), Eigen::Vector3i(1, 2, 3));
+  EXPECT_EQ(Color(1), Eigen::Vector3i(40, 60, 75));
+  EXPECT_EQ(Color(2), Eigen::Vector3i(1, 2, 3));
+}
+
+TEST_F(ColorizeReconstructionTest, NoImageReader) {
+  ColorizeReconstruction(directory_, 2, &reconstruction_);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(Color(i), Eigen::Vector3i(1, 2, 3));
+  }
+}
+
+}  // namespace theia
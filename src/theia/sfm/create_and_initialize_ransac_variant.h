@@ -39,6 +39,8 @@
 
 #include "theia/solvers/exhaustive_ransac.h"
 #include "theia/solvers/lmed.h"
+#include "theia/solvers/magsac.h"
+#include "theia/solvers/progressive_napsac.h"
 #include "theia/solvers/prosac.h"
 #include "theia/solvers/ransac.h"
 #include "theia/solvers/evsac.h"
@@ -47,13 +49,17 @@
 namespace theia {
 
 // NOTE: Prosac requires correspondences to be sorted by the descriptor
-// distances with the best match first. See theia/solvers for more information
-// on the various types.
+// distances with the best match first. NAPSAC draws samples from spatial
+// neighborhoods of the data and MAGSAC additionally scores models with the
+// MAGSAC++ quality. See theia/solvers for more information on the various
+// types.
 enum class RansacType {
   RANSAC = 0,
   PROSAC = 1,
   LMED = 2,
-  EXHAUSTIVE = 3
+  EXHAUSTIVE = 3,
+  NAPSAC = 4,
+  MAGSAC = 5
 };
 
 // Factory method to create a ransac variant based on the specified options. The
@@ -78,6 +84,13 @@ CreateAndInitializeRansacVariant(const RansacType& ransac_type,
       ransac_variant.reset(
           new ExhaustiveRansac<Estimator>(ransac_options, estimator));
       break;
+    case RansacType::NAPSAC:
+      ransac_variant.reset(
+          new ProgressiveNapsac<Estimator>(ransac_options, estimator));
+      break;
+    case RansacType::MAGSAC:
+      ransac_variant.reset(new Magsac<Estimator>(ransac_options, estimator));
+      break;
 //    case RansacType::EVSAC:
 //      ransac_variant.reset(new Evsac<Estimator>(ransac_options, estimator));
 //      break;
@@ -162,26 +162,21 @@ TrackEstimator::Summary TrackEstimator::EstimateTracks(
     return summary_;
   }
 
-  // Estimate the tracks in parallel. Instead of 1 threadpool worker per track,
-  // we let each worker estimate a fixed number of tracks at a time (e.g. 20
-  // tracks). Since estimating the tracks is so fast, this strategy is better
-  // helps speed up multithreaded estimation by reducing the overhead of
-  // starting/stopping threads.
-  const int num_threads = std::min(
-      options_.num_threads, static_cast<int>(tracks_to_estimate_.size()));
-  const int interval_step =
-      std::min(options_.multithreaded_step_size,
-               static_cast<int>(tracks_to_estimate_.size()) / num_threads);
-
-  std::unique_ptr<ThreadPool> pool(new ThreadPool(num_threads));
-  for (int i = 0; i < tracks_to_estimate_.size(); i += interval_step) {
-    const int end_interval = std::min(
-        static_cast<int>(tracks_to_estimate_.size()), i + interval_step);
-    pool->Add(&TrackEstimator::EstimateTrackSet, this, i, end_interval);
-  }
-
-  // Wait for all tracks to be estimated.
-  pool.reset(nullptr);
+  // Estimate the tracks in parallel. Instead of 1 task per track, we let each
+  // task estimate a fixed number of tracks at a time (e.g. 20 tracks). Since
+  // estimating the tracks is so fast, this strategy helps speed up
+  // multithreaded estimation by reducing the scheduling overhead.
+  const int num_tracks = tracks_to_estimate_.size();
+  const int num_threads = std::min(options_.num_threads, num_tracks);
+  const int interval_step = std::max(
+      std::min(options_.multithreaded_step_size, num_tracks / num_threads), 1);
+  const int num_intervals = (num_tracks + interval_step - 1) / interval_step;
+  ParallelFor(num_threads, num_intervals, [&](const int i) {
+    const int start_interval = i * interval_step;
+    const int end_interval =
+        std::min(num_tracks, start_interval + interval_step);
+    EstimateTrackSet(start_interval, end_interval);
+  });
 
   LOG(INFO) << summary_.estimated_tracks.size() << " tracks were estimated of "
             << summary_.num_triangulation_attempts << " possible tracks. "
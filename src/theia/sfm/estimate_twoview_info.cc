@@ -38,6 +38,8 @@
 #include <Eigen/Geometry>
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 
 #include "theia/matching/feature_correspondence.h"
@@ -53,6 +55,8 @@
 #include "theia/sfm/types.h"
 #include "theia/sfm/visibility_pyramid.h"
 #include "theia/solvers/sample_consensus_estimator.h"
+#include "theia/util/random.h"
+#include "theia/util/threadpool.h"
 
 namespace theia {
 
@@ -167,12 +171,16 @@ bool EstimateTwoViewInfoCalibrated(
   ransac_options.use_mle = options.use_mle;
 
   RelativePose relative_pose;
+  Matrix3d homography;
+  std::vector<int> homography_inliers;
   RansacSummary summary;
-  if (!EstimateRelativePose(ransac_options,
-                            options.ransac_type,
-                            normalized_correspondences,
-                            &relative_pose,
-                            &summary)) {
+  if (!EstimateRelativePoseAndHomography(ransac_options,
+                                         options.ransac_type,
+                                         normalized_correspondences,
+                                         &relative_pose,
+                                         &homography,
+                                         &homography_inliers,
+                                         &summary)) {
     return false;
   }
   AngleAxisd rotation(relative_pose.rotation);
@@ -183,6 +191,7 @@ bool EstimateTwoViewInfoCalibrated(
   twoview_info->focal_length_1 = intrinsics1.focal_length.value[0];
   twoview_info->focal_length_2 = intrinsics2.focal_length.value[0];
   twoview_info->num_verified_matches = summary.inliers.size();
+  twoview_info->num_homography_inliers = homography_inliers.size();
   twoview_info->visibility_score = ComputeVisibilityScoreOfInliers(
       intrinsics1, intrinsics2, correspondences, *inlier_indices);
 
@@ -227,13 +236,17 @@ bool EstimateTwoViewInfoUncalibrated(
       max_sampson_error_pixels1 * max_sampson_error_pixels2;
 
   UncalibratedRelativePose relative_pose;
+  Matrix3d homography;
+  std::vector<int> homography_inliers;
   RansacSummary summary;
-  if (!EstimateUncalibratedRelativePose(ransac_options,
-                                        options.ransac_type,
-                                        centered_correspondences,
-                                        min_max_focal_lengths,
-                                        &relative_pose,
-                                        &summary)) {
+  if (!EstimateUncalibratedRelativePoseAndHomography(ransac_options,
+                                                     options.ransac_type,
+                                                     centered_correspondences,
+                                                     min_max_focal_lengths,
+                                                     &relative_pose,
+                                                     &homography,
+                                                     &homography_inliers,
+                                                     &summary)) {
     return false;
   }
 
@@ -247,6 +260,7 @@ bool EstimateTwoViewInfoUncalibrated(
 
   // Get the number of verified features.
   twoview_info->num_verified_matches = summary.inliers.size();
+  twoview_info->num_homography_inliers = homography_inliers.size();
   twoview_info->visibility_score = ComputeVisibilityScoreOfInliers(
       intrinsics1, intrinsics2, correspondences, *inlier_indices);
   *inlier_indices = summary.inliers;
@@ -309,4 +323,55 @@ bool EstimateTwoViewInfo(
                                          inlier_indices);
 }
 
+void EstimateTwoViewInfos(
+    const EstimateTwoViewInfoOptions& options,
+    const int num_threads,
+    const std::vector<CameraIntrinsicsPrior>& intrinsics1,
+    const std::vector<CameraIntrinsicsPrior>& intrinsics2,
+    const std::vector<std::vector<FeatureCorrespondence>>& correspondences,
+    std::vector<bool>* successes,
+    std::vector<TwoViewInfo>* twoview_infos,
+    std::vector<std::vector<int>>* inlier_indices) {
+  CHECK_NOTNULL(successes);
+  CHECK_NOTNULL(twoview_infos);
+  CHECK_NOTNULL(inlier_indices);
+  CHECK_GE(num_threads, 1);
+  const int num_view_pairs = correspondences.size();
+  CHECK_EQ(intrinsics1.size(), num_view_pairs);
+  CHECK_EQ(intrinsics2.size(), num_view_pairs);
+
+  // std::vector<bool> may not be written concurrently, so the results are
+  // gathered as chars first.
+  std::vector<char> estimated(num_view_pairs, false);
+  twoview_infos->clear();
+  twoview_infos->resize(num_view_pairs);
+  inlier_indices->clear();
+  inlier_indices->resize(num_view_pairs);
+
+  // Random number generators are not thread-safe, so each view pair samples
+  // from a stream split off the supplied generator.
+  std::vector<std::shared_ptr<RandomNumberGenerator>> rngs(num_view_pairs);
+  if (options.rng.get() != nullptr) {
+    for (int i = 0; i < num_view_pairs; i++) {
+      rngs[i] = std::make_shared<RandomNumberGenerator>(options.rng->Split());
+    }
+  }
+
+  // The cost of a view pair depends on its number of correspondences and
+  // inlier ratio. Threads take the next few pairs as soon as they are done,
+  // which balances the load.
+  ParallelFor(num_threads, num_view_pairs, [&](const int i) {
+    EstimateTwoViewInfoOptions pair_options = options;
+    pair_options.rng = rngs[i];
+    estimated[i] = EstimateTwoViewInfo(pair_options,
+                                       intrinsics1[i],
+                                       intrinsics2[i],
+                                       correspondences[i],
+                                       &(*twoview_infos)[i],
+                                       &(*inlier_indices)[i]);
+  });
+
+  successes->assign(estimated.begin(), estimated.end());
+}
+
 }  // namespace theia
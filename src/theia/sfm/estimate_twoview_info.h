@@ -97,6 +97,21 @@ bool EstimateTwoViewInfo(
     TwoViewInfo* twoview_info,
     std::vector<int>* inlier_indices);
 
+// Estimates the two view infos of many view pairs with a thread pool. The i-th
+// view pair is estimated from correspondences[i], intrinsics1[i] and
+// intrinsics2[i] in the same way as EstimateTwoViewInfo and successes[i]
+// holds its return value. All output vectors are resized to the number of
+// view pairs.
+void EstimateTwoViewInfos(
+    const EstimateTwoViewInfoOptions& options,
+    const int num_threads,
+    const std::vector<CameraIntrinsicsPrior>& intrinsics1,
+    const std::vector<CameraIntrinsicsPrior>& intrinsics2,
+    const std::vector<std::vector<FeatureCorrespondence>>& correspondences,
+    std::vector<bool>* successes,
+    std::vector<TwoViewInfo>* twoview_infos,
+    std::vector<std::vector<int>>* inlier_indices);
+
 }  // namespace theia
 
 #endif  // THEIA_SFM_ESTIMATE_TWOVIEW_INFO_H_
@@ -0,0 +1,199 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "theia/matching/feature_correspondence.h"
+#include "theia/sfm/camera_intrinsics_prior.h"
+#include "theia/sfm/estimate_twoview_info.h"
+#include "theia/sfm/twoview_info.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+namespace {
+
+RandomNumberGenerator rng(59);
+
+static const double kFocalLength = 800.0;
+static const int kImageWidth = 1000;
+static const int kImageHeight = 800;
+
+CameraIntrinsicsPrior CalibratedPrior() {
+  CameraIntrinsicsPrior prior;
+  prior.image_width = kImageWidth;
+  prior.image_height = kImageHeight;
+  prior.focal_length.is_set = true;
+  prior.focal_length.value[0] = kFocalLength;
+  prior.principal_point.is_set = true;
+  prior.principal_point.value[0] = kImageWidth / 2.0;
+  prior.principal_point.value[1] = kImageHeight / 2.0;
+  return prior;
+}
+
+Eigen::Vector2d Project(const Eigen::Matrix3d& rotation,
+                        const Eigen::Vector3d& position,
+                        const Eigen::Vector3d& point) {
+  const Eigen::Vector3d point_in_camera = rotation * (point - position);
+  return kFocalLength * point_in_camera.hnormalized() +
+         Eigen::Vector2d(kImageWidth / 2.0, kImageHeight / 2.0);
+}
+
+// Creates noise-free correspondences between a camera at the origin and a
+// camera with the given relative pose.
+std::vector<FeatureCorrespondence> CreateCorrespondences(
+    const int num_correspondences,
+    const Eigen::Vector3d& rotation_2,
+    const Eigen::Vector3d& position_2) {
+  const Eigen::Matrix3d rotation =
+      Eigen::AngleAxisd(rotation_2.norm(), rotation_2.normalized())
+          .toRotationMatrix();
+  std::vector<FeatureCorrespondence> correspondences;
+  for (int i = 0; i < num_correspondences; i++) {
+    const Eigen::Vector3d point(
+        rng.RandDouble(-2.0, 2.0), rng.RandDouble(-2.0, 2.0),
+        rng.RandDouble(4.0, 8.0));
+    correspondences.emplace_back(
+        Feature(Project(Eigen::Matrix3d::Identity(),
+                        Eigen::Vector3d::Zero(),
+                        point)),
+        Feature(Project(rotation, position_2, point)));
+  }
+  return correspondences;
+}
+
+}  // namespace
+
+TEST(EstimateTwoViewInfos, MatchesGroundTruth) {
+  static const int kNumViewPairs = 6;
+  static const int kNumCorrespondences = 100;
+  static const double kTolerance = 1e-4;
+
+  EstimateTwoViewInfoOptions options;
+  options.rng = std::make_shared<RandomNumberGenerator>(37);
+  options.max_sampson_error_pixels = 1.0;
+
+  std::vector<Eigen::Vector3d> rotations, positions;
+  std::vector<std::vector<FeatureCorrespondence>> correspondences;
+  for (int i = 0; i < kNumViewPairs; i++) {
+    rotations.emplace_back(rng.RandVector3d(-0.1, 0.1));
+    positions.emplace_back(
+        (Eigen::Vector3d(1.0, 0.0, 0.0) + rng.RandVector3d(-0.2, 0.2))
+            .normalized());
+    correspondences.emplace_back(CreateCorrespondences(
+        kNumCorrespondences, rotations.back(), positions.back()));
+  }
+
+  const std::vector<CameraIntrinsicsPrior> priors(correspondences.size(),
+                                                  CalibratedPrior());
+  std::vector<bool> successes;
+  std::vector<TwoViewInfo> twoview_infos;
+  std::vector<std::vector<int>> inlier_indices;
+  EstimateTwoViewInfos(options,
+                       4,
+                       priors,
+                       priors,
+                       correspondences,
+                       &successes,
+                       &twoview_infos,
+                       &inlier_indices);
+
+  ASSERT_EQ(successes.size(), kNumViewPairs);
+  ASSERT_EQ(twoview_infos.size(), kNumViewPairs);
+  ASSERT_EQ(inlier_indices.size(), kNumViewPairs);
+  for (int i = 0; i < kNumViewPairs; i++) {
+    EXPECT_TRUE(successes[i]);
+    EXPECT_EQ(inlier_indices[i].size(), kNumCorrespondences);
+    EXPECT_LT((twoview_infos[i].rotation_2 - rotations[i]).norm(),
+              kTolerance);
+    EXPECT_LT((twoview_infos[i].position_2 - positions[i]).norm(),
+              kTolerance);
+  }
+}
+
+
+// Each view pair samples from its own stream split off options.rng, so the
+// result does not depend on which worker estimates which pair.
+TEST(EstimateTwoViewInfos, ReproducibleWithAnyNumberOfThreads) {
+  static const int kNumViewPairs = 8;
+  static const int kNumInliers = 60;
+  static const int kNumOutliers = 40;
+
+  std::vector<std::vector<FeatureCorrespondence>> correspondences;
+  for (int i = 0; i < kNumViewPairs; i++) {
+    const Eigen::Vector3d position =
+        (Eigen::Vector3d(1.0, 0.0, 0.0) + rng.RandVector3d(-0.2, 0.2))
+            .normalized();
+    correspondences.emplace_back(CreateCorrespondences(
+        kNumInliers, rng.RandVector3d(-0.1, 0.1), position));
+    for (int j = 0; j < kNumOutliers; j++) {
+      correspondences.back().emplace_back(
+          Feature(rng.RandDouble(0.0, kImageWidth),
+                  rng.RandDouble(0.0, kImageHeight)),
+          Feature(rng.RandDouble(0.0, kImageWidth),
+                  rng.RandDouble(0.0, kImageHeight)));
+    }
+  }
+  const std::vector<CameraIntrinsicsPrior> priors(correspondences.size(),
+                                                  CalibratedPrior());
+
+  std::vector<std::vector<int>> expected_inlier_indices;
+  for (const int num_threads : {1, 4}) {
+    EstimateTwoViewInfoOptions options;
+    options.rng = std::make_shared<RandomNumberGenerator>(37);
+    options.max_sampson_error_pixels = 1.0;
+
+    std::vector<bool> successes;
+    std::vector<TwoViewInfo> twoview_infos;
+    std::vector<std::vector<int>> inlier_indices;
+    EstimateTwoViewInfos(options,
+                         num_threads,
+                         priors,
+                         priors,
+                         correspondences,
+                         &successes,
+                         &twoview_infos,
+                         &inlier_indices);
+    if (expected_inlier_indices.empty()) {
+      expected_inlier_indices = inlier_indices;
+    } else {
+      EXPECT_EQ(inlier_indices, expected_inlier_indices);
+    }
+  }
+}
+
+}  // namespace theia
@@ -106,6 +106,13 @@ class AbsolutePoseWithKnownOrientationEstimator
       return true;
   }
 
+  // Correspondences are neighbors if their features are close in the image.
+  bool SpatialCoordinates(const FeatureCorrespondence2D3D& correspondence,
+                          Eigen::VectorXd* coordinates) const override {
+    *coordinates = correspondence.feature;
+    return true;
+  }
+
   // The error for a correspondences given an absolute position. This is the
   // squared reprojection error.
   double Error(const FeatureCorrespondence2D3D& correspondence,
@@ -117,6 +124,9 @@ class AbsolutePoseWithKnownOrientationEstimator
     return (reprojected_feature - correspondence.feature).squaredNorm();
   }
 
+  // Squared reprojection errors.
+  int ResidualDegreesOfFreedom() const { return 2; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(AbsolutePoseWithKnownOrientationEstimator);
 };
@@ -145,6 +145,13 @@ class CalibratedAbsolutePoseEstimator
   }
 
 
+  // Correspondences are neighbors if their features are close in the image.
+  bool SpatialCoordinates(const FeatureCorrespondence2D3D& correspondence,
+                          Eigen::VectorXd* coordinates) const override {
+    *coordinates = correspondence.feature;
+    return true;
+  }
+
   // The error for a correspondences given an absolute pose. This is the squared
   // reprojection error.
   double Error(const FeatureCorrespondence2D3D& correspondence,
@@ -158,6 +165,9 @@ class CalibratedAbsolutePoseEstimator
     return (reprojected_feature - correspondence.feature).squaredNorm();
   }
 
+  // Squared reprojection errors.
+  int ResidualDegreesOfFreedom() const { return 2; }
+
  private:
   PnPType pnp_type_;
   theia::BundleAdjustmentOptions ba_opts_;
@@ -72,7 +72,8 @@ void ExecuteRandomTest(const RansacParameters& options,
                        const double inlier_ratio,
                        const double noise,
                        const double tolerance,
-                       const PnPType pnp_type) {
+                       const PnPType pnp_type,
+                       const RansacType ransac_type = RansacType::RANSAC) {
   // Create feature correspondences (inliers and outliers) and add noise if
   // appropriate.
   std::vector<FeatureCorrespondence2D3D> correspondences;
@@ -104,7 +105,7 @@ void ExecuteRandomTest(const RansacParameters& options,
   CalibratedAbsolutePose pose;
   RansacSummary ransac_summary;
   EXPECT_TRUE(EstimateCalibratedAbsolutePose(
-      options, RansacType::RANSAC, pnp_type, correspondences, &pose, &ransac_summary));
+      options, ransac_type, pnp_type, correspondences, &pose, &ransac_summary));
 
   // Expect that the inlier ratio is close to the ground truth.
   EXPECT_GT(static_cast<double>(ransac_summary.inliers.size()), 3);
@@ -464,4 +465,36 @@ TEST(EstimateCalibratedAbsolutePose, OutliersWithNoiseSQPNP_LO) {
   }
 }
 
+TEST(EstimateCalibratedAbsolutePose, OutliersWithNoiseKNEIP_MAGSAC) {
+  // MAGSAC++ scores the squared reprojection errors as residuals with two
+  // degrees of freedom and the error threshold bounds the inlier residuals.
+  RansacParameters options;
+  options.rng = std::make_shared<RandomNumberGenerator>(rng);
+  options.error_thresh = kErrorThreshold;
+  options.failure_probability = 0.001;
+  options.min_iterations = kMinIterations;
+  const double kInlierRatio = 0.7;
+  const double kNoise = 1.0;
+  const double kPoseTolerance = 1e-2;
+  const PnPType type = PnPType::KNEIP;
+
+  const std::vector<Matrix3d> rotations = {Matrix3d::Identity(),
+                                           RandomRotation(10.0, &rng)};
+  const std::vector<Vector3d> positions = {Vector3d(1, 0, 0),
+                                           Vector3d(0, 1, 0)};
+
+  for (size_t i = 0; i < rotations.size(); i++) {
+    for (size_t j = 0; j < positions.size(); j++) {
+      ExecuteRandomTest(options,
+                        rotations[i],
+                        positions[j],
+                        kInlierRatio,
+                        kNoise,
+                        kPoseTolerance,
+                        type,
+                        RansacType::MAGSAC);
+    }
+  }
+}
+
 }  // namespace theia
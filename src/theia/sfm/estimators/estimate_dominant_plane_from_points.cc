@@ -80,11 +80,21 @@ class DominantPlaneEstimator : public Estimator<Vector3d, Plane> {
     return true;
   }
 
+  bool SpatialCoordinates(const Vector3d& point,
+                          Eigen::VectorXd* coordinates) const override {
+    *coordinates = point;
+    return true;
+  }
+
   // The error for a point given a plane model is the point-to-plane distance.
   double Error(const Vector3d& point, const Plane& plane) const {
     return std::abs(plane.unit_normal.dot(point - plane.point));
   }
 
+  // Unsquared distances of the points to the plane.
+  int ResidualDegreesOfFreedom() const { return 1; }
+  bool ResidualsAreSquared() const { return false; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(DominantPlaneEstimator);
 };
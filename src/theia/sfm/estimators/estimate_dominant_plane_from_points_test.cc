@@ -66,7 +66,8 @@ void GeneratePoints(std::vector<Vector3d>* points) {
 
 void ExecuteRandomTest(const RansacParameters& options,
                        const double inlier_ratio,
-                       const double noise) {
+                       const double noise,
+                       const RansacType ransac_type = RansacType::RANSAC) {
   // Create 3D points (inliers and outliers) and add noise if appropriate.
   std::vector<Vector3d> points3d;
   GeneratePoints(&points3d);
@@ -95,7 +96,7 @@ void ExecuteRandomTest(const RansacParameters& options,
   Plane plane;
   RansacSummary ransac_summary;
   EXPECT_TRUE(EstimateDominantPlaneFromPoints(
-      options, RansacType::RANSAC, points3d, &plane, &ransac_summary));
+      options, ransac_type, points3d, &plane, &ransac_summary));
 
   // Expect that the inlier ratio is close to the ground truth.
   EXPECT_GT(static_cast<double>(ransac_summary.inliers.size()), 3);
@@ -180,5 +181,18 @@ TEST(EstimateDominantPlane, OutliersWithNoise) {
   ExecuteRandomTest(options, kInlierRatio, kNoise);
 }
 
+TEST(EstimateDominantPlane, OutliersWithNoiseMagsac) {
+  // The point to plane distances are unsquared residuals with one degree of
+  // freedom, so the error threshold is the largest distance of an inlier.
+  RansacParameters options;
+  options.rng = std::make_shared<RandomNumberGenerator>(rng);
+  options.error_thresh = 3.0 * kErrorThreshold;
+  options.failure_probability = 0.001;
+  const double kInlierRatio = 0.7;
+  const double kNoise = 1.0;
+
+  ExecuteRandomTest(options, kInlierRatio, kNoise, RansacType::MAGSAC);
+}
+
 }  // namespace
 }  // namespace theia
@@ -73,6 +73,15 @@ class EssentialMatrixEstimator
         image1_points, image2_points, essential_matrices);
   }
 
+  // Correspondences are neighbors if they are close in both images.
+  bool SpatialCoordinates(const FeatureCorrespondence& correspondence,
+                          Eigen::VectorXd* coordinates) const override {
+    coordinates->resize(4);
+    *coordinates << correspondence.feature1.point_,
+        correspondence.feature2.point_;
+    return true;
+  }
+
   // The error for a correspondences given a model. This is the squared sampson
   // error.
   double Error(const FeatureCorrespondence& correspondence,
@@ -82,6 +91,9 @@ class EssentialMatrixEstimator
                                   correspondence.feature2.point_);
   }
 
+  // Squared Sampson distances of correspondences in two images.
+  int ResidualDegreesOfFreedom() const { return 4; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(EssentialMatrixEstimator);
 };
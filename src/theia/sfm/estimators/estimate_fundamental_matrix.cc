@@ -87,6 +87,15 @@ class FundamentalMatrixEstimator
     return ba_summary.final_cost < ba_summary.initial_cost && ba_summary.success;
   }
 
+  // Correspondences are neighbors if they are close in both images.
+  bool SpatialCoordinates(const FeatureCorrespondence& correspondence,
+                          Eigen::VectorXd* coordinates) const override {
+    coordinates->resize(4);
+    *coordinates << correspondence.feature1.point_,
+        correspondence.feature2.point_;
+    return true;
+  }
+
   // The error for a correspondences given a model. This is the squared sampson
   // error.
   double Error(const FeatureCorrespondence& correspondence,
@@ -96,6 +105,9 @@ class FundamentalMatrixEstimator
                                   correspondence.feature2.point_);
   }
 
+  // Squared Sampson distances of correspondences in two images.
+  int ResidualDegreesOfFreedom() const { return 4; }
+
  private:
   theia::BundleAdjustmentOptions ba_opts_;
   DISALLOW_COPY_AND_ASSIGN(FundamentalMatrixEstimator);
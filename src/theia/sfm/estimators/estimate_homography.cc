@@ -84,6 +84,15 @@ class HomographyEstimator
     return true;
   }
 
+  // Correspondences are neighbors if they are close in both images.
+  bool SpatialCoordinates(const FeatureCorrespondence& correspondence,
+                          Eigen::VectorXd* coordinates) const override {
+    coordinates->resize(4);
+    *coordinates << correspondence.feature1.point_,
+        correspondence.feature2.point_;
+    return true;
+  }
+
   // The error for a correspondences given a model. This is the asymmetric
   // distance that measures reprojection error in one image.
   double Error(const FeatureCorrespondence& correspondence,
@@ -94,6 +103,9 @@ class HomographyEstimator
         .squaredNorm();
   }
 
+  // Squared transfer errors in the second image.
+  int ResidualDegreesOfFreedom() const { return 2; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(HomographyEstimator);
 };
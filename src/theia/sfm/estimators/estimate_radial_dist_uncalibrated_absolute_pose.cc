@@ -133,6 +133,13 @@ class RadialDistUncalibratedAbsolutePoseEstimator
     return rotations.size() > 0;
   }
 
+  // Correspondences are neighbors if their features are close in the image.
+  bool SpatialCoordinates(const FeatureCorrespondence2D3D& correspondence,
+                          Eigen::VectorXd* coordinates) const override {
+    *coordinates = correspondence.feature;
+    return true;
+  }
+
   // The error for a correspondences given an absolute pose. This is the squared
   // reprojection error.
   double Error(const FeatureCorrespondence2D3D& correspondence,
@@ -156,6 +163,9 @@ class RadialDistUncalibratedAbsolutePoseEstimator
     return (distorted_point - correspondence.feature).squaredNorm();
   }
 
+  // Squared reprojection errors.
+  int ResidualDegreesOfFreedom() const { return 2; }
+
   void SetMetadata(RadialDistUncalibratedAbsolutePoseMetaData meta_data) {
     meta_data_ = meta_data;
   }
@@ -77,6 +77,15 @@ class RadialHomographyMatrixEstimator
         correspondences[0].max_radial_distortion);
   }
 
+  // Correspondences are neighbors if they are close in both images.
+  bool SpatialCoordinates(
+      const RadialDistortionFeatureCorrespondence& correspondence,
+      Eigen::VectorXd* coordinates) const override {
+    coordinates->resize(4);
+    *coordinates << correspondence.feature_left, correspondence.feature_right;
+    return true;
+  }
+
   // The error for a correspondence given a model
   double Error(const RadialDistortionFeatureCorrespondence& correspondence,
                const RadialHomographyResult& radial_homography_result) const {
@@ -88,6 +97,9 @@ class RadialHomographyMatrixEstimator
         correspondence.focal_length_estimate_right);
   }
 
+  // Symmetric squared transfer errors in both images.
+  int ResidualDegreesOfFreedom() const { return 4; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(RadialHomographyMatrixEstimator);
 };
@@ -36,12 +36,14 @@
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
+#include <glog/logging.h>
 #include <limits>
 #include <memory>
 #include <vector>
 
 #include "theia/matching/feature_correspondence.h"
 #include "theia/sfm/create_and_initialize_ransac_variant.h"
+#include "theia/sfm/estimators/relative_pose_and_homography_estimator.h"
 #include "theia/sfm/pose/essential_matrix_utils.h"
 #include "theia/sfm/pose/five_point_relative_pose.h"
 #include "theia/sfm/pose/util.h"
@@ -126,6 +128,15 @@ class RelativePoseEstimator
     return ba_summary.final_cost < ba_summary.initial_cost;
   }
 
+  // Correspondences are neighbors if they are close in both images.
+  bool SpatialCoordinates(const FeatureCorrespondence& correspondence,
+                          Eigen::VectorXd* coordinates) const override {
+    coordinates->resize(4);
+    *coordinates << correspondence.feature1.point_,
+        correspondence.feature2.point_;
+    return true;
+  }
+
   // The error for a correspondences given a model. This is the squared sampson
   // error.
   double Error(const FeatureCorrespondence& correspondence,
@@ -139,6 +150,9 @@ class RelativePoseEstimator
     return std::numeric_limits<double>::max();
   }
 
+  // Squared Sampson distances of correspondences in two images.
+  int ResidualDegreesOfFreedom() const { return 4; }
+
  private:
   theia::BundleAdjustmentOptions ba_opts_;
   DISALLOW_COPY_AND_ASSIGN(RelativePoseEstimator);
@@ -161,4 +175,38 @@ bool EstimateRelativePose(
       normalized_correspondences, relative_pose, ransac_summary);
 }
 
+bool EstimateRelativePoseAndHomography(
+    const RansacParameters& ransac_params,
+    const RansacType& ransac_type,
+    const std::vector<FeatureCorrespondence>& normalized_correspondences,
+    RelativePose* relative_pose,
+    Eigen::Matrix3d* homography,
+    std::vector<int>* homography_inliers,
+    RansacSummary* ransac_summary) {
+  CHECK_NOTNULL(homography);
+  CHECK_NOTNULL(homography_inliers);
+  RelativePoseEstimator relative_pose_estimator;
+  RelativePoseAndHomographyEstimator<RelativePoseEstimator> estimator(
+      relative_pose_estimator, ransac_params.error_thresh);
+  std::unique_ptr<SampleConsensusEstimator<
+      RelativePoseAndHomographyEstimator<RelativePoseEstimator> > >
+      ransac = CreateAndInitializeRansacVariant(
+          ransac_type, ransac_params, estimator);
+
+  RelativePoseAndHomography<RelativePose> model;
+  const bool success =
+      ransac->Estimate(normalized_correspondences, &model, ransac_summary) &&
+      model.has_relative_pose;
+  // The homography is output even without a relative pose, e.g. for planar
+  // scenes or rotation-only motion.
+  estimator.RefineBestHomography(normalized_correspondences);
+  *homography = estimator.BestHomography();
+  *homography_inliers = estimator.BestHomographyInliers();
+  if (!success) {
+    return false;
+  }
+  *relative_pose = model.relative_pose;
+  return true;
+}
+
 }  // namespace theia
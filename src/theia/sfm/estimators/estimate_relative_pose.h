@@ -64,6 +64,22 @@ bool EstimateRelativePose(
     RelativePose* relative_pose,
     RansacSummary* ransac_summary);
 
+// Estimates the relative pose as above and, from the same minimal samples and
+// residual passes, the homography with the most inliers (see
+// RelativePoseAndHomographyEstimator). The homography maps the normalized
+// features of the first image to the second one and homography_inliers are the
+// indices of the correspondences with a squared transfer error below
+// ransac_params.error_thresh. The homography is refit to its inliers after the
+// estimation and is output even if no relative pose is found.
+bool EstimateRelativePoseAndHomography(
+    const RansacParameters& ransac_params,
+    const RansacType& ransac_type,
+    const std::vector<FeatureCorrespondence>& normalized_correspondences,
+    RelativePose* relative_pose,
+    Eigen::Matrix3d* homography,
+    std::vector<int>* homography_inliers,
+    RansacSummary* ransac_summary);
+
 }  // namespace theia
 
 #endif  // THEIA_SFM_ESTIMATORS_ESTIMATE_RELATIVE_POSE_H_
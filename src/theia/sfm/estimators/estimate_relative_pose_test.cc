@@ -278,4 +278,68 @@ TEST(EstimateRelativePose, OutliersWithNoise_LO) {
   }
 }
 
+TEST(EstimateRelativePoseAndHomography, DominantPlane) {
+  static const int kNumPlanePoints = 60;
+  static const int kNumOffPlanePoints = 30;
+  static const double kPoseToleranceDegrees = 1e-4;
+
+  RansacParameters options;
+  options.rng = std::make_shared<RandomNumberGenerator>(rng);
+  options.use_mle = true;
+  options.error_thresh = kErrorThreshold;
+  options.failure_probability = 0.0001;
+
+  const Matrix3d rotation =
+      AngleAxisd(DegToRad(12.0), Vector3d::UnitY()).toRotationMatrix();
+  const Vector3d position(-0.7, 0, 0.1);
+  const Vector3d translation = (-rotation * position).normalized();
+
+  // Most points lie on the plane z = 5 and the rest are in front of or behind
+  // the plane.
+  std::vector<FeatureCorrespondence> correspondences;
+  for (int i = 0; i < kNumPlanePoints + kNumOffPlanePoints; i++) {
+    Vector3d point3d(rng.RandDouble(-1.0, 1.0), rng.RandDouble(-1.0, 1.0), 5.0);
+    if (i >= kNumPlanePoints) {
+      point3d.z() += (i % 2 == 0 ? 1.0 : -1.0) * rng.RandDouble(1.0, 2.0);
+    }
+    FeatureCorrespondence correspondence;
+    correspondence.feature1.point_ = point3d.hnormalized();
+    correspondence.feature2.point_ =
+        (rotation * point3d + translation).hnormalized();
+    correspondences.emplace_back(correspondence);
+  }
+
+  RelativePose relative_pose;
+  Matrix3d homography;
+  std::vector<int> homography_inliers;
+  RansacSummary ransac_summary;
+  EXPECT_TRUE(EstimateRelativePoseAndHomography(options,
+                                                RansacType::RANSAC,
+                                                correspondences,
+                                                &relative_pose,
+                                                &homography,
+                                                &homography_inliers,
+                                                &ransac_summary));
+
+  // All correspondences fit the relative pose but only the points on the plane
+  // fit the homography.
+  EXPECT_EQ(ransac_summary.inliers.size(), correspondences.size());
+  EXPECT_GE(homography_inliers.size(), kNumPlanePoints);
+  EXPECT_LT(homography_inliers.size(), correspondences.size());
+  for (const int i : homography_inliers) {
+    const Vector2d transferred_point =
+        (homography * correspondences[i].feature1.point_.homogeneous())
+            .hnormalized();
+    EXPECT_LT((transferred_point - correspondences[i].feature2.point_)
+                  .squaredNorm(),
+              kErrorThreshold);
+  }
+
+  const AngleAxisd rotation_loop(rotation * relative_pose.rotation.transpose());
+  EXPECT_LT(RadToDeg(rotation_loop.angle()), kPoseToleranceDegrees);
+  const double translation_diff_rad = std::acos(
+      Clamp(position.normalized().dot(relative_pose.position), -1.0, 1.0));
+  EXPECT_LT(RadToDeg(translation_diff_rad), kPoseToleranceDegrees);
+}
+
 }  // namespace theia
@@ -47,6 +47,15 @@ class RelativePoseWithKnownOrientationEstimator
     return true;
   }
 
+  // Correspondences are neighbors if they are close in both images.
+  bool SpatialCoordinates(const FeatureCorrespondence& correspondence,
+                          Eigen::VectorXd* coordinates) const override {
+    coordinates->resize(4);
+    *coordinates << correspondence.feature1.point_,
+        correspondence.feature2.point_;
+    return true;
+  }
+
   // The error for a correspondences given an relative position. This is the
   // squared reprojection error.
   double Error(const FeatureCorrespondence& correspondence,
@@ -57,6 +66,9 @@ class RelativePoseWithKnownOrientationEstimator
                                   correspondence.feature2.point_);
   }
 
+  // Squared Sampson distances of correspondences in two images.
+  int ResidualDegreesOfFreedom() const { return 4; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(RelativePoseWithKnownOrientationEstimator);
 };
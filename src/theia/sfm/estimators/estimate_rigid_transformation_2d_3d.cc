@@ -112,6 +112,15 @@ class NonCentralCameraPoseEstimator
     return true;
   }
 
+  // The observations may come from different cameras, so correspondences are
+  // neighbors if their 3D points are close.
+  bool SpatialCoordinates(
+      const CameraAndFeatureCorrespondence2D3D& correspondence,
+      Eigen::VectorXd* coordinates) const override {
+    *coordinates = correspondence.point3d.hnormalized();
+    return true;
+  }
+
   // Given a model and a data point, calculate the error. Users should implement
   // this function appropriately for the task being solved.
   double Error(const CameraAndFeatureCorrespondence2D3D& data,
@@ -130,6 +139,9 @@ class NonCentralCameraPoseEstimator
     return (data.observation.point_ - reprojection).squaredNorm();
   }
 
+  // Squared reprojection errors.
+  int ResidualDegreesOfFreedom() const override { return 2; }
+
  private:
   // Upnp estimator.
   std::unique_ptr<class Upnp> estimator_;
@@ -132,6 +132,15 @@ class GdlsSimilarityTransformationEstimator
     return similarity_transformations->size() > 0;
   }
 
+  // The observations may come from different cameras, so correspondences are
+  // neighbors if their 3D points are close.
+  bool SpatialCoordinates(
+      const CameraAndFeatureCorrespondence2D3D& correspondence,
+      Eigen::VectorXd* coordinates) const override {
+    *coordinates = correspondence.point3d.hnormalized();
+    return true;
+  }
+
   // The error for a correspondences given an absolute pose. This is the squared
   // reprojection error.
   double Error(const CameraAndFeatureCorrespondence2D3D& correspondence,
@@ -153,6 +162,9 @@ class GdlsSimilarityTransformationEstimator
     return (correspondence.observation.point_ - reprojection).squaredNorm();
   }
 
+  // Squared reprojection errors.
+  int ResidualDegreesOfFreedom() const override { return 2; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(GdlsSimilarityTransformationEstimator);
 };
@@ -103,6 +103,9 @@ class TriangulationEstimator
     }
     return (observation.observed_pixel - reprojection).squaredNorm();
   }
+
+  // Squared reprojection errors.
+  int ResidualDegreesOfFreedom() const { return 2; }
 };
 
 }  // namespace
@@ -85,6 +85,13 @@ class UncalibratedAbsolutePoseEstimator
     return num_solutions > 0;
   }
 
+  // Correspondences are neighbors if their features are close in the image.
+  bool SpatialCoordinates(const FeatureCorrespondence2D3D& correspondence,
+                          Eigen::VectorXd* coordinates) const override {
+    *coordinates = correspondence.feature;
+    return true;
+  }
+
   // The error for a correspondences given an absolute pose. This is the squared
   // reprojection error.
   double Error(const FeatureCorrespondence2D3D& correspondence,
@@ -98,6 +105,9 @@ class UncalibratedAbsolutePoseEstimator
     return (reprojected_feature - correspondence.feature).squaredNorm();
   }
 
+  // Squared reprojection errors.
+  int ResidualDegreesOfFreedom() const { return 2; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(UncalibratedAbsolutePoseEstimator);
 };
@@ -36,12 +36,14 @@
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
+#include <glog/logging.h>
 #include <limits>
 #include <memory>
 #include <vector>
 
 #include "theia/matching/feature_correspondence.h"
 #include "theia/sfm/create_and_initialize_ransac_variant.h"
+#include "theia/sfm/estimators/relative_pose_and_homography_estimator.h"
 #include "theia/sfm/pose/eight_point_fundamental_matrix.h"
 #include "theia/sfm/pose/essential_matrix_utils.h"
 #include "theia/sfm/pose/fundamental_matrix_util.h"
@@ -56,10 +58,61 @@
 namespace theia {
 
 using Eigen::Matrix3d;
+using Eigen::Vector2d;
 using Eigen::Vector3d;
 
 namespace {
 
+// Triplets of the 8 sample correspondences such that any 6 of them contain at
+// least one triplet. If 6 or more correspondences lie on a plane, the
+// homography induced by the plane is found from one of these triplets.
+static const int kNumSampleTriplets = 4;
+static const int kSampleTriplets[kNumSampleTriplets][3] = {
+    {0, 1, 2}, {0, 1, 3}, {2, 3, 4}, {5, 6, 7}};
+
+// The H-degeneracy test of DEGENSAC (Chum et al., "Two-View Geometry
+// Estimation Unaffected by a Dominant Plane", CVPR 2005). Returns true if at
+// least 6 of the 8 sample correspondences are consistent with a homography
+// compatible with the fundamental matrix. The homography and the indices of the
+// correspondences off its plane are output in that case.
+bool IsHomographyDegenerateSample(const Matrix3d& fundamental_matrix,
+                                  const std::vector<Vector2d>& image1_points,
+                                  const std::vector<Vector2d>& image2_points,
+                                  const double sq_error_thresh,
+                                  Matrix3d* homography,
+                                  std::vector<int>* off_plane_indices) {
+  static const int kMinNumPointsOnPlane = 6;
+
+  std::vector<Vector2d> triplet1(3), triplet2(3);
+  for (int t = 0; t < kNumSampleTriplets; t++) {
+    for (int i = 0; i < 3; i++) {
+      triplet1[i] = image1_points[kSampleTriplets[t][i]];
+      triplet2[i] = image2_points[kSampleTriplets[t][i]];
+    }
+    if (!HomographyFromFundamentalMatrix(fundamental_matrix.data(),
+                                         triplet1,
+                                         triplet2,
+                                         homography->data())) {
+      continue;
+    }
+
+    off_plane_indices->clear();
+    for (int i = 0; i < image1_points.size(); i++) {
+      const Vector2d transferred_point =
+          (*homography * image1_points[i].homogeneous()).hnormalized();
+      if ((transferred_point - image2_points[i]).squaredNorm() >=
+          sq_error_thresh) {
+        off_plane_indices->emplace_back(i);
+      }
+    }
+    if (image1_points.size() - off_plane_indices->size() >=
+        kMinNumPointsOnPlane) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // An estimator for computing the relative pose from 8 feature correspondences
 // (via decomposition of the fundamental matrix).
 //
@@ -69,7 +122,11 @@ namespace {
 class UncalibratedRelativePoseEstimator
     : public Estimator<FeatureCorrespondence, UncalibratedRelativePose> {
  public:
-  UncalibratedRelativePoseEstimator(const Eigen::Vector2d& min_max_focal_length) {
+  // Samples are tested for planar degeneracies with the squared transfer error
+  // threshold degeneracy_error_thresh.
+  UncalibratedRelativePoseEstimator(const Eigen::Vector2d& min_max_focal_length,
+                                    const double degeneracy_error_thresh)
+      : degeneracy_error_thresh_(degeneracy_error_thresh) {
       ba_opts_.max_num_iterations = 10;
       min_max_f_ = min_max_focal_length;
   }
@@ -94,6 +151,36 @@ class UncalibratedRelativePoseEstimator
       return false;
     }
 
+    // The fundamental matrix of a sample with a dominant plane is unreliable.
+    // Recover it from the plane and the parallax of the off-plane points. This
+    // needs at least two off-plane points in the sample, so the eight-point
+    // fundamental matrix is kept for samples of planar scenes or rotation-only
+    // motion, where every point agrees with the homography.
+    Matrix3d homography;
+    std::vector<int> off_plane_indices;
+    if (IsHomographyDegenerateSample(relative_pose.fundamental_matrix,
+                                     image1_points,
+                                     image2_points,
+                                     degeneracy_error_thresh_,
+                                     &homography,
+                                     &off_plane_indices) &&
+        off_plane_indices.size() >= 2) {
+      std::vector<Vector2d> off_plane_points1, off_plane_points2;
+      for (const int i : off_plane_indices) {
+        off_plane_points1.emplace_back(image1_points[i]);
+        off_plane_points2.emplace_back(image2_points[i]);
+      }
+      Matrix3d plane_and_parallax_fundamental_matrix;
+      if (FundamentalMatrixFromHomographyAndParallax(
+              homography.data(),
+              off_plane_points1,
+              off_plane_points2,
+              plane_and_parallax_fundamental_matrix.data())) {
+        relative_pose.fundamental_matrix =
+            plane_and_parallax_fundamental_matrix;
+      }
+    }
+
     // Only consider fundamental matrices that we can decompose focal lengths
     // from.
     if (!FocalLengthsFromFundamentalMatrix(
@@ -169,6 +256,15 @@ class UncalibratedRelativePoseEstimator
       return ba_summary.final_cost < ba_summary.initial_cost && ba_summary.success;
   }
 
+  // Correspondences are neighbors if they are close in both images.
+  bool SpatialCoordinates(const FeatureCorrespondence& correspondence,
+                          Eigen::VectorXd* coordinates) const override {
+    coordinates->resize(4);
+    *coordinates << correspondence.feature1.point_,
+        correspondence.feature2.point_;
+    return true;
+  }
+
   // The error for a correspondences given a model. This is the squared sampson
   // error.
   double Error(const FeatureCorrespondence& centered_correspondence,
@@ -189,10 +285,14 @@ class UncalibratedRelativePoseEstimator
                                   centered_correspondence.feature2.point_);
   }
 
+  // Squared Sampson distances of correspondences in two images.
+  int ResidualDegreesOfFreedom() const { return 4; }
+
  private:
   theia::BundleAdjustmentOptions ba_opts_;
   // for sanity checks
   Eigen::Vector2d min_max_f_;
+  const double degeneracy_error_thresh_;
   DISALLOW_COPY_AND_ASSIGN(UncalibratedRelativePoseEstimator);
 };
 
@@ -205,7 +305,8 @@ bool EstimateUncalibratedRelativePose(
     const Eigen::Vector2d& min_max_focal_lengths,
     UncalibratedRelativePose* relative_pose,
     RansacSummary* ransac_summary) {
-  UncalibratedRelativePoseEstimator relative_pose_estimator(min_max_focal_lengths);
+  UncalibratedRelativePoseEstimator relative_pose_estimator(
+      min_max_focal_lengths, ransac_params.error_thresh);
   std::unique_ptr<SampleConsensusEstimator<UncalibratedRelativePoseEstimator> >
       ransac = CreateAndInitializeRansacVariant(
           ransac_type, ransac_params, relative_pose_estimator);
@@ -215,4 +316,40 @@ bool EstimateUncalibratedRelativePose(
       centered_correspondences, relative_pose, ransac_summary);
 }
 
+bool EstimateUncalibratedRelativePoseAndHomography(
+    const RansacParameters& ransac_params,
+    const RansacType& ransac_type,
+    const std::vector<FeatureCorrespondence>& centered_correspondences,
+    const Eigen::Vector2d& min_max_focal_lengths,
+    UncalibratedRelativePose* relative_pose,
+    Eigen::Matrix3d* homography,
+    std::vector<int>* homography_inliers,
+    RansacSummary* ransac_summary) {
+  CHECK_NOTNULL(homography);
+  CHECK_NOTNULL(homography_inliers);
+  UncalibratedRelativePoseEstimator relative_pose_estimator(
+      min_max_focal_lengths, ransac_params.error_thresh);
+  RelativePoseAndHomographyEstimator<UncalibratedRelativePoseEstimator>
+      estimator(relative_pose_estimator, ransac_params.error_thresh);
+  std::unique_ptr<SampleConsensusEstimator<
+      RelativePoseAndHomographyEstimator<UncalibratedRelativePoseEstimator> > >
+      ransac = CreateAndInitializeRansacVariant(
+          ransac_type, ransac_params, estimator);
+
+  RelativePoseAndHomography<UncalibratedRelativePose> model;
+  const bool success =
+      ransac->Estimate(centered_correspondences, &model, ransac_summary) &&
+      model.has_relative_pose;
+  // The homography is output even without a relative pose, e.g. for planar
+  // scenes or rotation-only motion.
+  estimator.RefineBestHomography(centered_correspondences);
+  *homography = estimator.BestHomography();
+  *homography_inliers = estimator.BestHomographyInliers();
+  if (!success) {
+    return false;
+  }
+  *relative_pose = model.relative_pose;
+  return true;
+}
+
 }  // namespace theia
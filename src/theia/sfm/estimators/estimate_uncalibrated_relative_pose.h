@@ -61,6 +61,12 @@ struct UncalibratedRelativePose {
 // that the principal point is (0, 0). Returns true if a pose could be
 // succesfully estimated, and false otherwise. The quality of the result depends
 // on the quality of the input data.
+//
+// Minimal samples with 6 or more of the 8 correspondences on a plane do not
+// constrain the fundamental matrix well. As in DEGENSAC, the fundamental matrix
+// of such samples is recovered from the plane and the parallax of the remaining
+// correspondences instead. Samples with fewer than 2 correspondences off the
+// plane keep the eight-point fundamental matrix.
 bool EstimateUncalibratedRelativePose(const RansacParameters& ransac_params,
     const RansacType& ransac_type,
     const std::vector<FeatureCorrespondence>& centered_correspondences,
@@ -68,6 +74,23 @@ bool EstimateUncalibratedRelativePose(const RansacParameters& ransac_params,
     UncalibratedRelativePose* relative_pose,
     RansacSummary* ransac_summary);
 
+// Estimates the relative pose and focal lengths as above and, from the same
+// minimal samples and residual passes, the homography with the most inliers
+// (see RelativePoseAndHomographyEstimator). The homography maps the centered
+// features of the first image to the second one and homography_inliers are the
+// indices of the correspondences with a squared transfer error below
+// ransac_params.error_thresh. The homography is refit to its inliers after the
+// estimation and is output even if no relative pose is found.
+bool EstimateUncalibratedRelativePoseAndHomography(
+    const RansacParameters& ransac_params,
+    const RansacType& ransac_type,
+    const std::vector<FeatureCorrespondence>& centered_correspondences,
+    const Eigen::Vector2d& min_max_focal_lengths,
+    UncalibratedRelativePose* relative_pose,
+    Eigen::Matrix3d* homography,
+    std::vector<int>* homography_inliers,
+    RansacSummary* ransac_summary);
+
 }  // namespace theia
 
 #endif  // THEIA_SFM_ESTIMATORS_ESTIMATE_UNCALIBRATED_RELATIVE_POSE_H_
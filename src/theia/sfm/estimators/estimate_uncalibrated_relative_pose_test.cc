@@ -260,4 +260,111 @@ TEST(EstimateUncalibratedRelativePose, OutliersWithNoise_LO) {
   }
 }
 
+// Most minimal samples of a scene with a dominant plane are H-degenerate, and
+// their fundamental matrices must be recovered from the plane and parallax.
+TEST(EstimateUncalibratedRelativePoseAndHomography, DominantPlane) {
+  static const int kNumPlanePoints = 160;
+  static const int kNumOffPlanePoints = 40;
+  static const double kPoseToleranceDegrees = 1.0;
+
+  RansacParameters options;
+  options.rng = std::make_shared<RandomNumberGenerator>(rng);
+  options.use_mle = true;
+  options.error_thresh = 2;
+  options.failure_probability = 0.001;
+
+  for (int k = 0; k < 10; k++) {
+    const Matrix3d rotation = RandomRotation(10.0, &rng);
+    const Vector3d position = rng.RandVector3d();
+    const Vector3d translation = (-rotation * position).normalized();
+    const double focal_length1 = rng.RandDouble(800, 1600);
+    const double focal_length2 = rng.RandDouble(800, 1600);
+
+    std::vector<FeatureCorrespondence> correspondences;
+    for (int i = 0; i < kNumPlanePoints + kNumOffPlanePoints; i++) {
+      Vector3d point3d(
+          rng.RandDouble(-1.0, 1.0), rng.RandDouble(-1.0, 1.0), 4.0);
+      if (i >= kNumPlanePoints) {
+        point3d.z() += rng.RandDouble(-1.0, 1.0);
+      }
+      FeatureCorrespondence correspondence;
+      correspondence.feature1.point_ = focal_length1 * point3d.hnormalized();
+      correspondence.feature2.point_ =
+          focal_length2 * (rotation * point3d + translation).hnormalized();
+      correspondences.emplace_back(correspondence);
+    }
+
+    UncalibratedRelativePose relative_pose;
+    Matrix3d homography;
+    std::vector<int> homography_inliers;
+    RansacSummary ransac_summary;
+    const Eigen::Vector2d min_max_focal_length(600., 2000.);
+    EXPECT_TRUE(EstimateUncalibratedRelativePoseAndHomography(
+        options,
+        RansacType::RANSAC,
+        correspondences,
+        min_max_focal_length,
+        &relative_pose,
+        &homography,
+        &homography_inliers,
+        &ransac_summary));
+
+    EXPECT_GE(homography_inliers.size(), kNumPlanePoints);
+    EXPECT_GT(ransac_summary.inliers.size(), homography_inliers.size());
+
+    const Eigen::AngleAxisd rotation_loop(rotation *
+                                          relative_pose.rotation.transpose());
+    EXPECT_LT(RadToDeg(rotation_loop.angle()), kPoseToleranceDegrees);
+    const double translation_diff_rad = std::acos(
+        Clamp(position.normalized().dot(relative_pose.position), -1.0, 1.0));
+    EXPECT_LT(RadToDeg(translation_diff_rad), kPoseToleranceDegrees);
+  }
+}
+
+// All points of a planar scene agree with the homography, so no sample has the
+// off-plane points needed for plane and parallax. The homography and its
+// inliers are output whether or not a relative pose is found.
+TEST(EstimateUncalibratedRelativePoseAndHomography, PlanarScene) {
+  static const int kNumPoints = 100;
+  static const double kNoise = 0.5;
+
+  RansacParameters options;
+  options.rng = std::make_shared<RandomNumberGenerator>(rng);
+  options.use_mle = true;
+  options.error_thresh = 4.0;
+  options.failure_probability = 0.001;
+
+  const Matrix3d rotation = RandomRotation(10.0, &rng);
+  const Vector3d translation = rng.RandVector3d().normalized();
+  static const double kFocalLength = 1000.0;
+
+  std::vector<FeatureCorrespondence> correspondences;
+  for (int i = 0; i < kNumPoints; i++) {
+    const Vector3d point3d(
+        rng.RandDouble(-1.0, 1.0), rng.RandDouble(-1.0, 1.0), 4.0);
+    FeatureCorrespondence correspondence;
+    correspondence.feature1.point_ = kFocalLength * point3d.hnormalized();
+    correspondence.feature2.point_ =
+        kFocalLength * (rotation * point3d + translation).hnormalized();
+    AddNoiseToProjection(kNoise, &rng, &correspondence.feature1.point_);
+    AddNoiseToProjection(kNoise, &rng, &correspondence.feature2.point_);
+    correspondences.emplace_back(correspondence);
+  }
+
+  UncalibratedRelativePose relative_pose;
+  Matrix3d homography;
+  std::vector<int> homography_inliers;
+  RansacSummary ransac_summary;
+  const Eigen::Vector2d min_max_focal_length(600., 2000.);
+  EstimateUncalibratedRelativePoseAndHomography(options,
+                                                RansacType::RANSAC,
+                                                correspondences,
+                                                min_max_focal_length,
+                                                &relative_pose,
+                                                &homography,
+                                                &homography_inliers,
+                                                &ransac_summary);
+  EXPECT_EQ(homography_inliers.size(), kNumPoints);
+}
+
 }  // namespace theia
@@ -140,6 +140,27 @@ std::tuple<bool, RelativePose, RansacSummary> EstimateRelativePoseWrapper(
   return std::make_tuple(success, relative_pose, ransac_summary);
 }
 
+std::tuple<bool, RelativePose, Eigen::Matrix3d, std::vector<int>, RansacSummary>
+EstimateRelativePoseAndHomographyWrapper(
+    const RansacParameters& ransac_params,
+    const RansacType& ransac_type,
+    const std::vector<FeatureCorrespondence>& normalized_correspondences) {
+  RelativePose relative_pose;
+  Eigen::Matrix3d homography;
+  std::vector<int> homography_inliers;
+  RansacSummary ransac_summary;
+  const bool success =
+      EstimateRelativePoseAndHomography(ransac_params,
+                                        ransac_type,
+                                        normalized_correspondences,
+                                        &relative_pose,
+                                        &homography,
+                                        &homography_inliers,
+                                        &ransac_summary);
+  return std::make_tuple(
+      success, relative_pose, homography, homography_inliers, ransac_summary);
+}
+
 std::tuple<bool, Eigen::Vector3d, RansacSummary>
 EstimateRelativePoseWithKnownOrientationWrapper(
     const RansacParameters& ransac_params,
@@ -251,4 +272,31 @@ EstimateUncalibratedRelativePoseWrapper(
   return std::make_tuple(success, relative_pose, ransac_summary);
 }
 
+std::tuple<bool,
+           UncalibratedRelativePose,
+           Eigen::Matrix3d,
+           std::vector<int>,
+           RansacSummary>
+EstimateUncalibratedRelativePoseAndHomographyWrapper(
+    const RansacParameters& ransac_params,
+    const RansacType& ransac_type,
+    const std::vector<FeatureCorrespondence>& centered_correspondences,
+    const Eigen::Vector2d& min_max_focal_length) {
+  UncalibratedRelativePose relative_pose;
+  Eigen::Matrix3d homography;
+  std::vector<int> homography_inliers;
+  RansacSummary ransac_summary;
+  const bool success =
+      EstimateUncalibratedRelativePoseAndHomography(ransac_params,
+                                                    ransac_type,
+                                                    centered_correspondences,
+                                                    min_max_focal_length,
+                                                    &relative_pose,
+                                                    &homography,
+                                                    &homography_inliers,
+                                                    &ransac_summary);
+  return std::make_tuple(
+      success, relative_pose, homography, homography_inliers, ransac_summary);
+}
+
 }  // namespace theia
@@ -72,6 +72,12 @@ std::tuple<bool, RelativePose, RansacSummary> EstimateRelativePoseWrapper(
     const RansacType& ransac_type,
     const std::vector<FeatureCorrespondence>& normalized_correspondences);
 
+std::tuple<bool, RelativePose, Eigen::Matrix3d, std::vector<int>, RansacSummary>
+EstimateRelativePoseAndHomographyWrapper(
+    const RansacParameters& ransac_params,
+    const RansacType& ransac_type,
+    const std::vector<FeatureCorrespondence>& normalized_correspondences);
+
 std::tuple<bool, Eigen::Vector3d, RansacSummary>
 EstimateRelativePoseWithKnownOrientationWrapper(
     const RansacParameters& ransac_params,
@@ -114,4 +120,15 @@ EstimateUncalibratedRelativePoseWrapper(
     const std::vector<FeatureCorrespondence>& centered_correspondences,
     const Eigen::Vector2d& min_max_focal_length);
 
+std::tuple<bool,
+           UncalibratedRelativePose,
+           Eigen::Matrix3d,
+           std::vector<int>,
+           RansacSummary>
+EstimateUncalibratedRelativePoseAndHomographyWrapper(
+    const RansacParameters& ransac_params,
+    const RansacType& ransac_type,
+    const std::vector<FeatureCorrespondence>& centered_correspondences,
+    const Eigen::Vector2d& min_max_focal_length);
+
 }  // namespace theia
@@ -0,0 +1,257 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_SFM_ESTIMATORS_RELATIVE_POSE_AND_HOMOGRAPHY_ESTIMATOR_H_
+#define THEIA_SFM_ESTIMATORS_RELATIVE_POSE_AND_HOMOGRAPHY_ESTIMATOR_H_
+
+#include <Eigen/Core>
+#include <limits>
+#include <vector>
+
+#include "theia/matching/feature_correspondence.h"
+#include "theia/sfm/pose/four_point_homography.h"
+#include "theia/solvers/estimator.h"
+#include "theia/util/util.h"
+
+namespace theia {
+
+// A relative pose hypothesis together with the homography that was estimated
+// from the same minimal sample.
+template <class RelativePoseModel>
+struct RelativePoseAndHomography {
+  RelativePoseModel relative_pose;
+  Eigen::Matrix3d homography;
+
+  // False if the relative pose solver failed on the sample. These hypotheses
+  // are only kept to score the homography and have no inliers.
+  bool has_relative_pose = false;
+
+  // Only the first hypothesis of a sample scores its homography so that each
+  // homography is evaluated once, no matter how many relative poses the
+  // minimal solver returns.
+  bool score_homography = false;
+};
+
+// Estimates the relative pose and the dominant homography of two views in a
+// single sample consensus run, e.g. to decide whether a view pair is planar or
+// rotation-only. Each minimal sample of the relative pose estimator is also
+// used to fit a homography to its first 4 correspondences, and the residuals of
+// both models are computed in the same pass over the data. The relative pose
+// hypotheses are scored by the sample consensus estimator as usual while the
+// homography with the most inliers is tracked by this estimator. A homography
+// fit to 4 points is noisy, so RefineBestHomography should be called after the
+// estimation to refit it to its inliers, like the nonminimal fit at the end of
+// a separate homography estimation.
+//
+// The homography error is the asymmetric transfer error used by
+// EstimateHomography and must be below homography_error_thresh for inliers.
+//
+// NOTE: The best homography is state of the estimator, so a new estimator must
+// be used for each estimation and it must not be shared between threads.
+template <class RelativePoseEstimator>
+class RelativePoseAndHomographyEstimator
+    : public Estimator<
+          FeatureCorrespondence,
+          RelativePoseAndHomography<typename RelativePoseEstimator::Model> > {
+ public:
+  typedef typename RelativePoseEstimator::Model RelativePoseModel;
+  typedef RelativePoseAndHomography<RelativePoseModel> Model;
+
+  RelativePoseAndHomographyEstimator(
+      const RelativePoseEstimator& relative_pose_estimator,
+      const double homography_error_thresh)
+      : relative_pose_estimator_(relative_pose_estimator),
+        homography_error_thresh_(homography_error_thresh),
+        best_homography_(Eigen::Matrix3d::Identity()) {}
+
+  double SampleSize() const { return relative_pose_estimator_.SampleSize(); }
+
+  bool EstimateModel(const std::vector<FeatureCorrespondence>& correspondences,
+                     std::vector<Model>* models) const {
+    std::vector<Eigen::Vector2d> image1_points(4), image2_points(4);
+    for (int i = 0; i < 4; i++) {
+      image1_points[i] = correspondences[i].feature1.point_;
+      image2_points[i] = correspondences[i].feature2.point_;
+    }
+    Eigen::Matrix3d homography;
+    const bool has_homography =
+        FourPointHomography(image1_points, image2_points, &homography);
+
+    std::vector<RelativePoseModel> relative_poses;
+    if (!relative_pose_estimator_.EstimateModel(correspondences,
+                                                &relative_poses) ||
+        relative_poses.empty()) {
+      if (!has_homography) {
+        return false;
+      }
+      models->emplace_back();
+      models->back().homography = homography;
+      models->back().score_homography = true;
+      return true;
+    }
+
+    models->reserve(models->size() + relative_poses.size());
+    for (int i = 0; i < relative_poses.size(); i++) {
+      Model model;
+      model.relative_pose = relative_poses[i];
+      model.homography = homography;
+      model.has_relative_pose = true;
+      model.score_homography = has_homography && i == 0;
+      models->emplace_back(model);
+    }
+    return true;
+  }
+
+  bool RefineModel(const std::vector<FeatureCorrespondence>& correspondences,
+                   Model* model) const {
+    return model->has_relative_pose &&
+           relative_pose_estimator_.RefineModel(correspondences,
+                                                &model->relative_pose);
+  }
+
+  bool SpatialCoordinates(const FeatureCorrespondence& correspondence,
+                          Eigen::VectorXd* coordinates) const override {
+    return relative_pose_estimator_.SpatialCoordinates(correspondence,
+                                                       coordinates);
+  }
+
+  double Error(const FeatureCorrespondence& correspondence,
+               const Model& model) const {
+    if (!model.has_relative_pose) {
+      return std::numeric_limits<double>::max();
+    }
+    return relative_pose_estimator_.Error(correspondence, model.relative_pose);
+  }
+
+  // The residuals are those of the relative pose estimator.
+  int ResidualDegreesOfFreedom() const {
+    return relative_pose_estimator_.ResidualDegreesOfFreedom();
+  }
+  bool ResidualsAreSquared() const {
+    return relative_pose_estimator_.ResidualsAreSquared();
+  }
+
+  // Computes the relative pose residuals and, for the first hypothesis of each
+  // sample, the homography inliers in the same pass over the data.
+  std::vector<double> Residuals(
+      const std::vector<FeatureCorrespondence>& correspondences,
+      const Model& model) const override {
+    std::vector<double> residuals(correspondences.size());
+    if (!model.score_homography) {
+      for (int i = 0; i < correspondences.size(); i++) {
+        residuals[i] = Error(correspondences[i], model);
+      }
+      return residuals;
+    }
+
+    homography_inliers_.clear();
+    for (int i = 0; i < correspondences.size(); i++) {
+      residuals[i] = Error(correspondences[i], model);
+      if (HomographyError(correspondences[i], model.homography) <
+          homography_error_thresh_) {
+        homography_inliers_.emplace_back(i);
+      }
+    }
+    if (homography_inliers_.size() > best_homography_inliers_.size()) {
+      best_homography_ = model.homography;
+      best_homography_inliers_.swap(homography_inliers_);
+    }
+    return residuals;
+  }
+
+  // Refits the best homography to its inliers with the normalized DLT and
+  // recounts the inliers, as long as their number grows.
+  void RefineBestHomography(
+      const std::vector<FeatureCorrespondence>& correspondences) {
+    static const int kMaxNumRefinements = 10;
+    std::vector<Eigen::Vector2d> image1_points, image2_points;
+    for (int r = 0; r < kMaxNumRefinements; r++) {
+      if (best_homography_inliers_.size() < 4) {
+        return;
+      }
+      image1_points.clear();
+      image2_points.clear();
+      for (const int i : best_homography_inliers_) {
+        image1_points.emplace_back(correspondences[i].feature1.point_);
+        image2_points.emplace_back(correspondences[i].feature2.point_);
+      }
+      Eigen::Matrix3d homography;
+      if (!FourPointHomography(image1_points, image2_points, &homography)) {
+        return;
+      }
+
+      homography_inliers_.clear();
+      for (int i = 0; i < correspondences.size(); i++) {
+        if (HomographyError(correspondences[i], homography) <
+            homography_error_thresh_) {
+          homography_inliers_.emplace_back(i);
+        }
+      }
+      if (homography_inliers_.size() <= best_homography_inliers_.size()) {
+        return;
+      }
+      best_homography_ = homography;
+      best_homography_inliers_.swap(homography_inliers_);
+    }
+  }
+
+  // The homography with the most inliers among all samples evaluated so far
+  // and its inliers.
+  const Eigen::Matrix3d& BestHomography() const { return best_homography_; }
+  const std::vector<int>& BestHomographyInliers() const {
+    return best_homography_inliers_;
+  }
+
+ private:
+  static double HomographyError(const FeatureCorrespondence& correspondence,
+                                const Eigen::Matrix3d& homography) {
+    const Eigen::Vector3d reprojected_point =
+        homography * correspondence.feature1.point_.homogeneous();
+    return (correspondence.feature2.point_ - reprojected_point.hnormalized())
+        .squaredNorm();
+  }
+
+  const RelativePoseEstimator& relative_pose_estimator_;
+  const double homography_error_thresh_;
+
+  mutable Eigen::Matrix3d best_homography_;
+  mutable std::vector<int> best_homography_inliers_;
+  // The inliers of the homography being scored. It is swapped with the best
+  // inliers when the homography improves so that neither buffer is reallocated
+  // for each sample.
+  mutable std::vector<int> homography_inliers_;
+
+  DISALLOW_COPY_AND_ASSIGN(RelativePoseAndHomographyEstimator);
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SFM_ESTIMATORS_RELATIVE_POSE_AND_HOMOGRAPHY_ESTIMATOR_H_
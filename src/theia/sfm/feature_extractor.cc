@@ -60,23 +60,15 @@ bool FeatureExtractor::Extract(
   CHECK_NOTNULL(keypoints)->resize(filenames.size());
   CHECK_NOTNULL(descriptors)->resize(filenames.size());
 
-  // The thread pool will wait to finish all jobs when it goes out of scope.
-  const int num_threads =
-      std::min(options_.num_threads, static_cast<int>(filenames.size()));
-  ThreadPool feature_extractor_pool(num_threads);
-  for (int i = 0; i < filenames.size(); i++) {
+  ParallelFor(options_.num_threads, filenames.size(), [&](const int i) {
     if (!FileExists(filenames[i])) {
       LOG(ERROR) << "Could not extract features for " << filenames[i]
                  << " because the file cannot be found.";
-      continue;
+      return;
     }
 
-    feature_extractor_pool.Add(&FeatureExtractor::ExtractFeatures,
-                               this,
-                               filenames[i],
-                               &(*keypoints)[i],
-                               &(*descriptors)[i]);
-  }
+    ExtractFeatures(filenames[i], &(*keypoints)[i], &(*descriptors)[i]);
+  });
   return true;
 }
 
@@ -223,19 +223,14 @@ void FeatureExtractorAndMatcher::ExtractAndMatchFeatures() {
   CHECK_NOTNULL(matcher_.get());
 
   // For each image, process the features and add it to the matcher.
-  const int num_threads =
-      std::min(options_.num_threads, static_cast<int>(image_filepaths_.size()));
-  std::unique_ptr<ThreadPool> thread_pool(new ThreadPool(num_threads));
-  for (int i = 0; i < image_filepaths_.size(); i++) {
+  ParallelFor(options_.num_threads, image_filepaths_.size(), [&](const int i) {
     if (!FileExists(image_filepaths_[i])) {
       LOG(ERROR) << "Could not extract features for " << image_filepaths_[i]
                  << " because the file cannot be found.";
-      continue;
+      return;
     }
-    thread_pool->Add(&FeatureExtractorAndMatcher::ProcessImage, this, i);
-  }
-  // This forces all tasks to complete before proceeding.
-  thread_pool.reset(nullptr);
+    ProcessImage(i);
+  });
 
   // After all threads complete feature extraction, perform matching.
   SelectImagePairsWithGlobalDescriptorMatching();
@@ -341,20 +336,15 @@ void FeatureExtractorAndMatcher::ExtractGlobalDesriptors(
     const std::vector<std::string>& image_names,
     std::vector<Eigen::VectorXf>* global_descriptors) {
   // Extract the global descriptors in parallel.
-  ThreadPool pool(options_.num_threads);
   global_descriptors->resize(image_names.size());
-  for (int i = 0; i < image_names.size(); i++) {
-    pool.Add(
-        [&](const int i) {
-          const KeypointsAndDescriptors& features =
-              features_and_matches_database_->GetFeatures(image_names[i]);
-          // Extract the global descriptors
-          (*global_descriptors)[i] =
-              global_image_descriptor_extractor_->ExtractGlobalDescriptor(
-                  features.descriptors);
-        },
-        i);
-  }
+  ParallelFor(options_.num_threads, image_names.size(), [&](const int i) {
+    const KeypointsAndDescriptors features =
+        features_and_matches_database_->GetFeatures(image_names[i]);
+    // Extract the global descriptors
+    (*global_descriptors)[i] =
+        global_image_descriptor_extractor_->ExtractGlobalDescriptor(
+            features.descriptors);
+  });
 }
 
 void FeatureExtractorAndMatcher::
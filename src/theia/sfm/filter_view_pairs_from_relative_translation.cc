@@ -195,7 +195,8 @@ void ComputeMeanVariance(
 }
 
 // Performs a single iterations of the translation filtering. This method is
-// thread-safe.
+// thread-safe as long as each iteration is given its own random number
+// generator.
 void TranslationFilteringIteration(
     const std::unordered_map<ViewIdPair, Vector3d>& relative_translations,
     const Vector3d& direction_mean,
@@ -203,21 +204,11 @@ void TranslationFilteringIteration(
     const std::shared_ptr<RandomNumberGenerator>& rng,
     std::mutex* mutex,
     std::unordered_map<ViewIdPair, double>* bad_edge_weight) {
-  // Create the random number generator within each thread. If the random number
-  // generator is not supplied then create a new one within each thread.
-  std::shared_ptr<RandomNumberGenerator> local_rng;
-  if (rng.get() == nullptr) {
-    local_rng = std::make_shared<RandomNumberGenerator>();
-  } else {
-    local_rng = rng;
-  }
-
   // Get a random vector to project all relative translations on to.
   const Vector3d random_axis =
-      Vector3d(
-          local_rng->RandGaussian(direction_mean[0], direction_variance[0]),
-          local_rng->RandGaussian(direction_mean[1], direction_variance[1]),
-          local_rng->RandGaussian(direction_mean[2], direction_variance[2]))
+      Vector3d(rng->RandGaussian(direction_mean[0], direction_variance[0]),
+               rng->RandGaussian(direction_mean[1], direction_variance[1]),
+               rng->RandGaussian(direction_mean[2], direction_variance[2]))
           .normalized();
 
   // Project all vectors.
@@ -275,19 +266,27 @@ void FilterViewPairsFromRelativeTranslation(
   ComputeMeanVariance(
       rotated_translations, &translation_mean, &translation_variance);
 
-  std::unique_ptr<ThreadPool> pool(new ThreadPool(options.num_threads));
-  std::mutex mutex;
+  // Random number generators are not thread-safe, so each iteration draws
+  // from its own independent stream. If a generator is supplied, the streams
+  // are split from it so that the results are reproducible.
+  std::vector<std::shared_ptr<RandomNumberGenerator> > iteration_rngs(
+      options.num_iterations);
   for (int i = 0; i < options.num_iterations; i++) {
-    pool->Add(TranslationFilteringIteration,
-              rotated_translations,
-              translation_mean,
-              translation_variance,
-              options.rng,
-              &mutex,
-              &bad_edge_weight);
+    iteration_rngs[i] =
+        options.rng.get() == nullptr
+            ? std::make_shared<RandomNumberGenerator>()
+            : std::make_shared<RandomNumberGenerator>(options.rng->Split());
   }
-  // Wait for tasks to finish.
-  pool.reset(nullptr);
+
+  std::mutex mutex;
+  ParallelFor(options.num_threads, options.num_iterations, [&](const int i) {
+    TranslationFilteringIteration(rotated_translations,
+                                  translation_mean,
+                                  translation_variance,
+                                  iteration_rngs[i],
+                                  &mutex,
+                                  &bad_edge_weight);
+  });
 
   // Remove all the bad edges.
   const double max_aggregated_projection_tolerance =
@@ -44,6 +44,7 @@
 #include "theia/sfm/global_pose_estimation/rotation_estimator_util.h"
 #include "theia/sfm/types.h"
 #include "theia/util/map_util.h"
+#include "theia/util/threadpool.h"
 #include "theia/util/timer.h"
 
 namespace theia {
@@ -116,13 +117,12 @@ bool IRLSRotationLocalRefiner::SolveIRLS(
   for (int i = 0; i < options_.max_num_irls_iterations; i++) {
     // Compute the Huber-like weights for each error term.
     const double& sigma = options_.irls_loss_parameter_sigma;
-#pragma omp parallel for num_threads(options_.num_threads)
-    for (int k = 0; k < num_edges; ++k) {
+    ParallelFor(options_.num_threads, num_edges, [&](const int k) {
       double e_sq = tangent_space_residual_.segment<3>(3 * k).squaredNorm();
       double tmp = e_sq + sigma * sigma;
       double w = sigma / (tmp * tmp);
       weights.segment<3>(3 * k).setConstant(w);
-    }
+    });
 
     // Update the factorization for the weighted values.
     at_weight = sparse_matrix_.transpose() * weights.matrix().asDiagonal();
@@ -36,7 +36,6 @@
 
 #include <ceres/rotation.h>
 #include <glog/logging.h>
-#include <omp.h>
 
 #include <Eigen/Eigenvalues>
 #include <Eigen/QR>
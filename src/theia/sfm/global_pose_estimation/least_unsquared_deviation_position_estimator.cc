@@ -85,7 +85,130 @@ bool LeastUnsquaredDeviationPositionEstimator::EstimatePositions(
   // Set up the linear system.
   SetupConstraintMatrix(view_pairs, orientations);
   Eigen::VectorXd solution;
-  solution.setZero(constraint_matrix_.cols());
+  SolveConstraintMatrix(num_views, num_view_pairs, &solution);
+
+  // Set the estimated positions.
+  for (const auto& view_id_index : view_id_to_index_) {
+    const int index = view_id_index.second;
+    const ViewId view_id = view_id_index.first;
+    if (index == kConstantViewIndex) {
+      (*positions)[view_id] = Eigen::Vector3d::Zero();
+    } else {
+      (*positions)[view_id] = solution.segment<3>(index);
+    }
+  }
+
+  return true;
+}
+
+bool LeastUnsquaredDeviationPositionEstimator::EstimatePositions(
+    const CompactViewGraph& view_graph,
+    const std::unordered_map<ViewId, Vector3d>& orientations,
+    std::unordered_map<ViewId, Vector3d>* positions) {
+  CHECK_NOTNULL(positions)->clear();
+
+  std::vector<const Vector3d*> view_orientations(view_graph.NumViews(),
+                                                 nullptr);
+  for (int i = 0; i < view_graph.NumViews(); i++) {
+    view_orientations[i] =
+        FindOrNull(orientations, view_graph.ViewIdFromIndex(i));
+  }
+
+  // Only the view pairs where both views have an orientation are valid.
+  std::vector<int> edges;
+  edges.reserve(view_graph.NumEdges());
+  std::vector<bool> is_constrained(view_graph.NumViews(), false);
+  for (int i = 0; i < view_graph.NumEdges(); i++) {
+    const int view_index1 = view_graph.ViewIndex1(i);
+    const int view_index2 = view_graph.ViewIndex2(i);
+    if (view_orientations[view_index1] != nullptr &&
+        view_orientations[view_index2] != nullptr) {
+      edges.emplace_back(i);
+      is_constrained[view_index1] = true;
+      is_constrained[view_index2] = true;
+    }
+  }
+  const int num_view_pairs = edges.size();
+
+  // Only views that appear in at least one valid view pair take part in the
+  // problem, so that every variable is constrained. The first of these views
+  // is held constant at the origin.
+  const int kInvalidSystemIndex = std::numeric_limits<int>::min();
+  std::vector<int> system_index(view_graph.NumViews(), kInvalidSystemIndex);
+  int index = kConstantViewIndex;
+  for (int i = 0; i < view_graph.NumViews(); i++) {
+    if (is_constrained[i]) {
+      system_index[i] = index;
+      index += 3;
+    }
+  }
+  const int num_views = (index - kConstantViewIndex) / 3;
+  if (num_views == 0) {
+    return false;
+  }
+
+  // Add the camera to camera constraints. The scale of each view pair follows
+  // the view positions in the linear system.
+  constraint_matrix_.resize(3 * num_view_pairs,
+                            3 * (num_views - 1) + num_view_pairs);
+  std::vector<Eigen::Triplet<double> > triplet_list;
+  triplet_list.reserve(9 * num_view_pairs);
+  for (int i = 0; i < num_view_pairs; i++) {
+    const int edge = edges[i];
+    const int row = 3 * i;
+    const int view1_index = system_index[view_graph.ViewIndex1(edge)];
+    const int view2_index = system_index[view_graph.ViewIndex2(edge)];
+    const int scale_index = index + i;
+
+    // Rotate the relative translation so that it is aligned to the global
+    // orientation frame.
+    const Vector3d translation_direction = GetRotatedTranslation(
+        *view_orientations[view_graph.ViewIndex1(edge)],
+        view_graph.RelativePosition(edge));
+
+    // Add the constraint:
+    //   position2 - position1 - scale_1_2 * translation_direction.
+    if (view1_index != kConstantViewIndex) {
+      triplet_list.emplace_back(row + 0, view1_index + 0, -1.0);
+      triplet_list.emplace_back(row + 1, view1_index + 1, -1.0);
+      triplet_list.emplace_back(row + 2, view1_index + 2, -1.0);
+    }
+    if (view2_index != kConstantViewIndex) {
+      triplet_list.emplace_back(row + 0, view2_index + 0, 1.0);
+      triplet_list.emplace_back(row + 1, view2_index + 1, 1.0);
+      triplet_list.emplace_back(row + 2, view2_index + 2, 1.0);
+    }
+    triplet_list.emplace_back(row + 0, scale_index, -translation_direction[0]);
+    triplet_list.emplace_back(row + 1, scale_index, -translation_direction[1]);
+    triplet_list.emplace_back(row + 2, scale_index, -translation_direction[2]);
+  }
+  constraint_matrix_.setFromTriplets(triplet_list.begin(), triplet_list.end());
+
+  Eigen::VectorXd solution;
+  SolveConstraintMatrix(num_views, num_view_pairs, &solution);
+
+  // Set the estimated positions.
+  positions->reserve(num_views);
+  for (int i = 0; i < view_graph.NumViews(); i++) {
+    if (system_index[i] == kInvalidSystemIndex) {
+      continue;
+    }
+    const ViewId view_id = view_graph.ViewIdFromIndex(i);
+    if (system_index[i] == kConstantViewIndex) {
+      (*positions)[view_id] = Eigen::Vector3d::Zero();
+    } else {
+      (*positions)[view_id] = solution.segment<3>(system_index[i]);
+    }
+  }
+
+  return true;
+}
+
+void LeastUnsquaredDeviationPositionEstimator::SolveConstraintMatrix(
+    const int num_views,
+    const int num_view_pairs,
+    Eigen::VectorXd* solution) {
+  solution->setZero(constraint_matrix_.cols());
 
   // Create the lower bound constraint enforcing that all scales are > 1.
   Eigen::SparseMatrix<double> geq_mat(num_view_pairs,
@@ -100,24 +223,25 @@ bool LeastUnsquaredDeviationPositionEstimator::EstimatePositions(
   b.setZero();
 
   // Solve for camera positions by solving a constrained L1 problem to enforce
-  // all relative translations scales > 1.
+  // all relative translations scales > 1. Each outer iteration runs at most
+  // max_num_iterations ADMM iterations and continues from the state of the
+  // previous one, until ADMM converges or the solution stops changing.
   ConstrainedL1Solver::Options l1_options;
+  l1_options.max_num_iterations = options_.max_num_iterations;
+  l1_options.num_threads = options_.num_threads;
+  l1_options.warm_start = true;
   ConstrainedL1Solver solver(
       l1_options, constraint_matrix_, b, geq_mat, geq_vec);
-  solver.Solve(&solution);
-
-  // Set the estimated positions.
-  for (const auto& view_id_index : view_id_to_index_) {
-    const int index = view_id_index.second;
-    const ViewId view_id = view_id_index.first;
-    if (index == kConstantViewIndex) {
-      (*positions)[view_id] = Eigen::Vector3d::Zero();
-    } else {
-      (*positions)[view_id] = solution.segment<3>(index);
+  Eigen::VectorXd previous_solution;
+  for (int i = 0; i < options_.max_num_reweighted_iterations; i++) {
+    previous_solution = *solution;
+    solver.Solve(solution);
+    if (solver.NumIterations() < l1_options.max_num_iterations ||
+        (*solution - previous_solution).norm() <=
+            options_.convergence_criterion * solution->norm()) {
+      break;
     }
   }
-
-  return true;
 }
 
 void LeastUnsquaredDeviationPositionEstimator::InitializeIndexMapping(
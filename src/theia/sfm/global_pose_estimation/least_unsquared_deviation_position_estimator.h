@@ -58,14 +58,20 @@ class TwoViewInfo;
 class LeastUnsquaredDeviationPositionEstimator : public PositionEstimator {
  public:
   struct Options {
-    // Options for ADMM QP solver.
+    // Maximum number of ADMM iterations of each outer iteration.
     int max_num_iterations = 400;
 
-    // Maximum number of reweighted iterations.
+    // Maximum number of outer iterations. Each outer iteration continues the
+    // ADMM solve of the previous one.
     int max_num_reweighted_iterations = 10;
 
-    // A measurement for convergence criterion.
+    // The outer iterations stop once the relative change of the solution is
+    // below this threshold.
     double convergence_criterion = 1e-4;
+
+    // Number of threads used for the sparse matrix-vector products of the
+    // constrained L1 solver.
+    int num_threads = 1;
   };
 
   LeastUnsquaredDeviationPositionEstimator(
@@ -78,6 +84,13 @@ class LeastUnsquaredDeviationPositionEstimator : public PositionEstimator {
       const std::unordered_map<ViewId, Eigen::Vector3d>& orientation,
       std::unordered_map<ViewId, Eigen::Vector3d>* positions);
 
+  // Same as above, but the constraints are set up directly from the dense view
+  // indices and edge arrays of the compact view graph.
+  bool EstimatePositions(
+      const CompactViewGraph& view_graph,
+      const std::unordered_map<ViewId, Eigen::Vector3d>& orientation,
+      std::unordered_map<ViewId, Eigen::Vector3d>* positions);
+
   // python
   std::unordered_map<ViewId, Eigen::Vector3d> EstimatePositionsWrapper(
       const std::unordered_map<ViewIdPair, TwoViewInfo>& view_pairs,
@@ -93,6 +106,12 @@ class LeastUnsquaredDeviationPositionEstimator : public PositionEstimator {
       const std::unordered_map<ViewIdPair, TwoViewInfo>& view_pairs,
       const std::unordered_map<ViewId, Eigen::Vector3d>& orientations);
 
+  // Solves the constrained L1 problem given by the constraint matrix such that
+  // all relative translation scales are > 1.
+  void SolveConstraintMatrix(const int num_views,
+                             const int num_view_pairs,
+                             Eigen::VectorXd* solution);
+
   const LeastUnsquaredDeviationPositionEstimator::Options options_;
 
   std::unordered_map<ViewIdPair, int> view_id_pair_to_index_;
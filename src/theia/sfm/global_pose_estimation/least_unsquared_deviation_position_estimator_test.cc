@@ -50,6 +50,8 @@
 #include "theia/sfm/track.h"
 #include "theia/sfm/transformation/align_point_clouds.h"
 #include "theia/sfm/types.h"
+#include "theia/sfm/view_graph/compact_view_graph.h"
+#include "theia/sfm/view_graph/view_graph.h"
 #include "theia/util/map_util.h"
 #include "theia/util/random.h"
 #include "theia/util/stringprintf.h"
@@ -148,6 +150,55 @@ class EstimatePositionsLeastUnsquaredDeviationTest : public ::testing::Test {
     }
   }
 
+  // Estimates the positions from a CompactViewGraph snapshot of the view pairs
+  // and checks that they match the positions that are estimated from the view
+  // pairs directly. An extra view that only shares a view pair with a view
+  // without orientation must not be part of the problem.
+  void TestCompactViewGraphOverload(const int num_views,
+                                    const int num_view_pairs,
+                                    const double pose_noise) {
+    SetupScene(num_views);
+    GetTwoViewInfos(num_view_pairs, pose_noise);
+
+    const ViewId kUnorientedViewId = num_views;
+    const ViewId kUnconstrainedViewId = num_views + 1;
+    orientations_[kUnconstrainedViewId] = 0.2 * rng.RandVector3d();
+    ViewGraph view_graph;
+    for (const auto& view_pair : view_pairs_) {
+      view_graph.AddEdge(
+          view_pair.first.first, view_pair.first.second, view_pair.second);
+    }
+    view_graph.AddEdge(0, kUnorientedViewId, view_pairs_.begin()->second);
+    view_graph.AddEdge(
+        kUnorientedViewId, kUnconstrainedViewId, view_pairs_.begin()->second);
+    const CompactViewGraph compact_view_graph(view_graph);
+
+    LeastUnsquaredDeviationPositionEstimator position_estimator(options_);
+    std::unordered_map<ViewId, Vector3d> expected_positions;
+    EXPECT_TRUE(position_estimator.EstimatePositions(
+        view_pairs_, orientations_, &expected_positions));
+    std::unordered_map<ViewId, Vector3d> estimated_positions;
+    EXPECT_TRUE(position_estimator.EstimatePositions(
+        compact_view_graph, orientations_, &estimated_positions));
+    EXPECT_EQ(estimated_positions.size(), positions_.size());
+    EXPECT_FALSE(ContainsKey(estimated_positions, kUnorientedViewId));
+    EXPECT_FALSE(ContainsKey(estimated_positions, kUnconstrainedViewId));
+
+    // The gauge of the two solutions may differ, so both are aligned to the
+    // ground truth before they are compared.
+    static const double kTolerance = 1e-4;
+    AlignPositions(positions_, &expected_positions);
+    AlignPositions(positions_, &estimated_positions);
+    for (const auto& position : expected_positions) {
+      const Vector3d& estimated_position =
+          FindOrDie(estimated_positions, position.first);
+      EXPECT_LT((position.second - estimated_position).norm(), kTolerance)
+          << "\nview pairs position = " << position.second.transpose()
+          << "\ncompact view graph position = "
+          << estimated_position.transpose();
+    }
+  }
+
  protected:
   void SetUp() {}
 
@@ -232,4 +283,18 @@ TEST_F(EstimatePositionsLeastUnsquaredDeviationTest, SmallTestWithNoise) {
       kNumViews, kNumViewPairs, kPoseNoiseDegrees, kTolerance);
 }
 
+TEST_F(EstimatePositionsLeastUnsquaredDeviationTest, CompactViewGraphNoNoise) {
+  static const int kNumViews = 8;
+  static const int kNumViewPairs = 20;
+  TestCompactViewGraphOverload(kNumViews, kNumViewPairs, 0.0);
+}
+
+TEST_F(EstimatePositionsLeastUnsquaredDeviationTest,
+       CompactViewGraphWithNoise) {
+  static const int kNumViews = 8;
+  static const int kNumViewPairs = 20;
+  static const double kPoseNoiseDegrees = 1.0;
+  TestCompactViewGraphOverload(kNumViews, kNumViewPairs, kPoseNoiseDegrees);
+}
+
 }  // namespace theia
@@ -176,16 +176,13 @@ bool LinearPositionEstimator::EstimatePositions(
   VLOG(2) << "Determining baseline ratios within each triplet...";
   // Baselines where (x, y, z) corresponds to the baseline of the first,
   // second, and third view pair in the triplet.
-  std::unique_ptr<ThreadPool> pool(new ThreadPool(options_.num_threads));
   baselines_.resize(triplets_.size());
   for (size_t i = 0; i < triplets_.size(); i++) {
     AddTripletConstraint(triplets_[i]);
-    pool->Add(&LinearPositionEstimator::ComputeBaselineRatioForTriplet,
-              this,
-              triplets_[i],
-              &baselines_[i]);
   }
-  pool.reset(nullptr);
+  ParallelFor(options_.num_threads, triplets_.size(), [&](const int i) {
+    ComputeBaselineRatioForTriplet(triplets_[i], &baselines_[i]);
+  });
 
   VLOG(2) << "Building the constraint matrix...";
   // Create the linear system based on triplet constraints.
@@ -48,6 +48,7 @@
 #include "theia/sfm/types.h"
 #include "theia/util/map_util.h"
 #include "theia/util/random.h"
+#include "theia/util/threadpool.h"
 #include "theia/util/util.h"
 
 namespace theia {
@@ -177,7 +178,8 @@ bool NonlinearPositionEstimator::EstimatePositions(
 
   // Set the solver options.
   ceres::Solver::Summary summary;
-  solver_options_.num_threads = options_.num_threads;
+  solver_options_.num_threads =
+      GetNumThreadsForExternalSolver(options_.num_threads);
   solver_options_.max_num_iterations = options_.max_num_iterations;
 
   // Choose the type of linear solver. For sufficiently large problems, we want
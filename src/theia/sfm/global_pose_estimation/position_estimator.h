@@ -40,6 +40,7 @@
 
 #include "theia/sfm/twoview_info.h"
 #include "theia/sfm/types.h"
+#include "theia/sfm/view_graph/compact_view_graph.h"
 #include "theia/util/util.h"
 
 namespace theia {
@@ -66,6 +67,19 @@ class PositionEstimator {
       const std::unordered_map<ViewId, Eigen::Vector3d>& orientation,
       std::unordered_map<ViewId, Eigen::Vector3d>* positions) = 0;
 
+  // Same as above, but takes the relative translations from a compact snapshot
+  // of the view graph. Estimators that can operate on the dense view indices of
+  // the snapshot should override this method. By default the view pairs are
+  // recreated from the snapshot.
+  virtual bool EstimatePositions(
+      const CompactViewGraph& view_graph,
+      const std::unordered_map<ViewId, Eigen::Vector3d>& orientation,
+      std::unordered_map<ViewId, Eigen::Vector3d>* positions) {
+    std::unordered_map<ViewIdPair, TwoViewInfo> view_pairs;
+    view_graph.GetViewPairs(&view_pairs);
+    return EstimatePositions(view_pairs, orientation, positions);
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(PositionEstimator);
 };
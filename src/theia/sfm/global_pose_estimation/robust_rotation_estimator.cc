@@ -37,12 +37,15 @@
 #include <Eigen/Core>
 #include <Eigen/SparseCore>
 #include <ceres/rotation.h>
+#include <algorithm>
 #include <unordered_map>
+#include <vector>
 
 #include "theia/math/l1_solver.h"
 #include "theia/math/matrix/sparse_cholesky_llt.h"
 #include "theia/math/rotation.h"
 #include "theia/sfm/types.h"
+#include "theia/sfm/view_graph/compact_view_graph.h"
 #include "theia/util/hash.h"
 #include "theia/util/map_util.h"
 
@@ -68,31 +71,103 @@ bool RobustRotationEstimator::EstimateRotations(
   CHECK_GT(relative_rotations_.size(), 0)
       << "Relative rotation constraints must be added to the robust rotation "
          "solver before estimating global rotations.";
-  global_orientations_ = CHECK_NOTNULL(global_orientations);
+  CHECK_NOTNULL(global_orientations);
 
   if (fixed_view_ids_.size() == 0) {
     // just set the first rotation fix
     fixed_view_ids_.insert(std::begin(*global_orientations)->first);
     nr_fixed_rotations_ = 1;
   }
-  // Compute a mapping of view ids to indices in the linear system. One rotation
-  // will have an index of -1 and will not be added to the linear system. This
-  // will remove the gauge freedom (effectively holding one camera as the
-  // identity rotation).
-  int index = 0;
-  int fix_index = -nr_fixed_rotations_;
-  view_id_to_index_.reserve(global_orientations->size());
+
+  // Assign a dense index to each view so that the view ids only need to be
+  // looked up once when setting up the problem.
+  std::unordered_map<ViewId, int> view_id_to_index;
+  view_id_to_index.reserve(global_orientations->size());
+  view_ids_.clear();
+  view_ids_.reserve(global_orientations->size());
+  global_orientations_.clear();
+  global_orientations_.reserve(global_orientations->size());
   for (const auto& orientation : *global_orientations) {
-      if (fixed_view_ids_.find(orientation.first) == fixed_view_ids_.end()) {
-          view_id_to_index_[orientation.first] = index;
-          ++index;
-      } else {
-          view_id_to_index_[orientation.first] = fix_index;
-          ++fix_index;
-      }
+    view_id_to_index[orientation.first] = view_ids_.size();
+    view_ids_.emplace_back(orientation.first);
+    global_orientations_.emplace_back(orientation.second);
+  }
+
+  constraint_view_indices_.clear();
+  constraint_view_indices_.reserve(relative_rotations_.size());
+  constraint_rotations_.clear();
+  constraint_rotations_.reserve(relative_rotations_.size());
+  for (const auto& relative_rotation : relative_rotations_) {
+    constraint_view_indices_.emplace_back(
+        FindOrDie(view_id_to_index, relative_rotation.first.first),
+        FindOrDie(view_id_to_index, relative_rotation.first.second));
+    constraint_rotations_.emplace_back(relative_rotation.second);
+  }
+
+  if (!SolveRotations()) {
+    return false;
+  }
+
+  for (int i = 0; i < view_ids_.size(); i++) {
+    (*global_orientations)[view_ids_[i]] = global_orientations_[i];
+  }
+  return true;
+}
+
+bool RobustRotationEstimator::EstimateRotations(
+    const CompactViewGraph& view_graph,
+    std::unordered_map<ViewId, Eigen::Vector3d>* global_orientations) {
+  CHECK_GT(view_graph.NumEdges(), 0)
+      << "The view graph must contain relative rotation constraints before "
+         "estimating global rotations.";
+  CHECK_NOTNULL(global_orientations);
+
+  // The dense view indices of the snapshot are used as is.
+  view_ids_ = view_graph.ViewIds();
+  global_orientations_.resize(view_ids_.size());
+  for (int i = 0; i < view_ids_.size(); i++) {
+    global_orientations_[i] = FindOrDie(*global_orientations, view_ids_[i]);
+  }
+
+  if (fixed_view_ids_.size() == 0) {
+    // just set the first rotation fix
+    fixed_view_ids_.insert(view_ids_[0]);
+    nr_fixed_rotations_ = 1;
+  }
+
+  constraint_view_indices_.resize(view_graph.NumEdges());
+  for (int i = 0; i < view_graph.NumEdges(); i++) {
+    constraint_view_indices_[i].first = view_graph.ViewIndex1(i);
+    constraint_view_indices_[i].second = view_graph.ViewIndex2(i);
+  }
+  constraint_rotations_ = view_graph.RelativeRotations();
+
+  if (!SolveRotations()) {
+    return false;
+  }
+
+  for (int i = 0; i < view_ids_.size(); i++) {
+    (*global_orientations)[view_ids_[i]] = global_orientations_[i];
+  }
+  return true;
+}
+
+bool RobustRotationEstimator::SolveRotations() {
+  // Compute a mapping of view indices to indices in the linear system. The
+  // fixed rotations will have an index of kConstantRotationIndex and will not
+  // be added to the linear system. This will remove the gauge freedom
+  // (effectively holding the fixed cameras constant).
+  int index = 0;
+  view_index_to_system_index_.resize(view_ids_.size());
+  for (int i = 0; i < view_ids_.size(); i++) {
+    if (fixed_view_ids_.find(view_ids_[i]) == fixed_view_ids_.end()) {
+      view_index_to_system_index_[i] = index;
+      ++index;
+    } else {
+      view_index_to_system_index_[i] = kConstantRotationIndex;
+    }
   }
 
-  Eigen::SparseMatrix<double> sparse_mat;
   SetupLinearSystem();
 
   if (!SolveL1Regression()) {
@@ -110,53 +185,38 @@ bool RobustRotationEstimator::EstimateRotations(
 
 // Set up the sparse linear system.
 void RobustRotationEstimator::SetupLinearSystem() {
-  // The rotation change is one less than the number of global rotations because
-  // we keep one rotation constant.
-  tangent_space_step_.resize((global_orientations_->size() - nr_fixed_rotations_) * 3);
-  tangent_space_residual_.resize(relative_rotations_.size() * 3);
-  sparse_matrix_.resize(relative_rotations_.size() * 3,
-                        (global_orientations_->size() - nr_fixed_rotations_) * 3);
+  // The rotation change has one entry per rotation that is not held constant.
+  const int num_free_rotations =
+      std::count_if(view_index_to_system_index_.begin(),
+                    view_index_to_system_index_.end(),
+                    [](const int index) { return index >= 0; });
+  const int num_constraints = constraint_view_indices_.size();
+  tangent_space_step_.resize(num_free_rotations * 3);
+  tangent_space_residual_.resize(num_constraints * 3);
+  sparse_matrix_.resize(num_constraints * 3, num_free_rotations * 3);
 
   // For each relative rotation constraint, add an entry to the sparse
   // matrix. We use the first order approximation of angle axis such that:
   // R_ij = R_j - R_i. This makes the sparse matrix just a bunch of identity
   // matrices.
-  int rotation_error_index = 0;
   std::vector<Eigen::Triplet<double> > triplet_list;
-  for (const auto& relative_rotation : relative_rotations_) {
-
-    // see if this rotation should be fixed
-    if (fixed_view_ids_.find(relative_rotation.first.first) == fixed_view_ids_.end()) {
-      const int view1_index =
-        FindOrDie(view_id_to_index_, relative_rotation.first.first);
-
-      triplet_list.emplace_back(3 * rotation_error_index,
-                                3 * view1_index,
-                                -1.0);
-      triplet_list.emplace_back(3 * rotation_error_index + 1,
-                                3 * view1_index + 1,
-                                -1.0);
-      triplet_list.emplace_back(3 * rotation_error_index + 2,
-                                3 * view1_index + 2,
-                                -1.0);
-
+  triplet_list.reserve(6 * num_constraints);
+  for (int i = 0; i < num_constraints; i++) {
+    const int view1_index =
+        view_index_to_system_index_[constraint_view_indices_[i].first];
+    if (view1_index != kConstantRotationIndex) {
+      triplet_list.emplace_back(3 * i + 0, 3 * view1_index + 0, -1.0);
+      triplet_list.emplace_back(3 * i + 1, 3 * view1_index + 1, -1.0);
+      triplet_list.emplace_back(3 * i + 2, 3 * view1_index + 2, -1.0);
     }
-    if (fixed_view_ids_.find(relative_rotation.first.second) == fixed_view_ids_.end())  {
-      const int view2_index =
-        FindOrDie(view_id_to_index_, relative_rotation.first.second);
-      triplet_list.emplace_back(3 * rotation_error_index + 0,
-                                3 * view2_index + 0,
-                                1.0);
-      triplet_list.emplace_back(3 * rotation_error_index + 1,
-                                3 * view2_index + 1,
-                                1.0);
-      triplet_list.emplace_back(3 * rotation_error_index + 2,
-                                3 * view2_index + 2,
-                                1.0);
 
+    const int view2_index =
+        view_index_to_system_index_[constraint_view_indices_[i].second];
+    if (view2_index != kConstantRotationIndex) {
+      triplet_list.emplace_back(3 * i + 0, 3 * view2_index + 0, 1.0);
+      triplet_list.emplace_back(3 * i + 1, 3 * view2_index + 1, 1.0);
+      triplet_list.emplace_back(3 * i + 2, 3 * view2_index + 2, 1.0);
     }
-
-    ++rotation_error_index;
   }
   sparse_matrix_.setFromTriplets(triplet_list.begin(), triplet_list.end());
 }
@@ -164,7 +224,12 @@ void RobustRotationEstimator::SetupLinearSystem() {
 bool RobustRotationEstimator::SolveL1Regression() {
   L1Solver<Eigen::SparseMatrix<double> >::Options options;
   options.max_num_iterations = 5;
-  L1Solver<Eigen::SparseMatrix<double> > l1_solver(options, sparse_matrix_);
+  options.num_threads = options_.num_threads;
+  // Each outer iteration solves for a step from the residuals of the previous
+  // step, so the ADMM state of the previous solve is a good initialization.
+  options.warm_start = true;
+  L1Solver<Eigen::SparseMatrix<double> > l1_solver(
+      options, sparse_matrix_, &linear_solver_);
 
   tangent_space_step_.setZero();
   ComputeResiduals();
@@ -189,10 +254,10 @@ bool RobustRotationEstimator::SolveIRLS() {
 
   // Set up the linear solver and analyze the sparsity pattern of the
   // system. Since the sparsity pattern will not change with each linear solve
-  // this can help speed up the solution time.
-  SparseCholeskyLLt linear_solver;
-  linear_solver.AnalyzePattern(sparse_matrix_.transpose() * sparse_matrix_);
-  if (linear_solver.Info() != Eigen::Success) {
+  // this can help speed up the solution time. The analysis of the L1
+  // minimization is reused if it has been computed already.
+  linear_solver_.AnalyzePattern(sparse_matrix_.transpose() * sparse_matrix_);
+  if (linear_solver_.Info() != Eigen::Success) {
     LOG(ERROR) << "Cholesky decomposition failed.";
     return false;
   }
@@ -216,16 +281,16 @@ bool RobustRotationEstimator::SolveIRLS() {
 
     // Update the factorization for the weighted values.
     at_weight = sparse_matrix_.transpose() * weights.matrix().asDiagonal();
-    linear_solver.Factorize(at_weight * sparse_matrix_);
-    if (linear_solver.Info() != Eigen::Success) {
+    linear_solver_.Factorize(at_weight * sparse_matrix_);
+    if (linear_solver_.Info() != Eigen::Success) {
       LOG(ERROR) << "Failed to factorize the least squares system.";
       return false;
     }
 
     // Solve the least squares problem..
     tangent_space_step_ =
-        linear_solver.Solve(at_weight * tangent_space_residual_);
-    if (linear_solver.Info() != Eigen::Success) {
+        linear_solver_.Solve(at_weight * tangent_space_residual_);
+    if (linear_solver_.Info() != Eigen::Success) {
       LOG(ERROR) << "Failed to solve the least squares system.";
       return false;
     }
@@ -250,36 +315,35 @@ bool RobustRotationEstimator::SolveIRLS() {
 // Update the global orientations using the current value in the
 // rotation_change.
 void RobustRotationEstimator::UpdateGlobalRotations() {
-  for (auto& rotation : *global_orientations_) {
-    if (fixed_view_ids_.find(rotation.first) != fixed_view_ids_.end()) {
+  for (int i = 0; i < global_orientations_.size(); i++) {
+    const int system_index = view_index_to_system_index_[i];
+    if (system_index == kConstantRotationIndex) {
       continue;
     }
 
-    const int view_index = FindOrDie(view_id_to_index_, rotation.first);
     // Apply the rotation change to the global orientation.
     const Eigen::Vector3d& rotation_change =
-        tangent_space_step_.segment<3>(3 * view_index);
-    rotation.second = MultiplyRotations(rotation.second, rotation_change);
+        tangent_space_step_.segment<3>(3 * system_index);
+    global_orientations_[i] =
+        MultiplyRotations(global_orientations_[i], rotation_change);
   }
 }
 
 // Computes the relative rotation error based on the current global
 // orientation estimates.
 void RobustRotationEstimator::ComputeResiduals() {
-  int rotation_error_index = 0;
-  for (const auto& relative_rotation : relative_rotations_) {
-    const Eigen::Vector3d& relative_rotation_aa = relative_rotation.second;
+  for (int i = 0; i < constraint_view_indices_.size(); i++) {
+    const Eigen::Vector3d& relative_rotation_aa = constraint_rotations_[i];
     const Eigen::Vector3d& rotation1 =
-        FindOrDie(*global_orientations_, relative_rotation.first.first);
+        global_orientations_[constraint_view_indices_[i].first];
     const Eigen::Vector3d& rotation2 =
-        FindOrDie(*global_orientations_, relative_rotation.first.second);
+        global_orientations_[constraint_view_indices_[i].second];
 
     // Compute the relative rotation error as:
     //   R_err = R2^t * R_12 * R1.
-    tangent_space_residual_.segment<3>(3 * rotation_error_index) =
+    tangent_space_residual_.segment<3>(3 * i) =
         MultiplyRotations(-rotation2,
                           MultiplyRotations(relative_rotation_aa, rotation1));
-    ++rotation_error_index;
   }
 }
 
@@ -40,9 +40,11 @@
 #include <unordered_map>
 #include <set>
 
+#include "theia/math/matrix/sparse_cholesky_llt.h"
 #include "theia/math/util.h"
 #include "theia/sfm/global_pose_estimation/rotation_estimator.h"
 #include "theia/sfm/types.h"
+#include "theia/sfm/view_graph/compact_view_graph.h"
 #include "theia/util/hash.h"
 
 namespace theia {
@@ -80,6 +82,10 @@ class RobustRotationEstimator : public RotationEstimator {
     // This is the point where the Huber-like cost function switches from L1 to
     // L2.
     double irls_loss_parameter_sigma = DegToRad(5.0);
+
+    // Number of threads used for the sparse matrix-vector products of the L1
+    // minimization.
+    int num_threads = 1;
   };
 
   explicit RobustRotationEstimator(const Options& options)
@@ -116,11 +122,25 @@ class RobustRotationEstimator : public RotationEstimator {
   bool EstimateRotations(
       std::unordered_map<ViewId, Eigen::Vector3d>* global_orientations); 
 
+  // Estimates the global orientations of all views in the compact view graph
+  // based on an initial guess. The dense view indices and edge arrays of the
+  // snapshot are used directly, so no view id lookups are performed while
+  // solving. Orientations of views that are not in the view graph are left
+  // unchanged.
+  bool EstimateRotations(
+      const CompactViewGraph& view_graph,
+      std::unordered_map<ViewId, Eigen::Vector3d>* global_orientations);
+
   // With this function multiple views can be set to constant during estimation 
   // (e.g. keyframes in incremental estimation)
   void SetFixedGlobalRotations(const std::set<ViewId>& fixed_views);
 
  protected:
+  // Assigns the linear system index of each view and solves for the global
+  // orientations. The dense orientations and rotation constraints must be set
+  // before calling this method.
+  bool SolveRotations();
+
   // Sets up the sparse linear system such that dR_ij = dR_j - dR_i. This is the
   // first-order approximation of the angle-axis rotations. This should only be
   // called once.
@@ -154,13 +174,20 @@ class RobustRotationEstimator : public RotationEstimator {
   // The pairwise relative rotations used to compute the global rotations.
   std::vector<std::pair<ViewIdPair, Eigen::Vector3d> > relative_rotations_;
 
-  // The global orientation estimates for each camera.
-  std::unordered_map<ViewId, Eigen::Vector3d>* global_orientations_;
+  // The view ids and global orientation estimates of the views in the problem,
+  // indexed by a dense view index.
+  std::vector<ViewId> view_ids_;
+  std::vector<Eigen::Vector3d> global_orientations_;
+
+  // The position of each view's orientation in the linear system, indexed by
+  // the dense view index. Fixed views have an index of kConstantRotationIndex.
+  std::vector<int> view_index_to_system_index_;
+
+  // The rotation constraints as pairs of dense view indices along with the
+  // relative rotation between the two views.
+  std::vector<std::pair<int, int> > constraint_view_indices_;
+  std::vector<Eigen::Vector3d> constraint_rotations_;
 
-  // Map of ViewIds to the corresponding positions of the view's orientation in
-  // the linear system.
-  std::unordered_map<ViewId, int> view_id_to_index_;
-  
   // The sparse matrix used to maintain the linear system. This is matrix A in
   // Ax = b.
   Eigen::SparseMatrix<double> sparse_matrix_;
@@ -171,6 +198,11 @@ class RobustRotationEstimator : public RotationEstimator {
   // b in the linear system Ax = b.
   Eigen::VectorXd tangent_space_residual_;
 
+  // The Cholesky solver shared by the L1 minimization and the IRLS. The normal
+  // equations of both stages have the same sparsity pattern, so the symbolic
+  // analysis is only computed once.
+  SparseCholeskyLLt linear_solver_;
+
   // Set all view_ids that we would like to fix during estimation, e.g. for incremental estimation
   std::set<ViewId> fixed_view_ids_;
 
@@ -44,6 +44,8 @@
 #include "theia/sfm/global_pose_estimation/robust_rotation_estimator.h"
 #include "theia/sfm/transformation/align_rotations.h"
 #include "theia/sfm/types.h"
+#include "theia/sfm/view_graph/compact_view_graph.h"
+#include "theia/sfm/view_graph/view_graph.h"
 #include "theia/util/map_util.h"
 #include "theia/util/random.h"
 #include "gtest/gtest.h"
@@ -101,6 +103,55 @@ class EstimateRotationsRobustTest : public ::testing::Test {
     }
   }
 
+  // Checks that estimating the rotations from a CompactViewGraph snapshot of
+  // the view pairs gives the same rotations as estimating them from the view
+  // pairs directly.
+  void TestCompactViewGraphOverload(const int num_views,
+                                    const int num_view_pairs,
+                                    const double rotation_noise,
+                                    const int nr_fix_views) {
+    CreateGTOrientations(num_views);
+    GetRelativeRotations(num_view_pairs, rotation_noise);
+    ViewGraph view_graph;
+    for (const auto& view_pair : view_pairs_) {
+      view_graph.AddEdge(
+          view_pair.first.first, view_pair.first.second, view_pair.second);
+    }
+    const CompactViewGraph compact_view_graph(view_graph);
+
+    std::set<ViewId> fixed_views;
+    for (int i = 0; i < nr_fix_views; ++i) {
+      fixed_views.insert(i);
+    }
+    std::unordered_map<ViewId, Vector3d> expected_rotations;
+    InitializeRotationsFromSpanningTree(&expected_rotations);
+    std::unordered_map<ViewId, Vector3d> estimated_rotations =
+        expected_rotations;
+
+    RobustRotationEstimator::Options options;
+    RobustRotationEstimator rotation_estimator(options);
+    rotation_estimator.SetFixedGlobalRotations(fixed_views);
+    EXPECT_TRUE(rotation_estimator.EstimateRotations(view_pairs_,
+                                                     &expected_rotations));
+    RobustRotationEstimator compact_rotation_estimator(options);
+    compact_rotation_estimator.SetFixedGlobalRotations(fixed_views);
+    EXPECT_TRUE(compact_rotation_estimator.EstimateRotations(
+        compact_view_graph, &estimated_rotations));
+    EXPECT_EQ(estimated_rotations.size(), expected_rotations.size());
+
+    static const double kToleranceDegrees = 1e-4;
+    for (const auto& rotation : expected_rotations) {
+      const Vector3d& estimated_rotation =
+          FindOrDie(estimated_rotations, rotation.first);
+      const Vector3d relative_rotation = RelativeRotationFromTwoRotations(
+          estimated_rotation, rotation.second, 0.0, rng);
+      EXPECT_LT(RadToDeg(relative_rotation.norm()), kToleranceDegrees)
+          << "\nview pairs rotation = " << rotation.second.transpose()
+          << "\ncompact view graph rotation = "
+          << estimated_rotation.transpose();
+    }
+  }
+
  protected:
   void SetUp() {}
 
@@ -214,5 +265,19 @@ TEST_F(EstimateRotationsRobustTest, LargeTestWithNoiseFixedViews) {
                               kNrFixViews);
 }
 
+TEST_F(EstimateRotationsRobustTest, CompactViewGraphNoNoise) {
+  static const int kNumViews = 4;
+  static const int kNumViewPairs = 6;
+  TestCompactViewGraphOverload(kNumViews, kNumViewPairs, 0.0, 1);
+}
+
+TEST_F(EstimateRotationsRobustTest, CompactViewGraphWithNoiseFixedViews) {
+  static const int kNumViews = 100;
+  static const int kNumViewPairs = 800;
+  static const double kPoseNoiseDegrees = 2.0;
+  static const int kNrFixViews = 5;
+  TestCompactViewGraphOverload(
+      kNumViews, kNumViewPairs, kPoseNoiseDegrees, kNrFixViews);
+}
 
 }  // namespace theia
@@ -40,6 +40,7 @@
 
 #include "theia/sfm/twoview_info.h"
 #include "theia/sfm/types.h"
+#include "theia/sfm/view_graph/compact_view_graph.h"
 #include "theia/util/util.h"
 
 namespace theia {
@@ -60,6 +61,18 @@ class RotationEstimator {
       const std::unordered_map<ViewIdPair, TwoViewInfo>& view_pairs,
       std::unordered_map<ViewId, Eigen::Vector3d>* rotations) = 0;
 
+  // Same as above, but takes the relative rotations from a compact snapshot of
+  // the view graph. Estimators that can operate on the dense view indices of
+  // the snapshot should override this method. By default the view pairs are
+  // recreated from the snapshot.
+  virtual bool EstimateRotations(
+      const CompactViewGraph& view_graph,
+      std::unordered_map<ViewId, Eigen::Vector3d>* rotations) {
+    std::unordered_map<ViewIdPair, TwoViewInfo> view_pairs;
+    view_graph.GetViewPairs(&view_pairs);
+    return EstimateRotations(view_pairs, rotations);
+  }
+
   // virtual std::unordered_map<ViewId, Eigen::Vector3d>
   // EstimateRotationsWrapper(
   //    const std::unordered_map<ViewIdPair, TwoViewInfo>& view_pairs) = 0;
@@ -61,6 +61,7 @@
 #include "theia/sfm/set_camera_intrinsics_from_priors.h"
 #include "theia/sfm/set_outlier_tracks_to_unestimated.h"
 #include "theia/sfm/twoview_info.h"
+#include "theia/sfm/view_graph/compact_view_graph.h"
 #include "theia/sfm/view_graph/orientations_from_maximum_spanning_tree.h"
 #include "theia/sfm/view_graph/remove_disconnected_view_pairs.h"
 #include "theia/sfm/view_graph/view_graph.h"
@@ -120,6 +121,8 @@ GlobalReconstructionEstimator::GlobalReconstructionEstimator(
       options_.num_threads;
   options_.linear_triplet_position_estimator_options.num_threads =
       options_.num_threads;
+  options_.least_unsquared_deviation_position_estimator_options.num_threads =
+      options_.num_threads;
   ransac_params_ = SetRansacParameters(options);
 }
 
@@ -320,7 +323,9 @@ void GlobalReconstructionEstimator::CalibrateCameras() {
 }
 
 bool GlobalReconstructionEstimator::EstimateGlobalRotations() {
-  const auto& view_pairs = view_graph_->GetAllEdges();
+  // Freeze the view graph into a compact snapshot that the rotation estimators
+  // can iterate over with dense view indices.
+  const CompactViewGraph compact_view_graph(*view_graph_);
 
   // Choose the global rotation estimation type.
   std::unique_ptr<RotationEstimator> rotation_estimator;
@@ -330,6 +335,7 @@ bool GlobalReconstructionEstimator::EstimateGlobalRotations() {
       // spanning tree.
       OrientationsFromMaximumSpanningTree(*view_graph_, &orientations_);
       RobustRotationEstimator::Options robust_rotation_estimator_options;
+      robust_rotation_estimator_options.num_threads = options_.num_threads;
       rotation_estimator.reset(
           new RobustRotationEstimator(robust_rotation_estimator_options));
       break;
@@ -363,7 +369,8 @@ bool GlobalReconstructionEstimator::EstimateGlobalRotations() {
     }
   }
 
-  return rotation_estimator->EstimateRotations(view_pairs, &orientations_);
+  return rotation_estimator->EstimateRotations(compact_view_graph,
+                                               &orientations_);
 }
 
 void GlobalReconstructionEstimator::FilterRotations() {
@@ -411,8 +418,9 @@ void GlobalReconstructionEstimator::FilterRelativeTranslation() {
 }
 
 bool GlobalReconstructionEstimator::EstimatePosition() {
-  // Estimate position.
-  const auto& view_pairs = view_graph_->GetAllEdges();
+  // Estimate position. The view graph has been filtered since the rotations
+  // were estimated so a new snapshot is created.
+  const CompactViewGraph compact_view_graph(*view_graph_);
   std::unique_ptr<PositionEstimator> position_estimator;
 
   // Choose the global position estimation type.
@@ -446,7 +454,7 @@ bool GlobalReconstructionEstimator::EstimatePosition() {
   }
 
   return position_estimator->EstimatePositions(
-      view_pairs, orientations_, &positions_);
+      compact_view_graph, orientations_, &positions_);
 }
 
 void GlobalReconstructionEstimator::EstimateStructure() {
@@ -476,7 +484,7 @@ bool GlobalReconstructionEstimator::BundleAdjustment() {
   // job of filtering tracks with outliers that may slow down the nonlinear
   // optimization.
   std::unordered_set<TrackId> tracks_to_optimize;
-  if (options_.subsample_tracks_for_bundle_adjustment &&
+  if (ShouldSubsampleTracksForBundleAdjustment(options_, *reconstruction_) &&
       SelectGoodTracksForBundleAdjustment(
           *reconstruction_,
           options_.track_subset_selection_long_track_length_threshold,
@@ -517,7 +525,7 @@ bool GlobalReconstructionEstimator::BundleAdjustCameraPositionsAndPoints() {
   // reduces the number of parameters in bundle adjustment, and does a decent
   // job of filtering tracks with outliers that may slow down the nonlinear
   // optimization.
-  if (!options_.subsample_tracks_for_bundle_adjustment ||
+  if (!ShouldSubsampleTracksForBundleAdjustment(options_, *reconstruction_) ||
       !SelectGoodTracksForBundleAdjustment(
           *reconstruction_,
           options_.track_subset_selection_long_track_length_threshold,
@@ -134,13 +134,29 @@ HybridReconstructionEstimator::HybridReconstructionEstimator(
   localization_options_.min_num_inliers =
       options_.min_num_absolute_pose_inliers;
 
+  // Track selection options.
+  BundleAdjustmentTrackSelector::Options track_selector_options;
+  track_selector_options.long_track_length_threshold =
+      options_.track_subset_selection_long_track_length_threshold;
+  track_selector_options.image_grid_cell_size_pixels =
+      options_.track_selection_image_grid_cell_size_pixels;
+  track_selector_options.min_num_optimized_tracks_per_view =
+      options_.min_num_optimized_tracks_per_view;
+  track_selector_options.num_threads = options_.num_threads;
+  track_selector_.reset(
+      new BundleAdjustmentTrackSelector(track_selector_options));
+
   num_optimized_views_ = 0;
+  check_all_underconstrained_ = true;
 }
 
 ReconstructionEstimatorSummary HybridReconstructionEstimator::Estimate(
     ViewGraph* view_graph, Reconstruction* reconstruction) {
   reconstruction_ = reconstruction;
   view_graph_ = view_graph;
+  modified_tracks_.clear();
+  check_all_underconstrained_ = true;
+  track_selector_->Clear();
 
   // Initialize the unlocalized_views_ variable.
   const auto& view_ids = reconstruction_->ViewIds();
@@ -319,6 +335,7 @@ bool HybridReconstructionEstimator::EstimateCameraOrientations() {
       CHECK(OrientationsFromMaximumSpanningTree(*view_graph_, &orientations_))
           << "Could not estimate orientations from a spanning tree.";
       RobustRotationEstimator::Options robust_rotation_estimator_options;
+      robust_rotation_estimator_options.num_threads = options_.num_threads;
       rotation_estimator.reset(
           new RobustRotationEstimator(robust_rotation_estimator_options));
       break;
@@ -721,13 +738,8 @@ bool HybridReconstructionEstimator::FullBundleAdjustment() {
   // job of filtering tracks with outliers that may slow down the nonlinear
   // optimization.
   std::unordered_set<TrackId> tracks_to_optimize;
-  if (options_.subsample_tracks_for_bundle_adjustment &&
-      SelectGoodTracksForBundleAdjustment(
-          *reconstruction_,
-          options_.track_subset_selection_long_track_length_threshold,
-          options_.track_selection_image_grid_cell_size_pixels,
-          options_.min_num_optimized_tracks_per_view,
-          &tracks_to_optimize)) {
+  if (ShouldSubsampleTracksForBundleAdjustment(options_, *reconstruction_) &&
+      track_selector_->SelectTracks(*reconstruction_, &tracks_to_optimize)) {
     SetTracksInViewsToUnestimated(
         reconstructed_views_, tracks_to_optimize, reconstruction_);
   } else {
@@ -745,6 +757,9 @@ bool HybridReconstructionEstimator::FullBundleAdjustment() {
                                         reconstruction_);
   num_optimized_views_ = reconstructed_views_.size();
 
+  // All tracks are checked for outliers, so the entire reconstruction is
+  // checked for underconstrained views and tracks as well.
+  check_all_underconstrained_ = true;
   const auto& track_ids = reconstruction_->TrackIds();
   const std::unordered_set<TrackId> all_tracks(track_ids.begin(),
                                                track_ids.end());
@@ -790,15 +805,15 @@ bool HybridReconstructionEstimator::PartialBundleAdjustment() {
   // optimization.
   std::unordered_set<TrackId> tracks_to_optimize;
   if (options_.subsample_tracks_for_bundle_adjustment &&
-      SelectGoodTracksForBundleAdjustment(
-          *reconstruction_,
-          views_to_optimize,
-          options_.track_subset_selection_long_track_length_threshold,
-          options_.track_selection_image_grid_cell_size_pixels,
-          options_.min_num_optimized_tracks_per_view,
-          &tracks_to_optimize)) {
+      track_selector_->SelectTracks(
+          *reconstruction_, views_to_optimize, &tracks_to_optimize)) {
     SetTracksInViewsToUnestimated(
         views_to_optimize, tracks_to_optimize, reconstruction_);
+    for (const ViewId view_to_optimize : views_to_optimize) {
+      const auto& tracks_in_view =
+          reconstruction_->View(view_to_optimize)->TrackIds();
+      modified_tracks_.insert(tracks_in_view.begin(), tracks_in_view.end());
+    }
   } else {
     // If the track selection fails or is not desired, then add all tracks from
     // the views we wish to optimize.
@@ -836,19 +851,38 @@ void HybridReconstructionEstimator::RemoveOutlierTracks(
       SetOutlierTracksToUnestimated(tracks_to_check,
                                     max_reprojection_error_in_pixels,
                                     options_.min_triangulation_angle_degrees,
+                                    options_.num_threads,
                                     reconstruction_);
   LOG(INFO) << num_points_removed << " outlier points were removed.";
+  if (num_points_removed > 0 && !check_all_underconstrained_) {
+    modified_tracks_.insert(tracks_to_check.begin(), tracks_to_check.end());
+  }
 }
 
 void HybridReconstructionEstimator::SetUnderconstrainedAsUnestimated() {
   int num_underconstrained_views = -1;
   int num_underconstrained_tracks = -1;
-  while (num_underconstrained_views != 0 && num_underconstrained_tracks != 0) {
-    num_underconstrained_views =
-        SetUnderconstrainedViewsToUnestimated(reconstruction_);
-    num_underconstrained_tracks =
-        SetUnderconstrainedTracksToUnestimated(reconstruction_);
+  if (check_all_underconstrained_) {
+    while (num_underconstrained_views != 0 &&
+           num_underconstrained_tracks != 0) {
+      num_underconstrained_views = SetUnderconstrainedViewsToUnestimated(
+          options_.num_threads, reconstruction_);
+      num_underconstrained_tracks = SetUnderconstrainedTracksToUnestimated(
+          options_.num_threads, reconstruction_);
+    }
+  } else {
+    std::vector<ViewId> underconstrained_views;
+    std::vector<TrackId> underconstrained_tracks;
+    SetUnderconstrainedViewsAndTracksToUnestimated(modified_tracks_,
+                                                   options_.num_threads,
+                                                   reconstruction_,
+                                                   &underconstrained_views,
+                                                   &underconstrained_tracks);
+    num_underconstrained_views = underconstrained_views.size();
+    num_underconstrained_tracks = underconstrained_tracks.size();
   }
+  modified_tracks_.clear();
+  check_all_underconstrained_ = false;
 
   // If any views were removed then we need to update the localization container
   // so that we can try to re-estimate the view.
@@ -35,6 +35,7 @@
 #ifndef THEIA_SFM_HYBRID_RECONSTRUCTION_ESTIMATOR_H_
 #define THEIA_SFM_HYBRID_RECONSTRUCTION_ESTIMATOR_H_
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -43,6 +44,7 @@
 #include "theia/sfm/localize_view_to_reconstruction.h"
 #include "theia/sfm/reconstruction_estimator.h"
 #include "theia/sfm/reconstruction_estimator_options.h"
+#include "theia/sfm/select_good_tracks_for_bundle_adjustment.h"
 #include "theia/sfm/types.h"
 #include "theia/solvers/sample_consensus_estimator.h"
 #include "theia/util/util.h"
@@ -160,7 +162,8 @@ class HybridReconstructionEstimator : public ReconstructionEstimator {
 
   // Set any views that do not observe enough 3D points to unestimated, and
   // similarly set and tracks that are not observed by enough views to
-  // unestimated.
+  // unestimated. After a full BA the entire reconstruction is checked,
+  // otherwise only the views and tracks affected by the modified tracks are.
   void SetUnderconstrainedAsUnestimated();
 
   ViewGraph* view_graph_;
@@ -172,6 +175,10 @@ class HybridReconstructionEstimator : public ReconstructionEstimator {
   TrackEstimator::Options triangulation_options_;
   LocalizeViewToReconstructionOptions localization_options_;
 
+  // Selects the tracks for bundle adjustment and keeps the statistics of the
+  // tracks that did not change between bundle adjustments.
+  std::unique_ptr<BundleAdjustmentTrackSelector> track_selector_;
+
   ReconstructionEstimatorSummary summary_;
 
   // A container to keep track of which views need to be localized.
@@ -190,6 +197,12 @@ class HybridReconstructionEstimator : public ReconstructionEstimator {
   // Indicates the number of views that have been optimized with full BA.
   int num_optimized_views_;
 
+  // The tracks that may have been set to unestimated since underconstrained
+  // views and tracks were last removed, and whether the entire reconstruction
+  // must be checked instead (e.g. after full BA).
+  std::unordered_set<TrackId> modified_tracks_;
+  bool check_all_underconstrained_;
+
   DISALLOW_COPY_AND_ASSIGN(HybridReconstructionEstimator);
 };
 
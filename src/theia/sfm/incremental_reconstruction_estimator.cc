@@ -103,6 +103,11 @@ IncrementalReconstructionEstimator::IncrementalReconstructionEstimator(
       << "The bundle adjustment growth percent must be greater than 0 percent.";
   CHECK_GE(options.partial_bundle_adjustment_num_views, 0)
       << "The bundle adjustment growth percent must be greater than 0 percent.";
+  CHECK_GT(options.full_bundle_adjustment_max_cost_ratio, 1.0)
+      << "The full bundle adjustment cost ratio must be greater than 1.";
+  CHECK_GE(options.full_bundle_adjustment_max_growth_percent, 0.0)
+      << "The full bundle adjustment max growth percent must be at least 0 "
+         "percent.";
 
   options_ = options;
   ransac_params_ = SetRansacParameters(options);
@@ -128,7 +133,26 @@ IncrementalReconstructionEstimator::IncrementalReconstructionEstimator(
   localization_options_.min_num_inliers =
       options_.min_num_absolute_pose_inliers;
 
+  // Track selection options.
+  BundleAdjustmentTrackSelector::Options track_selector_options;
+  track_selector_options.long_track_length_threshold =
+      options_.track_subset_selection_long_track_length_threshold;
+  track_selector_options.image_grid_cell_size_pixels =
+      options_.track_selection_image_grid_cell_size_pixels;
+  track_selector_options.min_num_optimized_tracks_per_view =
+      options_.min_num_optimized_tracks_per_view;
+  track_selector_options.num_threads = options_.num_threads;
+  track_selector_.reset(
+      new BundleAdjustmentTrackSelector(track_selector_options));
+
   num_optimized_views_ = 0;
+  check_all_underconstrained_ = true;
+  full_bundle_adjustment_mean_squared_error_ = 0.0;
+  full_bundle_adjustment_requested_ = false;
+  num_partial_bundle_adjustments_ = 0;
+  num_full_bundle_adjustments_ = 0;
+  partial_bundle_adjustment_time_ = 0.0;
+  full_bundle_adjustment_time_ = 0.0;
 }
 
 // Estimates the camera position and 3D structure of the scene using an
@@ -161,6 +185,9 @@ ReconstructionEstimatorSummary IncrementalReconstructionEstimator::Estimate(
     ViewGraph* view_graph, Reconstruction* reconstruction) {
   reconstruction_ = reconstruction;
   view_graph_ = view_graph;
+  modified_tracks_.clear();
+  check_all_underconstrained_ = true;
+  track_selector_->Clear();
 
   // Initialize the unlocalized_views_ variable.
   const auto& view_ids = view_graph_->ViewIds();
@@ -245,8 +272,7 @@ ReconstructionEstimatorSummary IncrementalReconstructionEstimator::Estimate(
 
       // Step 5: Estimate new 3D points. and Step 6: Bundle adjustment.
       bool ba_success = false;
-      if (UnoptimizedGrowthPercentage() <
-          options_.full_bundle_adjustment_growth_percent) {
+      if (!ShouldRunFullBundleAdjustment()) {
         // Step 5: Perform triangulation on the most recent view.
         timer.Reset();
         EstimateStructure(reconstructed_views_.back());
@@ -255,6 +281,7 @@ ReconstructionEstimatorSummary IncrementalReconstructionEstimator::Estimate(
         // Step 6: Then perform partial Bundle Adjustment.
         timer.Reset();
         ba_success = PartialBundleAdjustment();
+        partial_bundle_adjustment_time_ += timer.ElapsedTimeInSeconds();
         summary_.bundle_adjustment_time += timer.ElapsedTimeInSeconds();
       } else {
         // Step 5: Perform triangulation on all views.
@@ -267,6 +294,7 @@ ReconstructionEstimatorSummary IncrementalReconstructionEstimator::Estimate(
         // Step 6: Full Bundle Adjustment.
         timer.Reset();
         ba_success = FullBundleAdjustment();
+        full_bundle_adjustment_time_ += timer.ElapsedTimeInSeconds();
         summary_.bundle_adjustment_time += timer.ElapsedTimeInSeconds();
       }
 
@@ -295,7 +323,13 @@ ReconstructionEstimatorSummary IncrementalReconstructionEstimator::Estimate(
   std::ostringstream string_stream;
   string_stream << "Incremental Reconstruction Estimator timings:"
                 << "\n\tTime to find an initial seed for the reconstruction: "
-                << time_to_find_initial_seed;
+                << time_to_find_initial_seed
+                << "\n\tPartial bundle adjustment: "
+                << num_partial_bundle_adjustments_ << " runs in "
+                << partial_bundle_adjustment_time_ << " seconds"
+                << "\n\tFull bundle adjustment: "
+                << num_full_bundle_adjustments_ << " runs in "
+                << full_bundle_adjustment_time_ << " seconds";
   summary_.message = string_stream.str();
   return summary_;
 }
@@ -470,6 +504,7 @@ void IncrementalReconstructionEstimator::EstimateStructure(
       tracks_in_view.begin(), tracks_in_view.end());
   const TrackEstimator::Summary summary =
       track_estimator.EstimateTracks(tracks_to_triangulate);
+  newly_estimated_tracks_ = summary.estimated_tracks;
 }
 
 double IncrementalReconstructionEstimator::UnoptimizedGrowthPercentage() {
@@ -477,6 +512,17 @@ double IncrementalReconstructionEstimator::UnoptimizedGrowthPercentage() {
          static_cast<double>(num_optimized_views_);
 }
 
+bool IncrementalReconstructionEstimator::ShouldRunFullBundleAdjustment() {
+  if (!options_.use_covisibility_local_bundle_adjustment) {
+    return UnoptimizedGrowthPercentage() >=
+           options_.full_bundle_adjustment_growth_percent;
+  }
+
+  return full_bundle_adjustment_requested_ ||
+         UnoptimizedGrowthPercentage() >=
+             options_.full_bundle_adjustment_max_growth_percent;
+}
+
 bool IncrementalReconstructionEstimator::FullBundleAdjustment() {
   // Full bundle adjustment.
   LOG(INFO) << "Running full bundle adjustment on the entire reconstruction.";
@@ -495,13 +541,8 @@ bool IncrementalReconstructionEstimator::FullBundleAdjustment() {
   // job of filtering tracks with outliers that may slow down the nonlinear
   // optimization.
   std::unordered_set<TrackId> tracks_to_optimize;
-  if (options_.subsample_tracks_for_bundle_adjustment &&
-      SelectGoodTracksForBundleAdjustment(
-          *reconstruction_,
-          options_.track_subset_selection_long_track_length_threshold,
-          options_.track_selection_image_grid_cell_size_pixels,
-          options_.min_num_optimized_tracks_per_view,
-          &tracks_to_optimize)) {
+  if (ShouldSubsampleTracksForBundleAdjustment(options_, *reconstruction_) &&
+      track_selector_->SelectTracks(*reconstruction_, &tracks_to_optimize)) {
     SetTracksInViewsToUnestimated(
         reconstructed_views_, tracks_to_optimize, reconstruction_);
   } else {
@@ -518,21 +559,65 @@ bool IncrementalReconstructionEstimator::FullBundleAdjustment() {
                                         tracks_to_optimize,
                                         reconstruction_);
   num_optimized_views_ = reconstructed_views_.size();
+  ++num_full_bundle_adjustments_;
 
+  // All tracks are checked for outliers, so the entire reconstruction is
+  // checked for underconstrained views and tracks as well.
+  check_all_underconstrained_ = true;
   const auto& track_ids = reconstruction_->TrackIds();
   const std::unordered_set<TrackId> all_tracks(track_ids.begin(),
                                                track_ids.end());
   RemoveOutlierTracks(all_tracks, options_.max_reprojection_error_in_pixels);
 
+  // Keep the error of the global solution (without the outliers) as the
+  // reference for measuring the drift of subsequent local BA problems.
+  if (options_.use_covisibility_local_bundle_adjustment) {
+    int num_observations;
+    full_bundle_adjustment_mean_squared_error_ =
+        MeanSquaredReprojectionError(*reconstruction_,
+                                     all_tracks,
+                                     std::unordered_set<ViewId>(),
+                                     &num_observations);
+  }
+  full_bundle_adjustment_requested_ = false;
+
   return ba_summary.success;
 }
 
-bool IncrementalReconstructionEstimator::PartialBundleAdjustment() {
-  // Partial bundle adjustment only only the k most recently added views that
-  // have not been optimized by full BA.
+void IncrementalReconstructionEstimator::SelectViewsForPartialBundleAdjustment(
+    std::unordered_set<ViewId>* views_to_optimize) {
   const int partial_ba_size =
       std::min(static_cast<int>(reconstructed_views_.size()),
                options_.partial_bundle_adjustment_num_views);
+
+  if (!options_.use_covisibility_local_bundle_adjustment) {
+    // Partial bundle adjustment only only the k most recently added views that
+    // have not been optimized by full BA.
+    views_to_optimize->insert(reconstructed_views_.end() - partial_ba_size,
+                              reconstructed_views_.end());
+    return;
+  }
+
+  // Seed the local window with the most recently added views and grow it with
+  // the views that share the most tracks with them.
+  const int num_seed_views =
+      std::min(static_cast<int>(reconstructed_views_.size()),
+               std::max(1, options_.local_bundle_adjustment_num_seed_views));
+  const std::vector<ViewId> seed_views(
+      reconstructed_views_.end() - num_seed_views, reconstructed_views_.end());
+  SelectCovisibleViewsForLocalBundleAdjustment(
+      *reconstruction_,
+      seed_views,
+      options_.local_bundle_adjustment_min_num_shared_tracks,
+      partial_ba_size,
+      views_to_optimize);
+}
+
+bool IncrementalReconstructionEstimator::PartialBundleAdjustment() {
+  // Get the views to optimize for partial BA.
+  std::unordered_set<ViewId> views_to_optimize;
+  SelectViewsForPartialBundleAdjustment(&views_to_optimize);
+  const int partial_ba_size = views_to_optimize.size();
   LOG(INFO) << "Running partial bundle adjustment on " << partial_ba_size
             << " views.";
 
@@ -546,29 +631,23 @@ bool IncrementalReconstructionEstimator::PartialBundleAdjustment() {
   bundle_adjustment_options_.use_inner_iterations = false;
   bundle_adjustment_options_.verbose = VLOG_IS_ON(2);
 
-  // If the model has grown sufficiently then run BA on the entire
-  // model. Otherwise, run partial BA.
   BundleAdjustmentSummary ba_summary;
 
-  // Get the views to optimize for partial BA.
-  std::unordered_set<ViewId> views_to_optimize(
-      reconstructed_views_.end() - partial_ba_size, reconstructed_views_.end());
-
   // If desired, select good tracks to optimize for BA. This dramatically
   // reduces the number of parameters in bundle adjustment, and does a decent
   // job of filtering tracks with outliers that may slow down the nonlinear
   // optimization.
   std::unordered_set<TrackId> tracks_to_optimize;
   if (options_.subsample_tracks_for_bundle_adjustment &&
-      SelectGoodTracksForBundleAdjustment(
-          *reconstruction_,
-          views_to_optimize,
-          options_.track_subset_selection_long_track_length_threshold,
-          options_.track_selection_image_grid_cell_size_pixels,
-          options_.min_num_optimized_tracks_per_view,
-          &tracks_to_optimize)) {
+      track_selector_->SelectTracks(
+          *reconstruction_, views_to_optimize, &tracks_to_optimize)) {
     SetTracksInViewsToUnestimated(
         views_to_optimize, tracks_to_optimize, reconstruction_);
+    for (const ViewId view_to_optimize : views_to_optimize) {
+      const auto& tracks_in_view =
+          reconstruction_->View(view_to_optimize)->TrackIds();
+      modified_tracks_.insert(tracks_in_view.begin(), tracks_in_view.end());
+    }
   } else {
     // If the track selection fails or is not desired, then add all tracks from
     // the views we wish to optimize.
@@ -583,11 +662,43 @@ bool IncrementalReconstructionEstimator::PartialBundleAdjustment() {
   LOG(INFO) << "Selected " << tracks_to_optimize.size()
             << " tracks to optimize.";
 
+  // Measure the drift of the local window before it is optimized. The error is
+  // measured without the newest view and the tracks it triangulated, i.e. the
+  // error of the local problem before the new view was added. The views
+  // outside of the window are held constant, so a large error compared to the
+  // error after the last full BA means that the local window no longer agrees
+  // with the anchoring views.
+  if (options_.use_covisibility_local_bundle_adjustment &&
+      full_bundle_adjustment_mean_squared_error_ > 0.0) {
+    std::unordered_set<TrackId> tracks_to_measure;
+    for (const TrackId track_id : tracks_to_optimize) {
+      if (!ContainsKey(newly_estimated_tracks_, track_id)) {
+        tracks_to_measure.insert(track_id);
+      }
+    }
+    const std::unordered_set<ViewId> newest_view = {
+        reconstructed_views_.back()};
+    int num_observations;
+    const double mean_squared_error =
+        MeanSquaredReprojectionError(*reconstruction_,
+                                     tracks_to_measure,
+                                     newest_view,
+                                     &num_observations);
+    const double cost_ratio =
+        mean_squared_error / full_bundle_adjustment_mean_squared_error_;
+    VLOG(2) << "Local bundle adjustment error ratio: " << cost_ratio;
+    if (num_observations > 0 &&
+        cost_ratio > options_.full_bundle_adjustment_max_cost_ratio) {
+      full_bundle_adjustment_requested_ = true;
+    }
+  }
+
   // Perform partial BA.
   ba_summary = BundleAdjustPartialReconstruction(bundle_adjustment_options_,
                                                  views_to_optimize,
                                                  tracks_to_optimize,
                                                  reconstruction_);
+  ++num_partial_bundle_adjustments_;
 
   RemoveOutlierTracks(tracks_to_optimize,
                       options_.max_reprojection_error_in_pixels);
@@ -603,19 +714,38 @@ void IncrementalReconstructionEstimator::RemoveOutlierTracks(
       SetOutlierTracksToUnestimated(tracks_to_check,
                                     max_reprojection_error_in_pixels,
                                     options_.min_triangulation_angle_degrees,
+                                    options_.num_threads,
                                     reconstruction_);
   LOG(INFO) << num_points_removed << " outlier points were removed.";
+  if (num_points_removed > 0 && !check_all_underconstrained_) {
+    modified_tracks_.insert(tracks_to_check.begin(), tracks_to_check.end());
+  }
 }
 
 void IncrementalReconstructionEstimator::SetUnderconstrainedAsUnestimated() {
   int num_underconstrained_views = -1;
   int num_underconstrained_tracks = -1;
-  while (num_underconstrained_views != 0 && num_underconstrained_tracks != 0) {
-    num_underconstrained_views =
-        SetUnderconstrainedViewsToUnestimated(reconstruction_);
-    num_underconstrained_tracks =
-        SetUnderconstrainedTracksToUnestimated(reconstruction_);
+  if (check_all_underconstrained_) {
+    while (num_underconstrained_views != 0 &&
+           num_underconstrained_tracks != 0) {
+      num_underconstrained_views = SetUnderconstrainedViewsToUnestimated(
+          options_.num_threads, reconstruction_);
+      num_underconstrained_tracks = SetUnderconstrainedTracksToUnestimated(
+          options_.num_threads, reconstruction_);
+    }
+  } else {
+    std::vector<ViewId> underconstrained_views;
+    std::vector<TrackId> underconstrained_tracks;
+    SetUnderconstrainedViewsAndTracksToUnestimated(modified_tracks_,
+                                                   options_.num_threads,
+                                                   reconstruction_,
+                                                   &underconstrained_views,
+                                                   &underconstrained_tracks);
+    num_underconstrained_views = underconstrained_views.size();
+    num_underconstrained_tracks = underconstrained_tracks.size();
   }
+  modified_tracks_.clear();
+  check_all_underconstrained_ = false;
 
   // If any views were removed then we need to update the localization container
   // so that we can try to re-estimate the view.
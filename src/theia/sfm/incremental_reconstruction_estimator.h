@@ -35,6 +35,7 @@
 #ifndef THEIA_SFM_INCREMENTAL_RECONSTRUCTION_ESTIMATOR_H_
 #define THEIA_SFM_INCREMENTAL_RECONSTRUCTION_ESTIMATOR_H_
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -43,6 +44,7 @@
 #include "theia/sfm/localize_view_to_reconstruction.h"
 #include "theia/sfm/reconstruction_estimator.h"
 #include "theia/sfm/reconstruction_estimator_options.h"
+#include "theia/sfm/select_good_tracks_for_bundle_adjustment.h"
 #include "theia/sfm/types.h"
 #include "theia/solvers/sample_consensus_estimator.h"
 #include "theia/util/util.h"
@@ -118,10 +120,21 @@ class IncrementalReconstructionEstimator : public ReconstructionEstimator {
   // The current percentage of cameras that have not been optimized by full BA.
   double UnoptimizedGrowthPercentage();
 
+  // Returns true if full BA should be run after the next view is added. By
+  // default this is decided by the growth of the model. With covisibility local
+  // BA, the drift measured during local BA is used instead.
+  bool ShouldRunFullBundleAdjustment();
+
   // Performs partial bundle adjustment on the model. Only the k most recent
-  // cameras (and the tracks observed in those views) are optimized.
+  // cameras (and the tracks observed in those views) are optimized. With
+  // covisibility local BA, the k views that are most covisible with the most
+  // recent cameras are optimized instead.
   bool PartialBundleAdjustment();
 
+  // Chooses the views for partial bundle adjustment.
+  void SelectViewsForPartialBundleAdjustment(
+      std::unordered_set<ViewId>* views_to_optimize);
+
   // Performs full bundle adjustment on the model.
   bool FullBundleAdjustment();
 
@@ -137,7 +150,8 @@ class IncrementalReconstructionEstimator : public ReconstructionEstimator {
 
   // Set any views that do not observe enough 3D points to unestimated, and
   // similarly set and tracks that are not observed by enough views to
-  // unestimated.
+  // unestimated. After a full BA the entire reconstruction is checked,
+  // otherwise only the views and tracks affected by the modified tracks are.
   void SetUnderconstrainedAsUnestimated();
 
   ViewGraph* view_graph_;
@@ -149,6 +163,10 @@ class IncrementalReconstructionEstimator : public ReconstructionEstimator {
   TrackEstimator::Options triangulation_options_;
   LocalizeViewToReconstructionOptions localization_options_;
 
+  // Selects the tracks for bundle adjustment and keeps the statistics of the
+  // tracks that did not change between bundle adjustments.
+  std::unique_ptr<BundleAdjustmentTrackSelector> track_selector_;
+
   ReconstructionEstimatorSummary summary_;
 
   // A container to keep track of which views need to be localized.
@@ -162,6 +180,27 @@ class IncrementalReconstructionEstimator : public ReconstructionEstimator {
   // Indicates the number of views that have been optimized with full BA.
   int num_optimized_views_;
 
+  // The tracks that may have been set to unestimated since underconstrained
+  // views and tracks were last removed, and whether the entire reconstruction
+  // must be checked instead (e.g. after full BA).
+  std::unordered_set<TrackId> modified_tracks_;
+  bool check_all_underconstrained_;
+
+  // The mean squared reprojection error after the last full BA, and whether
+  // local BA has measured enough drift from it to request a full BA.
+  double full_bundle_adjustment_mean_squared_error_;
+  bool full_bundle_adjustment_requested_;
+
+  // The tracks that were triangulated by the last call to EstimateStructure.
+  // They are excluded when the drift of local BA is measured.
+  std::unordered_set<TrackId> newly_estimated_tracks_;
+
+  // Bundle adjustment statistics that are reported in the summary.
+  int num_partial_bundle_adjustments_;
+  int num_full_bundle_adjustments_;
+  double partial_bundle_adjustment_time_;
+  double full_bundle_adjustment_time_;
+
   DISALLOW_COPY_AND_ASSIGN(IncrementalReconstructionEstimator);
 };
 
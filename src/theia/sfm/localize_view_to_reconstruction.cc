@@ -34,11 +34,22 @@
 
 #include "theia/sfm/localize_view_to_reconstruction.h"
 
+#include <ceres/ceres.h>
 #include <glog/logging.h>
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "theia/sfm/bundle_adjustment/bundle_adjustment.h"
+#include "theia/sfm/bundle_adjustment/create_loss_function.h"
+#include "theia/sfm/bundle_adjustment/gravity_error.h"
+#include "theia/sfm/bundle_adjustment/position_error.h"
 #include "theia/sfm/camera/camera.h"
+#include "theia/sfm/camera/create_reprojection_error_cost_function.h"
 #include "theia/sfm/estimators/estimate_absolute_pose_with_known_orientation.h"
 #include "theia/sfm/estimators/estimate_calibrated_absolute_pose.h"
 #include "theia/sfm/estimators/estimate_uncalibrated_absolute_pose.h"
@@ -47,6 +58,9 @@
 #include "theia/sfm/reconstruction_estimator_utils.h"
 #include "theia/sfm/types.h"
 #include "theia/solvers/sample_consensus_estimator.h"
+#include "theia/util/random.h"
+#include "theia/util/threadpool.h"
+#include "theia/util/timer.h"
 
 namespace theia {
 namespace {
@@ -122,25 +136,19 @@ void GetIntrinsicsNormalized2D3DMatches(
   }
 }
 
+// Estimates the pose of the camera from the 2D-3D correspondences, which must
+// be normalized by GetIntrinsicsNormalized2D3DMatches if the intrinsics are
+// known and by GetNormalized2D3DMatches otherwise.
 bool EstimateCameraPose(const bool known_intrinsics,
                         const LocalizeViewToReconstructionOptions& options,
-                        const Reconstruction& reconstruction,
-                        View* view,
+                        const std::vector<FeatureCorrespondence2D3D>& matches,
+                        const std::string& view_name,
+                        Camera* camera,
                         RansacSummary* summary) {
-  Camera* camera = view->MutableCamera();
-
-  // Gather all 2D-3D correspondences.
-  std::vector<FeatureCorrespondence2D3D> matches;
-  if (known_intrinsics) {
-    GetIntrinsicsNormalized2D3DMatches(reconstruction, *view, &matches);
-  } else {
-    GetNormalized2D3DMatches(reconstruction, *view, &matches);
-  }
-
   // Exit early if there are not enough putative matches.
   if (matches.size() < options.min_num_inliers) {
     VLOG(2) << "Not enough 2D-3D correspondences to localize view "
-            << view->Name();
+            << view_name;
     return false;
   }
 
@@ -216,6 +224,172 @@ bool EstimateCameraPose(const bool known_intrinsics,
   return false;
 }
 
+// The estimated 3D points of a reconstruction indexed by track id.
+struct FlatTrackIndex {
+  std::vector<Eigen::Vector4d> points;
+  std::vector<char> is_estimated;
+};
+
+void BuildFlatTrackIndex(const Reconstruction& reconstruction,
+                         FlatTrackIndex* index) {
+  const std::vector<TrackId> track_ids = reconstruction.TrackIds();
+  TrackId max_track_id = 0;
+  for (const TrackId track_id : track_ids) {
+    max_track_id = std::max(max_track_id, track_id);
+  }
+  index->points.resize(track_ids.empty() ? 0 : max_track_id + 1);
+  index->is_estimated.assign(index->points.size(), 0);
+  for (const TrackId track_id : track_ids) {
+    const Track* track = reconstruction.Track(track_id);
+    if (track->IsEstimated()) {
+      index->points[track_id] = track->Point();
+      index->is_estimated[track_id] = 1;
+    }
+  }
+}
+
+// Gathers the features of the view that observe estimated tracks along with
+// the 3D points of the tracks.
+void GatherObservations(const View& view,
+                        const FlatTrackIndex& index,
+                        std::vector<Feature>* features,
+                        std::vector<Eigen::Vector4d>* points) {
+  const std::vector<TrackId> tracks_in_view = view.TrackIds();
+  features->reserve(tracks_in_view.size());
+  points->reserve(tracks_in_view.size());
+  for (const TrackId track_id : tracks_in_view) {
+    if (track_id >= index.is_estimated.size() ||
+        !index.is_estimated[track_id]) {
+      continue;
+    }
+    features->emplace_back(*view.GetFeature(track_id));
+    points->emplace_back(index.points[track_id]);
+  }
+}
+
+// Creates the 2D-3D correspondences in the same way as
+// GetIntrinsicsNormalized2D3DMatches and GetNormalized2D3DMatches.
+void NormalizeObservations(const bool known_intrinsics,
+                           const Camera& camera,
+                           const std::vector<Feature>& features,
+                           const std::vector<Eigen::Vector4d>& points,
+                           std::vector<FeatureCorrespondence2D3D>* matches) {
+  const Eigen::Vector2d principal_point(camera.PrincipalPointX(),
+                                        camera.PrincipalPointY());
+  matches->resize(features.size());
+  for (int i = 0; i < features.size(); i++) {
+    FeatureCorrespondence2D3D& correspondence = (*matches)[i];
+    if (known_intrinsics) {
+      correspondence.feature =
+          camera.PixelToNormalizedCoordinates(features[i].point_)
+              .hnormalized();
+    } else {
+      correspondence.feature = features[i].point_ - principal_point;
+    }
+    correspondence.world_point = points[i].hnormalized();
+  }
+}
+
+// Returns a copy of the camera that does not share its intrinsics with the
+// original, so that the copy may be modified while other views of the same
+// intrinsics group are localized.
+Camera DeepCopyCamera(const Camera& camera) {
+  Camera copy;
+  copy.DeepCopy(camera);
+  return copy;
+}
+
+// Refines the pose of the camera with the 3D points and the camera intrinsics
+// held constant. This minimizes the same costs as BundleAdjustView but only
+// touches the given camera and points, so several views may be refined at the
+// same time.
+BundleAdjustmentSummary RefineCameraPose(
+    const BundleAdjustmentOptions& options,
+    const View& view,
+    const std::vector<Feature>& features,
+    std::vector<Eigen::Vector4d>* points,
+    Camera* camera) {
+  Timer timer;
+  const std::unique_ptr<ceres::LossFunction> loss_function =
+      CreateLossFunction(options.loss_function_type, options.robust_loss_width);
+  ceres::Problem::Options problem_options;
+  problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+  ceres::Problem problem(problem_options);
+
+  for (int i = 0; i < features.size(); i++) {
+    problem.AddResidualBlock(
+        CreateReprojectionErrorCostFunction(
+            camera->GetCameraIntrinsicsModelType(), features[i]),
+        loss_function.get(),
+        camera->mutable_extrinsics(),
+        camera->mutable_intrinsics(),
+        (*points)[i].data());
+    problem.SetParameterBlockConstant((*points)[i].data());
+  }
+  problem.SetParameterBlockConstant(camera->mutable_intrinsics());
+
+  if (options.use_position_priors && view.HasPositionPrior()) {
+    problem.AddResidualBlock(
+        PositionError::Create(view.GetPositionPrior(),
+                              view.GetPositionPriorSqrtInformation()),
+        NULL,
+        camera->mutable_extrinsics());
+  }
+  if (options.use_gravity_priors && view.HasGravityPrior()) {
+    problem.AddResidualBlock(
+        GravityError::Create(view.GetGravityPrior(),
+                             view.GetGravityPriorSqrtInformation()),
+        NULL,
+        camera->mutable_extrinsics());
+  }
+
+  BundleAdjustmentSummary summary;
+  if (options.constant_camera_orientation && options.constant_camera_position) {
+    summary.success = true;
+    return summary;
+  }
+  if (options.constant_camera_orientation ||
+      options.constant_camera_position) {
+    std::vector<int> constant_extrinsics;
+    const int first_constant_index = options.constant_camera_orientation
+                                         ? Camera::ORIENTATION
+                                         : Camera::POSITION;
+    for (int i = 0; i < 3; i++) {
+      constant_extrinsics.emplace_back(first_constant_index + i);
+    }
+    problem.SetManifold(camera->mutable_extrinsics(),
+                        new ceres::SubsetManifold(Camera::kExtrinsicsSize,
+                                                  constant_extrinsics));
+  }
+
+  // The problems are small and solved on the thread that localizes the view.
+  ceres::Solver::Options solver_options;
+  solver_options.linear_solver_type = ceres::DENSE_QR;
+  solver_options.logging_type =
+      options.verbose ? ceres::PER_MINIMIZER_ITERATION : ceres::SILENT;
+  solver_options.num_threads = 1;
+  solver_options.max_num_iterations = options.max_num_iterations;
+  solver_options.max_solver_time_in_seconds =
+      options.max_solver_time_in_seconds;
+  solver_options.function_tolerance = options.function_tolerance;
+  solver_options.gradient_tolerance = options.gradient_tolerance;
+  solver_options.parameter_tolerance = options.parameter_tolerance;
+  solver_options.max_trust_region_radius = options.max_trust_region_radius;
+
+  const double setup_time = timer.ElapsedTimeInSeconds();
+  ceres::Solver::Summary solver_summary;
+  ceres::Solve(solver_options, &problem, &solver_summary);
+
+  summary.setup_time_in_seconds =
+      setup_time + solver_summary.preprocessor_time_in_seconds;
+  summary.solve_time_in_seconds = solver_summary.total_time_in_seconds;
+  summary.initial_cost = solver_summary.initial_cost;
+  summary.final_cost = solver_summary.final_cost;
+  summary.num_residuals = solver_summary.num_residuals;
+  summary.success = solver_summary.IsSolutionUsable();
+  return summary;
+}
+
 }  // namespace
 
 bool LocalizeViewToReconstruction(
@@ -232,10 +406,22 @@ bool LocalizeViewToReconstruction(
       options.assume_known_orientation ||
       DoesViewHaveKnownIntrinsics(*reconstruction, view_to_localize);
 
+  // Gather all 2D-3D correspondences.
+  std::vector<FeatureCorrespondence2D3D> matches;
+  if (known_intrinsics) {
+    GetIntrinsicsNormalized2D3DMatches(*reconstruction, *view, &matches);
+  } else {
+    GetNormalized2D3DMatches(*reconstruction, *view, &matches);
+  }
+
   // If localization failed or did not produce a sufficient number of inliers
   // then return false.
-  bool success = EstimateCameraPose(
-      known_intrinsics, options, *reconstruction, view, summary);
+  bool success = EstimateCameraPose(known_intrinsics,
+                                    options,
+                                    matches,
+                                    view->Name(),
+                                    view->MutableCamera(),
+                                    summary);
   if (!success || summary->inliers.size() < options.min_num_inliers) {
     VLOG(2) << "Failed to localize view id " << view_to_localize
             << " with only " << summary->inliers.size() << " out of "
@@ -257,4 +443,132 @@ bool LocalizeViewToReconstruction(
   return success;
 }
 
+int LocalizeViewsToReconstruction(
+    const std::vector<ViewId>& views_to_localize,
+    const LocalizeViewToReconstructionOptions& options,
+    Reconstruction* reconstruction,
+    std::vector<LocalizeViewSummary>* summaries) {
+  CHECK_NOTNULL(reconstruction);
+  CHECK_NOTNULL(summaries)->clear();
+  const int num_views = views_to_localize.size();
+  summaries->resize(num_views);
+
+  FlatTrackIndex track_index;
+  BuildFlatTrackIndex(*reconstruction, &track_index);
+
+  // Everything that depends on the reconstruction or on the random number
+  // generator is set up before the views are localized in parallel. Each view
+  // is localized with its own camera so that views with shared intrinsics do
+  // not write to the same memory.
+  std::vector<char> known_intrinsics(num_views);
+  std::vector<Camera> cameras;
+  cameras.reserve(num_views);
+  std::vector<LocalizeViewToReconstructionOptions> view_options(num_views,
+                                                                options);
+  for (int i = 0; i < num_views; i++) {
+    const View* view =
+        CHECK_NOTNULL(reconstruction->View(views_to_localize[i]));
+    known_intrinsics[i] =
+        options.assume_known_orientation ||
+        DoesViewHaveKnownIntrinsics(*reconstruction, views_to_localize[i]);
+    cameras.emplace_back(DeepCopyCamera(view->Camera()));
+  }
+
+  // The random streams are handed out in the order of the view ids so that the
+  // estimate of a view does not depend on its position in views_to_localize.
+  if (options.ransac_params.rng.get() != nullptr) {
+    std::vector<int> order(num_views);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](const int i, const int j) {
+      return views_to_localize[i] < views_to_localize[j];
+    });
+    for (const int i : order) {
+      view_options[i].ransac_params.rng =
+          std::make_shared<RandomNumberGenerator>(
+              options.ransac_params.rng->Split());
+    }
+  }
+
+  const Reconstruction& const_reconstruction = *reconstruction;
+  ParallelFor(options.num_threads, num_views, [&](const int i) {
+    const View& view = *const_reconstruction.View(views_to_localize[i]);
+    LocalizeViewSummary& summary = (*summaries)[i];
+    summary.view_id = views_to_localize[i];
+
+    std::vector<Feature> features;
+    std::vector<Eigen::Vector4d> points;
+    GatherObservations(view, track_index, &features, &points);
+    summary.num_2d3d_correspondences = features.size();
+
+    std::vector<FeatureCorrespondence2D3D> matches;
+    NormalizeObservations(
+        known_intrinsics[i], cameras[i], features, points, &matches);
+    if (!EstimateCameraPose(known_intrinsics[i],
+                            view_options[i],
+                            matches,
+                            view.Name(),
+                            &cameras[i],
+                            &summary.ransac_summary) ||
+        summary.ransac_summary.inliers.size() < options.min_num_inliers) {
+      VLOG(2) << "Failed to localize view id " << summary.view_id
+              << " with only " << summary.ransac_summary.inliers.size()
+              << " out of " << matches.size() << " features as inliers.";
+      return;
+    }
+
+    if (options.bundle_adjust_view) {
+      summary.refinement_summary = RefineCameraPose(
+          options.ba_options, view, features, &points, &cameras[i]);
+      summary.success = summary.refinement_summary.success;
+    } else {
+      summary.success = true;
+    }
+  });
+
+  // Write the poses of the localized views back to the reconstruction. The
+  // focal length is only estimated if the intrinsics are unknown. Views of the
+  // same intrinsics group share one focal length, so the group is given the
+  // median of the estimates of its views rather than the estimate of whichever
+  // view is written last.
+  int num_localized_views = 0;
+  std::unordered_map<CameraIntrinsicsGroupId, std::vector<int>>
+      uncalibrated_views_of_group;
+  for (int i = 0; i < num_views; i++) {
+    if (!(*summaries)[i].success) {
+      continue;
+    }
+
+    View* view = reconstruction->MutableView(views_to_localize[i]);
+    Camera* camera = view->MutableCamera();
+    camera->SetOrientationFromAngleAxis(cameras[i].GetOrientationAsAngleAxis());
+    camera->SetPosition(cameras[i].GetPosition());
+    if (!known_intrinsics[i]) {
+      const CameraIntrinsicsGroupId group_id =
+          reconstruction->CameraIntrinsicsGroupIdFromViewId(
+              views_to_localize[i]);
+      uncalibrated_views_of_group[group_id].emplace_back(i);
+    }
+    view->SetEstimated(true);
+    ++num_localized_views;
+  }
+
+  for (const auto& group : uncalibrated_views_of_group) {
+    std::vector<double> focal_lengths;
+    for (const int i : group.second) {
+      focal_lengths.emplace_back(cameras[i].FocalLength());
+    }
+    std::sort(focal_lengths.begin(), focal_lengths.end());
+    const double median_focal_length = focal_lengths[focal_lengths.size() / 2];
+    for (const int i : group.second) {
+      reconstruction->MutableView(views_to_localize[i])
+          ->MutableCamera()
+          ->SetFocalLength(median_focal_length);
+    }
+  }
+
+  VLOG(2) << "Localized " << num_localized_views << " out of " << num_views
+          << " views.";
+  return num_localized_views;
+}
+
 }  // namespace theia
@@ -35,6 +35,8 @@
 #ifndef THEIA_SFM_LOCALIZE_VIEW_TO_RECONSTRUCTION_H_
 #define THEIA_SFM_LOCALIZE_VIEW_TO_RECONSTRUCTION_H_
 
+#include <vector>
+
 #include "theia/sfm/bundle_adjustment/bundle_adjustment.h"
 #include "theia/sfm/types.h"
 #include "theia/solvers/sample_consensus_estimator.h"
@@ -72,6 +74,10 @@ struct LocalizeViewToReconstructionOptions {
   // The minimum number of inliers found from RANSAC in order to be considered
   // successful localization.
   int min_num_inliers = 30;
+
+  // Number of threads used by LocalizeViewsToReconstruction. Each view is
+  // localized on a single thread.
+  int num_threads = 1;
 };
 
 // Localizes a view to the reconstruction using 2D-3D correspondences to
@@ -84,6 +90,40 @@ bool LocalizeViewToReconstruction(
     Reconstruction* reconstruction,
     RansacSummary* summary);
 
+// The outcome of localizing one of the views passed to
+// LocalizeViewsToReconstruction.
+struct LocalizeViewSummary {
+  ViewId view_id = kInvalidViewId;
+  bool success = false;
+
+  // The number of 2D-3D correspondences to estimated tracks.
+  int num_2d3d_correspondences = 0;
+
+  RansacSummary ransac_summary;
+
+  // The summary of the pose-only refinement if bundle_adjust_view is set.
+  BundleAdjustmentSummary refinement_summary;
+};
+
+// Localizes many views to a reconstruction whose tracks are held fixed, e.g. to
+// register new frames into an existing model. The estimated 3D points are
+// indexed by track id once so that the 2D-3D correspondences of every view are
+// gathered without lookups into the reconstruction. Each view is then
+// localized with RANSAC followed by a refinement of its pose only (the camera
+// intrinsics are held constant, unlike with BundleAdjustView) on one of
+// options.num_threads threads. The poses of the views that were successfully
+// localized are written to the reconstruction in a single pass once all views
+// are processed. Views with unknown intrinsics that share an intrinsics group
+// are given the median of their focal length estimates. The random streams are
+// assigned by view id, so the result does not depend on the order of the views.
+// Returns the number of views that were localized. A summary is returned for
+// each view in the order of views_to_localize.
+int LocalizeViewsToReconstruction(
+    const std::vector<ViewId>& views_to_localize,
+    const LocalizeViewToReconstructionOptions& options,
+    Reconstruction* reconstruction,
+    std::vector<LocalizeViewSummary>* summaries);
+
 }  // namespace theia
 
 #endif  // THEIA_SFM_LOCALIZE_VIEW_TO_RECONSTRUCTION_H_
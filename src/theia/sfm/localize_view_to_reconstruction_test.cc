@@ -0,0 +1,284 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "theia/sfm/camera/camera.h"
+#include "theia/sfm/localize_view_to_reconstruction.h"
+#include "theia/sfm/reconstruction.h"
+#include "theia/sfm/track.h"
+#include "theia/sfm/types.h"
+#include "theia/sfm/view.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+namespace {
+
+static const int kNumPoints = 100;
+static const double kFocalLength = 1000.0;
+static const double kImageSize = 1000.0;
+
+RandomNumberGenerator rng(61);
+
+void SetIntrinsics(Camera* camera) {
+  camera->SetFocalLength(kFocalLength);
+  camera->SetPrincipalPoint(kImageSize / 2.0, kImageSize / 2.0);
+  camera->SetImageSize(kImageSize, kImageSize);
+}
+
+// Adds kNumPoints estimated tracks in front of the cameras.
+void AddTracks(Reconstruction* reconstruction,
+               std::vector<TrackId>* track_ids) {
+  for (int i = 0; i < kNumPoints; i++) {
+    const TrackId track_id = reconstruction->AddTrack();
+    Track* track = reconstruction->MutableTrack(track_id);
+    *track->MutablePoint() =
+        Eigen::Vector3d(rng.RandDouble(-2.0, 2.0),
+                        rng.RandDouble(-2.0, 2.0),
+                        rng.RandDouble(6.0, 10.0))
+            .homogeneous();
+    track->SetEstimated(true);
+    track_ids->emplace_back(track_id);
+  }
+}
+
+// Adds the projections of the first num_observations tracks into the ground
+// truth camera, with uniform noise of the given magnitude, to the view.
+void AddObservations(const ViewId view_id,
+                     const std::vector<TrackId>& track_ids,
+                     const int num_observations,
+                     const double noise,
+                     const Camera& ground_truth_camera,
+                     Reconstruction* reconstruction) {
+  for (int i = 0; i < num_observations; i++) {
+    Eigen::Vector2d pixel;
+    ground_truth_camera.ProjectPoint(
+        reconstruction->Track(track_ids[i])->Point(), &pixel);
+    pixel += noise * rng.RandVector2d();
+    reconstruction->AddObservation(view_id, track_ids[i], Feature(pixel));
+  }
+}
+
+// Adds a view that observes the first num_observations tracks of the
+// reconstruction from a random pose. The pose is returned in the ground truth
+// camera.
+ViewId AddViewToLocalize(const std::string& name,
+                         const std::vector<TrackId>& track_ids,
+                         const int num_observations,
+                         Reconstruction* reconstruction,
+                         Camera* ground_truth_camera) {
+  SetIntrinsics(ground_truth_camera);
+  ground_truth_camera->SetOrientationFromAngleAxis(0.1 * rng.RandVector3d());
+  ground_truth_camera->SetPosition(rng.RandVector3d());
+
+  const ViewId view_id =
+      reconstruction->AddView(name, reconstruction->NumViews());
+  View* view = reconstruction->MutableView(view_id);
+  SetIntrinsics(view->MutableCamera());
+  view->MutableCameraIntrinsicsPrior()->focal_length.value[0] = kFocalLength;
+  view->MutableCameraIntrinsicsPrior()->focal_length.is_set = true;
+
+  AddObservations(view_id,
+                  track_ids,
+                  num_observations,
+                  0.0,
+                  *ground_truth_camera,
+                  reconstruction);
+  return view_id;
+}
+
+}  // namespace
+
+TEST(LocalizeViewsToReconstruction, LocalizesViewsInParallel) {
+  static const int kNumViews = 4;
+  Reconstruction reconstruction;
+  std::vector<TrackId> track_ids;
+  AddTracks(&reconstruction, &track_ids);
+
+  std::vector<ViewId> view_ids;
+  std::vector<Camera> ground_truth_cameras(kNumViews + 1);
+  for (int i = 0; i < kNumViews; i++) {
+    view_ids.emplace_back(AddViewToLocalize("view" + std::to_string(i),
+                                            track_ids,
+                                            kNumPoints,
+                                            &reconstruction,
+                                            &ground_truth_cameras[i]));
+  }
+  // This view does not observe enough tracks to be localized.
+  view_ids.emplace_back(AddViewToLocalize("unlocalizable_view",
+                                          track_ids,
+                                          10,
+                                          &reconstruction,
+                                          &ground_truth_cameras[kNumViews]));
+
+  LocalizeViewToReconstructionOptions options;
+  options.bundle_adjust_view = false;
+  options.num_threads = 2;
+  options.ransac_params.rng = std::make_shared<RandomNumberGenerator>(59);
+  std::vector<LocalizeViewSummary> summaries;
+  EXPECT_EQ(LocalizeViewsToReconstruction(
+                view_ids, options, &reconstruction, &summaries),
+            kNumViews);
+
+  ASSERT_EQ(summaries.size(), view_ids.size());
+  for (int i = 0; i < kNumViews; i++) {
+    EXPECT_EQ(summaries[i].view_id, view_ids[i]);
+    EXPECT_TRUE(summaries[i].success);
+    EXPECT_EQ(summaries[i].num_2d3d_correspondences, kNumPoints);
+
+    const View* view = reconstruction.View(view_ids[i]);
+    EXPECT_TRUE(view->IsEstimated());
+    EXPECT_LT((view->Camera().GetPosition() -
+               ground_truth_cameras[i].GetPosition())
+                  .norm(),
+              1e-6);
+    EXPECT_LT((view->Camera().GetOrientationAsAngleAxis() -
+               ground_truth_cameras[i].GetOrientationAsAngleAxis())
+                  .norm(),
+              1e-6);
+  }
+
+  EXPECT_FALSE(summaries[kNumViews].success);
+  EXPECT_EQ(summaries[kNumViews].num_2d3d_correspondences, 10);
+  EXPECT_FALSE(reconstruction.View(view_ids[kNumViews])->IsEstimated());
+}
+
+// The orientation of the view is perturbed and only its position is estimated
+// with RANSAC, so the pose refinement has to recover the orientation.
+TEST(LocalizeViewsToReconstruction, RefinesPerturbedPose) {
+  Reconstruction reconstruction;
+  std::vector<TrackId> track_ids;
+  AddTracks(&reconstruction, &track_ids);
+
+  Camera ground_truth_camera;
+  const ViewId view_id = AddViewToLocalize(
+      "view", track_ids, kNumPoints, &reconstruction, &ground_truth_camera);
+  Camera* camera = reconstruction.MutableView(view_id)->MutableCamera();
+  const Eigen::Vector3d perturbed_orientation =
+      ground_truth_camera.GetOrientationAsAngleAxis() +
+      Eigen::Vector3d(1e-3, -1e-3, 1e-3);
+  camera->SetOrientationFromAngleAxis(perturbed_orientation);
+
+  LocalizeViewToReconstructionOptions options;
+  options.assume_known_orientation = true;
+  options.bundle_adjust_view = true;
+  options.ransac_params.rng = std::make_shared<RandomNumberGenerator>(59);
+  std::vector<LocalizeViewSummary> summaries;
+  ASSERT_EQ(LocalizeViewsToReconstruction(
+                {view_id}, options, &reconstruction, &summaries),
+            1);
+
+  ASSERT_EQ(summaries.size(), 1);
+  EXPECT_TRUE(summaries[0].success);
+  EXPECT_TRUE(summaries[0].refinement_summary.success);
+  EXPECT_LT(summaries[0].refinement_summary.final_cost,
+            summaries[0].refinement_summary.initial_cost);
+  EXPECT_LT((camera->GetOrientationAsAngleAxis() -
+             ground_truth_camera.GetOrientationAsAngleAxis())
+                .norm(),
+            1e-6);
+  EXPECT_LT(
+      (camera->GetPosition() - ground_truth_camera.GetPosition()).norm(),
+      1e-6);
+  EXPECT_DOUBLE_EQ(camera->FocalLength(), kFocalLength);
+}
+
+// Creates views of one intrinsics group with unknown intrinsics that observe
+// noisy projections of the tracks.
+void CreateSharedIntrinsicsReconstruction(const int num_views,
+                                          Reconstruction* reconstruction,
+                                          std::vector<ViewId>* view_ids) {
+  static const CameraIntrinsicsGroupId kIntrinsicsGroupId = 0;
+  rng.Seed(67);
+  std::vector<TrackId> track_ids;
+  AddTracks(reconstruction, &track_ids);
+  for (int i = 0; i < num_views; i++) {
+    Camera ground_truth_camera;
+    SetIntrinsics(&ground_truth_camera);
+    ground_truth_camera.SetOrientationFromAngleAxis(0.1 * rng.RandVector3d());
+    ground_truth_camera.SetPosition(rng.RandVector3d());
+
+    const ViewId view_id = reconstruction->AddView(
+        "view" + std::to_string(i), kIntrinsicsGroupId, i);
+    SetIntrinsics(reconstruction->MutableView(view_id)->MutableCamera());
+    AddObservations(view_id,
+                    track_ids,
+                    kNumPoints,
+                    0.5,
+                    ground_truth_camera,
+                    reconstruction);
+    view_ids->emplace_back(view_id);
+  }
+}
+
+// Views of one intrinsics group that are localized with unknown intrinsics
+// each estimate a focal length. The shared focal length must not depend on the
+// order in which the views are passed.
+TEST(LocalizeViewsToReconstruction, SharedFocalLengthIsOrderIndependent) {
+  static const int kNumViews = 3;
+  LocalizeViewToReconstructionOptions options;
+  options.bundle_adjust_view = false;
+  options.num_threads = 2;
+
+  std::vector<double> focal_lengths;
+  for (const bool reverse : {false, true}) {
+    Reconstruction reconstruction;
+    std::vector<ViewId> view_ids;
+    CreateSharedIntrinsicsReconstruction(kNumViews, &reconstruction, &view_ids);
+    if (reverse) {
+      std::reverse(view_ids.begin(), view_ids.end());
+    }
+
+    options.ransac_params.rng = std::make_shared<RandomNumberGenerator>(59);
+    std::vector<LocalizeViewSummary> summaries;
+    ASSERT_EQ(LocalizeViewsToReconstruction(
+                  view_ids, options, &reconstruction, &summaries),
+              kNumViews);
+    focal_lengths.emplace_back(
+        reconstruction.View(view_ids[0])->Camera().FocalLength());
+    for (const ViewId view_id : view_ids) {
+      EXPECT_EQ(reconstruction.View(view_id)->Camera().FocalLength(),
+                focal_lengths.back());
+    }
+  }
+  EXPECT_EQ(focal_lengths[0], focal_lengths[1]);
+  EXPECT_NEAR(focal_lengths[0], kFocalLength, 0.05 * kFocalLength);
+}
+
+}  // namespace theia
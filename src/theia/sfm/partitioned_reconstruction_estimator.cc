@@ -0,0 +1,614 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/sfm/partitioned_reconstruction_estimator.h"
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <sstream>  // NOLINT
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "theia/io/reconstruction_reader.h"
+#include "theia/io/reconstruction_writer.h"
+#include "theia/sfm/bundle_adjustment/bundle_adjustment.h"
+#include "theia/sfm/camera/camera.h"
+#include "theia/sfm/estimate_track.h"
+#include "theia/sfm/reconstruction.h"
+#include "theia/sfm/reconstruction_estimator_options.h"
+#include "theia/sfm/reconstruction_estimator_utils.h"
+#include "theia/sfm/select_good_tracks_for_bundle_adjustment.h"
+#include "theia/sfm/set_outlier_tracks_to_unestimated.h"
+#include "theia/sfm/transformation/align_reconstructions.h"
+#include "theia/sfm/view_graph/partition_view_graph.h"
+#include "theia/sfm/view_graph/view_graph.h"
+#include "theia/util/filesystem.h"
+#include "theia/util/map_util.h"
+#include "theia/util/random.h"
+#include "theia/util/stringprintf.h"
+#include "theia/util/threadpool.h"
+#include "theia/util/timer.h"
+
+namespace theia {
+
+namespace {
+
+// All times are given in seconds.
+struct PartitionedReconstructionEstimatorTimings {
+  double partitioning_time = 0.0;
+  double partition_estimation_time = 0.0;
+  double merging_time = 0.0;
+};
+
+// Views in a sub-reconstruction share their camera intrinsics with the
+// reconstruction they were extracted from. Each partition gets its own copy of
+// the intrinsics so that partitions that are estimated in parallel do not
+// modify the same intrinsics. Views in the same intrinsics group still share a
+// single copy.
+void DetachCameraIntrinsics(Reconstruction* reconstruction) {
+  const auto group_ids = reconstruction->CameraIntrinsicsGroupIds();
+  for (const CameraIntrinsicsGroupId group_id : group_ids) {
+    const std::unordered_set<ViewId> view_ids =
+        reconstruction->GetViewsInCameraIntrinsicGroup(group_id);
+    if (view_ids.empty()) {
+      continue;
+    }
+
+    Camera camera;
+    camera.DeepCopy(reconstruction->View(*view_ids.begin())->Camera());
+    for (const ViewId view_id : view_ids) {
+      reconstruction->MutableView(view_id)
+          ->MutableCamera()
+          ->MutableCameraIntrinsics() = camera.CameraIntrinsics();
+    }
+  }
+}
+
+// Returns the median distance of the camera positions from their centroid,
+// which is used to express the alignment threshold relative to the extent of
+// the common views.
+double MedianCameraDistanceFromCentroid(const Reconstruction& reconstruction) {
+  const std::vector<ViewId> view_ids = reconstruction.ViewIds();
+  if (view_ids.empty()) {
+    return 0.0;
+  }
+
+  Eigen::Vector3d centroid = Eigen::Vector3d::Zero();
+  for (const ViewId view_id : view_ids) {
+    centroid += reconstruction.View(view_id)->Camera().GetPosition();
+  }
+  centroid /= static_cast<double>(view_ids.size());
+
+  std::vector<double> distances;
+  distances.reserve(view_ids.size());
+  for (const ViewId view_id : view_ids) {
+    distances.emplace_back(
+        (reconstruction.View(view_id)->Camera().GetPosition() - centroid)
+            .norm());
+  }
+  std::nth_element(distances.begin(),
+                   distances.begin() + distances.size() / 2,
+                   distances.end());
+  return distances[distances.size() / 2];
+}
+
+void SetUnderconstrainedAsUnestimated(Reconstruction* reconstruction) {
+  int num_underconstrained_views = -1;
+  int num_underconstrained_tracks = -1;
+  while (num_underconstrained_views != 0 && num_underconstrained_tracks != 0) {
+    num_underconstrained_views =
+        SetUnderconstrainedViewsToUnestimated(reconstruction);
+    num_underconstrained_tracks =
+        SetUnderconstrainedTracksToUnestimated(reconstruction);
+  }
+}
+
+}  // namespace
+
+PartitionedReconstructionEstimator::PartitionedReconstructionEstimator(
+    const ReconstructionEstimatorOptions& options) {
+  CHECK(options.partition_reconstruction_estimator_type !=
+        ReconstructionEstimatorType::PARTITIONED)
+      << "The partitions must be estimated with a global, incremental, or "
+         "hybrid reconstruction estimator.";
+  CHECK_GT(options.partition_num_parallel_reconstructions, 0);
+  // At least 4 views are needed to estimate a similarity transformation with
+  // RANSAC.
+  CHECK_GE(options.partition_min_num_common_views, 4)
+      << "At least 4 common views are required to align partitions.";
+  CHECK_GT(options.partition_alignment_max_relative_position_error, 0.0);
+
+  options_ = options;
+}
+
+PartitionedReconstructionEstimator::~PartitionedReconstructionEstimator() {
+  RemoveTemporaryPartitionDirectory();
+}
+
+bool PartitionedReconstructionEstimator::CreatePartitionDirectory() {
+  RemoveTemporaryPartitionDirectory();
+  partition_directory_.clear();
+  if (options_.partition_keep_in_memory) {
+    return true;
+  }
+
+  if (!options_.partition_directory.empty()) {
+    partition_directory_ = options_.partition_directory;
+    return true;
+  }
+
+  if (!CreateTemporaryDirectory("theia_partitions_", &partition_directory_)) {
+    LOG(ERROR) << "Could not create a temporary directory for the partitions.";
+    return false;
+  }
+  is_temporary_partition_directory_ = true;
+  VLOG(2) << "Writing the estimated partitions to " << partition_directory_;
+  return true;
+}
+
+void PartitionedReconstructionEstimator::RemoveTemporaryPartitionDirectory() {
+  if (!is_temporary_partition_directory_) {
+    return;
+  }
+  if (!RemoveDirectory(partition_directory_)) {
+    LOG(WARNING) << "Could not remove the temporary partition directory "
+                 << partition_directory_;
+  }
+  is_temporary_partition_directory_ = false;
+}
+
+ReconstructionEstimatorSummary PartitionedReconstructionEstimator::Estimate(
+    ViewGraph* view_graph, Reconstruction* reconstruction) {
+  CHECK_NOTNULL(reconstruction);
+  CHECK_NOTNULL(view_graph);
+  reconstruction_ = reconstruction;
+  view_graph_ = view_graph;
+  partitions_.clear();
+  merged_views_.clear();
+  merged_intrinsics_groups_.clear();
+
+  ReconstructionEstimatorSummary summary;
+  PartitionedReconstructionEstimatorTimings partitioned_estimator_timings;
+  Timer total_timer;
+  Timer timer;
+
+  // Step 1. Partition the view graph.
+  LOG(INFO) << "Partitioning the view graph.";
+  timer.Reset();
+  PartitionViewGraphOptions partition_options;
+  partition_options.max_num_views_per_partition =
+      options_.partition_max_num_views;
+  partition_options.overlap_percent = options_.partition_overlap_percent;
+  partition_options.min_num_overlapping_views =
+      options_.partition_min_num_overlapping_views;
+  std::vector<std::unordered_set<ViewId> > view_partitions;
+  if (!PartitionViewGraph(partition_options, *view_graph_, &view_partitions)) {
+    LOG(WARNING) << "The view graph could not be partitioned.";
+    return summary;
+  }
+  partitioned_estimator_timings.partitioning_time =
+      timer.ElapsedTimeInSeconds();
+  LOG(INFO) << "Partitioned " << view_graph_->NumViews() << " views into "
+            << view_partitions.size() << " partitions.";
+
+  // If the view graph is small enough there is nothing to merge, so the entire
+  // reconstruction is estimated directly.
+  if (view_partitions.size() == 1) {
+    ReconstructionEstimatorOptions partition_estimator_options = options_;
+    partition_estimator_options.reconstruction_estimator_type =
+        options_.partition_reconstruction_estimator_type;
+    std::unique_ptr<ReconstructionEstimator> reconstruction_estimator(
+        ReconstructionEstimator::Create(partition_estimator_options));
+    return reconstruction_estimator->Estimate(view_graph_, reconstruction_);
+  }
+
+  // Step 2. Estimate each partition independently. The random seeds are drawn
+  // up front so that the results do not depend on the scheduling of the
+  // partitions.
+  LOG(INFO) << "Estimating " << view_partitions.size() << " partitions.";
+  timer.Reset();
+  std::shared_ptr<RandomNumberGenerator> rng = options_.rng;
+  if (rng == nullptr) {
+    rng = std::make_shared<RandomNumberGenerator>();
+  }
+  std::vector<unsigned> rng_seeds(view_partitions.size());
+  for (unsigned& rng_seed : rng_seeds) {
+    rng_seed = rng->RandInt(0, std::numeric_limits<int>::max());
+  }
+
+  if (!CreatePartitionDirectory()) {
+    return summary;
+  }
+
+  // The parallel loops within each partition share the threads of the
+  // scheduler with the other partitions.
+  partitions_.resize(view_partitions.size());
+  ParallelFor(options_.partition_num_parallel_reconstructions,
+              view_partitions.size(),
+              [&](const int i) {
+                EstimatePartition(i, view_partitions[i], rng_seeds[i]);
+              });
+  partitioned_estimator_timings.partition_estimation_time =
+      timer.ElapsedTimeInSeconds();
+
+  // Step 3. Align and merge the partitions.
+  LOG(INFO) << "Merging the estimated partitions.";
+  timer.Reset();
+  const int num_merged_partitions = MergePartitions();
+  RemoveTemporaryPartitionDirectory();
+  partitioned_estimator_timings.merging_time = timer.ElapsedTimeInSeconds();
+  if (num_merged_partitions == 0) {
+    LOG(WARNING) << "None of the partitions could be estimated.";
+    return summary;
+  }
+  LOG(INFO) << "Merged " << num_merged_partitions << " of "
+            << partitions_.size() << " partitions with "
+            << merged_views_.size() << " views.";
+
+  // The estimated partitions are no longer needed.
+  partitions_.clear();
+
+  summary.pose_estimation_time =
+      partitioned_estimator_timings.partition_estimation_time +
+      partitioned_estimator_timings.merging_time;
+
+  // Step 4. Triangulate the tracks that were not estimated in any partition and
+  // bundle adjust the merged reconstruction.
+  for (int i = 0; i < options_.num_retriangulation_iterations + 1; i++) {
+    LOG(INFO) << "Triangulating all features.";
+    timer.Reset();
+    EstimateStructure();
+    summary.triangulation_time += timer.ElapsedTimeInSeconds();
+
+    SetUnderconstrainedAsUnestimated(reconstruction_);
+
+    LOG(INFO) << "Performing bundle adjustment.";
+    timer.Reset();
+    if (!BundleAdjustment()) {
+      summary.success = false;
+      LOG(WARNING) << "Bundle adjustment failed!";
+      return summary;
+    }
+    summary.bundle_adjustment_time += timer.ElapsedTimeInSeconds();
+
+    const int num_points_removed =
+        SetOutlierTracksToUnestimated(options_.max_reprojection_error_in_pixels,
+                                      options_.min_triangulation_angle_degrees,
+                                      reconstruction_);
+    LOG(INFO) << num_points_removed << " outlier points were removed.";
+  }
+
+  // Set the output parameters.
+  GetEstimatedViewsFromReconstruction(*reconstruction_,
+                                      &summary.estimated_views);
+  GetEstimatedTracksFromReconstruction(*reconstruction_,
+                                       &summary.estimated_tracks);
+  summary.success = true;
+  summary.total_time = total_timer.ElapsedTimeInSeconds();
+
+  // Output some timing statistics.
+  std::ostringstream string_stream;
+  string_stream << "Partitioned Reconstruction Estimator timings:"
+                << "\n\tView graph partitioning time = "
+                << partitioned_estimator_timings.partitioning_time
+                << "\n\tPartition estimation time = "
+                << partitioned_estimator_timings.partition_estimation_time
+                << "\n\tPartition merging time = "
+                << partitioned_estimator_timings.merging_time;
+  summary.message = string_stream.str();
+
+  return summary;
+}
+
+void PartitionedReconstructionEstimator::EstimatePartition(
+    const int partition_index,
+    const std::unordered_set<ViewId>& views,
+    const unsigned rng_seed) {
+  EstimatedPartition& partition = partitions_[partition_index];
+
+  // Extract the partition. View and track ids are preserved.
+  ViewGraph partition_view_graph;
+  view_graph_->ExtractSubgraph(views, &partition_view_graph);
+  std::unique_ptr<Reconstruction> partition_reconstruction(
+      new Reconstruction());
+  reconstruction_->GetSubReconstruction(views, partition_reconstruction.get());
+  DetachCameraIntrinsics(partition_reconstruction.get());
+
+  // The threads are divided between the partitions that are estimated in
+  // parallel.
+  ReconstructionEstimatorOptions partition_estimator_options = options_;
+  partition_estimator_options.reconstruction_estimator_type =
+      options_.partition_reconstruction_estimator_type;
+  partition_estimator_options.num_threads =
+      std::max(1,
+               options_.num_threads /
+                   options_.partition_num_parallel_reconstructions);
+  partition_estimator_options.rng =
+      std::make_shared<RandomNumberGenerator>(rng_seed);
+
+  std::unique_ptr<ReconstructionEstimator> reconstruction_estimator(
+      ReconstructionEstimator::Create(partition_estimator_options));
+  const ReconstructionEstimatorSummary summary =
+      reconstruction_estimator->Estimate(&partition_view_graph,
+                                         partition_reconstruction.get());
+  if (!summary.success) {
+    LOG(WARNING) << "Partition " << partition_index << " with " << views.size()
+                 << " views could not be estimated.";
+    return;
+  }
+
+  // Only the estimated views and tracks are needed for merging.
+  std::unique_ptr<Reconstruction> estimated_reconstruction(
+      new Reconstruction());
+  CreateEstimatedSubreconstruction(*partition_reconstruction,
+                                   estimated_reconstruction.get());
+  partition_reconstruction.reset();
+
+  const std::vector<ViewId> estimated_view_ids =
+      estimated_reconstruction->ViewIds();
+  partition.estimated_views.insert(estimated_view_ids.begin(),
+                                   estimated_view_ids.end());
+  LOG(INFO) << "Estimated " << partition.estimated_views.size() << " of "
+            << views.size() << " views in partition " << partition_index
+            << ".";
+
+  if (partition_directory_.empty()) {
+    partition.reconstruction = std::move(estimated_reconstruction);
+  } else {
+    partition.filepath = StringPrintf("%s/partition_%d.bin",
+                                      partition_directory_.c_str(),
+                                      partition_index);
+    if (!WriteReconstruction(*estimated_reconstruction, partition.filepath)) {
+      LOG(ERROR) << "Could not write partition " << partition_index << " to "
+                 << partition.filepath;
+      return;
+    }
+  }
+  partition.success = true;
+}
+
+std::unique_ptr<Reconstruction>
+PartitionedReconstructionEstimator::LoadPartition(const int partition_index) {
+  EstimatedPartition& partition = partitions_[partition_index];
+  if (partition.filepath.empty()) {
+    return std::move(partition.reconstruction);
+  }
+
+  std::unique_ptr<Reconstruction> partition_reconstruction(
+      new Reconstruction());
+  if (!ReadReconstruction(partition.filepath,
+                          partition_reconstruction.get())) {
+    LOG(ERROR) << "Could not read partition " << partition_index << " from "
+               << partition.filepath;
+    return nullptr;
+  }
+  return partition_reconstruction;
+}
+
+int PartitionedReconstructionEstimator::MergePartitions() {
+  // Only the views and tracks of the merged partitions should be estimated in
+  // the output reconstruction.
+  for (const ViewId view_id : reconstruction_->ViewIds()) {
+    reconstruction_->MutableView(view_id)->SetEstimated(false);
+  }
+  for (const TrackId track_id : reconstruction_->TrackIds()) {
+    reconstruction_->MutableTrack(track_id)->SetEstimated(false);
+  }
+
+  std::vector<bool> is_merged(partitions_.size(), false);
+  int num_merged_partitions = 0;
+  while (true) {
+    // Choose the partition with the most views in common with the merged
+    // model. The first partition is the one with the most estimated views.
+    int best_partition_index = -1;
+    int best_num_views = 0;
+    for (int i = 0; i < partitions_.size(); i++) {
+      if (is_merged[i] || !partitions_[i].success) {
+        continue;
+      }
+
+      int num_views = 0;
+      for (const ViewId view_id : partitions_[i].estimated_views) {
+        if (merged_views_.empty() || ContainsKey(merged_views_, view_id)) {
+          ++num_views;
+        }
+      }
+      if (num_views > best_num_views) {
+        best_partition_index = i;
+        best_num_views = num_views;
+      }
+    }
+
+    if (best_partition_index < 0 ||
+        (num_merged_partitions > 0 &&
+         best_num_views < options_.partition_min_num_common_views)) {
+      break;
+    }
+    is_merged[best_partition_index] = true;
+
+    std::unique_ptr<Reconstruction> partition_reconstruction =
+        LoadPartition(best_partition_index);
+    if (partition_reconstruction == nullptr) {
+      continue;
+    }
+
+    // Align the partition to the merged model through the positions of the
+    // common views.
+    if (num_merged_partitions > 0) {
+      std::unordered_set<ViewId> common_views;
+      for (const ViewId view_id :
+           partitions_[best_partition_index].estimated_views) {
+        if (ContainsKey(merged_views_, view_id)) {
+          common_views.insert(view_id);
+        }
+      }
+      Reconstruction common_reconstruction;
+      reconstruction_->GetSubReconstruction(common_views,
+                                            &common_reconstruction);
+
+      const double alignment_threshold =
+          options_.partition_alignment_max_relative_position_error *
+          MedianCameraDistanceFromCentroid(common_reconstruction);
+      if (alignment_threshold <= 0.0) {
+        LOG(WARNING) << "The common views of partition "
+                     << best_partition_index
+                     << " are degenerate. The partition will not be merged.";
+        continue;
+      }
+      AlignReconstructionsRobust(alignment_threshold,
+                                 common_reconstruction,
+                                 partition_reconstruction.get());
+    }
+
+    MergePartition(*partition_reconstruction);
+    ++num_merged_partitions;
+    VLOG(2) << "Merged partition " << best_partition_index << " with "
+            << best_num_views << " common views.";
+  }
+
+  for (int i = 0; i < partitions_.size(); i++) {
+    if (partitions_[i].success && !is_merged[i]) {
+      LOG(WARNING) << "Partition " << i << " does not have enough views in "
+                   << "common with the merged model and was not merged.";
+    }
+  }
+  return num_merged_partitions;
+}
+
+void PartitionedReconstructionEstimator::MergePartition(
+    const Reconstruction& partition_reconstruction) {
+  for (const ViewId view_id : partition_reconstruction.ViewIds()) {
+    const View* partition_view = partition_reconstruction.View(view_id);
+    View* view = reconstruction_->MutableView(view_id);
+    if (view == nullptr || !partition_view->IsEstimated() ||
+        view->IsEstimated()) {
+      continue;
+    }
+
+    const Camera& partition_camera = partition_view->Camera();
+    Camera* camera = view->MutableCamera();
+    camera->SetPosition(partition_camera.GetPosition());
+    camera->SetOrientationFromAngleAxis(
+        partition_camera.GetOrientationAsAngleAxis());
+    camera->SetImageSize(partition_camera.ImageWidth(),
+                         partition_camera.ImageHeight());
+
+    // Views in the same intrinsics group share their intrinsics, so the
+    // intrinsics of each group are taken from the first merged partition that
+    // estimated a view of the group.
+    const CameraIntrinsicsGroupId group_id =
+        reconstruction_->CameraIntrinsicsGroupIdFromViewId(view_id);
+    if (!ContainsKey(merged_intrinsics_groups_, group_id) &&
+        camera->GetCameraIntrinsicsModelType() ==
+            partition_camera.GetCameraIntrinsicsModelType()) {
+      std::copy(partition_camera.intrinsics(),
+                partition_camera.intrinsics() +
+                    partition_camera.CameraIntrinsics()->NumParameters(),
+                camera->mutable_intrinsics());
+      merged_intrinsics_groups_.insert(group_id);
+    }
+
+    view->SetEstimated(true);
+    merged_views_.insert(view_id);
+  }
+
+  for (const TrackId track_id : partition_reconstruction.TrackIds()) {
+    const Track* partition_track = partition_reconstruction.Track(track_id);
+    Track* track = reconstruction_->MutableTrack(track_id);
+    if (track == nullptr || !partition_track->IsEstimated() ||
+        track->IsEstimated()) {
+      continue;
+    }
+
+    *track->MutablePoint() = partition_track->Point();
+    track->SetEstimated(true);
+  }
+}
+
+void PartitionedReconstructionEstimator::EstimateStructure() {
+  // Estimate all tracks.
+  TrackEstimator::Options triangulation_options;
+  triangulation_options.max_acceptable_reprojection_error_pixels =
+      options_.triangulation_max_reprojection_error_in_pixels;
+  triangulation_options.min_triangulation_angle_degrees =
+      options_.min_triangulation_angle_degrees;
+  triangulation_options.bundle_adjustment = options_.bundle_adjust_tracks;
+  triangulation_options.ba_options = SetBundleAdjustmentOptions(options_, 0);
+  triangulation_options.ba_options.num_threads = 1;
+  triangulation_options.ba_options.verbose = false;
+  triangulation_options.num_threads = options_.num_threads;
+  triangulation_options.triangulation_method = options_.triangulation_method;
+  TrackEstimator track_estimator(triangulation_options, reconstruction_);
+  const TrackEstimator::Summary summary = track_estimator.EstimateAllTracks();
+}
+
+bool PartitionedReconstructionEstimator::BundleAdjustment() {
+  std::unordered_set<ViewId> views_to_optimize;
+  GetEstimatedViewsFromReconstruction(*reconstruction_, &views_to_optimize);
+  const BundleAdjustmentOptions bundle_adjustment_options =
+      SetBundleAdjustmentOptions(options_, views_to_optimize.size());
+
+  // If desired, select good tracks to optimize for BA. This dramatically
+  // reduces the number of parameters in bundle adjustment.
+  std::unordered_set<TrackId> tracks_to_optimize;
+  if (ShouldSubsampleTracksForBundleAdjustment(options_, *reconstruction_) &&
+      SelectGoodTracksForBundleAdjustment(
+          *reconstruction_,
+          options_.track_subset_selection_long_track_length_threshold,
+          options_.track_selection_image_grid_cell_size_pixels,
+          options_.min_num_optimized_tracks_per_view,
+          &tracks_to_optimize)) {
+    // Set all tracks that were not chosen for BA to be unestimated so that they
+    // do not affect the bundle adjustment optimization.
+    const auto& view_ids = reconstruction_->ViewIds();
+    SetTracksInViewsToUnestimated(
+        view_ids, tracks_to_optimize, reconstruction_);
+  } else {
+    GetEstimatedTracksFromReconstruction(*reconstruction_, &tracks_to_optimize);
+  }
+  LOG(INFO) << "Selected " << tracks_to_optimize.size()
+            << " tracks to optimize.";
+
+  const BundleAdjustmentSummary bundle_adjustment_summary =
+      BundleAdjustPartialReconstruction(bundle_adjustment_options,
+                                        views_to_optimize,
+                                        tracks_to_optimize,
+                                        reconstruction_);
+  return bundle_adjustment_summary.success;
+}
+
+}  // namespace theia
@@ -0,0 +1,138 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_SFM_PARTITIONED_RECONSTRUCTION_ESTIMATOR_H_
+#define THEIA_SFM_PARTITIONED_RECONSTRUCTION_ESTIMATOR_H_
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "theia/sfm/reconstruction_estimator.h"
+#include "theia/sfm/reconstruction_estimator_options.h"
+#include "theia/sfm/types.h"
+#include "theia/util/util.h"
+
+namespace theia {
+
+class Reconstruction;
+class ViewGraph;
+
+// Estimates the camera poses and 3D structure of large scenes by divide and
+// conquer. The pipeline is as follows:
+//   1) Partition the view graph into overlapping clusters of strongly connected
+//      views with recursive normalized graph cuts.
+//   2) Estimate each partition independently (and in parallel) with the
+//      reconstruction estimator specified by
+//      partition_reconstruction_estimator_type. Estimated partitions are
+//      written to disk (unless partition_keep_in_memory is set) so that only
+//      the partitions currently being estimated are held in memory.
+//   3) Starting with the largest partition, repeatedly align the partition with
+//      the most views in common with the merged model through a robust
+//      similarity transformation and merge its cameras and points.
+//   4) Triangulate the remaining tracks and bundle adjust the merged model.
+//
+// View and track ids are preserved in the partitions, so views and tracks that
+// are shared between partitions are merged by id.
+class PartitionedReconstructionEstimator : public ReconstructionEstimator {
+ public:
+  PartitionedReconstructionEstimator(
+      const ReconstructionEstimatorOptions& options);
+  ~PartitionedReconstructionEstimator();
+
+  ReconstructionEstimatorSummary Estimate(ViewGraph* view_graph,
+                                          Reconstruction* reconstruction);
+
+ private:
+  // The result of estimating a single partition. Only the estimated views are
+  // kept in memory once the partition has been estimated. The partition itself
+  // is either kept in memory or written to a file.
+  struct EstimatedPartition {
+    bool success = false;
+    std::unordered_set<ViewId> estimated_views;
+    std::unique_ptr<Reconstruction> reconstruction;
+    std::string filepath;
+  };
+
+  // Estimates the partition with the given index. This is thread-safe as long
+  // as each thread estimates a different partition.
+  void EstimatePartition(const int partition_index,
+                         const std::unordered_set<ViewId>& views,
+                         const unsigned rng_seed);
+
+  // Retrieves the estimated partition from memory or disk. Returns a nullptr
+  // if the partition cannot be read.
+  std::unique_ptr<Reconstruction> LoadPartition(const int partition_index);
+
+  // Sets up the directory that the estimated partitions are written to.
+  // Returns false if a temporary directory is needed and cannot be created.
+  bool CreatePartitionDirectory();
+
+  // Removes the temporary partition directory, if one was created.
+  void RemoveTemporaryPartitionDirectory();
+
+  // Aligns and merges all partitions that can be aligned with the merged
+  // model. Returns the number of merged partitions.
+  int MergePartitions();
+
+  // Copies the estimated cameras and points of the partition to the output
+  // reconstruction. Views and tracks that have been estimated by a previously
+  // merged partition are not modified.
+  void MergePartition(const Reconstruction& partition_reconstruction);
+
+  void EstimateStructure();
+  bool BundleAdjustment();
+
+  ViewGraph* view_graph_;
+  Reconstruction* reconstruction_;
+
+  ReconstructionEstimatorOptions options_;
+
+  std::vector<EstimatedPartition> partitions_;
+
+  // The directory that the estimated partitions are written to, which is empty
+  // if the partitions are kept in memory, and whether it is a temporary
+  // directory that is removed after merging.
+  std::string partition_directory_;
+  bool is_temporary_partition_directory_ = false;
+
+  // The views of the output reconstruction that have been merged, and the
+  // intrinsics groups whose intrinsics have been set from a partition.
+  std::unordered_set<ViewId> merged_views_;
+  std::unordered_set<CameraIntrinsicsGroupId> merged_intrinsics_groups_;
+
+  DISALLOW_COPY_AND_ASSIGN(PartitionedReconstructionEstimator);
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SFM_PARTITIONED_RECONSTRUCTION_ESTIMATOR_H_
@@ -38,6 +38,8 @@
 #include <Eigen/LU>
 #include <Eigen/SVD>
 #include <glog/logging.h>
+#include <limits>
+#include <vector>
 
 #include "theia/math/polynomial.h"
 #include "theia/sfm/pose/util.h"
@@ -48,6 +50,7 @@ using Eigen::DiagonalMatrix;
 using Eigen::Map;
 using Eigen::Matrix;
 using Eigen::Matrix3d;
+using Eigen::Vector2d;
 using Eigen::Vector3d;
 
 // Given a fundmental matrix, decompose the fundmental matrix and recover focal
@@ -268,4 +271,79 @@ void ComposeFundamentalMatrix(const double focal_length1,
       calibration_inv2 * CrossProductMatrix(trans) * rot * calibration_inv1;
 }
 
+bool HomographyFromFundamentalMatrix(const double fmatrix[3 * 3],
+                                     const std::vector<Vector2d>& image1_points,
+                                     const std::vector<Vector2d>& image2_points,
+                                     double homography[3 * 3]) {
+  CHECK_EQ(image1_points.size(), 3);
+  CHECK_EQ(image2_points.size(), 3);
+  const Map<const Matrix3d> fundamental_matrix(fmatrix);
+
+  // The epipole in the second image is the left null vector of F.
+  Eigen::JacobiSVD<Matrix3d> svd(fundamental_matrix, Eigen::ComputeFullU);
+  const Vector3d epipole2 = svd.matrixU().col(2);
+  const Matrix3d a = CrossProductMatrix(epipole2) * fundamental_matrix;
+
+  // Every homography compatible with F has the form H = A - e' * v^t. The plane
+  // vector v is found from H * x_i ~ x'_i, i.e. M * v = b where the rows of M
+  // are x_i^t.
+  Matrix3d m;
+  Vector3d b;
+  for (int i = 0; i < 3; i++) {
+    const Vector3d point1 = image1_points[i].homogeneous();
+    const Vector3d point2 = image2_points[i].homogeneous();
+    const Vector3d point2_cross_epipole = point2.cross(epipole2);
+    const double sq_norm = point2_cross_epipole.squaredNorm();
+    if (sq_norm < std::numeric_limits<double>::epsilon()) {
+      return false;
+    }
+    m.row(i) = point1.transpose();
+    b[i] = point2.cross(a * point1).dot(point2_cross_epipole) / sq_norm;
+  }
+
+  const Eigen::FullPivLU<Matrix3d> lu(m);
+  if (!lu.isInvertible()) {
+    return false;
+  }
+  Map<Matrix3d> homography_matrix(homography);
+  homography_matrix = a - epipole2 * lu.solve(b).transpose();
+  return true;
+}
+
+bool FundamentalMatrixFromHomographyAndParallax(
+    const double homography[3 * 3],
+    const std::vector<Vector2d>& image1_points,
+    const std::vector<Vector2d>& image2_points,
+    double fmatrix[3 * 3]) {
+  CHECK_EQ(image1_points.size(), image2_points.size());
+  if (image1_points.size() < 2) {
+    return false;
+  }
+  const Map<const Matrix3d> homography_matrix(homography);
+
+  // The epipole lies on the line through each point x' and its transfer H * x
+  // since both are projections of the ray through the 3D point.
+  Matrix<double, Eigen::Dynamic, 3> lines(image1_points.size(), 3);
+  for (int i = 0; i < image1_points.size(); i++) {
+    const Vector3d line = (homography_matrix * image1_points[i].homogeneous())
+                              .cross(image2_points[i].homogeneous());
+    const double norm = line.norm();
+    if (norm < std::numeric_limits<double>::epsilon()) {
+      return false;
+    }
+    lines.row(i) = line.transpose() / norm;
+  }
+
+  // The epipole is undefined if all lines are the same.
+  Eigen::JacobiSVD<Matrix<double, Eigen::Dynamic, 3> > svd(lines,
+                                                           Eigen::ComputeFullV);
+  if (svd.singularValues()[1] < 1e-8 * svd.singularValues()[0]) {
+    return false;
+  }
+  const Vector3d epipole2 = svd.matrixV().col(2);
+  Map<Matrix3d> fundamental_matrix(fmatrix);
+  fundamental_matrix = CrossProductMatrix(epipole2) * homography_matrix;
+  return true;
+}
+
 }  // namespace theia
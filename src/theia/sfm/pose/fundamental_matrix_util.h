@@ -35,6 +35,9 @@
 #ifndef THEIA_SFM_POSE_FUNDAMENTAL_MATRIX_UTIL_H_
 #define THEIA_SFM_POSE_FUNDAMENTAL_MATRIX_UTIL_H_
 
+#include <Eigen/Core>
+#include <vector>
+
 namespace theia {
 
 // Given a fundmental matrix, decompose the fundmental matrix and recover focal
@@ -84,6 +87,30 @@ void ComposeFundamentalMatrix(const double focal_length1,
                               const double translation[3],
                               double fmatrix[3 * 3]);
 
+// Computes the homography induced by the plane through the 3D points of three
+// correspondences image1_points[i] <-> image2_points[i] that is compatible with
+// the fundamental matrix, i.e. H^t * F is skew-symmetric (see Hartley and
+// Zisserman, Result 13.6). The fundamental matrix is such that
+// image2_point^t * F * image1_point = 0. Returns false if the three points are
+// collinear or a point in the second image coincides with the epipole.
+bool HomographyFromFundamentalMatrix(
+    const double fmatrix[3 * 3],
+    const std::vector<Eigen::Vector2d>& image1_points,
+    const std::vector<Eigen::Vector2d>& image2_points,
+    double homography[3 * 3]);
+
+// Recovers the fundamental matrix F = [e']_x * H from a homography and the
+// parallax of at least two correspondences that are not on the plane of the
+// homography (plane and parallax, see Hartley and Zisserman, Algorithm 13.2).
+// The epipole e' is the (least-squares) intersection of the lines through
+// image2_points[i] and H * image1_points[i]. Returns false if the epipole is
+// not constrained by the correspondences.
+bool FundamentalMatrixFromHomographyAndParallax(
+    const double homography[3 * 3],
+    const std::vector<Eigen::Vector2d>& image1_points,
+    const std::vector<Eigen::Vector2d>& image2_points,
+    double fmatrix[3 * 3]);
+
 }  // namespace theia
 
 #endif  // THEIA_SFM_POSE_FUNDAMENTAL_MATRIX_UTIL_H_
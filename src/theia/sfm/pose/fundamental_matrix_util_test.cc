@@ -37,6 +37,7 @@
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <cmath>
+#include <vector>
 
 #include "theia/sfm/pose/util.h"
 #include "theia/sfm/types.h"
@@ -47,6 +48,7 @@ namespace theia {
 
 using Eigen::Matrix3d;
 using Eigen::Quaterniond;
+using Eigen::Vector2d;
 using Eigen::Vector3d;
 
 RandomNumberGenerator rng(51);
@@ -144,4 +146,131 @@ TEST(FundamentalMatrixUtil, FundamentalMatrixFromProjectionMatrices) {
   }
 }
 
+// Projects the 3D point into both cameras of the fundamental matrix composed
+// from the focal lengths, rotation and translation.
+void ProjectToImages(const double focal_length1,
+                     const double focal_length2,
+                     const Matrix3d& rotation,
+                     const Vector3d& translation,
+                     const Vector3d& point_3d,
+                     Vector2d* image1_point,
+                     Vector2d* image2_point) {
+  *image1_point = focal_length1 * point_3d.hnormalized();
+  *image2_point =
+      focal_length2 * (rotation * point_3d + translation).hnormalized();
+}
+
+TEST(FundamentalMatrixUtil, HomographyFromFundamentalMatrix) {
+  static const double kTolerance = 1e-6;
+  static const int kNumPoints = 10;
+  static const double kFocalLength1 = 800.0;
+  static const double kFocalLength2 = 1000.0;
+
+  for (int i = 0; i < 100; i++) {
+    const Matrix3d rotation =
+        Eigen::AngleAxisd(0.2, rng.RandVector3d().normalized())
+            .toRotationMatrix();
+    const Vector3d translation = rng.RandVector3d().normalized();
+    Matrix3d fmatrix;
+    ComposeFundamentalMatrix(kFocalLength1,
+                             kFocalLength2,
+                             rotation.data(),
+                             translation.data(),
+                             fmatrix.data());
+
+    // Project points of a random plane in front of the cameras.
+    const Vector3d plane_origin = rng.RandVector3d() + Vector3d(0, 0, 6);
+    const Vector3d plane_axis1 = rng.RandVector3d();
+    const Vector3d plane_axis2 = rng.RandVector3d();
+    std::vector<Vector2d> image1_points(kNumPoints), image2_points(kNumPoints);
+    for (int j = 0; j < kNumPoints; j++) {
+      const Vector3d point_3d = plane_origin +
+                                rng.RandDouble(-1.0, 1.0) * plane_axis1 +
+                                rng.RandDouble(-1.0, 1.0) * plane_axis2;
+      ProjectToImages(kFocalLength1,
+                      kFocalLength2,
+                      rotation,
+                      translation,
+                      point_3d,
+                      &image1_points[j],
+                      &image2_points[j]);
+    }
+
+    const std::vector<Vector2d> triplet1(image1_points.begin(),
+                                         image1_points.begin() + 3);
+    const std::vector<Vector2d> triplet2(image2_points.begin(),
+                                         image2_points.begin() + 3);
+    Matrix3d homography;
+    EXPECT_TRUE(HomographyFromFundamentalMatrix(
+        fmatrix.data(), triplet1, triplet2, homography.data()));
+
+    // All points on the plane must be transferred by the homography.
+    for (int j = 0; j < kNumPoints; j++) {
+      const Vector2d transferred_point =
+          (homography * image1_points[j].homogeneous()).hnormalized();
+      EXPECT_LT((transferred_point - image2_points[j]).norm(), kTolerance);
+    }
+  }
+}
+
+TEST(FundamentalMatrixUtil, FundamentalMatrixFromHomographyAndParallax) {
+  static const double kTolerance = 1e-6;
+  static const int kNumPoints = 10;
+  static const double kFocalLength1 = 800.0;
+  static const double kFocalLength2 = 1000.0;
+
+  for (int i = 0; i < 100; i++) {
+    const Matrix3d rotation =
+        Eigen::AngleAxisd(0.2, rng.RandVector3d().normalized())
+            .toRotationMatrix();
+    const Vector3d translation = rng.RandVector3d().normalized();
+
+    // The homography induced by the plane n^t * X = d.
+    const Vector3d plane_normal = Vector3d(0, 0, 1) + 0.2 * rng.RandVector3d();
+    const double plane_distance = 6.0;
+    const Matrix3d homography =
+        Eigen::DiagonalMatrix<double, 3>(kFocalLength2, kFocalLength2, 1.0) *
+        (rotation + translation * plane_normal.transpose() / plane_distance) *
+        Eigen::DiagonalMatrix<double, 3>(1.0 / kFocalLength1,
+                                         1.0 / kFocalLength1,
+                                         1.0);
+
+    // Points off the plane.
+    std::vector<Vector2d> image1_points(kNumPoints), image2_points(kNumPoints);
+    for (int j = 0; j < kNumPoints; j++) {
+      const Vector3d point_3d = rng.RandVector3d() + Vector3d(0, 0, 4);
+      ProjectToImages(kFocalLength1,
+                      kFocalLength2,
+                      rotation,
+                      translation,
+                      point_3d,
+                      &image1_points[j],
+                      &image2_points[j]);
+    }
+
+    // Two points are enough to determine the epipole.
+    const std::vector<Vector2d> pair1(image1_points.begin(),
+                                      image1_points.begin() + 2);
+    const std::vector<Vector2d> pair2(image2_points.begin(),
+                                      image2_points.begin() + 2);
+    Matrix3d fmatrix;
+    EXPECT_TRUE(FundamentalMatrixFromHomographyAndParallax(
+        homography.data(), pair1, pair2, fmatrix.data()));
+    fmatrix.normalize();
+
+    for (int j = 0; j < kNumPoints; j++) {
+      const Vector3d epipolar_line = fmatrix * image1_points[j].homogeneous();
+      EXPECT_LT(std::abs(image2_points[j].homogeneous().dot(epipolar_line)) /
+                    epipolar_line.head<2>().norm(),
+                kTolerance);
+    }
+
+    // A single correspondence does not constrain the epipole.
+    const std::vector<Vector2d> single1(1, image1_points[0]);
+    const std::vector<Vector2d> single2(1, image2_points[0]);
+    EXPECT_FALSE(FundamentalMatrixFromHomographyAndParallax(
+        homography.data(), single1, single2, fmatrix.data()));
+  }
+}
+
 }  // namespace theia
@@ -51,6 +51,7 @@
 #include "theia/sfm/types.h"
 #include "theia/sfm/view.h"
 #include "theia/util/map_util.h"
+#include "theia/util/memory_usage.h"
 #include "theia/util/util.h"
 
 namespace theia {
@@ -86,6 +87,13 @@ Reconstruction::Reconstruction()
 
 Reconstruction::~Reconstruction() {}
 
+void Reconstruction::Reserve(const int num_views, const int num_tracks) {
+  views_.reserve(num_views);
+  view_name_to_id_.reserve(num_views);
+  view_timestamp_to_id_.reserve(num_views);
+  tracks_.reserve(num_tracks);
+}
+
 ViewId Reconstruction::ViewIdFromName(const std::string& view_name) const {
   return FindWithDefault(view_name_to_id_, view_name, kInvalidViewId);
 }
@@ -373,6 +381,30 @@ bool Reconstruction::RemoveTrack(const TrackId track_id) {
 
 int Reconstruction::NumTracks() const { return tracks_.size(); }
 
+size_t Reconstruction::MemoryUsage() const {
+  size_t memory_usage =
+      sizeof(*this) + HeapMemoryUsage(view_name_to_id_) +
+      HeapMemoryUsage(view_timestamp_to_id_) + HeapMemoryUsage(views_) +
+      HeapMemoryUsage(tracks_) +
+      HeapMemoryUsage(view_id_to_camera_intrinsics_group_id_) +
+      HeapMemoryUsage(camera_intrinsics_groups_);
+  for (const auto& view_name : view_name_to_id_) {
+    memory_usage += HeapMemoryUsage(view_name.first);
+  }
+  // The views and tracks are stored in the nodes of the maps, so only the
+  // memory they allocate on their own is added.
+  for (const auto& view : views_) {
+    memory_usage += view.second.MemoryUsage() - sizeof(view.second);
+  }
+  for (const auto& track : tracks_) {
+    memory_usage += track.second.MemoryUsage() - sizeof(track.second);
+  }
+  for (const auto& group : camera_intrinsics_groups_) {
+    memory_usage += HeapMemoryUsage(group.second);
+  }
+  return memory_usage;
+}
+
 const class Track* Reconstruction::Track(const TrackId track_id) const {
   return FindOrNull(tracks_, track_id);
 }
@@ -68,6 +68,10 @@ class Reconstruction {
   Reconstruction();
   ~Reconstruction();
 
+  // Preallocates storage for the given total number of views and tracks. This
+  // avoids rehashing when a large reconstruction is built from a file.
+  void Reserve(const int num_views, const int num_tracks);
+
   // Returns the unique ViewId of the view name, or kInvalidViewId if the view
   // does not
   // exist.
@@ -140,6 +144,11 @@ class Reconstruction {
   bool RemoveTrack(const TrackId track_id);
   int NumTracks() const;
 
+  // Returns the approximate number of bytes of memory used by the views,
+  // tracks and lookup tables of the reconstruction. This visits every view and
+  // track.
+  size_t MemoryUsage() const;
+
   // Returns the Track or a nullptr if the track does not exist.
   const class Track* Track(const TrackId track_id) const;
   class Track* MutableTrack(const TrackId track_id);
@@ -35,22 +35,31 @@
 #include "theia/sfm/reconstruction_builder.h"
 
 #include <glog/logging.h>
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "theia/matching/features_and_matches_database.h"
 #include "theia/matching/image_pair_match.h"
 #include "theia/matching/rocksdb_features_and_matches_database.h"
+#include "theia/sfm/bundle_adjustment/bundle_adjustment.h"
 #include "theia/sfm/camera_intrinsics_prior.h"
+#include "theia/sfm/estimate_track.h"
 #include "theia/sfm/feature_extractor_and_matcher.h"
+#include "theia/sfm/localize_view_to_reconstruction.h"
 #include "theia/sfm/reconstruction.h"
 #include "theia/sfm/reconstruction_estimator.h"
+#include "theia/sfm/reconstruction_estimator_utils.h"
+#include "theia/sfm/set_outlier_tracks_to_unestimated.h"
+#include "theia/sfm/track.h"
 #include "theia/sfm/track_builder.h"
 #include "theia/sfm/types.h"
 #include "theia/sfm/view.h"
 #include "theia/sfm/view_graph/view_graph.h"
 #include "theia/util/filesystem.h"
+#include "theia/util/timer.h"
 
 namespace theia {
 
@@ -156,15 +165,20 @@ ReconstructionBuilder::ReconstructionBuilder(
     std::unique_ptr<ViewGraph> view_graph)
     : options_(options),
       reconstruction_(std::move(reconstruction)),
-      view_graph_(std::move(view_graph)) {
+      view_graph_(std::move(view_graph)),
+      num_online_batches_(0),
+      features_and_matches_database_(nullptr) {
   CHECK_GT(options.num_threads, 0);
   options_.reconstruction_estimator_options.rng = options.rng;
+  track_builder_.reset(
+      new TrackBuilder(options.min_track_length, options.max_track_length));
 }
 
 ReconstructionBuilder::ReconstructionBuilder(
     const ReconstructionBuilderOptions& options,
     FeaturesAndMatchesDatabase* features_and_matches_database)
     : options_(options),
+      num_online_batches_(0),
       features_and_matches_database_(features_and_matches_database) {
   CHECK_GT(options.num_threads, 0);
 
@@ -202,6 +216,11 @@ ReconstructionBuilder::ReconstructionBuilder(
 
   feature_extractor_and_matcher_.reset(new FeatureExtractorAndMatcher(
       feam_options, features_and_matches_database_));
+
+  if (options_.features_and_matches_cache_memory_budget_bytes > 0) {
+    features_and_matches_database_->SetCacheMemoryBudget(
+        options_.features_and_matches_cache_memory_budget_bytes);
+  }
 }
 
 ReconstructionBuilder::~ReconstructionBuilder() {}
@@ -223,6 +242,11 @@ bool ReconstructionBuilder::AddImage(
                                reconstruction_.get())) {
     return false;
   }
+  // Features are not extracted once ExtractAndMatchFeatures was called, so the
+  // matches of the image must be added with AddTwoViewMatch.
+  if (feature_extractor_and_matcher_ == nullptr) {
+    return true;
+  }
   return feature_extractor_and_matcher_->AddImage(image_filepath);
 }
 
@@ -249,6 +273,9 @@ bool ReconstructionBuilder::AddImageWithCameraIntrinsicsPrior(
                                reconstruction_.get())) {
     return false;
   }
+  if (feature_extractor_and_matcher_ == nullptr) {
+    return true;
+  }
   return feature_extractor_and_matcher_->AddImage(image_filepath,
                                                   camera_intrinsics_prior);
 }
@@ -354,6 +381,8 @@ bool ReconstructionBuilder::AddTwoViewMatch(const std::string& image1,
   // Add tracks to the track builder.
   AddTracksForMatch(view_id1, view_id2, matches);
 
+  online_batch_views_.insert(view_id1);
+  online_batch_views_.insert(view_id2);
   return true;
 }
 
@@ -363,9 +392,13 @@ bool ReconstructionBuilder::BuildReconstruction(
                                           "in order to create a "
                                           "reconstruction.";
 
-  // Build tracks if they were not explicitly specified.
+  // Build tracks if they were not explicitly specified. Otherwise the
+  // remaining correspondences extend the existing tracks, e.g. if tracks were
+  // already built because of the track builder memory budget.
   if (reconstruction_->NumTracks() == 0) {
     track_builder_->BuildTracks(reconstruction_.get());
+  } else {
+    track_builder_->BuildTracksIncremental(reconstruction_.get());
   }
 
   // Remove uncalibrated views from the reconstruction and view graph.
@@ -424,6 +457,230 @@ bool ReconstructionBuilder::BuildReconstruction(
   return true;
 }
 
+bool ReconstructionBuilder::UpdateReconstruction(
+    ReconstructionBuilderUpdateSummary* summary) {
+  CHECK_NOTNULL(summary);
+  *summary = ReconstructionBuilderUpdateSummary();
+  Timer timer;
+
+  // Views that were estimated before the online mode was started (e.g. when a
+  // known reconstruction is passed to the constructor) are kept.
+  if (num_online_batches_ == 0 && NumEstimatedViews(*reconstruction_) < 2) {
+    CHECK_GE(view_graph_->NumViews(), 2)
+        << "At least 2 images must be provided in order to initialize the "
+           "reconstruction.";
+    track_builder_->BuildTracksIncremental(reconstruction_.get());
+
+    std::unique_ptr<ReconstructionEstimator> reconstruction_estimator(
+        ReconstructionEstimator::Create(
+            options_.reconstruction_estimator_options));
+    const auto& estimator_summary = reconstruction_estimator->Estimate(
+        view_graph_.get(), reconstruction_.get());
+    if (!estimator_summary.success) {
+      LOG(INFO) << "The reconstruction could not be initialized.";
+      return false;
+    }
+
+    summary->estimated_views.assign(estimator_summary.estimated_views.begin(),
+                                    estimator_summary.estimated_views.end());
+    std::sort(summary->estimated_views.begin(), summary->estimated_views.end());
+    summary->num_triangulated_tracks =
+        estimator_summary.estimated_tracks.size();
+    summary->global_bundle_adjustment = true;
+  } else {
+    UpdateOnlineReconstruction(summary);
+  }
+
+  online_batch_views_.clear();
+  ++num_online_batches_;
+  summary->success = true;
+  summary->total_time = timer.ElapsedTimeInSeconds();
+  LOG(INFO) << "Batch " << num_online_batches_ << ": "
+            << summary->estimated_views.size() << " views were estimated and "
+            << summary->num_triangulated_tracks
+            << " tracks were triangulated in " << summary->total_time
+            << " seconds.";
+  return true;
+}
+
+const Reconstruction& ReconstructionBuilder::GetReconstruction() const {
+  return *reconstruction_;
+}
+
+ReconstructionBuilderMemoryReport ReconstructionBuilder::GetMemoryReport()
+    const {
+  ReconstructionBuilderMemoryReport report;
+  report.reconstruction_bytes = reconstruction_->MemoryUsage();
+  report.view_graph_bytes = view_graph_->MemoryUsage();
+  report.track_builder_bytes = track_builder_->MemoryUsage();
+  if (features_and_matches_database_ != nullptr) {
+    report.features_and_matches_database_bytes =
+        features_and_matches_database_->MemoryUsage();
+  }
+  return report;
+}
+
+void ReconstructionBuilder::UpdateOnlineReconstruction(
+    ReconstructionBuilderUpdateSummary* summary) {
+  const ReconstructionEstimatorOptions& estimator_options =
+      options_.reconstruction_estimator_options;
+
+  // Extend the tracks with the new matches.
+  track_builder_->BuildTracksIncremental(reconstruction_.get());
+
+  // Localize the views of the batch that are not estimated yet.
+  std::vector<ViewId> views_to_localize;
+  for (const ViewId view_id : online_batch_views_) {
+    const View* view = reconstruction_->View(view_id);
+    if (view != nullptr && !view->IsEstimated()) {
+      views_to_localize.emplace_back(view_id);
+    }
+  }
+  std::sort(views_to_localize.begin(), views_to_localize.end());
+
+  // Initialize the intrinsics of the new views from their priors. Views of an
+  // intrinsics group that already has an estimated view share its intrinsics,
+  // which must not be reset.
+  for (const ViewId view_id : views_to_localize) {
+    const CameraIntrinsicsGroupId group_id =
+        reconstruction_->CameraIntrinsicsGroupIdFromViewId(view_id);
+    bool group_is_estimated = false;
+    for (const ViewId view_in_group :
+         reconstruction_->GetViewsInCameraIntrinsicGroup(group_id)) {
+      if (reconstruction_->View(view_in_group)->IsEstimated()) {
+        group_is_estimated = true;
+        break;
+      }
+    }
+    if (!group_is_estimated) {
+      View* view = reconstruction_->MutableView(view_id);
+      view->MutableCamera()->SetFromCameraIntrinsicsPriors(
+          view->CameraIntrinsicsPrior());
+    }
+  }
+
+  LocalizeViewToReconstructionOptions localization_options;
+  localization_options.reprojection_error_threshold_pixels =
+      estimator_options.absolute_pose_reprojection_error_threshold;
+  localization_options.ransac_params = SetRansacParameters(estimator_options);
+  localization_options.bundle_adjust_view = true;
+  localization_options.ba_options =
+      SetBundleAdjustmentOptions(estimator_options, 0);
+  localization_options.ba_options.verbose = false;
+  localization_options.min_num_inliers =
+      estimator_options.min_num_absolute_pose_inliers;
+  localization_options.num_threads = options_.num_threads;
+  std::vector<LocalizeViewSummary> localization_summaries;
+  LocalizeViewsToReconstruction(views_to_localize,
+                                localization_options,
+                                reconstruction_.get(),
+                                &localization_summaries);
+
+  // Triangulate the new tracks of the batch. Only the tracks observed by the
+  // views of the batch can have become estimable.
+  std::vector<ViewId> estimated_batch_views;
+  std::unordered_set<TrackId> tracks_to_triangulate;
+  for (const ViewId view_id : online_batch_views_) {
+    const View* view = reconstruction_->View(view_id);
+    if (view == nullptr || !view->IsEstimated()) {
+      continue;
+    }
+    estimated_batch_views.emplace_back(view_id);
+    for (const TrackId track_id : view->TrackIds()) {
+      if (!reconstruction_->Track(track_id)->IsEstimated()) {
+        tracks_to_triangulate.insert(track_id);
+      }
+    }
+  }
+  std::sort(estimated_batch_views.begin(), estimated_batch_views.end());
+
+  TrackEstimator::Options triangulation_options;
+  triangulation_options.max_acceptable_reprojection_error_pixels =
+      estimator_options.triangulation_max_reprojection_error_in_pixels;
+  triangulation_options.min_triangulation_angle_degrees =
+      estimator_options.min_triangulation_angle_degrees;
+  triangulation_options.bundle_adjustment =
+      estimator_options.bundle_adjust_tracks;
+  triangulation_options.ba_options =
+      SetBundleAdjustmentOptions(estimator_options, 0);
+  triangulation_options.ba_options.num_threads = 1;
+  triangulation_options.ba_options.verbose = false;
+  triangulation_options.num_threads = options_.num_threads;
+  triangulation_options.triangulation_method =
+      estimator_options.triangulation_method;
+  TrackEstimator track_estimator(triangulation_options, reconstruction_.get());
+  summary->num_triangulated_tracks =
+      track_estimator.EstimateTracks(tracks_to_triangulate)
+          .estimated_tracks.size();
+
+  const int global_interval = options_.online_global_bundle_adjustment_interval;
+  if (global_interval > 0 && (num_online_batches_ + 1) % global_interval == 0) {
+    // Periodically refine the entire reconstruction to correct the drift of
+    // the local solutions.
+    BundleAdjustmentOptions ba_options = SetBundleAdjustmentOptions(
+        estimator_options, NumEstimatedViews(*reconstruction_));
+    BundleAdjustReconstruction(ba_options, reconstruction_.get());
+    SetOutlierTracksToUnestimated(
+        estimator_options.max_reprojection_error_in_pixels,
+        estimator_options.min_triangulation_angle_degrees,
+        reconstruction_.get());
+    SetUnderconstrainedTracksToUnestimated(options_.num_threads,
+                                           reconstruction_.get());
+    SetUnderconstrainedViewsToUnestimated(options_.num_threads,
+                                          reconstruction_.get());
+    summary->global_bundle_adjustment = true;
+  } else if (!estimated_batch_views.empty()) {
+    // Bundle adjust the views of the batch and the views that share the most
+    // tracks with them. The other views observing the tracks are held
+    // constant.
+    std::unordered_set<ViewId> local_views;
+    SelectCovisibleViewsForLocalBundleAdjustment(
+        *reconstruction_,
+        estimated_batch_views,
+        estimator_options.local_bundle_adjustment_min_num_shared_tracks,
+        std::max(static_cast<int>(estimated_batch_views.size()),
+                 estimator_options.partial_bundle_adjustment_num_views),
+        &local_views);
+    std::unordered_set<TrackId> local_tracks;
+    for (const ViewId view_id : local_views) {
+      const View* view = reconstruction_->View(view_id);
+      for (const TrackId track_id : view->TrackIds()) {
+        if (reconstruction_->Track(track_id)->IsEstimated()) {
+          local_tracks.insert(track_id);
+        }
+      }
+    }
+
+    BundleAdjustmentOptions ba_options =
+        SetBundleAdjustmentOptions(estimator_options, local_views.size());
+    ba_options.use_inner_iterations = false;
+    BundleAdjustPartialReconstruction(
+        ba_options, local_views, local_tracks, reconstruction_.get());
+    summary->num_local_bundle_adjustment_views = local_views.size();
+
+    SetOutlierTracksToUnestimated(
+        local_tracks,
+        estimator_options.max_reprojection_error_in_pixels,
+        estimator_options.min_triangulation_angle_degrees,
+        options_.num_threads,
+        reconstruction_.get());
+    std::vector<ViewId> underconstrained_views;
+    std::vector<TrackId> underconstrained_tracks;
+    SetUnderconstrainedViewsAndTracksToUnestimated(local_tracks,
+                                                   options_.num_threads,
+                                                   reconstruction_.get(),
+                                                   &underconstrained_views,
+                                                   &underconstrained_tracks);
+  }
+
+  for (const LocalizeViewSummary& localization_summary :
+       localization_summaries) {
+    if (reconstruction_->View(localization_summary.view_id)->IsEstimated()) {
+      summary->estimated_views.emplace_back(localization_summary.view_id);
+    }
+  }
+}
+
 void ReconstructionBuilder::AddMatchToViewGraph(
     const ViewId view_id1,
     const ViewId view_id2,
@@ -446,6 +703,15 @@ void ReconstructionBuilder::AddTracksForMatch(const ViewId view_id1,
     track_builder_->AddFeatureCorrespondence(
         view_id1, match.feature1, view_id2, match.feature2);
   }
+
+  // Release the correspondences by building them into tracks if they exceed
+  // the memory budget.
+  if (options_.track_builder_memory_budget_bytes > 0 &&
+      track_builder_->MemoryUsage() >
+          options_.track_builder_memory_budget_bytes) {
+    VLOG(1) << "The track builder exceeds its memory budget, building tracks.";
+    track_builder_->BuildTracksIncremental(reconstruction_.get());
+  }
 }
 
 }  // namespace theia
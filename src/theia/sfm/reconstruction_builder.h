@@ -37,6 +37,7 @@
 
 #include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "theia/image/descriptor/create_descriptor_extractor.h"
@@ -125,6 +126,60 @@ struct ReconstructionBuilderOptions {
   // Options for estimating the reconstruction.
   // See //theia/sfm/reconstruction_estimator_options.h
   ReconstructionEstimatorOptions reconstruction_estimator_options;
+
+  // In the online mode (see ReconstructionBuilder::UpdateReconstruction), the
+  // entire reconstruction is bundle adjusted after every N batches, where N is
+  // set here. Only local bundle adjustment is performed if this is 0. The size
+  // of the local window is set with the partial bundle adjustment options of
+  // the reconstruction_estimator_options.
+  int online_global_bundle_adjustment_interval = 10;
+
+  // Memory budgets in bytes. A budget of 0 is unlimited.
+  //
+  // If the feature correspondences held by the track builder exceed this
+  // budget, they are built into tracks and released, so that the tracks are
+  // built in a streaming fashion (see TrackBuilder::BuildTracksIncremental).
+  // Tracks built this way are not merged across flushes, so they may be
+  // slightly shorter than tracks built from all correspondences at once.
+  size_t track_builder_memory_budget_bytes = 0;
+
+  // The budget of the caches of the features and matches database. See
+  // FeaturesAndMatchesDatabase::SetCacheMemoryBudget.
+  size_t features_and_matches_cache_memory_budget_bytes = 0;
+};
+
+// The approximate memory usage of the data structures of the
+// ReconstructionBuilder in bytes.
+struct ReconstructionBuilderMemoryReport {
+  size_t reconstruction_bytes = 0;
+  size_t view_graph_bytes = 0;
+  size_t track_builder_bytes = 0;
+  size_t features_and_matches_database_bytes = 0;
+
+  size_t TotalBytes() const {
+    return reconstruction_bytes + view_graph_bytes + track_builder_bytes +
+           features_and_matches_database_bytes;
+  }
+};
+
+// Statistics of a batch of views that was added to the reconstruction with
+// ReconstructionBuilder::UpdateReconstruction.
+struct ReconstructionBuilderUpdateSummary {
+  bool success = false;
+
+  // The views of the batch that were estimated.
+  std::vector<ViewId> estimated_views;
+
+  // The number of tracks that were triangulated.
+  int num_triangulated_tracks = 0;
+
+  // The number of views that were optimized by local bundle adjustment.
+  int num_local_bundle_adjustment_views = 0;
+
+  // True if the entire reconstruction was bundle adjusted.
+  bool global_bundle_adjustment = false;
+
+  double total_time = 0.0;
 };
 
 // Base class for building SfM reconstructions. This class will manage the
@@ -186,6 +241,29 @@ class ReconstructionBuilder {
   // successfully estimated.
   bool BuildReconstruction(std::vector<Reconstruction*>* reconstructions);
 
+  // Online mode for images that are streamed in batches. The views and two
+  // view matches of a batch are added with AddImage and AddTwoViewMatch as
+  // usual, and this method is called once per batch to update the
+  // reconstruction in place. The first call estimates an initial
+  // reconstruction with the ReconstructionEstimator. Each subsequent call
+  // extends the tracks with the new matches, localizes the new views to the
+  // reconstruction, triangulates the new tracks and bundle adjusts a local
+  // window of views around the new views. The entire reconstruction is only
+  // bundle adjusted every online_global_bundle_adjustment_interval batches, so
+  // the cost of the other batches only depends on the size of the batch and of
+  // the local window. Views that cannot be localized are retried when a later
+  // batch adds matches to them. Returns false if the reconstruction could not
+  // be initialized.
+  bool UpdateReconstruction(ReconstructionBuilderUpdateSummary* summary);
+
+  // The reconstruction that is updated in the online mode.
+  const Reconstruction& GetReconstruction() const;
+
+  // Reports the approximate memory usage of the reconstruction, view graph,
+  // track builder and the features and matches database. This visits every
+  // view and track, so it should not be called too frequently.
+  ReconstructionBuilderMemoryReport GetMemoryReport() const;
+
  private:
   // Adds the given matches as edges in the view graph.
   void AddMatchToViewGraph(const ViewId view_id1,
@@ -201,6 +279,10 @@ class ReconstructionBuilder {
   // Removes all uncalibrated views from the reconstruction and view graph.
   void RemoveUncalibratedViews();
 
+  // Adds the views of the current batch to the initialized online
+  // reconstruction.
+  void UpdateOnlineReconstruction(ReconstructionBuilderUpdateSummary* summary);
+
   ReconstructionBuilderOptions options_;
 
   // SfM objects.
@@ -211,6 +293,11 @@ class ReconstructionBuilder {
   // Container of image information.
   std::vector<std::string> image_filepaths_;
 
+  // The views that received new matches since the last call to
+  // UpdateReconstruction and the number of batches added in the online mode.
+  std::unordered_set<ViewId> online_batch_views_;
+  int num_online_batches_;
+
   // A DB for storing features and matches.
   FeaturesAndMatchesDatabase* features_and_matches_database_;
 
@@ -0,0 +1,265 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "theia/matching/feature_correspondence.h"
+#include "theia/matching/image_pair_match.h"
+#include "theia/sfm/camera/camera.h"
+#include "theia/sfm/camera_intrinsics_prior.h"
+#include "theia/sfm/feature.h"
+#include "theia/sfm/reconstruction.h"
+#include "theia/sfm/reconstruction_builder.h"
+#include "theia/sfm/track.h"
+#include "theia/sfm/types.h"
+#include "theia/sfm/view.h"
+#include "theia/sfm/view_graph/view_graph.h"
+#include "theia/util/map_util.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+namespace {
+
+static const int kNumInitialPoints = 100;
+static const int kNumNewPointsPerBatch = 40;
+static const int kNumInitialViews = 3;
+static const int kNumViewsPerBatch = 2;
+static const int kNumBatches = 2;
+static const double kFocalLength = 1000.0;
+static const int kImageSize = 1000;
+
+RandomNumberGenerator rng(53);
+
+CameraIntrinsicsPrior IntrinsicsPrior() {
+  CameraIntrinsicsPrior prior;
+  prior.image_width = kImageSize;
+  prior.image_height = kImageSize;
+  prior.focal_length.is_set = true;
+  prior.focal_length.value[0] = kFocalLength;
+  prior.principal_point.is_set = true;
+  prior.principal_point.value[0] = kImageSize / 2.0;
+  prior.principal_point.value[1] = kImageSize / 2.0;
+  return prior;
+}
+
+Eigen::Vector4d RandomPoint() {
+  return Eigen::Vector3d(rng.RandDouble(-2.0, 2.0),
+                         rng.RandDouble(-2.0, 2.0),
+                         rng.RandDouble(6.0, 10.0))
+      .homogeneous();
+}
+
+// The cameras are placed along the x axis, one unit apart, so that tracks
+// observed by neighboring views are well-conditioned for triangulation.
+Camera GroundTruthCamera(const int index) {
+  Camera camera;
+  camera.SetFromCameraIntrinsicsPriors(IntrinsicsPrior());
+  camera.SetOrientationFromAngleAxis(0.05 * rng.RandVector3d());
+  camera.SetPosition(Eigen::Vector3d(index - 3.0, 0.0, 0.0) +
+                     0.1 * rng.RandVector3d());
+  return camera;
+}
+
+Feature Project(const Camera& camera, const Eigen::Vector4d& point) {
+  Eigen::Vector2d pixel;
+  camera.ProjectPoint(point, &pixel);
+  return Feature(pixel);
+}
+
+// Returns the match of the given points between the two views.
+ImagePairMatch MatchPoints(const std::string& image1,
+                           const Camera& camera1,
+                           const std::string& image2,
+                           const Camera& camera2,
+                           const std::vector<Eigen::Vector4d>& points) {
+  ImagePairMatch match;
+  match.image1 = image1;
+  match.image2 = image2;
+  for (const Eigen::Vector4d& point : points) {
+    match.correspondences.emplace_back(Project(camera1, point),
+                                       Project(camera2, point));
+  }
+  return match;
+}
+
+// Each track must be observed at most once per view and each feature of a
+// view must belong to at most one track.
+void ExpectConsistentTracks(const Reconstruction& reconstruction) {
+  for (const TrackId track_id : reconstruction.TrackIds()) {
+    const Track* track = reconstruction.Track(track_id);
+    for (const ViewId view_id : track->ViewIds()) {
+      const View* view = reconstruction.View(view_id);
+      const Feature* feature = view->GetFeature(track_id);
+      ASSERT_NE(feature, nullptr);
+      EXPECT_EQ(view->GetTrack(*feature), track_id);
+    }
+  }
+
+  for (const ViewId view_id : reconstruction.ViewIds()) {
+    const View* view = reconstruction.View(view_id);
+    std::unordered_set<TrackId> track_ids;
+    for (const TrackId track_id : view->TrackIds()) {
+      EXPECT_TRUE(track_ids.insert(track_id).second);
+      EXPECT_TRUE(ContainsKey(reconstruction.Track(track_id)->ViewIds(),
+                              view_id));
+    }
+    EXPECT_EQ(track_ids.size(), view->NumFeatures());
+  }
+}
+
+}  // namespace
+
+// Views are streamed in batches into a known reconstruction. The new views
+// observe the existing points, so they must be localized and extend the
+// existing tracks, and the points that are new in a batch must be
+// triangulated as new tracks that are extended by the later batches.
+TEST(ReconstructionBuilder, UpdateReconstructionExtendsTracks) {
+  std::unique_ptr<Reconstruction> reconstruction(new Reconstruction());
+  std::vector<Camera> cameras;
+  std::vector<Eigen::Vector4d> points;
+  for (int i = 0; i < kNumInitialPoints; i++) {
+    points.emplace_back(RandomPoint());
+  }
+
+  // The initial reconstruction is estimated.
+  std::vector<TrackId> initial_track_ids;
+  for (int i = 0; i < kNumInitialPoints; i++) {
+    const TrackId track_id = reconstruction->AddTrack();
+    Track* track = reconstruction->MutableTrack(track_id);
+    *track->MutablePoint() = points[i];
+    track->SetEstimated(true);
+    initial_track_ids.emplace_back(track_id);
+  }
+  for (int i = 0; i < kNumInitialViews; i++) {
+    cameras.emplace_back(GroundTruthCamera(i));
+    const ViewId view_id = reconstruction->AddView(std::to_string(i), i);
+    View* view = reconstruction->MutableView(view_id);
+    *view->MutableCameraIntrinsicsPrior() = IntrinsicsPrior();
+    Camera* camera = view->MutableCamera();
+    camera->SetFromCameraIntrinsicsPriors(IntrinsicsPrior());
+    camera->SetOrientationFromAngleAxis(
+        cameras.back().GetOrientationAsAngleAxis());
+    camera->SetPosition(cameras.back().GetPosition());
+    view->SetEstimated(true);
+    for (int j = 0; j < kNumInitialPoints; j++) {
+      reconstruction->AddObservation(
+          view_id, initial_track_ids[j], Project(cameras.back(), points[j]));
+    }
+  }
+
+  ReconstructionBuilderOptions options;
+  options.rng = std::make_shared<RandomNumberGenerator>(59);
+  options.num_threads = 2;
+  options.online_global_bundle_adjustment_interval = 0;
+  ReconstructionBuilder reconstruction_builder(
+      options, std::move(reconstruction), std::unique_ptr<ViewGraph>(
+                                              new ViewGraph()));
+
+  for (int batch = 0; batch < kNumBatches; batch++) {
+    // Each view of the batch observes all points of the previous batches and
+    // the new points of the batch. The first view is matched to the last view
+    // of the reconstruction and the second view to the first one.
+    std::vector<Eigen::Vector4d> batch_points = points;
+    for (int i = 0; i < kNumNewPointsPerBatch; i++) {
+      batch_points.emplace_back(RandomPoint());
+    }
+
+    std::vector<std::string> batch_names;
+    for (int i = 0; i < kNumViewsPerBatch; i++) {
+      const std::string previous_name = std::to_string(cameras.size() - 1);
+      const Camera previous_camera = cameras.back();
+      batch_names.emplace_back(std::to_string(cameras.size()));
+      cameras.emplace_back(GroundTruthCamera(cameras.size()));
+      ASSERT_TRUE(reconstruction_builder.AddImageWithCameraIntrinsicsPrior(
+          batch_names.back(), IntrinsicsPrior(), cameras.size() - 1));
+      ASSERT_TRUE(reconstruction_builder.AddTwoViewMatch(
+          previous_name,
+          batch_names.back(),
+          MatchPoints(previous_name,
+                      previous_camera,
+                      batch_names.back(),
+                      cameras.back(),
+                      i == 0 ? points : batch_points)));
+    }
+    points = batch_points;
+
+    ReconstructionBuilderUpdateSummary summary;
+    ASSERT_TRUE(reconstruction_builder.UpdateReconstruction(&summary));
+    EXPECT_TRUE(summary.success);
+    EXPECT_FALSE(summary.global_bundle_adjustment);
+    EXPECT_EQ(summary.num_triangulated_tracks, kNumNewPointsPerBatch);
+
+    const Reconstruction& output = reconstruction_builder.GetReconstruction();
+    ASSERT_EQ(summary.estimated_views.size(), kNumViewsPerBatch);
+    for (int i = 0; i < kNumViewsPerBatch; i++) {
+      const ViewId view_id = output.ViewIdFromName(batch_names[i]);
+      EXPECT_EQ(summary.estimated_views[i], view_id);
+
+      const View* view = output.View(view_id);
+      EXPECT_TRUE(view->IsEstimated());
+      const Camera& ground_truth_camera =
+          cameras[cameras.size() - kNumViewsPerBatch + i];
+      EXPECT_LT((view->Camera().GetPosition() -
+                 ground_truth_camera.GetPosition())
+                    .norm(),
+                1e-6);
+      EXPECT_LT((view->Camera().GetOrientationAsAngleAxis() -
+                 ground_truth_camera.GetOrientationAsAngleAxis())
+                    .norm(),
+                1e-6);
+    }
+
+    // Every point is a single estimated track. The initial tracks are
+    // observed by all views and the tracks of a batch by its views and the
+    // views of the later batches.
+    EXPECT_EQ(output.NumTracks(), points.size());
+    EXPECT_EQ(output.NumViews(), cameras.size());
+    for (const TrackId track_id : output.TrackIds()) {
+      EXPECT_TRUE(output.Track(track_id)->IsEstimated());
+    }
+    for (const TrackId track_id : initial_track_ids) {
+      EXPECT_EQ(output.Track(track_id)->NumViews(), cameras.size());
+    }
+    ExpectConsistentTracks(output);
+  }
+}
+
+}  // namespace theia
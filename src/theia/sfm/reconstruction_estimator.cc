@@ -39,6 +39,7 @@
 #include "theia/sfm/global_reconstruction_estimator.h"
 #include "theia/sfm/hybrid_reconstruction_estimator.h"
 #include "theia/sfm/incremental_reconstruction_estimator.h"
+#include "theia/sfm/partitioned_reconstruction_estimator.h"
 #include "theia/sfm/reconstruction_estimator_options.h"
 
 namespace theia {
@@ -55,6 +56,9 @@ ReconstructionEstimator* ReconstructionEstimator::Create(
     case ReconstructionEstimatorType::HYBRID:
       return new HybridReconstructionEstimator(options);
       break;
+    case ReconstructionEstimatorType::PARTITIONED:
+      return new PartitionedReconstructionEstimator(options);
+      break;
     default:
       LOG(FATAL) << "Invalid reconstruction estimator specified.";
   }
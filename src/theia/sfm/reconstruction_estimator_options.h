@@ -36,6 +36,7 @@
 #define THEIA_SFM_RECONSTRUCTION_ESTIMATOR_OPTIONS_H_
 
 #include <memory>
+#include <string>
 
 #include "theia/sfm/bundle_adjustment/bundle_adjustment.h"
 #include "theia/sfm/global_pose_estimation/LiGT_position_estimator.h"
@@ -48,11 +49,14 @@
 namespace theia {
 
 // Global SfM methods are considered to be more scalable while incremental SfM
-// is less scalable but often more robust.
+// is less scalable but often more robust. Partitioned SfM divides the view
+// graph into overlapping partitions that are estimated independently with one
+// of the other methods and then merged.
 enum class ReconstructionEstimatorType {
   GLOBAL = 0,
   INCREMENTAL = 1,
-  HYBRID = 2
+  HYBRID = 2,
+  PARTITIONED = 3
 };
 
 // The recommended type of rotations solver is the Robust L1-L2 method. This
@@ -205,6 +209,36 @@ struct ReconstructionEstimatorOptions {
   // controls how many views should be part of the partial BA.
   int partial_bundle_adjustment_num_views = 20;
 
+  // If true, the views optimized during partial BA are selected by covisibility
+  // instead of by the order in which they were added. The most recently added
+  // views seed a local window, and the views that share the most tracks with
+  // them are added until the window holds partial_bundle_adjustment_num_views
+  // views. Views outside the window that observe the optimized tracks are held
+  // constant and anchor the local BA. Full BA is then scheduled by the drift
+  // measured during local BA (see below) instead of by
+  // full_bundle_adjustment_growth_percent.
+  bool use_covisibility_local_bundle_adjustment = false;
+
+  // The number of most recently added views that seed the local BA window.
+  int local_bundle_adjustment_num_seed_views = 3;
+
+  // The minimum number of tracks a view must share with the seed views to be
+  // added to the local BA window.
+  int local_bundle_adjustment_min_num_shared_tracks = 15;
+
+  // When covisibility local BA is used, full BA is triggered once the mean
+  // squared reprojection error of a local BA problem, measured before the
+  // newest view and the tracks it triangulated were added, exceeds this
+  // multiple of the mean squared reprojection error after the last full BA.
+  // A large ratio indicates that the local solutions have drifted away from
+  // the last global solution.
+  double full_bundle_adjustment_max_cost_ratio = 2.0;
+
+  // When covisibility local BA is used, full BA is also triggered once the
+  // model has grown by more than this percent since the last full BA,
+  // regardless of the measured drift.
+  double full_bundle_adjustment_max_growth_percent = 25.0;
+
   // --------------------- Hybrid SfM Options --------------------- //
 
   // The relative position of the initial pair used for the incremental portion
@@ -214,6 +248,47 @@ struct ReconstructionEstimatorOptions {
   // parameter.
   double relative_position_estimation_max_sampson_error_pixels = 4.0;
 
+  // --------------------- Partitioned SfM Options --------------------- //
+
+  // The reconstruction estimator used to estimate each partition. This may not
+  // be PARTITIONED.
+  ReconstructionEstimatorType partition_reconstruction_estimator_type =
+      ReconstructionEstimatorType::GLOBAL;
+
+  // The view graph is recursively cut until each partition has at most this
+  // many views. Each partition is then grown by partition_overlap_percent of
+  // its size (and at least partition_min_num_overlapping_views views) with the
+  // most strongly connected views of its neighbors so that the partitions can
+  // be aligned through their common views.
+  int partition_max_num_views = 500;
+  double partition_overlap_percent = 10.0;
+  int partition_min_num_overlapping_views = 10;
+
+  // The number of partitions that are estimated in parallel. Each partition is
+  // estimated with num_threads / partition_num_parallel_reconstructions
+  // threads. Since only this many partition problems are held in memory at
+  // once, this bounds the peak memory of the pose estimation.
+  int partition_num_parallel_reconstructions = 1;
+
+  // Estimated partitions are written to disk and read back one at a time when
+  // they are merged, so that only the partitions currently being estimated are
+  // held in memory. They are written to partition_directory if it is set (the
+  // directory must exist and be writeable, and the files are kept), and
+  // otherwise to a temporary directory that is removed once the partitions
+  // have been merged. If partition_keep_in_memory is true, the partitions are
+  // instead kept in memory until they are merged. This avoids the disk I/O
+  // but the peak memory then grows with the number of partitions.
+  std::string partition_directory = "";
+  bool partition_keep_in_memory = false;
+
+  // A partition is only merged if it has at least this many estimated views in
+  // common with the partitions merged so far. The similarity transformation
+  // between partitions is estimated robustly from the positions of the common
+  // views, and common views whose position error is larger than this fraction
+  // of the spread of the common views are treated as outliers.
+  int partition_min_num_common_views = 5;
+  double partition_alignment_max_relative_position_error = 0.05;
+
   // --------------- Triangulation Options --------------- //
 
   // Minimum angle required between a 3D point and 2 viewing rays in order to
@@ -306,6 +381,13 @@ struct ReconstructionEstimatorOptions {
   // track subsampling. If the view does not observe this many tracks, then all
   // tracks in the view are optimized.
   int min_num_optimized_tracks_per_view = 200;
+
+  // If positive, the tracks are also subsampled as above when the estimated
+  // peak memory of bundle adjusting the entire reconstruction exceeds this
+  // number of bytes (see EstimateBundleAdjustmentMemoryUsage), so that large
+  // reconstructions switch to subsampled bundle adjustment instead of running
+  // out of memory.
+  size_t bundle_adjustment_memory_budget_bytes = 0;
 };
 
 }  // namespace theia
@@ -39,7 +39,10 @@
 #include <ceres/rotation.h>
 
 #include <algorithm>
+#include <functional>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "theia/matching/feature_correspondence.h"
@@ -93,6 +96,85 @@ void GetNormalizedFeatureCorrespondences(
   }
 }
 
+// The minimum number of estimated views that must observe a track and the
+// minimum number of estimated tracks that a view must observe.
+const int kMinNumViewsPerTrack = 2;
+const int kMinNumTracksPerView = 3;
+
+bool IsTrackUnderconstrained(const Reconstruction& reconstruction,
+                             const Track& track) {
+  int num_estimated_views = 0;
+  for (const ViewId view_id : track.ViewIds()) {
+    if (reconstruction.View(view_id)->IsEstimated()) {
+      ++num_estimated_views;
+    }
+    if (num_estimated_views >= kMinNumViewsPerTrack) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsViewUnderconstrained(const Reconstruction& reconstruction,
+                            const View& view) {
+  int num_estimated_tracks = 0;
+  for (const TrackId track_id : view.TrackIds()) {
+    if (reconstruction.Track(track_id)->IsEstimated()) {
+      ++num_estimated_tracks;
+    }
+    if (num_estimated_tracks >= kMinNumTracksPerView) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks the estimated tracks in parallel and sets the underconstrained ones to
+// unestimated. The tracks that were set to unestimated are output.
+void SetTracksToUnestimatedIfUnderconstrained(
+    const std::vector<TrackId>& track_ids,
+    const int num_threads,
+    Reconstruction* reconstruction,
+    std::vector<TrackId>* underconstrained_tracks) {
+  std::vector<char> is_underconstrained(track_ids.size(), 0);
+  ParallelFor(num_threads, track_ids.size(), [&](const int i) {
+    const Track* track = CHECK_NOTNULL(reconstruction->Track(track_ids[i]));
+    is_underconstrained[i] = track->IsEstimated() &&
+                             IsTrackUnderconstrained(*reconstruction, *track);
+  });
+
+  underconstrained_tracks->clear();
+  for (int i = 0; i < track_ids.size(); i++) {
+    if (is_underconstrained[i]) {
+      reconstruction->MutableTrack(track_ids[i])->SetEstimated(false);
+      underconstrained_tracks->emplace_back(track_ids[i]);
+    }
+  }
+}
+
+// Checks the estimated views in parallel and sets the underconstrained ones to
+// unestimated. The views that were set to unestimated are output.
+void SetViewsToUnestimatedIfUnderconstrained(
+    const std::vector<ViewId>& view_ids,
+    const int num_threads,
+    Reconstruction* reconstruction,
+    std::vector<ViewId>* underconstrained_views) {
+  std::vector<char> is_underconstrained(view_ids.size(), 0);
+  ParallelFor(num_threads, view_ids.size(), [&](const int i) {
+    const View* view = CHECK_NOTNULL(reconstruction->View(view_ids[i]));
+    is_underconstrained[i] =
+        view->IsEstimated() && IsViewUnderconstrained(*reconstruction, *view);
+  });
+
+  underconstrained_views->clear();
+  for (int i = 0; i < view_ids.size(); i++) {
+    if (is_underconstrained[i]) {
+      reconstruction->MutableView(view_ids[i])->SetEstimated(false);
+      underconstrained_views->emplace_back(view_ids[i]);
+    }
+  }
+}
+
 }  // namespace
 
 double ComputeResolutionScaledThreshold(const double threshold_pixels,
@@ -244,6 +326,143 @@ void GetEstimatedTracksFromReconstruction(const Reconstruction& reconstruction,
   }
 }
 
+void SelectCovisibleViewsForLocalBundleAdjustment(
+    const Reconstruction& reconstruction,
+    const std::vector<ViewId>& seed_views,
+    const int min_num_shared_tracks,
+    const int max_num_views,
+    std::unordered_set<ViewId>* local_views) {
+  CHECK_NOTNULL(local_views)->clear();
+
+  // The seed views are always optimized.
+  for (const ViewId view_id : seed_views) {
+    const View* view = reconstruction.View(view_id);
+    if (view != nullptr && view->IsEstimated()) {
+      local_views->insert(view_id);
+    }
+  }
+
+  // Count the number of estimated tracks that each view shares with the seed
+  // views. A track observed by several seed views is only counted once.
+  std::unordered_set<TrackId> seed_tracks;
+  for (const ViewId view_id : *local_views) {
+    const View* view = reconstruction.View(view_id);
+    for (const TrackId track_id : view->TrackIds()) {
+      const Track* track = reconstruction.Track(track_id);
+      if (track != nullptr && track->IsEstimated()) {
+        seed_tracks.insert(track_id);
+      }
+    }
+  }
+
+  std::unordered_map<ViewId, int> num_shared_tracks;
+  for (const TrackId track_id : seed_tracks) {
+    for (const ViewId view_id : reconstruction.Track(track_id)->ViewIds()) {
+      if (ContainsKey(*local_views, view_id)) {
+        continue;
+      }
+      const View* view = reconstruction.View(view_id);
+      if (view != nullptr && view->IsEstimated()) {
+        ++num_shared_tracks[view_id];
+      }
+    }
+  }
+
+  // Add the most covisible views to the window.
+  std::vector<std::pair<int, ViewId> > candidates;
+  candidates.reserve(num_shared_tracks.size());
+  for (const auto& view_score : num_shared_tracks) {
+    if (view_score.second >= min_num_shared_tracks) {
+      candidates.emplace_back(view_score.second, view_score.first);
+    }
+  }
+  std::sort(candidates.begin(),
+            candidates.end(),
+            std::greater<std::pair<int, ViewId> >());
+
+  for (const auto& candidate : candidates) {
+    if (local_views->size() >= max_num_views) {
+      break;
+    }
+    local_views->insert(candidate.second);
+  }
+}
+
+double MeanSquaredReprojectionError(
+    const Reconstruction& reconstruction,
+    const std::unordered_set<TrackId>& track_ids,
+    const std::unordered_set<ViewId>& views_to_ignore,
+    int* num_observations) {
+  CHECK_NOTNULL(num_observations);
+  *num_observations = 0;
+  double sum_squared_error = 0.0;
+  for (const TrackId track_id : track_ids) {
+    const Track* track = reconstruction.Track(track_id);
+    if (track == nullptr || !track->IsEstimated()) {
+      continue;
+    }
+
+    for (const ViewId view_id : track->ViewIds()) {
+      const View* view = reconstruction.View(view_id);
+      if (view == nullptr || !view->IsEstimated() ||
+          ContainsKey(views_to_ignore, view_id)) {
+        continue;
+      }
+
+      const Feature* feature = view->GetFeature(track_id);
+      Eigen::Vector2d projection;
+      if (feature == nullptr ||
+          view->Camera().ProjectPoint(track->Point(), &projection) < 0.0) {
+        continue;
+      }
+      sum_squared_error += (projection - feature->point_).squaredNorm();
+      ++(*num_observations);
+    }
+  }
+
+  return *num_observations > 0 ? sum_squared_error / *num_observations : 0.0;
+}
+
+bool ShouldSubsampleTracksForBundleAdjustment(
+    const ReconstructionEstimatorOptions& options,
+    const Reconstruction& reconstruction) {
+  if (options.subsample_tracks_for_bundle_adjustment) {
+    return true;
+  }
+  if (options.bundle_adjustment_memory_budget_bytes == 0) {
+    return false;
+  }
+
+  int num_tracks = 0;
+  int num_observations = 0;
+  for (const TrackId track_id : reconstruction.TrackIds()) {
+    const Track* track = reconstruction.Track(track_id);
+    if (!track->IsEstimated()) {
+      continue;
+    }
+    ++num_tracks;
+    for (const ViewId view_id : track->ViewIds()) {
+      if (reconstruction.View(view_id)->IsEstimated()) {
+        ++num_observations;
+      }
+    }
+  }
+  const int num_views = NumEstimatedViews(reconstruction);
+  const size_t memory_usage = EstimateBundleAdjustmentMemoryUsage(
+      SetBundleAdjustmentOptions(options, num_views),
+      num_views,
+      num_tracks,
+      num_observations);
+  if (memory_usage <= options.bundle_adjustment_memory_budget_bytes) {
+    return false;
+  }
+  LOG(INFO) << "Bundle adjustment is estimated to use " << memory_usage
+            << " bytes, which exceeds the budget of "
+            << options.bundle_adjustment_memory_budget_bytes
+            << " bytes. The tracks are subsampled.";
+  return true;
+}
+
 void RefineRelativeTranslationsWithKnownRotations(
     const Reconstruction& reconstruction,
     const std::unordered_map<ViewId, Eigen::Vector3d>& orientations,
@@ -252,84 +471,123 @@ void RefineRelativeTranslationsWithKnownRotations(
   CHECK_GE(num_threads, 1);
   const auto& view_pairs = view_graph->GetAllEdges();
 
-  ThreadPool pool(num_threads);
-  // Refine the translation estimation for each view pair.
+  // Collect the edges first so that each one is refined independently.
+  std::vector<std::pair<ViewIdPair, TwoViewInfo*> > edges;
+  edges.reserve(view_pairs.size());
   for (const auto& view_pair : view_pairs) {
+    edges.emplace_back(view_pair.first,
+                       view_graph->GetMutableEdge(view_pair.first.first,
+                                                  view_pair.first.second));
+  }
+
+  // Refine the translation estimation for each view pair.
+  ParallelFor(num_threads, edges.size(), [&](const int i) {
+    const ViewIdPair& view_id_pair = edges[i].first;
     // Get all feature correspondences common to both views.
     std::vector<FeatureCorrespondence> matches;
-    const View* view1 = reconstruction.View(view_pair.first.first);
-    const View* view2 = reconstruction.View(view_pair.first.second);
+    const View* view1 = reconstruction.View(view_id_pair.first);
+    const View* view2 = reconstruction.View(view_id_pair.second);
     GetNormalizedFeatureCorrespondences(*view1, *view2, &matches);
 
-    TwoViewInfo* info = view_graph->GetMutableEdge(view_pair.first.first,
-                                                   view_pair.first.second);
-    pool.Add(OptimizeRelativePositionWithKnownRotation,
-             matches,
-             FindOrDie(orientations, view_pair.first.first),
-             FindOrDie(orientations, view_pair.first.second),
-             &info->position_2);
-  }
+    OptimizeRelativePositionWithKnownRotation(
+        matches,
+        FindOrDie(orientations, view_id_pair.first),
+        FindOrDie(orientations, view_id_pair.second),
+        &edges[i].second->position_2);
+  });
 }
 
 int SetUnderconstrainedTracksToUnestimated(Reconstruction* reconstruction) {
-  static const int kMinNumViews = 2;
-  int num_underconstrained_tracks = 0;
-  // Set all underconstrained tracks to be unestimated.
-  for (const TrackId track_id : reconstruction->TrackIds()) {
-    Track* track = CHECK_NOTNULL(reconstruction->MutableTrack(track_id));
-    if (!track->IsEstimated()) {
-      continue;
-    }
+  return SetUnderconstrainedTracksToUnestimated(1, reconstruction);
+}
 
-    // Count the number of estimated views observing it.
-    int num_estimated_views = 0;
-    for (const ViewId view_id : track->ViewIds()) {
-      if (reconstruction->View(view_id)->IsEstimated()) {
-        ++num_estimated_views;
-      }
-      if (num_estimated_views >= kMinNumViews) {
-        break;
-      }
-    }
+int SetUnderconstrainedViewsToUnestimated(Reconstruction* reconstruction) {
+  return SetUnderconstrainedViewsToUnestimated(1, reconstruction);
+}
 
-    if (num_estimated_views < kMinNumViews) {
-      track->SetEstimated(false);
-      ++num_underconstrained_tracks;
-    }
-  }
+int SetUnderconstrainedTracksToUnestimated(const int num_threads,
+                                           Reconstruction* reconstruction) {
+  std::vector<TrackId> underconstrained_tracks;
+  SetTracksToUnestimatedIfUnderconstrained(reconstruction->TrackIds(),
+                                           num_threads,
+                                           reconstruction,
+                                           &underconstrained_tracks);
+  return underconstrained_tracks.size();
+}
 
-  return num_underconstrained_tracks;
+int SetUnderconstrainedViewsToUnestimated(const int num_threads,
+                                          Reconstruction* reconstruction) {
+  std::vector<ViewId> underconstrained_views;
+  SetViewsToUnestimatedIfUnderconstrained(reconstruction->ViewIds(),
+                                          num_threads,
+                                          reconstruction,
+                                          &underconstrained_views);
+  return underconstrained_views.size();
 }
 
-int SetUnderconstrainedViewsToUnestimated(Reconstruction* reconstruction) {
-  // Set all underconstrained views to be unestimated.
-  static const int kMinNumTracks = 3;
-  int num_underconstrained_views = 0;
-  // Set all underconstrained views to be unestimated.
-  for (const ViewId view_id : reconstruction->ViewIds()) {
-    View* view = CHECK_NOTNULL(reconstruction->MutableView(view_id));
-    if (!view->IsEstimated()) {
-      continue;
+void SetUnderconstrainedViewsAndTracksToUnestimated(
+    const std::unordered_set<TrackId>& modified_tracks,
+    const int num_threads,
+    Reconstruction* reconstruction,
+    std::vector<ViewId>* underconstrained_views,
+    std::vector<TrackId>* underconstrained_tracks) {
+  CHECK_NOTNULL(underconstrained_views)->clear();
+  CHECK_NOTNULL(underconstrained_tracks)->clear();
+
+  // Only the removal of a track may leave a view underconstrained.
+  std::vector<TrackId> removed_tracks;
+  for (const TrackId track_id : modified_tracks) {
+    const Track* track = reconstruction->Track(track_id);
+    if (track != nullptr && !track->IsEstimated()) {
+      removed_tracks.emplace_back(track_id);
     }
+  }
 
-    // Count the number of estimated views observing it.
-    int num_estimated_tracks = 0;
-    for (const TrackId track_id : view->TrackIds()) {
-      if (reconstruction->Track(track_id)->IsEstimated()) {
-        ++num_estimated_tracks;
-      }
-      if (num_estimated_tracks >= kMinNumTracks) {
-        break;
+  std::vector<ViewId> removed_views;
+  std::unordered_set<ViewId> views_to_check;
+  std::unordered_set<TrackId> tracks_to_check;
+  while (!removed_tracks.empty()) {
+    // Check the estimated views that observe the removed tracks.
+    views_to_check.clear();
+    for (const TrackId track_id : removed_tracks) {
+      for (const ViewId view_id : reconstruction->Track(track_id)->ViewIds()) {
+        const View* view = reconstruction->View(view_id);
+        if (view != nullptr && view->IsEstimated()) {
+          views_to_check.insert(view_id);
+        }
       }
     }
-
-    if (num_estimated_tracks < kMinNumTracks) {
-      view->SetEstimated(false);
-      ++num_underconstrained_views;
+    SetViewsToUnestimatedIfUnderconstrained(
+        std::vector<ViewId>(views_to_check.begin(), views_to_check.end()),
+        num_threads,
+        reconstruction,
+        &removed_views);
+    if (removed_views.empty()) {
+      break;
     }
+    underconstrained_views->insert(underconstrained_views->end(),
+                                   removed_views.begin(),
+                                   removed_views.end());
+
+    // Check the estimated tracks in the removed views.
+    tracks_to_check.clear();
+    for (const ViewId view_id : removed_views) {
+      for (const TrackId track_id : reconstruction->View(view_id)->TrackIds()) {
+        const Track* track = reconstruction->Track(track_id);
+        if (track != nullptr && track->IsEstimated()) {
+          tracks_to_check.insert(track_id);
+        }
+      }
+    }
+    SetTracksToUnestimatedIfUnderconstrained(
+        std::vector<TrackId>(tracks_to_check.begin(), tracks_to_check.end()),
+        num_threads,
+        reconstruction,
+        &removed_tracks);
+    underconstrained_tracks->insert(underconstrained_tracks->end(),
+                                    removed_tracks.begin(),
+                                    removed_tracks.end());
   }
-
-  return num_underconstrained_views;
 }
 
 int NumEstimatedViews(const Reconstruction& reconstruction) {
@@ -38,6 +38,7 @@
 #include <Eigen/Core>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "theia/sfm/bundle_adjustment/bundle_adjustment.h"
 #include "theia/sfm/reconstruction.h"
@@ -94,6 +95,38 @@ void GetEstimatedViewsFromReconstruction(const Reconstruction& reconstruction,
 void GetEstimatedTracksFromReconstruction(const Reconstruction& reconstruction,
                                           std::unordered_set<TrackId>* tracks);
 
+// Selects a local window of views for bundle adjustment based on covisibility
+// with the seed views. Each estimated view is scored by the number of estimated
+// tracks that it shares with the seed views. The seed views are always part of
+// the window, and the views with the highest scores (and at least
+// min_num_shared_tracks shared tracks) are added until the window contains
+// max_num_views views.
+void SelectCovisibleViewsForLocalBundleAdjustment(
+    const Reconstruction& reconstruction,
+    const std::vector<ViewId>& seed_views,
+    const int min_num_shared_tracks,
+    const int max_num_views,
+    std::unordered_set<ViewId>* local_views);
+
+// Returns the mean squared reprojection error of the observations of the given
+// estimated tracks in estimated views, ignoring the observations in
+// views_to_ignore. The number of observations that contributed is returned in
+// num_observations; the error is 0 if there are none.
+double MeanSquaredReprojectionError(
+    const Reconstruction& reconstruction,
+    const std::unordered_set<TrackId>& track_ids,
+    const std::unordered_set<ViewId>& views_to_ignore,
+    int* num_observations);
+
+// Returns true if the tracks should be subsampled with
+// SelectGoodTracksForBundleAdjustment before all estimated views and tracks of
+// the reconstruction are bundle adjusted. This is the case if
+// subsample_tracks_for_bundle_adjustment is set or if the estimated memory of
+// the bundle adjustment exceeds bundle_adjustment_memory_budget_bytes.
+bool ShouldSubsampleTracksForBundleAdjustment(
+    const ReconstructionEstimatorOptions& options,
+    const Reconstruction& reconstruction);
+
 // Refine the relative translation estimates between view pairs by optimizing
 // the epipolar constraint given the known rotation estimation.
 void RefineRelativeTranslationsWithKnownRotations(
@@ -110,6 +143,31 @@ int SetUnderconstrainedTracksToUnestimated(Reconstruction* reconstruction);
 // Returns the number of views set to unestimated.
 int SetUnderconstrainedViewsToUnestimated(Reconstruction* reconstruction);
 
+// Same as the two functions above, but the tracks (or views) are checked in
+// parallel with num_threads threads. They are only set to unestimated once all
+// checks have finished, so the result is identical to the single-threaded
+// versions.
+int SetUnderconstrainedTracksToUnestimated(const int num_threads,
+                                           Reconstruction* reconstruction);
+int SetUnderconstrainedViewsToUnestimated(const int num_threads,
+                                          Reconstruction* reconstruction);
+
+// Incremental version of the functions above. Views and tracks can only become
+// underconstrained when a track (or view) they depend on is set to unestimated,
+// so only the estimated views observing a modified track that is now
+// unestimated are checked. The tracks of views that are set to unestimated are
+// checked next, and so on until no more views or tracks are removed. This keeps
+// the cost proportional to the size of the modification instead of the size of
+// the reconstruction, assuming that the reconstruction did not contain
+// underconstrained views or tracks before the modification. The views and
+// tracks that were set to unestimated are output.
+void SetUnderconstrainedViewsAndTracksToUnestimated(
+    const std::unordered_set<TrackId>& modified_tracks,
+    const int num_threads,
+    Reconstruction* reconstruction,
+    std::vector<ViewId>* underconstrained_views,
+    std::vector<TrackId>* underconstrained_tracks);
+
 // Return the number of estimated views or tracks in the reconstruction.
 int NumEstimatedViews(const Reconstruction& reconstruction);
 int NumEstimatedTracks(const Reconstruction& reconstruction);
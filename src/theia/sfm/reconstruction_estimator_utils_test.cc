@@ -0,0 +1,305 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "theia/sfm/camera/camera.h"
+#include "theia/sfm/reconstruction.h"
+#include "theia/sfm/reconstruction_estimator_utils.h"
+#include "theia/sfm/set_outlier_tracks_to_unestimated.h"
+#include "theia/sfm/track.h"
+#include "theia/sfm/types.h"
+#include "theia/sfm/view.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+namespace {
+
+static const int kNumViews = 20;
+static const int kNumTracks = 500;
+static const int kNumThreads = 4;
+
+// Creates a reconstruction of cameras on a line that observe random points in
+// front of them. Some of the observations are corrupted so that the tracks are
+// outliers. The same reconstruction is created for the same seed.
+void CreateReconstruction(const unsigned seed, Reconstruction* reconstruction) {
+  RandomNumberGenerator rng(seed);
+  for (int i = 0; i < kNumViews; i++) {
+    const ViewId view_id =
+        reconstruction->AddView(std::to_string(i), static_cast<double>(i));
+    View* view = reconstruction->MutableView(view_id);
+    Camera* camera = view->MutableCamera();
+    camera->SetFocalLength(1000.0);
+    camera->SetPrincipalPoint(500.0, 500.0);
+    camera->SetPosition(Eigen::Vector3d(i, 0.0, 0.0));
+    view->SetEstimated(true);
+  }
+
+  for (int i = 0; i < kNumTracks; i++) {
+    const Eigen::Vector4d point(rng.RandDouble(-5.0, kNumViews + 5.0),
+                                rng.RandDouble(-5.0, 5.0),
+                                rng.RandDouble(5.0, 20.0),
+                                1.0);
+    const bool is_outlier = rng.RandDouble(0.0, 1.0) < 0.1;
+
+    // Observe the point in a few random views.
+    const int num_observations = rng.RandInt(2, 4);
+    std::unordered_set<ViewId> view_ids;
+    while (view_ids.size() < num_observations) {
+      view_ids.insert(rng.RandInt(0, kNumViews - 1));
+    }
+
+    std::vector<std::pair<ViewId, Feature> > observations;
+    for (const ViewId view_id : view_ids) {
+      Eigen::Vector2d pixel;
+      reconstruction->View(view_id)->Camera().ProjectPoint(point, &pixel);
+      if (is_outlier) {
+        pixel += Eigen::Vector2d(rng.RandDouble(20.0, 50.0), 0.0);
+      }
+      observations.emplace_back(view_id, Feature(pixel));
+    }
+    const TrackId track_id = reconstruction->AddTrack(observations);
+    Track* track = reconstruction->MutableTrack(track_id);
+    track->SetPoint(point);
+    track->SetEstimated(true);
+  }
+}
+
+// Removes underconstrained views and tracks from the entire reconstruction
+// until none are left.
+void RemoveAllUnderconstrained(const int num_threads,
+                               Reconstruction* reconstruction) {
+  int num_removed = 1;
+  while (num_removed > 0) {
+    num_removed =
+        SetUnderconstrainedViewsToUnestimated(num_threads, reconstruction) +
+        SetUnderconstrainedTracksToUnestimated(num_threads, reconstruction);
+  }
+}
+
+void ExpectSameEstimatedState(const Reconstruction& reconstruction1,
+                              const Reconstruction& reconstruction2) {
+  for (const ViewId view_id : reconstruction1.ViewIds()) {
+    EXPECT_EQ(reconstruction1.View(view_id)->IsEstimated(),
+              reconstruction2.View(view_id)->IsEstimated());
+  }
+  for (const TrackId track_id : reconstruction1.TrackIds()) {
+    EXPECT_EQ(reconstruction1.Track(track_id)->IsEstimated(),
+              reconstruction2.Track(track_id)->IsEstimated());
+  }
+}
+
+// Adds an estimated track that is observed without noise in the views.
+TrackId AddTrackInViews(const std::vector<ViewId>& view_ids,
+                        const Eigen::Vector4d& point,
+                        Reconstruction* reconstruction) {
+  std::vector<std::pair<ViewId, Feature> > observations;
+  for (const ViewId view_id : view_ids) {
+    Eigen::Vector2d pixel;
+    reconstruction->View(view_id)->Camera().ProjectPoint(point, &pixel);
+    observations.emplace_back(view_id, Feature(pixel));
+  }
+  const TrackId track_id = reconstruction->AddTrack(observations);
+  Track* track = reconstruction->MutableTrack(track_id);
+  track->SetPoint(point);
+  track->SetEstimated(true);
+  return track_id;
+}
+
+// Creates a reconstruction where view 0 shares 20 tracks with view 1, 10
+// tracks with view 2 and 3 tracks with view 3. Views 4 and 5 only share tracks
+// with each other.
+void CreateCovisibilityReconstruction(Reconstruction* reconstruction) {
+  for (int i = 0; i < 6; i++) {
+    const ViewId view_id =
+        reconstruction->AddView(std::to_string(i), static_cast<double>(i));
+    View* view = reconstruction->MutableView(view_id);
+    Camera* camera = view->MutableCamera();
+    camera->SetFocalLength(1000.0);
+    camera->SetPrincipalPoint(500.0, 500.0);
+    camera->SetPosition(Eigen::Vector3d(i, 0.0, 0.0));
+    view->SetEstimated(true);
+  }
+
+  const std::vector<std::pair<ViewId, int> > num_shared_tracks = {
+      {1, 20}, {2, 10}, {3, 3}};
+  for (const auto& shared_tracks : num_shared_tracks) {
+    for (int i = 0; i < shared_tracks.second; i++) {
+      AddTrackInViews({0, shared_tracks.first},
+                      Eigen::Vector4d(0.1 * i, 1.0, 10.0, 1.0),
+                      reconstruction);
+    }
+  }
+  for (int i = 0; i < 30; i++) {
+    AddTrackInViews({4, 5}, Eigen::Vector4d(0.1 * i, 1.0, 10.0, 1.0),
+                    reconstruction);
+  }
+}
+
+}  // namespace
+
+TEST(SelectCovisibleViewsForLocalBundleAdjustment, MostCovisibleViews) {
+  Reconstruction reconstruction;
+  CreateCovisibilityReconstruction(&reconstruction);
+
+  std::unordered_set<ViewId> local_views;
+  SelectCovisibleViewsForLocalBundleAdjustment(
+      reconstruction, {0}, 1, 3, &local_views);
+  EXPECT_EQ(local_views, std::unordered_set<ViewId>({0, 1, 2}));
+
+  // Views that share too few tracks are not added.
+  SelectCovisibleViewsForLocalBundleAdjustment(
+      reconstruction, {0}, 5, 10, &local_views);
+  EXPECT_EQ(local_views, std::unordered_set<ViewId>({0, 1, 2}));
+
+  // The seed views are always part of the window, even if they do not share
+  // tracks with each other, and view 5 shares more tracks with them than view
+  // 1.
+  SelectCovisibleViewsForLocalBundleAdjustment(
+      reconstruction, {0, 4}, 1, 3, &local_views);
+  EXPECT_EQ(local_views, std::unordered_set<ViewId>({0, 4, 5}));
+}
+
+TEST(SelectCovisibleViewsForLocalBundleAdjustment, IgnoresUnestimated) {
+  Reconstruction reconstruction;
+  CreateCovisibilityReconstruction(&reconstruction);
+  reconstruction.MutableView(1)->SetEstimated(false);
+
+  // Only estimated tracks are counted.
+  for (const TrackId track_id : reconstruction.View(2)->TrackIds()) {
+    reconstruction.MutableTrack(track_id)->SetEstimated(false);
+  }
+
+  std::unordered_set<ViewId> local_views;
+  SelectCovisibleViewsForLocalBundleAdjustment(
+      reconstruction, {0, 1}, 1, 10, &local_views);
+  EXPECT_EQ(local_views, std::unordered_set<ViewId>({0, 3}));
+}
+
+TEST(MeanSquaredReprojectionError, IgnoresViews) {
+  Reconstruction reconstruction;
+  CreateCovisibilityReconstruction(&reconstruction);
+
+  // Add a track whose observation in view 3 is off by 5 pixels.
+  const Eigen::Vector4d point(0.5, -1.0, 10.0, 1.0);
+  Eigen::Vector2d pixel0, pixel3;
+  reconstruction.View(0)->Camera().ProjectPoint(point, &pixel0);
+  reconstruction.View(3)->Camera().ProjectPoint(point, &pixel3);
+  const TrackId noisy_track_id = reconstruction.AddTrack(
+      {{0, Feature(pixel0)}, {3, Feature(pixel3 + Eigen::Vector2d(3, 4))}});
+  reconstruction.MutableTrack(noisy_track_id)->SetPoint(point);
+  reconstruction.MutableTrack(noisy_track_id)->SetEstimated(true);
+
+  const auto& track_ids = reconstruction.TrackIds();
+  const std::unordered_set<TrackId> tracks(track_ids.begin(), track_ids.end());
+  const int num_observations = 2 * tracks.size();
+
+  int num_measured_observations;
+  EXPECT_NEAR(MeanSquaredReprojectionError(reconstruction,
+                                           tracks,
+                                           std::unordered_set<ViewId>(),
+                                           &num_measured_observations),
+              25.0 / num_observations,
+              1e-8);
+  EXPECT_EQ(num_measured_observations, num_observations);
+
+  EXPECT_NEAR(MeanSquaredReprojectionError(
+                  reconstruction, tracks, {3}, &num_measured_observations),
+              0.0,
+              1e-8);
+  EXPECT_EQ(num_measured_observations, num_observations - 4);
+}
+
+TEST(SetOutlierTracksToUnestimated, MultithreadedMatchesSingleThreaded) {
+  Reconstruction reconstruction1, reconstruction2;
+  CreateReconstruction(59, &reconstruction1);
+  CreateReconstruction(59, &reconstruction2);
+
+  const auto& track_ids = reconstruction1.TrackIds();
+  const std::unordered_set<TrackId> tracks(track_ids.begin(), track_ids.end());
+  const int num_outliers1 =
+      SetOutlierTracksToUnestimated(tracks, 4.0, 1.0, &reconstruction1);
+  const int num_outliers2 = SetOutlierTracksToUnestimated(
+      tracks, 4.0, 1.0, kNumThreads, &reconstruction2);
+
+  EXPECT_GT(num_outliers1, 0);
+  EXPECT_EQ(num_outliers1, num_outliers2);
+  ExpectSameEstimatedState(reconstruction1, reconstruction2);
+}
+
+TEST(SetUnderconstrainedViewsAndTracksToUnestimated, MatchesFullCheck) {
+  Reconstruction reconstruction1, reconstruction2;
+  CreateReconstruction(67, &reconstruction1);
+  CreateReconstruction(67, &reconstruction2);
+  RemoveAllUnderconstrained(1, &reconstruction1);
+  RemoveAllUnderconstrained(1, &reconstruction2);
+
+  // Remove all but two tracks of a few views so that the views, and in turn
+  // some of their remaining tracks, become underconstrained.
+  std::unordered_set<TrackId> modified_tracks;
+  for (const ViewId view_id : {2, 9, 15}) {
+    int num_remaining_tracks = 0;
+    for (const TrackId track_id : reconstruction1.View(view_id)->TrackIds()) {
+      if (!reconstruction1.Track(track_id)->IsEstimated()) {
+        continue;
+      }
+      if (num_remaining_tracks < 2) {
+        ++num_remaining_tracks;
+        continue;
+      }
+      reconstruction1.MutableTrack(track_id)->SetEstimated(false);
+      reconstruction2.MutableTrack(track_id)->SetEstimated(false);
+      modified_tracks.insert(track_id);
+    }
+  }
+
+  RemoveAllUnderconstrained(1, &reconstruction1);
+
+  std::vector<ViewId> underconstrained_views;
+  std::vector<TrackId> underconstrained_tracks;
+  SetUnderconstrainedViewsAndTracksToUnestimated(modified_tracks,
+                                                 kNumThreads,
+                                                 &reconstruction2,
+                                                 &underconstrained_views,
+                                                 &underconstrained_tracks);
+  EXPECT_GT(underconstrained_views.size(), 0);
+  EXPECT_GT(underconstrained_tracks.size(), 0);
+  ExpectSameEstimatedState(reconstruction1, reconstruction2);
+}
+
+}  // namespace theia
@@ -35,6 +35,7 @@
 #include "theia/sfm/select_good_tracks_for_bundle_adjustment.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -46,24 +47,11 @@
 #include "theia/sfm/track.h"
 #include "theia/sfm/types.h"
 #include "theia/sfm/view.h"
-#include "theia/util/hash.h"
 #include "theia/util/map_util.h"
+#include "theia/util/threadpool.h"
 
 namespace theia {
 namespace {
-// Track statistics are the track length and mean reprojection error.
-typedef std::pair<int, double> TrackStatistics;
-typedef std::pair<TrackId, TrackStatistics> GridCellElement;
-typedef std::unordered_map<Eigen::Vector2i, std::vector<GridCellElement> >
-    ImageGrid;
-
-// Sorts the grid cell elements by the track statistics, which will sort first
-// by the (truncated) track length, then by the mean reprojection error.
-bool CompareGridCellElements(
-    const std::pair<TrackId, TrackStatistics>& element1,
-    const std::pair<TrackId, TrackStatistics>& element2) {
-  return element1.second < element2.second;
-}
 
 // Return the squared reprojection error of the track in the view.
 inline double ComputeSqReprojectionError(const View& view,
@@ -74,177 +62,17 @@ inline double ComputeSqReprojectionError(const View& view,
   return (reprojected_feature - feature.point_).squaredNorm();
 }
 
-// Compute the reprojection error and truncated track length for this specific
-// track.
-TrackStatistics ComputeStatisticsForTrack(
-    const Reconstruction& reconstruction,
-    const TrackId track_id,
-    const int long_track_length_threshold) {
-  // Any tracks that reach this function are guaranteed to exist and be
-  // estimated, so no need to check for that here.
-  const Track* track = reconstruction.Track(track_id);
-  const auto& views_observing_track = track->ViewIds();
-
-  double sq_reprojection_error_sum = 0.0;
-  int num_valid_reprojections = 0;
-  // Compute the sq reprojection error for each view that observes the track
-  // and it it to the accumulating sum.
-  for (const ViewId view_id : views_observing_track) {
-    const View* view = reconstruction.View(view_id);
-    if (view == nullptr || !view->IsEstimated()) {
-      continue;
-    }
-    sq_reprojection_error_sum +=
-        ComputeSqReprojectionError(*view, *view->GetFeature(track_id), *track);
-    ++num_valid_reprojections;
-  }
-
-  // Compute and return the track statistics.
-  const int truncated_track_length =
-      std::min(num_valid_reprojections, long_track_length_threshold);
-  const double mean_sq_reprojection_error =
-      sq_reprojection_error_sum / static_cast<double>(num_valid_reprojections);
-  return TrackStatistics(truncated_track_length, mean_sq_reprojection_error);
-}
-
-// Compute the mean reprojection error and the truncated track length of each
-// track. We truncate the track length based on the observation that while
-// larger track lengths provide better constraints for bundle adjustment, larger
-// tracks are also more likely to contain outliers in our experience. Truncating
-// the track lengths enforces that the long tracks with the lowest reprojection
-// error are chosen.
-void ComputeTrackStatistics(
-    const Reconstruction& reconstruction,
-    const std::unordered_set<ViewId>& view_ids,
-    const int long_track_length_threshold,
-    std::unordered_map<TrackId, TrackStatistics>* track_statistics) {
-  // Iterate over all views and compute the track statistics for each track we
-  // encounter.
-  for (const ViewId view_id : view_ids) {
-    const View* view = reconstruction.View(view_id);
-    const auto& tracks_in_view = view->TrackIds();
-    // Compute statistics for each track in this view that we have not already
-    // computed statistics for.
-    for (const TrackId track_id : tracks_in_view) {
-      const Track* track = reconstruction.Track(track_id);
-      // Skip this track if the statistics were already computed, or if the
-      // track has not been estimated.
-      if (ContainsKey(*track_statistics, track_id) || track == nullptr ||
-          !track->IsEstimated()) {
-        continue;
-      }
-
-      // Compute the track statistics and add it to the output map.
-      const TrackStatistics& statistics_for_this_track =
-          ComputeStatisticsForTrack(
-              reconstruction, track_id, long_track_length_threshold);
-      track_statistics->emplace(track_id, statistics_for_this_track);
-    }
-  }
-}
-
-// Select tracks from the image to ensure good spatial coverage of the image. To
-// do this, we first bin the tracks into grid cells in an image grid. Then
-// within each cell we find the best ranked track and add it to the list of
-// tracks to optimize.
-void SelectBestTracksFromEachImageGridCell(
-    const Reconstruction& reconstruction,
-    const View& view,
-    const int grid_cell_size,
-    const std::unordered_map<TrackId, TrackStatistics>& track_statistics,
-    std::unordered_set<TrackId>* tracks_to_optimize) {
-  static const double inv_grid_cell_size = 1.0 / grid_cell_size;
-
-  // Hash each feature into a grid cell.
-  ImageGrid image_grid;
-  const auto& track_ids = view.TrackIds();
-  for (const TrackId track_id : track_ids) {
-    const Track* track = reconstruction.Track(track_id);
-    if (track == nullptr || !track->IsEstimated()) {
-      continue;
-    }
-
-    const Feature& feature = *view.GetFeature(track_id);
-    const TrackStatistics& current_track_statistics =
-        FindOrDieNoPrint(track_statistics, track_id);
-    const Eigen::Vector2i grid_cell =
-        (feature.point_ * inv_grid_cell_size).cast<int>();
-
-    image_grid[grid_cell].emplace_back(track_id, current_track_statistics);
-  }
-
-  // Select the best feature from each grid cell and add it to the tracks to
-  // optimize.
-  for (auto& grid_cell : image_grid) {
-    // Order the features in each cell by track length first, then mean
-    // reprojection error.
-    const GridCellElement& grid_cell_element =
-        *std::min_element(grid_cell.second.begin(),
-                          grid_cell.second.end(),
-                          CompareGridCellElements);
-
-    // Insert the track id in to the tracks to optimize.
-    tracks_to_optimize->emplace(grid_cell_element.first);
-  }
-}
-
-// Selects the top ranked tracks that have not already been chosen until the
-// view observes the minimum number of optimized tracks.
-void SelectTopRankedTracksInView(
-    const Reconstruction& reconstruction,
-    const std::unordered_map<TrackId, TrackStatistics>& track_statistics,
-    const View& view,
-    const int min_num_optimized_tracks_per_view,
-    std::unordered_set<TrackId>* tracks_to_optimize) {
-  int num_optimized_tracks = 0;
-  int num_estimated_tracks = 0;
-
-  const auto& tracks_in_view = view.TrackIds();
-  std::vector<GridCellElement> ranked_candidate_tracks;
-  for (const TrackId track_id : tracks_in_view) {
-    const Track* track = reconstruction.Track(track_id);
-    if (track == nullptr || !track->IsEstimated()) {
-      continue;
-    }
-    // We only reach this point if the track is estimated.
-    ++num_estimated_tracks;
-
-    // If the track is already slated for optimization, increase the count of
-    // optimized features.
-    if (ContainsKey(*tracks_to_optimize, track_id)) {
-      ++num_optimized_tracks;
-      // If the number of optimized_tracks is greater than the minimum then we
-      // can return early since we know that no more features need to added for
-      // this view.
-      if (num_optimized_tracks >= min_num_optimized_tracks_per_view) {
-        return;
-      }
-    } else {
-      // If the track is not already set to be optimized then add it to the list
-      // of candidate tracks.
-      ranked_candidate_tracks.emplace_back(
-          track_id, FindOrDieNoPrint(track_statistics, track_id));
-    }
-  }
-
-  // We only reach this point if the number of optimized tracks is less than the
-  // minimum. If that is the case then we add the top candidate features until
-  // the minimum number of features observed is met.
-  if (num_optimized_tracks != num_estimated_tracks) {
-    // Select how many tracks to add. If we need more tracks than are estimated
-    // then we simply add all remaining features.
-    const int num_optimized_tracks_needed =
-        std::min(min_num_optimized_tracks_per_view - num_optimized_tracks,
-                 num_estimated_tracks - num_optimized_tracks);
-    std::partial_sort(
-        ranked_candidate_tracks.begin(),
-        ranked_candidate_tracks.begin() + num_optimized_tracks_needed,
-        ranked_candidate_tracks.end());
-    // Add the candidate tracks to the list of tracks to be optimized.
-    for (int i = 0; i < num_optimized_tracks_needed; i++) {
-      tracks_to_optimize->emplace(ranked_candidate_tracks[i].first);
-    }
-  }
+// Copies the extrinsics and intrinsics of the camera into the vector.
+void GetCameraParameters(const Camera& camera,
+                         std::vector<double>* parameters) {
+  const int num_intrinsics = camera.CameraIntrinsics()->NumParameters();
+  parameters->resize(Camera::kExtrinsicsSize + num_intrinsics);
+  std::copy(camera.extrinsics(),
+            camera.extrinsics() + Camera::kExtrinsicsSize,
+            parameters->data());
+  std::copy(camera.intrinsics(),
+            camera.intrinsics() + num_intrinsics,
+            parameters->data() + Camera::kExtrinsicsSize);
 }
 
 }  // namespace
@@ -283,42 +111,322 @@ bool SelectGoodTracksForBundleAdjustment(
     const int image_grid_cell_size_pixels,
     const int min_num_optimized_tracks_per_view,
     std::unordered_set<TrackId>* tracks_to_optimize) {
-  // Compute the track mean reprojection errors.
-  std::unordered_map<TrackId, TrackStatistics> track_statistics;
-  ComputeTrackStatistics(
-      reconstruction, view_ids, long_track_length_threshold, &track_statistics);
+  BundleAdjustmentTrackSelector::Options options;
+  options.long_track_length_threshold = long_track_length_threshold;
+  options.image_grid_cell_size_pixels = image_grid_cell_size_pixels;
+  options.min_num_optimized_tracks_per_view = min_num_optimized_tracks_per_view;
+  BundleAdjustmentTrackSelector track_selector(options);
+  return track_selector.SelectTracks(
+      reconstruction, view_ids, tracks_to_optimize);
+}
+
+BundleAdjustmentTrackSelector::BundleAdjustmentTrackSelector(
+    const Options& options)
+    : options_(options),
+      num_selections_(0),
+      num_computed_track_statistics_(0) {
+  CHECK_GT(options_.image_grid_cell_size_pixels, 0);
+  CHECK_GE(options_.num_threads, 1);
+}
+
+void BundleAdjustmentTrackSelector::Clear() {
+  num_selections_ = 0;
+  num_computed_track_statistics_ = 0;
+  camera_states_.clear();
+  track_to_entry_.clear();
+  entries_.clear();
+}
+
+bool BundleAdjustmentTrackSelector::SelectTracks(
+    const Reconstruction& reconstruction,
+    std::unordered_set<TrackId>* tracks_to_optimize) {
+  std::unordered_set<ViewId> view_ids;
+  GetEstimatedViewsFromReconstruction(reconstruction, &view_ids);
+  return SelectTracks(reconstruction, view_ids, tracks_to_optimize);
+}
+
+int BundleAdjustmentTrackSelector::UpdateCameraStates(
+    const Reconstruction& reconstruction) {
+  int num_changed_cameras = 0;
+  std::vector<double> parameters;
+  for (const ViewId view_id : reconstruction.ViewIds()) {
+    const View* view = reconstruction.View(view_id);
+    GetCameraParameters(view->Camera(), &parameters);
+
+    CameraState& camera_state = camera_states_[view_id];
+    if (camera_state.changed_at >= 0 &&
+        camera_state.is_estimated == view->IsEstimated() &&
+        camera_state.parameters == parameters) {
+      continue;
+    }
+
+    camera_state.parameters.swap(parameters);
+    camera_state.is_estimated = view->IsEstimated();
+    camera_state.changed_at = num_selections_;
+    ++num_changed_cameras;
+  }
+  return num_changed_cameras;
+}
+
+bool BundleAdjustmentTrackSelector::HasValidStatistics(
+    const Reconstruction& reconstruction, const TrackEntry& entry) const {
+  if (entry.computed_at < 0) {
+    return false;
+  }
+
+  const Track* track = reconstruction.Track(entry.track_id);
+  if (track->NumViews() != entry.num_views || track->Point() != entry.point) {
+    return false;
+  }
+
+  // The statistics were computed after the camera states were last updated,
+  // so they are valid unless a camera changed in a later selection.
+  for (const ViewId view_id : track->ViewIds()) {
+    const auto camera_state = camera_states_.find(view_id);
+    if (camera_state == camera_states_.end() ||
+        camera_state->second.changed_at > entry.computed_at) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Compute the reprojection error and truncated track length for this specific
+// track. We truncate the track length based on the observation that while
+// larger track lengths provide better constraints for bundle adjustment, larger
+// tracks are also more likely to contain outliers in our experience. Truncating
+// the track lengths enforces that the long tracks with the lowest reprojection
+// error are chosen.
+void BundleAdjustmentTrackSelector::ComputeStatistics(
+    const Reconstruction& reconstruction, TrackEntry* entry) const {
+  // Any tracks that reach this function are guaranteed to exist and be
+  // estimated, so no need to check for that here.
+  const Track* track = reconstruction.Track(entry->track_id);
+
+  double sq_reprojection_error_sum = 0.0;
+  int num_valid_reprojections = 0;
+  // Compute the sq reprojection error for each view that observes the track
+  // and it it to the accumulating sum.
+  for (const ViewId view_id : track->ViewIds()) {
+    const View* view = reconstruction.View(view_id);
+    if (view == nullptr || !view->IsEstimated()) {
+      continue;
+    }
+    sq_reprojection_error_sum += ComputeSqReprojectionError(
+        *view, *view->GetFeature(entry->track_id), *track);
+    ++num_valid_reprojections;
+  }
+
+  const int truncated_track_length =
+      std::min(num_valid_reprojections, options_.long_track_length_threshold);
+  const double mean_sq_reprojection_error =
+      sq_reprojection_error_sum / static_cast<double>(num_valid_reprojections);
+  entry->point = track->Point();
+  entry->num_views = track->NumViews();
+  entry->statistics =
+      TrackStatistics(truncated_track_length, mean_sq_reprojection_error);
+  entry->computed_at = num_selections_;
+}
+
+// Select tracks from the image to ensure good spatial coverage of the image. To
+// do this, we first bin the tracks into grid cells in an image grid. Then
+// within each cell we find the best ranked track. The grid is a flat array
+// spanning the cells that contain features. If the features are spread so
+// widely that this array would be much larger than the number of features, the
+// observations are sorted by grid cell instead.
+void BundleAdjustmentTrackSelector::SelectBestTracksFromEachImageGridCell(
+    const std::vector<Observation>& observations,
+    std::vector<int>* best_entries) const {
+  best_entries->clear();
+  if (observations.empty()) {
+    return;
+  }
+
+  Eigen::Vector2i min_cell = observations[0].grid_cell;
+  Eigen::Vector2i max_cell = observations[0].grid_cell;
+  for (const Observation& observation : observations) {
+    min_cell = min_cell.cwiseMin(observation.grid_cell);
+    max_cell = max_cell.cwiseMax(observation.grid_cell);
+  }
+  const int64_t grid_width =
+      static_cast<int64_t>(max_cell.x()) - min_cell.x() + 1;
+  const int64_t grid_height =
+      static_cast<int64_t>(max_cell.y()) - min_cell.y() + 1;
+  const auto CellIndex = [&](const Eigen::Vector2i& grid_cell) {
+    return (grid_cell.y() - min_cell.y()) * grid_width +
+           (grid_cell.x() - min_cell.x());
+  };
+
+  // The features in each cell are ordered by track length first, then mean
+  // reprojection error. The first of several equally ranked features is kept.
+  const auto IsBetter = [&](const int entry1, const int entry2) {
+    return entries_[entry1].statistics < entries_[entry2].statistics;
+  };
+
+  const int64_t num_cells = grid_width * grid_height;
+  if (num_cells <= 4 * static_cast<int64_t>(observations.size()) + 64) {
+    std::vector<int> best_entry_in_cell(num_cells, -1);
+    for (const Observation& observation : observations) {
+      int& best_entry = best_entry_in_cell[CellIndex(observation.grid_cell)];
+      if (best_entry == -1 || IsBetter(observation.entry, best_entry)) {
+        best_entry = observation.entry;
+      }
+    }
+    for (const int best_entry : best_entry_in_cell) {
+      if (best_entry != -1) {
+        best_entries->emplace_back(best_entry);
+      }
+    }
+    return;
+  }
+
+  std::vector<std::pair<int64_t, int> > cells(observations.size());
+  for (int i = 0; i < observations.size(); i++) {
+    cells[i] = std::make_pair(CellIndex(observations[i].grid_cell), i);
+  }
+  std::sort(cells.begin(), cells.end());
+  for (int i = 0; i < cells.size(); i++) {
+    int best_entry = observations[cells[i].second].entry;
+    while (i + 1 < cells.size() && cells[i + 1].first == cells[i].first) {
+      ++i;
+      const int entry = observations[cells[i].second].entry;
+      if (IsBetter(entry, best_entry)) {
+        best_entry = entry;
+      }
+    }
+    best_entries->emplace_back(best_entry);
+  }
+}
+
+bool BundleAdjustmentTrackSelector::SelectTracks(
+    const Reconstruction& reconstruction,
+    const std::unordered_set<ViewId>& view_ids,
+    std::unordered_set<TrackId>* tracks_to_optimize) {
+  ++num_selections_;
+  const int selection = num_selections_;
+  const int num_changed_cameras = UpdateCameraStates(reconstruction);
+
+  // Gather the estimated tracks observed by each view in parallel.
+  const std::vector<ViewId> views(view_ids.begin(), view_ids.end());
+  const double inv_grid_cell_size = 1.0 / options_.image_grid_cell_size_pixels;
+  std::vector<std::vector<Observation> > observations(views.size());
+  ParallelFor(options_.num_threads, views.size(), [&](const int i) {
+    const View* view = reconstruction.View(views[i]);
+    const auto& track_ids = view->TrackIds();
+    observations[i].reserve(track_ids.size());
+    for (const TrackId track_id : track_ids) {
+      const Track* track = reconstruction.Track(track_id);
+      if (track == nullptr || !track->IsEstimated()) {
+        continue;
+      }
+      const Eigen::Vector2i grid_cell =
+          (view->GetFeature(track_id)->point_ * inv_grid_cell_size)
+              .cast<int>();
+      observations[i].emplace_back(Observation{track_id, -1, grid_cell});
+    }
+  });
+
+  // Assign each track to its entry and collect the entries of all tracks
+  // observed by the views.
+  std::vector<int> candidates;
+  for (std::vector<Observation>& observations_in_view : observations) {
+    for (Observation& observation : observations_in_view) {
+      const auto inserted = track_to_entry_.emplace(observation.track_id,
+                                                    entries_.size());
+      if (inserted.second) {
+        entries_.emplace_back();
+        entries_.back().track_id = observation.track_id;
+      }
+      observation.entry = inserted.first->second;
+
+      TrackEntry& entry = entries_[observation.entry];
+      if (entry.candidate_at != selection) {
+        entry.candidate_at = selection;
+        candidates.emplace_back(observation.entry);
+      }
+    }
+  }
+
+  // Compute the statistics of the tracks that are not cached.
+  std::vector<char> computed(candidates.size(), 0);
+  ParallelFor(options_.num_threads, candidates.size(), [&](const int i) {
+    TrackEntry* entry = &entries_[candidates[i]];
+    if (!HasValidStatistics(reconstruction, *entry)) {
+      ComputeStatistics(reconstruction, entry);
+      computed[i] = 1;
+    }
+  });
+  num_computed_track_statistics_ =
+      std::count(computed.begin(), computed.end(), 1);
+  VLOG(2) << num_changed_cameras << " cameras changed since the last "
+          << "selection. Computed the statistics of "
+          << num_computed_track_statistics_ << " of " << candidates.size()
+          << " tracks.";
+
+  for (const TrackId track_id : *tracks_to_optimize) {
+    const int* entry = FindOrNull(track_to_entry_, track_id);
+    if (entry != nullptr) {
+      entries_[*entry].selected_at = selection;
+    }
+  }
 
   // For each image, divide the image into a grid and choose the highest quality
   // tracks from each grid cell. This encourages good spatial coverage of tracks
   // within each image.
-  for (const ViewId view_id : view_ids) {
-    const View* view = reconstruction.View(view_id);
-
-    // Select the best tracks from each grid cell in the image and add them to
-    // the container of tracks to be optimized.
-    SelectBestTracksFromEachImageGridCell(reconstruction,
-                                          *view,
-                                          image_grid_cell_size_pixels,
-                                          track_statistics,
-                                          tracks_to_optimize);
+  std::vector<std::vector<int> > best_entries(views.size());
+  ParallelFor(options_.num_threads, views.size(), [&](const int i) {
+    SelectBestTracksFromEachImageGridCell(observations[i], &best_entries[i]);
+  });
+  for (const std::vector<int>& best_entries_in_view : best_entries) {
+    for (const int entry : best_entries_in_view) {
+      entries_[entry].selected_at = selection;
+    }
   }
 
   // To this point, we have only added features that have as full spatial
   // coverage as possible within each image but we have not ensured that each
   // image is constrainted by at least K features. So, we cycle through all
   // views again and add the top M tracks that have not already been added.
-  for (const ViewId view_id : view_ids) {
-    const View* view = reconstruction.View(view_id);
+  // This depends on the tracks selected for the previous views, so it is done
+  // sequentially.
+  std::vector<std::pair<TrackId, TrackStatistics> > ranked_candidate_tracks;
+  for (const std::vector<Observation>& observations_in_view : observations) {
+    int num_optimized_tracks = 0;
+    ranked_candidate_tracks.clear();
+    for (const Observation& observation : observations_in_view) {
+      const TrackEntry& entry = entries_[observation.entry];
+      if (entry.selected_at == selection) {
+        ++num_optimized_tracks;
+      } else {
+        ranked_candidate_tracks.emplace_back(entry.track_id, entry.statistics);
+      }
+    }
 
-    // If this view is not constrained by enough optimized tracks, add the top
-    // ranked features until there are enough tracks constraining the view.
-    SelectTopRankedTracksInView(reconstruction,
-                                track_statistics,
-                                *view,
-                                min_num_optimized_tracks_per_view,
-                                tracks_to_optimize);
+    // If the view is not constrained by enough optimized tracks, add the top
+    // candidate tracks until the minimum number of tracks is observed (or all
+    // tracks of the view are optimized).
+    const int num_optimized_tracks_needed =
+        std::min(options_.min_num_optimized_tracks_per_view -
+                     num_optimized_tracks,
+                 static_cast<int>(ranked_candidate_tracks.size()));
+    if (num_optimized_tracks_needed <= 0) {
+      continue;
+    }
+    std::partial_sort(
+        ranked_candidate_tracks.begin(),
+        ranked_candidate_tracks.begin() + num_optimized_tracks_needed,
+        ranked_candidate_tracks.end());
+    for (int i = 0; i < num_optimized_tracks_needed; i++) {
+      entries_[FindOrDie(track_to_entry_, ranked_candidate_tracks[i].first)]
+          .selected_at = selection;
+    }
   }
 
+  for (const int candidate : candidates) {
+    if (entries_[candidate].selected_at == selection) {
+      tracks_to_optimize->emplace(entries_[candidate].track_id);
+    }
+  }
   return true;
 }
 
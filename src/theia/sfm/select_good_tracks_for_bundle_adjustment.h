@@ -35,9 +35,14 @@
 #ifndef THEIA_SFM_SELECT_GOOD_TRACKS_FOR_BUNDLE_ADJUSTMENT_H_
 #define THEIA_SFM_SELECT_GOOD_TRACKS_FOR_BUNDLE_ADJUSTMENT_H_
 
+#include <Eigen/Core>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "theia/sfm/types.h"
+#include "theia/util/util.h"
 
 namespace theia {
 class Reconstruction;
@@ -81,6 +86,114 @@ bool SelectGoodTracksForBundleAdjustment(
     const int min_num_optimized_tracks_per_view,
     std::unordered_set<TrackId>* tracks_to_optimize);
 
+// Selects the same tracks as SelectGoodTracksForBundleAdjustment, but keeps the
+// track statistics (truncated track length and mean reprojection error) between
+// calls so that it may be reused before each bundle adjustment of a growing
+// reconstruction. The statistics of a track are only recomputed if its point
+// or its views changed, or if the camera of one of its views changed, since
+// they were last computed. The statistics and the per-view image grids are
+// computed in parallel.
+class BundleAdjustmentTrackSelector {
+ public:
+  struct Options {
+    // Tracks longer than this are ranked as if they had this length.
+    int long_track_length_threshold = 10;
+
+    // The width of the image grid cells in pixels.
+    int image_grid_cell_size_pixels = 100;
+
+    // Each view observes at least this many selected tracks (if possible).
+    int min_num_optimized_tracks_per_view = 100;
+
+    int num_threads = 1;
+  };
+
+  explicit BundleAdjustmentTrackSelector(const Options& options);
+
+  // Selects tracks from all estimated views of the reconstruction.
+  bool SelectTracks(const Reconstruction& reconstruction,
+                    std::unordered_set<TrackId>* tracks_to_optimize);
+
+  // Selects tracks from the given views only.
+  bool SelectTracks(const Reconstruction& reconstruction,
+                    const std::unordered_set<ViewId>& view_ids,
+                    std::unordered_set<TrackId>* tracks_to_optimize);
+
+  // Removes all cached statistics. This must be called before the selector is
+  // used with a different reconstruction.
+  void Clear();
+
+  // The number of tracks whose statistics were computed by the last call to
+  // SelectTracks, i.e. that were not taken from the cache.
+  int NumComputedTrackStatistics() const {
+    return num_computed_track_statistics_;
+  }
+
+ private:
+  // Track length truncated to long_track_length_threshold and mean squared
+  // reprojection error.
+  typedef std::pair<int, double> TrackStatistics;
+
+  struct TrackEntry {
+    TrackId track_id;
+    // The point and number of views at the time the statistics were computed.
+    Eigen::Matrix<double, 4, 1, Eigen::DontAlign> point;
+    int num_views = 0;
+    TrackStatistics statistics;
+
+    // The last selection in which the statistics were computed, the track was
+    // a candidate or the track was selected, or -1.
+    int computed_at = -1;
+    int candidate_at = -1;
+    int selected_at = -1;
+  };
+
+  struct CameraState {
+    std::vector<double> parameters;
+    bool is_estimated = false;
+    // The selection in which a change of the camera was last detected.
+    int changed_at = -1;
+  };
+
+  // An estimated track observed by one of the selected views and the image
+  // grid cell of its feature.
+  struct Observation {
+    TrackId track_id;
+    int entry;
+    Eigen::Vector2i grid_cell;
+  };
+
+  // Updates the camera states and returns the number of changed cameras.
+  int UpdateCameraStates(const Reconstruction& reconstruction);
+
+  // Returns true if the cached statistics of the entry are still valid.
+  bool HasValidStatistics(const Reconstruction& reconstruction,
+                          const TrackEntry& entry) const;
+
+  void ComputeStatistics(const Reconstruction& reconstruction,
+                         TrackEntry* entry) const;
+
+  // Returns the entries of the tracks with the best statistics in each image
+  // grid cell of the view.
+  void SelectBestTracksFromEachImageGridCell(
+      const std::vector<Observation>& observations,
+      std::vector<int>* best_entries) const;
+
+  const Options options_;
+
+  // The number of calls to SelectTracks since the last call to Clear.
+  int num_selections_;
+  int num_computed_track_statistics_;
+
+  std::unordered_map<ViewId, CameraState> camera_states_;
+
+  // The statistics are stored densely and each track keeps its entry.
+  std::unordered_map<TrackId, int> track_to_entry_;
+  std::vector<TrackEntry> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(BundleAdjustmentTrackSelector);
+};
+
 }  // namespace theia
 
 #endif  // THEIA_SFM_SELECT_GOOD_TRACKS_FOR_BUNDLE_ADJUSTMENT_H_
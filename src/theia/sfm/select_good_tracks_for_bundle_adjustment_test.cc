@@ -0,0 +1,183 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "theia/sfm/camera/camera.h"
+#include "theia/sfm/reconstruction.h"
+#include "theia/sfm/select_good_tracks_for_bundle_adjustment.h"
+#include "theia/sfm/track.h"
+#include "theia/sfm/types.h"
+#include "theia/sfm/view.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+namespace {
+
+static const int kNumViews = 10;
+static const int kNumTracks = 1000;
+static const int kNumThreads = 4;
+
+// Creates a reconstruction of cameras on a line that observe random points in
+// front of them with noisy observations.
+void CreateReconstruction(Reconstruction* reconstruction) {
+  RandomNumberGenerator rng(53);
+  for (int i = 0; i < kNumViews; i++) {
+    const ViewId view_id =
+        reconstruction->AddView(std::to_string(i), static_cast<double>(i));
+    View* view = reconstruction->MutableView(view_id);
+    Camera* camera = view->MutableCamera();
+    camera->SetFocalLength(1000.0);
+    camera->SetPrincipalPoint(500.0, 500.0);
+    camera->SetPosition(Eigen::Vector3d(i, 0.0, 0.0));
+    view->SetEstimated(true);
+  }
+
+  for (int i = 0; i < kNumTracks; i++) {
+    const Eigen::Vector4d point(rng.RandDouble(-5.0, kNumViews + 5.0),
+                                rng.RandDouble(-5.0, 5.0),
+                                rng.RandDouble(5.0, 20.0),
+                                1.0);
+    const int num_observations = rng.RandInt(2, 6);
+    std::unordered_set<ViewId> view_ids;
+    while (view_ids.size() < num_observations) {
+      view_ids.insert(rng.RandInt(0, kNumViews - 1));
+    }
+
+    std::vector<std::pair<ViewId, Feature> > observations;
+    for (const ViewId view_id : view_ids) {
+      Eigen::Vector2d pixel;
+      reconstruction->View(view_id)->Camera().ProjectPoint(point, &pixel);
+      pixel += Eigen::Vector2d(rng.RandGaussian(0.0, 1.0),
+                               rng.RandGaussian(0.0, 1.0));
+      observations.emplace_back(view_id, Feature(pixel));
+    }
+    const TrackId track_id = reconstruction->AddTrack(observations);
+    Track* track = reconstruction->MutableTrack(track_id);
+    track->SetPoint(point);
+    track->SetEstimated(true);
+  }
+}
+
+BundleAdjustmentTrackSelector::Options SelectorOptions(const int num_threads) {
+  BundleAdjustmentTrackSelector::Options options;
+  options.long_track_length_threshold = 4;
+  options.image_grid_cell_size_pixels = 200;
+  options.min_num_optimized_tracks_per_view = 30;
+  options.num_threads = num_threads;
+  return options;
+}
+
+}  // namespace
+
+TEST(BundleAdjustmentTrackSelector, EachViewObservesEnoughTracks) {
+  Reconstruction reconstruction;
+  CreateReconstruction(&reconstruction);
+
+  BundleAdjustmentTrackSelector track_selector(SelectorOptions(kNumThreads));
+  std::unordered_set<TrackId> tracks_to_optimize;
+  EXPECT_TRUE(track_selector.SelectTracks(reconstruction, &tracks_to_optimize));
+  EXPECT_GT(tracks_to_optimize.size(), 0);
+  EXPECT_LT(tracks_to_optimize.size(), kNumTracks);
+
+  for (const ViewId view_id : reconstruction.ViewIds()) {
+    int num_optimized_tracks = 0;
+    for (const TrackId track_id : reconstruction.View(view_id)->TrackIds()) {
+      if (tracks_to_optimize.count(track_id) > 0) {
+        ++num_optimized_tracks;
+      }
+    }
+    EXPECT_GE(num_optimized_tracks, 30);
+  }
+}
+
+TEST(BundleAdjustmentTrackSelector, MultithreadedMatchesSingleThreaded) {
+  Reconstruction reconstruction;
+  CreateReconstruction(&reconstruction);
+  const BundleAdjustmentTrackSelector::Options options = SelectorOptions(1);
+
+  std::unordered_set<TrackId> tracks_to_optimize1;
+  EXPECT_TRUE(SelectGoodTracksForBundleAdjustment(
+      reconstruction,
+      options.long_track_length_threshold,
+      options.image_grid_cell_size_pixels,
+      options.min_num_optimized_tracks_per_view,
+      &tracks_to_optimize1));
+
+  BundleAdjustmentTrackSelector track_selector(SelectorOptions(kNumThreads));
+  std::unordered_set<TrackId> tracks_to_optimize2;
+  EXPECT_TRUE(
+      track_selector.SelectTracks(reconstruction, &tracks_to_optimize2));
+  EXPECT_EQ(tracks_to_optimize1, tracks_to_optimize2);
+}
+
+TEST(BundleAdjustmentTrackSelector, OnlyChangedTracksAreRecomputed) {
+  Reconstruction reconstruction;
+  CreateReconstruction(&reconstruction);
+  BundleAdjustmentTrackSelector track_selector(SelectorOptions(kNumThreads));
+
+  std::unordered_set<TrackId> tracks_to_optimize;
+  track_selector.SelectTracks(reconstruction, &tracks_to_optimize);
+  EXPECT_EQ(track_selector.NumComputedTrackStatistics(), kNumTracks);
+
+  // Nothing changed, so all statistics are cached.
+  std::unordered_set<TrackId> cached_tracks_to_optimize;
+  track_selector.SelectTracks(reconstruction, &cached_tracks_to_optimize);
+  EXPECT_EQ(track_selector.NumComputedTrackStatistics(), 0);
+  EXPECT_EQ(tracks_to_optimize, cached_tracks_to_optimize);
+
+  // Moving a point invalidates its track only.
+  const TrackId track_id = 0;
+  *reconstruction.MutableTrack(track_id)->MutablePoint() +=
+      Eigen::Vector4d(0.01, 0.0, 0.0, 0.0);
+  track_selector.SelectTracks(reconstruction, &tracks_to_optimize);
+  EXPECT_EQ(track_selector.NumComputedTrackStatistics(), 1);
+
+  // Moving a camera invalidates all tracks that it observes.
+  const ViewId view_id = 3;
+  View* view = reconstruction.MutableView(view_id);
+  view->MutableCamera()->SetPosition(Eigen::Vector3d(3.01, 0.0, 0.0));
+  track_selector.SelectTracks(reconstruction, &tracks_to_optimize);
+  EXPECT_EQ(track_selector.NumComputedTrackStatistics(), view->NumFeatures());
+
+  track_selector.Clear();
+  track_selector.SelectTracks(reconstruction, &tracks_to_optimize);
+  EXPECT_EQ(track_selector.NumComputedTrackStatistics(), kNumTracks);
+}
+
+}  // namespace theia
@@ -37,6 +37,7 @@
 #include <Eigen/Core>
 #include <glog/logging.h>
 #include <unordered_set>
+#include <vector>
 
 #include "theia/sfm/camera/camera.h"
 #include "theia/sfm/reconstruction.h"
@@ -44,9 +45,77 @@
 #include "theia/sfm/triangulation/triangulation.h"
 #include "theia/sfm/types.h"
 #include "theia/sfm/view.h"
+#include "theia/util/threadpool.h"
 
 namespace theia {
 
+namespace {
+
+enum class TrackStatus {
+  INLIER = 0,
+  BAD_REPROJECTION = 1,
+  INSUFFICIENT_VIEWING_ANGLE = 2,
+};
+
+// Determines whether the track is an outlier because of a large reprojection
+// error or whether it is poorly constrained because of a small viewing angle.
+// Unestimated tracks are reported as inliers so that they are left untouched.
+TrackStatus CheckTrack(const Reconstruction& reconstruction,
+                       const TrackId track_id,
+                       const double max_sq_reprojection_error,
+                       const double min_triangulation_angle_degrees) {
+  const Track* track = CHECK_NOTNULL(reconstruction.Track(track_id));
+  if (!track->IsEstimated()) {
+    return TrackStatus::INLIER;
+  }
+
+  const auto& view_ids = track->ViewIds();
+  std::vector<Eigen::Vector3d> ray_directions;
+  ray_directions.reserve(view_ids.size());
+  int num_projections = 0;
+  double mean_sq_reprojection_error = 0;
+  for (const ViewId view_id : view_ids) {
+    const View* view = CHECK_NOTNULL(reconstruction.View(view_id));
+    if (!view->IsEstimated()) {
+      continue;
+    }
+
+    const Camera& camera = view->Camera();
+    const Eigen::Vector3d ray_direction =
+        track->Point().hnormalized() - camera.GetPosition();
+    ray_directions.push_back(ray_direction.normalized());
+
+    // Check the reprojection error.
+    const Feature* feature = view->GetFeature(track_id);
+    // Reproject the observations.
+    Eigen::Vector2d projection;
+    const double depth = camera.ProjectPoint(track->Point(), &projection);
+    // Remove the feature if the reprojection is behind the camera.
+    if (depth < 0) {
+      return TrackStatus::BAD_REPROJECTION;
+    }
+    mean_sq_reprojection_error +=
+        (projection - (*feature).point_).squaredNorm();
+    ++num_projections;
+  }
+
+  mean_sq_reprojection_error /= static_cast<double>(num_projections);
+  if (mean_sq_reprojection_error > max_sq_reprojection_error) {
+    return TrackStatus::BAD_REPROJECTION;
+  }
+
+  // The track will remain estimated if the reprojection errors were all
+  // good. We then test that the track is properly constrained by having at
+  // least two cameras view it with a sufficient viewing angle.
+  if (!SufficientTriangulationAngle(ray_directions,
+                                    min_triangulation_angle_degrees)) {
+    return TrackStatus::INSUFFICIENT_VIEWING_ANGLE;
+  }
+  return TrackStatus::INLIER;
+}
+
+}  // namespace
+
 int SetOutlierTracksToUnestimated(const double max_inlier_reprojection_error,
                                   const double min_triangulation_angle_degrees,
                                   Reconstruction* reconstruction) {
@@ -63,67 +132,46 @@ int SetOutlierTracksToUnestimated(const std::unordered_set<TrackId>& track_ids,
                                   const double max_inlier_reprojection_error,
                                   const double min_triangulation_angle_degrees,
                                   Reconstruction* reconstruction) {
+  return SetOutlierTracksToUnestimated(track_ids,
+                                       max_inlier_reprojection_error,
+                                       min_triangulation_angle_degrees,
+                                       1,
+                                       reconstruction);
+}
+
+int SetOutlierTracksToUnestimated(const std::unordered_set<TrackId>& track_ids,
+                                  const double max_inlier_reprojection_error,
+                                  const double min_triangulation_angle_degrees,
+                                  const int num_threads,
+                                  Reconstruction* reconstruction) {
+  CHECK_GE(num_threads, 1);
   const double max_sq_reprojection_error =
       max_inlier_reprojection_error * max_inlier_reprojection_error;
 
-  int num_estimated_tracks = 0;
+  // Each track is only read while the tracks are checked in parallel. The
+  // outliers are set to unestimated afterwards.
+  const std::vector<TrackId> tracks(track_ids.begin(), track_ids.end());
+  std::vector<TrackStatus> track_status(tracks.size(), TrackStatus::INLIER);
+  ParallelFor(num_threads, tracks.size(), [&](const int i) {
+    track_status[i] = CheckTrack(*reconstruction,
+                                 tracks[i],
+                                 max_sq_reprojection_error,
+                                 min_triangulation_angle_degrees);
+  });
+
   int num_bad_reprojections = 0;
   int num_insufficient_viewing_angles = 0;
-
-  for (const TrackId track_id : track_ids) {
-    Track* track = reconstruction->MutableTrack(track_id);
-    if (!track->IsEstimated()) {
+  for (int i = 0; i < tracks.size(); i++) {
+    if (track_status[i] == TrackStatus::INLIER) {
       continue;
     }
-    ++num_estimated_tracks;
-
-    std::vector<Eigen::Vector3d> ray_directions;
-    const auto& view_ids = track->ViewIds();
-    int num_projections = 0;
-    double mean_sq_reprojection_error = 0;
-    for (const ViewId view_id : view_ids) {
-      const View* view = CHECK_NOTNULL(reconstruction->View(view_id));
-      if (!view->IsEstimated()) {
-        continue;
-      }
-
-      const Camera& camera = view->Camera();
-      const Eigen::Vector3d ray_direction =
-          track->Point().hnormalized() - camera.GetPosition();
-      ray_directions.push_back(ray_direction.normalized());
-
-      // Check the reprojection error.
-      const Feature* feature = view->GetFeature(track_id);
-      // Reproject the observations.
-      Eigen::Vector2d projection;
-      const double depth = camera.ProjectPoint(track->Point(), &projection);
-      // Remove the feature if the reprojection is behind the camera.
-      if (depth < 0) {
-        ++num_bad_reprojections;
-        track->SetEstimated(false);
-        break;
-      }
-      mean_sq_reprojection_error +=
-          (projection - (*feature).point_).squaredNorm();
-      ++num_projections;
-    }
 
-    mean_sq_reprojection_error /= static_cast<double>(num_projections);
-    if (track->IsEstimated() &&
-        mean_sq_reprojection_error > max_sq_reprojection_error) {
+    if (track_status[i] == TrackStatus::BAD_REPROJECTION) {
       ++num_bad_reprojections;
-      track->SetEstimated(false);
-    }
-
-    // The track will remain estimated if the reprojection errors were all
-    // good. We then test that the track is properly constrained by having at
-    // least two cameras view it with a sufficient viewing angle.
-    if (track->IsEstimated() &&
-        !SufficientTriangulationAngle(ray_directions,
-                                      min_triangulation_angle_degrees)) {
+    } else {
       ++num_insufficient_viewing_angles;
-      track->SetEstimated(false);
     }
+    reconstruction->MutableTrack(tracks[i])->SetEstimated(false);
   }
 
   LOG_IF(INFO, num_bad_reprojections > 0 || num_insufficient_viewing_angles > 0)
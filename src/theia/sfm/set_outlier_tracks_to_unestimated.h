@@ -54,6 +54,15 @@ int SetOutlierTracksToUnestimated(const double max_inlier_reprojection_error,
                                   const double min_triangulation_angle_degrees,
                                   Reconstruction* reconstruction);
 
+// Same as above, but the tracks are checked in parallel with num_threads
+// threads. The reprojections are computed before any track is modified, so the
+// result is identical to the single-threaded version.
+int SetOutlierTracksToUnestimated(const std::unordered_set<TrackId>& tracks,
+                                  const double max_inlier_reprojection_error,
+                                  const double min_triangulation_angle_degrees,
+                                  const int num_threads,
+                                  Reconstruction* reconstruction);
+
 }  // namespace theia
 
 #endif  // THEIA_SFM_SET_OUTLIER_TRACKS_TO_UNESTIMATED_H_
@@ -1,13 +1,64 @@
 
 #include "theia/sfm/sfm_wrapper.h"
+#include "theia/matching/feature_correspondence.h"
+#include "theia/sfm/camera_intrinsics_prior.h"
 #include "theia/sfm/reconstruction.h"
 #include "theia/sfm/twoview_info.h"
 #include "theia/sfm/view_graph/view_graph.h"
 //#include "theia/image/image.h"
 #include "theia/sfm/camera/camera.h"
 
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "theia/util/map_util.h"
+
 namespace theia {
 
+namespace {
+
+std::vector<ViewId> SortedEstimatedViewIds(
+    const Reconstruction& reconstruction) {
+  std::vector<ViewId> view_ids;
+  view_ids.reserve(reconstruction.NumViews());
+  for (const ViewId view_id : reconstruction.ViewIds()) {
+    if (reconstruction.View(view_id)->IsEstimated()) {
+      view_ids.emplace_back(view_id);
+    }
+  }
+  std::sort(view_ids.begin(), view_ids.end());
+  return view_ids;
+}
+
+std::vector<TrackId> SortedEstimatedTrackIds(
+    const Reconstruction& reconstruction) {
+  std::vector<TrackId> track_ids;
+  track_ids.reserve(reconstruction.NumTracks());
+  for (const TrackId track_id : reconstruction.TrackIds()) {
+    if (reconstruction.Track(track_id)->IsEstimated()) {
+      track_ids.emplace_back(track_id);
+    }
+  }
+  std::sort(track_ids.begin(), track_ids.end());
+  return track_ids;
+}
+
+// The bulk conversions are called from Python with user provided arrays, so
+// malformed input raises an exception (a ValueError in Python) instead of
+// aborting the interpreter.
+void CheckNumRows(const char* name, const int num_rows, const int expected) {
+  if (num_rows != expected) {
+    throw std::invalid_argument(std::string(name) + " has " +
+                                std::to_string(num_rows) +
+                                " rows but expected " +
+                                std::to_string(expected));
+  }
+}
+
+}  // namespace
+
 std::tuple<bool, TwoViewInfo, std::vector<int>> EstimateTwoViewInfoWrapper(
     const EstimateTwoViewInfoOptions& options,
     const CameraIntrinsicsPrior& intrinsics1,
@@ -24,6 +75,81 @@ std::tuple<bool, TwoViewInfo, std::vector<int>> EstimateTwoViewInfoWrapper(
   return std::make_tuple(success, twoview_info, inlier_indices);
 }
 
+std::tuple<BoolArray, Array2d, Array3d, Array3d, Array3i, BoolArray>
+EstimateTwoViewInfosWrapper(
+    const EstimateTwoViewInfoOptions& options,
+    const std::vector<CameraIntrinsicsPrior>& intrinsics1,
+    const std::vector<CameraIntrinsicsPrior>& intrinsics2,
+    const Array2d& points1,
+    const Array2d& points2,
+    const Eigen::VectorXi& offsets,
+    const int num_threads) {
+  if (num_threads < 1) {
+    throw std::invalid_argument("num_threads must be at least 1");
+  }
+  if (offsets.size() < 1 || offsets(0) != 0 ||
+      offsets(offsets.size() - 1) != points1.rows()) {
+    throw std::invalid_argument(
+        "offsets must start at 0 and end at the number of correspondences");
+  }
+  const int num_view_pairs = offsets.size() - 1;
+  CheckNumRows("points2", points2.rows(), points1.rows());
+  CheckNumRows("intrinsics1", intrinsics1.size(), num_view_pairs);
+  CheckNumRows("intrinsics2", intrinsics2.size(), num_view_pairs);
+  for (int i = 0; i < num_view_pairs; i++) {
+    if (offsets(i) > offsets(i + 1)) {
+      throw std::invalid_argument("offsets must be non-decreasing");
+    }
+  }
+
+  std::vector<std::vector<FeatureCorrespondence>> correspondences(
+      num_view_pairs);
+  for (int i = 0; i < num_view_pairs; i++) {
+    correspondences[i].reserve(offsets(i + 1) - offsets(i));
+    for (int j = offsets(i); j < offsets(i + 1); j++) {
+      correspondences[i].emplace_back(Feature(points1.row(j).transpose()),
+                                      Feature(points2.row(j).transpose()));
+    }
+  }
+
+  std::vector<bool> successes;
+  std::vector<TwoViewInfo> twoview_infos;
+  std::vector<std::vector<int>> inlier_indices;
+  EstimateTwoViewInfos(options,
+                       num_threads,
+                       intrinsics1,
+                       intrinsics2,
+                       correspondences,
+                       &successes,
+                       &twoview_infos,
+                       &inlier_indices);
+
+  // The rows of view pairs that could not be estimated are zero.
+  BoolArray estimated(num_view_pairs);
+  Array2d focal_lengths = Array2d::Zero(num_view_pairs, 2);
+  Array3d rotations = Array3d::Zero(num_view_pairs, 3);
+  Array3d positions = Array3d::Zero(num_view_pairs, 3);
+  Array3i counts = Array3i::Zero(num_view_pairs, 3);
+  BoolArray inlier_mask = BoolArray::Constant(points1.rows(), false);
+  for (int i = 0; i < num_view_pairs; i++) {
+    estimated(i) = successes[i];
+    if (!successes[i]) {
+      continue;
+    }
+    const TwoViewInfo& info = twoview_infos[i];
+    focal_lengths.row(i) << info.focal_length_1, info.focal_length_2;
+    rotations.row(i) = info.rotation_2.transpose();
+    positions.row(i) = info.position_2.transpose();
+    counts.row(i) << info.num_verified_matches, info.num_homography_inliers,
+        info.visibility_score;
+    for (const int inlier : inlier_indices[i]) {
+      inlier_mask(offsets(i) + inlier) = true;
+    }
+  }
+  return std::make_tuple(
+      estimated, focal_lengths, rotations, positions, counts, inlier_mask);
+}
+
 std::tuple<bool, std::unordered_set<TrackId>>
 SelectGoodTracksForBundleAdjustmentWrapper(
     const Reconstruction& reconstruction,
@@ -42,6 +168,17 @@ SelectGoodTracksForBundleAdjustmentWrapper(
   return std::make_tuple(success, tracks_to_optimize);
 }
 
+std::tuple<int, std::vector<LocalizeViewSummary>>
+LocalizeViewsToReconstructionWrapper(
+    const std::vector<ViewId>& view_ids,
+    const LocalizeViewToReconstructionOptions& options,
+    Reconstruction& reconstruction) {
+  std::vector<LocalizeViewSummary> summaries;
+  const int num_localized_views = LocalizeViewsToReconstruction(
+      view_ids, options, &reconstruction, &summaries);
+  return std::make_tuple(num_localized_views, summaries);
+}
+
 int SetOutlierTracksToUnestimatedWrapper(
     const std::unordered_set<TrackId>& tracks,
     const double max_inlier_reprojection_error,
@@ -55,4 +192,213 @@ int SetOutlierTracksToUnestimatedWrapper(
   return num_features_rm;
 }
 
+std::tuple<IdArray, Array4d, Array3u8> TracksToArraysWrapper(
+    const Reconstruction& reconstruction) {
+  const std::vector<TrackId> track_ids =
+      SortedEstimatedTrackIds(reconstruction);
+  IdArray ids(track_ids.size());
+  Array4d points(track_ids.size(), 4);
+  Array3u8 colors(track_ids.size(), 3);
+  for (int i = 0; i < track_ids.size(); i++) {
+    const Track* track = reconstruction.Track(track_ids[i]);
+    ids(i) = track_ids[i];
+    points.row(i) = track->Point().transpose();
+    colors.row(i) = track->Color().transpose();
+  }
+  return std::make_tuple(ids, points, colors);
+}
+
+std::tuple<IdArray, Array6d, Eigen::VectorXi, ArrayXd> ViewsToArraysWrapper(
+    const Reconstruction& reconstruction) {
+  const std::vector<ViewId> view_ids = SortedEstimatedViewIds(reconstruction);
+  int num_intrinsics = 0;
+  for (const ViewId view_id : view_ids) {
+    num_intrinsics = std::max(num_intrinsics,
+                              reconstruction.View(view_id)
+                                  ->Camera()
+                                  .CameraIntrinsics()
+                                  ->NumParameters());
+  }
+
+  IdArray ids(view_ids.size());
+  Array6d poses(view_ids.size(), 6);
+  Eigen::VectorXi intrinsics_types(view_ids.size());
+  ArrayXd intrinsics = ArrayXd::Zero(view_ids.size(), num_intrinsics);
+  for (int i = 0; i < view_ids.size(); i++) {
+    const Camera& camera = reconstruction.View(view_ids[i])->Camera();
+    ids(i) = view_ids[i];
+    poses.block<1, 3>(i, 0) = camera.GetOrientationAsAngleAxis().transpose();
+    poses.block<1, 3>(i, 3) = camera.GetPosition().transpose();
+    intrinsics_types(i) =
+        static_cast<int>(camera.GetCameraIntrinsicsModelType());
+    const int num_parameters = camera.CameraIntrinsics()->NumParameters();
+    intrinsics.row(i).head(num_parameters) =
+        Eigen::Map<const Eigen::RowVectorXd>(camera.intrinsics(),
+                                             num_parameters);
+  }
+  return std::make_tuple(ids, poses, intrinsics_types, intrinsics);
+}
+
+std::tuple<Eigen::VectorXi, Eigen::VectorXi, Array2d>
+ObservationsToArraysWrapper(const Reconstruction& reconstruction) {
+  const std::vector<ViewId> view_ids = SortedEstimatedViewIds(reconstruction);
+  const std::vector<TrackId> track_ids =
+      SortedEstimatedTrackIds(reconstruction);
+  std::unordered_map<ViewId, int> view_index;
+  view_index.reserve(view_ids.size());
+  for (int i = 0; i < view_ids.size(); i++) {
+    view_index.emplace(view_ids[i], i);
+  }
+
+  int num_observations = 0;
+  for (const TrackId track_id : track_ids) {
+    num_observations += reconstruction.Track(track_id)->NumViews();
+  }
+
+  Eigen::VectorXi view_indices(num_observations);
+  Eigen::VectorXi track_indices(num_observations);
+  Array2d features(num_observations, 2);
+  std::vector<int> observing_views;
+  int num_estimated_observations = 0;
+  for (int i = 0; i < track_ids.size(); i++) {
+    observing_views.clear();
+    for (const ViewId view_id : reconstruction.Track(track_ids[i])->ViewIds()) {
+      const int* index = FindOrNull(view_index, view_id);
+      if (index != nullptr) {
+        observing_views.emplace_back(*index);
+      }
+    }
+    std::sort(observing_views.begin(), observing_views.end());
+
+    for (const int j : observing_views) {
+      const Feature* feature =
+          reconstruction.View(view_ids[j])->GetFeature(track_ids[i]);
+      view_indices(num_estimated_observations) = j;
+      track_indices(num_estimated_observations) = i;
+      features.row(num_estimated_observations) = feature->point_.transpose();
+      ++num_estimated_observations;
+    }
+  }
+
+  view_indices.conservativeResize(num_estimated_observations);
+  track_indices.conservativeResize(num_estimated_observations);
+  features.conservativeResize(num_estimated_observations, 2);
+  return std::make_tuple(view_indices, track_indices, features);
+}
+
+IdArray AddViewsFromArraysWrapper(const std::vector<std::string>& names,
+                                  const Eigen::VectorXd& timestamps,
+                                  const Array6d& poses,
+                                  const Eigen::VectorXi& intrinsics_types,
+                                  const ArrayXd& intrinsics,
+                                  Reconstruction& reconstruction) {
+  const int num_views = names.size();
+  CheckNumRows("timestamps", timestamps.size(), num_views);
+  CheckNumRows("poses", poses.rows(), num_views);
+  CheckNumRows("intrinsics_types", intrinsics_types.size(), num_views);
+  CheckNumRows("intrinsics", intrinsics.rows(), num_views);
+
+  // Validate all rows before the reconstruction is modified.
+  for (int i = 0; i < num_views; i++) {
+    if (intrinsics_types(i) <=
+            static_cast<int>(CameraIntrinsicsModelType::INVALID) ||
+        intrinsics_types(i) >
+            static_cast<int>(CameraIntrinsicsModelType::ORTHOGRAPHIC)) {
+      throw std::invalid_argument("Invalid camera intrinsics model type " +
+                                  std::to_string(intrinsics_types(i)) +
+                                  " for view " + names[i]);
+    }
+    const int num_parameters =
+        CameraIntrinsicsModel::Create(
+            static_cast<CameraIntrinsicsModelType>(intrinsics_types(i)))
+            ->NumParameters();
+    if (num_parameters > intrinsics.cols()) {
+      throw std::invalid_argument(
+          "Not enough intrinsics parameters for view " + names[i]);
+    }
+  }
+
+  IdArray view_ids(num_views);
+  for (int i = 0; i < num_views; i++) {
+    view_ids(i) = reconstruction.AddView(names[i], timestamps(i));
+    if (view_ids(i) == kInvalidViewId) {
+      continue;
+    }
+
+    View* view = reconstruction.MutableView(view_ids(i));
+    Camera* camera = view->MutableCamera();
+    camera->SetOrientationFromAngleAxis(poses.block<1, 3>(i, 0).transpose());
+    camera->SetPosition(poses.block<1, 3>(i, 3).transpose());
+    camera->SetCameraIntrinsicsModelType(
+        static_cast<CameraIntrinsicsModelType>(intrinsics_types(i)));
+    const int num_parameters = camera->CameraIntrinsics()->NumParameters();
+    Eigen::Map<Eigen::RowVectorXd>(camera->mutable_intrinsics(),
+                                   num_parameters) =
+        intrinsics.row(i).head(num_parameters);
+    view->SetEstimated(true);
+  }
+  return view_ids;
+}
+
+IdArray AddTracksFromArraysWrapper(const IdArray& view_ids,
+                                   const Array4d& points,
+                                   const Array3u8& colors,
+                                   const Eigen::VectorXi& view_indices,
+                                   const Eigen::VectorXi& track_indices,
+                                   const Array2d& features,
+                                   Reconstruction& reconstruction) {
+  const int num_tracks = points.rows();
+  const int num_observations = view_indices.size();
+  CheckNumRows("colors", colors.rows(), num_tracks);
+  CheckNumRows("track_indices", track_indices.size(), num_observations);
+  CheckNumRows("features", features.rows(), num_observations);
+
+  // Bucket the observations by track so that each track is gathered in one
+  // pass over the observations.
+  std::vector<int> track_offsets(num_tracks + 1, 0);
+  for (int i = 0; i < num_observations; i++) {
+    if (track_indices(i) < 0 || track_indices(i) >= num_tracks) {
+      throw std::invalid_argument("Track index " +
+                                  std::to_string(track_indices(i)) +
+                                  " is out of range");
+    }
+    if (view_indices(i) < 0 || view_indices(i) >= view_ids.size()) {
+      throw std::invalid_argument("View index " +
+                                  std::to_string(view_indices(i)) +
+                                  " is out of range");
+    }
+    ++track_offsets[track_indices(i) + 1];
+  }
+  for (int i = 0; i < num_tracks; i++) {
+    track_offsets[i + 1] += track_offsets[i];
+  }
+  std::vector<int> observations(num_observations);
+  std::vector<int> next_observation(track_offsets.begin(),
+                                    track_offsets.end() - 1);
+  for (int i = 0; i < num_observations; i++) {
+    observations[next_observation[track_indices(i)]++] = i;
+  }
+
+  IdArray track_ids(num_tracks);
+  std::vector<std::pair<ViewId, Feature>> track;
+  for (int i = 0; i < num_tracks; i++) {
+    track.clear();
+    for (int j = track_offsets[i]; j < track_offsets[i + 1]; j++) {
+      const int observation = observations[j];
+      track.emplace_back(view_ids(view_indices(observation)),
+                         Feature(features.row(observation).transpose()));
+    }
+
+    track_ids(i) = reconstruction.AddTrack(track);
+    if (track_ids(i) == kInvalidTrackId) {
+      continue;
+    }
+    Track* new_track = reconstruction.MutableTrack(track_ids(i));
+    new_track->SetPoint(points.row(i).transpose());
+    new_track->SetColor(colors.row(i).transpose());
+    new_track->SetEstimated(true);
+  }
+  return track_ids;
+}
+
 }  // namespace theia
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <Eigen/Core>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
 #include "theia/sfm/colorize_reconstruction.h"
 #include "theia/sfm/estimate_twoview_info.h"
 #include "theia/sfm/extract_maximally_parallel_rigid_subgraph.h"
@@ -23,12 +29,43 @@ class TwoViewInfo;
 class ViewGraph;
 class Camera;
 
+// Contiguous (row-major) arrays that pybind11 hands to numpy without a copy.
+typedef Eigen::Matrix<uint32_t, Eigen::Dynamic, 1> IdArray;
+typedef Eigen::Matrix<bool, Eigen::Dynamic, 1> BoolArray;
+typedef Eigen::Matrix<double, Eigen::Dynamic, 2, Eigen::RowMajor> Array2d;
+typedef Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> Array3d;
+typedef Eigen::Matrix<double, Eigen::Dynamic, 4, Eigen::RowMajor> Array4d;
+typedef Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor> Array6d;
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+    ArrayXd;
+typedef Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> Array3i;
+typedef Eigen::Matrix<uint8_t, Eigen::Dynamic, 3, Eigen::RowMajor> Array3u8;
+
 std::tuple<bool, TwoViewInfo, std::vector<int>> EstimateTwoViewInfoWrapper(
     const EstimateTwoViewInfoOptions& options,
     const CameraIntrinsicsPrior& intrinsics1,
     const CameraIntrinsicsPrior& intrinsics2,
     const std::vector<FeatureCorrespondence>& correspondences);
     
+// Batched version of EstimateTwoViewInfoWrapper. The correspondences of all
+// view pairs are stacked in points1 and points2 and the correspondences of the
+// i-th pair are the rows [offsets(i), offsets(i + 1)). Returns one row per view
+// pair with whether it was estimated, the focal lengths of both views, the
+// angle-axis rotation and the position of the second view, and the number of
+// verified matches, homography inliers and the visibility score. The last
+// output is the inlier mask of every correspondence. The rows of view pairs
+// that could not be estimated are zero. Throws std::invalid_argument if the
+// inputs are inconsistent.
+std::tuple<BoolArray, Array2d, Array3d, Array3d, Array3i, BoolArray>
+EstimateTwoViewInfosWrapper(
+    const EstimateTwoViewInfoOptions& options,
+    const std::vector<CameraIntrinsicsPrior>& intrinsics1,
+    const std::vector<CameraIntrinsicsPrior>& intrinsics2,
+    const Array2d& points1,
+    const Array2d& points2,
+    const Eigen::VectorXi& offsets,
+    const int num_threads);
+
 std::tuple<bool, std::unordered_set<TrackId>>
 SelectGoodTracksForBundleAdjustmentWrapper(
     const Reconstruction& reconstruction,
@@ -37,11 +74,61 @@ SelectGoodTracksForBundleAdjustmentWrapper(
     const int image_grid_cell_size_pixels,
     const int min_num_optimized_tracks_per_view);
 
+// Returns the number of localized views and the summary of every view.
+std::tuple<int, std::vector<LocalizeViewSummary>>
+LocalizeViewsToReconstructionWrapper(
+    const std::vector<ViewId>& view_ids,
+    const LocalizeViewToReconstructionOptions& options,
+    Reconstruction& reconstruction);
+
 int SetOutlierTracksToUnestimatedWrapper(
     const std::unordered_set<TrackId>& tracks,
     const double max_inlier_reprojection_error,
     const double min_triangulation_angle_degrees,
     Reconstruction& reconstruction);
 
+// Bulk conversions between a reconstruction and contiguous (row-major) arrays
+// so that Python does not have to visit every view and track individually.
+// Only estimated views and tracks are exported and the rows are sorted by id.
+// The imports throw std::invalid_argument on inconsistent input, before the
+// reconstruction is modified.
+
+// Returns the track ids, the homogeneous points and the colors.
+std::tuple<IdArray, Array4d, Array3u8> TracksToArraysWrapper(
+    const Reconstruction& reconstruction);
+
+// Returns the view ids, the poses as [angle-axis rotation, position], the
+// camera intrinsics model types and the intrinsics parameters. The number of
+// columns of the intrinsics is the largest number of parameters of any model
+// and unused columns are zero.
+std::tuple<IdArray, Array6d, Eigen::VectorXi, ArrayXd> ViewsToArraysWrapper(
+    const Reconstruction& reconstruction);
+
+// Returns one row per observation of an estimated track in an estimated view:
+// the row of the view in ViewsToArraysWrapper, the row of the track in
+// TracksToArraysWrapper and the feature position.
+std::tuple<Eigen::VectorXi, Eigen::VectorXi, Array2d>
+ObservationsToArraysWrapper(const Reconstruction& reconstruction);
+
+// Adds an estimated view with its own camera intrinsics group for each row and
+// returns the new view ids. Views that could not be added have the id
+// kInvalidViewId.
+IdArray AddViewsFromArraysWrapper(const std::vector<std::string>& names,
+                                  const Eigen::VectorXd& timestamps,
+                                  const Array6d& poses,
+                                  const Eigen::VectorXi& intrinsics_types,
+                                  const ArrayXd& intrinsics,
+                                  Reconstruction& reconstruction);
+
+// Adds an estimated track for each row of points and returns the new track
+// ids. The observations refer to the rows of view_ids and points. Tracks that
+// could not be added have the id kInvalidTrackId.
+IdArray AddTracksFromArraysWrapper(const IdArray& view_ids,
+                                   const Array4d& points,
+                                   const Array3u8& colors,
+                                   const Eigen::VectorXi& view_indices,
+                                   const Eigen::VectorXi& track_indices,
+                                   const Array2d& features,
+                                   Reconstruction& reconstruction);
 
 }  // namespace theia
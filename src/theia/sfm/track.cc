@@ -38,6 +38,7 @@
 #include <unordered_set>
 
 #include "theia/util/map_util.h"
+#include "theia/util/memory_usage.h"
 
 namespace theia {
 
@@ -55,6 +56,11 @@ Track::Track()
 
 int Track::NumViews() const { return view_ids_.size(); }
 
+size_t Track::MemoryUsage() const {
+  return sizeof(*this) + HeapMemoryUsage(view_ids_) +
+         HeapMemoryUsage(reference_descriptor_);
+}
+
 void Track::SetEstimated(const bool is_estimated) {
   is_estimated_ = is_estimated;
 }
@@ -87,6 +87,9 @@ class Track {
   void SetReferenceDescriptor(const Eigen::VectorXf& descriptor);
   const Eigen::VectorXf& ReferenceDescriptor() const;
 
+  // Returns the approximate number of bytes of memory used by the track.
+  size_t MemoryUsage() const;
+
  private:
   // Templated method for disk I/O with cereal. This method tells cereal which
   // data members should be used when reading/writing to/from disk.
@@ -39,20 +39,26 @@
 #include <stdint.h>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "theia/math/graph/connected_components.h"
 #include "theia/sfm/feature.h"
 #include "theia/sfm/reconstruction.h"
+#include "theia/sfm/track.h"
 #include "theia/sfm/types.h"
+#include "theia/sfm/view.h"
 #include "theia/util/map_util.h"
+#include "theia/util/memory_usage.h"
 
 namespace theia {
 
 TrackBuilder::TrackBuilder(const int min_track_length,
                            const int max_track_length)
-    : num_features_(0), min_track_length_(min_track_length) {
+    : num_features_(0),
+      min_track_length_(min_track_length),
+      max_track_length_(max_track_length) {
   connected_components_.reset(
       new ConnectedComponents<uint64_t>(max_track_length));
 }
@@ -86,72 +92,112 @@ void TrackBuilder::BuildTracksIncremental(Reconstruction* reconstruction) {
     InsertOrDie(&id_to_feature, feature.second, &feature.first);
   }
 
-  // Extract all connected components.
+  // Extract the connected components of the correspondences that were added
+  // since the last call.
   std::unordered_map<uint64_t, std::unordered_set<uint64_t> > components;
   connected_components_->Extract(&components);
 
-  // Each connected component is a track. Add all tracks to the reconstruction.
+  int num_new_tracks = 0;
+  int num_extended_tracks = 0;
   int num_small_tracks = 0;
   int num_inconsistent_features = 0;
   for (const auto& component : components) {
-    // Skip singleton tracks.
-    if (component.second.size() < min_track_length_) {
-      ++num_small_tracks;
-      continue;
+    // Find the existing track that the component belongs to. If the features
+    // of the component belong to several tracks, the longest track is extended
+    // and the tracks are not merged.
+    TrackId track_id = kInvalidTrackId;
+    for (const uint64_t feature_id : component.second) {
+      const auto& feature = *FindOrDie(id_to_feature, feature_id);
+      const View* view = reconstruction->View(feature.first);
+      const TrackId existing_track_id =
+          view == nullptr ? kInvalidTrackId : view->GetTrack(feature.second);
+      if (existing_track_id == kInvalidTrackId) {
+        continue;
+      }
+      if (track_id == kInvalidTrackId ||
+          reconstruction->Track(existing_track_id)->NumViews() >
+              reconstruction->Track(track_id)->NumViews()) {
+        track_id = existing_track_id;
+      }
     }
 
-    // connected component already has a track in the reconstruction
-    const auto track_component = connected_component_to_track_id_.find(component.first);
-    if (track_component != connected_component_to_track_id_.end()) {
-
-        auto track = reconstruction->Track(track_component->second);
-        auto view_ids = track->ViewIds();
-        for (const auto& feature_id : component.second) {
-            const auto& feature_to_add = *FindOrDie(id_to_feature, feature_id);
-            const ViewId v_id = feature_to_add.first;
-            // if this feature already is an observation of a track
-            if (view_ids.find(v_id) == view_ids.end()) {
-                //std::cout<<"Adding an observation to an already existing track "<<track_component->second<<" vid: "<<v_id<<"\n";
-                reconstruction->AddObservation(v_id, track_component->second, feature_to_add.second);
-            }
+    // Initialize a new track if none of the features are part of a track.
+    if (track_id == kInvalidTrackId) {
+      if (component.second.size() < min_track_length_) {
+        ++num_small_tracks;
+        continue;
+      }
+
+      std::vector<std::pair<ViewId, Feature> > track;
+      track.reserve(component.second.size());
+      std::unordered_set<ViewId> view_ids;
+      for (const uint64_t feature_id : component.second) {
+        const auto& feature_to_add = *FindOrDie(id_to_feature, feature_id);
+        if (!InsertIfNotPresent(&view_ids, feature_to_add.first)) {
+          ++num_inconsistent_features;
+          continue;
         }
+        track.emplace_back(feature_to_add);
+      }
+
+      CHECK_NE(reconstruction->AddTrack(track), kInvalidTrackId)
+          << "Could not build tracks.";
+      ++num_new_tracks;
+      continue;
     }
-    // initialize a new track
-    else {
-        std::vector<std::pair<ViewId, Feature> > track;
-        track.reserve(component.second.size());
-
-        // Add all features in the connected component to the track.
-        std::unordered_set<ViewId> view_ids;
-        for (const auto& feature_id : component.second) {
-          const auto& feature_to_add = *FindOrDie(id_to_feature, feature_id);
-
-          // Do not add the feature if the track already contains a feature from the
-          // same image.
-          if (!InsertIfNotPresent(&view_ids, feature_to_add.first)) {
-            ++num_inconsistent_features;
-            continue;
-          }
-
-          track.emplace_back(feature_to_add);
-        }
 
-        TrackId new_track_id = reconstruction->AddTrack(track);
-        CHECK_NE(new_track_id, kInvalidTrackId)
-            << "Could not build tracks.";
-        connected_component_to_track_id_[component.first] = new_track_id;
+    // Otherwise, add the new observations to the existing track. Features that
+    // are part of another track or that come from a view already observing the
+    // track are dropped, as are features beyond the maximum track length.
+    const Track* track = reconstruction->Track(track_id);
+    bool track_was_extended = false;
+    for (const uint64_t feature_id : component.second) {
+      const auto& feature_to_add = *FindOrDie(id_to_feature, feature_id);
+      const View* view = reconstruction->View(feature_to_add.first);
+      if (view == nullptr) {
+        continue;
+      }
+      const TrackId existing_track_id = view->GetTrack(feature_to_add.second);
+      if (existing_track_id == track_id) {
+        continue;
       }
+      if (existing_track_id != kInvalidTrackId ||
+          ContainsKey(track->ViewIds(), feature_to_add.first) ||
+          track->NumViews() >= max_track_length_) {
+        ++num_inconsistent_features;
+        continue;
+      }
+      CHECK(reconstruction->AddObservation(
+          feature_to_add.first, track_id, feature_to_add.second));
+      track_was_extended = true;
+    }
+    if (track_was_extended) {
+      ++num_extended_tracks;
+    }
   }
 
+  // The correspondences have been consumed, so the next call only processes
+  // the correspondences added after this one. Swapping with an empty map
+  // releases the buckets as well.
+  std::unordered_map<std::pair<ViewId, Feature>, uint64_t>().swap(features_);
+  num_features_ = 0;
+  connected_components_.reset(
+      new ConnectedComponents<uint64_t>(max_track_length_));
+
   LOG(INFO)
-      << reconstruction->NumTracks() << " tracks were created. "
-      << num_inconsistent_features
+      << num_new_tracks << " tracks were created and " << num_extended_tracks
+      << " tracks were extended. " << num_inconsistent_features
       << " features were dropped because they formed inconsistent tracks, and "
       << num_small_tracks
       << " features were dropped because they did not have "
          "enough observations.";
 }
 
+size_t TrackBuilder::MemoryUsage() const {
+  return sizeof(*this) + HeapMemoryUsage(features_) +
+         connected_components_->MemoryUsage();
+}
+
 void TrackBuilder::BuildTracks(Reconstruction* reconstruction) {
   CHECK_NOTNULL(reconstruction);
 
@@ -71,18 +71,27 @@ class TrackBuilder {
   // Generates all tracks and adds them to the reconstruction.
   void BuildTracks(Reconstruction* reconstruction);
 
-  // This function can be called incrementally for sequential reconstructions
-  // It checks if connected components already exist
+  // Builds tracks from the feature correspondences that were added since the
+  // last call and adds them to the reconstruction, e.g. when new images are
+  // streamed into an existing reconstruction. A connected component that
+  // contains a feature of an existing track extends that track with the new
+  // observations instead of creating a new track. The correspondences are
+  // cleared afterwards, so the cost of each call only depends on the number of
+  // new correspondences and not on the size of the reconstruction.
   void BuildTracksIncremental(Reconstruction* reconstruction);
+
+  // Returns the approximate number of bytes of memory used by the feature
+  // correspondences that have not been built into tracks yet.
+  size_t MemoryUsage() const;
+
  private:
   uint64_t FindOrInsert(const std::pair<ViewId, Feature>& image_feature);
 
   std::unordered_map<std::pair<ViewId, Feature>, uint64_t> features_;
   std::unique_ptr<ConnectedComponents<uint64_t> > connected_components_;
-  // for incremental mapping
-  std::unordered_map<uint64_t, TrackId> connected_component_to_track_id_;
   uint64_t num_features_;
   const int min_track_length_;
+  const int max_track_length_;
 };
 
 }  // namespace theia
@@ -189,4 +189,63 @@ TEST(TrackBuilder, MinTrackLength) {
   EXPECT_EQ(reconstruction.NumTracks(), 1);
 }
 
+// Tracks built from batches of correspondences extend the existing tracks.
+TEST(TrackBuilder, IncrementalTracks) {
+  static const int kMaxTrackLength = 10;
+
+  Reconstruction reconstruction;
+  reconstruction.AddView("0", 0.0);
+  reconstruction.AddView("1", 1.0);
+
+  TrackBuilder track_builder(kMinTrackLength, kMaxTrackLength);
+  track_builder.AddFeatureCorrespondence(0, Feature(0, 0), 1, Feature(0, 0));
+  track_builder.AddFeatureCorrespondence(0, Feature(1, 1), 1, Feature(1, 1));
+  track_builder.BuildTracksIncremental(&reconstruction);
+  VerifyTracks(reconstruction);
+  EXPECT_EQ(reconstruction.NumTracks(), 2);
+  const TrackId track_id = reconstruction.View(1)->GetTrack(Feature(0, 0));
+  ASSERT_NE(track_id, kInvalidTrackId);
+
+  // A new view observes an existing track and creates a new track.
+  reconstruction.AddView("2", 2.0);
+  track_builder.AddFeatureCorrespondence(1, Feature(0, 0), 2, Feature(2, 2));
+  track_builder.AddFeatureCorrespondence(1, Feature(3, 3), 2, Feature(3, 3));
+  track_builder.BuildTracksIncremental(&reconstruction);
+  VerifyTracks(reconstruction);
+  EXPECT_EQ(reconstruction.NumTracks(), 3);
+  EXPECT_EQ(reconstruction.View(2)->GetTrack(Feature(2, 2)), track_id);
+  EXPECT_EQ(reconstruction.Track(track_id)->NumViews(), 3);
+
+  // A correspondence between two existing tracks does not merge them or create
+  // a duplicate track.
+  track_builder.AddFeatureCorrespondence(2, Feature(2, 2), 0, Feature(1, 1));
+  track_builder.BuildTracksIncremental(&reconstruction);
+  VerifyTracks(reconstruction);
+  EXPECT_EQ(reconstruction.NumTracks(), 3);
+  EXPECT_EQ(reconstruction.Track(track_id)->NumViews(), 3);
+}
+
+// Building tracks incrementally releases the feature correspondences.
+TEST(TrackBuilder, IncrementalTracksReleaseMemory) {
+  static const int kMaxTrackLength = 10;
+  static const int kNumCorrespondences = 1000;
+
+  Reconstruction reconstruction;
+  reconstruction.AddView("0", 0.0);
+  reconstruction.AddView("1", 1.0);
+
+  TrackBuilder track_builder(kMinTrackLength, kMaxTrackLength);
+  const size_t empty_memory_usage = track_builder.MemoryUsage();
+  for (int i = 0; i < kNumCorrespondences; i++) {
+    track_builder.AddFeatureCorrespondence(0, Feature(i, i), 1, Feature(i, i));
+  }
+  EXPECT_GT(track_builder.MemoryUsage(), empty_memory_usage);
+
+  const size_t reconstruction_memory_usage = reconstruction.MemoryUsage();
+  track_builder.BuildTracksIncremental(&reconstruction);
+  EXPECT_EQ(reconstruction.NumTracks(), kNumCorrespondences);
+  EXPECT_EQ(track_builder.MemoryUsage(), empty_memory_usage);
+  EXPECT_GT(reconstruction.MemoryUsage(), reconstruction_memory_usage);
+}
+
 }  // namespace theia
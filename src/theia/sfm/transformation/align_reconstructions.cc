@@ -90,6 +90,9 @@ class CameraAlignmentEstimator
         sim_transform.translation;
     return (cameras.camera1 - transformed_camera).squaredNorm();
   }
+
+  // Squared distances between camera positions.
+  int ResidualDegreesOfFreedom() const { return 3; }
 };
 
 }  // namespace
@@ -43,7 +43,6 @@
 #include "theia/sfm/bundle_adjustment/bundle_adjustment.h"
 #include "theia/sfm/camera_intrinsics_prior.h"
 #include "theia/sfm/estimate_twoview_info.h"
-#include "theia/sfm/estimators/estimate_homography.h"
 #include "theia/sfm/reconstruction_estimator_utils.h"
 #include "theia/sfm/set_camera_intrinsics_from_priors.h"
 #include "theia/sfm/triangulation/triangulation.h"
@@ -121,10 +120,8 @@ bool TwoViewMatchGeometricVerification::VerifyMatches(
   std::vector<FeatureCorrespondence> correspondences;
   CreateCorrespondencesFromIndexedMatches(&correspondences);
 
-  // Estimate a homography (before the matches_ container is modified).
-  twoview_info->num_homography_inliers = CountHomographyInliers();
-
-  // Estimate 2-view geometry from feature matches.
+  // Estimate 2-view geometry from feature matches. The number of homography
+  // inliers is estimated from the same samples.
   std::vector<int> inlier_indices;
   if (!EstimateTwoViewInfo(options_.estimate_twoview_info_options,
                            intrinsics1_,
@@ -326,43 +323,4 @@ bool TwoViewMatchGeometricVerification::BundleAdjustRelativePose(
   return true;
 }
 
-// Compute a homography and return the number of inliers. This determines how
-// well a plane fits the two view geometry.
-int TwoViewMatchGeometricVerification::CountHomographyInliers() {
-  const EstimateTwoViewInfoOptions& etvi_options =
-      options_.estimate_twoview_info_options;
-  RansacParameters homography_params;
-  homography_params.rng = etvi_options.rng;
-
-  // Compute the reprojection error threshold to account for the resolution of
-  // the images.
-  const double max_sampson_error_pixels1 =
-      ComputeResolutionScaledThreshold(etvi_options.max_sampson_error_pixels,
-                                       camera1_.ImageWidth(),
-                                       camera1_.ImageHeight());
-  const double max_sampson_error_pixels2 =
-      ComputeResolutionScaledThreshold(etvi_options.max_sampson_error_pixels,
-                                       camera2_.ImageWidth(),
-                                       camera2_.ImageHeight());
-
-  homography_params.error_thresh =
-      max_sampson_error_pixels1 * max_sampson_error_pixels2;
-  homography_params.max_iterations = etvi_options.max_ransac_iterations;
-  homography_params.min_iterations = etvi_options.min_ransac_iterations;
-  homography_params.use_mle = etvi_options.use_mle;
-  homography_params.failure_probability =
-      1.0 - etvi_options.expected_ransac_confidence;
-  RansacSummary homography_summary;
-  Eigen::Matrix3d unused_homography;
-  std::vector<FeatureCorrespondence> correspondences;
-  CreateCorrespondencesFromIndexedMatches(&correspondences);
-  EstimateHomography(homography_params,
-                     etvi_options.ransac_type,
-                     correspondences,
-                     &unused_homography,
-                     &homography_summary);
-
-  return homography_summary.inliers.size();
-}
-
 }  // namespace theia
@@ -106,6 +106,12 @@ class TwoViewMatchGeometricVerification {
   bool VerifyMatches(std::vector<FeatureCorrespondence>* verified_matches,
                      TwoViewInfo* twoview_info);
 
+  // The feature indices of the verified matches, in the same order as the
+  // verified correspondences. Only valid after VerifyMatches returned true.
+  const std::vector<IndexedFeatureMatch>& VerifiedMatchIndices() const {
+    return matches_;
+  }
+
  private:
   // A helper method that creates a vector of FeatureCorrespondence from the
   // matches_ vector of match indices.
@@ -122,9 +128,6 @@ class TwoViewMatchGeometricVerification {
   // errors.
   bool BundleAdjustRelativePose(TwoViewInfo* twoview_info);
 
-  // Estimates a homography and returns the number of inliers.
-  int CountHomographyInliers();
-
   const Options options_;
   const CameraIntrinsicsPrior &intrinsics1_, intrinsics2_;
   const KeypointsAndDescriptors &features1_, features2_;
@@ -43,6 +43,7 @@
 #include "theia/sfm/feature.h"
 #include "theia/sfm/types.h"
 #include "theia/util/map_util.h"
+#include "theia/util/memory_usage.h"
 
 namespace theia {
 using Vector2d = Eigen::Vector2d;
@@ -109,6 +110,11 @@ void View::SetCameraIntrinsicsPrior(struct CameraIntrinsicsPrior prior) {
 
 int View::NumFeatures() const { return features_.size(); }
 
+size_t View::MemoryUsage() const {
+  return sizeof(*this) + HeapMemoryUsage(name_) + HeapMemoryUsage(features_) +
+         HeapMemoryUsage(features_to_tracks_);
+}
+
 std::vector<TrackId> View::TrackIds() const {
   std::vector<TrackId> track_ids;
   track_ids.reserve(features_.size());
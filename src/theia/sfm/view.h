@@ -92,6 +92,11 @@ class View {
 
   void SetTimestamp(const double timestamp);
 
+  // Returns the approximate number of bytes of memory used by the view. The
+  // camera intrinsics are shared between the views of an intrinsics group and
+  // are not included.
+  size_t MemoryUsage() const;
+
   void SetPositionPrior(const Eigen::Vector3d& position_prior,
                         const Eigen::Matrix3d& position_prior_information);
   Eigen::Vector3d GetPositionPrior() const;
@@ -0,0 +1,175 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/sfm/view_graph/compact_view_graph.h"
+
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "theia/sfm/twoview_info.h"
+#include "theia/sfm/types.h"
+#include "theia/sfm/view_graph/view_graph.h"
+
+namespace theia {
+
+const int CompactViewGraph::kInvalidIndex;
+
+CompactViewGraph::CompactViewGraph(const ViewGraph& view_graph) {
+  Build(view_graph);
+}
+
+void CompactViewGraph::Build(const ViewGraph& view_graph) {
+  const auto& edges = view_graph.GetAllEdges();
+
+  // Assign dense view indices in increasing order of view id.
+  view_ids_.clear();
+  view_ids_.reserve(view_graph.NumViews());
+  for (const ViewId view_id : view_graph.ViewIds()) {
+    view_ids_.emplace_back(view_id);
+  }
+  std::sort(view_ids_.begin(), view_ids_.end());
+
+  // Gather the edges as view index pairs and sort them so that the edge arrays
+  // and the adjacency lists are ordered.
+  std::vector<std::tuple<int, int, const TwoViewInfo*> > sorted_edges;
+  sorted_edges.reserve(edges.size());
+  for (const auto& edge : edges) {
+    sorted_edges.emplace_back(ViewIndex(edge.first.first),
+                              ViewIndex(edge.first.second),
+                              &edge.second);
+  }
+  std::sort(sorted_edges.begin(),
+            sorted_edges.end(),
+            [](const std::tuple<int, int, const TwoViewInfo*>& lhs,
+               const std::tuple<int, int, const TwoViewInfo*>& rhs) {
+              return std::tie(std::get<0>(lhs), std::get<1>(lhs)) <
+                     std::tie(std::get<0>(rhs), std::get<1>(rhs));
+            });
+
+  const int num_edges = sorted_edges.size();
+  edge_view_index_1_.resize(num_edges);
+  edge_view_index_2_.resize(num_edges);
+  relative_rotations_.resize(num_edges);
+  relative_positions_.resize(num_edges);
+  num_verified_matches_.resize(num_edges);
+  num_homography_inliers_.resize(num_edges);
+  visibility_scores_.resize(num_edges);
+  focal_lengths_1_.resize(num_edges);
+  focal_lengths_2_.resize(num_edges);
+
+  adjacency_offsets_.assign(view_ids_.size() + 1, 0);
+  for (int i = 0; i < num_edges; i++) {
+    const int view_index_1 = std::get<0>(sorted_edges[i]);
+    const int view_index_2 = std::get<1>(sorted_edges[i]);
+    const TwoViewInfo& info = *std::get<2>(sorted_edges[i]);
+
+    edge_view_index_1_[i] = view_index_1;
+    edge_view_index_2_[i] = view_index_2;
+    relative_rotations_[i] = info.rotation_2;
+    relative_positions_[i] = info.position_2;
+    num_verified_matches_[i] = info.num_verified_matches;
+    num_homography_inliers_[i] = info.num_homography_inliers;
+    visibility_scores_[i] = info.visibility_score;
+    focal_lengths_1_[i] = info.focal_length_1;
+    focal_lengths_2_[i] = info.focal_length_2;
+
+    ++adjacency_offsets_[view_index_1 + 1];
+    ++adjacency_offsets_[view_index_2 + 1];
+  }
+  for (int i = 0; i < view_ids_.size(); i++) {
+    adjacency_offsets_[i + 1] += adjacency_offsets_[i];
+  }
+
+  // Fill the adjacency lists. Since the edges are sorted lexicographically, the
+  // neighbors of each view are inserted in increasing order of view index.
+  adjacent_view_indices_.resize(2 * num_edges);
+  adjacent_edge_indices_.resize(2 * num_edges);
+  std::vector<int> insert_position(adjacency_offsets_.begin(),
+                                   adjacency_offsets_.end() - 1);
+  for (int i = 0; i < num_edges; i++) {
+    const int view_index_1 = edge_view_index_1_[i];
+    const int view_index_2 = edge_view_index_2_[i];
+
+    adjacent_view_indices_[insert_position[view_index_1]] = view_index_2;
+    adjacent_edge_indices_[insert_position[view_index_1]] = i;
+    ++insert_position[view_index_1];
+
+    adjacent_view_indices_[insert_position[view_index_2]] = view_index_1;
+    adjacent_edge_indices_[insert_position[view_index_2]] = i;
+    ++insert_position[view_index_2];
+  }
+}
+
+int CompactViewGraph::ViewIndex(const ViewId view_id) const {
+  const auto it = std::lower_bound(view_ids_.begin(), view_ids_.end(), view_id);
+  if (it == view_ids_.end() || *it != view_id) {
+    return kInvalidIndex;
+  }
+  return std::distance(view_ids_.begin(), it);
+}
+
+int CompactViewGraph::EdgeIndex(const int view_index_1,
+                                const int view_index_2) const {
+  // Search the adjacency list of the view with the smaller degree.
+  const int source = (Degree(view_index_1) < Degree(view_index_2))
+                         ? view_index_1
+                         : view_index_2;
+  const int target = (source == view_index_1) ? view_index_2 : view_index_1;
+
+  const auto begin = adjacent_view_indices_.begin() + AdjacencyBegin(source);
+  const auto end = adjacent_view_indices_.begin() + AdjacencyEnd(source);
+  const auto it = std::lower_bound(begin, end, target);
+  if (it == end || *it != target) {
+    return kInvalidIndex;
+  }
+  return adjacent_edge_indices_[std::distance(
+      adjacent_view_indices_.begin(), it)];
+}
+
+void CompactViewGraph::GetViewPairs(
+    std::unordered_map<ViewIdPair, TwoViewInfo>* view_pairs) const {
+  CHECK_NOTNULL(view_pairs)->clear();
+  view_pairs->reserve(NumEdges());
+  for (int i = 0; i < NumEdges(); i++) {
+    TwoViewInfo& info = (*view_pairs)[ViewIdPairFromEdge(i)];
+    info.focal_length_1 = focal_lengths_1_[i];
+    info.focal_length_2 = focal_lengths_2_[i];
+    info.rotation_2 = relative_rotations_[i];
+    info.position_2 = relative_positions_[i];
+    info.num_verified_matches = num_verified_matches_[i];
+    info.num_homography_inliers = num_homography_inliers_[i];
+    info.visibility_score = visibility_scores_[i];
+  }
+}
+
+}  // namespace theia
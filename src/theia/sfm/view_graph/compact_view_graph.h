@@ -0,0 +1,172 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_SFM_VIEW_GRAPH_COMPACT_VIEW_GRAPH_H_
+#define THEIA_SFM_VIEW_GRAPH_COMPACT_VIEW_GRAPH_H_
+
+#include <Eigen/Core>
+#include <unordered_map>
+#include <vector>
+
+#include "theia/sfm/twoview_info.h"
+#include "theia/sfm/types.h"
+#include "theia/util/hash.h"
+
+namespace theia {
+
+class ViewGraph;
+
+// An immutable, compact snapshot of a ViewGraph. The views are assigned dense
+// indices in increasing order of their view ids, the adjacency is stored in
+// compressed sparse row (CSR) format and the edge values are stored as a
+// structure of arrays. This makes the snapshot cheap to iterate over for the
+// global pose estimation stages, which would otherwise walk the hash maps of
+// the ViewGraph and build their own view id to index mappings.
+//
+// Each undirected edge is stored exactly once and is oriented such that
+// ViewIndex1(e) < ViewIndex2(e). Since the view indices are sorted by view id
+// this is the same orientation as the ViewIdPair keys of the ViewGraph, so the
+// relative rotation and position of edge e are those of the TwoViewInfo stored
+// in the ViewGraph. The edges are sorted lexicographically by view index pair.
+class CompactViewGraph {
+ public:
+  static const int kInvalidIndex = -1;
+
+  CompactViewGraph() {}
+  explicit CompactViewGraph(const ViewGraph& view_graph);
+
+  // Rebuilds the snapshot from the view graph. Any previous contents are
+  // discarded.
+  void Build(const ViewGraph& view_graph);
+
+  int NumViews() const { return view_ids_.size(); }
+  int NumEdges() const { return edge_view_index_1_.size(); }
+
+  // The view ids sorted in increasing order. The position of a view id in this
+  // vector is its view index.
+  const std::vector<ViewId>& ViewIds() const { return view_ids_; }
+  ViewId ViewIdFromIndex(const int view_index) const {
+    return view_ids_[view_index];
+  }
+
+  // Returns the dense index of the view or kInvalidIndex if the view is not in
+  // the graph.
+  int ViewIndex(const ViewId view_id) const;
+
+  // CSR adjacency. The neighbors of view index i are stored in
+  // [AdjacencyBegin(i), AdjacencyEnd(i)) of AdjacentViewIndices() and
+  // AdjacentEdgeIndices(), sorted by increasing neighbor index.
+  int AdjacencyBegin(const int view_index) const {
+    return adjacency_offsets_[view_index];
+  }
+  int AdjacencyEnd(const int view_index) const {
+    return adjacency_offsets_[view_index + 1];
+  }
+  int Degree(const int view_index) const {
+    return AdjacencyEnd(view_index) - AdjacencyBegin(view_index);
+  }
+  const std::vector<int>& AdjacencyOffsets() const {
+    return adjacency_offsets_;
+  }
+  const std::vector<int>& AdjacentViewIndices() const {
+    return adjacent_view_indices_;
+  }
+  const std::vector<int>& AdjacentEdgeIndices() const {
+    return adjacent_edge_indices_;
+  }
+
+  // Returns the index of the edge between the two views or kInvalidIndex if
+  // the edge does not exist. The order of the view indices does not matter.
+  int EdgeIndex(const int view_index_1, const int view_index_2) const;
+
+  // Edge values, indexed by edge index.
+  int ViewIndex1(const int edge_index) const {
+    return edge_view_index_1_[edge_index];
+  }
+  int ViewIndex2(const int edge_index) const {
+    return edge_view_index_2_[edge_index];
+  }
+  ViewIdPair ViewIdPairFromEdge(const int edge_index) const {
+    return ViewIdPair(view_ids_[edge_view_index_1_[edge_index]],
+                      view_ids_[edge_view_index_2_[edge_index]]);
+  }
+  const Eigen::Vector3d& RelativeRotation(const int edge_index) const {
+    return relative_rotations_[edge_index];
+  }
+  const Eigen::Vector3d& RelativePosition(const int edge_index) const {
+    return relative_positions_[edge_index];
+  }
+  int NumVerifiedMatches(const int edge_index) const {
+    return num_verified_matches_[edge_index];
+  }
+  int NumHomographyInliers(const int edge_index) const {
+    return num_homography_inliers_[edge_index];
+  }
+
+  const std::vector<Eigen::Vector3d>& RelativeRotations() const {
+    return relative_rotations_;
+  }
+  const std::vector<Eigen::Vector3d>& RelativePositions() const {
+    return relative_positions_;
+  }
+  const std::vector<int>& NumVerifiedMatches() const {
+    return num_verified_matches_;
+  }
+
+  // Recreates the view pairs in the format used by the ViewGraph. This is
+  // provided for estimators that do not operate on the snapshot directly.
+  void GetViewPairs(
+      std::unordered_map<ViewIdPair, TwoViewInfo>* view_pairs) const;
+
+ private:
+  // Views.
+  std::vector<ViewId> view_ids_;
+
+  // CSR adjacency.
+  std::vector<int> adjacency_offsets_;
+  std::vector<int> adjacent_view_indices_;
+  std::vector<int> adjacent_edge_indices_;
+
+  // Edges.
+  std::vector<int> edge_view_index_1_;
+  std::vector<int> edge_view_index_2_;
+  std::vector<Eigen::Vector3d> relative_rotations_;
+  std::vector<Eigen::Vector3d> relative_positions_;
+  std::vector<int> num_verified_matches_;
+  std::vector<int> num_homography_inliers_;
+  std::vector<int> visibility_scores_;
+  std::vector<double> focal_lengths_1_;
+  std::vector<double> focal_lengths_2_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SFM_VIEW_GRAPH_COMPACT_VIEW_GRAPH_H_
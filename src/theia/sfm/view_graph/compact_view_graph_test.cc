@@ -0,0 +1,170 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "theia/sfm/twoview_info.h"
+#include "theia/sfm/types.h"
+#include "theia/sfm/view_graph/compact_view_graph.h"
+#include "theia/sfm/view_graph/view_graph.h"
+#include "theia/util/map_util.h"
+
+namespace theia {
+
+namespace {
+
+TwoViewInfo MakeTwoViewInfo(const int num_verified_matches) {
+  TwoViewInfo info;
+  info.num_verified_matches = num_verified_matches;
+  info.rotation_2 = Eigen::Vector3d::Random();
+  info.position_2 = Eigen::Vector3d::Random().normalized();
+  info.visibility_score = 0;
+  return info;
+}
+
+}  // namespace
+
+TEST(CompactViewGraph, Empty) {
+  ViewGraph view_graph;
+  CompactViewGraph compact_view_graph(view_graph);
+  EXPECT_EQ(compact_view_graph.NumViews(), 0);
+  EXPECT_EQ(compact_view_graph.NumEdges(), 0);
+  EXPECT_EQ(compact_view_graph.ViewIndex(0), CompactViewGraph::kInvalidIndex);
+}
+
+TEST(CompactViewGraph, ViewIndicesAreSorted) {
+  ViewGraph view_graph;
+  view_graph.AddEdge(7, 3, MakeTwoViewInfo(10));
+  view_graph.AddEdge(3, 11, MakeTwoViewInfo(20));
+  view_graph.AddEdge(11, 5, MakeTwoViewInfo(30));
+
+  CompactViewGraph compact_view_graph(view_graph);
+  EXPECT_EQ(compact_view_graph.NumViews(), 4);
+  EXPECT_EQ(compact_view_graph.NumEdges(), 3);
+
+  const std::vector<ViewId> expected_view_ids = {3, 5, 7, 11};
+  EXPECT_EQ(compact_view_graph.ViewIds(), expected_view_ids);
+  for (int i = 0; i < expected_view_ids.size(); i++) {
+    EXPECT_EQ(compact_view_graph.ViewIndex(expected_view_ids[i]), i);
+    EXPECT_EQ(compact_view_graph.ViewIdFromIndex(i), expected_view_ids[i]);
+  }
+  EXPECT_EQ(compact_view_graph.ViewIndex(4), CompactViewGraph::kInvalidIndex);
+}
+
+TEST(CompactViewGraph, EdgesMatchViewGraph) {
+  ViewGraph view_graph;
+  for (int i = 0; i < 10; i++) {
+    for (int j = i + 1; j < 10; j += (i % 3) + 1) {
+      view_graph.AddEdge(i, j, MakeTwoViewInfo(10 * i + j));
+    }
+  }
+
+  CompactViewGraph compact_view_graph(view_graph);
+  ASSERT_EQ(compact_view_graph.NumEdges(), view_graph.NumEdges());
+
+  for (int e = 0; e < compact_view_graph.NumEdges(); e++) {
+    EXPECT_LT(compact_view_graph.ViewIndex1(e),
+              compact_view_graph.ViewIndex2(e));
+    const ViewIdPair view_id_pair = compact_view_graph.ViewIdPairFromEdge(e);
+    const TwoViewInfo* info =
+        view_graph.GetEdge(view_id_pair.first, view_id_pair.second);
+    ASSERT_TRUE(info != nullptr);
+    EXPECT_EQ(compact_view_graph.RelativeRotation(e), info->rotation_2);
+    EXPECT_EQ(compact_view_graph.RelativePosition(e), info->position_2);
+    EXPECT_EQ(compact_view_graph.NumVerifiedMatches(e),
+              info->num_verified_matches);
+    EXPECT_EQ(compact_view_graph.EdgeIndex(compact_view_graph.ViewIndex1(e),
+                                           compact_view_graph.ViewIndex2(e)),
+              e);
+    EXPECT_EQ(compact_view_graph.EdgeIndex(compact_view_graph.ViewIndex2(e),
+                                           compact_view_graph.ViewIndex1(e)),
+              e);
+  }
+}
+
+TEST(CompactViewGraph, Adjacency) {
+  ViewGraph view_graph;
+  for (int i = 0; i < 10; i++) {
+    for (int j = i + 1; j < 10; j += (i % 3) + 1) {
+      view_graph.AddEdge(i, j, MakeTwoViewInfo(10 * i + j));
+    }
+  }
+
+  CompactViewGraph compact_view_graph(view_graph);
+  int num_adjacent_views = 0;
+  for (int i = 0; i < compact_view_graph.NumViews(); i++) {
+    const ViewId view_id = compact_view_graph.ViewIdFromIndex(i);
+    const auto* neighbor_ids = view_graph.GetNeighborIdsForView(view_id);
+    ASSERT_TRUE(neighbor_ids != nullptr);
+    EXPECT_EQ(compact_view_graph.Degree(i), neighbor_ids->size());
+
+    for (int k = compact_view_graph.AdjacencyBegin(i);
+         k < compact_view_graph.AdjacencyEnd(i);
+         k++) {
+      const int neighbor = compact_view_graph.AdjacentViewIndices()[k];
+      const int edge = compact_view_graph.AdjacentEdgeIndices()[k];
+      EXPECT_TRUE(ContainsKey(*neighbor_ids,
+                              compact_view_graph.ViewIdFromIndex(neighbor)));
+      EXPECT_EQ(compact_view_graph.EdgeIndex(i, neighbor), edge);
+      if (k > compact_view_graph.AdjacencyBegin(i)) {
+        EXPECT_LT(compact_view_graph.AdjacentViewIndices()[k - 1], neighbor);
+      }
+      ++num_adjacent_views;
+    }
+  }
+  EXPECT_EQ(num_adjacent_views, 2 * view_graph.NumEdges());
+  EXPECT_EQ(compact_view_graph.EdgeIndex(0, 0),
+            CompactViewGraph::kInvalidIndex);
+}
+
+TEST(CompactViewGraph, GetViewPairs) {
+  ViewGraph view_graph;
+  view_graph.AddEdge(0, 1, MakeTwoViewInfo(10));
+  view_graph.AddEdge(1, 2, MakeTwoViewInfo(20));
+  view_graph.AddEdge(0, 2, MakeTwoViewInfo(30));
+
+  CompactViewGraph compact_view_graph(view_graph);
+  std::unordered_map<ViewIdPair, TwoViewInfo> view_pairs;
+  compact_view_graph.GetViewPairs(&view_pairs);
+  EXPECT_EQ(view_pairs.size(), view_graph.NumEdges());
+  for (const auto& edge : view_graph.GetAllEdges()) {
+    const TwoViewInfo& info = FindOrDie(view_pairs, edge.first);
+    EXPECT_EQ(info.rotation_2, edge.second.rotation_2);
+    EXPECT_EQ(info.position_2, edge.second.position_2);
+    EXPECT_EQ(info.num_verified_matches, edge.second.num_verified_matches);
+  }
+}
+
+}  // namespace theia
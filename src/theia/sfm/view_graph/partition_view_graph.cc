@@ -0,0 +1,217 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/sfm/view_graph/partition_view_graph.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "theia/math/graph/connected_components.h"
+#include "theia/math/graph/normalized_graph_cut.h"
+#include "theia/sfm/twoview_info.h"
+#include "theia/sfm/types.h"
+#include "theia/sfm/view_graph/view_graph.h"
+#include "theia/util/hash.h"
+#include "theia/util/map_util.h"
+
+namespace theia {
+
+namespace {
+
+// Edges are weighted by the number of verified matches so that the cuts
+// separate the weakly connected parts of the scene.
+double EdgeWeight(const TwoViewInfo& info) {
+  return std::max(info.num_verified_matches, 1);
+}
+
+// Collects the weighted edges of the subgraph induced by the views.
+void GetEdgesInSubgraph(const ViewGraph& view_graph,
+                        const std::unordered_set<ViewId>& views,
+                        std::unordered_map<ViewIdPair, double>* edges) {
+  for (const ViewId view_id : views) {
+    const std::unordered_set<ViewId>* neighbor_ids =
+        view_graph.GetNeighborIdsForView(view_id);
+    if (neighbor_ids == nullptr) {
+      continue;
+    }
+
+    for (const ViewId neighbor_id : *neighbor_ids) {
+      if (view_id >= neighbor_id || !ContainsKey(views, neighbor_id)) {
+        continue;
+      }
+      const TwoViewInfo* info = view_graph.GetEdge(view_id, neighbor_id);
+      (*edges)[ViewIdPair(view_id, neighbor_id)] = EdgeWeight(*info);
+    }
+  }
+}
+
+// Splits the views into the connected components of the subgraph induced by
+// the views. Views without any edges in the subgraph become singletons.
+void GetConnectedComponentsOfSubgraph(
+    const ViewGraph& view_graph,
+    const std::unordered_set<ViewId>& views,
+    std::vector<std::unordered_set<ViewId> >* components) {
+  std::unordered_map<ViewIdPair, double> edges;
+  GetEdgesInSubgraph(view_graph, views, &edges);
+
+  ConnectedComponents<ViewId> connected_components;
+  for (const auto& edge : edges) {
+    connected_components.AddEdge(edge.first.first, edge.first.second);
+  }
+  std::unordered_map<ViewId, std::unordered_set<ViewId> > components_by_root;
+  connected_components.Extract(&components_by_root);
+
+  std::unordered_set<ViewId> connected_views;
+  for (auto& component : components_by_root) {
+    connected_views.insert(component.second.begin(), component.second.end());
+    components->emplace_back(std::move(component.second));
+  }
+  for (const ViewId view_id : views) {
+    if (!ContainsKey(connected_views, view_id)) {
+      components->emplace_back(std::unordered_set<ViewId>{view_id});
+    }
+  }
+}
+
+// Adds the views outside of the partition with the strongest connection to the
+// partition, measured by the sum of the edge weights into the partition.
+void GrowPartition(const ViewGraph& view_graph,
+                   const int num_views_to_add,
+                   const std::unordered_set<ViewId>& partition,
+                   std::unordered_set<ViewId>* grown_partition) {
+  std::unordered_map<ViewId, double> connectivity;
+  for (const ViewId view_id : partition) {
+    const std::unordered_set<ViewId>* neighbor_ids =
+        view_graph.GetNeighborIdsForView(view_id);
+    if (neighbor_ids == nullptr) {
+      continue;
+    }
+
+    for (const ViewId neighbor_id : *neighbor_ids) {
+      if (!ContainsKey(partition, neighbor_id)) {
+        connectivity[neighbor_id] +=
+            EdgeWeight(*view_graph.GetEdge(view_id, neighbor_id));
+      }
+    }
+  }
+
+  // Sort by decreasing connectivity. Ties are broken by the view id so that the
+  // partitioning is deterministic.
+  std::vector<std::pair<double, ViewId> > candidates;
+  candidates.reserve(connectivity.size());
+  for (const auto& view_connectivity : connectivity) {
+    candidates.emplace_back(-view_connectivity.second, view_connectivity.first);
+  }
+  const int num_candidates =
+      std::min(num_views_to_add, static_cast<int>(candidates.size()));
+  std::partial_sort(candidates.begin(),
+                    candidates.begin() + num_candidates,
+                    candidates.end());
+
+  *grown_partition = partition;
+  for (int i = 0; i < num_candidates; i++) {
+    grown_partition->insert(candidates[i].second);
+  }
+}
+
+}  // namespace
+
+bool PartitionViewGraph(const PartitionViewGraphOptions& options,
+                        const ViewGraph& view_graph,
+                        std::vector<std::unordered_set<ViewId> >* partitions) {
+  CHECK_NOTNULL(partitions)->clear();
+  // The normalized graph cut requires at least 4 nodes.
+  CHECK_GE(options.max_num_views_per_partition, 3);
+  CHECK_GE(options.overlap_percent, 0.0);
+  CHECK_GE(options.min_num_overlapping_views, 0);
+
+  if (view_graph.NumViews() == 0) {
+    return false;
+  }
+
+  // Recursively cut each connected component until all partitions are small
+  // enough.
+  std::vector<std::unordered_set<ViewId> > views_to_partition;
+  GetConnectedComponentsOfSubgraph(
+      view_graph, view_graph.ViewIds(), &views_to_partition);
+
+  NormalizedGraphCut<ViewId>::Options ncut_options;
+  std::vector<std::unordered_set<ViewId> > core_partitions;
+  while (!views_to_partition.empty()) {
+    std::unordered_set<ViewId> views = std::move(views_to_partition.back());
+    views_to_partition.pop_back();
+    if (views.size() <= options.max_num_views_per_partition) {
+      core_partitions.emplace_back(std::move(views));
+      continue;
+    }
+
+    std::unordered_map<ViewIdPair, double> edges;
+    GetEdgesInSubgraph(view_graph, views, &edges);
+    NormalizedGraphCut<ViewId> ncut(ncut_options);
+    std::unordered_set<ViewId> subgraph1, subgraph2;
+    if (!ncut.ComputeCut(edges, &subgraph1, &subgraph2, nullptr) ||
+        subgraph1.empty() || subgraph2.empty()) {
+      LOG(WARNING) << "Could not cut a partition with " << views.size()
+                   << " views. The partition will not be divided further.";
+      core_partitions.emplace_back(std::move(views));
+      continue;
+    }
+
+    // Either side of the cut may be disconnected, so each side is split into
+    // its connected components before it is cut again.
+    GetConnectedComponentsOfSubgraph(view_graph, subgraph1, &views_to_partition);
+    GetConnectedComponentsOfSubgraph(view_graph, subgraph2, &views_to_partition);
+  }
+
+  // Grow each partition so that it overlaps with its neighbors.
+  partitions->reserve(core_partitions.size());
+  for (const std::unordered_set<ViewId>& partition : core_partitions) {
+    const int num_views_to_add = std::max(
+        options.min_num_overlapping_views,
+        static_cast<int>(
+            std::ceil(options.overlap_percent / 100.0 * partition.size())));
+    partitions->emplace_back();
+    GrowPartition(
+        view_graph, num_views_to_add, partition, &partitions->back());
+  }
+
+  VLOG(2) << "Partitioned " << view_graph.NumViews() << " views into "
+          << partitions->size() << " partitions.";
+  return true;
+}
+
+}  // namespace theia
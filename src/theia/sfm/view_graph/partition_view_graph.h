@@ -0,0 +1,70 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_SFM_VIEW_GRAPH_PARTITION_VIEW_GRAPH_H_
+#define THEIA_SFM_VIEW_GRAPH_PARTITION_VIEW_GRAPH_H_
+
+#include <unordered_set>
+#include <vector>
+
+#include "theia/sfm/types.h"
+
+namespace theia {
+
+class ViewGraph;
+
+struct PartitionViewGraphOptions {
+  // The view graph is recursively cut with the normalized graph cut until each
+  // partition contains at most this many views.
+  int max_num_views_per_partition = 500;
+
+  // After partitioning, each partition is grown with the views outside of the
+  // partition that are most strongly connected to it so that neighboring
+  // partitions share views. The number of added views is this percentage of
+  // the partition size, but at least min_num_overlapping_views.
+  double overlap_percent = 10.0;
+  int min_num_overlapping_views = 10;
+};
+
+// Partitions the view graph into clusters of strongly connected views that
+// overlap with their neighbors. Edges are weighted by the number of verified
+// matches and each connected component of the view graph is recursively split
+// with the normalized graph cut of Shi and Malik until the partitions are small
+// enough. The overlapping views are what allow independently estimated
+// partitions to be aligned and merged afterwards. Returns false if the view
+// graph does not contain any views.
+bool PartitionViewGraph(const PartitionViewGraphOptions& options,
+                        const ViewGraph& view_graph,
+                        std::vector<std::unordered_set<ViewId> >* partitions);
+
+}  // namespace theia
+
+#endif  // THEIA_SFM_VIEW_GRAPH_PARTITION_VIEW_GRAPH_H_
@@ -0,0 +1,140 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <unordered_set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "theia/sfm/twoview_info.h"
+#include "theia/sfm/types.h"
+#include "theia/sfm/view_graph/partition_view_graph.h"
+#include "theia/sfm/view_graph/view_graph.h"
+#include "theia/util/map_util.h"
+
+namespace theia {
+
+namespace {
+
+// Adds a fully connected cluster of views with strong edges.
+void AddCluster(const ViewId first_view_id,
+                const int num_views,
+                ViewGraph* view_graph) {
+  TwoViewInfo info;
+  info.num_verified_matches = 100;
+  for (int i = 0; i < num_views; i++) {
+    for (int j = i + 1; j < num_views; j++) {
+      view_graph->AddEdge(first_view_id + i, first_view_id + j, info);
+    }
+  }
+}
+
+int NumViewsInRange(const std::unordered_set<ViewId>& partition,
+                    const ViewId first_view_id,
+                    const int num_views) {
+  int count = 0;
+  for (int i = 0; i < num_views; i++) {
+    if (ContainsKey(partition, first_view_id + i)) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST(PartitionViewGraph, SmallViewGraphIsNotPartitioned) {
+  ViewGraph view_graph;
+  AddCluster(0, 6, &view_graph);
+
+  PartitionViewGraphOptions options;
+  options.max_num_views_per_partition = 10;
+  std::vector<std::unordered_set<ViewId> > partitions;
+  EXPECT_TRUE(PartitionViewGraph(options, view_graph, &partitions));
+  ASSERT_EQ(partitions.size(), 1);
+  EXPECT_EQ(partitions[0].size(), 6);
+}
+
+TEST(PartitionViewGraph, ConnectedComponentsArePartitionedSeparately) {
+  ViewGraph view_graph;
+  AddCluster(0, 5, &view_graph);
+  AddCluster(10, 5, &view_graph);
+
+  PartitionViewGraphOptions options;
+  options.max_num_views_per_partition = 10;
+  std::vector<std::unordered_set<ViewId> > partitions;
+  EXPECT_TRUE(PartitionViewGraph(options, view_graph, &partitions));
+  ASSERT_EQ(partitions.size(), 2);
+  // There is no overlap between disconnected components.
+  EXPECT_EQ(partitions[0].size(), 5);
+  EXPECT_EQ(partitions[1].size(), 5);
+}
+
+TEST(PartitionViewGraph, WeaklyConnectedClustersOverlap) {
+  // Two dense clusters of 8 views that are connected by weak edges.
+  ViewGraph view_graph;
+  AddCluster(0, 8, &view_graph);
+  AddCluster(8, 8, &view_graph);
+  TwoViewInfo weak_info;
+  weak_info.num_verified_matches = 1;
+  view_graph.AddEdge(0, 8, weak_info);
+  view_graph.AddEdge(3, 11, weak_info);
+  view_graph.AddEdge(7, 15, weak_info);
+
+  PartitionViewGraphOptions options;
+  options.max_num_views_per_partition = 10;
+  options.overlap_percent = 0.0;
+  options.min_num_overlapping_views = 2;
+  std::vector<std::unordered_set<ViewId> > partitions;
+  EXPECT_TRUE(PartitionViewGraph(options, view_graph, &partitions));
+  ASSERT_EQ(partitions.size(), 2);
+
+  // Each partition contains one of the clusters and is grown by two views of
+  // the other cluster.
+  for (const std::unordered_set<ViewId>& partition : partitions) {
+    EXPECT_EQ(partition.size(), 10);
+    const int num_views_in_first_cluster = NumViewsInRange(partition, 0, 8);
+    const int num_views_in_second_cluster = NumViewsInRange(partition, 8, 8);
+    EXPECT_TRUE(
+        (num_views_in_first_cluster == 8 && num_views_in_second_cluster == 2) ||
+        (num_views_in_first_cluster == 2 && num_views_in_second_cluster == 8));
+  }
+}
+
+TEST(PartitionViewGraph, EmptyViewGraph) {
+  ViewGraph view_graph;
+  PartitionViewGraphOptions options;
+  std::vector<std::unordered_set<ViewId> > partitions;
+  EXPECT_FALSE(PartitionViewGraph(options, view_graph, &partitions));
+  EXPECT_TRUE(partitions.empty());
+}
+
+}  // namespace theia
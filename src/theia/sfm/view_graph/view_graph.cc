@@ -47,6 +47,7 @@
 #include "theia/sfm/types.h"
 #include "theia/util/hash.h"
 #include "theia/util/map_util.h"
+#include "theia/util/memory_usage.h"
 
 namespace theia {
 
@@ -55,6 +56,15 @@ int ViewGraph::NumViews() const { return vertices_.size(); }
 
 int ViewGraph::NumEdges() const { return edges_.size(); }
 
+size_t ViewGraph::MemoryUsage() const {
+  size_t memory_usage =
+      sizeof(*this) + HeapMemoryUsage(vertices_) + HeapMemoryUsage(edges_);
+  for (const auto& vertex : vertices_) {
+    memory_usage += HeapMemoryUsage(vertex.second);
+  }
+  return memory_usage;
+}
+
 // Utilities to read and write a view graph to/from disk.
 bool ViewGraph::ReadFromDisk(const std::string& input_file) {
   std::ifstream input_reader(input_file, std::ios::in | std::ios::binary);
@@ -70,6 +70,9 @@ class ViewGraph {
   // Number of undirected edges in the graph.
   int NumEdges() const;
 
+  // Returns the approximate number of bytes of memory used by the view graph.
+  size_t MemoryUsage() const;
+
   bool HasView(const ViewId view_id) const;
 
   bool HasEdge(const ViewId view_id_1, const ViewId view_id_2) const;
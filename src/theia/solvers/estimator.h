@@ -35,10 +35,8 @@
 #ifndef THEIA_SOLVERS_ESTIMATOR_H_
 #define THEIA_SOLVERS_ESTIMATOR_H_
 
+#include <Eigen/Core>
 #include <glog/logging.h>
-#ifdef THEIA_USE_OPENMP
-#include <omp.h>
-#endif
 #include <vector>
 
 namespace theia {
@@ -92,11 +90,11 @@ class Estimator {
   // that calls Error() on each data point, but this function can be useful if
   // the errors of multiple points may be estimated simultanesously (e.g.,
   // matrix multiplication to compute the reprojection error of many points at
-  // once).
+  // once). The loop is not parallelized since estimators are typically run on
+  // many problems in parallel already.
   virtual std::vector<double> Residuals(const std::vector<Datum>& data,
                                         const Model& model) const {
     std::vector<double> residuals(data.size());
-#pragma omp parallel for
     for (int i = 0; i < data.size(); i++) {
       residuals[i] = Error(data[i], model);
     }
@@ -118,9 +116,27 @@ class Estimator {
     return inliers;
   }
 
+  // The degrees of freedom of the residuals returned by Error(), e.g. 2 for
+  // reprojection errors, and whether the residuals are squared distances.
+  // MAGSAC++ (see MagsacQualityMeasurement) models the distribution of the
+  // inlier residuals with them and rejects estimators that keep the default
+  // of 0 degrees of freedom.
+  virtual int ResidualDegreesOfFreedom() const { return 0; }
+  virtual bool ResidualsAreSquared() const { return true; }
+
   // Enable a quick check to see if the model is valid. This can be a geometric
   // check or some other verification of the model structure.
   virtual bool ValidModel(const Model& model) const { return true; }
+
+  // Outputs the spatial coordinates of a data point (e.g., the feature
+  // positions of a correspondence). Samplers that draw minimal samples from
+  // local neighborhoods (see ProgressiveNapsacSampler) use these coordinates
+  // and fall back to uniform sampling if the estimator returns false, which is
+  // the default.
+  virtual bool SpatialCoordinates(const Datum& datum,
+                                  Eigen::VectorXd* coordinates) const {
+    return false;
+  }
 };
 
 }  // namespace theia
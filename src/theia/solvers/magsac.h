@@ -0,0 +1,72 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_SOLVERS_MAGSAC_H_
+#define THEIA_SOLVERS_MAGSAC_H_
+
+#include "theia/solvers/magsac_quality_measurement.h"
+#include "theia/solvers/progressive_napsac.h"
+
+namespace theia {
+
+// Estimates a model with MAGSAC++ as described in "MAGSAC++, a fast, reliable
+// and accurate robust estimator" by Barath et al. (CVPR 2020): minimal samples
+// are drawn by the progressive NAPSAC sampler and models are scored with the
+// threshold-marginalizing MagsacQualityMeasurement, regardless of use_mle and
+// use_magsac. The error threshold is the largest residual an inlier may have
+// rather than a tuned inlier threshold, so it may be set generously. The
+// estimator must declare the degrees of freedom of its residuals (see
+// Estimator::ResidualDegreesOfFreedom).
+template <class ModelEstimator>
+class Magsac : public ProgressiveNapsac<ModelEstimator> {
+ public:
+  typedef typename ModelEstimator::Datum Datum;
+  typedef typename ModelEstimator::Model Model;
+
+  Magsac(const RansacParameters& ransac_params, const ModelEstimator& estimator)
+      : ProgressiveNapsac<ModelEstimator>(ransac_params, estimator) {}
+  virtual ~Magsac() {}
+
+  bool Initialize() override {
+    if (!ProgressiveNapsac<ModelEstimator>::Initialize()) {
+      return false;
+    }
+    this->quality_measurement_.reset(new MagsacQualityMeasurement(
+        this->ransac_params_.error_thresh,
+        this->estimator_.ResidualDegreesOfFreedom(),
+        this->estimator_.ResidualsAreSquared()));
+    return this->quality_measurement_->Initialize();
+  }
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_MAGSAC_H_
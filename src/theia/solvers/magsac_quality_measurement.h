@@ -0,0 +1,201 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_SOLVERS_MAGSAC_QUALITY_MEASUREMENT_H_
+#define THEIA_SOLVERS_MAGSAC_QUALITY_MEASUREMENT_H_
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "theia/solvers/quality_measurement.h"
+
+namespace theia {
+
+// The MAGSAC++ quality of "MAGSAC++, a fast, reliable and accurate robust
+// estimator" by Barath et al. (CVPR 2020). Instead of counting the residuals
+// below a single hand-tuned threshold, the loss of each residual is
+// marginalized over all noise scales sigma up to a maximum, so a model is
+// scored by how well it explains the data at every plausible noise level. The
+// error threshold is the largest residual of an inlier, i.e. k * sigma_max
+// where k is the 0.99 quantile of the chi distribution with the degrees of
+// freedom of the residual. The degrees of freedom are 4 for residuals that
+// measure the distance of a correspondence in two images (e.g., Sampson
+// distances), 2 for reprojection errors and 1 for point to plane distances.
+//
+// Residuals may be squared distances, like the residuals of most estimators in
+// theia/sfm/estimators, or plain distances. The error threshold is in the same
+// units as the residuals. The loss of a residual grows smoothly from 0 to 1 at
+// the threshold and every outlier costs 1, so the cost is at most the number
+// of data points.
+class MagsacQualityMeasurement : public QualityMeasurement {
+ public:
+  MagsacQualityMeasurement(const double error_thresh,
+                           const int degrees_of_freedom,
+                           const bool residuals_are_squared)
+      : QualityMeasurement(error_thresh),
+        degrees_of_freedom_(degrees_of_freedom),
+        residuals_are_squared_(residuals_are_squared) {}
+  ~MagsacQualityMeasurement() {}
+
+  // Tabulates the loss between zero and the error threshold.
+  bool Initialize() override {
+    CHECK_GT(error_thresh_, 0.0);
+    CHECK(degrees_of_freedom_ >= 1 && degrees_of_freedom_ <= 4)
+        << "MAGSAC++ supports residuals with 1 to 4 degrees of freedom.";
+    // The 0.99 quantiles of the chi distribution with 1, 2, 3 and 4 degrees of
+    // freedom.
+    static const double kQuantiles[] = {2.58, 3.03, 3.37, 3.64};
+    const double k = kQuantiles[degrees_of_freedom_ - 1];
+    const double max_x = k * k / 2.0;
+
+    // With x = r^2 / (2 sigma_max^2), the MAGSAC++ loss of a residual r is
+    //   gamma(a, x) + x * (Gamma(b, x) - Gamma(b, max_x)),
+    // up to a constant factor, where a = (dof + 1) / 2, b = (dof - 1) / 2 and
+    // gamma and Gamma are the lower and upper incomplete gamma functions. For
+    // one degree of freedom b = 0 and Gamma(0, x) is the exponential integral,
+    // which diverges at x = 0 while x * Gamma(0, x) goes to 0.
+    double lower_gamma_at_max, upper_gamma_at_max, unused;
+    IncompleteGamma(degrees_of_freedom_ + 1, max_x, &lower_gamma_at_max,
+                    &unused);
+    IncompleteGamma(degrees_of_freedom_ - 1, max_x, &unused,
+                    &upper_gamma_at_max);
+
+    loss_table_.resize(kTableSize + 1);
+    loss_table_[0] = 0.0;
+    for (int i = 1; i <= kTableSize; i++) {
+      const double x = max_x * i / kTableSize;
+      double lower_gamma, upper_gamma;
+      IncompleteGamma(degrees_of_freedom_ + 1, x, &lower_gamma, &unused);
+      IncompleteGamma(degrees_of_freedom_ - 1, x, &unused, &upper_gamma);
+      loss_table_[i] =
+          (lower_gamma + x * (upper_gamma - upper_gamma_at_max)) /
+          lower_gamma_at_max;
+    }
+    return true;
+  }
+
+  // Returns the sum of the losses of all residuals and the indices of the
+  // residuals below the error threshold.
+  double ComputeCost(const std::vector<double>& residuals,
+                     std::vector<int>* inliers) override {
+    inliers->reserve(residuals.size());
+    double cost = 0.0;
+    for (int i = 0; i < residuals.size(); i++) {
+      if (residuals[i] < error_thresh_) {
+        cost += Loss(residuals[i]);
+        inliers->emplace_back(i);
+      } else {
+        cost += 1.0;
+      }
+    }
+    return cost;
+  }
+
+  // The loss of a residual, interpolated linearly from the table.
+  double Loss(const double residual) const {
+    if (residual >= error_thresh_) {
+      return 1.0;
+    }
+    // The table is indexed by the squared residual relative to the squared
+    // error threshold.
+    const double relative_residual = std::max(residual, 0.0) / error_thresh_;
+    const double position =
+        (residuals_are_squared_ ? relative_residual
+                                : relative_residual * relative_residual) *
+        kTableSize;
+    const int index = std::min(static_cast<int>(position), kTableSize - 1);
+    const double t = position - index;
+    return (1.0 - t) * loss_table_[index] + t * loss_table_[index + 1];
+  }
+
+ private:
+  // The number of intervals of the loss table.
+  static const int kTableSize = 1024;
+
+  // Computes the lower and upper incomplete gamma functions of s = twice_s / 2
+  // at x with the recurrences gamma(s + 1, x) = s * gamma(s, x) - x^s e^-x and
+  // Gamma(s + 1, x) = s * Gamma(s, x) + x^s e^-x, starting from s = 1/2 or 1.
+  // Only the upper function is finite for s = 0.
+  static void IncompleteGamma(const int twice_s,
+                              const double x,
+                              double* lower,
+                              double* upper) {
+    CHECK_GE(twice_s, 0);
+    if (twice_s == 0) {
+      *lower = std::numeric_limits<double>::infinity();
+      *upper = ExponentialIntegral(x);
+      return;
+    }
+    double s;
+    if (twice_s % 2 == 1) {
+      static const double kSqrtPi = std::sqrt(M_PI);
+      s = 0.5;
+      *lower = kSqrtPi * std::erf(std::sqrt(x));
+      *upper = kSqrtPi * std::erfc(std::sqrt(x));
+    } else {
+      s = 1.0;
+      *lower = -std::expm1(-x);
+      *upper = std::exp(-x);
+    }
+    for (; 2.0 * s < twice_s; s += 1.0) {
+      const double term = std::pow(x, s) * std::exp(-x);
+      *lower = s * *lower - term;
+      *upper = s * *upper + term;
+    }
+  }
+
+  // The exponential integral E1(x) = Gamma(0, x) for x > 0 from its power
+  // series, which converges quickly for the x <= k^2 / 2 of the loss.
+  static double ExponentialIntegral(const double x) {
+    static const double kEulerGamma = 0.57721566490153286;
+    double sum = 0.0;
+    double term = 1.0;
+    for (int n = 1; n <= 64; n++) {
+      term *= -x / n;
+      sum += term / n;
+    }
+    return -kEulerGamma - std::log(x) - sum;
+  }
+
+  const int degrees_of_freedom_;
+  const bool residuals_are_squared_;
+  // The loss at kTableSize + 1 evenly spaced squared residuals from 0 to the
+  // squared error threshold.
+  std::vector<double> loss_table_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_MAGSAC_QUALITY_MEASUREMENT_H_
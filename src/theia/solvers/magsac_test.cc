@@ -0,0 +1,239 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <Eigen/QR>
+#include <glog/logging.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "theia/solvers/estimator.h"
+#include "theia/solvers/magsac.h"
+#include "theia/solvers/magsac_quality_measurement.h"
+#include "theia/solvers/ransac.h"
+#include "theia/util/random.h"
+
+namespace theia {
+namespace {
+
+struct Point {
+  double x;
+  double y;
+  Point() {}
+  Point(double _x, double _y) : x(_x), y(_y) {}
+};
+
+// y = mx + b
+struct Line {
+  double m;
+  double b;
+  Line() {}
+  Line(double _m, double _b) : m(_m), b(_b) {}
+};
+
+class LineEstimator : public Estimator<Point, Line> {
+ public:
+  LineEstimator() {}
+  ~LineEstimator() {}
+
+  double SampleSize() const { return 2; }
+  bool EstimateModel(const std::vector<Point>& data,
+                     std::vector<Line>* models) const {
+    Line model;
+    model.m = (data[1].y - data[0].y) / (data[1].x - data[0].x);
+    model.b = data[1].y - model.m * data[1].x;
+    models->push_back(model);
+    return true;
+  }
+
+  // Least squares fit of the line to the points.
+  bool RefineModel(const std::vector<Point>& data, Line* line) const {
+    if (data.size() < 2) {
+      return false;
+    }
+    Eigen::MatrixXd a(data.size(), 2);
+    Eigen::VectorXd b(data.size());
+    for (int i = 0; i < data.size(); i++) {
+      a.row(i) << data[i].x, 1.0;
+      b(i) = data[i].y;
+    }
+    const Eigen::Vector2d solution = a.colPivHouseholderQr().solve(b);
+    line->m = solution(0);
+    line->b = solution(1);
+    return true;
+  }
+
+  // The squared distance of the point to the line.
+  double Error(const Point& point, const Line& line) const {
+    const double distance = line.m * point.x - point.y + line.b;
+    return distance * distance / (line.m * line.m + 1.0);
+  }
+
+  int ResidualDegreesOfFreedom() const { return 1; }
+
+  bool SpatialCoordinates(const Point& point,
+                          Eigen::VectorXd* coordinates) const {
+    *coordinates = Eigen::Vector2d(point.x, point.y);
+    return true;
+  }
+};
+
+// Points on the line y = x with Gaussian noise and uniformly distributed
+// outliers. The first points are the inliers.
+std::vector<Point> LineWithOutliers(const int num_points,
+                                    const double inlier_ratio,
+                                    RandomNumberGenerator* rng) {
+  std::vector<Point> points;
+  const int num_inliers = inlier_ratio * num_points;
+  for (int i = 0; i < num_points; i++) {
+    if (i < num_inliers) {
+      const double x = rng->RandDouble(0.0, 1000.0);
+      points.emplace_back(x + rng->RandGaussian(0.0, 0.5),
+                          x + rng->RandGaussian(0.0, 0.5));
+    } else {
+      points.emplace_back(rng->RandDouble(0.0, 1000.0),
+                          rng->RandDouble(0.0, 1000.0));
+    }
+  }
+  return points;
+}
+
+}  // namespace
+
+TEST(MagsacQualityMeasurement, LossIsIncreasingAndBounded) {
+  static const double kErrorThreshold = 4.0;
+  for (int dof = 1; dof <= 4; dof++) {
+    MagsacQualityMeasurement quality(kErrorThreshold, dof, true);
+    ASSERT_TRUE(quality.Initialize());
+    EXPECT_NEAR(quality.Loss(0.0), 0.0, 1e-12);
+    EXPECT_NEAR(quality.Loss(kErrorThreshold * (1.0 - 1e-9)), 1.0, 1e-6);
+    EXPECT_EQ(quality.Loss(2.0 * kErrorThreshold), 1.0);
+    double previous_loss = 0.0;
+    for (int i = 1; i < 100; i++) {
+      const double loss = quality.Loss(kErrorThreshold * i / 100.0);
+      EXPECT_GT(loss, previous_loss);
+      EXPECT_LT(loss, 1.0);
+      previous_loss = loss;
+    }
+  }
+}
+
+TEST(MagsacQualityMeasurement, UnsquaredResiduals) {
+  static const double kErrorThreshold = 2.0;
+  for (int dof = 1; dof <= 4; dof++) {
+    MagsacQualityMeasurement squared_quality(
+        kErrorThreshold * kErrorThreshold, dof, true);
+    MagsacQualityMeasurement quality(kErrorThreshold, dof, false);
+    ASSERT_TRUE(squared_quality.Initialize());
+    ASSERT_TRUE(quality.Initialize());
+    for (int i = 0; i <= 100; i++) {
+      const double distance = 1.1 * kErrorThreshold * i / 100.0;
+      EXPECT_NEAR(quality.Loss(distance),
+                  squared_quality.Loss(distance * distance),
+                  1e-12);
+    }
+  }
+}
+
+TEST(MagsacQualityMeasurement, Cost) {
+  MagsacQualityMeasurement quality(1.0, 4, true);
+  ASSERT_TRUE(quality.Initialize());
+  const std::vector<double> residuals = {0.0, 0.5, 2.0, 0.25, 10.0};
+  std::vector<int> inliers;
+  const double cost = quality.ComputeCost(residuals, &inliers);
+  EXPECT_EQ(inliers, std::vector<int>({0, 1, 3}));
+  EXPECT_NEAR(cost, 2.0 + quality.Loss(0.5) + quality.Loss(0.25), 1e-12);
+}
+
+TEST(Magsac, LineFitting) {
+  RandomNumberGenerator rng(47);
+  const std::vector<Point> points = LineWithOutliers(5000, 0.2, &rng);
+
+  LineEstimator line_estimator;
+  RansacParameters params;
+  params.rng = std::make_shared<RandomNumberGenerator>(rng);
+  params.error_thresh = 9.0;
+  Magsac<LineEstimator> magsac(params, line_estimator);
+  ASSERT_TRUE(magsac.Initialize());
+
+  Line line;
+  RansacSummary summary;
+  ASSERT_TRUE(magsac.Estimate(points, &line, &summary));
+  EXPECT_NEAR(line.m, 1.0, 0.01);
+  EXPECT_NEAR(line.b, 0.0, 5.0);
+  EXPECT_GE(summary.inliers.size(), 950);
+}
+
+TEST(Magsac, FindsModelInFewerIterationsThanRansac) {
+  // With 3% inliers, a uniform minimal sample consists of inliers with a
+  // probability of about 1/1000. Samples from local neighborhoods of points on
+  // the line are much more likely to contain only inliers, so MAGSAC finds the
+  // line within a small iteration budget more often than RANSAC.
+  static const int kNumTrials = 20;
+  const auto is_correct = [](const Line& line) {
+    return std::abs(line.m - 1.0) < 0.01 && std::abs(line.b) < 5.0;
+  };
+  int num_magsac_successes = 0;
+  int num_ransac_successes = 0;
+  for (int i = 0; i < kNumTrials; i++) {
+    RandomNumberGenerator rng(100 + i);
+    const std::vector<Point> points = LineWithOutliers(5000, 0.03, &rng);
+
+    LineEstimator line_estimator;
+    RansacParameters params;
+    params.rng = std::make_shared<RandomNumberGenerator>(rng);
+    params.error_thresh = 9.0;
+    params.min_iterations = 400;
+    params.max_iterations = 400;
+    params.use_lo = true;
+    params.lo_start_iterations = 0;
+
+    Line line;
+    RansacSummary summary;
+    Magsac<LineEstimator> magsac(params, line_estimator);
+    ASSERT_TRUE(magsac.Initialize());
+    ASSERT_TRUE(magsac.Estimate(points, &line, &summary));
+    num_magsac_successes += is_correct(line);
+
+    Ransac<LineEstimator> ransac(params, line_estimator);
+    ASSERT_TRUE(ransac.Initialize());
+    ASSERT_TRUE(ransac.Estimate(points, &line, &summary));
+    num_ransac_successes += is_correct(line);
+  }
+  EXPECT_GE(num_magsac_successes, kNumTrials / 2);
+  EXPECT_GT(num_magsac_successes, num_ransac_successes);
+}
+
+}  // namespace theia
@@ -0,0 +1,91 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_SOLVERS_PROGRESSIVE_NAPSAC_H_
+#define THEIA_SOLVERS_PROGRESSIVE_NAPSAC_H_
+
+#include <Eigen/Core>
+
+#include <utility>
+#include <vector>
+
+#include "theia/solvers/progressive_napsac_sampler.h"
+#include "theia/solvers/sample_consensus_estimator.h"
+
+namespace theia {
+
+// Estimate a model with minimal samples drawn from local neighborhoods by the
+// ProgressiveNapsacSampler. The neighborhoods are found from the spatial
+// coordinates that the estimator outputs for each data point (see
+// Estimator::SpatialCoordinates). If the estimator does not provide spatial
+// coordinates, samples are drawn uniformly as in RANSAC.
+template <class ModelEstimator>
+class ProgressiveNapsac : public SampleConsensusEstimator<ModelEstimator> {
+ public:
+  typedef typename ModelEstimator::Datum Datum;
+  typedef typename ModelEstimator::Model Model;
+
+  ProgressiveNapsac(const RansacParameters& ransac_params,
+                    const ModelEstimator& estimator)
+      : SampleConsensusEstimator<ModelEstimator>(ransac_params, estimator) {}
+  virtual ~ProgressiveNapsac() {}
+
+  bool Initialize() override {
+    napsac_sampler_ = new ProgressiveNapsacSampler(
+        this->ransac_params_.rng, this->estimator_.SampleSize());
+    return SampleConsensusEstimator<ModelEstimator>::Initialize(
+        napsac_sampler_);
+  }
+
+  bool Estimate(const std::vector<Datum>& data,
+                Model* best_model,
+                RansacSummary* summary) override {
+    CHECK_NOTNULL(napsac_sampler_);
+    std::vector<Eigen::VectorXd> coordinates(data.size());
+    for (int i = 0; i < data.size(); i++) {
+      if (!this->estimator_.SpatialCoordinates(data[i], &coordinates[i])) {
+        coordinates.clear();
+        break;
+      }
+    }
+    napsac_sampler_->SetSpatialCoordinates(std::move(coordinates));
+    return SampleConsensusEstimator<ModelEstimator>::Estimate(
+        data, best_model, summary);
+  }
+
+ protected:
+  // Owned by the base class.
+  ProgressiveNapsacSampler* napsac_sampler_ = nullptr;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_PROGRESSIVE_NAPSAC_H_
@@ -0,0 +1,195 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/solvers/progressive_napsac_sampler.h"
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "theia/solvers/sampler.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+ProgressiveNapsacSampler::ProgressiveNapsacSampler(
+    const std::shared_ptr<RandomNumberGenerator>& rng,
+    const int min_num_samples,
+    const int num_grid_layers,
+    const int num_local_sampling_iterations)
+    : Sampler(rng, min_num_samples),
+      num_grid_layers_(num_grid_layers),
+      num_local_sampling_iterations_(num_local_sampling_iterations),
+      num_iterations_(0) {
+  CHECK_GT(num_grid_layers_, 0);
+  CHECK_GT(num_local_sampling_iterations_, 0);
+}
+
+void ProgressiveNapsacSampler::SetSpatialCoordinates(
+    std::vector<Eigen::VectorXd> coordinates) {
+  coordinates_ = std::move(coordinates);
+}
+
+bool ProgressiveNapsacSampler::Initialize(const int num_datapoints) {
+  CHECK_GE(num_datapoints, this->min_num_samples_);
+  sample_indices_.resize(num_datapoints);
+  std::iota(sample_indices_.begin(), sample_indices_.end(), 0);
+  num_times_center_.assign(num_datapoints, 0);
+  num_iterations_ = 0;
+
+  layers_.clear();
+  if (coordinates_.size() == num_datapoints) {
+    BuildGridLayers();
+  } else if (!coordinates_.empty()) {
+    LOG(WARNING) << "The number of spatial coordinates does not match the "
+                    "number of data points. Sampling uniformly instead.";
+  }
+  return true;
+}
+
+void ProgressiveNapsacSampler::BuildGridLayers() {
+  const int num_points = coordinates_.size();
+  const int dimension = coordinates_[0].size();
+  CHECK(dimension >= 1 && dimension <= 4)
+      << "Spatial coordinates must have 1 to 4 dimensions.";
+
+  Eigen::VectorXd min_coordinates = coordinates_[0];
+  Eigen::VectorXd max_coordinates = coordinates_[0];
+  for (const Eigen::VectorXd& coordinates : coordinates_) {
+    CHECK_EQ(coordinates.size(), dimension);
+    min_coordinates = min_coordinates.cwiseMin(coordinates);
+    max_coordinates = max_coordinates.cwiseMax(coordinates);
+  }
+  const Eigen::VectorXd extent =
+      (max_coordinates - min_coordinates)
+          .cwiseMax(Eigen::VectorXd::Constant(dimension, 1e-12));
+
+  // The finest layer has 2^num_grid_layers_ cells along each dimension and
+  // every following layer halves the number of cells.
+  layers_.resize(num_grid_layers_);
+  for (int l = 0; l < num_grid_layers_; l++) {
+    GridLayer& layer = layers_[l];
+    const int cells_per_dimension = 1 << (num_grid_layers_ - l);
+    int num_cells = 1;
+    for (int d = 0; d < dimension; d++) {
+      num_cells *= cells_per_dimension;
+    }
+
+    layer.point_cell.resize(num_points);
+    layer.cell_begin.assign(num_cells + 1, 0);
+    for (int i = 0; i < num_points; i++) {
+      int cell = 0;
+      for (int d = 0; d < dimension; d++) {
+        const int bin = std::min(
+            static_cast<int>((coordinates_[i][d] - min_coordinates[d]) /
+                             extent[d] * cells_per_dimension),
+            cells_per_dimension - 1);
+        cell = cell * cells_per_dimension + bin;
+      }
+      layer.point_cell[i] = cell;
+      ++layer.cell_begin[cell + 1];
+    }
+    std::partial_sum(layer.cell_begin.begin(),
+                     layer.cell_begin.end(),
+                     layer.cell_begin.begin());
+
+    layer.cell_points.resize(num_points);
+    std::vector<int> cell_end(layer.cell_begin.begin(),
+                              layer.cell_begin.end() - 1);
+    for (int i = 0; i < num_points; i++) {
+      layer.cell_points[cell_end[layer.point_cell[i]]++] = i;
+    }
+  }
+}
+
+bool ProgressiveNapsacSampler::Sample(std::vector<int>* subset_indices) {
+  ++num_iterations_;
+  // The probability of a uniform sample grows linearly until all samples are
+  // uniform.
+  if (layers_.empty() ||
+      this->rng_->RandDouble(0.0, 1.0) <
+          static_cast<double>(num_iterations_) /
+              num_local_sampling_iterations_) {
+    return SampleUniformly(subset_indices);
+  }
+
+  const int center = this->rng_->RandInt(0, num_times_center_.size() - 1);
+  const int num_times_center = num_times_center_[center]++;
+
+  // Use the finest cell of the center that holds enough points for a sample
+  // and that has not been sampled around this center more often than it has
+  // points.
+  for (const GridLayer& layer : layers_) {
+    const int cell = layer.point_cell[center];
+    const int begin = layer.cell_begin[cell];
+    const int end = layer.cell_begin[cell + 1];
+    const int cell_size = end - begin;
+    if (cell_size < this->min_num_samples_ || num_times_center >= cell_size) {
+      continue;
+    }
+
+    // Draw the remaining points of the sample from the cell. Rejecting
+    // duplicates is cheap since the cell holds at least as many points as the
+    // sample.
+    subset_indices->reserve(this->min_num_samples_);
+    subset_indices->emplace_back(center);
+    while (subset_indices->size() < this->min_num_samples_) {
+      const int point = layer.cell_points[this->rng_->RandInt(begin, end - 1)];
+      if (std::find(subset_indices->begin(), subset_indices->end(), point) ==
+          subset_indices->end()) {
+        subset_indices->emplace_back(point);
+      }
+    }
+    return true;
+  }
+
+  // The neighborhood of the center has been exhausted on all layers.
+  return SampleUniformly(subset_indices);
+}
+
+bool ProgressiveNapsacSampler::SampleUniformly(
+    std::vector<int>* subset_indices) {
+  subset_indices->reserve(this->min_num_samples_);
+  for (int i = 0; i < this->min_num_samples_; i++) {
+    std::swap(
+        sample_indices_[i],
+        sample_indices_[this->rng_->RandInt(i, sample_indices_.size() - 1)]);
+    subset_indices->emplace_back(sample_indices_[i]);
+  }
+  return true;
+}
+
+}  // namespace theia
@@ -0,0 +1,104 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_SOLVERS_PROGRESSIVE_NAPSAC_SAMPLER_H_
+#define THEIA_SOLVERS_PROGRESSIVE_NAPSAC_SAMPLER_H_
+
+#include <Eigen/Core>
+
+#include <memory>
+#include <vector>
+
+#include "theia/solvers/sampler.h"
+#include "theia/util/random.h"
+
+namespace theia {
+
+// The progressive NAPSAC (P-NAPSAC) sampler of "MAGSAC++, a fast, reliable and
+// accurate robust estimator" by Barath et al. (CVPR 2020). Inliers tend to be
+// closer to each other than outliers, so minimal samples drawn from a local
+// neighborhood contain only inliers far more often than uniform samples. Each
+// sample picks a random center point and draws the rest of the sample from the
+// grid cell of the center. Neighborhoods are found on a hierarchy of grids over
+// the spatial coordinates of the data, from fine to coarse, and the
+// neighborhood of a point grows to the next coarser grid once the point has
+// been the center of as many samples as its cell holds points. The sampler
+// blends into uniform sampling over the first num_local_sampling_iterations
+// samples so that the global structure of the data is not missed.
+//
+// The spatial coordinates must be set before Initialize is called. Without
+// coordinates, the sampler draws uniform samples like the RandomSampler.
+class ProgressiveNapsacSampler : public Sampler {
+ public:
+  ProgressiveNapsacSampler(const std::shared_ptr<RandomNumberGenerator>& rng,
+                           const int min_num_samples,
+                           const int num_grid_layers = 4,
+                           const int num_local_sampling_iterations = 1000);
+  ~ProgressiveNapsacSampler() {}
+
+  // Sets the coordinates of the data points, which must all have the same
+  // dimension (at most 4). Passing an empty vector disables local sampling.
+  void SetSpatialCoordinates(std::vector<Eigen::VectorXd> coordinates);
+
+  bool Initialize(const int num_datapoints) override;
+
+  // Samples the input variable data and fills the vector subset with the
+  // samples.
+  bool Sample(std::vector<int>* subset_indices) override;
+
+ private:
+  // A uniform grid over the bounding box of the coordinates. The points of
+  // each cell are stored contiguously in cell_points.
+  struct GridLayer {
+    std::vector<int> point_cell;
+    std::vector<int> cell_begin;
+    std::vector<int> cell_points;
+  };
+
+  void BuildGridLayers();
+  bool SampleUniformly(std::vector<int>* subset_indices);
+
+  const int num_grid_layers_;
+  const int num_local_sampling_iterations_;
+
+  std::vector<Eigen::VectorXd> coordinates_;
+  // Grid layers from the finest to the coarsest.
+  std::vector<GridLayer> layers_;
+  // The number of times each point was the center of a sample.
+  std::vector<int> num_times_center_;
+  // Indices permuted by the uniform sampling.
+  std::vector<int> sample_indices_;
+  int num_iterations_;
+};
+
+}  // namespace theia
+
+#endif  // THEIA_SOLVERS_PROGRESSIVE_NAPSAC_SAMPLER_H_
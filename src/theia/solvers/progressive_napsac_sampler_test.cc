@@ -0,0 +1,138 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "theia/solvers/progressive_napsac_sampler.h"
+#include "theia/util/random.h"
+#include "gtest/gtest.h"
+
+namespace theia {
+
+namespace {
+
+bool IsUnique(const std::vector<int>& vec) {
+  std::vector<int> sorted_vec = vec;
+  std::sort(sorted_vec.begin(), sorted_vec.end());
+  return std::unique(sorted_vec.begin(), sorted_vec.end()) == sorted_vec.end();
+}
+
+// Two clusters of points in opposite corners of the image. The first half of
+// the points belongs to the first cluster.
+std::vector<Eigen::VectorXd> TwoClusters(const int num_points,
+                                         RandomNumberGenerator* rng) {
+  std::vector<Eigen::VectorXd> coordinates(num_points);
+  for (int i = 0; i < num_points; i++) {
+    const double offset = i < num_points / 2 ? 0.0 : 100.0;
+    coordinates[i] = Eigen::Vector2d(rng->RandGaussian(offset, 1.0),
+                                     rng->RandGaussian(offset, 1.0));
+  }
+  return coordinates;
+}
+
+}  // namespace
+
+TEST(ProgressiveNapsacSampler, UniqueMinimalSample) {
+  std::shared_ptr<RandomNumberGenerator> rng =
+      std::make_shared<RandomNumberGenerator>(55);
+  static const int kNumPoints = 100;
+  static const int kMinNumSamples = 4;
+  ProgressiveNapsacSampler sampler(rng, kMinNumSamples);
+  sampler.SetSpatialCoordinates(TwoClusters(kNumPoints, rng.get()));
+  CHECK(sampler.Initialize(kNumPoints));
+  for (int i = 0; i < 2000; i++) {
+    std::vector<int> subset;
+    EXPECT_TRUE(sampler.Sample(&subset));
+    EXPECT_EQ(subset.size(), kMinNumSamples);
+    EXPECT_TRUE(IsUnique(subset));
+    for (const int index : subset) {
+      EXPECT_GE(index, 0);
+      EXPECT_LT(index, kNumPoints);
+    }
+  }
+}
+
+TEST(ProgressiveNapsacSampler, SamplesAreLocal) {
+  std::shared_ptr<RandomNumberGenerator> rng =
+      std::make_shared<RandomNumberGenerator>(56);
+  static const int kNumPoints = 200;
+  static const int kMinNumSamples = 3;
+  static const int kNumSamples = 100;
+  ProgressiveNapsacSampler sampler(rng, kMinNumSamples);
+  sampler.SetSpatialCoordinates(TwoClusters(kNumPoints, rng.get()));
+  CHECK(sampler.Initialize(kNumPoints));
+
+  // Uniform samples lie in a single cluster with a probability of 1/4, while
+  // the first samples of P-NAPSAC are almost all local.
+  int num_local_samples = 0;
+  for (int i = 0; i < kNumSamples; i++) {
+    std::vector<int> subset;
+    EXPECT_TRUE(sampler.Sample(&subset));
+    const int num_in_first_cluster =
+        std::count_if(subset.begin(), subset.end(), [](const int index) {
+          return index < kNumPoints / 2;
+        });
+    if (num_in_first_cluster == 0 || num_in_first_cluster == kMinNumSamples) {
+      ++num_local_samples;
+    }
+  }
+  EXPECT_GT(num_local_samples, 0.8 * kNumSamples);
+}
+
+TEST(ProgressiveNapsacSampler, UniformWithoutCoordinates) {
+  std::shared_ptr<RandomNumberGenerator> rng =
+      std::make_shared<RandomNumberGenerator>(57);
+  static const int kNumPoints = 11;
+  static const int kMinNumSamples = 3;
+  ProgressiveNapsacSampler sampler(rng, kMinNumSamples);
+  CHECK(sampler.Initialize(kNumPoints));
+
+  std::vector<int> num_times_sampled(kNumPoints, 0);
+  for (int i = 0; i < 1000; i++) {
+    std::vector<int> subset;
+    EXPECT_TRUE(sampler.Sample(&subset));
+    EXPECT_EQ(subset.size(), kMinNumSamples);
+    EXPECT_TRUE(IsUnique(subset));
+    for (const int index : subset) {
+      ++num_times_sampled[index];
+    }
+  }
+  for (const int num_times : num_times_sampled) {
+    EXPECT_GT(num_times, 0);
+  }
+}
+
+}  // namespace theia
@@ -44,6 +44,7 @@
 
 #include "theia/solvers/estimator.h"
 #include "theia/solvers/inlier_support.h"
+#include "theia/solvers/magsac_quality_measurement.h"
 #include "theia/solvers/mle_quality_measurement.h"
 #include "theia/solvers/quality_measurement.h"
 #include "theia/solvers/sampler.h"
@@ -62,6 +63,7 @@ struct RansacParameters {
         min_iterations(100),
         max_iterations(std::numeric_limits<int>::max()),
         use_mle(false),
+        use_magsac(false),
         use_Tdd_test(false),
         use_lo(false),
         lo_start_iterations(50) {}
@@ -103,6 +105,12 @@ struct RansacParameters {
   // and outliers count as a constant penalty.
   bool use_mle;
 
+  // Instead of the standard inlier count, use the MAGSAC++ quality, which
+  // marginalizes the inlier threshold over all noise scales up to error_thresh
+  // (see MagsacQualityMeasurement). This takes precedence over use_mle. The
+  // estimator must declare the degrees of freedom of its residuals.
+  bool use_magsac;
+
   // If local optimization should be used (LO-RANSAC). This only works if the
   // corresponding estimator has the RefineModel() model function implemented.
   // Otherwise no local optimization is performed
@@ -221,7 +229,12 @@ bool SampleConsensusEstimator<ModelEstimator>::Initialize(Sampler* sampler) {
   CHECK_NOTNULL(sampler);
   sampler_.reset(sampler);
 
-  if (ransac_params_.use_mle) {
+  if (ransac_params_.use_magsac) {
+    quality_measurement_.reset(
+        new MagsacQualityMeasurement(ransac_params_.error_thresh,
+                                     estimator_.ResidualDegreesOfFreedom(),
+                                     estimator_.ResidualsAreSquared()));
+  } else if (ransac_params_.use_mle) {
     quality_measurement_.reset(
         new MLEQualityMeasurement(ransac_params_.error_thresh));
   } else {
@@ -0,0 +1,170 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_UTIL_BOUNDED_QUEUE_H_
+#define THEIA_UTIL_BOUNDED_QUEUE_H_
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <utility>
+
+#include "theia/util/util.h"
+
+namespace theia {
+
+// A thread-safe FIFO queue holding at most a fixed number of items. Producers
+// block in Push while the queue is full and consumers block in Pop while it is
+// empty, so a slow consumer throttles its producers (back-pressure) instead of
+// letting the queue grow without bounds. Once Close has been called, Push fails
+// and Pop returns the remaining items before failing as well.
+//
+// The queue keeps statistics about its depth and about the time producers and
+// consumers spent blocked, which help to find the bottleneck of a pipeline.
+//
+// NOTE: Threads blocked in Push or Pop do not run other work, so pipeline
+// stages connected with bounded queues should run on their own threads rather
+// than on the tasks of the shared TaskScheduler.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(const int capacity) : capacity_(capacity) {
+    CHECK_GT(capacity_, 0);
+  }
+
+  // Adds the item to the back of the queue, blocking while the queue is full.
+  // Returns false and drops the item if the queue has been closed.
+  bool Push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!closed_ && static_cast<int>(queue_.size()) >= capacity_) {
+      const auto start = std::chrono::steady_clock::now();
+      not_full_.wait(lock, [this] {
+        return closed_ || static_cast<int>(queue_.size()) < capacity_;
+      });
+      push_wait_time_ += std::chrono::steady_clock::now() - start;
+    }
+    if (closed_) {
+      return false;
+    }
+    queue_.emplace_back(std::move(item));
+    ++num_pushed_;
+    depth_sum_ += queue_.size();
+    max_depth_ = std::max(max_depth_, static_cast<int>(queue_.size()));
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Removes the item at the front of the queue, blocking while the queue is
+  // empty. Returns false once the queue has been closed and is empty.
+  bool Pop(T* item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!closed_ && queue_.empty()) {
+      const auto start = std::chrono::steady_clock::now();
+      not_empty_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+      pop_wait_time_ += std::chrono::steady_clock::now() - start;
+    }
+    if (queue_.empty()) {
+      return false;
+    }
+    *item = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+  }
+
+  // No more items may be pushed. Wakes up all blocked producers and consumers.
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+  int Capacity() const { return capacity_; }
+
+  int Size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+  }
+
+  // The largest and the average number of items in the queue, sampled after
+  // each successful Push.
+  int MaxDepth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_depth_;
+  }
+  double MeanDepth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_pushed_ == 0 ? 0.0
+                            : static_cast<double>(depth_sum_) / num_pushed_;
+  }
+
+  // The total time that producers spent waiting for room in the queue and that
+  // consumers spent waiting for items.
+  double PushWaitTimeInSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return push_wait_time_.count();
+  }
+  double PopWaitTimeInSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pop_wait_time_.count();
+  }
+
+ private:
+  const int capacity_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T> queue_;
+  bool closed_ = false;
+
+  int64_t num_pushed_ = 0;
+  int64_t depth_sum_ = 0;
+  int max_depth_ = 0;
+  std::chrono::duration<double> push_wait_time_{0.0};
+  std::chrono::duration<double> pop_wait_time_{0.0};
+
+  DISALLOW_COPY_AND_ASSIGN(BoundedQueue);
+};
+
+}  // namespace theia
+
+#endif  // THEIA_UTIL_BOUNDED_QUEUE_H_
@@ -0,0 +1,142 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "theia/util/bounded_queue.h"
+
+#include "gtest/gtest.h"
+
+namespace theia {
+
+TEST(BoundedQueue, FirstInFirstOut) {
+  BoundedQueue<int> queue(3);
+  EXPECT_TRUE(queue.Push(1));
+  EXPECT_TRUE(queue.Push(2));
+  EXPECT_TRUE(queue.Push(3));
+  EXPECT_EQ(queue.Size(), 3);
+  EXPECT_EQ(queue.MaxDepth(), 3);
+  EXPECT_DOUBLE_EQ(queue.MeanDepth(), 2.0);
+
+  int item = 0;
+  for (int i = 1; i <= 3; i++) {
+    EXPECT_TRUE(queue.Pop(&item));
+    EXPECT_EQ(item, i);
+  }
+  EXPECT_EQ(queue.Size(), 0);
+}
+
+TEST(BoundedQueue, CloseDrainsRemainingItems) {
+  BoundedQueue<int> queue(2);
+  EXPECT_TRUE(queue.Push(1));
+  queue.Close();
+  EXPECT_FALSE(queue.Push(2));
+
+  int item = 0;
+  EXPECT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(item, 1);
+  EXPECT_FALSE(queue.Pop(&item));
+}
+
+TEST(BoundedQueue, CloseWakesBlockedConsumers) {
+  BoundedQueue<int> queue(1);
+  std::thread consumer([&queue]() {
+    int item = 0;
+    EXPECT_FALSE(queue.Pop(&item));
+  });
+  queue.Close();
+  consumer.join();
+}
+
+TEST(BoundedQueue, FullQueueBlocksProducers) {
+  static const int kNumItems = 1000;
+  static const int kCapacity = 4;
+  BoundedQueue<int> queue(kCapacity);
+
+  std::atomic<int> num_pushed(0);
+  std::thread producer([&]() {
+    for (int i = 0; i < kNumItems; i++) {
+      EXPECT_TRUE(queue.Push(i));
+      ++num_pushed;
+    }
+  });
+
+  // Items are consumed in order and the queue never holds more than its
+  // capacity, no matter how far the producer is ahead of the consumer.
+  int item = 0;
+  for (int i = 0; i < kNumItems; i++) {
+    EXPECT_TRUE(queue.Pop(&item));
+    EXPECT_EQ(item, i);
+    EXPECT_LE(num_pushed - i, kCapacity + 1);
+  }
+  producer.join();
+  EXPECT_LE(queue.MaxDepth(), kCapacity);
+}
+
+TEST(BoundedQueue, MultipleProducersAndConsumers) {
+  static const int kNumProducers = 3;
+  static const int kNumConsumers = 3;
+  static const int kNumItemsPerProducer = 10000;
+  BoundedQueue<int> queue(8);
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kNumProducers; i++) {
+    producers.emplace_back([&queue]() {
+      for (int j = 1; j <= kNumItemsPerProducer; j++) {
+        queue.Push(j);
+      }
+    });
+  }
+  std::atomic<int64_t> sum(0);
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < kNumConsumers; i++) {
+    consumers.emplace_back([&queue, &sum]() {
+      int item = 0;
+      while (queue.Pop(&item)) {
+        sum += item;
+      }
+    });
+  }
+
+  for (std::thread& producer : producers) {
+    producer.join();
+  }
+  queue.Close();
+  for (std::thread& consumer : consumers) {
+    consumer.join();
+  }
+  EXPECT_EQ(sum, static_cast<int64_t>(kNumProducers) * kNumItemsPerProducer *
+                     (kNumItemsPerProducer + 1) / 2);
+}
+
+}  // namespace theia
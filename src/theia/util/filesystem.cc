@@ -35,7 +35,9 @@
 #include "theia/util/filesystem.h"
 
 #include <glog/logging.h>
+#include <stdlib.h>
 #include <stlplus3/file_system.hpp>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -111,4 +113,44 @@ bool CopyFile(const std::string& filepath_to_copy_from,
   return stlplus::file_copy(filepath_to_copy_from, filepath_to_copy_to);
 }
 
+bool CreateTemporaryDirectory(const std::string& prefix,
+                              std::string* directory) {
+  CHECK_NOTNULL(directory);
+#ifdef _WIN32
+  const char* temporary_directory = getenv("TEMP");
+  const std::string base_directory =
+      temporary_directory != nullptr ? temporary_directory : ".";
+  std::random_device random_device;
+  static const int kMaxNumAttempts = 100;
+  for (int i = 0; i < kMaxNumAttempts; i++) {
+    *directory = stlplus::create_filespec(
+        base_directory, prefix + std::to_string(random_device()));
+    if (!stlplus::folder_exists(*directory) &&
+        stlplus::folder_create(*directory)) {
+      return true;
+    }
+  }
+  return false;
+#else
+  const char* temporary_directory = getenv("TMPDIR");
+  const std::string directory_template =
+      stlplus::create_filespec(
+          temporary_directory != nullptr ? temporary_directory : "/tmp",
+          prefix) +
+      "XXXXXX";
+  std::vector<char> directory_name(directory_template.begin(),
+                                   directory_template.end());
+  directory_name.push_back('\0');
+  if (mkdtemp(directory_name.data()) == nullptr) {
+    return false;
+  }
+  *directory = directory_name.data();
+  return true;
+#endif
+}
+
+bool RemoveDirectory(const std::string& directory) {
+  return stlplus::folder_delete(directory, true);
+}
+
 }  // namespace theia
@@ -69,6 +69,15 @@ bool CreateNewDirectory(const std::string& directory);
 bool CopyFile(const std::string& filepath_to_copy_from,
               const std::string& filepath_to_copy_to);
 
+// Creates a new, uniquely named directory in the temporary directory of the
+// system (TMPDIR on POSIX systems). The name of the directory starts with the
+// prefix. Returns false if the directory could not be created.
+bool CreateTemporaryDirectory(const std::string& prefix,
+                              std::string* directory);
+
+// Removes the directory and all of its contents.
+bool RemoveDirectory(const std::string& directory);
+
 }  // namespace theia
 
 #endif  // THEIA_UTIL_FILESYSTEM_H_
@@ -0,0 +1,61 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/util/filesystem.h"
+
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace theia {
+
+TEST(Filesystem, CreateAndRemoveTemporaryDirectory) {
+  std::string directory1, directory2;
+  ASSERT_TRUE(CreateTemporaryDirectory("theia_test_", &directory1));
+  ASSERT_TRUE(CreateTemporaryDirectory("theia_test_", &directory2));
+  EXPECT_NE(directory1, directory2);
+  EXPECT_TRUE(DirectoryExists(directory1));
+  EXPECT_TRUE(DirectoryExists(directory2));
+
+  // The directory is removed together with its contents.
+  const std::string filepath = directory1 + "/file.txt";
+  std::ofstream(filepath) << "contents";
+  EXPECT_TRUE(FileExists(filepath));
+  EXPECT_TRUE(RemoveDirectory(directory1));
+  EXPECT_FALSE(FileExists(filepath));
+  EXPECT_FALSE(DirectoryExists(directory1));
+
+  EXPECT_TRUE(RemoveDirectory(directory2));
+  EXPECT_FALSE(DirectoryExists(directory2));
+}
+
+}  // namespace theia
@@ -111,29 +111,67 @@ class LRUCache {
     InsertIntoCache(key, value);
   }
 
+  // Removes the entry from the cache if it exists. Returns true if an entry was
+  // removed.
+  virtual bool Remove(const KeyType& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = cache_entries_map_.find(key);
+    if (it == cache_entries_map_.end()) {
+      return false;
+    }
+    cache_size_ -= EntrySize(it->second.first);
+    cache_entries_.erase(it->second.second);
+    cache_entries_map_.erase(it);
+    return true;
+  }
+
   // Return if the key exists in the cache.
   virtual bool ExistsInCache(const KeyType& key) {
     return ContainsKey(cache_entries_map_, key);
   }
 
+  // Sets the function that measures the size of a cached value (e.g. its memory
+  // usage in bytes). By default each entry has a size of 1.
+  void SetEntrySizeFunction(
+      const std::function<size_t(const ValueType&)>& entry_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entry_size_ = entry_size;
+    cache_size_ = 0;
+    for (const auto& entry : cache_entries_map_) {
+      cache_size_ += EntrySize(entry.second.first);
+    }
+    EvictEntriesToFitCapacity();
+  }
+
+  // Limits the total size of the cached values as measured by the entry size
+  // function, in addition to the maximum number of entries. The least recently
+  // used entries are evicted until the cache fits into the new capacity.
+  void SetMaxCacheSize(const size_t max_cache_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_cache_size_ = max_cache_size;
+    EvictEntriesToFitCapacity();
+  }
+
   // Varios statistics for the cache.
   int CacheCapacity() const { return max_cache_entries_; }
+  size_t MaxCacheSize() const { return max_cache_size_; }
+  size_t CacheSize() const { return cache_size_; }
   int Size() const { return cache_entries_map_.size(); }
   int NumCacheMisses() const { return cache_misses_; }
   int NumCacheHits() const { return cache_hits_; }
 
  private:
-  // Insert the key/value pair into the cache, evicting the oldest entry if
-  // necessary.
+  // Insert the key/value pair into the cache, evicting the oldest entries if
+  // necessary. An entry that is larger than the maximum cache size is not kept.
   //
   // NOTE: This method is not thread-safe so any methods calling it must take
   // proper thread safety precautions.
   void InsertIntoCache(const KeyType& key, const ValueType& value) {
     // Ensure this method is only called on a cache miss.
     CHECK(!ContainsKey(cache_entries_map_, key));
-
-    if (cache_entries_map_.size() == max_cache_entries_) {
-      EvictOldestEntry();
+    const size_t entry_size = EntrySize(value);
+    if (entry_size > max_cache_size_) {
+      return;
     }
 
     // Insert the entry into the end of the accessor list (i.e. as the most
@@ -142,6 +180,27 @@ class LRUCache {
 
     // Add the entry to the map.
     cache_entries_map_.insert(std::make_pair(key, std::make_pair(value, it)));
+    cache_size_ += entry_size;
+
+    EvictEntriesToFitCapacity();
+  }
+
+  // Evicts the oldest entries until both the number of entries and their total
+  // size are within the capacity of the cache.
+  //
+  // NOTE: This method is not thread-safe so any methods calling it must take
+  // proper thread safety precautions.
+  void EvictEntriesToFitCapacity() {
+    const size_t max_cache_entries = max_cache_entries_;
+    while (!cache_entries_.empty() &&
+           (cache_entries_map_.size() > max_cache_entries ||
+            cache_size_ > max_cache_size_)) {
+      EvictOldestEntry();
+    }
+  }
+
+  size_t EntrySize(const ValueType& value) const {
+    return entry_size_ ? entry_size_(value) : 1;
   }
 
   // Evicts the oldest entry from the cache.
@@ -154,7 +213,9 @@ class LRUCache {
     CHECK_GT(cache_entries_map_.size(), 0);
 
     const KeyType& evicted_key = *cache_entries_.begin();
-    cache_entries_map_.erase(evicted_key);
+    const auto it = cache_entries_map_.find(evicted_key);
+    cache_size_ -= EntrySize(it->second.first);
+    cache_entries_map_.erase(it);
     cache_entries_.pop_front();
   }
 
@@ -176,6 +237,12 @@ class LRUCache {
   // Maximum cache size.
   const int max_cache_entries_;
 
+  // Measures the size of a cached value. The total size of the cached values
+  // is limited by max_cache_size_.
+  std::function<size_t(const ValueType&)> entry_size_;
+  size_t max_cache_size_ = std::numeric_limits<size_t>::max();
+  size_t cache_size_ = 0;
+
   // Some cache statistics.
   int cache_misses_, cache_hits_;
 
@@ -132,4 +132,49 @@ TEST(LRUCache, FetchWithCacheMiss) {
   EXPECT_EQ(lru_cache.NumCacheHits(), 0);
 }
 
+TEST(LRUCache, Remove) {
+  static const int kMaxCacheSize = 2;
+  LRUCache<int, int> lru_cache(CacheMissLookup, kMaxCacheSize);
+  lru_cache.Fetch(0);
+  lru_cache.Fetch(1);
+  EXPECT_TRUE(lru_cache.Remove(0));
+  EXPECT_FALSE(lru_cache.Remove(0));
+  EXPECT_FALSE(lru_cache.ExistsInCache(0));
+  EXPECT_TRUE(lru_cache.ExistsInCache(1));
+  EXPECT_EQ(lru_cache.Size(), 1);
+  EXPECT_EQ(lru_cache.CacheSize(), 1);
+
+  // The removed entry can be inserted again.
+  lru_cache.Insert(0, FindOrDie(cache_lookup, 0));
+  EXPECT_EQ(lru_cache.Size(), 2);
+}
+
+TEST(LRUCache, MaxCacheSizeEvictsLeastRecentlyUsedEntries) {
+  static const int kMaxCacheSize = 10;
+  LRUCache<int, int> lru_cache(CacheMissLookup, kMaxCacheSize);
+  // Measure each entry by its value.
+  lru_cache.SetEntrySizeFunction([](const int& value) { return value; });
+  lru_cache.SetMaxCacheSize(61);
+
+  // Entries 0, 1 and 2 have a total size of 62, so entry 0 is evicted.
+  lru_cache.Fetch(0);
+  lru_cache.Fetch(1);
+  lru_cache.Fetch(2);
+  EXPECT_FALSE(lru_cache.ExistsInCache(0));
+  EXPECT_EQ(lru_cache.Size(), 2);
+  EXPECT_EQ(lru_cache.CacheSize(), 61);
+  EXPECT_LE(lru_cache.CacheSize(), lru_cache.MaxCacheSize());
+
+  // Entry 3 is larger than the cache and is not kept.
+  EXPECT_EQ(lru_cache.Fetch(3), FindOrDie(cache_lookup, 3));
+  EXPECT_FALSE(lru_cache.ExistsInCache(3));
+
+  // Lowering the budget evicts the least recently used entry.
+  lru_cache.Fetch(1);
+  lru_cache.SetMaxCacheSize(50);
+  EXPECT_TRUE(lru_cache.ExistsInCache(1));
+  EXPECT_FALSE(lru_cache.ExistsInCache(2));
+  EXPECT_EQ(lru_cache.CacheSize(), 47);
+}
+
 }  // namespace theia
@@ -0,0 +1,119 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/util/mapped_file.h"
+
+#include <glog/logging.h>
+
+#include <fstream>  // NOLINT
+#include <iterator>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+namespace theia {
+
+MappedFile::MappedFile() : data_(""), size_(0), is_mapped_(false) {}
+
+MappedFile::~MappedFile() { Close(); }
+
+bool MappedFile::Open(const std::string& filepath) {
+  Close();
+
+#ifndef _WIN32
+  const int file_descriptor = open(filepath.c_str(), O_RDONLY);
+  if (file_descriptor < 0) {
+    VLOG(2) << "Could not open " << filepath;
+    return false;
+  }
+
+  struct stat file_status;
+  if (fstat(file_descriptor, &file_status) != 0) {
+    close(file_descriptor);
+    return false;
+  }
+
+  // Empty files cannot be mapped.
+  if (file_status.st_size > 0) {
+    void* data = mmap(nullptr,
+                      file_status.st_size,
+                      PROT_READ,
+                      MAP_PRIVATE,
+                      file_descriptor,
+                      0);
+    if (data != MAP_FAILED) {
+      // The files are parsed front to back, so ask for aggressive read-ahead.
+      // The advice values are not flags and must be given one at a time.
+      madvise(data, file_status.st_size, MADV_SEQUENTIAL);
+      madvise(data, file_status.st_size, MADV_WILLNEED);
+      data_ = static_cast<const char*>(data);
+      size_ = file_status.st_size;
+      is_mapped_ = true;
+    }
+  }
+  // The mapping stays valid after the file is closed.
+  close(file_descriptor);
+  if (is_mapped_ || file_status.st_size == 0) {
+    return true;
+  }
+  VLOG(2) << "Could not map " << filepath << ". Reading it instead.";
+#endif  // _WIN32
+
+  std::ifstream ifs(filepath.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs.is_open()) {
+    VLOG(2) << "Could not open " << filepath;
+    return false;
+  }
+  buffer_.assign(std::istreambuf_iterator<char>(ifs),
+                 std::istreambuf_iterator<char>());
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+  return true;
+}
+
+void MappedFile::Close() {
+#ifndef _WIN32
+  if (is_mapped_) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+#endif  // _WIN32
+  buffer_.clear();
+  data_ = "";
+  size_ = 0;
+  is_mapped_ = false;
+}
+
+}  // namespace theia
@@ -0,0 +1,76 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_UTIL_MAPPED_FILE_H_
+#define THEIA_UTIL_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+#include "theia/util/util.h"
+
+namespace theia {
+
+// A read-only view of the contents of a file. On POSIX systems the file is
+// memory-mapped so that large text inputs may be parsed in place, possibly by
+// several threads at once, without copying them through stream buffers. On
+// other systems the file is read into memory instead.
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+
+  // Maps the file into memory. Returns false if the file cannot be opened or
+  // mapped.
+  bool Open(const std::string& filepath);
+
+  // Unmaps the file. This is called by the destructor.
+  void Close();
+
+  // The contents of the file. The data is not null-terminated.
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+  bool is_mapped_;
+
+  // Holds the contents of the file if it could not be mapped.
+  std::string buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+}  // namespace theia
+
+#endif  // THEIA_UTIL_MAPPED_FILE_H_
@@ -0,0 +1,96 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_UTIL_MEMORY_USAGE_H_
+#define THEIA_UTIL_MEMORY_USAGE_H_
+
+#include <Eigen/Core>
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace theia {
+
+// Helpers to approximate the number of bytes of heap memory allocated by the
+// standard containers, which is used to report the memory usage of the SfM data
+// structures. The estimates follow the node-based layout of the common standard
+// library implementations and include the storage of the elements themselves
+// (i.e. sizeof(value_type) per element), but not the memory that the elements
+// allocate on their own. Callers must add the latter for elements such as
+// strings or nested containers.
+//
+// All functions run in constant time, so the memory usage of a structure can
+// be checked against a budget as often as needed.
+
+inline size_t HeapMemoryUsage(const std::string& str) {
+  // Short strings are stored inline (small string optimization).
+  static const size_t kInlineCapacity = 15;
+  return str.capacity() > kInlineCapacity ? str.capacity() + 1 : 0;
+}
+
+template <typename T, typename Allocator>
+size_t HeapMemoryUsage(const std::vector<T, Allocator>& vec) {
+  return vec.capacity() * sizeof(T);
+}
+
+template <typename Scalar, int Rows, int Cols, int Options>
+size_t HeapMemoryUsage(
+    const Eigen::Matrix<Scalar, Rows, Cols, Options>& matrix) {
+  return (Rows == Eigen::Dynamic || Cols == Eigen::Dynamic)
+             ? matrix.size() * sizeof(Scalar)
+             : 0;
+}
+
+// Each element of a hash table is stored in a node with a pointer to the next
+// node and the cached hash value, and the table holds one pointer per bucket.
+template <typename Key, typename Value, typename Hash, typename Equal,
+          typename Allocator>
+size_t HeapMemoryUsage(
+    const std::unordered_map<Key, Value, Hash, Equal, Allocator>& map) {
+  return map.bucket_count() * sizeof(void*) +
+         map.size() * (sizeof(std::pair<const Key, Value>) + sizeof(void*) +
+                       sizeof(size_t));
+}
+
+template <typename Key, typename Hash, typename Equal, typename Allocator>
+size_t HeapMemoryUsage(
+    const std::unordered_set<Key, Hash, Equal, Allocator>& set) {
+  return set.bucket_count() * sizeof(void*) +
+         set.size() * (sizeof(Key) + sizeof(void*) + sizeof(size_t));
+}
+
+}  // namespace theia
+
+#endif  // THEIA_UTIL_MEMORY_USAGE_H_
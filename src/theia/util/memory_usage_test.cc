@@ -0,0 +1,79 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Eigen/Core>
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "theia/util/memory_usage.h"
+
+#include "gtest/gtest.h"
+
+namespace theia {
+
+TEST(MemoryUsage, Strings) {
+  // Short strings do not allocate.
+  EXPECT_EQ(HeapMemoryUsage(std::string("view")), 0);
+  const std::string long_string(100, 'a');
+  EXPECT_GE(HeapMemoryUsage(long_string), 101);
+}
+
+TEST(MemoryUsage, VectorsAndMatrices) {
+  std::vector<double> vec;
+  EXPECT_EQ(HeapMemoryUsage(vec), 0);
+  vec.reserve(10);
+  EXPECT_EQ(HeapMemoryUsage(vec), 10 * sizeof(double));
+
+  // Fixed-size matrices are stored inline.
+  EXPECT_EQ(HeapMemoryUsage(Eigen::Matrix3d()), 0);
+  EXPECT_EQ(HeapMemoryUsage(Eigen::VectorXf(128)), 128 * sizeof(float));
+}
+
+TEST(MemoryUsage, HashTablesGrowWithTheirElements) {
+  std::unordered_map<int, double> map;
+  std::unordered_set<int> set;
+  const size_t empty_map_usage = HeapMemoryUsage(map);
+  const size_t empty_set_usage = HeapMemoryUsage(set);
+  for (int i = 0; i < 1000; i++) {
+    map[i] = i;
+    set.insert(i);
+  }
+  EXPECT_GE(HeapMemoryUsage(map),
+            empty_map_usage + 1000 * sizeof(std::pair<const int, double>));
+  EXPECT_GE(HeapMemoryUsage(set), empty_set_usage + 1000 * sizeof(int));
+  // The buckets are counted as well.
+  EXPECT_GE(HeapMemoryUsage(set), set.bucket_count() * sizeof(void*));
+}
+
+}  // namespace theia
@@ -34,60 +34,213 @@
 
 #include "theia/util/random.h"
 
+#include <atomic>
 #include <chrono>  // NOLINT
+#include <cmath>
 #include <glog/logging.h>
-#include <random>
 
 #include "theia/util/util.h"
 
 namespace theia {
 namespace {
 
-#ifdef THEIA_HAS_THREAD_LOCAL_KEYWORD
-thread_local std::mt19937 util_generator;
-#else
-static std::mt19937 util_generator;
-#endif  // THEIA_HAS_THREAD_LOCAL_KEYWORD
+// Distinguishes generators that are seeded from the clock at the same time.
+std::atomic<uint64_t> num_clock_seeded_generators(0);
+
+inline uint64_t RotateLeft(const uint64_t x, const int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+// The splitmix64 generator. It is used to expand a seed into the full state, as
+// recommended by the authors of xoshiro.
+inline uint64_t SplitMix64(uint64_t* x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
 
 }  // namespace
 
 RandomNumberGenerator::RandomNumberGenerator() {
-  const unsigned seed =
-      std::chrono::system_clock::now().time_since_epoch().count();
-  util_generator.seed(seed);
+  const uint64_t time_seed =
+      std::chrono::high_resolution_clock::now().time_since_epoch().count();
+  uint64_t seed = time_seed ^ RotateLeft(++num_clock_seeded_generators, 32);
+  for (int i = 0; i < 4; i++) {
+    state_[i] = SplitMix64(&seed);
+  }
+  has_spare_gaussian_ = false;
 }
 
 RandomNumberGenerator::RandomNumberGenerator(const unsigned seed) {
-  util_generator.seed(seed);
+  Seed(seed);
 }
 
 void RandomNumberGenerator::Seed(const unsigned seed) {
-  util_generator.seed(seed);
+  uint64_t x = seed;
+  for (int i = 0; i < 4; i++) {
+    state_[i] = SplitMix64(&x);
+  }
+  has_spare_gaussian_ = false;
+}
+
+inline uint64_t RandomNumberGenerator::Next() {
+  const uint64_t result = RotateLeft(state_[1] * 5, 7) * 9;
+  const uint64_t t = state_[1] << 17;
+  state_[2] ^= state_[0];
+  state_[3] ^= state_[1];
+  state_[1] ^= state_[2];
+  state_[0] ^= state_[3];
+  state_[2] ^= t;
+  state_[3] = RotateLeft(state_[3], 45);
+  return result;
+}
+
+inline double RandomNumberGenerator::NextUnitDouble() {
+  // Use the upper 53 bits for the mantissa.
+  return (Next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+inline double RandomNumberGenerator::NextGaussian() {
+  if (has_spare_gaussian_) {
+    has_spare_gaussian_ = false;
+    return spare_gaussian_;
+  }
+
+  // Marsaglia's polar method.
+  double u, v, s;
+  do {
+    u = 2.0 * NextUnitDouble() - 1.0;
+    v = 2.0 * NextUnitDouble() - 1.0;
+    s = u * u + v * v;
+  } while (s >= 1.0 || s == 0.0);
+  const double scale = std::sqrt(-2.0 * std::log(s) / s);
+  spare_gaussian_ = v * scale;
+  has_spare_gaussian_ = true;
+  return u * scale;
+}
+
+void RandomNumberGenerator::Jump() {
+  static const uint64_t kJump[] = {0x180ec6d33cfd0abaULL,
+                                   0xd5a61266f0c9392cULL,
+                                   0xa9582618e03fc9aaULL,
+                                   0x39abdc4529b1661cULL};
+  uint64_t jumped_state[4] = {0, 0, 0, 0};
+  for (int i = 0; i < 4; i++) {
+    for (int b = 0; b < 64; b++) {
+      if (kJump[i] & (1ULL << b)) {
+        for (int j = 0; j < 4; j++) {
+          jumped_state[j] ^= state_[j];
+        }
+      }
+      Next();
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    state_[i] = jumped_state[i];
+  }
+  has_spare_gaussian_ = false;
+}
+
+RandomNumberGenerator RandomNumberGenerator::Split() {
+  RandomNumberGenerator split = *this;
+  Jump();
+  return split;
 }
 
-// Get a random double between lower and upper (inclusive).
+// Get a random double in [lower, upper).
 double RandomNumberGenerator::RandDouble(const double lower,
                                          const double upper) {
-  std::uniform_real_distribution<double> distribution(lower, upper);
-  return distribution(util_generator);
+  return lower + (upper - lower) * NextUnitDouble();
 }
 
 float RandomNumberGenerator::RandFloat(const float lower, const float upper) {
-  std::uniform_real_distribution<float> distribution(lower, upper);
-  return distribution(util_generator);
+  // Use the upper 24 bits for the mantissa.
+  const float unit = (Next() >> 40) * (1.0f / 16777216.0f);
+  return lower + (upper - lower) * unit;
 }
 
 // Get a random int between lower and upper (inclusive).
 int RandomNumberGenerator::RandInt(const int lower, const int upper) {
-  std::uniform_int_distribution<int> distribution(lower, upper);
-  return distribution(util_generator);
+  DCHECK_LE(lower, upper);
+  // Lemire's nearly divisionless method for an unbiased integer in [0, range).
+  const uint64_t range =
+      static_cast<uint64_t>(static_cast<int64_t>(upper) - lower) + 1;
+  uint64_t product = (Next() >> 32) * range;
+  uint32_t low_bits = static_cast<uint32_t>(product);
+  if (low_bits < range) {
+    const uint32_t threshold = static_cast<uint32_t>((1ULL << 32) % range);
+    while (low_bits < threshold) {
+      product = (Next() >> 32) * range;
+      low_bits = static_cast<uint32_t>(product);
+    }
+  }
+  return static_cast<int>(lower + static_cast<int64_t>(product >> 32));
 }
 
 // Gaussian Distribution with the corresponding mean and std dev.
 double RandomNumberGenerator::RandGaussian(const double mean,
                                            const double std_dev) {
-  std::normal_distribution<double> distribution(mean, std_dev);
-  return distribution(util_generator);
+  return mean + std_dev * NextGaussian();
+}
+
+void RandomNumberGenerator::RandInts(const int lower,
+                                     const int upper,
+                                     const int num_values,
+                                     int* values) {
+  CHECK_NOTNULL(values);
+  CHECK_LE(lower, upper);
+  // The range and the rejection threshold of Lemire's method are computed
+  // once for all values. Each 64-bit draw provides two 32-bit candidates, so
+  // about half as many draws are needed as with RandInt.
+  const uint64_t range =
+      static_cast<uint64_t>(static_cast<int64_t>(upper) - lower) + 1;
+  const uint32_t threshold = static_cast<uint32_t>((1ULL << 32) % range);
+  int i = 0;
+  while (i < num_values) {
+    const uint64_t bits = Next();
+    const uint64_t product_high = (bits >> 32) * range;
+    if (static_cast<uint32_t>(product_high) >= threshold) {
+      values[i++] =
+          static_cast<int>(lower + static_cast<int64_t>(product_high >> 32));
+    }
+    const uint64_t product_low = (bits & 0xffffffffULL) * range;
+    if (i < num_values && static_cast<uint32_t>(product_low) >= threshold) {
+      values[i++] =
+          static_cast<int>(lower + static_cast<int64_t>(product_low >> 32));
+    }
+  }
+}
+
+void RandomNumberGenerator::RandGaussians(const double mean,
+                                          const double std_dev,
+                                          const int num_values,
+                                          double* values) {
+  CHECK_NOTNULL(values);
+  int i = 0;
+  if (num_values > 0 && has_spare_gaussian_) {
+    has_spare_gaussian_ = false;
+    values[i++] = mean + std_dev * spare_gaussian_;
+  }
+
+  // Both values of each polar method draw are written directly. Only a last
+  // odd value is kept as the spare.
+  while (i < num_values) {
+    double u, v, s;
+    do {
+      u = 2.0 * NextUnitDouble() - 1.0;
+      v = 2.0 * NextUnitDouble() - 1.0;
+      s = u * u + v * v;
+    } while (s >= 1.0 || s == 0.0);
+    const double scale = std::sqrt(-2.0 * std::log(s) / s);
+    values[i++] = mean + std_dev * u * scale;
+    if (i < num_values) {
+      values[i++] = mean + std_dev * v * scale;
+    } else {
+      spare_gaussian_ = v * scale;
+      has_spare_gaussian_ = true;
+    }
+  }
 }
 
 Eigen::Vector2d RandomNumberGenerator::RandVector2d(const double min,
@@ -36,13 +36,19 @@
 #define THEIA_UTIL_RANDOM_H_
 
 #include <Eigen/Core>
+#include <cstdint>
 #include <random>
 
 namespace theia {
 
-// A wrapper around the c++11 random generator utilities. This allows for a
-// thread-safe random number generator that may be easily instantiated and
-// passed around as an object.
+// A small and fast random number generator with per-instance state. Each
+// instance owns an xoshiro256** engine, so generators seeded with the same
+// value produce the same stream regardless of which thread uses them or of
+// any other generator. An instance must not be used by several threads at
+// once; use Split() to hand each thread or task its own generator.
+//
+// The engine is described in "Scrambled Linear Pseudorandom Number Generators"
+// by Blackman and Vigna, ACM Transactions on Mathematical Software (2021).
 class RandomNumberGenerator {
  public:
   // Creates the random number generator using the current time as the seed.
@@ -54,18 +60,40 @@ class RandomNumberGenerator {
   // Seeds the random number generator with the given value.
   void Seed(const unsigned seed);
 
-  // Get a random double between lower and upper (inclusive).
+  // Advances the generator by 2^128 draws. Jumping a copy of a generator k
+  // times gives k streams that do not overlap in practice.
+  void Jump();
+
+  // Returns a generator that continues the current stream and jumps this
+  // generator ahead, so the two streams do not overlap. Splitting a seeded
+  // generator in a fixed order gives reproducible streams for parallel work.
+  RandomNumberGenerator Split();
+
+  // Get a random double in [lower, upper).
   double RandDouble(const double lower, const double upper);
 
-  // Get a random float between lower and upper (inclusive).
+  // Get a random float in [lower, upper).
   float RandFloat(const float lower, const float upper);
 
-  // Get a random double between lower and upper (inclusive).
+  // Get a random int between lower and upper (inclusive).
   int RandInt(const int lower, const int upper);
 
   // Generate a number drawn from a gaussian distribution.
   double RandGaussian(const double mean, const double std_dev);
 
+  // Fill values with num_values independent draws from the same distributions
+  // as RandInt and RandGaussian. The range checks and constants are hoisted
+  // out of the loop and RandInts uses both halves of each 64-bit draw, so the
+  // values differ from those of a loop over RandInt with the same seed.
+  void RandInts(const int lower,
+                const int upper,
+                const int num_values,
+                int* values);
+  void RandGaussians(const double mean,
+                     const double std_dev,
+                     const int num_values,
+                     double* values);
+
   // Return eigen types with random initialization. These are just convenience
   // methods. Methods without min and max assign random values between -1 and 1
   // just like the Eigen::Random function.
@@ -94,6 +122,23 @@ class RandomNumberGenerator {
       }
     }
   }
+
+ private:
+  // Returns the next 64 random bits.
+  uint64_t Next();
+
+  // Returns a double in [0, 1).
+  double NextUnitDouble();
+
+  // Returns a draw from the standard normal distribution.
+  double NextGaussian();
+
+  uint64_t state_[4];
+
+  // The polar method generates gaussians in pairs. The second one is kept for
+  // the next call.
+  bool has_spare_gaussian_;
+  double spare_gaussian_;
 };
 
 }  // namespace theia
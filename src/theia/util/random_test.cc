@@ -0,0 +1,139 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/util/random.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace theia {
+
+TEST(RandomNumberGenerator, SameSeedGivesSameStream) {
+  RandomNumberGenerator rng1(59), rng2(59);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(rng1.RandInt(0, 1000000), rng2.RandInt(0, 1000000));
+    EXPECT_EQ(rng1.RandGaussian(0.0, 1.0), rng2.RandGaussian(0.0, 1.0));
+  }
+
+  // Reseeding restarts the stream.
+  RandomNumberGenerator rng3(59);
+  const double value = rng3.RandDouble(0.0, 1.0);
+  rng3.RandGaussian(0.0, 1.0);
+  rng3.Seed(59);
+  EXPECT_EQ(rng3.RandDouble(0.0, 1.0), value);
+}
+
+TEST(RandomNumberGenerator, SplitStreamsAreReproducibleAndDistinct) {
+  RandomNumberGenerator rng1(59), rng2(59);
+  RandomNumberGenerator split1 = rng1.Split();
+  RandomNumberGenerator split2 = rng2.Split();
+  int num_equal = 0;
+  for (int i = 0; i < 100; i++) {
+    const int value1 = split1.RandInt(0, 1000000);
+    EXPECT_EQ(value1, split2.RandInt(0, 1000000));
+    const int value2 = rng1.RandInt(0, 1000000);
+    EXPECT_EQ(value2, rng2.RandInt(0, 1000000));
+    if (value1 == value2) {
+      ++num_equal;
+    }
+  }
+  EXPECT_LT(num_equal, 5);
+}
+
+TEST(RandomNumberGenerator, RandIntIsWithinBounds) {
+  RandomNumberGenerator rng(59);
+  const int kNumValues = 10000;
+  std::vector<int> values(kNumValues);
+  rng.RandInts(-3, 3, kNumValues, values.data());
+  std::vector<int> histogram(7, 0);
+  for (const int value : values) {
+    ASSERT_GE(value, -3);
+    ASSERT_LE(value, 3);
+    ++histogram[value + 3];
+  }
+  // Every value in the range is drawn.
+  for (const int count : histogram) {
+    EXPECT_GT(count, 0);
+  }
+
+  // The full range of an int must not overflow.
+  for (int i = 0; i < 100; i++) {
+    rng.RandInt(std::numeric_limits<int>::min(),
+                std::numeric_limits<int>::max());
+  }
+  EXPECT_EQ(rng.RandInt(5, 5), 5);
+
+  rng.RandInts(std::numeric_limits<int>::min(),
+               std::numeric_limits<int>::max(),
+               kNumValues,
+               values.data());
+  rng.RandInts(5, 5, kNumValues, values.data());
+  for (const int value : values) {
+    ASSERT_EQ(value, 5);
+  }
+}
+
+TEST(RandomNumberGenerator, RandGaussiansKeepOddValueAsSpare) {
+  // An odd fill leaves the second value of the last pair as the spare, so a
+  // fill of 3 followed by a single draw matches a fill of 4.
+  RandomNumberGenerator rng1(59), rng2(59);
+  double values1[4], values2[4];
+  rng1.RandGaussians(0.0, 1.0, 3, values1);
+  values1[3] = rng1.RandGaussian(0.0, 1.0);
+  rng2.RandGaussians(0.0, 1.0, 4, values2);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(values1[i], values2[i]);
+  }
+}
+
+TEST(RandomNumberGenerator, RandGaussiansHaveCorrectMoments) {
+  RandomNumberGenerator rng(59);
+  const int kNumValues = 100000;
+  const double kMean = 2.0;
+  const double kStdDev = 0.5;
+  std::vector<double> values(kNumValues);
+  rng.RandGaussians(kMean, kStdDev, kNumValues, values.data());
+
+  double sum = 0.0, sum_of_squares = 0.0;
+  for (const double value : values) {
+    sum += value;
+    sum_of_squares += value * value;
+  }
+  const double mean = sum / kNumValues;
+  const double variance = sum_of_squares / kNumValues - mean * mean;
+  EXPECT_NEAR(mean, kMean, 0.01);
+  EXPECT_NEAR(std::sqrt(variance), kStdDev, 0.01);
+}
+
+}  // namespace theia
@@ -0,0 +1,236 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef THEIA_UTIL_TEXT_PARSER_H_
+#define THEIA_UTIL_TEXT_PARSER_H_
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace theia {
+
+// A fast tokenizer for whitespace-separated numbers and words in a character
+// range, e.g. a MappedFile or a part of one. Numbers are converted in place
+// without any stream or locale machinery for integers and with strtod for
+// floating point values. Each method returns false if the next token is missing
+// or malformed, in which case the parser does not advance past that token.
+class TextParser {
+ public:
+  TextParser(const char* begin, const char* end) : pos_(begin), end_(end) {}
+
+  // Returns true if only whitespace is left.
+  bool AtEnd() {
+    SkipWhitespace();
+    return pos_ == end_;
+  }
+
+  // The current position of the parser and the end of its range.
+  const char* position() const { return pos_; }
+  const char* end() const { return end_; }
+
+  bool ReadInt(int* value) {
+    SkipWhitespace();
+    const char* pos = pos_;
+    bool negative = false;
+    if (pos != end_ && (*pos == '-' || *pos == '+')) {
+      negative = *pos == '-';
+      ++pos;
+    }
+    if (pos == end_ || !IsDigit(*pos)) {
+      return false;
+    }
+    // Values outside of the range of an int are malformed. The magnitude of
+    // the most negative int is one larger than the largest int.
+    const long long max_magnitude =  // NOLINT
+        negative ? -static_cast<long long>(std::numeric_limits<int>::min())
+                 : std::numeric_limits<int>::max();
+    long long result = 0;  // NOLINT
+    for (; pos != end_ && IsDigit(*pos); ++pos) {
+      result = 10 * result + (*pos - '0');
+      if (result > max_magnitude) {
+        return false;
+      }
+    }
+    if (pos != end_ && !IsWhitespace(*pos)) {
+      return false;
+    }
+    *value = static_cast<int>(negative ? -result : result);
+    pos_ = pos;
+    return true;
+  }
+
+  bool ReadDouble(double* value) {
+    SkipWhitespace();
+    const char* token_end = FindTokenEnd();
+    if (token_end == pos_) {
+      return false;
+    }
+
+    // strtod stops at the whitespace that ends the token. Only a token that
+    // ends the range needs to be copied to be null-terminated.
+    char* parsed_end;
+    if (token_end != end_) {
+      *value = std::strtod(pos_, &parsed_end);
+      if (parsed_end != token_end) {
+        return false;
+      }
+    } else {
+      static const int kMaxTokenLength = 64;
+      const int length = token_end - pos_;
+      if (length >= kMaxTokenLength) {
+        return false;
+      }
+      char token[kMaxTokenLength];
+      std::memcpy(token, pos_, length);
+      token[length] = '\0';
+      *value = std::strtod(token, &parsed_end);
+      if (parsed_end != token + length) {
+        return false;
+      }
+    }
+    pos_ = token_end;
+    return true;
+  }
+
+  bool ReadFloat(float* value) {
+    double double_value;
+    if (!ReadDouble(&double_value)) {
+      return false;
+    }
+    *value = static_cast<float>(double_value);
+    return true;
+  }
+
+  // Reads the next whitespace-separated word.
+  bool ReadToken(std::string* token) {
+    SkipWhitespace();
+    const char* token_end = FindTokenEnd();
+    if (token_end == pos_) {
+      return false;
+    }
+    token->assign(pos_, token_end);
+    pos_ = token_end;
+    return true;
+  }
+
+  // Reads the rest of the current line without the line break and moves to the
+  // start of the next line.
+  bool ReadLine(std::string* line) {
+    if (pos_ == end_) {
+      return false;
+    }
+    const char* line_end = FindLineEnd(pos_, end_);
+    const char* content_end = line_end;
+    if (content_end != pos_ && content_end[-1] == '\r') {
+      --content_end;
+    }
+    line->assign(pos_, content_end);
+    pos_ = line_end == end_ ? end_ : line_end + 1;
+    return true;
+  }
+
+  // Moves to the start of the next line.
+  bool SkipLine() {
+    if (pos_ == end_) {
+      return false;
+    }
+    const char* line_end = FindLineEnd(pos_, end_);
+    pos_ = line_end == end_ ? end_ : line_end + 1;
+    return true;
+  }
+
+  // Returns a pointer to the first line break at or after begin, or end if
+  // there is none.
+  static const char* FindLineEnd(const char* begin, const char* end) {
+    const void* line_end = std::memchr(begin, '\n', end - begin);
+    return line_end == nullptr ? end : static_cast<const char*>(line_end);
+  }
+
+ private:
+  static bool IsDigit(const char c) { return c >= '0' && c <= '9'; }
+
+  static bool IsWhitespace(const char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+           c == '\f';
+  }
+
+  void SkipWhitespace() {
+    while (pos_ != end_ && IsWhitespace(*pos_)) {
+      ++pos_;
+    }
+  }
+
+  const char* FindTokenEnd() const {
+    const char* token_end = pos_;
+    while (token_end != end_ && !IsWhitespace(*token_end)) {
+      ++token_end;
+    }
+    return token_end;
+  }
+
+  const char* pos_;
+  const char* end_;
+};
+
+// Finds the start of every line in [begin, end) that contains a character
+// other than whitespace. The end of the range is appended so that line i spans
+// [(*line_starts)[i], (*line_starts)[i + 1]). This allows line-oriented files
+// to be split into chunks that are parsed in parallel.
+inline void FindNonEmptyLineStarts(const char* begin,
+                                   const char* end,
+                                   std::vector<const char*>* line_starts) {
+  line_starts->clear();
+  const char* line_begin = begin;
+  while (line_begin != end) {
+    const char* line_end = TextParser::FindLineEnd(line_begin, end);
+    TextParser line(line_begin, line_end);
+    if (!line.AtEnd()) {
+      line_starts->emplace_back(line_begin);
+    }
+    line_begin = line_end == end ? end : line_end + 1;
+  }
+  line_starts->emplace_back(end);
+}
+
+// Returns the 1-based number of the line of a file that contains position,
+// where begin is the start of the file. This is only meant for error messages
+// since it scans the file up to position.
+inline int LineNumber(const char* begin, const char* position) {
+  return 1 + std::count(begin, position, '\n');
+}
+
+}  // namespace theia
+
+#endif  // THEIA_UTIL_TEXT_PARSER_H_
@@ -0,0 +1,121 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/util/text_parser.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace theia {
+
+TEST(TextParser, ReadsNumbersAndTokens) {
+  const std::string text = "  name -12 +7 3.25e2\n-0.5\t1e-3 last";
+  TextParser parser(text.data(), text.data() + text.size());
+  std::string token;
+  int int_value;
+  double double_value;
+  EXPECT_TRUE(parser.ReadToken(&token));
+  EXPECT_EQ(token, "name");
+  EXPECT_TRUE(parser.ReadInt(&int_value));
+  EXPECT_EQ(int_value, -12);
+  EXPECT_TRUE(parser.ReadInt(&int_value));
+  EXPECT_EQ(int_value, 7);
+  EXPECT_TRUE(parser.ReadDouble(&double_value));
+  EXPECT_EQ(double_value, 325.0);
+  EXPECT_TRUE(parser.ReadDouble(&double_value));
+  EXPECT_EQ(double_value, -0.5);
+  EXPECT_TRUE(parser.ReadDouble(&double_value));
+  EXPECT_EQ(double_value, 1e-3);
+  // A word is not a number and the parser does not advance past it.
+  EXPECT_FALSE(parser.ReadInt(&int_value));
+  EXPECT_FALSE(parser.ReadDouble(&double_value));
+  EXPECT_TRUE(parser.ReadToken(&token));
+  EXPECT_EQ(token, "last");
+  EXPECT_TRUE(parser.AtEnd());
+  EXPECT_FALSE(parser.ReadToken(&token));
+}
+
+TEST(TextParser, ParsesNumberAtEndOfRange) {
+  // The range is not null-terminated, so the digits after it must be ignored.
+  const std::string text = "1.5 42123";
+  TextParser parser(text.data(), text.data() + 6);
+  double double_value;
+  int int_value;
+  EXPECT_TRUE(parser.ReadDouble(&double_value));
+  EXPECT_EQ(double_value, 1.5);
+  EXPECT_TRUE(parser.ReadInt(&int_value));
+  EXPECT_EQ(int_value, 42);
+
+  TextParser double_parser(text.data() + 4, text.data() + 6);
+  EXPECT_TRUE(double_parser.ReadDouble(&double_value));
+  EXPECT_EQ(double_value, 42.0);
+  EXPECT_TRUE(double_parser.AtEnd());
+}
+
+TEST(TextParser, RejectsIntOverflow) {
+  const std::string text =
+      "2147483647 -2147483648 2147483648 -2147483649 99999999999999999999";
+  TextParser parser(text.data(), text.data() + text.size());
+  int int_value;
+  EXPECT_TRUE(parser.ReadInt(&int_value));
+  EXPECT_EQ(int_value, std::numeric_limits<int>::max());
+  EXPECT_TRUE(parser.ReadInt(&int_value));
+  EXPECT_EQ(int_value, std::numeric_limits<int>::min());
+  for (int i = 0; i < 3; i++) {
+    EXPECT_FALSE(parser.ReadInt(&int_value));
+    std::string token;
+    EXPECT_TRUE(parser.ReadToken(&token));
+  }
+  EXPECT_TRUE(parser.AtEnd());
+}
+
+TEST(TextParser, ReadsLines) {
+  const std::string text = "first line\r\n\n  \nsecond\nthird";
+  TextParser parser(text.data(), text.data() + text.size());
+  std::string line;
+  EXPECT_TRUE(parser.ReadLine(&line));
+  EXPECT_EQ(line, "first line");
+  EXPECT_TRUE(parser.ReadLine(&line));
+  EXPECT_EQ(line, "");
+
+  std::vector<const char*> line_starts;
+  FindNonEmptyLineStarts(text.data(), text.data() + text.size(), &line_starts);
+  ASSERT_EQ(line_starts.size(), 4);
+  EXPECT_EQ(line_starts[0], text.data());
+  EXPECT_EQ(std::string(line_starts[1], line_starts[1] + 6), "second");
+  EXPECT_EQ(std::string(line_starts[2], line_starts[3]), "third");
+  EXPECT_EQ(line_starts[3], text.data() + text.size());
+}
+
+}  // namespace theia
@@ -62,15 +62,14 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
-#include <future>
 #include <memory>
 #include <mutex>
-#include <queue>
-#include <stdexcept>
 #include <thread>
-#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -78,37 +77,257 @@
 
 namespace theia {
 
-ThreadPool::ThreadPool(const int num_threads) : stop(false) {
+namespace {
+
+std::mutex global_scheduler_mutex;
+std::unique_ptr<TaskScheduler> global_scheduler;
+// Zero until SetThreadBudget is called.
+std::atomic<int> thread_budget(0);
+
+// The scheduler and queue of the worker thread that is running, if any.
+thread_local TaskScheduler* current_scheduler = nullptr;
+thread_local int current_queue_index = -1;
+
+// The number of tasks that the calling thread is running, counting nested
+// tasks.
+thread_local int parallel_task_depth = 0;
+
+// Marks the calling thread as running a task while in scope.
+class ParallelTaskScope {
+ public:
+  ParallelTaskScope() { ++parallel_task_depth; }
+  ~ParallelTaskScope() { --parallel_task_depth; }
+};
+
+}  // namespace
+
+void SetThreadBudget(const int num_threads) {
+  CHECK_GE(num_threads, 1);
+  std::lock_guard<std::mutex> lock(global_scheduler_mutex);
+  thread_budget = num_threads;
+  // The scheduler is recreated with the new size when it is used next.
+  global_scheduler.reset();
+}
+
+int GetThreadBudget() {
+  const int num_threads = thread_budget.load();
+  if (num_threads > 0) {
+    return num_threads;
+  }
+  return std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+}
+
+bool IsInParallelTask() { return parallel_task_depth > 0; }
+
+int GetNumThreadsForExternalSolver(const int num_threads) {
+  if (IsInParallelTask()) {
+    return 1;
+  }
+  return std::max(std::min(num_threads, GetThreadBudget()), 1);
+}
+
+TaskScheduler::TaskScheduler(const int num_threads)
+    : num_queued_tasks_(0), stop_(false) {
+  CHECK_GE(num_threads, 1)
+      << "The number of threads specified to the TaskScheduler is "
+         "insufficient.";
+  for (int i = 0; i <= num_threads; i++) {
+    queues_.emplace_back(new TaskQueue);
+  }
+  for (int i = 0; i < num_threads; i++) {
+    workers_.emplace_back([this, i]() { WorkerLoop(i); });
+  }
+}
+
+// the destructor joins all threads
+TaskScheduler::~TaskScheduler() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+TaskScheduler* TaskScheduler::Global() {
+  std::lock_guard<std::mutex> lock(global_scheduler_mutex);
+  if (global_scheduler == nullptr) {
+    global_scheduler.reset(
+        new TaskScheduler(std::max(GetThreadBudget() - 1, 1)));
+  }
+  return global_scheduler.get();
+}
+
+void TaskScheduler::Spawn(std::function<void()> task, TaskGroup* group) {
+  group->num_pending_tasks_.fetch_add(1);
+  std::function<void()> group_task = [this, task, group]() {
+    task();
+    if (group->num_pending_tasks_.fetch_sub(1) == 1) {
+      // The group may be destroyed as soon as its waiter sees that it has
+      // finished, so only the scheduler is used from here on.
+      { std::lock_guard<std::mutex> lock(mutex_); }
+      condition_.notify_all();
+    }
+  };
+
+  // Workers of this scheduler push nested tasks to their own queue.
+  const int queue_index = current_scheduler == this ? current_queue_index
+                                                    : queues_.size() - 1;
+  TaskQueue* queue = queues_[queue_index].get();
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->tasks.emplace_back(std::move(group_task));
+  }
+  num_queued_tasks_.fetch_add(1);
+  { std::lock_guard<std::mutex> lock(mutex_); }
+  condition_.notify_one();
+}
+
+void TaskScheduler::Wait(TaskGroup* group) {
+  const int queue_index =
+      current_scheduler == this ? current_queue_index : -1;
+  while (group->num_pending_tasks_.load() > 0) {
+    if (RunQueuedTask(queue_index)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this, group]() {
+      return group->num_pending_tasks_.load() == 0 ||
+             num_queued_tasks_.load() > 0;
+    });
+  }
+}
+
+void TaskScheduler::WorkerLoop(const int queue_index) {
+  current_scheduler = this;
+  current_queue_index = queue_index;
+  for (;;) {
+    if (RunQueuedTask(queue_index)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(
+        lock, [this]() { return stop_ || num_queued_tasks_.load() > 0; });
+    if (stop_ && num_queued_tasks_.load() == 0) {
+      return;
+    }
+  }
+}
+
+bool TaskScheduler::RunQueuedTask(const int queue_index) {
+  std::function<void()> task;
+  if (queue_index >= 0) {
+    TaskQueue* queue = queues_[queue_index].get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (!queue->tasks.empty()) {
+      task = std::move(queue->tasks.back());
+      queue->tasks.pop_back();
+    }
+  }
+
+  // Steal the oldest task of another queue, starting after our own queue so
+  // that the workers do not all contend for the same one.
+  const int num_queues = queues_.size();
+  for (int i = 1; i <= num_queues && !task; i++) {
+    TaskQueue* queue =
+        queues_[(std::max(queue_index, 0) + i) % num_queues].get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (!queue->tasks.empty()) {
+      task = std::move(queue->tasks.front());
+      queue->tasks.pop_front();
+    }
+  }
+
+  if (!task) {
+    return false;
+  }
+  num_queued_tasks_.fetch_sub(1);
+  ParallelTaskScope scope;
+  task();
+  return true;
+}
+
+ThreadPool::ThreadPool(const int num_threads)
+    : num_threads_(num_threads), num_running_(0) {
   CHECK_GE(num_threads, 1)
       << "The number of threads specified to the ThreadPool is insufficient.";
-  for (size_t i = 0; i < num_threads; ++i) {
-    workers.emplace_back([this] {
-      for (;;) {
-        std::function<void()> task;
-
-        {
-          std::unique_lock<std::mutex> lock(this->queue_mutex);
-          this->condition.wait(
-              lock, [this] { return this->stop || !this->tasks.empty(); });
-          if (this->stop && this->tasks.empty()) return;
-          task = std::move(this->tasks.front());
-          this->tasks.pop();
-        }
-
-        task();
+}
+
+// the destructor waits for all tasks
+ThreadPool::~ThreadPool() { TaskScheduler::Global()->Wait(&group_); }
+
+void ThreadPool::Enqueue(std::function<void()> task) {
+  bool run_tasks = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.emplace(std::move(task));
+    if (num_running_ < num_threads_) {
+      ++num_running_;
+      run_tasks = true;
+    }
+  }
+  if (run_tasks) {
+    TaskScheduler::Global()->Spawn([this]() { RunTasks(); }, &group_);
+  }
+}
+
+void ThreadPool::RunTasks() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (tasks_.empty()) {
+        --num_running_;
+        return;
       }
-    });
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
   }
 }
 
-// the destructor joins all threads
-ThreadPool::~ThreadPool() {
+void ParallelForRange(const int num_threads,
+                      const int num_items,
+                      const std::function<void(int, int)>& function) {
+  CHECK_GE(num_threads, 1);
+  static const int kNumBlocksPerThread = 4;
+  if (num_items <= 0) {
+    return;
+  }
+
+  const int num_workers =
+      std::min({num_threads, num_items, GetThreadBudget()});
+  if (num_workers == 1) {
+    function(0, num_items);
+    return;
+  }
+
+  // Every thread takes the next block until none are left. The calling thread
+  // takes blocks as well, so all blocks are done even if every worker of the
+  // scheduler is busy with other work.
+  const int num_blocks = std::min(num_items, kNumBlocksPerThread * num_workers);
+  std::atomic<int> next_block(0);
+  const auto run_blocks = [&]() {
+    for (int i = next_block++; i < num_blocks; i = next_block++) {
+      const int begin = static_cast<int64_t>(num_items) * i / num_blocks;
+      const int end = static_cast<int64_t>(num_items) * (i + 1) / num_blocks;
+      function(begin, end);
+    }
+  };
+
+  TaskScheduler* scheduler = TaskScheduler::Global();
+  TaskGroup group;
+  for (int i = 1; i < num_workers; i++) {
+    scheduler->Spawn(run_blocks, &group);
+  }
   {
-    std::unique_lock<std::mutex> lock(queue_mutex);
-    stop = true;
+    ParallelTaskScope scope;
+    run_blocks();
   }
-  condition.notify_all();
-  for (std::thread& worker : workers) worker.join();
+  scheduler->Wait(&group);
 }
 
 }  // namespace theia
@@ -63,7 +63,7 @@
 
 #include <glog/logging.h>
 
-#include <chrono>
+#include <atomic>
 #include <condition_variable>
 #include <deque>
 #include <functional>
@@ -71,7 +71,6 @@
 #include <memory>
 #include <mutex>
 #include <queue>
-#include <stdexcept>
 #include <thread>
 #include <type_traits>
 #include <utility>
@@ -81,10 +80,96 @@
 
 namespace theia {
 
-// A simple threadpool implementation.
-class ThreadPool {
+// Sets the number of threads that Theia uses for parallel work, including the
+// thread that calls into Theia. The default is the number of hardware threads.
+// The process-wide scheduler is resized, so this must not be called while
+// parallel work is running.
+void SetThreadBudget(const int num_threads);
+int GetThreadBudget();
+
+// Returns true if the calling thread is running a task of a parallel loop or
+// of the scheduler.
+bool IsInParallelTask();
+
+// Returns the number of threads that a library with its own threads, such as
+// Ceres, should be given when num_threads are requested. Those threads are not
+// part of the scheduler, so inside a parallel task, where the other threads of
+// the budget are busy with sibling tasks, this is 1. Otherwise it is
+// num_threads limited to the thread budget.
+int GetNumThreadsForExternalSolver(const int num_threads);
+
+// A set of tasks that is waited on as a whole with TaskScheduler::Wait.
+class TaskGroup {
+ public:
+  TaskGroup() : num_pending_tasks_(0) {}
+  ~TaskGroup() { CHECK_EQ(num_pending_tasks_.load(), 0); }
+
+ private:
+  friend class TaskScheduler;
+  std::atomic<int> num_pending_tasks_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskGroup);
+};
+
+// A work-stealing task scheduler. Each worker thread owns a queue of tasks:
+// tasks spawned by a worker are pushed to and popped from the back of its own
+// queue so that nested work stays on the same thread, and idle workers steal
+// from the front of the other queues. Tasks spawned by other threads go to a
+// shared queue. A thread that waits for a group runs queued tasks until the
+// group has finished, so tasks may spawn and wait for nested tasks without
+// blocking a worker or creating more threads.
+//
+// All parallel code in Theia runs on the process-wide scheduler returned by
+// TaskScheduler::Global(), which has GetThreadBudget() - 1 workers since the
+// calling thread works as well.
+class TaskScheduler {
  public:
   // All the threads are created upon construction.
+  explicit TaskScheduler(const int num_threads);
+  ~TaskScheduler();
+
+  static TaskScheduler* Global();
+
+  int NumThreads() const { return workers_.size(); }
+
+  // Adds the task to the group and queues it.
+  void Spawn(std::function<void()> task, TaskGroup* group);
+
+  // Returns once all tasks of the group have finished. The calling thread runs
+  // queued tasks in the meantime.
+  void Wait(TaskGroup* group);
+
+ private:
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()> > tasks;
+  };
+
+  void WorkerLoop(const int queue_index);
+
+  // Runs one queued task, preferring the back of the queue with the given
+  // index (which may be -1 for threads without a queue). Returns false if no
+  // task was queued.
+  bool RunQueuedTask(const int queue_index);
+
+  // One queue per worker followed by the shared queue.
+  std::vector<std::unique_ptr<TaskQueue> > queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<int> num_queued_tasks_;
+
+  // Idle workers and waiting threads sleep on the condition until a task is
+  // queued or a group finishes.
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stop_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskScheduler);
+};
+
+// Runs tasks on the process-wide scheduler with at most num_threads of them
+// running at the same time. The destructor waits for all tasks to finish.
+class ThreadPool {
+ public:
   explicit ThreadPool(const int num_threads);
   ~ThreadPool();
 
@@ -94,15 +179,17 @@ class ThreadPool {
       -> std::future<typename std::result_of<F(Args...)>::type>;
 
  private:
-  // Keep track of threads so we can join them
-  std::vector<std::thread> workers;
-  // The task queue
-  std::queue<std::function<void()> > tasks;
+  void Enqueue(std::function<void()> task);
 
-  // Synchronization
-  std::mutex queue_mutex;
-  std::condition_variable condition;
-  bool stop;
+  // Runs the queued tasks of the pool until none are left. At most
+  // num_threads_ of these run at the same time.
+  void RunTasks();
+
+  const int num_threads_;
+  int num_running_;
+  std::queue<std::function<void()> > tasks_;
+  std::mutex mutex_;
+  TaskGroup group_;
 
   DISALLOW_COPY_AND_ASSIGN(ThreadPool);
 };
@@ -117,17 +204,45 @@ auto ThreadPool::Add(F&& f, Args&&... args)
       std::bind(std::forward<F>(f), std::forward<Args>(args)...));
 
   std::future<return_type> res = task->get_future();
-  {
-    std::unique_lock<std::mutex> lock(queue_mutex);
-
-    // don't allow enqueueing after stopping the pool
-    CHECK(!stop) << "The ThreadPool object has been destroyed! Cannot add more "
-                    "tasks to the ThreadPool!";
+  Enqueue([task]() { (*task)(); });
+  return res;
+}
 
-    tasks.emplace([task]() { (*task)(); });
+// Calls function(begin, end) for contiguous ranges that together cover
+// [0, num_items) with at most num_threads threads (and no more than the thread
+// budget) and returns once all calls have finished. There are a few ranges per
+// thread and threads take the next range as soon as they finish one, so the
+// load is balanced when the cost per item varies. Per-range state such as
+// partial sums may be kept in the function. If only one thread is used the
+// whole range is processed in one call on the calling thread. This may be
+// called from within other parallel loops.
+void ParallelForRange(const int num_threads,
+                      const int num_items,
+                      const std::function<void(int, int)>& function);
+
+// Calls function(i) for all i in [0, num_items) with num_threads threads and
+// returns once all calls have finished. The items are split into contiguous
+// ranges as in ParallelForRange. The function must be safe to call
+// concurrently for different items. If num_threads is 1 the items are
+// processed in order on the calling thread.
+template <class Function>
+void ParallelFor(const int num_threads,
+                 const int num_items,
+                 const Function& function) {
+  CHECK_GE(num_threads, 1);
+  if (num_threads == 1 || num_items == 1) {
+    for (int i = 0; i < num_items; i++) {
+      function(i);
+    }
+    return;
   }
-  condition.notify_one();
-  return res;
+
+  ParallelForRange(
+      num_threads, num_items, [&function](const int begin, const int end) {
+        for (int i = begin; i < end; i++) {
+          function(i);
+        }
+      });
 }
 
 }  // namespace theia
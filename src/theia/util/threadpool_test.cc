@@ -0,0 +1,148 @@
+// Copyright (C) 2024 The Regents of the University of California (Regents).
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of The Regents or University of California nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "theia/util/threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace theia {
+
+TEST(ParallelFor, CallsEveryItemOnce) {
+  SetThreadBudget(4);
+  static const int kNumItems = 1000;
+  std::vector<std::atomic<int> > num_calls(kNumItems);
+  for (std::atomic<int>& num_call : num_calls) {
+    num_call = 0;
+  }
+  ParallelFor(4, kNumItems, [&](const int i) { ++num_calls[i]; });
+  for (const std::atomic<int>& num_call : num_calls) {
+    EXPECT_EQ(num_call.load(), 1);
+  }
+}
+
+TEST(ParallelFor, SingleThreadRunsItemsInOrder) {
+  std::vector<int> items;
+  ParallelFor(1, 100, [&](const int i) { items.emplace_back(i); });
+  ASSERT_EQ(items.size(), 100);
+  for (int i = 0; i < items.size(); i++) {
+    EXPECT_EQ(items[i], i);
+  }
+}
+
+TEST(ParallelFor, LimitsTheNumberOfThreads) {
+  SetThreadBudget(8);
+  std::atomic<int> num_running(0), max_num_running(0);
+  ParallelFor(2, 64, [&](const int i) {
+    const int num_now_running = ++num_running;
+    int expected = max_num_running.load();
+    while (num_now_running > expected &&
+           !max_num_running.compare_exchange_weak(expected, num_now_running)) {
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    --num_running;
+  });
+  EXPECT_LE(max_num_running.load(), 2);
+}
+
+TEST(ParallelForRange, RangesCoverAllItems) {
+  SetThreadBudget(4);
+  static const int kNumItems = 1001;
+  std::vector<std::atomic<int> > num_calls(kNumItems);
+  for (std::atomic<int>& num_call : num_calls) {
+    num_call = 0;
+  }
+  ParallelForRange(4, kNumItems, [&](const int begin, const int end) {
+    EXPECT_LT(begin, end);
+    for (int i = begin; i < end; i++) {
+      ++num_calls[i];
+    }
+  });
+  for (const std::atomic<int>& num_call : num_calls) {
+    EXPECT_EQ(num_call.load(), 1);
+  }
+}
+
+TEST(ParallelFor, NestedLoopsFinish) {
+  // Every outer item waits for an inner loop, which must not deadlock even
+  // though there are more outer items than threads.
+  SetThreadBudget(2);
+  static const int kNumOuterItems = 16;
+  static const int kNumInnerItems = 100;
+  std::vector<int> sums(kNumOuterItems, 0);
+  ParallelFor(4, kNumOuterItems, [&](const int i) {
+    std::atomic<int> sum(0);
+    ParallelFor(4, kNumInnerItems, [&](const int j) { sum += j; });
+    sums[i] = sum;
+  });
+  for (const int sum : sums) {
+    EXPECT_EQ(sum, kNumInnerItems * (kNumInnerItems - 1) / 2);
+  }
+}
+
+TEST(ThreadPool, ReturnsTheResultsOfAllTasks) {
+  SetThreadBudget(4);
+  std::vector<std::future<int> > results;
+  {
+    ThreadPool pool(3);
+    for (int i = 0; i < 50; i++) {
+      results.emplace_back(pool.Add([](const int x) { return x * x; }, i));
+    }
+  }
+  for (int i = 0; i < results.size(); i++) {
+    EXPECT_EQ(results[i].get(), i * i);
+  }
+}
+
+TEST(GetNumThreadsForExternalSolver, UsesOneThreadInsideParallelTasks) {
+  SetThreadBudget(4);
+  EXPECT_FALSE(IsInParallelTask());
+  EXPECT_EQ(GetNumThreadsForExternalSolver(2), 2);
+  EXPECT_EQ(GetNumThreadsForExternalSolver(8), 4);
+
+  static const int kNumItems = 64;
+  std::vector<int> num_solver_threads(kNumItems, 0);
+  ParallelFor(4, kNumItems, [&](const int i) {
+    num_solver_threads[i] = GetNumThreadsForExternalSolver(4);
+  });
+  for (const int num_threads : num_solver_threads) {
+    EXPECT_EQ(num_threads, 1);
+  }
+  EXPECT_FALSE(IsInParallelTask());
+}
+
+}  // namespace theia